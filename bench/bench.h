@@ -0,0 +1,57 @@
+#ifndef GLISY_BENCH_H
+#define GLISY_BENCH_H
+
+#include <time.h>
+#include <stdio.h>
+#include <glisy/math.h>
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 1000000
+#endif
+
+/**
+ * Returns monotonic time in seconds.
+ */
+
+static inline double
+bench_now (void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Keeps the optimizer from discarding benchmarked work.
+ */
+
+#define bench_use(x) __asm__ __volatile__("" : : "g"(&(x)) : "memory")
+
+/**
+ * Runs body n times and prints nanoseconds per iteration.
+ */
+
+#define BENCH(name, n, body) {                                \
+  double start = bench_now();                                 \
+  for (long bench_i = 0; bench_i < (long) (n); ++bench_i) {   \
+    body;                                                     \
+  }                                                           \
+  double elapsed = bench_now() - start;                       \
+  printf("%-40s %10.2f ns/op\n", name, elapsed * 1e9 / (n));  \
+}
+
+/**
+ * Runs body n times, each pass processing items elements, and
+ * prints nanoseconds per element.
+ */
+
+#define BENCH_ITEMS(name, n, items, body) {                             \
+  double start = bench_now();                                           \
+  for (long bench_i = 0; bench_i < (long) (n); ++bench_i) {             \
+    body;                                                               \
+  }                                                                     \
+  double elapsed = bench_now() - start;                                 \
+  printf("%-40s %10.2f ns/item\n", name,                                \
+         elapsed * 1e9 / ((double) (n) * (double) (items)));            \
+}
+
+#endif
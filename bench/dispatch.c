@@ -0,0 +1,72 @@
+#include <glisy/dispatch.h>
+#include "bench.h"
+
+#define COUNT 4096
+#define PASSES (BENCH_ITERATIONS / COUNT * 4)
+
+static mat4 as[COUNT], ms[COUNT];
+static vec3 points[COUNT], out3[COUNT];
+static vec4 points4[COUNT], out4[COUNT];
+
+int
+main (void) {
+  static const char *ops[GLISY_KERNEL_COUNT] = {
+    "mat4_multiply_batch", "vec3_transform_mat4_batch",
+    "vec4_transform_mat4_batch", "vec3_soa_normalize", "quat_slerp_batch"
+  };
+  vec3_soa soa = vec3_soa_create();
+  vec3_soa normals = vec3_soa_create();
+  char name[64];
+
+  for (int i = 0; i < COUNT; ++i) {
+    as[i] = mat4_create();
+    mat4_rotateY(as[i], i * 0.001f);
+    points[i] = vec3(i * 0.001f, 1, -i * 0.002f);
+    points4[i] = vec4(i * 0.001f, 1, -i * 0.002f, 1);
+  }
+  glisy_vec3_soa_from_vec3(&soa, points, COUNT);
+  glisy_vec3_soa_resize(&normals, COUNT);
+
+  const glisy_kernels *tuned = glisy_dispatch_init(GLISY_DISPATCH_TUNE);
+  printf("cpu isa: %s\n", glisy_isa_name(tuned->cpu));
+  for (int op = 0; op < GLISY_KERNEL_COUNT; ++op) {
+    printf("  %-28s tuned to %s\n", ops[op], glisy_isa_name(tuned->isa[op]));
+  }
+
+  for (int isa = 0; isa <= tuned->cpu; ++isa) {
+    glisy_kernels k;
+    glisy_kernels_select(&k, isa, 0);
+
+    snprintf(name, sizeof(name), "mat4_multiply_batch (%s)",
+             glisy_isa_name(k.isa[GLISY_KERNEL_MAT4_MULTIPLY]));
+    BENCH_ITEMS(name, PASSES, COUNT, {
+      k.mat4_multiply_batch(ms, as, as, COUNT);
+      bench_use(ms);
+    });
+
+    snprintf(name, sizeof(name), "vec3_transform_affine (%s)",
+             glisy_isa_name(k.isa[GLISY_KERNEL_VEC3_TRANSFORM]));
+    BENCH_ITEMS(name, PASSES, COUNT, {
+      k.vec3_transform_mat4_batch(out3, points, COUNT, &as[1], 0);
+      bench_use(out3);
+    });
+
+    snprintf(name, sizeof(name), "vec4_transform_mat4 (%s)",
+             glisy_isa_name(k.isa[GLISY_KERNEL_VEC4_TRANSFORM]));
+    BENCH_ITEMS(name, PASSES, COUNT, {
+      k.vec4_transform_mat4_batch(out4, points4, COUNT, &as[1]);
+      bench_use(out4);
+    });
+
+    snprintf(name, sizeof(name), "vec3_soa_normalize (%s)",
+             glisy_isa_name(k.isa[GLISY_KERNEL_VEC3_NORMALIZE]));
+    BENCH_ITEMS(name, PASSES, COUNT, {
+      k.vec3_soa_normalize(&normals, &soa);
+      bench_use(normals);
+    });
+  }
+
+  vec3_soa_free(soa);
+  vec3_soa_free(normals);
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <glisy/vec3_soa.h>
+#include "bench.h"
+
+#define COUNT 16384
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static vec2 a2[COUNT], b2[COUNT];
+static vec3 a3[COUNT], b3[COUNT];
+static vec4 a4[COUNT], b4[COUNT];
+static float lengths[COUNT];
+
+/**
+ * Distance in ulps between two positive floats.
+ */
+
+static long
+ulps (float a, float b) {
+  int32_t ia, ib;
+  memcpy(&ia, &a, sizeof(ia));
+  memcpy(&ib, &b, sizeof(ib));
+  return labs((long) ia - (long) ib);
+}
+
+/**
+ * Sweeps every 61st float in [1e-6, 1e6] and prints the largest
+ * relative and ulp error of the fast routines against the
+ * correctly rounded result.
+ */
+
+static void
+precision (void) {
+  double rsqrt_rel = 0, sqrt_rel = 0, norm_err = 0;
+  long rsqrt_ulps = 0, sqrt_ulps = 0;
+  float lo = 1e-6f, hi = 1e6f;
+  int32_t begin, end;
+  memcpy(&begin, &lo, sizeof(begin));
+  memcpy(&end, &hi, sizeof(end));
+
+  for (int32_t bits = begin; bits < end; bits += 61) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+
+    float r = glisy_rsqrtf_fast(x);
+    float re = (float) (1.0 / sqrt((double) x));
+    rsqrt_rel = fmax(rsqrt_rel, fabs((double) r - re) / re);
+    if (ulps(r, re) > rsqrt_ulps) rsqrt_ulps = ulps(r, re);
+
+    float s = glisy_sqrtf_fast(x);
+    float se = sqrtf(x);
+    sqrt_rel = fmax(sqrt_rel, fabs((double) s - se) / se);
+    if (ulps(s, se) > sqrt_ulps) sqrt_ulps = ulps(s, se);
+
+    vec3 n = vec3_normalize_fast(vec3(x, 1, -0.5f));
+    double len = sqrt((double) n.x * n.x + (double) n.y * n.y +
+                      (double) n.z * n.z);
+    norm_err = fmax(norm_err, fabs(len - 1));
+  }
+
+  printf("%-40s %10.2e rel %4ld ulp\n", "glisy_rsqrtf_fast", rsqrt_rel,
+         rsqrt_ulps);
+  printf("%-40s %10.2e rel %4ld ulp\n", "glisy_sqrtf_fast", sqrt_rel,
+         sqrt_ulps);
+  printf("%-40s %10.2e |len - 1|\n", "glisy_vec3_normalize_fast", norm_err);
+}
+
+int
+main (void) {
+  vec3_soa sa = vec3_soa_create();
+  vec3_soa sb = vec3_soa_create();
+  vec3_soa so = vec3_soa_create();
+
+  for (int i = 0; i < COUNT; ++i) {
+    a2[i] = vec2(i * 0.1f, 1);
+    b2[i] = vec2(1, i * 0.3f);
+    a3[i] = vec3(i * 0.1f, 1, -i);
+    b3[i] = vec3(1, i * 0.3f, 2);
+    a4[i] = vec4(i * 0.1f, 1, -i, 0.5f);
+    b4[i] = vec4(1, i * 0.3f, 2, -1);
+  }
+  glisy_vec3_soa_from_vec3(&sa, a3, COUNT);
+  glisy_vec3_soa_from_vec3(&sb, b3, COUNT);
+
+  precision();
+
+  BENCH_ITEMS("vec2_length", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) lengths[i] = vec2_length(a2[i]);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec2_length_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) lengths[i] = vec2_length_fast(a2[i]);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec2_normalize", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b2[i] = vec2_normalize(a2[i]);
+    bench_use(b2);
+  });
+
+  BENCH_ITEMS("vec2_normalize_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b2[i] = vec2_normalize_fast(a2[i]);
+    bench_use(b2);
+  });
+
+  BENCH_ITEMS("vec3_distance", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) lengths[i] = vec3_distance(a3[i], b3[i]);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec3_distance_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      lengths[i] = vec3_distance_fast(a3[i], b3[i]);
+    }
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec3_normalize", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b3[i] = vec3_normalize(a3[i]);
+    bench_use(b3);
+  });
+
+  BENCH_ITEMS("vec3_normalize_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b3[i] = vec3_normalize_fast(a3[i]);
+    bench_use(b3);
+  });
+
+  BENCH_ITEMS("vec4_length", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) lengths[i] = vec4_length(a4[i]);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec4_length_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) lengths[i] = vec4_length_fast(a4[i]);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("vec4_normalize", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b4[i] = vec4_normalize(a4[i]);
+    bench_use(b4);
+  });
+
+  BENCH_ITEMS("vec4_normalize_fast", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) b4[i] = vec4_normalize_fast(a4[i]);
+    bench_use(b4);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_distance", PASSES, COUNT, {
+    glisy_vec3_soa_distance(lengths, &sa, &sb);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_distance_fast", PASSES, COUNT, {
+    glisy_vec3_soa_distance_fast(lengths, &sa, &sb);
+    bench_use(lengths);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_normalize", PASSES, COUNT, {
+    glisy_vec3_soa_normalize(&so, &sa);
+    bench_use(so);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_normalize_fast", PASSES, COUNT, {
+    glisy_vec3_soa_normalize_fast(&so, &sa);
+    bench_use(so);
+  });
+
+  vec3_soa_free(sa);
+  vec3_soa_free(sb);
+  vec3_soa_free(so);
+  return 0;
+}
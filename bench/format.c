@@ -0,0 +1,85 @@
+#include <glisy/trs.h>
+#include "bench.h"
+
+#define COUNT 1024
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static mat4 ms[COUNT];
+static char memory[COUNT * 256];
+
+/**
+ * The formatting mat4_string used before: snprintf with %g into a
+ * BUFSIZ stack buffer, then strdup.
+ */
+
+static const char *
+snprintf_string (mat4 a) {
+  char str[BUFSIZ];
+  snprintf(str, BUFSIZ, "mat4(%g, %g, %g, %g,\n"
+                        "     %g, %g, %g, %g,\n"
+                        "     %g, %g, %g, %g,\n"
+                        "     %g, %g, %g, %g)",
+                        a.m11, a.m12, a.m13, a.m14,
+                        a.m21, a.m22, a.m23, a.m24,
+                        a.m31, a.m32, a.m33, a.m34,
+                        a.m41, a.m42, a.m43, a.m44);
+  return strdup(str);
+}
+
+int
+main (void) {
+  char buf[GLISY_FORMAT_MAX];
+  size_t bytes = 0;
+
+  for (int i = 0; i < COUNT; ++i) {
+    ms[i] = mat4_create();
+    mat4_rotateY(ms[i], i * 0.01f);
+    ms[i] = mat4_translate(ms[i], vec3(i, i * 0.5f, -1.25f));
+  }
+  for (int i = 0; i < COUNT; ++i) {
+    bytes += mat4_format(buf, sizeof(buf), ms[i]);
+  }
+
+  BENCH_ITEMS("mat4 snprintf %g + strdup", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      free((void *) snprintf_string(ms[i]));
+    }
+  });
+
+  BENCH_ITEMS("mat4_string", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      free((void *) mat4_string(ms[i]));
+    }
+  });
+
+  double start = bench_now();
+  for (int pass = 0; pass < PASSES; ++pass) {
+    for (int i = 0; i < COUNT; ++i) {
+      mat4_format(buf, sizeof(buf), ms[i]);
+      bench_use(buf);
+    }
+  }
+  double elapsed = bench_now() - start;
+  printf("%-40s %10.2f ns/item %8.1f MB/s\n", "mat4_format",
+         elapsed * 1e9 / ((double) PASSES * COUNT),
+         (double) bytes * PASSES / elapsed * 1e-6);
+
+  BENCH_ITEMS("glisy_arena_format (mat4)", PASSES, COUNT, {
+    glisy_arena arena = glisy_arena(memory, sizeof(memory));
+    for (int i = 0; i < COUNT; ++i) {
+      bench_use(*glisy_arena_format(arena, mat4, ms[i]));
+    }
+  });
+
+  BENCH_ITEMS("glisy_format_float", PASSES, COUNT * 16, {
+    for (int i = 0; i < COUNT; ++i) {
+      const float *m = &ms[i].m11;
+      for (int e = 0; e < 16; ++e) {
+        glisy_format_float(buf, m[e]);
+        bench_use(buf);
+      }
+    }
+  });
+
+  return 0;
+}
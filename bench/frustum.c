@@ -0,0 +1,83 @@
+#include <glisy/frustum.h>
+#include "bench.h"
+
+#define SIDE 1000
+#define COUNT (SIDE * SIDE)
+#define PASSES (8 * BENCH_ITERATIONS / COUNT)
+
+static uint32_t naive[COUNT];
+
+int
+main (void) {
+  glisy_pool pool;
+  sphere_soa spheres = sphere_soa_create();
+  aabb_soa boxes = aabb_soa_create();
+  frustum_cull out = frustum_cull_create();
+  size_t n = 0;
+  glisy_pool_init(&pool, 0, 0);
+
+  // a field of objects in row order, seen from above one corner,
+  // so objects close in memory are close in space
+  for (int z = 0; z < SIDE; ++z) {
+    for (int x = 0; x < SIDE; ++x) {
+      float r = 0.3f + 0.2f * ((x * 7 + z * 3) % 5);
+      sphere_soa_push(spheres, sphere({x, 0, z}, r));
+      aabb_soa_push(boxes, aabb({x - r, -r, z - r}, {x + r, 2 * r, z + r}));
+    }
+  }
+  mat4 proj = mat4_perspective(M_PI / 3, 16.0 / 9, 0.1, 400);
+  mat4 view = mat4_lookAt(vec3(-20, 60, -20), vec3(200, 0, 200),
+                          vec3(0, 1, 0));
+  frustum f = frustum_from_mat4(mat4_multiply(proj, view));
+
+  // one glisy_frustum_classify_sphere per object
+  BENCH_ITEMS("frustum_classify_sphere (scalar)", PASSES, COUNT, {
+    n = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+      naive[n] = (uint32_t) i;
+      n += frustum_classify_sphere(f, sphere_soa_get(spheres, i)) != 0;
+    }
+    bench_use(naive);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_spheres", PASSES, COUNT, {
+    glisy_frustum_cull_spheres(NULL, &out, &f, &spheres, 0);
+    bench_use(out.visible);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_spheres (coherent)", PASSES, COUNT, {
+    glisy_frustum_cull_spheres(NULL, &out, &f, &spheres,
+                               GLISY_FRUSTUM_COHERENT);
+    bench_use(out.visible);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_spheres (pool)", PASSES, COUNT, {
+    glisy_frustum_cull_spheres(&pool, &out, &f, &spheres, 0);
+    bench_use(out.visible);
+  });
+  BENCH_ITEMS("frustum_classify_aabb (scalar)", PASSES, COUNT, {
+    n = 0;
+    for (size_t i = 0; i < COUNT; ++i) {
+      naive[n] = (uint32_t) i;
+      n += frustum_classify_aabb(f, aabb_soa_get(boxes, i)) != 0;
+    }
+    bench_use(naive);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_aabbs", PASSES, COUNT, {
+    glisy_frustum_cull_aabbs(NULL, &out, &f, &boxes, 0);
+    bench_use(out.visible);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_aabbs (coherent)", PASSES, COUNT, {
+    glisy_frustum_cull_aabbs(NULL, &out, &f, &boxes,
+                             GLISY_FRUSTUM_COHERENT);
+    bench_use(out.visible);
+  });
+  BENCH_ITEMS("glisy_frustum_cull_aabbs (pool)", PASSES, COUNT, {
+    glisy_frustum_cull_aabbs(&pool, &out, &f, &boxes, 0);
+    bench_use(out.visible);
+  });
+  printf("visible: %zu of %d (scalar %zu)\n", out.visible_count, COUNT, n);
+
+  frustum_cull_free(out);
+  sphere_soa_free(spheres);
+  aabb_soa_free(boxes);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
@@ -0,0 +1,34 @@
+#include <glisy/half.h>
+#include "bench.h"
+
+#define COUNT 4096
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static vec3 in[COUNT], out[COUNT];
+static hvec3 packed[COUNT];
+
+int
+main (void) {
+  for (int i = 0; i < COUNT; ++i) {
+    in[i] = vec3(i * 0.25f, -i * 0.5f, 1.0f / (i + 1));
+  }
+
+  BENCH_ITEMS("hvec3_encode", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) packed[i] = hvec3_encode(in[i]);
+    bench_use(packed);
+  });
+  BENCH_ITEMS("glisy_hvec3_encode_batch", PASSES, COUNT, {
+    glisy_hvec3_encode_batch(packed, in, COUNT);
+    bench_use(packed);
+  });
+  BENCH_ITEMS("hvec3_decode", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) out[i] = hvec3_decode(packed[i]);
+    bench_use(out);
+  });
+  BENCH_ITEMS("glisy_hvec3_decode_batch", PASSES, COUNT, {
+    glisy_hvec3_decode_batch(out, packed, COUNT);
+    bench_use(out);
+  });
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <glisy/hierarchy.h>
+#include "bench.h"
+
+#define COUNT 200000
+#define CHANGED (COUNT / 20)
+#define PASSES 50
+
+static uint32_t touched[CHANGED];
+
+/**
+ * Prints the work counters of the last update of h.
+ */
+
+static void
+report (const char *name, const hierarchy *h) {
+  printf("%-40s %10zu visited %8zu recomputed\n", name,
+         h->counters.visited, h->counters.recomputed);
+}
+
+int
+main (void) {
+  hierarchy h = hierarchy_create();
+  glisy_pool pool;
+  unsigned int seed = 1;
+
+  // a wide scene: 200 roots, every node has up to 8 children
+  for (int i = 0; i < COUNT; ++i) {
+    mat4 local = mat4_create();
+    mat4_rotateY(local, i * 0.001f);
+    local = mat4_translate(local, vec3(1, 0, 0));
+    hierarchy_add(h, i < 200 ? -1 : (i - 200) / 8, local);
+  }
+  hierarchy_update(h);
+
+  // 5% of the nodes move each frame, mostly leaves
+  for (int k = 0; k < CHANGED; ++k) {
+    seed = seed * 1664525u + 1013904223u;
+    touched[k] = (seed >> 8) % COUNT;
+  }
+
+  BENCH_ITEMS("hierarchy_update_all", PASSES, COUNT, {
+    hierarchy_update_all(h);
+    bench_use(h);
+  });
+  report("hierarchy_update_all", &h);
+
+  BENCH_ITEMS("hierarchy_update (5% dirty)", PASSES, COUNT, {
+    for (int k = 0; k < CHANGED; ++k) hierarchy_mark_dirty(h, touched[k]);
+    hierarchy_update(h);
+    bench_use(h);
+  });
+  report("hierarchy_update (5% dirty)", &h);
+
+  glisy_pool_init(&pool, 4, 0);
+  BENCH_ITEMS("hierarchy_update_parallel (5%, 4)", PASSES, COUNT, {
+    for (int k = 0; k < CHANGED; ++k) hierarchy_mark_dirty(h, touched[k]);
+    hierarchy_update_parallel(&pool, h);
+    bench_use(h);
+  });
+  report("hierarchy_update_parallel (5%, 4)", &h);
+
+  BENCH_ITEMS("hierarchy_update (clean)", PASSES, COUNT, {
+    hierarchy_update(h);
+    bench_use(h);
+  });
+
+  glisy_pool_destroy(&pool);
+  hierarchy_free(h);
+  return 0;
+}
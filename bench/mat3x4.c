@@ -0,0 +1,79 @@
+#include <glisy/mat3x4.h>
+#include "bench.h"
+
+#define COUNT 16384
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static mat4 a4[COUNT], b4[COUNT], out4[COUNT];
+static mat3x4 a[COUNT], b[COUNT], out[COUNT];
+static vec3 points[COUNT], moved[COUNT];
+
+int
+main (void) {
+  for (int i = 0; i < COUNT; ++i) {
+    a4[i] = mat4_create();
+    b4[i] = mat4_create();
+    mat4_rotateX(a4[i], i * 0.01f);
+    mat4_rotateY(b4[i], i * 0.02f);
+    a4[i] = mat4_translate(a4[i], vec3(i, 1, 2));
+    b4[i] = mat4_translate(b4[i], vec3(-1, i, 3));
+    points[i] = vec3(i * 0.1f, 1, -i);
+  }
+  glisy_mat3x4_from_mat4_batch(a, a4, COUNT);
+  glisy_mat3x4_from_mat4_batch(b, b4, COUNT);
+
+  printf("%zu bytes per mat3x4, %zu per mat4\n",
+         sizeof(mat3x4), sizeof(mat4));
+
+  BENCH_ITEMS("glisy_mat4_multiply_affine_batch", PASSES, COUNT, {
+    glisy_mat4_multiply_affine_batch(out4, a4, b4, COUNT);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_multiply_batch", PASSES, COUNT, {
+    glisy_mat3x4_multiply_batch(out, a, b, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_invert_affine_batch", PASSES, COUNT, {
+    glisy_mat4_invert_affine_batch(out4, a4, COUNT);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_invert_batch", PASSES, COUNT, {
+    glisy_mat3x4_invert_batch(out, a, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_invert_rigid_batch", PASSES, COUNT, {
+    glisy_mat4_invert_rigid_batch(out4, a4, COUNT);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_invert_rigid_batch", PASSES, COUNT, {
+    glisy_mat3x4_invert_rigid_batch(out, a, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_affine_batch", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_affine_batch(moved, points, COUNT, &a4[7]);
+    bench_use(moved);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_transform_point_batch", PASSES, COUNT, {
+    glisy_mat3x4_transform_point_batch(moved, points, COUNT, &a[7]);
+    bench_use(moved);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_from_mat4_batch", PASSES, COUNT, {
+    glisy_mat3x4_from_mat4_batch(out, a4, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat3x4_to_mat4_batch", PASSES, COUNT, {
+    glisy_mat3x4_to_mat4_batch(out4, a, COUNT);
+    bench_use(out4);
+  });
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "bench.h"
+
+#define COUNT 1024
+
+static mat4 a[COUNT];
+static mat4 b[COUNT];
+static mat4 out[COUNT];
+
+int
+main (void) {
+  for (int i = 0; i < COUNT; ++i) {
+    a[i] = mat4_create();
+    b[i] = mat4_create();
+    mat4_rotateX(a[i], i * 0.01f);
+    mat4_rotateY(b[i], i * 0.02f);
+    a[i] = mat4_translate(a[i], vec3(i, 1, 2));
+  }
+
+  BENCH("mat4_multiply (by value)", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    out[i] = mat4_multiply(a[i], b[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_multiply_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_multiply_into(&out[i], &a[i], &b[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("mat4_multiply nested (by value)", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    out[i] = mat4_multiply(mat4_multiply(a[i], b[i]), a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_multiply_into nested", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_multiply_into(&out[i], &a[i], &b[i]);
+    glisy_mat4_multiply_into(&out[i], &out[i], &a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("mat4_invert (by value)", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    out[i] = mat4_invert(a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_invert_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_invert_into(&out[i], &a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_invert_affine_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_invert_affine_into(&out[i], &a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_invert_rigid_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_invert_rigid_into(&out[i], &a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_multiply_affine_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_multiply_affine_into(&out[i], &a[i], &b[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("mat4_transpose (by value)", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    out[i] = mat4_transpose(a[i]);
+    bench_use(out[i]);
+  });
+
+  BENCH("glisy_mat4_transpose_into", BENCH_ITERATIONS, {
+    int i = bench_i % COUNT;
+    glisy_mat4_transpose_into(&out[i], &a[i]);
+    bench_use(out[i]);
+  });
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <glisy/mat4_block.h>
+#include "bench.h"
+
+#define COUNT 1024
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static mat4 a[COUNT];
+static mat4 b[COUNT];
+static mat4 out[COUNT];
+static mat4_block ablocks[COUNT / GLISY_MAT4_BLOCK_LANES];
+static mat4_block bblocks[COUNT / GLISY_MAT4_BLOCK_LANES];
+static mat4_block oblocks[COUNT / GLISY_MAT4_BLOCK_LANES];
+
+int
+main (void) {
+  size_t blocks = mat4_block_count(COUNT);
+  mat4 vp = mat4_create();
+  mat4_rotateY(vp, 0.5f);
+
+  for (int i = 0; i < COUNT; ++i) {
+    a[i] = mat4_create();
+    b[i] = mat4_create();
+    mat4_rotateX(a[i], i * 0.01f);
+    mat4_rotateY(b[i], i * 0.02f);
+    a[i] = mat4_translate(a[i], vec3(i, 1, 2));
+  }
+
+  glisy_mat4_block_pack(ablocks, a, COUNT);
+  glisy_mat4_block_pack(bblocks, b, COUNT);
+
+  BENCH_ITEMS("glisy_mat4_multiply_into (array x one)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_mat4_multiply_into(&out[i], &a[i], &vp);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_multiply_mat4", PASSES, COUNT, {
+    glisy_mat4_block_multiply_mat4(oblocks, ablocks, &vp, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_multiply_into (one x array)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_mat4_multiply_into(&out[i], &vp, &b[i]);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_multiply_block", PASSES, COUNT, {
+    glisy_mat4_multiply_block(oblocks, &vp, bblocks, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_multiply_into (array x array)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_mat4_multiply_into(&out[i], &a[i], &b[i]);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_multiply", PASSES, COUNT, {
+    glisy_mat4_block_multiply(oblocks, ablocks, bblocks, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_multiply_affine", PASSES, COUNT, {
+    glisy_mat4_block_multiply_affine(oblocks, ablocks, bblocks, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_invert_affine_batch", PASSES, COUNT, {
+    glisy_mat4_invert_affine_batch(out, a, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_invert_affine", PASSES, COUNT, {
+    glisy_mat4_block_invert_affine(oblocks, ablocks, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_invert_rigid", PASSES, COUNT, {
+    glisy_mat4_block_invert_rigid(oblocks, ablocks, blocks);
+    bench_use(oblocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_pack", PASSES, COUNT, {
+    glisy_mat4_block_pack(ablocks, a, COUNT);
+    bench_use(ablocks);
+  });
+
+  BENCH_ITEMS("glisy_mat4_block_unpack", PASSES, COUNT, {
+    glisy_mat4_block_unpack(out, ablocks, COUNT);
+    bench_use(out);
+  });
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <glisy/parallel.h>
+#include "bench.h"
+
+#define COUNT (1 << 20)
+#define PASSES 20
+
+static vec3 points[COUNT], out[COUNT];
+static vec4 points4[COUNT], out4[COUNT];
+static mat4 as[COUNT / 16], bs[COUNT / 16], ms[COUNT / 16];
+
+int
+main (void) {
+  glisy_pool pool;
+  mat4 m = mat4_create();
+  mat4_rotateY(m, 0.5f);
+  m = mat4_translate(m, vec3(1, 2, 3));
+
+  if (glisy_pool_init(&pool, 0, GLISY_POOL_PIN)) return 1;
+  printf("pool threads: %u\n", pool.threads);
+
+  for (int i = 0; i < COUNT; ++i) {
+    points[i] = vec3(i * 0.001f, 1, -i * 0.002f);
+    points4[i] = vec4(i * 0.001f, 1, -i * 0.002f, 1);
+  }
+  for (int i = 0; i < COUNT / 16; ++i) {
+    as[i] = m;
+    bs[i] = mat4_translate(m, vec3(i, 0, 0));
+  }
+
+  vec3_soa soa = vec3_soa_create();
+  vec3_soa normals = vec3_soa_create();
+  glisy_vec3_soa_from_vec3(&soa, points, COUNT);
+
+  BENCH_ITEMS("vec3_transform_mat4_affine_batch", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_affine_batch(out, points, COUNT, &m);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("parallel_vec3_transform_mat4_affine", PASSES, COUNT, {
+    glisy_parallel_vec3_transform_mat4_affine_batch(&pool, out, points,
+                                                    COUNT, &m);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("vec4_transform_mat4_batch", PASSES, COUNT, {
+    glisy_vec4_transform_mat4_batch(out4, points4, COUNT, &m);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("parallel_vec4_transform_mat4", PASSES, COUNT, {
+    glisy_parallel_vec4_transform_mat4_batch(&pool, out4, points4,
+                                             COUNT, &m);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("vec3_soa_normalize", PASSES, COUNT, {
+    glisy_vec3_soa_normalize(&normals, &soa);
+    bench_use(normals);
+  });
+
+  BENCH_ITEMS("parallel_vec3_soa_normalize", PASSES, COUNT, {
+    glisy_parallel_vec3_soa_normalize(&pool, &normals, &soa, 0);
+    bench_use(normals);
+  });
+
+  BENCH_ITEMS("mat4_multiply_affine_batch", PASSES, COUNT / 16, {
+    glisy_mat4_multiply_affine_batch(ms, as, bs, COUNT / 16);
+    bench_use(ms);
+  });
+
+  BENCH_ITEMS("parallel_mat4_multiply_affine", PASSES, COUNT / 16, {
+    glisy_parallel_mat4_multiply_affine_batch(&pool, ms, as, bs,
+                                              COUNT / 16);
+    bench_use(ms);
+  });
+  printf("last loop: %zu chunks, %zu stolen\n", pool.chunks, pool.steals);
+
+  vec3_soa_free(soa);
+  vec3_soa_free(normals);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
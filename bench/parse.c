@@ -0,0 +1,65 @@
+#include <glisy/parse.h>
+#include "bench.h"
+
+#define COUNT 1024
+#define PASSES (BENCH_ITERATIONS / COUNT / 16)
+
+static mat4 ms[COUNT], out[COUNT];
+static char text[COUNT * GLISY_FORMAT_MAX];
+
+/**
+ * The obvious reader: skip to each number and call strtof.
+ */
+
+static size_t
+strtof_parse (const char *s, mat4 *m, size_t capacity) {
+  size_t count = 0;
+  while (count < capacity && (s = strchr(s, '('))) {
+    float *f = &m[count++].m11;
+    for (int e = 0; e < 16; ++e) {
+      char *end;
+      f[e] = strtof(s + 1, &end);
+      s = end;
+    }
+  }
+  return count;
+}
+
+static void
+report (const char *name, size_t bytes, double elapsed) {
+  printf("%-40s %10.2f ns/item %8.1f MB/s\n", name,
+         elapsed * 1e9 / ((double) PASSES * COUNT),
+         (double) bytes * PASSES / elapsed * 1e-6);
+}
+
+int
+main (void) {
+  glisy_writer w = {text, sizeof(text), 0};
+  double start;
+
+  for (int i = 0; i < COUNT; ++i) {
+    ms[i] = mat4_create();
+    mat4_rotateY(ms[i], i * 0.01f);
+    ms[i] = mat4_translate(ms[i], vec3(i, i * 0.5f, -1.25f));
+    w.len += mat4_format(text + w.len, sizeof(text) - w.len, ms[i]);
+    glisy_writer_text(&w, "\n", 1);
+  }
+  glisy_writer_end(&w);
+
+  start = bench_now();
+  for (int pass = 0; pass < PASSES; ++pass) {
+    strtof_parse(text, out, COUNT);
+    bench_use(out);
+  }
+  report("mat4 strtof", w.len, bench_now() - start);
+
+  start = bench_now();
+  for (int pass = 0; pass < PASSES; ++pass) {
+    glisy_parser p = glisy_parser(text, w.len);
+    glisy_parse_mat4_array(&p, out, COUNT);
+    bench_use(out);
+  }
+  report("glisy_parse_mat4_array", w.len, bench_now() - start);
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <glisy/quat_pack.h>
+#include "bench.h"
+
+#define COUNT 4096
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static quat in[COUNT], out[COUNT];
+static quat32 p32[COUNT];
+static quat48 p48[COUNT];
+static quat64 p64[COUNT];
+static hquat ph[COUNT];
+
+/**
+ * Prints the mean and largest rotation error of out against in
+ * next to the codec's bound.
+ */
+
+static void
+accuracy (const char *name, float bound) {
+  double sum = 0;
+  float max = 0;
+  for (int i = 0; i < COUNT; ++i) {
+    float e = glisy_quat_error_degrees(in[i], out[i]);
+    sum += e;
+    max = fmaxf(max, e);
+  }
+  printf("%-40s mean %.2e max %.2e bound %.2e degrees\n",
+         name, sum / COUNT, max, bound);
+}
+
+int
+main (void) {
+  srand(1);
+  for (int i = 0; i < COUNT; ++i) {
+    in[i] = quat_normalize(quat(rand() / (float) RAND_MAX - 0.5f,
+                                rand() / (float) RAND_MAX - 0.5f,
+                                rand() / (float) RAND_MAX - 0.5f,
+                                rand() / (float) RAND_MAX - 0.5f));
+  }
+
+  BENCH_ITEMS("quat32_encode", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) p32[i] = quat32_encode(in[i]);
+    bench_use(p32);
+  });
+  BENCH_ITEMS("glisy_quat32_encode_batch", PASSES, COUNT, {
+    glisy_quat32_encode_batch(p32, in, COUNT);
+    bench_use(p32);
+  });
+  BENCH_ITEMS("quat32_decode", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) out[i] = quat32_decode(p32[i]);
+    bench_use(out);
+  });
+  BENCH_ITEMS("glisy_quat32_decode_batch", PASSES, COUNT, {
+    glisy_quat32_decode_batch(out, p32, COUNT);
+    bench_use(out);
+  });
+  accuracy("quat32 (4 bytes)", glisy_quat32_error_bound());
+
+  BENCH_ITEMS("glisy_quat48_encode_batch", PASSES, COUNT, {
+    glisy_quat48_encode_batch(p48, in, COUNT);
+    bench_use(p48);
+  });
+  BENCH_ITEMS("glisy_quat48_decode_batch", PASSES, COUNT, {
+    glisy_quat48_decode_batch(out, p48, COUNT);
+    bench_use(out);
+  });
+  accuracy("quat48 (6 bytes)", glisy_quat48_error_bound());
+
+  BENCH_ITEMS("glisy_quat64_encode_batch", PASSES, COUNT, {
+    glisy_quat64_encode_batch(p64, in, COUNT);
+    bench_use(p64);
+  });
+  BENCH_ITEMS("glisy_quat64_decode_batch", PASSES, COUNT, {
+    glisy_quat64_decode_batch(out, p64, COUNT);
+    bench_use(out);
+  });
+  accuracy("quat64 (8 bytes)", glisy_quat64_error_bound());
+
+  BENCH_ITEMS("glisy_hquat_encode_batch", PASSES, COUNT, {
+    glisy_hquat_encode_batch(ph, in, COUNT);
+    bench_use(ph);
+  });
+  BENCH_ITEMS("glisy_hquat_decode_batch", PASSES, COUNT, {
+    glisy_hquat_decode_batch(out, ph, COUNT);
+    bench_use(out);
+  });
+  accuracy("hquat (8 bytes)", glisy_hquat_error_bound());
+
+  return 0;
+}
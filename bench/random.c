@@ -0,0 +1,37 @@
+#include <glisy/sample.h>
+#include "bench.h"
+
+#define COUNT 4096
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static vec3 points[COUNT];
+static quat rotations[COUNT];
+
+int
+main (void) {
+  glisy_rng rng;
+  glisy_rng_seed(&rng, 1);
+
+  BENCH_ITEMS("vec3_random", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) points[i] = vec3_random(1);
+    bench_use(points);
+  });
+  BENCH_ITEMS("glisy_sample_sphere", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) points[i] = glisy_sample_sphere(&rng);
+    bench_use(points);
+  });
+  BENCH_ITEMS("glisy_sample_sphere_batch", PASSES, COUNT, {
+    glisy_sample_sphere_batch(&rng, points, COUNT);
+    bench_use(points);
+  });
+  BENCH_ITEMS("glisy_sample_quat", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) rotations[i] = glisy_sample_quat(&rng);
+    bench_use(rotations);
+  });
+  BENCH_ITEMS("glisy_sample_quat_batch", PASSES, COUNT, {
+    glisy_sample_quat_batch(&rng, rotations, COUNT);
+    bench_use(rotations);
+  });
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <glisy/quat_soa.h>
+#include "bench.h"
+
+#define COUNT 16384
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static float angles[COUNT], sines[COUNT], cosines[COUNT];
+static vec3 axes[COUNT];
+static quat quats[COUNT];
+
+/**
+ * Error of a in ulps of the float nearest e.
+ */
+
+static double
+ulps (float a, double e) {
+  int exp;
+  frexpf((float) e, &exp);
+  return fabs(a - e) / ldexp(1.0, exp - 24 < -149 ? -149 : exp - 24);
+}
+
+/**
+ * Sweeps every 97th float in [-range, range] through the scalar and
+ * batch routines and prints the largest error against double sin
+ * and cos.
+ */
+
+static void
+precision (float range) {
+  static float xs[4096], ss[4096], cs[4096];
+  double scalar = 0, batch = 0;
+  uint32_t end;
+  size_t n = 0;
+  memcpy(&end, &range, sizeof(end));
+
+  for (uint64_t b = 0; b < 2ull * end; b += 97) {
+    uint32_t bits = b < end ? (uint32_t) b : (uint32_t) (b - end) | 1u << 31;
+    float s, c;
+    memcpy(&xs[n], &bits, sizeof(float));
+    glisy_sincosf(xs[n], &s, &c);
+    scalar = fmax(scalar, fmax(ulps(s, sin(xs[n])), ulps(c, cos(xs[n]))));
+    if (++n == 4096 || b + 97 >= 2ull * end) {
+      glisy_sincosf_batch(ss, cs, xs, n);
+      for (size_t i = 0; i < n; ++i) {
+        batch = fmax(batch, fmax(ulps(ss[i], sin(xs[i])),
+                                 ulps(cs[i], cos(xs[i]))));
+      }
+      n = 0;
+    }
+  }
+
+  printf("glisy_sincosf |x| <= %-19g %10.2f ulp\n", range, scalar);
+  printf("glisy_sincosf_batch |x| <= %-13g %10.2f ulp\n", range, batch);
+}
+
+int
+main (void) {
+  vec3_soa soa_axes = vec3_soa_create();
+  quat_soa soa_quats = quat_soa_create();
+
+  for (int i = 0; i < COUNT; ++i) {
+    angles[i] = (i - COUNT / 2) * 0.001f;
+    axes[i] = vec3_normalize(vec3(i, 1, -i));
+  }
+  glisy_vec3_soa_from_vec3(&soa_axes, axes, COUNT);
+
+  precision(M_PI);
+  precision(1024);
+  precision(GLISY_SINCOS_RANGE);
+
+  BENCH_ITEMS("sinf, cosf", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      sines[i] = sinf(angles[i]);
+      cosines[i] = cosf(angles[i]);
+    }
+    bench_use(sines);
+    bench_use(cosines);
+  });
+
+  BENCH_ITEMS("glisy_sincosf", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_sincosf(angles[i], &sines[i], &cosines[i]);
+    }
+    bench_use(sines);
+    bench_use(cosines);
+  });
+
+  BENCH_ITEMS("glisy_sincosf_batch", PASSES, COUNT, {
+    glisy_sincosf_batch(sines, cosines, angles, COUNT);
+    bench_use(sines);
+    bench_use(cosines);
+  });
+
+  BENCH_ITEMS("quat_set_axis_angle (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      quat_set_axis_angle(quats[i], axes[i], angles[i]);
+    }
+    bench_use(quats);
+  });
+
+  BENCH_ITEMS("glisy_quat_soa_set_axis_angle", PASSES, COUNT, {
+    glisy_quat_soa_set_axis_angle(&soa_quats, &soa_axes, angles);
+    bench_use(soa_quats);
+  });
+
+  vec3_soa_free(soa_axes);
+  quat_soa_free(soa_quats);
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <glisy/skin.h>
+#include "bench.h"
+
+#define COUNT 65536
+#define BONES 64
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static mat4 world[BONES], inverse_bind[BONES], blend[BONES];
+static mat3x4 palette[BONES];
+static dquat dpalette[BONES];
+static vec3 naive[COUNT], naive_normals[COUNT];
+
+int
+main (void) {
+  glisy_pool pool;
+  skin_weights weights = skin_weights_create();
+  vec3_soa positions = vec3_soa_create(), normals = vec3_soa_create();
+  vec3_soa out = vec3_soa_create(), out_normals = vec3_soa_create();
+  glisy_pool_init(&pool, 0, 0);
+
+  for (int b = 0; b < BONES; ++b) {
+    trs a = trs_create();
+    quat_set_axis_angle(a.rotation, vec3_normalize(vec3(1, b % 5, 2)),
+                        b * 0.1f);
+    a.translation = vec3(b, 0, b * 0.5f);
+    world[b] = trs_to_mat4(a);
+    inverse_bind[b] = mat4_invert(mat4_translate(mat4_create(),
+                                                 vec3(b, 1, 0)));
+  }
+  for (int b = 0; b < BONES; ++b) {
+    blend[b] = mat4_multiply(world[b], inverse_bind[b]);
+  }
+  glisy_skin_palette_mat4(palette, world, inverse_bind, BONES);
+  glisy_skin_dquat_palette_mat4(dpalette, world, inverse_bind, BONES);
+  for (size_t i = 0; i < COUNT; ++i) {
+    vec3_soa_push(positions, vec3(i % 97, i % 31, i % 13));
+    vec3_soa_push(normals, vec3_normalize(vec3(1, i % 3, 1)));
+  }
+
+  for (int influences = 4; influences <= 8; influences += 4) {
+    const char *lbs = 4 == influences ? "glisy_skin_lbs (4)"
+                                      : "glisy_skin_lbs (8)";
+    const char *lbs_pool = 4 == influences ? "glisy_skin_lbs (4, pool)"
+                                           : "glisy_skin_lbs (8, pool)";
+    const char *dqs = 4 == influences ? "glisy_skin_dqs (4)"
+                                      : "glisy_skin_dqs (8)";
+    const char *dqs_pool = 4 == influences ? "glisy_skin_dqs (4, pool)"
+                                           : "glisy_skin_dqs (8, pool)";
+    const char *base = 4 == influences ? "naive mat4 blend (4)"
+                                       : "naive mat4 blend (8)";
+    skin_weights_resize(weights, COUNT, influences);
+    for (size_t i = 0; i < COUNT; ++i) {
+      uint16_t bones[GLISY_SKIN_MAX_INFLUENCES];
+      float w[GLISY_SKIN_MAX_INFLUENCES];
+      for (int k = 0; k < influences; ++k) {
+        bones[k] = (uint16_t) ((i / 64 + k * 3) % BONES);
+        w[k] = 1.0f + k;
+      }
+      skin_weights_set(weights, i, influences, bones, w);
+    }
+
+    // one mat4 blend per vertex, then vec3_transform_mat4 and a
+    // normalized normal
+    BENCH_ITEMS(base, PASSES, COUNT, {
+      for (size_t i = 0; i < COUNT; ++i) {
+        mat4 m = {0};
+        for (int k = 0; k < influences; ++k) {
+          size_t j = k * weights.capacity + i;
+          const float *p = &blend[weights.bones[j]].m11;
+          float s = weights.weights[j];
+          for (int e = 0; e < 16; ++e) (&m.m11)[e] += s * p[e];
+        }
+        vec3 n = vec3_soa_get(normals, i);
+        naive[i] = vec3_transform_mat4(vec3_soa_get(positions, i), m);
+        naive_normals[i] = vec3_normalize(vec3(
+          m.m11 * n.x + m.m21 * n.y + m.m31 * n.z,
+          m.m12 * n.x + m.m22 * n.y + m.m32 * n.z,
+          m.m13 * n.x + m.m23 * n.y + m.m33 * n.z));
+      }
+      bench_use(naive);
+      bench_use(naive_normals);
+    });
+    BENCH_ITEMS(lbs, PASSES, COUNT, {
+      glisy_skin_lbs(NULL, &out, &out_normals, &positions, &normals,
+                     &weights, palette);
+      bench_use(out.x);
+    });
+    BENCH_ITEMS(lbs_pool, PASSES, COUNT, {
+      glisy_skin_lbs(&pool, &out, &out_normals, &positions, &normals,
+                     &weights, palette);
+      bench_use(out.x);
+    });
+    BENCH_ITEMS(dqs, PASSES, COUNT, {
+      glisy_skin_dqs(NULL, &out, &out_normals, &positions, &normals,
+                     &weights, dpalette);
+      bench_use(out.x);
+    });
+    BENCH_ITEMS(dqs_pool, PASSES, COUNT, {
+      glisy_skin_dqs(&pool, &out, &out_normals, &positions, &normals,
+                     &weights, dpalette);
+      bench_use(out.x);
+    });
+  }
+
+  skin_weights_free(weights);
+  vec3_soa_free(positions);
+  vec3_soa_free(normals);
+  vec3_soa_free(out);
+  vec3_soa_free(out_normals);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <glisy/quat_soa.h>
+#include "bench.h"
+
+#define COUNT 4096
+#define PASSES (BENCH_ITERATIONS / COUNT)
+
+static quat a[COUNT];
+static quat b[COUNT];
+static quat out[COUNT];
+
+int
+main (void) {
+  quat_soa poses[4] = {
+    quat_soa_create(), quat_soa_create(), quat_soa_create(), quat_soa_create()
+  };
+  quat_soa so = quat_soa_create();
+  float weights[4] = {0.1f, 0.2f, 0.3f, 0.4f};
+
+  for (int i = 0; i < COUNT; ++i) {
+    a[i] = quat_normalize(quat(i * 0.1f, 1, -i, 2));
+    b[i] = quat_normalize(quat(1, i * 0.3f, 2, -i * 0.5f));
+  }
+  glisy_quat_soa_from_quat(&poses[0], a, COUNT);
+  glisy_quat_soa_from_quat(&poses[1], b, COUNT);
+  glisy_quat_soa_from_quat(&poses[2], b, COUNT);
+  glisy_quat_soa_from_quat(&poses[3], a, COUNT);
+
+  BENCH_ITEMS("glisy_quat_slerp_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_quat_slerp_into(&out[i], &a[i], &b[i], 0.3f);
+    }
+    bench_use(out);
+  });
+  BENCH_ITEMS("glisy_quat_slerp_batch", PASSES, COUNT, {
+    glisy_quat_slerp_batch(out, a, b, 0.3f, COUNT);
+    bench_use(out);
+  });
+  BENCH_ITEMS("glisy_quat_soa_slerp", PASSES, COUNT, {
+    glisy_quat_soa_slerp(&so, &poses[0], &poses[1], 0.3f);
+    bench_use(so);
+  });
+  BENCH_ITEMS("glisy_quat_soa_nlerp", PASSES, COUNT, {
+    glisy_quat_soa_nlerp(&so, &poses[0], &poses[1], 0.3f);
+    bench_use(so);
+  });
+  BENCH_ITEMS("glisy_quat_soa_slerp_fast", PASSES, COUNT, {
+    glisy_quat_soa_slerp_fast(&so, &poses[0], &poses[1], 0.3f);
+    bench_use(so);
+  });
+  BENCH_ITEMS("glisy_quat_soa_blend (4 poses)", PASSES, COUNT, {
+    glisy_quat_soa_blend(&so, poses, weights, 4);
+    bench_use(so);
+  });
+
+  for (int i = 0; i < 4; ++i) quat_soa_free(poses[i]);
+  quat_soa_free(so);
+  return 0;
+}
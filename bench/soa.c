@@ -0,0 +1,73 @@
+#include <glisy/vec3_soa.h>
+#include "bench.h"
+
+#define COUNT 16384
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static vec3 a[COUNT];
+static vec3 b[COUNT];
+static vec3 out[COUNT];
+
+int
+main (void) {
+  vec3_soa sa = vec3_soa_create();
+  vec3_soa sb = vec3_soa_create();
+  vec3_soa so = vec3_soa_create();
+
+  for (int i = 0; i < COUNT; ++i) {
+    a[i] = vec3(i * 0.1f, 1, -i);
+    b[i] = vec3(1, i * 0.3f, 2);
+  }
+
+  BENCH_ITEMS("glisy_vec3_soa_from_vec3", PASSES, COUNT, {
+    glisy_vec3_soa_from_vec3(&sa, a, COUNT);
+    bench_use(sa);
+  });
+  glisy_vec3_soa_from_vec3(&sb, b, COUNT);
+
+  BENCH_ITEMS("glisy_vec3_soa_to_vec3", PASSES, COUNT, {
+    glisy_vec3_soa_to_vec3(out, &sa);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_vec3_cross_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_vec3_cross_into(&out[i], &a[i], &b[i]);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_cross", PASSES, COUNT, {
+    glisy_vec3_soa_cross(&so, &sa, &sb);
+    bench_use(so);
+  });
+
+  BENCH_ITEMS("glisy_vec3_normalize_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_vec3_normalize_into(&out[i], &a[i]);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_normalize", PASSES, COUNT, {
+    glisy_vec3_soa_normalize(&so, &sa);
+    bench_use(so);
+  });
+
+  BENCH_ITEMS("glisy_vec3_lerp_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_vec3_lerp_into(&out[i], &a[i], &b[i], 0.5f);
+    }
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_vec3_soa_lerp", PASSES, COUNT, {
+    glisy_vec3_soa_lerp(&so, &sa, &sb, 0.5f);
+    bench_use(so);
+  });
+
+  vec3_soa_free(sa);
+  vec3_soa_free(sb);
+  vec3_soa_free(so);
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <glisy/track.h>
+#include "bench.h"
+
+#define TRACKS 1024
+#define KEYS 64
+#define FRAMES 64
+#define PASSES (BENCH_ITERATIONS / (TRACKS * FRAMES))
+
+static track tracks[TRACKS];
+static track_cursor cursors[TRACKS];
+static trs out[TRACKS];
+
+int
+main (void) {
+  vec3_soa translation = vec3_soa_create();
+  vec3_soa scale = vec3_soa_create();
+  quat_soa rotation = quat_soa_create();
+
+  for (int i = 0; i < TRACKS; ++i) {
+    for (int k = 0; k < KEYS; ++k) {
+      float time = k * (1.0f / 30);
+      quat q;
+      quat_set_axis_angle(q, vec3_normalize(vec3(1, i % 7, 2)), k * 0.3f);
+      glisy_track_add_translation(&tracks[i], time, vec3(k, i, 0));
+      glisy_track_add_rotation(&tracks[i], time, q);
+      glisy_track_add_scale(&tracks[i], time, vec3(1, 1 + 0.01f * k, 1));
+    }
+  }
+
+  // a fresh cursor per sample binary searches every channel
+  BENCH_ITEMS("glisy_track_sample (search)", PASSES, TRACKS * FRAMES, {
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f * (1.0f / 60);
+      for (int i = 0; i < TRACKS; ++i) {
+        track_cursor c = track_cursor_create();
+        c.translation = c.rotation = c.scale = UINT32_MAX;
+        out[i] = glisy_track_sample(&tracks[i], &c, time);
+      }
+      bench_use(out);
+    }
+  });
+  BENCH_ITEMS("glisy_track_sample (cursor)", PASSES, TRACKS * FRAMES, {
+    memset(cursors, 0, sizeof(cursors));
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f * (1.0f / 60);
+      for (int i = 0; i < TRACKS; ++i) {
+        out[i] = glisy_track_sample(&tracks[i], &cursors[i], time);
+      }
+      bench_use(out);
+    }
+  });
+  BENCH_ITEMS("glisy_track_sample_batch", PASSES, TRACKS * FRAMES, {
+    memset(cursors, 0, sizeof(cursors));
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f * (1.0f / 60);
+      glisy_track_sample_batch(&translation, &rotation, &scale,
+                               tracks, cursors, TRACKS, time);
+      bench_use(rotation.w);
+    }
+  });
+
+  for (int i = 0; i < TRACKS; ++i) track_free(tracks[i]);
+  vec3_soa_free(translation);
+  vec3_soa_free(scale);
+  quat_soa_free(rotation);
+  return 0;
+}
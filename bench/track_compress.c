@@ -0,0 +1,83 @@
+#include <glisy/track_compress.h>
+#include "bench.h"
+
+#define TRACKS 256
+#define FRAMES 240
+#define PASSES 4
+
+static track tracks[TRACKS];
+static track_cursor cursors[TRACKS];
+static trs out[TRACKS];
+
+int
+main (void) {
+  track_tolerance tol = track_tolerance_create();
+  track_clip clip = track_clip_create();
+  glisy_pool pool;
+  vec3_soa translation = vec3_soa_create();
+  vec3_soa scale = vec3_soa_create();
+  quat_soa rotation = quat_soa_create();
+  glisy_pool_init(&pool, 0, 0);
+
+  for (int i = 0; i < TRACKS; ++i) {
+    vec3 axis = vec3_normalize(vec3(1, i % 5, 2));
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f / 60.0f;
+      quat q;
+      quat_set_axis_angle(q, axis, sinf(time * (1 + i % 3)));
+      glisy_track_add_translation(&tracks[i], time,
+                                  vec3(sinf(time), 0.1f * time, i));
+      glisy_track_add_rotation(&tracks[i], time, q);
+      glisy_track_add_scale(&tracks[i], time, vec3(1, 1, 1));
+    }
+  }
+
+  BENCH_ITEMS("glisy_track_compress (1 thread)", PASSES, TRACKS * FRAMES, {
+    glisy_track_compress(NULL, &clip, tracks, TRACKS, &tol);
+    track_clip_free(clip);
+  });
+  BENCH_ITEMS("glisy_track_compress (pool)", PASSES, TRACKS * FRAMES, {
+    glisy_track_compress(&pool, &clip, tracks, TRACKS, &tol);
+    track_clip_free(clip);
+  });
+  glisy_track_compress(&pool, &clip, tracks, TRACKS, &tol);
+  printf("%zu keys as %zu bytes\n", (size_t) TRACKS * FRAMES, clip.size);
+
+  // between keys, so every sample interpolates
+  BENCH_ITEMS("glisy_track_sample", 64, TRACKS * FRAMES, {
+    memset(cursors, 0, sizeof(cursors));
+    for (int f = 0; f < FRAMES; ++f) {
+      for (int i = 0; i < TRACKS; ++i) {
+        out[i] = glisy_track_sample(&tracks[i], &cursors[i],
+                                    (f + 0.5f) / 60.0f);
+      }
+      bench_use(out);
+    }
+  });
+  BENCH_ITEMS("glisy_track_clip_sample", 64, TRACKS * FRAMES, {
+    memset(cursors, 0, sizeof(cursors));
+    for (int f = 0; f < FRAMES; ++f) {
+      for (int i = 0; i < TRACKS; ++i) {
+        out[i] = glisy_track_clip_sample(&clip, i, &cursors[i],
+                                         (f + 0.5f) / 60.0f);
+      }
+      bench_use(out);
+    }
+  });
+  BENCH_ITEMS("glisy_track_clip_sample_batch", 64, TRACKS * FRAMES, {
+    memset(cursors, 0, sizeof(cursors));
+    for (int f = 0; f < FRAMES; ++f) {
+      glisy_track_clip_sample_batch(&translation, &rotation, &scale,
+                                    &clip, cursors, (f + 0.5f) / 60.0f);
+      bench_use(rotation.w);
+    }
+  });
+
+  track_clip_free(clip);
+  for (int i = 0; i < TRACKS; ++i) track_free(tracks[i]);
+  vec3_soa_free(translation);
+  vec3_soa_free(scale);
+  quat_soa_free(rotation);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
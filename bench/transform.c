@@ -0,0 +1,77 @@
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include "bench.h"
+
+#define COUNT 65536
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static vec3 points[COUNT];
+static vec3 out3[COUNT];
+static vec4 points4[COUNT];
+static vec4 out4[COUNT];
+static float xs[COUNT], ys[COUNT], zs[COUNT];
+static float ox[COUNT], oy[COUNT], oz[COUNT], ow[COUNT];
+
+int
+main (void) {
+  mat4 model = mat4_create();
+  mat4_rotateY(model, 0.5f);
+  model = mat4_translate(model, vec3(1, 2, 3));
+  mat4 mvp = mat4_multiply(model, mat4_perspective(1.0, 1.5, 0.1, 100));
+
+  for (int i = 0; i < COUNT; ++i) {
+    points[i] = vec3(i * 0.001f, 1, -i * 0.002f);
+    points4[i] = vec4(points[i].x, points[i].y, points[i].z, 1);
+    xs[i] = points[i].x;
+    ys[i] = points[i].y;
+    zs[i] = points[i].z;
+  }
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_vec3_transform_mat4_into(&out3[i], &points[i], &mvp);
+    }
+    bench_use(out3);
+  });
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_batch", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_batch(out3, points, COUNT, &mvp);
+    bench_use(out3);
+  });
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_affine_batch", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_affine_batch(out3, points, COUNT, &model);
+    bench_use(out3);
+  });
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_streams", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_streams(ox, oy, oz, xs, ys, zs, COUNT, &mvp);
+    bench_use(ox);
+  });
+
+  BENCH_ITEMS("glisy_vec3_transform_mat4_affine_streams", PASSES, COUNT, {
+    glisy_vec3_transform_mat4_affine_streams(ox, oy, oz, xs, ys, zs,
+                                             COUNT, &model);
+    bench_use(ox);
+  });
+
+  BENCH_ITEMS("glisy_vec4_transform_mat4_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_vec4_transform_mat4_into(&out4[i], &points4[i], &mvp);
+    }
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("glisy_vec4_transform_mat4_batch", PASSES, COUNT, {
+    glisy_vec4_transform_mat4_batch(out4, points4, COUNT, &mvp);
+    bench_use(out4);
+  });
+
+  BENCH_ITEMS("glisy_vec4_transform_mat4_streams", PASSES, COUNT, {
+    glisy_vec4_transform_mat4_streams(ox, oy, oz, ow, xs, ys, zs, 0,
+                                      COUNT, &mvp);
+    bench_use(ox);
+  });
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <glisy/trs.h>
+#include "bench.h"
+
+#define COUNT 16384
+#define PASSES (BENCH_ITERATIONS / COUNT * 16)
+
+static trs ts[COUNT], us[COUNT], out[COUNT];
+static mat4 m4[COUNT];
+static mat3x4 m34[COUNT];
+
+int
+main (void) {
+  for (int i = 0; i < COUNT; ++i) {
+    quat_set_axis_angle(ts[i].rotation,
+                        vec3_normalize(vec3(i, 1, -i)), i * 0.001f);
+    ts[i].translation = vec3(i, 1, 2);
+    ts[i].scale = vec3(1, 1 + i * 0.001f, 2);
+    us[i] = ts[i];
+    us[i].scale = vec3(2, 2, 2);
+  }
+  glisy_trs_to_mat4_batch(m4, ts, COUNT);
+
+  BENCH_ITEMS("mat4_from_quat, translation, mat4_scale", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) {
+      glisy_mat4_from_quat_into(&m4[i], &ts[i].rotation);
+      m4[i].m41 = ts[i].translation.x;
+      m4[i].m42 = ts[i].translation.y;
+      m4[i].m43 = ts[i].translation.z;
+      glisy_mat4_scale_into(&m4[i], &m4[i], &ts[i].scale);
+    }
+    bench_use(m4);
+  });
+
+  BENCH_ITEMS("glisy_trs_to_mat4_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) glisy_trs_to_mat4_into(&m4[i], &ts[i]);
+    bench_use(m4);
+  });
+
+  BENCH_ITEMS("glisy_trs_to_mat4_batch", PASSES, COUNT, {
+    glisy_trs_to_mat4_batch(m4, ts, COUNT);
+    bench_use(m4);
+  });
+
+  BENCH_ITEMS("glisy_trs_to_mat3x4_batch", PASSES, COUNT, {
+    glisy_trs_to_mat3x4_batch(m34, ts, COUNT);
+    bench_use(m34);
+  });
+
+  BENCH_ITEMS("glisy_trs_from_mat4_batch", PASSES, COUNT, {
+    glisy_trs_from_mat4_batch(out, m4, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("glisy_trs_multiply_batch", PASSES, COUNT, {
+    glisy_trs_multiply_batch(out, us, ts, COUNT);
+    bench_use(out);
+  });
+
+  BENCH_ITEMS("mat4_multiply_affine (same pairs)", PASSES, COUNT, {
+    glisy_mat4_multiply_affine_batch(m4, m4, m4, COUNT);
+    bench_use(m4);
+  });
+
+  BENCH_ITEMS("glisy_trs_invert_into (loop)", PASSES, COUNT, {
+    for (int i = 0; i < COUNT; ++i) glisy_trs_invert_into(&out[i], &ts[i]);
+    bench_use(out);
+  });
+
+  return 0;
+}
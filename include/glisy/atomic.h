@@ -0,0 +1,28 @@
+#ifndef GLISY_ATOMIC_H
+#define GLISY_ATOMIC_H
+
+/**
+ * The C11 atomics used by the threaded headers. C builds take them
+ * from <stdatomic.h>; C++ builds get the same names from
+ * std::atomic, so those headers compile unchanged as either.
+ */
+
+#ifdef __cplusplus
+#include <atomic>
+
+using std::atomic_int;
+using std::atomic_size_t;
+using std::atomic_init;
+using std::atomic_load;
+using std::atomic_load_explicit;
+using std::atomic_store_explicit;
+using std::atomic_fetch_add_explicit;
+using std::atomic_compare_exchange_weak_explicit;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+#else
+#include <stdatomic.h>
+#endif
+
+#endif
@@ -0,0 +1,455 @@
+#ifndef GLISY_BOUNDS_H
+#define GLISY_BOUNDS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/vec3.h>
+#include <glisy/mat4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * plane struct type. The points p with dot(normal, p) + distance
+ * equal to zero. Points with a positive signed distance are in
+ * front of the plane.
+ */
+
+typedef struct plane plane;
+struct plane {
+  vec3 normal;
+  float distance;
+};
+
+/**
+ * sphere struct type. A bounding sphere.
+ */
+
+typedef struct sphere sphere;
+struct sphere {
+  vec3 center;
+  float radius;
+};
+
+/**
+ * aabb struct type. An axis aligned bounding box from min to max.
+ */
+
+typedef struct aabb aabb;
+struct aabb {
+  vec3 min;
+  vec3 max;
+};
+
+/**
+ * Bounds initializers.
+ */
+
+#define plane(...) ((plane){ __VA_ARGS__ })
+
+#define sphere(...) ((sphere){ __VA_ARGS__ })
+
+#define aabb(...) ((aabb){ __VA_ARGS__ })
+
+/**
+ * Scales plane a so its normal has unit length, which makes
+ * plane_distance a true distance. A zero normal yields a zero plane.
+ */
+
+static inline void
+glisy_plane_normalize_into (plane *out, const plane *a) {
+  vec3 n = a->normal;
+  float len = n.x * n.x + n.y * n.y + n.z * n.z;
+  float inv = len > 0 ? 1 / sqrtf(len) : 0;
+  *out = (plane) {{n.x * inv, n.y * inv, n.z * inv}, a->distance * inv};
+}
+
+static inline plane
+glisy_plane_normalize (plane a) {
+  plane out;
+  glisy_plane_normalize_into(&out, &a);
+  return out;
+}
+
+#define plane_normalize(a) glisy_plane_normalize((a))
+
+/**
+ * Returns the signed distance of point v from plane a, scaled by
+ * the length of a's normal.
+ */
+
+static inline float
+glisy_plane_distance (plane a, vec3 v) {
+  return a.normal.x * v.x + a.normal.y * v.y + a.normal.z * v.z +
+         a.distance;
+}
+
+#define plane_distance(a, v) glisy_plane_distance((a), (v))
+
+/**
+ * Returns the center and the half size of aabb a.
+ */
+
+static inline vec3
+glisy_aabb_center (aabb a) {
+  return (vec3) {0.5f * (a.min.x + a.max.x), 0.5f * (a.min.y + a.max.y),
+                 0.5f * (a.min.z + a.max.z)};
+}
+
+#define aabb_center(a) glisy_aabb_center((a))
+
+static inline vec3
+glisy_aabb_extents (aabb a) {
+  return (vec3) {0.5f * (a.max.x - a.min.x), 0.5f * (a.max.y - a.min.y),
+                 0.5f * (a.max.z - a.min.z)};
+}
+
+#define aabb_extents(a) glisy_aabb_extents((a))
+
+/**
+ * Returns the aabb of aabb a transformed by affine mat4 b. The
+ * center is transformed and the extents are scaled by the absolute
+ * value of b's rotation and scale.
+ */
+
+static inline void
+glisy_aabb_transform_mat4_into (aabb *out, const aabb *a, const mat4 *b) {
+  vec3 c = glisy_aabb_center(*a), e = glisy_aabb_extents(*a);
+  vec3 tc = {b->m11 * c.x + b->m21 * c.y + b->m31 * c.z + b->m41,
+             b->m12 * c.x + b->m22 * c.y + b->m32 * c.z + b->m42,
+             b->m13 * c.x + b->m23 * c.y + b->m33 * c.z + b->m43};
+  vec3 te = {fabsf(b->m11) * e.x + fabsf(b->m21) * e.y + fabsf(b->m31) * e.z,
+             fabsf(b->m12) * e.x + fabsf(b->m22) * e.y + fabsf(b->m32) * e.z,
+             fabsf(b->m13) * e.x + fabsf(b->m23) * e.y + fabsf(b->m33) * e.z};
+  *out = (aabb) {{tc.x - te.x, tc.y - te.y, tc.z - te.z},
+                 {tc.x + te.x, tc.y + te.y, tc.z + te.z}};
+}
+
+static inline aabb
+glisy_aabb_transform_mat4 (aabb a, mat4 b) {
+  aabb out;
+  glisy_aabb_transform_mat4_into(&out, &a, &b);
+  return out;
+}
+
+#define aabb_transform_mat4(a, b) glisy_aabb_transform_mat4((a), (b))
+
+/**
+ * Write string representations of bounds to buf of size bytes, NUL
+ * terminated, and return their full length like snprintf.
+ */
+
+static inline size_t
+glisy_plane_format (char *buf, size_t size, plane a) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_text(&w, "plane(", 6);
+  glisy_writer_floats(&w, "normal=", &a.normal.x, 3, 3);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "distance=", &a.distance, 1, 1);
+  glisy_writer_text(&w, ")", 1);
+  return glisy_writer_end(&w);
+}
+
+#define plane_format(buf, size, a) glisy_plane_format((buf), (size), (a))
+
+static inline size_t
+glisy_sphere_format (char *buf, size_t size, sphere a) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_text(&w, "sphere(", 7);
+  glisy_writer_floats(&w, "center=", &a.center.x, 3, 3);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "radius=", &a.radius, 1, 1);
+  glisy_writer_text(&w, ")", 1);
+  return glisy_writer_end(&w);
+}
+
+#define sphere_format(buf, size, a) glisy_sphere_format((buf), (size), (a))
+
+static inline size_t
+glisy_aabb_format (char *buf, size_t size, aabb a) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_text(&w, "aabb(", 5);
+  glisy_writer_floats(&w, "min=", &a.min.x, 3, 3);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "max=", &a.max.x, 3, 3);
+  glisy_writer_text(&w, ")", 1);
+  return glisy_writer_end(&w);
+}
+
+#define aabb_format(buf, size, a) glisy_aabb_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(plane)
+GLISY_ARENA_FORMAT(sphere)
+GLISY_ARENA_FORMAT(aabb)
+
+/**
+ * sphere_soa struct type. A growable array of spheres stored as
+ * separate x, y, z and radius float arrays sharing one allocation,
+ * with the same alignment and zero padding guarantees as vec3_soa.
+ */
+
+typedef struct sphere_soa sphere_soa;
+struct sphere_soa {
+  float *x;
+  float *y;
+  float *z;
+  float *radius;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * sphere_soa initializer.
+ */
+
+#define sphere_soa_create() ((sphere_soa) {0})
+
+/**
+ * Releases the storage of sphere_soa s and empties it.
+ */
+
+static inline void
+glisy_sphere_soa_free (sphere_soa *s) {
+  free(s->x);
+  *s = (sphere_soa) {0};
+}
+
+#define sphere_soa_free(s) glisy_sphere_soa_free(&(s))
+
+/**
+ * Grows sphere_soa s to hold at least capacity elements. Returns 0
+ * on success and -1 when allocation fails, leaving s unchanged.
+ */
+
+static inline int
+glisy_sphere_soa_reserve (sphere_soa *s, size_t capacity) {
+  if (capacity <= s->capacity) return 0;
+  if (capacity < 2 * s->capacity) capacity = 2 * s->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  float *data = (float *) glisy_simd_alloc(4 * capacity * sizeof(float));
+  float *old[4] = {s->x, s->y, s->z, s->radius};
+  if (!data) return -1;
+  memset(data, 0, 4 * capacity * sizeof(float));
+  for (int k = 0; k < 4 && s->count; ++k) {
+    memcpy(data + k * capacity, old[k], s->count * sizeof(float));
+  }
+  free(s->x);
+  s->x = data;
+  s->y = data + capacity;
+  s->z = data + 2 * capacity;
+  s->radius = data + 3 * capacity;
+  s->capacity = capacity;
+  return 0;
+}
+
+#define sphere_soa_reserve(s, capacity) \
+  glisy_sphere_soa_reserve(&(s), (capacity))
+
+/**
+ * Sets the number of elements of sphere_soa s. New elements are
+ * zero. Returns 0 on success and -1 when allocation fails.
+ */
+
+static inline int
+glisy_sphere_soa_resize (sphere_soa *s, size_t count) {
+  if (glisy_sphere_soa_reserve(s, count)) return -1;
+  if (count < s->count) {
+    size_t n = (s->count - count) * sizeof(float);
+    memset(s->x + count, 0, n);
+    memset(s->y + count, 0, n);
+    memset(s->z + count, 0, n);
+    memset(s->radius + count, 0, n);
+  }
+  s->count = count;
+  return 0;
+}
+
+#define sphere_soa_resize(s, count) glisy_sphere_soa_resize(&(s), (count))
+
+/**
+ * Returns element i of sphere_soa s.
+ */
+
+static inline sphere
+glisy_sphere_soa_get (const sphere_soa *s, size_t i) {
+  return (sphere) {{s->x[i], s->y[i], s->z[i]}, s->radius[i]};
+}
+
+#define sphere_soa_get(s, i) glisy_sphere_soa_get(&(s), (i))
+
+/**
+ * Sets element i of sphere_soa s to sphere a.
+ */
+
+static inline void
+glisy_sphere_soa_set (sphere_soa *s, size_t i, sphere a) {
+  s->x[i] = a.center.x;
+  s->y[i] = a.center.y;
+  s->z[i] = a.center.z;
+  s->radius[i] = a.radius;
+}
+
+#define sphere_soa_set(s, i, a) glisy_sphere_soa_set(&(s), (i), (a))
+
+/**
+ * Appends sphere a to sphere_soa s. Returns 0 on success and -1
+ * when allocation fails.
+ */
+
+static inline int
+glisy_sphere_soa_push (sphere_soa *s, sphere a) {
+  if (glisy_sphere_soa_reserve(s, s->count + 1)) return -1;
+  s->x[s->count] = a.center.x;
+  s->y[s->count] = a.center.y;
+  s->z[s->count] = a.center.z;
+  s->radius[s->count] = a.radius;
+  s->count++;
+  return 0;
+}
+
+#define sphere_soa_push(s, a) glisy_sphere_soa_push(&(s), (a))
+
+/**
+ * aabb_soa struct type. A growable array of aabbs stored as six
+ * float arrays for the min and max corners sharing one allocation,
+ * with the same alignment and zero padding guarantees as vec3_soa.
+ */
+
+typedef struct aabb_soa aabb_soa;
+struct aabb_soa {
+  float *min_x;
+  float *min_y;
+  float *min_z;
+  float *max_x;
+  float *max_y;
+  float *max_z;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * aabb_soa initializer.
+ */
+
+#define aabb_soa_create() ((aabb_soa) {0})
+
+/**
+ * Releases the storage of aabb_soa s and empties it.
+ */
+
+static inline void
+glisy_aabb_soa_free (aabb_soa *s) {
+  free(s->min_x);
+  *s = (aabb_soa) {0};
+}
+
+#define aabb_soa_free(s) glisy_aabb_soa_free(&(s))
+
+/**
+ * Grows aabb_soa s to hold at least capacity elements. Returns 0
+ * on success and -1 when allocation fails, leaving s unchanged.
+ */
+
+static inline int
+glisy_aabb_soa_reserve (aabb_soa *s, size_t capacity) {
+  if (capacity <= s->capacity) return 0;
+  if (capacity < 2 * s->capacity) capacity = 2 * s->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  float *data = (float *) glisy_simd_alloc(6 * capacity * sizeof(float));
+  float *old[6] = {s->min_x, s->min_y, s->min_z,
+                   s->max_x, s->max_y, s->max_z};
+  if (!data) return -1;
+  memset(data, 0, 6 * capacity * sizeof(float));
+  for (int k = 0; k < 6 && s->count; ++k) {
+    memcpy(data + k * capacity, old[k], s->count * sizeof(float));
+  }
+  free(s->min_x);
+  s->min_x = data;
+  s->min_y = data + capacity;
+  s->min_z = data + 2 * capacity;
+  s->max_x = data + 3 * capacity;
+  s->max_y = data + 4 * capacity;
+  s->max_z = data + 5 * capacity;
+  s->capacity = capacity;
+  return 0;
+}
+
+#define aabb_soa_reserve(s, capacity) glisy_aabb_soa_reserve(&(s), (capacity))
+
+/**
+ * Sets the number of elements of aabb_soa s. New elements are
+ * zero. Returns 0 on success and -1 when allocation fails.
+ */
+
+static inline int
+glisy_aabb_soa_resize (aabb_soa *s, size_t count) {
+  if (glisy_aabb_soa_reserve(s, count)) return -1;
+  if (count < s->count) {
+    size_t n = (s->count - count) * sizeof(float);
+    memset(s->min_x + count, 0, n);
+    memset(s->min_y + count, 0, n);
+    memset(s->min_z + count, 0, n);
+    memset(s->max_x + count, 0, n);
+    memset(s->max_y + count, 0, n);
+    memset(s->max_z + count, 0, n);
+  }
+  s->count = count;
+  return 0;
+}
+
+#define aabb_soa_resize(s, count) glisy_aabb_soa_resize(&(s), (count))
+
+/**
+ * Returns element i of aabb_soa s.
+ */
+
+static inline aabb
+glisy_aabb_soa_get (const aabb_soa *s, size_t i) {
+  return (aabb) {{s->min_x[i], s->min_y[i], s->min_z[i]},
+                 {s->max_x[i], s->max_y[i], s->max_z[i]}};
+}
+
+#define aabb_soa_get(s, i) glisy_aabb_soa_get(&(s), (i))
+
+/**
+ * Sets element i of aabb_soa s to aabb a.
+ */
+
+static inline void
+glisy_aabb_soa_set (aabb_soa *s, size_t i, aabb a) {
+  s->min_x[i] = a.min.x;
+  s->min_y[i] = a.min.y;
+  s->min_z[i] = a.min.z;
+  s->max_x[i] = a.max.x;
+  s->max_y[i] = a.max.y;
+  s->max_z[i] = a.max.z;
+}
+
+#define aabb_soa_set(s, i, a) glisy_aabb_soa_set(&(s), (i), (a))
+
+/**
+ * Appends aabb a to aabb_soa s. Returns 0 on success and -1 when
+ * allocation fails.
+ */
+
+static inline int
+glisy_aabb_soa_push (aabb_soa *s, aabb a) {
+  if (glisy_aabb_soa_reserve(s, s->count + 1)) return -1;
+  glisy_aabb_soa_set(s, s->count, a);
+  s->count++;
+  return 0;
+}
+
+#define aabb_soa_push(s, a) glisy_aabb_soa_push(&(s), (a))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,975 @@
+#ifndef GLISY_DISPATCH_H
+#define GLISY_DISPATCH_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/mat4.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+
+#ifndef GLISY_NO_THREADS
+#include <pthread.h>
+#include <glisy/atomic.h>
+#endif
+
+/**
+ * Runtime kernel selection. The other headers pick their kernels
+ * at compile time from the build flags. This header also compiles
+ * AVX2 and AVX-512 variants of the hot batch kernels with function
+ * target attributes. At startup it picks one variant per operation
+ * for the CPU it runs on, so one binary built for x86-64 still uses
+ * the widest unit the machine has.
+ */
+
+#if defined(GLISY_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define GLISY_DISPATCH_X86 1
+#include <immintrin.h>
+#define GLISY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Instruction set levels, in increasing order. GLISY_ISA_SSE2
+ * variants are the header kernels as the build compiled them.
+ * GLISY_ISA_AVX2 needs AVX2 and FMA; GLISY_ISA_AVX512 needs
+ * AVX-512F as well.
+ */
+
+#define GLISY_ISA_SCALAR 0
+#define GLISY_ISA_SSE2 1
+#define GLISY_ISA_AVX2 2
+#define GLISY_ISA_AVX512 3
+#define GLISY_ISA_COUNT 4
+
+/**
+ * glisy_dispatch_init flags. GLISY_DISPATCH_TUNE times every
+ * variant the CPU supports on a small batch and keeps the fastest
+ * for each operation, instead of the widest.
+ */
+
+#define GLISY_DISPATCH_TUNE 1
+
+/**
+ * Operations with a slot in the kernel table.
+ */
+
+#define GLISY_KERNEL_MAT4_MULTIPLY 0
+#define GLISY_KERNEL_VEC3_TRANSFORM 1
+#define GLISY_KERNEL_VEC4_TRANSFORM 2
+#define GLISY_KERNEL_VEC3_NORMALIZE 3
+#define GLISY_KERNEL_QUAT_SLERP 4
+#define GLISY_KERNEL_COUNT 5
+
+typedef void (*glisy_mat4_multiply_batch_fn) (mat4 *out,
+                                              const mat4 *a,
+                                              const mat4 *b,
+                                              size_t count);
+typedef void (*glisy_vec3_transform_batch_fn) (vec3 *out,
+                                               const vec3 *in,
+                                               size_t count,
+                                               const mat4 *mat,
+                                               int projective);
+typedef void (*glisy_vec4_transform_batch_fn) (vec4 *out,
+                                               const vec4 *in,
+                                               size_t count,
+                                               const mat4 *mat);
+typedef void (*glisy_vec3_soa_normalize_fn) (vec3_soa *out,
+                                             const vec3_soa *a);
+typedef void (*glisy_quat_slerp_batch_fn) (quat *out,
+                                           const quat *a,
+                                           const quat *b,
+                                           float t,
+                                           size_t count);
+
+/**
+ * glisy_kernels struct type. One function pointer per operation,
+ * and in isa the level each pointer was taken from. cpu is the
+ * level the CPU supports and cap the level selection was limited
+ * to, lower than cpu when GLISY_ISA is set.
+ */
+
+typedef struct glisy_kernels glisy_kernels;
+struct glisy_kernels {
+  glisy_mat4_multiply_batch_fn mat4_multiply_batch;
+  glisy_vec3_transform_batch_fn vec3_transform_mat4_batch;
+  glisy_vec4_transform_batch_fn vec4_transform_mat4_batch;
+  glisy_vec3_soa_normalize_fn vec3_soa_normalize;
+  glisy_quat_slerp_batch_fn quat_slerp_batch;
+  int isa[GLISY_KERNEL_COUNT];
+  int cpu;
+  int cap;
+};
+
+/**
+ * Returns the name of ISA level isa, as accepted by GLISY_ISA.
+ */
+
+static inline const char *
+glisy_isa_name (int isa) {
+  static const char *names[GLISY_ISA_COUNT] = {
+    "scalar", "sse2", "avx2", "avx512"
+  };
+  return isa >= 0 && isa < GLISY_ISA_COUNT ? names[isa] : "unknown";
+}
+
+/**
+ * Returns the highest ISA level the CPU and OS support and this
+ * build can use.
+ */
+
+static inline int
+glisy_cpu_isa (void) {
+#ifdef GLISY_DISPATCH_X86
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) {
+    return GLISY_ISA_SSE2;
+  }
+  if (!__builtin_cpu_supports("avx512f")) return GLISY_ISA_AVX2;
+  return GLISY_ISA_AVX512;
+#else
+  return GLISY_ISA_SCALAR;
+#endif
+}
+
+/**
+ * Scalar and compiled variants.
+ */
+
+static inline void
+glisy_mat4_multiply_batch_scalar (mat4 *out,
+                                  const mat4 *a,
+                                  const mat4 *b,
+                                  size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat4_multiply_scalar(&out[i], &a[i], &b[i]);
+  }
+}
+
+static inline void
+glisy_vec3_soa_normalize_scalar (vec3_soa *out, const vec3_soa *a) {
+  for (size_t i = 0; i < a->count; ++i) {
+    vec3 v = glisy_vec3_soa_get(a, i);
+    glisy_vec3_normalize_into(&v, &v);
+    glisy_vec3_soa_set(out, i, v);
+  }
+}
+
+static inline void
+glisy_quat_slerp_batch_scalar (quat *out,
+                               const quat *a,
+                               const quat *b,
+                               float t,
+                               size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_quat_slerp_into(&out[i], &a[i], &b[i], t);
+  }
+}
+
+#ifdef GLISY_DISPATCH_X86
+static inline void
+glisy_mat4_multiply_batch_sse (mat4 *out,
+                               const mat4 *a,
+                               const mat4 *b,
+                               size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat4_multiply_sse(&out[i], &a[i], &b[i]);
+  }
+}
+
+static inline void
+glisy_vec3_soa_normalize_sse (vec3_soa *out, const vec3_soa *a) {
+  glisy_vec3_soa_normalize_kernel(out, a, 0);
+}
+
+/**
+ * AVX2 and FMA variants. Results may differ from the scalar ones
+ * by the rounding of the fused multiply-adds.
+ */
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_mat4_multiply_batch_avx2 (mat4 *out,
+                                const mat4 *a,
+                                const mat4 *b,
+                                size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    __m256 a0 = _mm256_broadcast_ps((const __m128 *) &a[i].m11);
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *) &a[i].m21);
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *) &a[i].m31);
+    __m256 a3 = _mm256_broadcast_ps((const __m128 *) &a[i].m41);
+    __m256 b01 = _mm256_loadu_ps(&b[i].m11);
+    __m256 b23 = _mm256_loadu_ps(&b[i].m31);
+    __m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+    __m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+    r01 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b01, b01, 0x55), r01);
+    r23 = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b23, b23, 0x55), r23);
+    r01 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b01, b01, 0xaa), r01);
+    r23 = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b23, b23, 0xaa), r23);
+    r01 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b01, b01, 0xff), r01);
+    r23 = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b23, b23, 0xff), r23);
+    _mm256_storeu_ps(&out[i].m11, r01);
+    _mm256_storeu_ps(&out[i].m31, r23);
+  }
+}
+
+/**
+ * Transforms eight vec3s at a time. The 24 floats are loaded as
+ * three vectors and split into x, y and z with two blends and a
+ * permute each, then put back the same way.
+ */
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_vec3_transform_mat4_batch_avx2 (vec3 *out,
+                                      const vec3 *in,
+                                      size_t count,
+                                      const mat4 *mat,
+                                      int projective) {
+  const float *m = &mat->m11;
+  const __m256i gx = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+  const __m256i gy = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+  const __m256i gz = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+  const __m256i sy = _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2);
+  __m256 c[16];
+  size_t i = 0;
+  for (int e = 0; e < 16; ++e) c[e] = _mm256_set1_ps(m[e]);
+  for (; i + 8 <= count; i += 8) {
+    const float *p = &in[i].x;
+    __m256 v0 = _mm256_loadu_ps(p);
+    __m256 v1 = _mm256_loadu_ps(p + 8);
+    __m256 v2 = _mm256_loadu_ps(p + 16);
+    __m256 x = _mm256_blend_ps(_mm256_blend_ps(v0, v1, 0x92), v2, 0x24);
+    __m256 y = _mm256_blend_ps(_mm256_blend_ps(v0, v1, 0x24), v2, 0x49);
+    __m256 z = _mm256_blend_ps(_mm256_blend_ps(v0, v1, 0x49), v2, 0x92);
+    x = _mm256_permutevar8x32_ps(x, gx);
+    y = _mm256_permutevar8x32_ps(y, gy);
+    z = _mm256_permutevar8x32_ps(z, gz);
+
+    __m256 ox = _mm256_fmadd_ps(c[8], z, _mm256_fmadd_ps(c[4], y,
+                _mm256_fmadd_ps(c[0], x, c[12])));
+    __m256 oy = _mm256_fmadd_ps(c[9], z, _mm256_fmadd_ps(c[5], y,
+                _mm256_fmadd_ps(c[1], x, c[13])));
+    __m256 oz = _mm256_fmadd_ps(c[10], z, _mm256_fmadd_ps(c[6], y,
+                _mm256_fmadd_ps(c[2], x, c[14])));
+    if (projective) {
+      __m256 one = _mm256_set1_ps(1.0f);
+      __m256 w = _mm256_fmadd_ps(c[11], z, _mm256_fmadd_ps(c[7], y,
+                 _mm256_fmadd_ps(c[3], x, c[15])));
+      w = _mm256_blendv_ps(w, one,
+                           _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_EQ_OQ));
+      w = _mm256_div_ps(one, w);
+      ox = _mm256_mul_ps(ox, w);
+      oy = _mm256_mul_ps(oy, w);
+      oz = _mm256_mul_ps(oz, w);
+    }
+
+    ox = _mm256_permutevar8x32_ps(ox, gx);
+    oy = _mm256_permutevar8x32_ps(oy, sy);
+    oz = _mm256_permutevar8x32_ps(oz, gz);
+    float *q = &out[i].x;
+    _mm256_storeu_ps(q, _mm256_blend_ps(_mm256_blend_ps(ox, oy, 0x92),
+                                        oz, 0x24));
+    _mm256_storeu_ps(q + 8, _mm256_blend_ps(_mm256_blend_ps(ox, oy, 0x24),
+                                            oz, 0x49));
+    _mm256_storeu_ps(q + 16, _mm256_blend_ps(_mm256_blend_ps(ox, oy, 0x49),
+                                             oz, 0x92));
+  }
+  glisy_vec3_transform_mat4_batch_scalar(out + i, in + i, count - i,
+                                         mat, projective);
+}
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_vec4_transform_mat4_batch_avx2 (vec4 *out,
+                                      const vec4 *in,
+                                      size_t count,
+                                      const mat4 *b) {
+  __m256 b0 = _mm256_broadcast_ps((const __m128 *) &b->m11);
+  __m256 b1 = _mm256_broadcast_ps((const __m128 *) &b->m21);
+  __m256 b2 = _mm256_broadcast_ps((const __m128 *) &b->m31);
+  __m256 b3 = _mm256_broadcast_ps((const __m128 *) &b->m41);
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256 v = _mm256_loadu_ps(&in[i].x);
+    __m256 r = _mm256_mul_ps(b0, _mm256_shuffle_ps(v, v, 0x00));
+    r = _mm256_fmadd_ps(b1, _mm256_shuffle_ps(v, v, 0x55), r);
+    r = _mm256_fmadd_ps(b2, _mm256_shuffle_ps(v, v, 0xaa), r);
+    r = _mm256_fmadd_ps(b3, _mm256_shuffle_ps(v, v, 0xff), r);
+    _mm256_storeu_ps(&out[i].x, r);
+  }
+  glisy_vec4_transform_mat4_batch_scalar(out + i, in + i, count - i, b);
+}
+
+/**
+ * vec3_soa streams are aligned to GLISY_SIMD_ALIGN and padded to
+ * GLISY_SOA_PAD floats, so the AVX2 and AVX-512 loops run over
+ * whole vectors without a tail.
+ */
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_vec3_soa_normalize_avx2 (vec3_soa *out, const vec3_soa *a) {
+  for (size_t i = 0; i < a->count; i += 8) {
+    __m256 x = _mm256_load_ps(a->x + i);
+    __m256 y = _mm256_load_ps(a->y + i);
+    __m256 z = _mm256_load_ps(a->z + i);
+    __m256 len = _mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y,
+                 _mm256_mul_ps(x, x)));
+    __m256 inv = _mm256_and_ps(
+      _mm256_cmp_ps(len, _mm256_setzero_ps(), _CMP_GT_OQ),
+      _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len)));
+    _mm256_store_ps(out->x + i, _mm256_mul_ps(x, inv));
+    _mm256_store_ps(out->y + i, _mm256_mul_ps(y, inv));
+    _mm256_store_ps(out->z + i, _mm256_mul_ps(z, inv));
+  }
+}
+
+/**
+ * Slerp for t in [0, 1], eight quats at a time. Both angles
+ * t w and (1 - t) w then lie in [0, pi / 2], where an odd Taylor
+ * polynomial of degree 11 gives their sines to 6e-8, so no sincos
+ * range reduction is needed. acos is the polynomial of
+ * glisy_quat_slerp_weights. Other t take the compiled kernel.
+ */
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_quat_transpose_avx2 (__m256 v[4]) {
+  __m256 t0 = _mm256_unpacklo_ps(v[0], v[1]);
+  __m256 t1 = _mm256_unpacklo_ps(v[2], v[3]);
+  __m256 t2 = _mm256_unpackhi_ps(v[0], v[1]);
+  __m256 t3 = _mm256_unpackhi_ps(v[2], v[3]);
+  v[0] = _mm256_shuffle_ps(t0, t1, 0x44);
+  v[1] = _mm256_shuffle_ps(t0, t1, 0xee);
+  v[2] = _mm256_shuffle_ps(t2, t3, 0x44);
+  v[3] = _mm256_shuffle_ps(t2, t3, 0xee);
+}
+
+GLISY_TARGET("avx2,fma")
+static inline __m256
+glisy_quat_sin_avx2 (__m256 x) {
+  __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_fmadd_ps(x2, _mm256_set1_ps(-2.5052108e-8f),
+                             _mm256_set1_ps(2.7557319e-6f));
+  p = _mm256_fmadd_ps(x2, p, _mm256_set1_ps(-1.9841270e-4f));
+  p = _mm256_fmadd_ps(x2, p, _mm256_set1_ps(8.3333333e-3f));
+  p = _mm256_fmadd_ps(x2, p, _mm256_set1_ps(-1.6666667e-1f));
+  return _mm256_fmadd_ps(_mm256_mul_ps(x, x2), p, x);
+}
+
+GLISY_TARGET("avx2,fma")
+static inline void
+glisy_quat_slerp_batch_avx2 (quat *out,
+                             const quat *a,
+                             const quat *b,
+                             float t,
+                             size_t count) {
+  size_t i = 0;
+  if (t >= 0 && t <= 1) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 vt = _mm256_set1_ps(t);
+    const __m256 vu = _mm256_set1_ps(1.0f - t);
+    for (; i < (count & ~(size_t) 7); i += 8) {
+      const float *pa = &a[i].x, *pb = &b[i].x;
+      __m256 q[4], r[4];
+      for (int k = 0; k < 4; ++k) {
+        q[k] = _mm256_loadu2_m128(pa + 16 + 4 * k, pa + 4 * k);
+        r[k] = _mm256_loadu2_m128(pb + 16 + 4 * k, pb + 4 * k);
+      }
+      glisy_quat_transpose_avx2(q);
+      glisy_quat_transpose_avx2(r);
+
+      __m256 d = _mm256_mul_ps(q[0], r[0]);
+      d = _mm256_fmadd_ps(q[1], r[1], d);
+      d = _mm256_fmadd_ps(q[2], r[2], d);
+      d = _mm256_fmadd_ps(q[3], r[3], d);
+      __m256 flip = _mm256_and_ps(d, sign);
+      __m256 c = _mm256_xor_ps(d, flip);
+      __m256 p = _mm256_fmadd_ps(c, _mm256_set1_ps(-0.0012624911f),
+                                 _mm256_set1_ps(0.0066700901f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(-0.0170881256f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(0.0308918810f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(-0.0501743046f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(0.0889789874f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(-0.2145988016f));
+      p = _mm256_fmadd_ps(c, p, _mm256_set1_ps(1.5707963050f));
+      __m256 e = _mm256_sub_ps(one, c);
+      __m256 omega = _mm256_mul_ps(p, _mm256_sqrt_ps(_mm256_max_ps(e, zero)));
+      __m256 sinom = _mm256_sqrt_ps(_mm256_max_ps(
+                       _mm256_fnmadd_ps(c, c, one), zero));
+      __m256 inv = _mm256_div_ps(one, sinom);
+      __m256 w0 = _mm256_mul_ps(glisy_quat_sin_avx2(_mm256_mul_ps(vu, omega)),
+                                inv);
+      __m256 w1 = _mm256_mul_ps(glisy_quat_sin_avx2(_mm256_mul_ps(vt, omega)),
+                                inv);
+      __m256 near = _mm256_cmp_ps(e, _mm256_set1_ps(0.000001f), _CMP_LE_OQ);
+      w0 = _mm256_blendv_ps(w0, vu, near);
+      w1 = _mm256_xor_ps(_mm256_blendv_ps(w1, vt, near), flip);
+      for (int k = 0; k < 4; ++k) {
+        q[k] = _mm256_fmadd_ps(w0, q[k], _mm256_mul_ps(w1, r[k]));
+      }
+
+      glisy_quat_transpose_avx2(q);
+      float *po = &out[i].x;
+      for (int k = 0; k < 4; ++k) {
+        _mm256_storeu2_m128(po + 16 + 4 * k, po + 4 * k, q[k]);
+      }
+    }
+  }
+  glisy_quat_slerp_batch(out + i, a + i, b + i, t, count - i);
+}
+
+/**
+ * AVX-512 variants. One zmm register holds a whole mat4, or four
+ * vec4s, and masked loads and stores handle the tails.
+ */
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_mat4_multiply_batch_avx512 (mat4 *out,
+                                  const mat4 *a,
+                                  const mat4 *b,
+                                  size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    __m512 a0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&a[i].m11));
+    __m512 a1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&a[i].m21));
+    __m512 a2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&a[i].m31));
+    __m512 a3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&a[i].m41));
+    __m512 v = _mm512_loadu_ps(&b[i].m11);
+    __m512 r = _mm512_mul_ps(a0, _mm512_permute_ps(v, 0x00));
+    r = _mm512_fmadd_ps(a1, _mm512_permute_ps(v, 0x55), r);
+    r = _mm512_fmadd_ps(a2, _mm512_permute_ps(v, 0xaa), r);
+    r = _mm512_fmadd_ps(a3, _mm512_permute_ps(v, 0xff), r);
+    _mm512_storeu_ps(&out[i].m11, r);
+  }
+}
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_vec4_transform_mat4_batch_avx512 (vec4 *out,
+                                        const vec4 *in,
+                                        size_t count,
+                                        const mat4 *b) {
+  __m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b->m11));
+  __m512 b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b->m21));
+  __m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b->m31));
+  __m512 b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&b->m41));
+  for (size_t i = 0; i < count; i += 4) {
+    __mmask16 k = count - i >= 4 ? 0xffff
+                                 : (__mmask16) ((1u << 4 * (count - i)) - 1);
+    __m512 v = _mm512_maskz_loadu_ps(k, &in[i].x);
+    __m512 r = _mm512_mul_ps(b0, _mm512_permute_ps(v, 0x00));
+    r = _mm512_fmadd_ps(b1, _mm512_permute_ps(v, 0x55), r);
+    r = _mm512_fmadd_ps(b2, _mm512_permute_ps(v, 0xaa), r);
+    r = _mm512_fmadd_ps(b3, _mm512_permute_ps(v, 0xff), r);
+    _mm512_mask_storeu_ps(&out[i].x, k, r);
+  }
+}
+
+/**
+ * Sixteen vec3s at a time, split like the AVX2 kernel. The
+ * permutes that gather a component and the ones that scatter it
+ * back differ at this width.
+ */
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_vec3_transform_mat4_batch_avx512 (vec3 *out,
+                                        const vec3 *in,
+                                        size_t count,
+                                        const mat4 *mat,
+                                        int projective) {
+  const float *m = &mat->m11;
+  const __m512i gx = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 2, 5,
+                                       8, 11, 14, 1, 4, 7, 10, 13);
+  const __m512i gy = _mm512_setr_epi32(1, 4, 7, 10, 13, 0, 3, 6,
+                                       9, 12, 15, 2, 5, 8, 11, 14);
+  const __m512i gz = _mm512_setr_epi32(2, 5, 8, 11, 14, 1, 4, 7,
+                                       10, 13, 0, 3, 6, 9, 12, 15);
+  const __m512i sx = _mm512_setr_epi32(0, 11, 6, 1, 12, 7, 2, 13,
+                                       8, 3, 14, 9, 4, 15, 10, 5);
+  const __m512i sy = _mm512_setr_epi32(5, 0, 11, 6, 1, 12, 7, 2,
+                                       13, 8, 3, 14, 9, 4, 15, 10);
+  const __m512i sz = _mm512_setr_epi32(10, 5, 0, 11, 6, 1, 12, 7,
+                                       2, 13, 8, 3, 14, 9, 4, 15);
+  __m512 c[16];
+  size_t i = 0;
+  for (int e = 0; e < 16; ++e) c[e] = _mm512_set1_ps(m[e]);
+  for (; i + 16 <= count; i += 16) {
+    const float *p = &in[i].x;
+    __m512 v0 = _mm512_loadu_ps(p);
+    __m512 v1 = _mm512_loadu_ps(p + 16);
+    __m512 v2 = _mm512_loadu_ps(p + 32);
+    __m512 x = _mm512_mask_blend_ps(0x2492,
+                 _mm512_mask_blend_ps(0x4924, v0, v1), v2);
+    __m512 y = _mm512_mask_blend_ps(0x4924,
+                 _mm512_mask_blend_ps(0x9249, v0, v1), v2);
+    __m512 z = _mm512_mask_blend_ps(0x9249,
+                 _mm512_mask_blend_ps(0x2492, v0, v1), v2);
+    x = _mm512_permutexvar_ps(gx, x);
+    y = _mm512_permutexvar_ps(gy, y);
+    z = _mm512_permutexvar_ps(gz, z);
+
+    __m512 ox = _mm512_fmadd_ps(c[8], z, _mm512_fmadd_ps(c[4], y,
+                _mm512_fmadd_ps(c[0], x, c[12])));
+    __m512 oy = _mm512_fmadd_ps(c[9], z, _mm512_fmadd_ps(c[5], y,
+                _mm512_fmadd_ps(c[1], x, c[13])));
+    __m512 oz = _mm512_fmadd_ps(c[10], z, _mm512_fmadd_ps(c[6], y,
+                _mm512_fmadd_ps(c[2], x, c[14])));
+    if (projective) {
+      __m512 one = _mm512_set1_ps(1.0f);
+      __m512 w = _mm512_fmadd_ps(c[11], z, _mm512_fmadd_ps(c[7], y,
+                 _mm512_fmadd_ps(c[3], x, c[15])));
+      __mmask16 zero = _mm512_cmp_ps_mask(w, _mm512_setzero_ps(),
+                                          _CMP_EQ_OQ);
+      w = _mm512_div_ps(one, _mm512_mask_blend_ps(zero, w, one));
+      ox = _mm512_mul_ps(ox, w);
+      oy = _mm512_mul_ps(oy, w);
+      oz = _mm512_mul_ps(oz, w);
+    }
+
+    ox = _mm512_permutexvar_ps(sx, ox);
+    oy = _mm512_permutexvar_ps(sy, oy);
+    oz = _mm512_permutexvar_ps(sz, oz);
+    float *q = &out[i].x;
+    _mm512_storeu_ps(q, _mm512_mask_blend_ps(0x4924,
+                          _mm512_mask_blend_ps(0x2492, ox, oy), oz));
+    _mm512_storeu_ps(q + 16, _mm512_mask_blend_ps(0x2492,
+                               _mm512_mask_blend_ps(0x9249, ox, oy), oz));
+    _mm512_storeu_ps(q + 32, _mm512_mask_blend_ps(0x9249,
+                               _mm512_mask_blend_ps(0x4924, ox, oy), oz));
+  }
+  glisy_vec3_transform_mat4_batch_avx2(out + i, in + i, count - i,
+                                       mat, projective);
+}
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_vec3_soa_normalize_avx512 (vec3_soa *out, const vec3_soa *a) {
+  for (size_t i = 0; i < a->count; i += 16) {
+    __m512 x = _mm512_load_ps(a->x + i);
+    __m512 y = _mm512_load_ps(a->y + i);
+    __m512 z = _mm512_load_ps(a->z + i);
+    __m512 len = _mm512_fmadd_ps(z, z, _mm512_fmadd_ps(y, y,
+                 _mm512_mul_ps(x, x)));
+    __mmask16 k = _mm512_cmp_ps_mask(len, _mm512_setzero_ps(), _CMP_GT_OQ);
+    __m512 inv = _mm512_maskz_div_ps(k, _mm512_set1_ps(1.0f),
+                                     _mm512_sqrt_ps(len));
+    _mm512_store_ps(out->x + i, _mm512_mul_ps(x, inv));
+    _mm512_store_ps(out->y + i, _mm512_mul_ps(y, inv));
+    _mm512_store_ps(out->z + i, _mm512_mul_ps(z, inv));
+  }
+}
+
+/**
+ * Slerp as glisy_quat_slerp_batch_avx2, sixteen quats at a time.
+ * Each zmm register loads four whole quats and the transpose works
+ * within 128 bit lanes, so lane j holds quat 4 (j % 4) + j / 4;
+ * transposing back restores the order.
+ */
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_quat_transpose_avx512 (__m512 v[4]) {
+  __m512 t0 = _mm512_unpacklo_ps(v[0], v[1]);
+  __m512 t1 = _mm512_unpacklo_ps(v[2], v[3]);
+  __m512 t2 = _mm512_unpackhi_ps(v[0], v[1]);
+  __m512 t3 = _mm512_unpackhi_ps(v[2], v[3]);
+  v[0] = _mm512_shuffle_ps(t0, t1, 0x44);
+  v[1] = _mm512_shuffle_ps(t0, t1, 0xee);
+  v[2] = _mm512_shuffle_ps(t2, t3, 0x44);
+  v[3] = _mm512_shuffle_ps(t2, t3, 0xee);
+}
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline __m512
+glisy_quat_sin_avx512 (__m512 x) {
+  __m512 x2 = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_fmadd_ps(x2, _mm512_set1_ps(-2.5052108e-8f),
+                             _mm512_set1_ps(2.7557319e-6f));
+  p = _mm512_fmadd_ps(x2, p, _mm512_set1_ps(-1.9841270e-4f));
+  p = _mm512_fmadd_ps(x2, p, _mm512_set1_ps(8.3333333e-3f));
+  p = _mm512_fmadd_ps(x2, p, _mm512_set1_ps(-1.6666667e-1f));
+  return _mm512_fmadd_ps(_mm512_mul_ps(x, x2), p, x);
+}
+
+GLISY_TARGET("avx512f,avx2,fma")
+static inline void
+glisy_quat_slerp_batch_avx512 (quat *out,
+                               const quat *a,
+                               const quat *b,
+                               float t,
+                               size_t count) {
+  size_t i = 0;
+  if (t >= 0 && t <= 1) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 vt = _mm512_set1_ps(t);
+    const __m512 vu = _mm512_set1_ps(1.0f - t);
+    for (; i < (count & ~(size_t) 15); i += 16) {
+      const float *pa = &a[i].x, *pb = &b[i].x;
+      __m512 q[4], r[4];
+      for (int k = 0; k < 4; ++k) {
+        q[k] = _mm512_loadu_ps(pa + 16 * k);
+        r[k] = _mm512_loadu_ps(pb + 16 * k);
+      }
+      glisy_quat_transpose_avx512(q);
+      glisy_quat_transpose_avx512(r);
+
+      __m512 d = _mm512_mul_ps(q[0], r[0]);
+      d = _mm512_fmadd_ps(q[1], r[1], d);
+      d = _mm512_fmadd_ps(q[2], r[2], d);
+      d = _mm512_fmadd_ps(q[3], r[3], d);
+      __mmask16 flip = _mm512_cmp_ps_mask(d, zero, _CMP_LT_OQ);
+      __m512 c = _mm512_abs_ps(d);
+      __m512 p = _mm512_fmadd_ps(c, _mm512_set1_ps(-0.0012624911f),
+                                 _mm512_set1_ps(0.0066700901f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(-0.0170881256f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(0.0308918810f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(-0.0501743046f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(0.0889789874f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(-0.2145988016f));
+      p = _mm512_fmadd_ps(c, p, _mm512_set1_ps(1.5707963050f));
+      __m512 e = _mm512_sub_ps(one, c);
+      __m512 omega = _mm512_mul_ps(p, _mm512_sqrt_ps(_mm512_max_ps(e, zero)));
+      __m512 sinom = _mm512_sqrt_ps(_mm512_max_ps(
+                       _mm512_fnmadd_ps(c, c, one), zero));
+      __m512 inv = _mm512_div_ps(one, sinom);
+      __m512 w0 = _mm512_mul_ps(glisy_quat_sin_avx512(_mm512_mul_ps(vu, omega)),
+                                inv);
+      __m512 w1 = _mm512_mul_ps(glisy_quat_sin_avx512(_mm512_mul_ps(vt, omega)),
+                                inv);
+      __mmask16 near = _mm512_cmp_ps_mask(e, _mm512_set1_ps(0.000001f),
+                                          _CMP_LE_OQ);
+      w0 = _mm512_mask_blend_ps(near, w0, vu);
+      w1 = _mm512_mask_blend_ps(near, w1, vt);
+      w1 = _mm512_mask_sub_ps(w1, flip, zero, w1);
+      for (int k = 0; k < 4; ++k) {
+        q[k] = _mm512_fmadd_ps(w0, q[k], _mm512_mul_ps(w1, r[k]));
+      }
+
+      glisy_quat_transpose_avx512(q);
+      float *po = &out[i].x;
+      for (int k = 0; k < 4; ++k) _mm512_storeu_ps(po + 16 * k, q[k]);
+    }
+  }
+  glisy_quat_slerp_batch_avx2(out + i, a + i, b + i, t, count - i);
+}
+#endif
+
+/**
+ * Expands to the variants of one operation indexed by ISA level,
+ * NULL where a level has none of its own. Selection falls back to
+ * the next lower level that has one.
+ */
+
+#ifdef GLISY_DISPATCH_X86
+#define GLISY_DISPATCH_VARIANTS(scalar, sse2, avx2, avx512) \
+  {scalar, sse2, avx2, avx512}
+#else
+#define GLISY_DISPATCH_VARIANTS(scalar, sse2, avx2, avx512) {scalar}
+#endif
+
+/**
+ * Points slot op of table k at its variant of level isa. Returns 0
+ * and leaves k unchanged when that level has no variant.
+ */
+
+static inline int
+glisy_kernels_set (glisy_kernels *k, int op, int isa) {
+  switch (op) {
+    case GLISY_KERNEL_MAT4_MULTIPLY: {
+      glisy_mat4_multiply_batch_fn v[GLISY_ISA_COUNT] =
+        GLISY_DISPATCH_VARIANTS(glisy_mat4_multiply_batch_scalar,
+                                glisy_mat4_multiply_batch_sse,
+                                glisy_mat4_multiply_batch_avx2,
+                                glisy_mat4_multiply_batch_avx512);
+      if (!v[isa]) return 0;
+      k->mat4_multiply_batch = v[isa];
+      break;
+    }
+    case GLISY_KERNEL_VEC3_TRANSFORM: {
+      glisy_vec3_transform_batch_fn v[GLISY_ISA_COUNT] =
+        GLISY_DISPATCH_VARIANTS(glisy_vec3_transform_mat4_batch_scalar,
+                                glisy_vec3_transform_mat4_batch_simd,
+                                glisy_vec3_transform_mat4_batch_avx2,
+                                glisy_vec3_transform_mat4_batch_avx512);
+      if (!v[isa]) return 0;
+      k->vec3_transform_mat4_batch = v[isa];
+      break;
+    }
+    case GLISY_KERNEL_VEC4_TRANSFORM: {
+      glisy_vec4_transform_batch_fn v[GLISY_ISA_COUNT] =
+        GLISY_DISPATCH_VARIANTS(glisy_vec4_transform_mat4_batch_scalar,
+                                glisy_vec4_transform_mat4_batch_sse,
+                                glisy_vec4_transform_mat4_batch_avx2,
+                                glisy_vec4_transform_mat4_batch_avx512);
+      if (!v[isa]) return 0;
+      k->vec4_transform_mat4_batch = v[isa];
+      break;
+    }
+    case GLISY_KERNEL_VEC3_NORMALIZE: {
+      glisy_vec3_soa_normalize_fn v[GLISY_ISA_COUNT] =
+        GLISY_DISPATCH_VARIANTS(glisy_vec3_soa_normalize_scalar,
+                                glisy_vec3_soa_normalize_sse,
+                                glisy_vec3_soa_normalize_avx2,
+                                glisy_vec3_soa_normalize_avx512);
+      if (!v[isa]) return 0;
+      k->vec3_soa_normalize = v[isa];
+      break;
+    }
+    case GLISY_KERNEL_QUAT_SLERP: {
+      glisy_quat_slerp_batch_fn v[GLISY_ISA_COUNT] =
+        GLISY_DISPATCH_VARIANTS(glisy_quat_slerp_batch_scalar,
+                                glisy_quat_slerp_batch,
+                                glisy_quat_slerp_batch_avx2,
+                                glisy_quat_slerp_batch_avx512);
+      if (!v[isa]) return 0;
+      k->quat_slerp_batch = v[isa];
+      break;
+    }
+    default:
+      return 0;
+  }
+  k->isa[op] = isa;
+  return 1;
+}
+
+/**
+ * Items per pass and passes per variant of the tuning benchmark.
+ * The batch is small enough to stay in L1 so only the kernels are
+ * compared, and the best of the passes is kept to ignore
+ * interruptions.
+ */
+
+#define GLISY_DISPATCH_TUNE_ITEMS 256
+#define GLISY_DISPATCH_TUNE_PASSES 16
+
+/**
+ * Returns the fastest time in seconds of slot op of table k over
+ * the tuning batch.
+ */
+
+static inline double
+glisy_kernels_time (const glisy_kernels *k, int op,
+                    mat4 *m, vec4 *v, vec3_soa *s) {
+  const size_t n = GLISY_DISPATCH_TUNE_ITEMS;
+  double best = 1e30;
+  for (int pass = 0; pass < GLISY_DISPATCH_TUNE_PASSES; ++pass) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    switch (op) {
+      case GLISY_KERNEL_MAT4_MULTIPLY:
+        k->mat4_multiply_batch(m + n, m, m, n);
+        break;
+      case GLISY_KERNEL_VEC3_TRANSFORM:
+        k->vec3_transform_mat4_batch((vec3 *) (v + n), (vec3 *) v,
+                                     n, m, 0);
+        break;
+      case GLISY_KERNEL_VEC4_TRANSFORM:
+        k->vec4_transform_mat4_batch(v + n, v, n, m);
+        break;
+      case GLISY_KERNEL_VEC3_NORMALIZE:
+        k->vec3_soa_normalize(s + 1, s);
+        break;
+      case GLISY_KERNEL_QUAT_SLERP:
+        k->quat_slerp_batch((quat *) (v + n), (quat *) v,
+                            (quat *) m, 0.25f, n);
+        break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double t = (double) (stop.tv_sec - start.tv_sec) +
+               (double) (stop.tv_nsec - start.tv_nsec) * 1e-9;
+    if (t < best) best = t;
+  }
+  return best;
+}
+
+/**
+ * Fills table k with, for every operation, the variant of the
+ * highest level up to cap or, with tune, the fastest variant up to
+ * cap. Tuning needs scratch memory and falls back to the highest
+ * level when it cannot get it.
+ */
+
+static inline void
+glisy_kernels_select (glisy_kernels *k, int cap, int tune) {
+  const size_t n = GLISY_DISPATCH_TUNE_ITEMS;
+  mat4 *m = NULL;
+  vec4 *v = NULL;
+  vec3_soa s[2] = {vec3_soa_create(), vec3_soa_create()};
+
+  if (tune) {
+    m = (mat4 *) glisy_simd_alloc(2 * n * sizeof(mat4));
+    v = (vec4 *) glisy_simd_alloc(2 * n * sizeof(vec4));
+    if (!m || !v || glisy_vec3_soa_resize(&s[0], n) ||
+        glisy_vec3_soa_resize(&s[1], n)) {
+      tune = 0;
+    } else {
+      for (size_t i = 0; i < 2 * n; ++i) {
+        m[i] = mat4_create();
+        m[i].m41 = (float) i;
+        v[i] = (vec4) {1.0f + i, 0.5f, -0.25f, 1.0f};
+      }
+      glisy_vec3_soa_from_vec4(&s[0], v, n);
+    }
+  }
+
+  for (int op = 0; op < GLISY_KERNEL_COUNT; ++op) {
+    int best = 0;
+    double fastest = 1e30;
+    for (int isa = 0; isa <= cap; ++isa) {
+      if (!glisy_kernels_set(k, op, isa)) continue;
+      if (tune) {
+        double t = glisy_kernels_time(k, op, m, v, s);
+        if (t >= fastest) continue;
+        fastest = t;
+      }
+      best = isa;
+    }
+    glisy_kernels_set(k, op, best);
+  }
+
+  free(m);
+  free(v);
+  vec3_soa_free(s[0]);
+  vec3_soa_free(s[1]);
+}
+
+/**
+ * The table used by the glisy_dispatch_* calls. Each translation
+ * unit that includes this header has its own.
+ */
+
+static glisy_kernels glisy_kernels_table;
+#ifndef GLISY_NO_THREADS
+static atomic_int glisy_kernels_ready;
+static pthread_once_t glisy_kernels_once = PTHREAD_ONCE_INIT;
+#else
+static int glisy_kernels_ready;
+#endif
+
+/**
+ * Detects the CPU and fills the kernel table, timing the variants
+ * when flags has GLISY_DISPATCH_TUNE. The GLISY_ISA environment
+ * variable, one of "scalar", "sse2", "avx2" or "avx512", forces
+ * every operation to that level or the nearest lower one with a
+ * variant, and turns tuning off; it never goes above what the CPU
+ * supports. Call it once at startup, before other threads use the
+ * table, to tune; otherwise the first dispatched call runs it with
+ * no flags. Returns the table.
+ */
+
+static inline const glisy_kernels *
+glisy_dispatch_init (int flags) {
+  glisy_kernels *k = &glisy_kernels_table;
+  const char *env = getenv("GLISY_ISA");
+  k->cpu = glisy_cpu_isa();
+  k->cap = k->cpu;
+  if (env) {
+    for (int isa = 0; isa < GLISY_ISA_COUNT; ++isa) {
+      if (0 == strcmp(env, glisy_isa_name(isa))) {
+        if (isa < k->cap) k->cap = isa;
+        flags &= ~GLISY_DISPATCH_TUNE;
+      }
+    }
+  }
+  glisy_kernels_select(k, k->cap, flags & GLISY_DISPATCH_TUNE);
+#ifndef GLISY_NO_THREADS
+  atomic_store_explicit(&glisy_kernels_ready, 1, memory_order_release);
+#else
+  glisy_kernels_ready = 1;
+#endif
+  return k;
+}
+
+static inline void
+glisy_dispatch_init_default (void) {
+  glisy_dispatch_init(0);
+}
+
+/**
+ * Returns the kernel table, filling it on first use.
+ */
+
+static inline const glisy_kernels *
+glisy_dispatch (void) {
+#ifndef GLISY_NO_THREADS
+  if (!atomic_load_explicit(&glisy_kernels_ready, memory_order_acquire)) {
+    pthread_once(&glisy_kernels_once, glisy_dispatch_init_default);
+  }
+#else
+  if (!glisy_kernels_ready) glisy_dispatch_init_default();
+#endif
+  return &glisy_kernels_table;
+}
+
+/**
+ * Dispatched batch kernels, with the same contracts as the
+ * compile time ones they stand in for.
+ */
+
+static inline void
+glisy_dispatch_mat4_multiply_batch (mat4 *out,
+                                    const mat4 *a,
+                                    const mat4 *b,
+                                    size_t count) {
+  glisy_dispatch()->mat4_multiply_batch(out, a, b, count);
+}
+
+static inline void
+glisy_dispatch_vec3_transform_mat4_batch (vec3 *out,
+                                          const vec3 *in,
+                                          size_t count,
+                                          const mat4 *mat) {
+  glisy_dispatch()->vec3_transform_mat4_batch(out, in, count, mat, 1);
+}
+
+static inline void
+glisy_dispatch_vec3_transform_mat4_affine_batch (vec3 *out,
+                                                 const vec3 *in,
+                                                 size_t count,
+                                                 const mat4 *mat) {
+  glisy_dispatch()->vec3_transform_mat4_batch(out, in, count, mat, 0);
+}
+
+static inline void
+glisy_dispatch_vec4_transform_mat4_batch (vec4 *out,
+                                          const vec4 *in,
+                                          size_t count,
+                                          const mat4 *mat) {
+  glisy_dispatch()->vec4_transform_mat4_batch(out, in, count, mat);
+}
+
+static inline int
+glisy_dispatch_vec3_soa_normalize (vec3_soa *out, const vec3_soa *a) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+  glisy_dispatch()->vec3_soa_normalize(out, a);
+  return 0;
+}
+
+static inline void
+glisy_dispatch_quat_slerp_batch (quat *out,
+                                 const quat *a,
+                                 const quat *b,
+                                 float t,
+                                 size_t count) {
+  glisy_dispatch()->quat_slerp_batch(out, a, b, t, count);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
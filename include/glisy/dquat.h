@@ -0,0 +1,321 @@
+#ifndef GLISY_DQUAT_H
+#define GLISY_DQUAT_H
+
+#include <math.h>
+#include <stddef.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+#include <glisy/mat4.h>
+#include <glisy/mat3x4.h>
+#include <glisy/trs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * dquat struct type. A dual quaternion real + e dual. A unit dquat
+ * is a rigid transform that rotates by the unit quat real, then
+ * translates by t, with dual = t * real / 2 where t is the pure
+ * quat (t.x, t.y, t.z, 0). Composition and transformation follow
+ * trs and mat4_multiply: dquat_multiply(a, b) applies b, then a.
+ */
+
+typedef struct dquat dquat;
+struct dquat {
+  quat real;
+  quat dual;
+};
+
+/**
+ * dquat initializers.
+ */
+
+#define dquat_create() dquat({0, 0, 0, 1}, {0, 0, 0, 0})
+
+#define dquat(...) ((dquat){ __VA_ARGS__ })
+
+/**
+ * Builds the dquat that rotates by unit quat q, then translates
+ * by t.
+ */
+
+static inline void
+glisy_dquat_from_rotation_translation_into (dquat *out,
+                                            const quat *q,
+                                            const vec3 *t) {
+  float tx = 0.5f * t->x, ty = 0.5f * t->y, tz = 0.5f * t->z;
+  quat r = *q;
+  out->real = r;
+  out->dual = (quat) {tx * r.w + ty * r.z - tz * r.y,
+                      ty * r.w + tz * r.x - tx * r.z,
+                      tz * r.w + tx * r.y - ty * r.x,
+                      -tx * r.x - ty * r.y - tz * r.z};
+}
+
+static inline dquat
+glisy_dquat_from_rotation_translation (quat q, vec3 t) {
+  dquat out;
+  glisy_dquat_from_rotation_translation_into(&out, &q, &t);
+  return out;
+}
+
+#define dquat_from_rotation_translation(q, t) \
+  glisy_dquat_from_rotation_translation((q), (t))
+
+/**
+ * Returns the translation of unit dquat a, 2 * dual * conj(real).
+ */
+
+static inline vec3
+glisy_dquat_get_translation (dquat a) {
+  quat r = a.real, d = a.dual;
+  return (vec3) {2 * (d.x * r.w - d.w * r.x + r.y * d.z - r.z * d.y),
+                 2 * (d.y * r.w - d.w * r.y + r.z * d.x - r.x * d.z),
+                 2 * (d.z * r.w - d.w * r.z + r.x * d.y - r.y * d.x)};
+}
+
+#define dquat_get_translation(a) glisy_dquat_get_translation((a))
+
+/**
+ * Converts trs a to a dquat. Dual quaternions cannot hold scale,
+ * so it is dropped.
+ */
+
+static inline void
+glisy_dquat_from_trs_into (dquat *out, const trs *a) {
+  glisy_dquat_from_rotation_translation_into(out, &a->rotation,
+                                             &a->translation);
+}
+
+static inline dquat
+glisy_dquat_from_trs (trs a) {
+  dquat out;
+  glisy_dquat_from_trs_into(&out, &a);
+  return out;
+}
+
+#define dquat_from_trs(a) glisy_dquat_from_trs((a))
+
+/**
+ * Converts unit dquat a to a trs with unit scale.
+ */
+
+static inline trs
+glisy_dquat_to_trs (dquat a) {
+  return trs(glisy_dquat_get_translation(a), a.real, {1, 1, 1});
+}
+
+#define dquat_to_trs(a) glisy_dquat_to_trs((a))
+
+/**
+ * Converts the rigid part of affine mat4 a to a dquat, decomposing
+ * it like trs_from_mat4 and dropping the scale.
+ */
+
+static inline dquat
+glisy_dquat_from_mat4 (mat4 a) {
+  return glisy_dquat_from_trs(glisy_trs_from_mat4(a));
+}
+
+#define dquat_from_mat4(a) glisy_dquat_from_mat4((a))
+
+static inline dquat
+glisy_dquat_from_mat3x4 (mat3x4 a) {
+  return glisy_dquat_from_trs(glisy_trs_from_mat3x4(a));
+}
+
+#define dquat_from_mat3x4(a) glisy_dquat_from_mat3x4((a))
+
+/**
+ * Converts unit dquat a to an affine mat4 or a mat3x4.
+ */
+
+static inline mat4
+glisy_dquat_to_mat4 (dquat a) {
+  return glisy_trs_to_mat4(glisy_dquat_to_trs(a));
+}
+
+#define dquat_to_mat4(a) glisy_dquat_to_mat4((a))
+
+static inline mat3x4
+glisy_dquat_to_mat3x4 (dquat a) {
+  return glisy_trs_to_mat3x4(glisy_dquat_to_trs(a));
+}
+
+#define dquat_to_mat3x4(a) glisy_dquat_to_mat3x4((a))
+
+/**
+ * Multiplies dquats a and b: the result applies b, then a.
+ */
+
+static inline void
+glisy_dquat_multiply_into (dquat *out, const dquat *a, const dquat *b) {
+  quat real, d0, d1;
+  glisy_quat_multiply_into(&real, &a->real, &b->real);
+  glisy_quat_multiply_into(&d0, &a->real, &b->dual);
+  glisy_quat_multiply_into(&d1, &a->dual, &b->real);
+  out->real = real;
+  out->dual = (quat) {d0.x + d1.x, d0.y + d1.y, d0.z + d1.z, d0.w + d1.w};
+}
+
+static inline dquat
+glisy_dquat_multiply (dquat a, dquat b) {
+  dquat out;
+  glisy_dquat_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define dquat_multiply(a, b) glisy_dquat_multiply((a), (b))
+
+/**
+ * Conjugates both parts of dquat a, which inverts a unit dquat.
+ */
+
+static inline void
+glisy_dquat_conjugate_into (dquat *out, const dquat *a) {
+  glisy_quat_conjugate_into(&out->real, &a->real);
+  glisy_quat_conjugate_into(&out->dual, &a->dual);
+}
+
+static inline dquat
+glisy_dquat_conjugate (dquat a) {
+  dquat out;
+  glisy_dquat_conjugate_into(&out, &a);
+  return out;
+}
+
+#define dquat_conjugate(a) glisy_dquat_conjugate((a))
+
+/**
+ * Normalizes dquat a: scales it so real has unit length and removes
+ * the part of dual along real, so a blend of unit dquats becomes a
+ * rigid transform again. A zero real part yields a zero dquat.
+ */
+
+static inline void
+glisy_dquat_normalize_into (dquat *out, const dquat *a) {
+  quat r = a->real, d = a->dual;
+  float len = r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w;
+  if (len > 0) {
+    float inv = 1 / sqrtf(len);
+    float dot = (r.x * d.x + r.y * d.y + r.z * d.z + r.w * d.w) * inv;
+    r = (quat) {r.x * inv, r.y * inv, r.z * inv, r.w * inv};
+    d = (quat) {(d.x - r.x * dot) * inv, (d.y - r.y * dot) * inv,
+                (d.z - r.z * dot) * inv, (d.w - r.w * dot) * inv};
+  } else {
+    r = d = (quat) {0, 0, 0, 0};
+  }
+  out->real = r;
+  out->dual = d;
+}
+
+static inline dquat
+glisy_dquat_normalize (dquat a) {
+  dquat out;
+  glisy_dquat_normalize_into(&out, &a);
+  return out;
+}
+
+#define dquat_normalize(a) glisy_dquat_normalize((a))
+
+/**
+ * Blends dquats a and b by t and normalizes the result (dual
+ * quaternion linear blending). b is negated first when its real
+ * part is on the other side of the sphere from a's, so the blend
+ * takes the shorter path.
+ */
+
+static inline void
+glisy_dquat_lerp_into (dquat *out, const dquat *a, const dquat *b,
+                       float t) {
+  const float *pa = &a->real.x, *pb = &b->real.x;
+  float dot = a->real.x * b->real.x + a->real.y * b->real.y +
+              a->real.z * b->real.z + a->real.w * b->real.w;
+  float s = 1 - t, u = dot < 0 ? -t : t;
+  float v[8];
+  for (int i = 0; i < 8; ++i) v[i] = s * pa[i] + u * pb[i];
+  dquat blend = dquat({v[0], v[1], v[2], v[3]}, {v[4], v[5], v[6], v[7]});
+  glisy_dquat_normalize_into(out, &blend);
+}
+
+static inline dquat
+glisy_dquat_lerp (dquat a, dquat b, float t) {
+  dquat out;
+  glisy_dquat_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+#define dquat_lerp(a, b, t) glisy_dquat_lerp((a), (b), (t))
+
+/**
+ * Transforms point v by unit dquat a.
+ */
+
+static inline void
+glisy_dquat_transform_point_into (vec3 *out, const dquat *a, const vec3 *v) {
+  vec3 p = glisy_trs_rotate(&a->real, *v);
+  vec3 t = glisy_dquat_get_translation(*a);
+  *out = (vec3) {p.x + t.x, p.y + t.y, p.z + t.z};
+}
+
+static inline vec3
+glisy_dquat_transform_point (dquat a, vec3 v) {
+  vec3 out;
+  glisy_dquat_transform_point_into(&out, &a, &v);
+  return out;
+}
+
+#define dquat_transform_point(a, v) glisy_dquat_transform_point((a), (v))
+
+/**
+ * Transforms direction v by unit dquat a, ignoring the translation.
+ */
+
+static inline vec3
+glisy_dquat_transform_vector (dquat a, vec3 v) {
+  return glisy_trs_rotate(&a.real, v);
+}
+
+#define dquat_transform_vector(a, v) glisy_dquat_transform_vector((a), (v))
+
+/**
+ * Writes a string representation of dquat a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_dquat_format (char *buf, size_t size, dquat a) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_text(&w, "dquat(", 6);
+  glisy_writer_floats(&w, "real=", &a.real.x, 4, 4);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "dual=", &a.dual.x, 4, 4);
+  glisy_writer_text(&w, ")", 1);
+  return glisy_writer_end(&w);
+}
+
+#define dquat_format(buf, size, a) glisy_dquat_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(dquat)
+
+/**
+ * Returns a string representation of dquat a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_dquat_string (dquat a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_dquat_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define dquat_string(a) glisy_dquat_string((a))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -24,7 +24,7 @@ typedef vec3 euler;
  * Clones and returns euler.
  */
 
-#define euler_clone(e) ((euler) {e.x, e.y, e.z})
+#define euler_clone(e) glisy_vec3_clone((e))
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,462 @@
+#ifndef GLISY_FORMAT_H
+#define GLISY_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Non-allocating text formatting for the *_format functions. Floats
+ * are written with the fewest significant digits that read back as
+ * the same float (Ryu, Adams 2018), in the style of %g: fixed
+ * notation for decimal exponents from -4 to 8, otherwise d.ddde+XX.
+ */
+
+/**
+ * Largest number of characters glisy_format_float writes, as in
+ * "-1.17549435e-38".
+ */
+
+#define GLISY_FORMAT_FLOAT_MAX 15
+
+/**
+ * Buffer size that holds the text of any glisy type, including the
+ * terminating NUL.
+ */
+
+#define GLISY_FORMAT_MAX 512
+
+#define GLISY_FORMAT_POW5_INV_BITCOUNT 59
+#define GLISY_FORMAT_POW5_BITCOUNT 61
+
+/**
+ * Returns the number of bits of 5^e, for 0 < e <= 3528.
+ */
+
+static inline int32_t
+glisy_format_pow5bits (int32_t e) {
+  return (int32_t) (((uint32_t) e * 1217359) >> 19) + 1;
+}
+
+/**
+ * Returns floor(log10(2^e)) and floor(log10(5^e)), for 0 <= e <= 1650.
+ */
+
+static inline uint32_t
+glisy_format_log10_pow2 (int32_t e) {
+  return ((uint32_t) e * 78913) >> 18;
+}
+
+static inline uint32_t
+glisy_format_log10_pow5 (int32_t e) {
+  return ((uint32_t) e * 732923) >> 20;
+}
+
+static inline int
+glisy_format_multiple_of_pow5 (uint32_t value, uint32_t p) {
+  uint32_t count = 0;
+  while (value % 5 == 0) {
+    value /= 5;
+    ++count;
+  }
+  return count >= p;
+}
+
+/**
+ * Returns (m * factor) >> shift for shift > 32, with factor below
+ * 2^62.
+ */
+
+static inline uint32_t
+glisy_format_mul_shift (uint32_t m, uint64_t factor, int32_t shift) {
+  uint64_t lo = (uint64_t) m * (uint32_t) factor;
+  uint64_t hi = (uint64_t) m * (uint32_t) (factor >> 32);
+  return (uint32_t) (((lo >> 32) + hi) >> (shift - 32));
+}
+
+/**
+ * Returns m * 5^-q / 2^j and m * 5^i / 2^j, rounded down, from
+ * tables of 5^-q and 5^i normalized to 59 and 61 bits.
+ */
+
+static inline uint32_t
+glisy_format_mul_pow5_inv (uint32_t m, uint32_t q, int32_t j) {
+  static const uint64_t table[31] = {
+    576460752303423489u, 461168601842738791u, 368934881474191033u,
+    295147905179352826u, 472236648286964522u, 377789318629571618u,
+    302231454903657294u, 483570327845851670u, 386856262276681336u,
+    309485009821345069u, 495176015714152110u, 396140812571321688u,
+    316912650057057351u, 507060240091291761u, 405648192073033409u,
+    324518553658426727u, 519229685853482763u, 415383748682786211u,
+    332306998946228969u, 531691198313966350u, 425352958651173080u,
+    340282366920938464u, 544451787073501542u, 435561429658801234u,
+    348449143727040987u, 557518629963265579u, 446014903970612463u,
+    356811923176489971u, 570899077082383953u, 456719261665907162u,
+    365375409332725730u
+  };
+  return glisy_format_mul_shift(m, table[q], j);
+}
+
+static inline uint32_t
+glisy_format_mul_pow5 (uint32_t m, uint32_t i, int32_t j) {
+  static const uint64_t table[47] = {
+    1152921504606846976u, 1441151880758558720u, 1801439850948198400u,
+    2251799813685248000u, 1407374883553280000u, 1759218604441600000u,
+    2199023255552000000u, 1374389534720000000u, 1717986918400000000u,
+    2147483648000000000u, 1342177280000000000u, 1677721600000000000u,
+    2097152000000000000u, 1310720000000000000u, 1638400000000000000u,
+    2048000000000000000u, 1280000000000000000u, 1600000000000000000u,
+    2000000000000000000u, 1250000000000000000u, 1562500000000000000u,
+    1953125000000000000u, 1220703125000000000u, 1525878906250000000u,
+    1907348632812500000u, 1192092895507812500u, 1490116119384765625u,
+    1862645149230957031u, 1164153218269348144u, 1455191522836685180u,
+    1818989403545856475u, 2273736754432320594u, 1421085471520200371u,
+    1776356839400250464u, 2220446049250313080u, 1387778780781445675u,
+    1734723475976807094u, 2168404344971008868u, 1355252715606880542u,
+    1694065894508600678u, 2117582368135750847u, 1323488980084844279u,
+    1654361225106055349u, 2067951531382569187u, 1292469707114105741u,
+    1615587133892632177u, 2019483917365790221u
+  };
+  return glisy_format_mul_shift(m, table[i], j);
+}
+
+/**
+ * Finds the shortest decimal digits * 10^exponent that rounds to
+ * the finite, non-zero float with biased exponent ieee_exponent and
+ * mantissa bits ieee_mantissa.
+ */
+
+static inline void
+glisy_format_shortest (uint32_t ieee_mantissa, uint32_t ieee_exponent,
+                       uint32_t *digits, int32_t *exponent) {
+  int32_t e2;
+  uint32_t m2;
+  if (0 == ieee_exponent) {
+    e2 = 1 - 127 - 23 - 2;
+    m2 = ieee_mantissa;
+  } else {
+    e2 = (int32_t) ieee_exponent - 127 - 23 - 2;
+    m2 = (1u << 23) | ieee_mantissa;
+  }
+  const int accept_bounds = 0 == (m2 & 1);
+
+  // the float and the midpoints to its neighbours, times four
+  const uint32_t mv = 4 * m2;
+  const uint32_t mp = 4 * m2 + 2;
+  const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+  const uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+  uint32_t vr, vp, vm;
+  int32_t e10;
+  int vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+  uint32_t last_removed = 0;
+  if (e2 >= 0) {
+    const uint32_t q = glisy_format_log10_pow2(e2);
+    const int32_t k = GLISY_FORMAT_POW5_INV_BITCOUNT +
+                      glisy_format_pow5bits((int32_t) q) - 1;
+    const int32_t i = -e2 + (int32_t) q + k;
+    e10 = (int32_t) q;
+    vr = glisy_format_mul_pow5_inv(mv, q, i);
+    vp = glisy_format_mul_pow5_inv(mp, q, i);
+    vm = glisy_format_mul_pow5_inv(mm, q, i);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      const int32_t l = GLISY_FORMAT_POW5_INV_BITCOUNT +
+                        glisy_format_pow5bits((int32_t) (q - 1)) - 1;
+      last_removed = glisy_format_mul_pow5_inv(mv, q - 1,
+                       -e2 + (int32_t) q - 1 + l) % 10;
+    }
+    if (q <= 9) {
+      if (mv % 5 == 0) {
+        vr_trailing_zeros = glisy_format_multiple_of_pow5(mv, q);
+      } else if (accept_bounds) {
+        vm_trailing_zeros = glisy_format_multiple_of_pow5(mm, q);
+      } else {
+        vp -= glisy_format_multiple_of_pow5(mp, q);
+      }
+    }
+  } else {
+    const uint32_t q = glisy_format_log10_pow5(-e2);
+    const int32_t i = -e2 - (int32_t) q;
+    const int32_t k = glisy_format_pow5bits(i) - GLISY_FORMAT_POW5_BITCOUNT;
+    int32_t j = (int32_t) q - k;
+    e10 = (int32_t) q + e2;
+    vr = glisy_format_mul_pow5(mv, (uint32_t) i, j);
+    vp = glisy_format_mul_pow5(mp, (uint32_t) i, j);
+    vm = glisy_format_mul_pow5(mm, (uint32_t) i, j);
+    if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+      j = (int32_t) q - 1 -
+          (glisy_format_pow5bits(i + 1) - GLISY_FORMAT_POW5_BITCOUNT);
+      last_removed = glisy_format_mul_pow5(mv, (uint32_t) (i + 1), j) % 10;
+    }
+    if (q <= 1) {
+      vr_trailing_zeros = 1;
+      if (accept_bounds) {
+        vm_trailing_zeros = mm_shift == 1;
+      } else {
+        --vp;
+      }
+    } else if (q < 31) {
+      vr_trailing_zeros = 0 == (mv & ((1u << (q - 1)) - 1));
+    }
+  }
+
+  // drop digits while the interval still holds a shorter number
+  int32_t removed = 0;
+  if (vm_trailing_zeros || vr_trailing_zeros) {
+    while (vp / 10 > vm / 10) {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed == 0;
+      last_removed = vr % 10;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vm_trailing_zeros) {
+      while (vm % 10 == 0) {
+        vr_trailing_zeros &= last_removed == 0;
+        last_removed = vr % 10;
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+      last_removed = 4;
+    }
+    *digits = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+                    last_removed >= 5);
+  } else {
+    while (vp / 10 > vm / 10) {
+      last_removed = vr % 10;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    *digits = vr + (vr == vm || last_removed >= 5);
+  }
+  *exponent = e10 + removed;
+}
+
+/**
+ * Writes the shortest round trip text of float f to buf, which must
+ * have room for GLISY_FORMAT_FLOAT_MAX characters, and returns the
+ * number written. No NUL is written.
+ */
+
+static inline size_t
+glisy_format_float (char *buf, float f) {
+  uint32_t bits;
+  char digits[10];
+  char *p = buf;
+  memcpy(&bits, &f, sizeof(bits));
+  uint32_t mantissa = bits & ((1u << 23) - 1);
+  uint32_t exponent = (bits >> 23) & 0xff;
+
+  if (0xff == exponent && mantissa) {
+    memcpy(p, "nan", 3);
+    return 3;
+  }
+  if (bits >> 31) *p++ = '-';
+  if (0xff == exponent) {
+    memcpy(p, "inf", 3);
+    return (size_t) (p - buf) + 3;
+  }
+  if (0 == exponent && 0 == mantissa) {
+    *p++ = '0';
+    return (size_t) (p - buf);
+  }
+
+  uint32_t value;
+  int32_t e10;
+  int n = 0;
+  glisy_format_shortest(mantissa, exponent, &value, &e10);
+  for (; value; value /= 10) digits[9 - n++] = (char) ('0' + value % 10);
+  const char *d = digits + 10 - n;
+
+  // decimal exponent of the leading digit
+  int32_t x = e10 + n - 1;
+  if (x >= -4 && x < 9) {
+    if (x < 0) {
+      *p++ = '0';
+      *p++ = '.';
+      for (int32_t z = -1; z > x; --z) *p++ = '0';
+      memcpy(p, d, n);
+      p += n;
+    } else if (n <= x + 1) {
+      memcpy(p, d, n);
+      p += n;
+      for (int32_t z = n; z <= x; ++z) *p++ = '0';
+    } else {
+      memcpy(p, d, x + 1);
+      p += x + 1;
+      *p++ = '.';
+      memcpy(p, d + x + 1, n - x - 1);
+      p += n - x - 1;
+    }
+  } else {
+    *p++ = d[0];
+    if (n > 1) {
+      *p++ = '.';
+      memcpy(p, d + 1, n - 1);
+      p += n - 1;
+    }
+    *p++ = 'e';
+    *p++ = x < 0 ? '-' : '+';
+    if (x < 0) x = -x;
+    *p++ = (char) ('0' + x / 10);
+    *p++ = (char) ('0' + x % 10);
+  }
+  return (size_t) (p - buf);
+}
+
+/**
+ * glisy_writer struct type. Appends text to buf with snprintf
+ * semantics: len counts every byte appended, and only what fits in
+ * size - 1 bytes is stored.
+ */
+
+typedef struct glisy_writer glisy_writer;
+struct glisy_writer {
+  char *buf;
+  size_t size;
+  size_t len;
+};
+
+static inline void
+glisy_writer_text (glisy_writer *w, const char *s, size_t n) {
+  if (w->len + n < w->size) {
+    memcpy(w->buf + w->len, s, n);
+  } else if (w->len + 1 < w->size) {
+    memcpy(w->buf + w->len, s, w->size - 1 - w->len);
+  }
+  w->len += n;
+}
+
+static inline void
+glisy_writer_float (glisy_writer *w, float f) {
+  if (w->len + GLISY_FORMAT_FLOAT_MAX < w->size) {
+    w->len += glisy_format_float(w->buf + w->len, f);
+  } else {
+    char tmp[GLISY_FORMAT_FLOAT_MAX];
+    glisy_writer_text(w, tmp, glisy_format_float(tmp, f));
+  }
+}
+
+/**
+ * NUL terminates the text of w and returns its full length.
+ */
+
+static inline size_t
+glisy_writer_end (glisy_writer *w) {
+  if (w->size) w->buf[w->len < w->size ? w->len : w->size - 1] = 0;
+  return w->len;
+}
+
+/**
+ * Appends count floats as "name(a, b, ...)", breaking the line
+ * after every columns values and indenting continuation lines
+ * under the first value.
+ */
+
+static inline void
+glisy_writer_floats (glisy_writer *w, const char *name,
+                     const float *v, int count, int columns) {
+  static const char spaces[] = "                ";
+  size_t indent = strlen(name) + 1;
+  glisy_writer_text(w, name, indent - 1);
+  if (indent > sizeof(spaces) - 1) indent = sizeof(spaces) - 1;
+  glisy_writer_text(w, "(", 1);
+  for (int i = 0; i < count; ++i) {
+    if (i && i % columns == 0) {
+      glisy_writer_text(w, ",\n", 2);
+      glisy_writer_text(w, spaces, indent);
+    } else if (i) {
+      glisy_writer_text(w, ", ", 2);
+    }
+    glisy_writer_float(w, v[i]);
+  }
+  glisy_writer_text(w, ")", 1);
+}
+
+/**
+ * Formats count floats like glisy_writer_floats into buf of size
+ * bytes, NUL terminated, and returns the length of the whole text;
+ * it was truncated when that is size or more, like snprintf.
+ */
+
+static inline size_t
+glisy_format_floats (char *buf, size_t size, const char *name,
+                     const float *v, int count, int columns) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_floats(&w, name, v, count, columns);
+  return glisy_writer_end(&w);
+}
+
+/**
+ * glisy_arena struct type. Caller owned memory that formatted
+ * strings are packed into back to back. Reset it to reuse the
+ * memory, for example once per frame.
+ */
+
+typedef struct glisy_arena glisy_arena;
+struct glisy_arena {
+  char *data;
+  size_t size;
+  size_t used;
+};
+
+#define glisy_arena(data, size) ((glisy_arena) {(data), (size), 0})
+#define glisy_arena_reset(a) ((a).used = 0)
+
+static inline char *
+glisy_arena_cursor (const glisy_arena *a) {
+  return a->data + a->used;
+}
+
+static inline size_t
+glisy_arena_room (const glisy_arena *a) {
+  return a->size - a->used;
+}
+
+/**
+ * Keeps the len bytes and NUL just formatted at the cursor of
+ * arena a and returns them, or returns NULL and keeps nothing
+ * when they did not fit.
+ */
+
+static inline const char *
+glisy_arena_push (glisy_arena *a, size_t len) {
+  char *s = a->data + a->used;
+  if (len >= a->size - a->used) return NULL;
+  a->used += len + 1;
+  return s;
+}
+
+/**
+ * Arena formatters. Each type header defines
+ * glisy_arena_format_<type> after its glisy_<type>_format, which
+ * formats value into arena a and returns the string, or NULL when
+ * a is full.
+ */
+
+#define GLISY_ARENA_FORMAT(type)                                       \
+  static inline const char *                                           \
+  glisy_arena_format_##type (glisy_arena *a, type value) {             \
+    return glisy_arena_push(a, glisy_##type##_format(                  \
+      glisy_arena_cursor(a), glisy_arena_room(a), value));             \
+  }
+
+#define glisy_arena_format(a, type, value) \
+  glisy_arena_format_##type(&(a), (value))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,467 @@
+#ifndef GLISY_FRUSTUM_H
+#define GLISY_FRUSTUM_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/mat4.h>
+#include <glisy/bounds.h>
+#include <glisy/parallel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * frustum struct type. Six planes facing inwards, in the order of
+ * the GLISY_FRUSTUM_* indices, so a point is inside when it is in
+ * front of all of them.
+ */
+
+#define GLISY_FRUSTUM_LEFT 0
+#define GLISY_FRUSTUM_RIGHT 1
+#define GLISY_FRUSTUM_BOTTOM 2
+#define GLISY_FRUSTUM_TOP 3
+#define GLISY_FRUSTUM_NEAR 4
+#define GLISY_FRUSTUM_FAR 5
+
+typedef struct frustum frustum;
+struct frustum {
+  plane planes[6];
+};
+
+/**
+ * Extracts the frustum of mat4 a, usually a projection such as
+ * mat4_perspective or mat4_ortho times a view such as mat4_lookAt,
+ * and returns it in the space a transforms from. Planes are taken
+ * from the rows of a against the -w <= x, y, z <= w clip volume and
+ * normalized, so plane distances are true distances.
+ */
+
+static inline void
+glisy_frustum_from_mat4_into (frustum *out, const mat4 *a) {
+  const float w[4] = {a->m14, a->m24, a->m34, a->m44};
+  const float r[3][4] = {{a->m11, a->m21, a->m31, a->m41},
+                         {a->m12, a->m22, a->m32, a->m42},
+                         {a->m13, a->m23, a->m33, a->m43}};
+  for (int p = 0; p < 6; ++p) {
+    float s = p & 1 ? -1 : 1;
+    const float *row = r[p / 2];
+    plane q = {{w[0] + s * row[0], w[1] + s * row[1], w[2] + s * row[2]},
+               w[3] + s * row[3]};
+    glisy_plane_normalize_into(&out->planes[p], &q);
+  }
+}
+
+static inline frustum
+glisy_frustum_from_mat4 (mat4 a) {
+  frustum out;
+  glisy_frustum_from_mat4_into(&out, &a);
+  return out;
+}
+
+#define frustum_from_mat4(a) glisy_frustum_from_mat4((a))
+
+/**
+ * Culling states. Visible objects have GLISY_CULL_VISIBLE set;
+ * objects fully inside the frustum also have the bit above it.
+ */
+
+#define GLISY_CULL_OUTSIDE 0
+#define GLISY_CULL_VISIBLE 1
+#define GLISY_CULL_INTERSECT GLISY_CULL_VISIBLE
+#define GLISY_CULL_INSIDE 3
+
+/**
+ * Classifies bounds centered on c that reach reach + dot(|n|, e)
+ * along each plane normal n against frustum f. When the bounds are
+ * outside and plane is not NULL, the index of a plane they are
+ * behind is stored in it.
+ */
+
+static inline int
+glisy_frustum_classify (const frustum *f, vec3 c, vec3 e, float reach,
+                        uint8_t *plane) {
+  int state = GLISY_CULL_INSIDE;
+  for (int p = 0; p < 6; ++p) {
+    vec3 n = f->planes[p].normal;
+    float d = n.x * c.x + n.y * c.y + n.z * c.z + f->planes[p].distance;
+    float r = reach + fabsf(n.x) * e.x + fabsf(n.y) * e.y +
+              fabsf(n.z) * e.z;
+    if (d + r < 0) {
+      if (plane) *plane = (uint8_t) p;
+      return GLISY_CULL_OUTSIDE;
+    }
+    if (d - r < 0) state = GLISY_CULL_INTERSECT;
+  }
+  return state;
+}
+
+/**
+ * Returns the GLISY_CULL_* state of sphere or aabb a in frustum f.
+ */
+
+static inline int
+glisy_frustum_classify_sphere (const frustum *f, sphere a) {
+  return glisy_frustum_classify(f, a.center, (vec3) {0, 0, 0}, a.radius,
+                                NULL);
+}
+
+#define frustum_classify_sphere(f, a) \
+  glisy_frustum_classify_sphere(&(f), (a))
+
+static inline int
+glisy_frustum_classify_aabb (const frustum *f, aabb a) {
+  return glisy_frustum_classify(f, glisy_aabb_center(a),
+                                glisy_aabb_extents(a), 0, NULL);
+}
+
+#define frustum_classify_aabb(f, a) glisy_frustum_classify_aabb(&(f), (a))
+
+/**
+ * frustum_cull struct type. The result of culling a batch of
+ * bounds: the GLISY_CULL_* state of each of the count objects and
+ * the ascending indices of the visible_count visible ones. plane
+ * holds, per object, the last plane that rejected it, which
+ * GLISY_FRUSTUM_COHERENT tests first on the next call; it survives
+ * between calls as long as objects keep their indices. chunks is
+ * scratch for compacting visible across threads.
+ */
+
+typedef struct frustum_cull frustum_cull;
+struct frustum_cull {
+  uint8_t *state;
+  uint8_t *plane;
+  uint32_t *visible;
+  uint32_t *chunks;
+  size_t visible_count;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * glisy_frustum_cull_* flags. GLISY_FRUSTUM_COHERENT first tests
+ * each group of objects against the plane that last rejected its
+ * first object, and skips the other planes when the whole group is
+ * still behind it. It pays off when objects that are close in
+ * memory are close in space and stay out of view across frames.
+ */
+
+#define GLISY_FRUSTUM_COHERENT 1
+
+/**
+ * frustum_cull initializer.
+ */
+
+#define frustum_cull_create() ((frustum_cull) {0})
+
+/**
+ * Releases the storage of frustum_cull c and empties it.
+ */
+
+static inline void
+glisy_frustum_cull_free (frustum_cull *c) {
+  free(c->visible);
+  *c = (frustum_cull) {0};
+}
+
+#define frustum_cull_free(c) glisy_frustum_cull_free(&(c))
+
+/**
+ * Grows frustum_cull c to hold at least capacity objects, keeping
+ * its cached planes. Returns 0 on success and -1 when allocation
+ * fails, leaving c unchanged.
+ */
+
+static inline int
+glisy_frustum_cull_reserve (frustum_cull *c, size_t capacity) {
+  if (capacity <= c->capacity) return 0;
+  if (capacity < 2 * c->capacity) capacity = 2 * c->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  size_t chunks = capacity / GLISY_PARALLEL_ALIGN;
+  size_t bytes = (capacity + chunks) * sizeof(uint32_t) + 2 * capacity;
+  uint32_t *data = (uint32_t *) glisy_simd_alloc(bytes);
+  if (!data) return -1;
+  memset(data, 0, bytes);
+  uint8_t *state = (uint8_t *) (data + capacity + chunks);
+  if (c->count) memcpy(state + capacity, c->plane, c->count);
+  free(c->visible);
+  c->visible = data;
+  c->chunks = data + capacity;
+  c->state = state;
+  c->plane = state + capacity;
+  c->visible_count = 0;
+  c->capacity = capacity;
+  return 0;
+}
+
+#define frustum_cull_reserve(c, capacity) \
+  glisy_frustum_cull_reserve(&(c), (capacity))
+
+/**
+ * State shared by the threads of a culling call. planes holds each
+ * frustum plane's normal, distance and absolute normal.
+ */
+
+typedef struct glisy_frustum_job glisy_frustum_job;
+struct glisy_frustum_job {
+  frustum_cull *out;
+  const frustum *frustum;
+  const sphere_soa *spheres;
+  const aabb_soa *aabbs;
+  size_t count;
+  int flags;
+  float planes[6][8];
+};
+
+#ifdef GLISY_SSE2
+
+/**
+ * Returns 4 bits of b spread to the low bit of each byte of a word.
+ */
+
+static inline uint32_t
+glisy_frustum_spread (uint32_t b) {
+  return (b & 1) | (b & 2) << 7 | (b & 4) << 14 | (b & 8) << 21;
+}
+
+/**
+ * Sets d to the signed distances of centers c from plane q, splat
+ * from a glisy_frustum_job row, and r to
+ * how far the bounds reach along its normal: e[0] for spheres and
+ * dot(|n|, e) for boxes.
+ */
+
+static inline void
+glisy_frustum_plane_lanes (const glisy_lane q[7], const glisy_lane c[3],
+                           const glisy_lane e[3], int box,
+                           glisy_lane *d, glisy_lane *r) {
+  *d = glisy_lane_madd(q[0], c[0], glisy_lane_madd(q[1], c[1],
+       glisy_lane_madd(q[2], c[2], q[3])));
+  *r = !box ? e[0] : glisy_lane_madd(q[4], e[0],
+       glisy_lane_madd(q[5], e[1], glisy_lane_mul(q[6], e[2])));
+}
+
+/**
+ * Culls the GLISY_LANES objects from i, centered on c with reach e
+ * as in glisy_frustum_plane_lanes. Writes their states and cached
+ * planes, appends the visible ones to visible at n and returns the
+ * new n.
+ */
+
+static inline size_t
+glisy_frustum_cull_lanes (const glisy_frustum_job *j,
+                          const glisy_lane planes[6][7], size_t i,
+                          const glisy_lane c[3], const glisy_lane e[3],
+                          int box, uint32_t *visible, size_t n) {
+  frustum_cull *out = j->out;
+  size_t left = j->count - i;
+  int all = (1 << GLISY_LANES) - 1;
+  int valid = left < GLISY_LANES ? (1 << left) - 1 : all;
+  int coherent = j->flags & GLISY_FRUSTUM_COHERENT;
+  glisy_lane zero = glisy_lane_zero();
+  glisy_lane d, r;
+
+  if (coherent) {
+    uint8_t p = out->plane[i];
+    glisy_frustum_plane_lanes(planes[p], c, e, box, &d, &r);
+    int behind = glisy_lane_movemask(glisy_lane_gt(zero,
+                                                   glisy_lane_add(d, r)));
+    if (valid == (behind & valid)) {
+      memset(out->state + i, GLISY_CULL_OUTSIDE, GLISY_LANES);
+      memset(out->plane + i, p, GLISY_LANES);
+      return n;
+    }
+  }
+
+  // planes run backwards so id ends on the first rejecting plane,
+  // as in glisy_frustum_classify
+  glisy_lane outside = zero, inside = glisy_lane_eq(zero, zero), id = zero;
+  for (int p = 5; p >= 0; --p) {
+    glisy_frustum_plane_lanes(planes[p], c, e, box, &d, &r);
+    glisy_lane behind = glisy_lane_gt(zero, glisy_lane_add(d, r));
+    if (coherent) {
+      id = glisy_lane_select(behind, glisy_lane_splat((float) p), id);
+    }
+    outside = glisy_lane_or(outside, behind);
+    inside = glisy_lane_and(inside, glisy_lane_ge(glisy_lane_sub(d, r), zero));
+  }
+
+  int rejected = glisy_lane_movemask(outside) & valid;
+  int shown = ~rejected & valid;
+  int full = glisy_lane_movemask(inside) & shown;
+  for (int v = 0; v < GLISY_LANES; v += 4) {
+    uint32_t word = glisy_frustum_spread(shown >> v & 15) |
+                    glisy_frustum_spread(full >> v & 15) << 1;
+    memcpy(out->state + i + v, &word, 4);
+  }
+  for (int v = 0; v < GLISY_LANES; ++v) {
+    visible[n] = (uint32_t) (i + v);
+    n += shown >> v & 1;
+  }
+  if (coherent && rejected) {
+    float ids[GLISY_LANES];
+    glisy_lane_store(ids, id);
+    for (int v = 0; v < GLISY_LANES; ++v) {
+      if (rejected >> v & 1) out->plane[i + v] = (uint8_t) ids[v];
+    }
+  }
+  return n;
+}
+#endif
+
+/**
+ * Culls objects [begin, end), compacting their visible indices to
+ * the start of the chunk's share of visible and recording how many
+ * there are in the chunk's first chunks entry.
+ */
+
+static inline void
+glisy_frustum_cull_fn (void *ctx, size_t begin, size_t end,
+                       unsigned worker) {
+  const glisy_frustum_job *j = (const glisy_frustum_job *) ctx;
+  frustum_cull *out = j->out;
+  uint32_t *visible = out->visible + begin;
+  size_t n = 0;
+  (void) worker;
+#ifdef GLISY_SSE2
+  glisy_lane planes[6][7];
+  for (int p = 0; p < 6; ++p) {
+    for (int k = 0; k < 7; ++k) {
+      planes[p][k] = glisy_lane_splat(j->planes[p][k]);
+    }
+  }
+  if (j->spheres) {
+    const sphere_soa *s = j->spheres;
+    for (size_t i = begin; i < end; i += GLISY_LANES) {
+      glisy_lane c[3] = {glisy_lane_load(s->x + i), glisy_lane_load(s->y + i),
+                         glisy_lane_load(s->z + i)};
+      glisy_lane e[3] = {glisy_lane_load(s->radius + i)};
+      n = glisy_frustum_cull_lanes(j, planes, i, c, e, 0, visible, n);
+    }
+  } else {
+    const aabb_soa *s = j->aabbs;
+    glisy_lane half = glisy_lane_splat(0.5f);
+    for (size_t i = begin; i < end; i += GLISY_LANES) {
+      glisy_lane lo[3] = {glisy_lane_load(s->min_x + i),
+                          glisy_lane_load(s->min_y + i),
+                          glisy_lane_load(s->min_z + i)};
+      glisy_lane hi[3] = {glisy_lane_load(s->max_x + i),
+                          glisy_lane_load(s->max_y + i),
+                          glisy_lane_load(s->max_z + i)};
+      glisy_lane c[3], e[3];
+      for (int k = 0; k < 3; ++k) {
+        c[k] = glisy_lane_mul(glisy_lane_add(hi[k], lo[k]), half);
+        e[k] = glisy_lane_mul(glisy_lane_sub(hi[k], lo[k]), half);
+      }
+      n = glisy_frustum_cull_lanes(j, planes, i, c, e, 1, visible, n);
+    }
+  }
+#else
+  int coherent = j->flags & GLISY_FRUSTUM_COHERENT;
+  for (size_t i = begin; i < end; ++i) {
+    vec3 c, e = {0, 0, 0};
+    float reach = 0;
+    if (j->spheres) {
+      sphere a = glisy_sphere_soa_get(j->spheres, i);
+      c = a.center;
+      reach = a.radius;
+    } else {
+      aabb a = glisy_aabb_soa_get(j->aabbs, i);
+      c = glisy_aabb_center(a);
+      e = glisy_aabb_extents(a);
+    }
+    if (coherent) {
+      plane q = j->frustum->planes[out->plane[i]];
+      float r = reach + fabsf(q.normal.x) * e.x + fabsf(q.normal.y) * e.y +
+                fabsf(q.normal.z) * e.z;
+      if (glisy_plane_distance(q, c) + r < 0) {
+        out->state[i] = GLISY_CULL_OUTSIDE;
+        continue;
+      }
+    }
+    int state = glisy_frustum_classify(j->frustum, c, e, reach,
+                                       coherent ? &out->plane[i] : NULL);
+    out->state[i] = (uint8_t) state;
+    visible[n] = (uint32_t) i;
+    n += state & GLISY_CULL_VISIBLE;
+  }
+#endif
+  out->chunks[begin / GLISY_PARALLEL_ALIGN] = (uint32_t) n;
+  for (size_t k = begin / GLISY_PARALLEL_ALIGN + 1;
+       k < (end + GLISY_PARALLEL_ALIGN - 1) / GLISY_PARALLEL_ALIGN; ++k) {
+    out->chunks[k] = 0;
+  }
+}
+
+/**
+ * Culls the count objects of a job on pool and joins the visible
+ * indices of its chunks.
+ */
+
+static inline int
+glisy_frustum_cull_run (glisy_pool *pool, glisy_frustum_job *j,
+                        size_t item_bytes) {
+  frustum_cull *out = j->out;
+  if (j->count > UINT32_MAX) return -1;
+  if (glisy_frustum_cull_reserve(out, j->count)) return -1;
+  for (int p = 0; p < 6; ++p) {
+    plane q = j->frustum->planes[p];
+    float row[8] = {q.normal.x, q.normal.y, q.normal.z, q.distance,
+                    fabsf(q.normal.x), fabsf(q.normal.y), fabsf(q.normal.z)};
+    memcpy(j->planes[p], row, sizeof(row));
+  }
+  out->count = j->count;
+  glisy_parallel_for(pool, j->count, item_bytes, glisy_frustum_cull_fn, j);
+
+  size_t total = 0;
+  size_t chunks = (j->count + GLISY_PARALLEL_ALIGN - 1) / GLISY_PARALLEL_ALIGN;
+  for (size_t k = 0; k < chunks; ++k) {
+    size_t n = out->chunks[k], from = k * GLISY_PARALLEL_ALIGN;
+    if (n && from != total) {
+      memmove(out->visible + total, out->visible + from, n * sizeof(uint32_t));
+    }
+    total += n;
+  }
+  out->visible_count = total;
+  return 0;
+}
+
+/**
+ * Culls the spheres or aabbs of s against frustum f into out, which
+ * is resized to match. flags is 0 or GLISY_FRUSTUM_COHERENT. Work is
+ * split over the threads of pool, which may be NULL, and the result
+ * does not depend on it. Returns 0 on success and -1 when out cannot
+ * grow or s holds more than UINT32_MAX objects.
+ */
+
+static inline int
+glisy_frustum_cull_spheres (glisy_pool *pool, frustum_cull *out,
+                            const frustum *f, const sphere_soa *s,
+                            int flags) {
+  glisy_frustum_job j = {out, f, s, NULL, s->count, flags, {{0}}};
+  return glisy_frustum_cull_run(pool, &j, 4 * sizeof(float) + 6);
+}
+
+#define frustum_cull_spheres(pool, out, f, s, flags) \
+  glisy_frustum_cull_spheres((pool), &(out), &(f), &(s), (flags))
+
+static inline int
+glisy_frustum_cull_aabbs (glisy_pool *pool, frustum_cull *out,
+                          const frustum *f, const aabb_soa *s, int flags) {
+  glisy_frustum_job j = {out, f, NULL, s, s->count, flags, {{0}}};
+  return glisy_frustum_cull_run(pool, &j, 6 * sizeof(float) + 6);
+}
+
+#define frustum_cull_aabbs(pool, out, f, s, flags) \
+  glisy_frustum_cull_aabbs((pool), &(out), &(f), &(s), (flags))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
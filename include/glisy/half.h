@@ -0,0 +1,311 @@
+#ifndef GLISY_HALF_H
+#define GLISY_HALF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <glisy/simd.h>
+#include <glisy/vec2.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * IEEE 754 binary16 conversions. Rounding is to nearest even,
+ * values too large for a half become infinity, and nan stays nan.
+ */
+
+static inline uint16_t
+glisy_half_from_float (float f) {
+  uint32_t x, sign;
+  memcpy(&x, &f, sizeof(x));
+  sign = (x >> 16) & 0x8000;
+  x &= 0x7fffffff;
+
+  if (x >= 0x7f800000) {
+    // inf, or nan with its top payload bits and the quiet bit
+    return (uint16_t) (sign | 0x7c00 |
+                       (x > 0x7f800000 ? 0x200 | ((x >> 13) & 0x3ff) : 0));
+  }
+  if (x >= 0x477ff000) return (uint16_t) (sign | 0x7c00);
+  if (x < 0x38800000) {
+    // subnormal half: adding 0.5 leaves the half mantissa in the
+    // low bits of the float, rounded to nearest even by the FPU
+    float g;
+    memcpy(&g, &x, sizeof(g));
+    g += 0.5f;
+    memcpy(&x, &g, sizeof(x));
+    return (uint16_t) (sign | (x - 0x3f000000));
+  }
+  // rebias the exponent and round the 13 dropped bits to even
+  x += 0xc8000fff + ((x >> 13) & 1);
+  return (uint16_t) (sign | (x >> 13));
+}
+
+static inline float
+glisy_half_to_float (uint16_t h) {
+  uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1f;
+  uint32_t mantissa = h & 0x3ff;
+  uint32_t x;
+  float f;
+
+  if (0 == exponent) {
+    f = (float) mantissa * 0x1p-24f;
+    memcpy(&x, &f, sizeof(x));
+    x |= sign;
+  } else if (31 == exponent) {
+    // nan comes back quiet, as F16C returns it
+    x = sign | 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+  } else {
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * SSE2 forms of the conversions, bit exact with the scalar ones.
+ * Halves sit in the low 16 bits of each 32 bit lane.
+ */
+
+static inline __m128i
+glisy_half_from_float_sse (__m128 f) {
+  __m128i x = _mm_castps_si128(f);
+  __m128i sign = _mm_and_si128(x, _mm_set1_epi32((int) 0x80000000));
+  x = _mm_xor_si128(x, sign);
+
+  __m128i nan = _mm_cmpgt_epi32(x, _mm_set1_epi32(0x7f800000));
+  __m128i payload = _mm_or_si128(_mm_set1_epi32(0x200),
+    _mm_and_si128(_mm_srli_epi32(x, 13), _mm_set1_epi32(0x3ff)));
+  __m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00),
+                                 _mm_and_si128(nan, payload));
+
+  __m128 g = _mm_add_ps(_mm_castsi128_ps(x), _mm_set1_ps(0.5f));
+  __m128i small = _mm_sub_epi32(_mm_castps_si128(g),
+                                _mm_set1_epi32(0x3f000000));
+
+  __m128i odd = _mm_and_si128(_mm_srli_epi32(x, 13), _mm_set1_epi32(1));
+  __m128i normal = _mm_add_epi32(x, _mm_set1_epi32((int) 0xc8000fff));
+  normal = _mm_srli_epi32(_mm_add_epi32(normal, odd), 13);
+
+  __m128i is_special = _mm_cmpgt_epi32(x, _mm_set1_epi32(0x477fefff));
+  __m128i is_small = _mm_cmplt_epi32(x, _mm_set1_epi32(0x38800000));
+  __m128i h = _mm_or_si128(_mm_and_si128(is_small, small),
+                           _mm_andnot_si128(is_small, normal));
+  h = _mm_or_si128(_mm_and_si128(is_special, special),
+                   _mm_andnot_si128(is_special, h));
+  return _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+}
+
+static inline __m128
+glisy_half_to_float_sse (__m128i h) {
+  const __m128i exponent = _mm_set1_epi32(0x0f800000);
+  const __m128i rebias = _mm_set1_epi32(0x38000000);
+  __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+  __m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+  __m128i e = _mm_and_si128(o, exponent);
+  o = _mm_add_epi32(o, rebias);
+
+  // inf and nan move on to exponent 255, and nan comes back quiet
+  __m128i special = _mm_cmpeq_epi32(e, exponent);
+  __m128i nan = _mm_and_si128(special, _mm_cmpgt_epi32(
+    _mm_and_si128(h, _mm_set1_epi32(0x3ff)), _mm_setzero_si128()));
+  o = _mm_add_epi32(o, _mm_and_si128(special, rebias));
+  o = _mm_or_si128(o, _mm_and_si128(nan, _mm_set1_epi32(0x400000)));
+
+  // subnormals are renormalized by a float subtraction of 2^-14
+  __m128i zero = _mm_cmpeq_epi32(e, _mm_setzero_si128());
+  __m128 small = _mm_sub_ps(
+    _mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(0x00800000))),
+    _mm_castsi128_ps(_mm_set1_epi32(0x38800000)));
+  o = _mm_or_si128(_mm_and_si128(zero, _mm_castps_si128(small)),
+                   _mm_andnot_si128(zero, o));
+  return _mm_castsi128_ps(_mm_or_si128(o, sign));
+}
+
+/**
+ * Returns the number of lanes of f that are finite but too large
+ * for a half.
+ */
+
+static inline int
+glisy_half_overflow_sse (__m128 f) {
+  __m128i x = _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0x7fffffff));
+  __m128i over = _mm_andnot_si128(
+    _mm_cmpgt_epi32(x, _mm_set1_epi32(0x7f7fffff)),
+    _mm_cmpgt_epi32(x, _mm_set1_epi32(0x477fefff)));
+  return __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(over)));
+}
+
+#endif
+
+/**
+ * Converts count floats at in to halves at out. Finite values
+ * beyond the half range, 65520 and up in magnitude, become
+ * infinity as F16C makes them; the return value counts them, so
+ * callers can check for overflow without a second pass. F16C is
+ * used when the compiler targets it, SSE2 otherwise, and the scalar
+ * conversion for the tail; all give the same bits.
+ */
+
+static inline size_t
+glisy_half_from_float_batch (uint16_t *out, const float *in, size_t count) {
+  size_t i = 0, overflow = 0;
+#if defined(GLISY_F16C)
+  for (; i < (count & ~(size_t) 7); i += 8) {
+    __m256 f = _mm256_loadu_ps(in + i);
+    __m128i h = _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT);
+    overflow += glisy_half_overflow_sse(_mm256_castps256_ps128(f)) +
+                glisy_half_overflow_sse(_mm256_extractf128_ps(f, 1));
+    _mm_storeu_si128((__m128i *) (out + i), h);
+  }
+#elif defined(GLISY_SSE2)
+  for (; i < (count & ~(size_t) 7); i += 8) {
+    __m128 a = _mm_loadu_ps(in + i), b = _mm_loadu_ps(in + i + 4);
+    // sign extend so the saturating pack keeps every bit
+    __m128i lo = _mm_srai_epi32(_mm_slli_epi32(
+      glisy_half_from_float_sse(a), 16), 16);
+    __m128i hi = _mm_srai_epi32(_mm_slli_epi32(
+      glisy_half_from_float_sse(b), 16), 16);
+    overflow += glisy_half_overflow_sse(a) + glisy_half_overflow_sse(b);
+    _mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(lo, hi));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = glisy_half_from_float(in[i]);
+    overflow += isfinite(in[i]) && 0x7c00 == (out[i] & 0x7fff);
+  }
+  return overflow;
+}
+
+/**
+ * Converts count halves at in to floats at out. Every half is
+ * exact as a float, so this cannot fail.
+ */
+
+static inline void
+glisy_half_to_float_batch (float *out, const uint16_t *in, size_t count) {
+  size_t i = 0;
+#if defined(GLISY_F16C)
+  for (; i < (count & ~(size_t) 7); i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *) (in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+#elif defined(GLISY_SSE2)
+  for (; i < (count & ~(size_t) 7); i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i *) (in + i));
+    __m128i zero = _mm_setzero_si128();
+    _mm_storeu_ps(out + i,
+                  glisy_half_to_float_sse(_mm_unpacklo_epi16(h, zero)));
+    _mm_storeu_ps(out + i + 4,
+                  glisy_half_to_float_sse(_mm_unpackhi_epi16(h, zero)));
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_half_to_float(in[i]);
+}
+
+/**
+ * Half precision storage types. They are for holding and moving
+ * data, not arithmetic: encode from and decode to vec2, vec3 and
+ * vec4, singly or in bulk.
+ */
+
+typedef struct hvec2 hvec2;
+struct hvec2 { uint16_t x; uint16_t y; };
+
+typedef struct hvec3 hvec3;
+struct hvec3 { uint16_t x; uint16_t y; uint16_t z; };
+
+typedef struct hvec4 hvec4;
+struct hvec4 { uint16_t x; uint16_t y; uint16_t z; uint16_t w; };
+
+static inline hvec2
+glisy_hvec2_encode (vec2 v) {
+  hvec2 h = {glisy_half_from_float(v.x), glisy_half_from_float(v.y)};
+  return h;
+}
+
+static inline vec2
+glisy_hvec2_decode (hvec2 h) {
+  return vec2(glisy_half_to_float(h.x), glisy_half_to_float(h.y));
+}
+
+static inline hvec3
+glisy_hvec3_encode (vec3 v) {
+  hvec3 h = {glisy_half_from_float(v.x), glisy_half_from_float(v.y),
+             glisy_half_from_float(v.z)};
+  return h;
+}
+
+static inline vec3
+glisy_hvec3_decode (hvec3 h) {
+  return vec3(glisy_half_to_float(h.x), glisy_half_to_float(h.y),
+              glisy_half_to_float(h.z));
+}
+
+static inline hvec4
+glisy_hvec4_encode (vec4 v) {
+  hvec4 h = {glisy_half_from_float(v.x), glisy_half_from_float(v.y),
+             glisy_half_from_float(v.z), glisy_half_from_float(v.w)};
+  return h;
+}
+
+static inline vec4
+glisy_hvec4_decode (hvec4 h) {
+  return vec4(glisy_half_to_float(h.x), glisy_half_to_float(h.y),
+              glisy_half_to_float(h.z), glisy_half_to_float(h.w));
+}
+
+#define hvec2_encode(v) glisy_hvec2_encode((v))
+#define hvec2_decode(h) glisy_hvec2_decode((h))
+#define hvec3_encode(v) glisy_hvec3_encode((v))
+#define hvec3_decode(h) glisy_hvec3_decode((h))
+#define hvec4_encode(v) glisy_hvec4_encode((v))
+#define hvec4_decode(h) glisy_hvec4_decode((h))
+
+/**
+ * Bulk forms over count vectors, which are packed so each runs as
+ * one conversion of the flat components. The encoders return the
+ * number of components that overflowed to infinity.
+ */
+
+static inline size_t
+glisy_hvec2_encode_batch (hvec2 *out, const vec2 *in, size_t count) {
+  return glisy_half_from_float_batch(&out->x, &in->x, 2 * count);
+}
+
+static inline void
+glisy_hvec2_decode_batch (vec2 *out, const hvec2 *in, size_t count) {
+  glisy_half_to_float_batch(&out->x, &in->x, 2 * count);
+}
+
+static inline size_t
+glisy_hvec3_encode_batch (hvec3 *out, const vec3 *in, size_t count) {
+  return glisy_half_from_float_batch(&out->x, &in->x, 3 * count);
+}
+
+static inline void
+glisy_hvec3_decode_batch (vec3 *out, const hvec3 *in, size_t count) {
+  glisy_half_to_float_batch(&out->x, &in->x, 3 * count);
+}
+
+static inline size_t
+glisy_hvec4_encode_batch (hvec4 *out, const vec4 *in, size_t count) {
+  return glisy_half_from_float_batch(&out->x, &in->x, 4 * count);
+}
+
+static inline void
+glisy_hvec4_decode_batch (vec4 *out, const hvec4 *in, size_t count) {
+  glisy_half_to_float_batch(&out->x, &in->x, 4 * count);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
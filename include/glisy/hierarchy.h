@@ -0,0 +1,412 @@
+#ifndef GLISY_HIERARCHY_H
+#define GLISY_HIERARCHY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/mat4.h>
+#include <glisy/parallel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Work done by the last hierarchy update: nodes whose flags were
+ * checked and nodes whose world matrix was recomputed, plus running
+ * totals over every update.
+ */
+
+typedef struct hierarchy_counters hierarchy_counters;
+struct hierarchy_counters {
+  size_t visited;
+  size_t recomputed;
+  size_t total_visited;
+  size_t total_recomputed;
+  size_t updates;
+};
+
+/**
+ * hierarchy struct type. A flattened transform tree of count nodes
+ * stored as parallel arrays. Nodes are appended with their parent
+ * already present, so parent[i] < i and one forward pass sees every
+ * parent before its children. Roots have parent -1.
+ *
+ * Setting a local matrix raises its dirty flag and bumps version[i].
+ * An update recomputes world = parent world * local only for dirty
+ * nodes and their descendants, bumps world_version[i] for each and
+ * stamps it with the update's epoch, which is how children see that
+ * their parent moved without clearing any per node state.
+ *
+ * All arrays share one allocation aligned to GLISY_SIMD_ALIGN.
+ */
+
+typedef struct hierarchy hierarchy;
+struct hierarchy {
+  mat4 *local;
+  mat4 *world;
+  int32_t *parent;
+  uint32_t *depth;
+  uint32_t *version;
+  uint32_t *world_version;
+  uint32_t *epoch;
+  uint8_t *dirty;
+  uint32_t *pending;
+  uint32_t *order;
+  uint32_t *levels;
+  size_t pending_count;
+  size_t level_count;
+  size_t level_nodes;
+  uint32_t current_epoch;
+  size_t count;
+  size_t capacity;
+  hierarchy_counters counters;
+};
+
+/**
+ * hierarchy initializer.
+ */
+
+#define hierarchy_create() ((hierarchy) {0})
+
+/**
+ * Releases the storage of hierarchy h and empties it.
+ */
+
+static inline void
+glisy_hierarchy_free (hierarchy *h) {
+  free(h->local);
+  *h = (hierarchy) {0};
+}
+
+#define hierarchy_free(h) glisy_hierarchy_free(&(h))
+
+/**
+ * Bytes of an array of n elements of size bytes, rounded up so the
+ * next array starts on a GLISY_SIMD_ALIGN boundary.
+ */
+
+static inline size_t
+glisy_hierarchy_span (size_t n, size_t size) {
+  return (n * size + GLISY_SIMD_ALIGN - 1) & ~(size_t) (GLISY_SIMD_ALIGN - 1);
+}
+
+/**
+ * Grows hierarchy h to hold at least capacity nodes. Returns 0 on
+ * success and -1 when allocation fails, leaving h unchanged.
+ */
+
+static inline int
+glisy_hierarchy_reserve (hierarchy *h, size_t capacity) {
+  if (capacity <= h->capacity) return 0;
+  if (capacity < 2 * h->capacity) capacity = 2 * h->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  size_t m = glisy_hierarchy_span(capacity, sizeof(mat4));
+  size_t u = glisy_hierarchy_span(capacity, sizeof(uint32_t));
+  size_t b = glisy_hierarchy_span(capacity, sizeof(uint8_t));
+  size_t l = glisy_hierarchy_span(capacity + 1, sizeof(uint32_t));
+  char *data = (char *) glisy_simd_alloc(2 * m + 7 * u + b + l);
+  if (!data) return -1;
+
+  hierarchy g = *h;
+  g.local = (mat4 *) data;
+  g.world = (mat4 *) (data + m);
+  g.parent = (int32_t *) (data + 2 * m);
+  g.depth = (uint32_t *) (data + 2 * m + u);
+  g.version = (uint32_t *) (data + 2 * m + 2 * u);
+  g.world_version = (uint32_t *) (data + 2 * m + 3 * u);
+  g.epoch = (uint32_t *) (data + 2 * m + 4 * u);
+  g.pending = (uint32_t *) (data + 2 * m + 5 * u);
+  g.order = (uint32_t *) (data + 2 * m + 6 * u);
+  g.dirty = (uint8_t *) (data + 2 * m + 7 * u);
+  g.levels = (uint32_t *) (data + 2 * m + 7 * u + b);
+  g.capacity = capacity;
+  g.level_nodes = 0;
+
+  if (h->count) {
+    size_t n = h->count;
+    memcpy(g.local, h->local, n * sizeof(mat4));
+    memcpy(g.world, h->world, n * sizeof(mat4));
+    memcpy(g.parent, h->parent, n * sizeof(int32_t));
+    memcpy(g.depth, h->depth, n * sizeof(uint32_t));
+    memcpy(g.version, h->version, n * sizeof(uint32_t));
+    memcpy(g.world_version, h->world_version, n * sizeof(uint32_t));
+    memcpy(g.epoch, h->epoch, n * sizeof(uint32_t));
+    memcpy(g.dirty, h->dirty, n * sizeof(uint8_t));
+    memcpy(g.pending, h->pending, h->pending_count * sizeof(uint32_t));
+  }
+  free(h->local);
+  *h = g;
+  return 0;
+}
+
+#define hierarchy_reserve(h, capacity) \
+  glisy_hierarchy_reserve(&(h), (capacity))
+
+/**
+ * Marks node i of hierarchy h dirty after its local matrix was
+ * written in place.
+ */
+
+static inline void
+glisy_hierarchy_mark_dirty (hierarchy *h, size_t i) {
+  h->version[i]++;
+  if (!h->dirty[i]) {
+    h->dirty[i] = 1;
+    h->pending[h->pending_count++] = (uint32_t) i;
+  }
+}
+
+#define hierarchy_mark_dirty(h, i) glisy_hierarchy_mark_dirty(&(h), (i))
+
+/**
+ * Sets the local matrix of node i of hierarchy h and marks it
+ * dirty.
+ */
+
+static inline void
+glisy_hierarchy_set_local (hierarchy *h, size_t i, mat4 local) {
+  h->local[i] = local;
+  glisy_hierarchy_mark_dirty(h, i);
+}
+
+#define hierarchy_set_local(h, i, local) \
+  glisy_hierarchy_set_local(&(h), (i), (local))
+
+/**
+ * Appends a node with local matrix local under node parent, or as
+ * a root when parent is -1, to hierarchy h. Returns the new node's
+ * index, or -1 when parent is not an existing node or allocation
+ * fails. The node is dirty until the next update.
+ */
+
+static inline int32_t
+glisy_hierarchy_add (hierarchy *h, int32_t parent, mat4 local) {
+  if (parent < -1 || parent >= (int64_t) h->count) return -1;
+  if (h->count >= INT32_MAX) return -1;
+  if (glisy_hierarchy_reserve(h, h->count + 1)) return -1;
+  size_t i = h->count++;
+  h->local[i] = local;
+  h->world[i] = local;
+  h->parent[i] = parent;
+  h->depth[i] = parent < 0 ? 0 : h->depth[parent] + 1;
+  h->version[i] = 0;
+  h->world_version[i] = 0;
+  h->epoch[i] = 0;
+  h->dirty[i] = 0;
+  glisy_hierarchy_mark_dirty(h, i);
+  return (int32_t) i;
+}
+
+#define hierarchy_add(h, parent, local) \
+  glisy_hierarchy_add(&(h), (parent), (local))
+
+/**
+ * Recomputes the world matrix of node i when it is dirty or its
+ * parent was recomputed in epoch e. Returns 1 when it did.
+ */
+
+static inline int
+glisy_hierarchy_visit (hierarchy *h, size_t i, uint32_t e) {
+  int32_t p = h->parent[i];
+  if (!h->dirty[i] && (p < 0 || h->epoch[p] != e)) return 0;
+  if (p < 0) {
+    h->world[i] = h->local[i];
+  } else {
+    glisy_mat4_multiply_into(&h->world[i], &h->world[p], &h->local[i]);
+  }
+  h->epoch[i] = e;
+  h->world_version[i]++;
+  h->dirty[i] = 0;
+  return 1;
+}
+
+/**
+ * Starts an update of hierarchy h. Returns the first node that can
+ * change, or h->count when nothing is dirty. Nodes before the
+ * smallest pending index have no dirty ancestor since every parent
+ * precedes its children.
+ */
+
+static inline size_t
+glisy_hierarchy_begin (hierarchy *h) {
+  size_t start = h->count;
+  for (size_t k = 0; k < h->pending_count; ++k) {
+    if (h->pending[k] < start) start = h->pending[k];
+  }
+  h->pending_count = 0;
+  h->current_epoch++;
+  h->counters.visited = 0;
+  h->counters.recomputed = 0;
+  h->counters.updates++;
+  return start;
+}
+
+static inline void
+glisy_hierarchy_end (hierarchy *h, size_t visited, size_t recomputed) {
+  h->counters.visited = visited;
+  h->counters.recomputed = recomputed;
+  h->counters.total_visited += visited;
+  h->counters.total_recomputed += recomputed;
+}
+
+/**
+ * Brings every world matrix of hierarchy h up to date in one
+ * forward pass from the first dirty node. Clean subtrees cost one
+ * flag check per node and no matrix work; with nothing dirty the
+ * update returns immediately.
+ */
+
+static inline void
+glisy_hierarchy_update (hierarchy *h) {
+  size_t start = glisy_hierarchy_begin(h);
+  size_t recomputed = 0;
+  uint32_t e = h->current_epoch;
+  for (size_t i = start; i < h->count; ++i) {
+    recomputed += glisy_hierarchy_visit(h, i, e);
+  }
+  glisy_hierarchy_end(h, h->count - start, recomputed);
+}
+
+#define hierarchy_update(h) glisy_hierarchy_update(&(h))
+
+/**
+ * Recomputes every world matrix of hierarchy h, dirty or not.
+ */
+
+static inline void
+glisy_hierarchy_update_all (hierarchy *h) {
+  for (size_t i = 0; i < h->count; ++i) {
+    h->dirty[i] = 1;
+  }
+  h->pending_count = 0;
+  if (h->count) h->pending[h->pending_count++] = 0;
+  glisy_hierarchy_update(h);
+}
+
+#define hierarchy_update_all(h) glisy_hierarchy_update_all(&(h))
+
+/**
+ * Groups the nodes of hierarchy h by depth: order lists node
+ * indices level by level, ascending within a level, and level d
+ * spans order[levels[d]] up to order[levels[d + 1]]. Rebuilt only
+ * after nodes were added.
+ */
+
+static inline void
+glisy_hierarchy_build_levels (hierarchy *h) {
+  if (h->level_nodes == h->count) return;
+  size_t depth = 0;
+  for (size_t i = 0; i < h->count; ++i) {
+    if (h->depth[i] + 1 > depth) depth = h->depth[i] + 1;
+  }
+  memset(h->levels, 0, (depth + 1) * sizeof(uint32_t));
+  for (size_t i = 0; i < h->count; ++i) {
+    h->levels[h->depth[i] + 1]++;
+  }
+  for (size_t d = 0; d < depth; ++d) {
+    h->levels[d + 1] += h->levels[d];
+  }
+  for (size_t i = 0; i < h->count; ++i) {
+    h->order[h->levels[h->depth[i]]++] = (uint32_t) i;
+  }
+  for (size_t d = depth; d > 0; --d) {
+    h->levels[d] = h->levels[d - 1];
+  }
+  h->levels[0] = 0;
+  h->level_count = depth;
+  h->level_nodes = h->count;
+}
+
+/**
+ * Below this many nodes from the first dirty one to the end,
+ * glisy_hierarchy_update_parallel runs the serial update, which
+ * beats waking threads.
+ */
+
+#ifndef GLISY_HIERARCHY_PARALLEL_MIN
+#define GLISY_HIERARCHY_PARALLEL_MIN 16384
+#endif
+
+#ifndef GLISY_NO_THREADS
+
+/**
+ * One parallel update: the level being walked, its first node at
+ * or after start and how many nodes the chunks recomputed.
+ */
+
+typedef struct glisy_hierarchy_job glisy_hierarchy_job;
+struct glisy_hierarchy_job {
+  hierarchy *h;
+  size_t first;
+  atomic_size_t recomputed;
+};
+
+static inline void
+glisy_hierarchy_level_fn (void *ctx, size_t begin, size_t end,
+                          unsigned worker) {
+  glisy_hierarchy_job *j = (glisy_hierarchy_job *) ctx;
+  hierarchy *h = j->h;
+  uint32_t e = h->current_epoch;
+  size_t recomputed = 0;
+  (void) worker;
+  for (size_t k = j->first + begin; k < j->first + end; ++k) {
+    recomputed += glisy_hierarchy_visit(h, h->order[k], e);
+  }
+  atomic_fetch_add_explicit(&j->recomputed, recomputed,
+                            memory_order_relaxed);
+}
+#endif
+
+/**
+ * Like glisy_hierarchy_update, splitting each depth level across
+ * the threads of pool. Nodes of one level only read the world
+ * matrices of the level above, so levels run one after another and
+ * the nodes within one are split into chunks. Nodes before the
+ * first dirty one are skipped without touching them. Small updates,
+ * a NULL or single thread pool and GLISY_NO_THREADS builds run the
+ * serial update.
+ */
+
+static inline void
+glisy_hierarchy_update_parallel (glisy_pool *pool, hierarchy *h) {
+#ifndef GLISY_NO_THREADS
+  size_t start = h->count;
+  for (size_t k = 0; k < h->pending_count; ++k) {
+    if (h->pending[k] < start) start = h->pending[k];
+  }
+  if (pool && pool->threads > 1 &&
+      h->count - start >= GLISY_HIERARCHY_PARALLEL_MIN) {
+    glisy_hierarchy_job job = {h, 0, 0};
+    glisy_hierarchy_build_levels(h);
+    start = glisy_hierarchy_begin(h);
+    for (size_t d = 0; d < h->level_count; ++d) {
+      size_t lo = h->levels[d], hi = h->levels[d + 1];
+      while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (h->order[mid] < start) lo = mid + 1;
+        else hi = mid;
+      }
+      job.first = lo;
+      glisy_parallel_for(pool, h->levels[d + 1] - lo, 3 * sizeof(mat4),
+                         glisy_hierarchy_level_fn, &job);
+    }
+    glisy_hierarchy_end(h, h->count - start, atomic_load(&job.recomputed));
+    return;
+  }
+#else
+  (void) pool;
+#endif
+  glisy_hierarchy_update(h);
+}
+
+#define hierarchy_update_parallel(pool, h) \
+  glisy_hierarchy_update_parallel((pool), &(h))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
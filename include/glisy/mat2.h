@@ -1,9 +1,12 @@
 #ifndef GLISY_MAT2_H
 #define GLISY_MAT2_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
 
 /**
  * mat2 struct type.
@@ -15,6 +18,17 @@ struct mat2 {
   float m21; float m22;
 };
 
+/**
+ * Types used by mat2 routines. Included after the
+ * mat2 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/vec2.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * mat2 initializers.
  */
@@ -26,161 +40,288 @@ struct mat2 {
  * Clones and returns mat2 a.
  */
 
-#define mat2_clone(a) ((mat2){ (a).m11, (a).m12, (a).m21, (a).m22})
+static inline mat2
+glisy_mat2_clone (mat2 a) {
+  return (mat2) {a.m11, a.m12, a.m21, a.m22};
+}
+
+#define mat2_clone(a) glisy_mat2_clone((a))
 
 /**
  * Copies mat2 b into mat2 a.
  */
 
-#define mat2_copy(a, b) ({                \
-  mat2 *tmp = (mat2 *) &a;                \
-  (tmp->m11 = b.m11), (tmp->m12 = b.m12); \
-  (tmp->m21 = b.m21), (tmp->m22 = b.m22); \
-  (*tmp);                                 \
-})
+static inline mat2
+glisy_mat2_copy (mat2 *a, mat2 b) {
+  a->m11 = b.m11; a->m12 = b.m12;
+  a->m21 = b.m21; a->m22 = b.m22;
+  return *a;
+}
+
+#define mat2_copy(a, b) glisy_mat2_copy(&(a), (b))
 
 /**
  * Sets an identity for mat2 a.
  */
 
-#define mat2_identity(a) ({        \
-  mat2 *tmp = (mat2 *) &a;         \
-  (tmp->m11 = 1), (tmp->m12 = 0);  \
-  (tmp->m21 = 0), (tmp->m22 = 1);  \
-  (*tmp);                          \
-})
+static inline mat2
+glisy_mat2_identity (mat2 *a) {
+  a->m11 = 1; a->m12 = 0;
+  a->m21 = 0; a->m22 = 1;
+  return *a;
+}
+
+#define mat2_identity(a) glisy_mat2_identity(&(a))
 
 /**
  * Transposes mat2 a.
  */
 
-#define mat2_transpose(a) ((mat2){ (a).m11, (a).m21, (a).m12, (a).m22 })
+static inline void
+glisy_mat2_transpose_into (mat2 *out, const mat2 *a) {
+  *out = (mat2) {a->m11, a->m21, a->m12, a->m22};
+}
+
+static inline mat2
+glisy_mat2_transpose (mat2 a) {
+  mat2 out;
+  glisy_mat2_transpose_into(&out, &a);
+  return out;
+}
+
+#define mat2_transpose(a) glisy_mat2_transpose((a))
 
 /**
  * Calculates and returns inverse for mat2 a.
  */
 
-#define mat2_invert(a) ({                 \
-  mat2 b;                                 \
-  float det = (                           \
-    (a).m11 * (a).m22 - (a).m21 * (a).m12 \
-  );                                      \
-  if (!det) {                             \
-    (b.m11 = 0);                          \
-    (b.m12 = 0);                          \
-    (b.m21 = 0);                          \
-    (b.m22 = 0);                          \
-  } else {                                \
-    det = (1.0/det);                      \
-    b.m11 = det * a.m22;                  \
-    b.m12 = det * -a.m12;                 \
-    b.m21 = det * -a.m21;                 \
-    b.m22 = det * a.m11;                  \
-  }                                       \
-  (b);                                    \
-})
+static inline void
+glisy_mat2_invert_into (mat2 *out, const mat2 *a) {
+  mat2 b = {0, 0, 0, 0};
+  float det = a->m11 * a->m22 - a->m21 * a->m12;
+  if (det) {
+    det = 1.0f / det;
+    b.m11 = det * a->m22;
+    b.m12 = det * -a->m12;
+    b.m21 = det * -a->m21;
+    b.m22 = det * a->m11;
+  }
+  *out = b;
+}
+
+static inline mat2
+glisy_mat2_invert (mat2 a) {
+  mat2 out;
+  glisy_mat2_invert_into(&out, &a);
+  return out;
+}
+
+#define mat2_invert(a) glisy_mat2_invert((a))
 
 /**
  * Calculates adjugate of mat2 a.
  */
 
-#define mat2_adjoint(a) ((mat2){ (a).m22, -(a).m12, -(a).m21, (a).m11 })
+static inline void
+glisy_mat2_adjoint_into (mat2 *out, const mat2 *a) {
+  *out = (mat2) {a->m22, -a->m12, -a->m21, a->m11};
+}
+
+static inline mat2
+glisy_mat2_adjoint (mat2 a) {
+  mat2 out;
+  glisy_mat2_adjoint_into(&out, &a);
+  return out;
+}
+
+#define mat2_adjoint(a) glisy_mat2_adjoint((a))
 
 /**
  * Calculates determinant of mat2 a.
  */
 
-#define mat2_determinant(a) (float) ((a).m11 * (a).m22 - (a).m21 * (a).m12)
+static inline float
+glisy_mat2_determinant (mat2 a) {
+  return a.m11 * a.m22 - a.m21 * a.m12;
+}
+
+#define mat2_determinant(a) glisy_mat2_determinant((a))
 
 /**
  * Add mat2 a and mat2 b.
  */
 
-#define mat2_add(a, b) ((mat2){         \
-  (a).m11 + (b).m11, (a).m12 + (b).m12, \
-  (a).m21 + (b).m21, (b).m22 + (b).m22  \
-})
+static inline void
+glisy_mat2_add_into (mat2 *out, const mat2 *a, const mat2 *b) {
+  *out = (mat2) {
+    a->m11 + b->m11, a->m12 + b->m12,
+    a->m21 + b->m21, a->m22 + b->m22
+  };
+}
+
+static inline mat2
+glisy_mat2_add (mat2 a, mat2 b) {
+  mat2 out;
+  glisy_mat2_add_into(&out, &a, &b);
+  return out;
+}
+
+#define mat2_add(a, b) glisy_mat2_add((a), (b))
 
 /**
  * Subtract mat2 b from mat2 a.
  */
 
-#define mat2_subtract(a, b) ((mat2){     \
-  (a).m11 - (b).m11, (a).m12 - (b).m12,  \
-  (a).m21 - (b).m21, (b).m22 - (b).m22   \
-})
+static inline void
+glisy_mat2_subtract_into (mat2 *out, const mat2 *a, const mat2 *b) {
+  *out = (mat2) {
+    a->m11 - b->m11, a->m12 - b->m12,
+    a->m21 - b->m21, a->m22 - b->m22
+  };
+}
+
+static inline mat2
+glisy_mat2_subtract (mat2 a, mat2 b) {
+  mat2 out;
+  glisy_mat2_subtract_into(&out, &a, &b);
+  return out;
+}
+
+#define mat2_subtract(a, b) glisy_mat2_subtract((a), (b))
 
 /**
  * Multiply mat2 a and mat2 b.
  */
 
-#define mat2_multiply(a, b) ((mat2){       \
-  ((a).m11 * (b).m11 + (a).m21 * (b).m12), \
-  ((a).m12 * (b).m11 + (a).m22 * (b).m12), \
-  ((a).m11 * (b).m21 + (a).m21 * (b).m22), \
-  ((a).m12 * (b).m21 + (a).m22 * (b).m22)  \
-})
+static inline void
+glisy_mat2_multiply_into (mat2 *out, const mat2 *a, const mat2 *b) {
+  *out = (mat2) {
+    a->m11 * b->m11 + a->m21 * b->m12,
+    a->m12 * b->m11 + a->m22 * b->m12,
+    a->m11 * b->m21 + a->m21 * b->m22,
+    a->m12 * b->m21 + a->m22 * b->m22
+  };
+}
+
+static inline mat2
+glisy_mat2_multiply (mat2 a, mat2 b) {
+  mat2 out;
+  glisy_mat2_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define mat2_multiply(a, b) glisy_mat2_multiply((a), (b))
 
 /**
  * Rotates mat2 a by angle rad.
  */
 
-#define mat2_rotate(a, rad) ({         \
-  float s = sinf(rad);                 \
-  float c = cosf(rad);                 \
-  mat2((a).m11 * +c + (a).m21 * s,     \
-       (a).m12 * +c + (a).m22 * s,     \
-       (a).m11 * -s + (a).m21 * c,     \
-       (a).m12 * -s + (a).m22 * c);    \
-})
+static inline void
+glisy_mat2_rotate_into (mat2 *out, const mat2 *a, float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  *out = (mat2) {
+    a->m11 * +c + a->m21 * s,
+    a->m12 * +c + a->m22 * s,
+    a->m11 * -s + a->m21 * c,
+    a->m12 * -s + a->m22 * c
+  };
+}
+
+static inline mat2
+glisy_mat2_rotate (mat2 a, float rad) {
+  mat2 out;
+  glisy_mat2_rotate_into(&out, &a, rad);
+  return out;
+}
+
+#define mat2_rotate(a, rad) glisy_mat2_rotate((a), (rad))
 
 /**
  * Creates a mat2 from rotation rad.
  */
 
-#define mat2_from_rotation(rad) ((mat2){ \
-  cosf(rad), sinf(rad),                  \
-  -sinf(rad), cosf(rad)                  \
-})
+static inline mat2
+glisy_mat2_from_rotation (float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  return (mat2) {c, s, -s, c};
+}
+
+#define mat2_from_rotation(rad) glisy_mat2_from_rotation((rad))
 
 /**
  * Scale mat2 a by vec2 b.
  */
 
-#define mat2_scale(a, b) ((mat2) {  \
-  (a.m11 * b.x), (a.m12 * b.x),     \
-  (a.m21 * b.y), (a.m22 * b.y)      \
-})
+static inline void
+glisy_mat2_scale_into (mat2 *out, const mat2 *a, const vec2 *b) {
+  *out = (mat2) {
+    a->m11 * b->x, a->m12 * b->x,
+    a->m21 * b->y, a->m22 * b->y
+  };
+}
+
+static inline mat2
+glisy_mat2_scale (mat2 a, vec2 b) {
+  mat2 out;
+  glisy_mat2_scale_into(&out, &a, &b);
+  return out;
+}
+
+#define mat2_scale(a, b) glisy_mat2_scale((a), (b))
 
 /**
  * Creates a scaled mat2 from a vec2 a.
  */
 
-#define mat2_scaled_from_vec2(a) ((mat2){(a).x, 0, 0, (a).y})
+static inline mat2
+glisy_mat2_scaled_from_vec2 (vec2 a) {
+  return (mat2) {a.x, 0, 0, a.y};
+}
+
+#define mat2_scaled_from_vec2(a) glisy_mat2_scaled_from_vec2((a))
 
 /**
  * Calculates the Frobenius norm for mat2 a.
  * See: http://mathworld.wolfram.com/FrobeniusNorm.html
  */
 
-#define mat2_frob(a) ((float) sqrt(    \
-  powf((a).m11, 2.0) +                 \
-  powf((a).m12, 2.0) +                 \
-  powf((a).m21, 2.0) +                 \
-  powf((a).m22, 2.0)                   \
-))
+static inline float
+glisy_mat2_frob (mat2 a) {
+  return sqrtf(a.m11 * a.m11 + a.m12 * a.m12 +
+               a.m21 * a.m21 + a.m22 * a.m22);
+}
+
+#define mat2_frob(a) glisy_mat2_frob((a))
+
+/**
+ * Writes a string representation of mat2 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_mat2_format (char *buf, size_t size, mat2 a) {
+  return glisy_format_floats(buf, size, "mat2", &a.m11, 4, 2);
+}
+
+#define mat2_format(buf, size, a) glisy_mat2_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(mat2)
 
 /**
- * Returns a string representation of mat2 a.
+ * Returns a string representation of mat2 a, allocated with
+ * strdup. The caller frees it.
  */
 
-#define mat2_string(a) (const char *) ({              \
-  char str[BUFSIZ];                                   \
-  memset(str, 0, BUFSIZ);                             \
-  sprintf(str, "mat2(%f, %f, \n%f, %f)",              \
-               (a).m11, (a).m12, (a).m21, (a).m22);   \
-  (strdup(str));                                      \
-})
+static inline const char *
+glisy_mat2_string (mat2 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_mat2_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define mat2_string(a) glisy_mat2_string((a))
 
 #ifdef __cplusplus
 }
@@ -1,9 +1,12 @@
 #ifndef GLISY_MAT3_H
 #define GLISY_MAT3_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
 
 /**
  * mat3 struct type.
@@ -16,6 +19,18 @@ struct mat3 {
   float m31; float m32; float m33;
 };
 
+/**
+ * Types used by mat3 routines. Included after the
+ * mat3 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/vec2.h>
+#include <glisy/quat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * mat3 initializers.
  */
@@ -30,270 +45,413 @@ struct mat3 {
  * Clones and returns mat3 a.
  */
 
-#define mat3_clone(a) ((mat3){(a).m11, (a).m12, (a).m13,  \
-                               (a).m21, (a).m22, (a).m23, \
-                               (a).m31, (a).m32, (a).m33})
+static inline mat3
+glisy_mat3_clone (mat3 a) {
+  return (mat3) {a.m11, a.m12, a.m13,
+                 a.m21, a.m22, a.m23,
+                 a.m31, a.m32, a.m33};
+}
+
+#define mat3_clone(a) glisy_mat3_clone((a))
 
 /**
  * Copies mat3 b into mat3 a.
  */
 
-#define mat3_copy(a, b)  ({                                     \
-  mat3 *tmp = (mat3 *) &(a);                                    \
-  (tmp->m11 = b.m11), (tmp->m12 = b.m12), (tmp->m13 = b.m13);   \
-  (tmp->m21 = b.m21), (tmp->m22 = b.m22), (tmp->m23 = b.m23);   \
-  (tmp->m31 = b.m31), (tmp->m32 = b.m32), (tmp->m33 = b.m33);   \
-  (*tmp);                                                       \
-})
+static inline mat3
+glisy_mat3_copy (mat3 *a, mat3 b) {
+  a->m11 = b.m11; a->m12 = b.m12; a->m13 = b.m13;
+  a->m21 = b.m21; a->m22 = b.m22; a->m23 = b.m23;
+  a->m31 = b.m31; a->m32 = b.m32; a->m33 = b.m33;
+  return *a;
+}
+
+#define mat3_copy(a, b) glisy_mat3_copy(&(a), (b))
 
 /**
  * Sets an identity for mat3 a.
  */
 
-#define mat3_identity(a)  ({                          \
-  mat3 *tmp = (mat3 *) &(a);                          \
-  (tmp->m11 = 1), (tmp->m12 = 0), (tmp->m13 = 0);     \
-  (tmp->m21 = 0), (tmp->m22 = 1), (tmp->m23 = 0);     \
-  (tmp->m31 = 0), (tmp->m32 = 0), (tmp->m33 = 1);     \
-  (*tmp);                                             \
-})
+static inline mat3
+glisy_mat3_identity (mat3 *a) {
+  a->m11 = 1; a->m12 = 0; a->m13 = 0;
+  a->m21 = 0; a->m22 = 1; a->m23 = 0;
+  a->m31 = 0; a->m32 = 0; a->m33 = 1;
+  return *a;
+}
+
+#define mat3_identity(a) glisy_mat3_identity(&(a))
 
 /**
  * Transposes mat3 a.
  */
 
-#define mat3_transpose(a)  ({       \
-  mat3((a).m11, (a).m21, (a).m31,   \
-       (a).m12, (a).m22, (a).m32,   \
-       (a).m13, (a).m23, (a).m33);  \
-})
+static inline void
+glisy_mat3_transpose_into (mat3 *out, const mat3 *a) {
+  *out = (mat3) {a->m11, a->m21, a->m31,
+                 a->m12, a->m22, a->m32,
+                 a->m13, a->m23, a->m33};
+}
+
+static inline mat3
+glisy_mat3_transpose (mat3 a) {
+  mat3 out;
+  glisy_mat3_transpose_into(&out, &a);
+  return out;
+}
+
+#define mat3_transpose(a) glisy_mat3_transpose((a))
 
 /**
  * Calculates and returns inverse for mat3 a.
  */
 
-#define mat3_invert(a)  ({                             \
-  mat3 b = mat3(0);                                    \
-  float a11 = (a).m11, a12 = (a).m12, a13 = (a).m13;   \
-  float a21 = (a).m21, a22 = (a).m22, a23 = (a).m23;   \
-  float a31 = (a).m31, a32 = (a).m32, a33 = (a).m33;   \
-  float b11 = a33 * a22 - a23 * a32;                   \
-  float b21 = -a33 * a21 + a23 * a31;                  \
-  float b31 = a32 * a21 - a22 * a31;                   \
-  float det = a11 * b11 + a12 * b21 + a13 * b31;       \
-  if (det) {                                           \
-    det = 1.0 / det;                                   \
-    b.m11 = (det * b11);                               \
-    b.m12 = (det * (-a33 * a12 + a13 * a32));          \
-    b.m13 = (det * (a23 * a12 - a13 * a22));           \
-    b.m21 = (det * b21);                               \
-    b.m22 = (det * (a33 * a11 - a13 * a31));           \
-    b.m23 = (det * (-a23 * a11 + a13 * a21));          \
-    b.m31 = (det * b31);                               \
-    b.m32 = (det * (-a32 * a11 + a12 * a31));          \
-    b.m33 = (det * (a22 * a11 - a12 * a21));           \
-  }                                                    \
-  (b);                                                 \
-})
+static inline void
+glisy_mat3_invert_into (mat3 *out, const mat3 *a) {
+  mat3 b = {0};
+  float a11 = a->m11, a12 = a->m12, a13 = a->m13;
+  float a21 = a->m21, a22 = a->m22, a23 = a->m23;
+  float a31 = a->m31, a32 = a->m32, a33 = a->m33;
+  float b11 = a33 * a22 - a23 * a32;
+  float b21 = -a33 * a21 + a23 * a31;
+  float b31 = a32 * a21 - a22 * a31;
+  float det = a11 * b11 + a12 * b21 + a13 * b31;
+  if (det) {
+    det = 1.0f / det;
+    b.m11 = (det * b11);
+    b.m12 = (det * (-a33 * a12 + a13 * a32));
+    b.m13 = (det * (a23 * a12 - a13 * a22));
+    b.m21 = (det * b21);
+    b.m22 = (det * (a33 * a11 - a13 * a31));
+    b.m23 = (det * (-a23 * a11 + a13 * a21));
+    b.m31 = (det * b31);
+    b.m32 = (det * (-a32 * a11 + a12 * a31));
+    b.m33 = (det * (a22 * a11 - a12 * a21));
+  }
+  *out = b;
+}
+
+static inline mat3
+glisy_mat3_invert (mat3 a) {
+  mat3 out;
+  glisy_mat3_invert_into(&out, &a);
+  return out;
+}
+
+#define mat3_invert(a) glisy_mat3_invert((a))
 
 /**
  * Calculates adjugate of mat3 a.
  */
 
-#define mat3_adjoint(a)  ({                            \
-  mat3 b = mat3(0);                                    \
-  float a11 = (a).m11, a12 = (a).m12, a13 = (a).m13;   \
-  float a21 = (a).m21, a22 = (a).m22, a23 = (a).m23;   \
-  float a31 = (a).m31, a32 = (a).m32, a33 = (a).m33;   \
-  b.m11 = (a22 * a33 - a23 * a32);                     \
-  b.m12 = (a13 * a32 - a12 * a33);                     \
-  b.m13 = (a12 * a23 - a13 * a22);                     \
-  b.m21 = (a23 * a31 - a21 * a33);                     \
-  b.m22 = (a11 * a33 - a13 * a31);                     \
-  b.m23 = (a13 * a21 - a11 * a23);                     \
-  b.m31 = (a21 * a32 - a22 * a31);                     \
-  b.m32 = (a12 * a31 - a11 * a32);                     \
-  b.m33 = (a11 * a22 - a12 * a21);                     \
-  (b);                                                 \
-})
+static inline void
+glisy_mat3_adjoint_into (mat3 *out, const mat3 *a) {
+  float a11 = a->m11, a12 = a->m12, a13 = a->m13;
+  float a21 = a->m21, a22 = a->m22, a23 = a->m23;
+  float a31 = a->m31, a32 = a->m32, a33 = a->m33;
+  *out = (mat3) {
+    (a22 * a33 - a23 * a32),
+    (a13 * a32 - a12 * a33),
+    (a12 * a23 - a13 * a22),
+    (a23 * a31 - a21 * a33),
+    (a11 * a33 - a13 * a31),
+    (a13 * a21 - a11 * a23),
+    (a21 * a32 - a22 * a31),
+    (a12 * a31 - a11 * a32),
+    (a11 * a22 - a12 * a21)
+  };
+}
+
+static inline mat3
+glisy_mat3_adjoint (mat3 a) {
+  mat3 out;
+  glisy_mat3_adjoint_into(&out, &a);
+  return out;
+}
+
+#define mat3_adjoint(a) glisy_mat3_adjoint((a))
 
 /**
  * Calculates determinant of mat3 a.
  */
 
-#define mat3_determinant(a) (float) ({                  \
-  (a).m11 * (+(a).m33 * (a).m22 - (a).m23 * (a).m32) +  \
-  (a).m12 * (-(a).m33 * (a).m21 + (a).m23 * (a).m31) +  \
-  (a).m13 * (+(a).m32 * (a).m21 - (a).m22 * (a).m31);   \
-})
+static inline float
+glisy_mat3_determinant (mat3 a) {
+  return a.m11 * (+a.m33 * a.m22 - a.m23 * a.m32) +
+         a.m12 * (-a.m33 * a.m21 + a.m23 * a.m31) +
+         a.m13 * (+a.m32 * a.m21 - a.m22 * a.m31);
+}
+
+#define mat3_determinant(a) glisy_mat3_determinant((a))
 
 /**
  * Add mat3 a and mat3 b.
  */
 
-#define mat3_add(a, b) ((mat3) {                             \
-  (a).m11 + (b).m11, (a).m12 + (b).m12, (a).m13 + (b).m13,   \
-  (a).m21 + (b).m21, (b).m22 + (b).m22, (a).m23 + (b).m23,   \
-  (a).m31 + (b).m31, (b).m32 + (b).m32, (a).m33 + (b).m33    \
-})
+static inline void
+glisy_mat3_add_into (mat3 *out, const mat3 *a, const mat3 *b) {
+  *out = (mat3) {
+    a->m11 + b->m11, a->m12 + b->m12, a->m13 + b->m13,
+    a->m21 + b->m21, a->m22 + b->m22, a->m23 + b->m23,
+    a->m31 + b->m31, a->m32 + b->m32, a->m33 + b->m33
+  };
+}
+
+static inline mat3
+glisy_mat3_add (mat3 a, mat3 b) {
+  mat3 out;
+  glisy_mat3_add_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3_add(a, b) glisy_mat3_add((a), (b))
 
 /**
  * Subtract mat3 b from mat3 a.
  */
 
-#define mat3_subtract(a, b) ((mat3) {                        \
-  (a).m11 - (b).m11, (a).m12 - (b).m12, (a).m13 - (b).m13,   \
-  (a).m21 - (b).m21, (b).m22 - (b).m22, (a).m23 - (b).m23,   \
-  (a).m31 - (b).m31, (b).m32 - (b).m32, (a).m33 - (b).m33    \
-})
+static inline void
+glisy_mat3_subtract_into (mat3 *out, const mat3 *a, const mat3 *b) {
+  *out = (mat3) {
+    a->m11 - b->m11, a->m12 - b->m12, a->m13 - b->m13,
+    a->m21 - b->m21, a->m22 - b->m22, a->m23 - b->m23,
+    a->m31 - b->m31, a->m32 - b->m32, a->m33 - b->m33
+  };
+}
+
+static inline mat3
+glisy_mat3_subtract (mat3 a, mat3 b) {
+  mat3 out;
+  glisy_mat3_subtract_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3_subtract(a, b) glisy_mat3_subtract((a), (b))
 
 /**
  * multiply mat3 a and mat3 b.
  */
 
-#define mat3_multiply(a, b) ((mat3) {                          \
-  ((a).m11 * (b).m11 + (a).m21 * (b).m12 + (a).m31 * (b).m13), \
-  ((a).m12 * (b).m11 + (a).m22 * (b).m12 + (a).m32 * (b).m13), \
-  ((a).m13 * (b).m11 + (a).m23 * (b).m12 + (a).m33 * (b).m13), \
-                                                               \
-  ((a).m11 * (b).m21 + (a).m21 * (b).m22 + (a).m31 * (b).m23), \
-  ((a).m12 * (b).m21 + (a).m22 * (b).m22 + (a).m32 * (b).m23), \
-  ((a).m13 * (b).m21 + (a).m23 * (b).m22 + (a).m33 * (b).m23), \
-                                                               \
-  ((a).m11 * (b).m31 + (a).m21 * (b).m32 + (a).m31 * (b).m33), \
-  ((a).m12 * (b).m31 + (a).m22 * (b).m32 + (a).m32 * (b).m33), \
-  ((a).m13 * (b).m31 + (a).m23 * (b).m32 + (a).m33 * (b).m33)  \
-})
+static inline void
+glisy_mat3_multiply_into (mat3 *out, const mat3 *a, const mat3 *b) {
+  *out = (mat3) {
+    (a->m11 * b->m11 + a->m21 * b->m12 + a->m31 * b->m13),
+    (a->m12 * b->m11 + a->m22 * b->m12 + a->m32 * b->m13),
+    (a->m13 * b->m11 + a->m23 * b->m12 + a->m33 * b->m13),
+
+    (a->m11 * b->m21 + a->m21 * b->m22 + a->m31 * b->m23),
+    (a->m12 * b->m21 + a->m22 * b->m22 + a->m32 * b->m23),
+    (a->m13 * b->m21 + a->m23 * b->m22 + a->m33 * b->m23),
+
+    (a->m11 * b->m31 + a->m21 * b->m32 + a->m31 * b->m33),
+    (a->m12 * b->m31 + a->m22 * b->m32 + a->m32 * b->m33),
+    (a->m13 * b->m31 + a->m23 * b->m32 + a->m33 * b->m33)
+  };
+}
+
+static inline mat3
+glisy_mat3_multiply (mat3 a, mat3 b) {
+  mat3 out;
+  glisy_mat3_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3_multiply(a, b) glisy_mat3_multiply((a), (b))
 
 /**
  * Rotates mat3 a by angle rad.
  */
 
-#define mat3_rotate(a, rad) ( ({            \
-  float c = cosf(rad);                      \
-  float s = sinf(rad);                      \
-  mat3((c * (a).m11 + s * (a).m21),         \
-       (c * (a).m12 + s * (a).m22),         \
-       (c * (a).m13 + s * (a).m23),         \
-       (c * (a).m21 - s * (a).m11),         \
-       (c * (a).m22 - s * (a).m12),         \
-       (c * (a).m23 - s * (a).m13),         \
-       (a).m31, (a).m32, (a).m33            \
-    );                                      \
-}))
+static inline void
+glisy_mat3_rotate_into (mat3 *out, const mat3 *a, float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  *out = (mat3) {
+    (c * a->m11 + s * a->m21),
+    (c * a->m12 + s * a->m22),
+    (c * a->m13 + s * a->m23),
+    (c * a->m21 - s * a->m11),
+    (c * a->m22 - s * a->m12),
+    (c * a->m23 - s * a->m13),
+    a->m31, a->m32, a->m33
+  };
+}
+
+static inline mat3
+glisy_mat3_rotate (mat3 a, float rad) {
+  mat3 out;
+  glisy_mat3_rotate_into(&out, &a, rad);
+  return out;
+}
+
+#define mat3_rotate(a, rad) glisy_mat3_rotate((a), (rad))
 
 /**
  * Creates mat3 from rotation angle rad.
  */
 
-#define mat3_from_rotation(rad) ((mat3) {    \
-  +cosf(rad), +sinf(rad), 0.0,               \
-  -sinf(rad), +cosf(rad), 0.0,               \
-  0.0, 0.0, 1.0                              \
-})
+static inline mat3
+glisy_mat3_from_rotation (float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  return (mat3) {
+    +c, +s, 0.0,
+    -s, +c, 0.0,
+    0.0, 0.0, 1.0
+  };
+}
+
+#define mat3_from_rotation(rad) glisy_mat3_from_rotation((rad))
 
 /**
  * Scales mat3 a by vec2 b.
  */
 
-#define mat3_scale(a, b) ((mat3) {                           \
-  ((a).m11 * (b).x), ((a).m12 * (b).x), ((a).m13 * (b).x),   \
-  ((a).m21 * (b).y), ((a).m22 * (b).y), ((a).m23 * (b).y),   \
-  (a).m31, (a).m32, (a).m33                                  \
-})
+static inline void
+glisy_mat3_scale_into (mat3 *out, const mat3 *a, const vec2 *b) {
+  *out = (mat3) {
+    (a->m11 * b->x), (a->m12 * b->x), (a->m13 * b->x),
+    (a->m21 * b->y), (a->m22 * b->y), (a->m23 * b->y),
+    a->m31, a->m32, a->m33
+  };
+}
+
+static inline mat3
+glisy_mat3_scale (mat3 a, vec2 b) {
+  mat3 out;
+  glisy_mat3_scale_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3_scale(a, b) glisy_mat3_scale((a), (b))
 
 /**
  * Creates mat3 from scale vec2 a.
  */
 
-#define mat3_from_scale(a) ((mat3) {   \
-  (a).x, 0.0, 0.0,                     \
-  0.0, (a).y, 0.0,                     \
-  0.0, 0.0, 1.0                        \
-})
+static inline mat3
+glisy_mat3_from_scale (vec2 a) {
+  return (mat3) {
+    a.x, 0.0, 0.0,
+    0.0, a.y, 0.0,
+    0.0, 0.0, 1.0
+  };
+}
+
+#define mat3_from_scale(a) glisy_mat3_from_scale((a))
 
 /**
  * Translate mat3 a by vec2 b.
  */
 
-#define mat3_translate(a, b) ((mat3) {           \
-  (a).m11, (a).m12, (a).m13,                     \
-  (a).m21, (a).m22, (a).m23,                     \
-  ((b).x * (a).m11 + (b).y * (a).m21 + (a).m31), \
-  ((b).x * (a).m12 + (b).y * (a).m22 + (a).m32), \
-  ((b).x * (a).m13 + (b).y * (a).m23 + (a).m33)  \
-})
+static inline void
+glisy_mat3_translate_into (mat3 *out, const mat3 *a, const vec2 *b) {
+  *out = (mat3) {
+    a->m11, a->m12, a->m13,
+    a->m21, a->m22, a->m23,
+    (b->x * a->m11 + b->y * a->m21 + a->m31),
+    (b->x * a->m12 + b->y * a->m22 + a->m32),
+    (b->x * a->m13 + b->y * a->m23 + a->m33)
+  };
+}
+
+static inline mat3
+glisy_mat3_translate (mat3 a, vec2 b) {
+  mat3 out;
+  glisy_mat3_translate_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3_translate(a, b) glisy_mat3_translate((a), (b))
 
 /**
  * Creates mat3 from translation vec2 a.
  */
 
-#define mat3_from_translation(a) ((mat3) {1.0, 0.0, 0.0,     \
-                                          0.0, 1.0, 0.0,     \
-                                          (a).x, (a).y, 1.0})
+static inline mat3
+glisy_mat3_from_translation (vec2 a) {
+  return (mat3) {1.0, 0.0, 0.0,
+                 0.0, 1.0, 0.0,
+                 a.x, a.y, 1.0};
+}
+
+#define mat3_from_translation(a) glisy_mat3_from_translation((a))
 
 /**
  * Creates mat3 from quat a.
  */
 
-#define mat3_from_quat(a) ({                        \
-  float x = (a).x, y = (a).y, z = (a).z, w = (a).w; \
-  float x2 = x + x,                                 \
-        y2 = y + y,                                 \
-        z2 = z + z,                                 \
-        xx = x * x2,                                \
-        yx = y * x2,                                \
-        yy = y * y2,                                \
-        zx = z * x2,                                \
-        zy = z * y2,                                \
-        zz = z * z2,                                \
-        wx = w * x2,                                \
-        wy = w * y2,                                \
-        wz = w * z2;                                \
-  mat3((1 - yy - zz),                               \
-       (yx + wz),                                   \
-       (zx - wy),                                   \
-       (yx - wz),                                   \
-       (1 - xx - zz),                               \
-       (zy + wx),                                   \
-       (zx + wy),                                   \
-       (zy - wx),                                   \
-       (1 - xx - yy));                              \
-})
+static inline void
+glisy_mat3_from_quat_into (mat3 *out, const quat *a) {
+  float x = a->x, y = a->y, z = a->z, w = a->w;
+  float x2 = x + x,
+        y2 = y + y,
+        z2 = z + z,
+        xx = x * x2,
+        yx = y * x2,
+        yy = y * y2,
+        zx = z * x2,
+        zy = z * y2,
+        zz = z * z2,
+        wx = w * x2,
+        wy = w * y2,
+        wz = w * z2;
+  *out = (mat3) {
+    (1 - yy - zz), (yx + wz), (zx - wy),
+    (yx - wz), (1 - xx - zz), (zy + wx),
+    (zx + wy), (zy - wx), (1 - xx - yy)
+  };
+}
+
+static inline mat3
+glisy_mat3_from_quat (quat a) {
+  mat3 out;
+  glisy_mat3_from_quat_into(&out, &a);
+  return out;
+}
+
+#define mat3_from_quat(a) glisy_mat3_from_quat((a))
 
 /**
  * Calculates Frobenius norm mat3 a.
  */
 
-#define mat3_frob(a) (float) sqrt(  \
-  powf((a).m11, 2.0) +              \
-  powf((a).m12, 2.0) +              \
-  powf((a).m13, 2.0) +              \
-  powf((a).m21, 2.0) +              \
-  powf((a).m22, 2.0) +              \
-  powf((a).m23, 2.0) +              \
-  powf((a).m31, 2.0) +              \
-  powf((a).m32, 2.0) +              \
-  powf((a).m33, 2.0)                \
-)
+static inline float
+glisy_mat3_frob (mat3 a) {
+  return sqrtf(a.m11 * a.m11 + a.m12 * a.m12 + a.m13 * a.m13 +
+               a.m21 * a.m21 + a.m22 * a.m22 + a.m23 * a.m23 +
+               a.m31 * a.m31 + a.m32 * a.m32 + a.m33 * a.m33);
+}
+
+#define mat3_frob(a) glisy_mat3_frob((a))
 
 /**
- * Returns a string representation of mat3 a.
+ * Writes a string representation of mat3 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
  */
 
-#define mat3_string(a) (const char *) ({                       \
-  char str[BUFSIZ];                                            \
-  mat3 b;                                                      \
-  mat3_copy(b, (a));                                           \
-  memset(str, 0, BUFSIZ);                                      \
-  sprintf(str, "mat3(%f, %f, %f,\n"                            \
-               "     %f, %f, %f,\n"                            \
-               "     %f, %f, %f)",                             \
-               b.m11, b.m12, b.m13,                            \
-               b.m21, b.m22, b.m23,                            \
-               b.m31, b.m32, b.m33);                           \
-  (strdup(str));                                               \
-})
+static inline size_t
+glisy_mat3_format (char *buf, size_t size, mat3 a) {
+  return glisy_format_floats(buf, size, "mat3", &a.m11, 9, 3);
+}
+
+#define mat3_format(buf, size, a) glisy_mat3_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(mat3)
+
+/**
+ * Returns a string representation of mat3 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_mat3_string (mat3 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_mat3_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define mat3_string(a) glisy_mat3_string((a))
 
 #ifdef __cplusplus
 }
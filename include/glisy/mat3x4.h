@@ -0,0 +1,623 @@
+#ifndef GLISY_MAT3X4_H
+#define GLISY_MAT3X4_H
+
+#include <math.h>
+#include <stddef.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+#include <glisy/mat3.h>
+#include <glisy/mat4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * mat3x4 struct type. A 48 byte affine transform holding the first
+ * three columns of the equivalent mat4 as rows, so the constant
+ * 0, 0, 0, 1 column is never stored. Row i dotted with (x, y, z, 1)
+ * is component i of a transformed point and m14, m24, m34 hold the
+ * translation. This is the layout of a GLSL mat3x4 or HLSL float3x4
+ * bone palette entry. Aligned to 16 bytes so each row loads as one
+ * SSE register.
+ */
+
+typedef struct mat3x4 mat3x4;
+struct mat3x4 {
+  float m11; float m12; float m13; float m14;
+  float m21; float m22; float m23; float m24;
+  float m31; float m32; float m33; float m34;
+} GLISY_ALIGN(16);
+
+/**
+ * mat3x4 initializers.
+ */
+
+#define mat3x4_create() mat3x4(1,0,0,0, \
+                               0,1,0,0, \
+                               0,0,1,0)
+
+#define mat3x4(...) ((mat3x4){ __VA_ARGS__ })
+
+/**
+ * Converts affine mat4 a to a mat3x4, dropping its projective
+ * column.
+ */
+
+static inline void
+glisy_mat3x4_from_mat4_into (mat3x4 *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 r3 = _mm_load_ps(&a->m41);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_store_ps(&out->m11, r0);
+  _mm_store_ps(&out->m21, r1);
+  _mm_store_ps(&out->m31, r2);
+#else
+  *out = (mat3x4) {
+    a->m11, a->m21, a->m31, a->m41,
+    a->m12, a->m22, a->m32, a->m42,
+    a->m13, a->m23, a->m33, a->m43
+  };
+#endif
+}
+
+static inline mat3x4
+glisy_mat3x4_from_mat4 (mat4 a) {
+  mat3x4 out;
+  glisy_mat3x4_from_mat4_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_from_mat4(a) glisy_mat3x4_from_mat4((a))
+
+/**
+ * Expands mat3x4 a to an affine mat4.
+ */
+
+static inline void
+glisy_mat3x4_to_mat4_into (mat4 *out, const mat3x4 *a) {
+#ifdef GLISY_SSE2
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 r3 = _mm_setr_ps(0, 0, 0, 1);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_store_ps(&out->m11, r0);
+  _mm_store_ps(&out->m21, r1);
+  _mm_store_ps(&out->m31, r2);
+  _mm_store_ps(&out->m41, r3);
+#else
+  *out = (mat4) {
+    a->m11, a->m21, a->m31, 0,
+    a->m12, a->m22, a->m32, 0,
+    a->m13, a->m23, a->m33, 0,
+    a->m14, a->m24, a->m34, 1
+  };
+#endif
+}
+
+static inline mat4
+glisy_mat3x4_to_mat4 (mat3x4 a) {
+  mat4 out;
+  glisy_mat3x4_to_mat4_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_to_mat4(a) glisy_mat3x4_to_mat4((a))
+
+/**
+ * Converts mat3 a to a mat3x4 with no translation.
+ */
+
+static inline void
+glisy_mat3x4_from_mat3_into (mat3x4 *out, const mat3 *a) {
+  *out = (mat3x4) {
+    a->m11, a->m21, a->m31, 0,
+    a->m12, a->m22, a->m32, 0,
+    a->m13, a->m23, a->m33, 0
+  };
+}
+
+static inline mat3x4
+glisy_mat3x4_from_mat3 (mat3 a) {
+  mat3x4 out;
+  glisy_mat3x4_from_mat3_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_from_mat3(a) glisy_mat3x4_from_mat3((a))
+
+/**
+ * Returns the upper 3x3 of mat3x4 a, dropping the translation.
+ */
+
+static inline void
+glisy_mat3x4_to_mat3_into (mat3 *out, const mat3x4 *a) {
+  *out = (mat3) {
+    a->m11, a->m21, a->m31,
+    a->m12, a->m22, a->m32,
+    a->m13, a->m23, a->m33
+  };
+}
+
+static inline mat3
+glisy_mat3x4_to_mat3 (mat3x4 a) {
+  mat3 out;
+  glisy_mat3x4_to_mat3_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_to_mat3(a) glisy_mat3x4_to_mat3((a))
+
+/**
+ * Calculates the rotation mat3x4 of unit quat a. Matches
+ * mat4_from_quat and mat3_from_quat.
+ */
+
+static inline void
+glisy_mat3x4_from_quat_into (mat3x4 *out, const quat *a) {
+  mat3 m;
+  glisy_mat3_from_quat_into(&m, a);
+  glisy_mat3x4_from_mat3_into(out, &m);
+}
+
+static inline mat3x4
+glisy_mat3x4_from_quat (quat a) {
+  mat3x4 out;
+  glisy_mat3x4_from_quat_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_from_quat(a) glisy_mat3x4_from_quat((a))
+
+/**
+ * Returns the rotation of mat3x4 a as a quat. The upper 3x3 must
+ * be a pure rotation.
+ */
+
+static inline quat
+glisy_mat3x4_to_quat (mat3x4 a) {
+  return glisy_quat_from_mat3(glisy_mat3x4_to_mat3(a));
+}
+
+#define mat3x4_to_quat(a) glisy_mat3x4_to_quat((a))
+
+/**
+ * Multiplies mat3x4s a and b with the same meaning as mat4_multiply
+ * on the equivalent mat4s: the result applies b, then a. Each row
+ * of the result is a combination of the rows of b, 36 multiplies
+ * in the scalar path and nine vector multiply-adds with SSE.
+ */
+
+static inline void
+glisy_mat3x4_multiply_scalar (mat3x4 *out,
+                              const mat3x4 *a,
+                              const mat3x4 *b) {
+  *out = (mat3x4) {
+    (a->m11 * b->m11 + a->m12 * b->m21 + a->m13 * b->m31),
+    (a->m11 * b->m12 + a->m12 * b->m22 + a->m13 * b->m32),
+    (a->m11 * b->m13 + a->m12 * b->m23 + a->m13 * b->m33),
+    (a->m11 * b->m14 + a->m12 * b->m24 + a->m13 * b->m34 + a->m14),
+
+    (a->m21 * b->m11 + a->m22 * b->m21 + a->m23 * b->m31),
+    (a->m21 * b->m12 + a->m22 * b->m22 + a->m23 * b->m32),
+    (a->m21 * b->m13 + a->m22 * b->m23 + a->m23 * b->m33),
+    (a->m21 * b->m14 + a->m22 * b->m24 + a->m23 * b->m34 + a->m24),
+
+    (a->m31 * b->m11 + a->m32 * b->m21 + a->m33 * b->m31),
+    (a->m31 * b->m12 + a->m32 * b->m22 + a->m33 * b->m32),
+    (a->m31 * b->m13 + a->m32 * b->m23 + a->m33 * b->m33),
+    (a->m31 * b->m14 + a->m32 * b->m24 + a->m33 * b->m34 + a->m34)
+  };
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat3x4_multiply_sse (mat3x4 *out,
+                           const mat3x4 *a,
+                           const mat3x4 *b) {
+  __m128 b0 = _mm_load_ps(&b->m11);
+  __m128 b1 = _mm_load_ps(&b->m21);
+  __m128 b2 = _mm_load_ps(&b->m31);
+  __m128 w = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  __m128 r[3];
+  const float *ap = &a->m11;
+  for (int i = 0; i < 3; ++i) {
+    __m128 row = _mm_load_ps(ap + 4 * i);
+    __m128 v = glisy_simd_madd(glisy_simd_splat(row, 0), b0,
+                               _mm_and_ps(row, w));
+    v = glisy_simd_madd(glisy_simd_splat(row, 1), b1, v);
+    r[i] = glisy_simd_madd(glisy_simd_splat(row, 2), b2, v);
+  }
+  _mm_store_ps(&out->m11, r[0]);
+  _mm_store_ps(&out->m21, r[1]);
+  _mm_store_ps(&out->m31, r[2]);
+}
+#endif
+
+static inline void
+glisy_mat3x4_multiply_into (mat3x4 *out, const mat3x4 *a, const mat3x4 *b) {
+#ifdef GLISY_SSE2
+  glisy_mat3x4_multiply_sse(out, a, b);
+#else
+  glisy_mat3x4_multiply_scalar(out, a, b);
+#endif
+}
+
+static inline mat3x4
+glisy_mat3x4_multiply (mat3x4 a, mat3x4 b) {
+  mat3x4 out;
+  glisy_mat3x4_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define mat3x4_multiply(a, b) glisy_mat3x4_multiply((a), (b))
+
+/**
+ * Inverts mat3x4 a. The inverse of the 3x3 part is its adjugate
+ * over its determinant and the translation is the negated
+ * translation mapped through it. A singular a yields an all zero
+ * matrix, like mat4_invert_affine.
+ */
+
+static inline void
+glisy_mat3x4_invert_scalar (mat3x4 *out, const mat3x4 *a) {
+  float a00 = a->m11, a01 = a->m12, a02 = a->m13, tx = a->m14;
+  float a10 = a->m21, a11 = a->m22, a12 = a->m23, ty = a->m24;
+  float a20 = a->m31, a21 = a->m32, a22 = a->m33, tz = a->m34;
+
+  float c00 = a11 * a22 - a12 * a21;
+  float c10 = a12 * a20 - a10 * a22;
+  float c20 = a10 * a21 - a11 * a20;
+  float det = a00 * c00 + a01 * c10 + a02 * c20;
+
+  if (0 == det) {
+    *out = (mat3x4) {0};
+    return;
+  }
+
+  det = 1.0f / det;
+
+  float i00 = c00 * det;
+  float i01 = (a02 * a21 - a01 * a22) * det;
+  float i02 = (a01 * a12 - a02 * a11) * det;
+  float i10 = c10 * det;
+  float i11 = (a00 * a22 - a02 * a20) * det;
+  float i12 = (a02 * a10 - a00 * a12) * det;
+  float i20 = c20 * det;
+  float i21 = (a01 * a20 - a00 * a21) * det;
+  float i22 = (a00 * a11 - a01 * a10) * det;
+
+  *out = (mat3x4) {
+    i00, i01, i02, -(i00 * tx + i01 * ty + i02 * tz),
+    i10, i11, i12, -(i10 * tx + i11 * ty + i12 * tz),
+    i20, i21, i22, -(i20 * tx + i21 * ty + i22 * tz)
+  };
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * The columns of the inverse 3x3 are the cross products of the rows
+ * of a, so the new translation is a combination of them too. One
+ * transpose turns the three columns and the translation into the
+ * three output rows. The w lane of each row holds a translation,
+ * so it is masked out of the determinant.
+ */
+
+static inline void
+glisy_mat3x4_invert_sse (mat3x4 *out, const mat3x4 *a) {
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+
+  __m128 c0 = glisy_mat4_cross3(r1, r2);
+  __m128 c1 = glisy_mat4_cross3(r2, r0);
+  __m128 c2 = glisy_mat4_cross3(r0, r1);
+  __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  __m128 det = glisy_simd_hsum(_mm_mul_ps(_mm_and_ps(r0, xyz), c0));
+
+  if (0 == _mm_cvtss_f32(det)) {
+    *out = (mat3x4) {0};
+    return;
+  }
+
+  __m128 rdet = _mm_div_ps(_mm_set1_ps(-1.0f), det);
+  __m128 t = _mm_mul_ps(glisy_simd_splat(r0, 3), c0);
+  t = glisy_simd_madd(glisy_simd_splat(r1, 3), c1, t);
+  t = glisy_simd_madd(glisy_simd_splat(r2, 3), c2, t);
+  t = _mm_mul_ps(t, rdet);
+  rdet = _mm_sub_ps(_mm_setzero_ps(), rdet);
+  c0 = _mm_mul_ps(c0, rdet);
+  c1 = _mm_mul_ps(c1, rdet);
+  c2 = _mm_mul_ps(c2, rdet);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, t);
+  _mm_store_ps(&out->m11, c0);
+  _mm_store_ps(&out->m21, c1);
+  _mm_store_ps(&out->m31, c2);
+}
+#endif
+
+static inline void
+glisy_mat3x4_invert_into (mat3x4 *out, const mat3x4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat3x4_invert_sse(out, a);
+#else
+  glisy_mat3x4_invert_scalar(out, a);
+#endif
+}
+
+static inline mat3x4
+glisy_mat3x4_invert (mat3x4 a) {
+  mat3x4 out;
+  glisy_mat3x4_invert_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_invert(a) glisy_mat3x4_invert((a))
+
+/**
+ * Inverts a rigid mat3x4 a, a rotation followed by a translation
+ * with no scale, by transposing the rotation. No determinant is
+ * computed.
+ */
+
+static inline void
+glisy_mat3x4_invert_rigid_scalar (mat3x4 *out, const mat3x4 *a) {
+  float a00 = a->m11, a01 = a->m12, a02 = a->m13, tx = a->m14;
+  float a10 = a->m21, a11 = a->m22, a12 = a->m23, ty = a->m24;
+  float a20 = a->m31, a21 = a->m32, a22 = a->m33, tz = a->m34;
+  *out = (mat3x4) {
+    a00, a10, a20, -(a00 * tx + a10 * ty + a20 * tz),
+    a01, a11, a21, -(a01 * tx + a11 * ty + a21 * tz),
+    a02, a12, a22, -(a02 * tx + a12 * ty + a22 * tz)
+  };
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat3x4_invert_rigid_sse (mat3x4 *out, const mat3x4 *a) {
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 t = _mm_mul_ps(glisy_simd_splat(r0, 3), r0);
+  t = glisy_simd_madd(glisy_simd_splat(r1, 3), r1, t);
+  t = glisy_simd_madd(glisy_simd_splat(r2, 3), r2, t);
+  t = _mm_sub_ps(_mm_setzero_ps(), t);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, t);
+  _mm_store_ps(&out->m11, r0);
+  _mm_store_ps(&out->m21, r1);
+  _mm_store_ps(&out->m31, r2);
+}
+#endif
+
+static inline void
+glisy_mat3x4_invert_rigid_into (mat3x4 *out, const mat3x4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat3x4_invert_rigid_sse(out, a);
+#else
+  glisy_mat3x4_invert_rigid_scalar(out, a);
+#endif
+}
+
+static inline mat3x4
+glisy_mat3x4_invert_rigid (mat3x4 a) {
+  mat3x4 out;
+  glisy_mat3x4_invert_rigid_into(&out, &a);
+  return out;
+}
+
+#define mat3x4_invert_rigid(a) glisy_mat3x4_invert_rigid((a))
+
+/**
+ * Transforms point v by mat3x4 a, applying the translation.
+ */
+
+static inline void
+glisy_mat3x4_transform_point_into (vec3 *out, const mat3x4 *a, const vec3 *v) {
+  float x = v->x, y = v->y, z = v->z;
+  *out = (vec3) {
+    a->m11 * x + a->m12 * y + a->m13 * z + a->m14,
+    a->m21 * x + a->m22 * y + a->m23 * z + a->m24,
+    a->m31 * x + a->m32 * y + a->m33 * z + a->m34
+  };
+}
+
+static inline vec3
+glisy_mat3x4_transform_point (mat3x4 a, vec3 v) {
+  vec3 out;
+  glisy_mat3x4_transform_point_into(&out, &a, &v);
+  return out;
+}
+
+#define mat3x4_transform_point(a, v) glisy_mat3x4_transform_point((a), (v))
+
+/**
+ * Transforms direction v by mat3x4 a, ignoring the translation.
+ */
+
+static inline void
+glisy_mat3x4_transform_vector_into (vec3 *out,
+                                    const mat3x4 *a,
+                                    const vec3 *v) {
+  float x = v->x, y = v->y, z = v->z;
+  *out = (vec3) {
+    a->m11 * x + a->m12 * y + a->m13 * z,
+    a->m21 * x + a->m22 * y + a->m23 * z,
+    a->m31 * x + a->m32 * y + a->m33 * z
+  };
+}
+
+static inline vec3
+glisy_mat3x4_transform_vector (mat3x4 a, vec3 v) {
+  vec3 out;
+  glisy_mat3x4_transform_vector_into(&out, &a, &v);
+  return out;
+}
+
+#define mat3x4_transform_vector(a, v) glisy_mat3x4_transform_vector((a), (v))
+
+/**
+ * Batch conversions between count contiguous mat4s and mat3x4s.
+ * Packing a palette of affine mat4s with glisy_mat3x4_from_mat4_batch
+ * before upload moves 48 bytes per matrix instead of 64.
+ */
+
+static inline void
+glisy_mat3x4_from_mat4_batch (mat3x4 *out, const mat4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_from_mat4_into(&out[i], &in[i]);
+  }
+}
+
+static inline void
+glisy_mat3x4_to_mat4_batch (mat4 *out, const mat3x4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_to_mat4_into(&out[i], &in[i]);
+  }
+}
+
+/**
+ * Batch form of mat3x4_multiply over count contiguous pairs,
+ * out[i] = a[i] * b[i], such as world transforms times inverse
+ * bind poses for a skinning palette. out may be a or b.
+ */
+
+static inline void
+glisy_mat3x4_multiply_batch (mat3x4 *out,
+                             const mat3x4 *a,
+                             const mat3x4 *b,
+                             size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_multiply_into(&out[i], &a[i], &b[i]);
+  }
+}
+
+/**
+ * Multiplies mat3x4 a by each of count contiguous mat3x4s in b,
+ * out[i] = a * b[i]. out may be b.
+ */
+
+static inline void
+glisy_mat3x4_multiply_each (mat3x4 *out,
+                            const mat3x4 *a,
+                            const mat3x4 *b,
+                            size_t count) {
+  mat3x4 m = *a;
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_multiply_into(&out[i], &m, &b[i]);
+  }
+}
+
+/**
+ * Batch forms of mat3x4_invert and mat3x4_invert_rigid over count
+ * contiguous mat3x4s. out may be in.
+ */
+
+static inline void
+glisy_mat3x4_invert_batch (mat3x4 *out, const mat3x4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_invert_into(&out[i], &in[i]);
+  }
+}
+
+static inline void
+glisy_mat3x4_invert_rigid_batch (mat3x4 *out,
+                                 const mat3x4 *in,
+                                 size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_invert_rigid_into(&out[i], &in[i]);
+  }
+}
+
+/**
+ * Transforms count contiguous points by mat3x4 a. The SIMD kernel
+ * transposes GLISY_LANES points at a time into x, y and z lanes like
+ * glisy_vec3_transform_mat4_affine_batch. out may be in.
+ */
+
+static inline void
+glisy_mat3x4_transform_point_batch_scalar (vec3 *out,
+                                           const vec3 *in,
+                                           size_t count,
+                                           const mat3x4 *a) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat3x4_transform_point_into(&out[i], a, &in[i]);
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat3x4_transform_point_batch_simd (vec3 *out,
+                                         const vec3 *in,
+                                         size_t count,
+                                         const mat3x4 *a) {
+  glisy_lane m[12];
+  size_t i = 0;
+  for (int e = 0; e < 12; ++e) {
+    m[e] = glisy_lane_splat((&a->m11)[e]);
+  }
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane x, y, z;
+    glisy_vec3_load_lanes(in + i, &x, &y, &z);
+    glisy_lane rx = glisy_lane_madd(z, m[2], glisy_lane_madd(y, m[1],
+                    glisy_lane_madd(x, m[0], m[3])));
+    glisy_lane ry = glisy_lane_madd(z, m[6], glisy_lane_madd(y, m[5],
+                    glisy_lane_madd(x, m[4], m[7])));
+    glisy_lane rz = glisy_lane_madd(z, m[10], glisy_lane_madd(y, m[9],
+                    glisy_lane_madd(x, m[8], m[11])));
+    glisy_vec3_store_lanes(out + i, rx, ry, rz);
+  }
+  glisy_mat3x4_transform_point_batch_scalar(out + i, in + i, count - i, a);
+}
+#endif
+
+static inline void
+glisy_mat3x4_transform_point_batch (vec3 *out,
+                                    const vec3 *in,
+                                    size_t count,
+                                    const mat3x4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat3x4_transform_point_batch_simd(out, in, count, a);
+#else
+  glisy_mat3x4_transform_point_batch_scalar(out, in, count, a);
+#endif
+}
+
+/**
+ * Writes a string representation of mat3x4 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_mat3x4_format (char *buf, size_t size, mat3x4 a) {
+  return glisy_format_floats(buf, size, "mat3x4", &a.m11, 12, 4);
+}
+
+#define mat3x4_format(buf, size, a) glisy_mat3x4_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(mat3x4)
+
+/**
+ * Returns a string representation of mat3x4 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_mat3x4_string (mat3x4 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_mat3x4_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define mat3x4_string(a) glisy_mat3x4_string((a))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,12 +1,16 @@
 #ifndef GLISY_MAT4_H
 #define GLISY_MAT4_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
 
 /**
- * mat4 struct type.
+ * mat4 struct type. Aligned to 16 bytes so each
+ * row of four floats loads as one SSE register.
  */
 
 typedef struct mat4 mat4;
@@ -15,7 +19,20 @@ struct mat4 {
   float m21; float m22; float m23; float m24;
   float m31; float m32; float m33; float m34;
   float m41; float m42; float m43; float m44;
-};
+} GLISY_ALIGN(16);
+
+/**
+ * Types used by mat4 routines. Included after the
+ * mat4 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/math.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * mat4 initializers.
@@ -32,661 +49,1313 @@ struct mat4 {
  * Clones and returns mat4 a.
  */
 
-#define mat4_clone(a) ((mat4){(a).m11, (a).m12, (a).m13, (a).m14,  \
-                               (a).m21, (a).m22, (a).m23, (a).m24, \
-                               (a).m31, (a).m32, (a).m33, (a).m34, \
-                               (a).m41, (a).m42, (a).m43, (a).m44})
+static inline mat4
+glisy_mat4_clone (mat4 a) {
+  return (mat4) {a.m11, a.m12, a.m13, a.m14,
+                 a.m21, a.m22, a.m23, a.m24,
+                 a.m31, a.m32, a.m33, a.m34,
+                 a.m41, a.m42, a.m43, a.m44};
+}
+
+#define mat4_clone(a) glisy_mat4_clone((a))
 
 /**
  * Copies mat4 b into mat4 a.
  */
 
-#define mat4_copy(a, b)  ({                                                       \
-  mat4 *tmp = (mat4 *) &(a);                                                      \
-  (tmp->m11 = b.m11), (tmp->m12 = b.m12), (tmp->m13 = b.m13), (tmp->m14 = b.m14); \
-  (tmp->m21 = b.m21), (tmp->m22 = b.m22), (tmp->m23 = b.m23), (tmp->m24 = b.m24); \
-  (tmp->m31 = b.m31), (tmp->m32 = b.m32), (tmp->m33 = b.m33), (tmp->m34 = b.m34); \
-  (tmp->m41 = b.m41), (tmp->m42 = b.m42), (tmp->m43 = b.m43), (tmp->m44 = b.m44); \
-  (*tmp);                                                                         \
-})
+static inline mat4
+glisy_mat4_copy (mat4 *a, mat4 b) {
+  a->m11 = b.m11; a->m12 = b.m12; a->m13 = b.m13; a->m14 = b.m14;
+  a->m21 = b.m21; a->m22 = b.m22; a->m23 = b.m23; a->m24 = b.m24;
+  a->m31 = b.m31; a->m32 = b.m32; a->m33 = b.m33; a->m34 = b.m34;
+  a->m41 = b.m41; a->m42 = b.m42; a->m43 = b.m43; a->m44 = b.m44;
+  return *a;
+}
+
+#define mat4_copy(a, b) glisy_mat4_copy(&(a), (b))
 
 /**
  * Sets an identity for mat4 a.
  */
 
-#define mat4_identity(a)  ({                                      \
-  mat4 *tmp = (mat4 *) &(a);                                      \
-  (tmp->m11 = 1), (tmp->m12 = 0), (tmp->m13 = 0), (tmp->m14 = 0); \
-  (tmp->m21 = 0), (tmp->m22 = 1), (tmp->m23 = 0), (tmp->m24 = 0); \
-  (tmp->m31 = 0), (tmp->m32 = 0), (tmp->m33 = 1), (tmp->m34 = 0); \
-  (tmp->m41 = 0), (tmp->m42 = 0), (tmp->m43 = 0), (tmp->m44 = 1); \
-  (*tmp);                                                         \
-})
+static inline mat4
+glisy_mat4_identity (mat4 *a) {
+  a->m11 = 1; a->m12 = 0; a->m13 = 0; a->m14 = 0;
+  a->m21 = 0; a->m22 = 1; a->m23 = 0; a->m24 = 0;
+  a->m31 = 0; a->m32 = 0; a->m33 = 1; a->m34 = 0;
+  a->m41 = 0; a->m42 = 0; a->m43 = 0; a->m44 = 1;
+  return *a;
+}
+
+#define mat4_identity(a) glisy_mat4_identity(&(a))
 
 /**
  * Transposes mat4 a.
  */
 
-#define mat4_transpose(a) ((mat4){     \
-  (a).m11, (a).m21, (a).m31, (a).m41,  \
-  (a).m12, (a).m22, (a).m32, (a).m42,  \
-  (a).m13, (a).m23, (a).m33, (a).m43,  \
-  (a).m14, (a).m24, (a).m34, (a).m44   \
-})
+static inline void
+glisy_mat4_transpose_scalar (mat4 *out, const mat4 *a) {
+  *out = (mat4) {a->m11, a->m21, a->m31, a->m41,
+                 a->m12, a->m22, a->m32, a->m42,
+                 a->m13, a->m23, a->m33, a->m43,
+                 a->m14, a->m24, a->m34, a->m44};
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_transpose_sse (mat4 *out, const mat4 *a) {
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 r3 = _mm_load_ps(&a->m41);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_store_ps(&out->m11, r0);
+  _mm_store_ps(&out->m21, r1);
+  _mm_store_ps(&out->m31, r2);
+  _mm_store_ps(&out->m41, r3);
+}
+#endif
+
+static inline void
+glisy_mat4_transpose_into (mat4 *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat4_transpose_sse(out, a);
+#else
+  glisy_mat4_transpose_scalar(out, a);
+#endif
+}
+
+static inline mat4
+glisy_mat4_transpose (mat4 a) {
+  mat4 out;
+  glisy_mat4_transpose_into(&out, &a);
+  return out;
+}
+
+#define mat4_transpose(a) glisy_mat4_transpose((a))
 
 /**
  * Calculates and returns inverse for mat4 a.
  */
 
-#define mat4_invert(a)  ({                                           \
-  mat4 b = mat4(0);                                                  \
-                                                                     \
-  double a00 = (a).m11, a01 = (a).m12, a02 = (a).m13, a03 = (a).m14;  \
-  double a10 = (a).m21, a11 = (a).m22, a12 = (a).m23, a13 = (a).m24;  \
-  double a20 = (a).m31, a21 = (a).m32, a22 = (a).m33, a23 = (a).m34;  \
-  double a30 = (a).m41, a31 = (a).m42, a32 = (a).m43, a33 = (a).m44;  \
-                                                                     \
-  double b00 = a00 * a11 - a01 * a10;                                 \
-  double b01 = a00 * a12 - a02 * a10;                                 \
-  double b02 = a00 * a13 - a03 * a10;                                 \
-  double b03 = a01 * a12 - a02 * a11;                                 \
-  double b04 = a01 * a13 - a03 * a11;                                 \
-  double b05 = a02 * a13 - a03 * a12;                                 \
-  double b06 = a20 * a31 - a21 * a30;                                 \
-  double b07 = a20 * a32 - a22 * a30;                                 \
-  double b08 = a20 * a33 - a23 * a30;                                 \
-  double b09 = a21 * a32 - a22 * a31;                                 \
-  double b10 = a21 * a33 - a23 * a31;                                 \
-  double b11 = a22 * a33 - a23 * a32;                                 \
-                                                                     \
-  double det = b00 * b11 - b01 * b10                                  \
-            + b02 * b09 + b03 * b08                                  \
-            - b04 * b07 + b05 * b06;                                 \
-                                                                     \
-  if (det) {                                                         \
-    det = 1.0 / det;                                                 \
-                                                                     \
-    b.m11 = (a11 * b11 - a12 * b10 + a13 * b09) * det;               \
-    b.m12 = (a02 * b10 - a01 * b11 - a03 * b09) * det;               \
-    b.m13 = (a31 * b05 - a32 * b04 + a33 * b03) * det;               \
-    b.m14 = (a22 * b04 - a21 * b05 - a23 * b03) * det;               \
-                                                                     \
-    b.m21 = (a12 * b08 - a10 * b11 - a13 * b07) * det;               \
-    b.m22 = (a00 * b11 - a02 * b08 + a03 * b07) * det;               \
-    b.m23 = (a32 * b02 - a30 * b05 - a33 * b01) * det;               \
-    b.m24 = (a20 * b05 - a22 * b02 + a23 * b01) * det;               \
-                                                                     \
-    b.m31 = (a10 * b10 - a11 * b08 + a13 * b06) * det;               \
-    b.m32 = (a01 * b08 - a00 * b10 - a03 * b06) * det;               \
-    b.m33 = (a30 * b04 - a31 * b02 + a33 * b00) * det;               \
-    b.m34 = (a21 * b02 - a20 * b04 - a23 * b00) * det;               \
-                                                                     \
-    b.m41 = (a11 * b07 - a10 * b09 - a12 * b06) * det;               \
-    b.m42 = (a00 * b09 - a01 * b07 + a02 * b06) * det;               \
-    b.m43 = (a31 * b01 - a30 * b03 - a32 * b00) * det;               \
-    b.m44 = (a20 * b03 - a21 * b01 + a22 * b00) * det;               \
-  }                                                                  \
-  (b);                                                               \
-})
+static inline void
+glisy_mat4_invert_scalar (mat4 *out, const mat4 *a) {
+  mat4 b = {0};
+
+  double a00 = a->m11, a01 = a->m12, a02 = a->m13, a03 = a->m14;
+  double a10 = a->m21, a11 = a->m22, a12 = a->m23, a13 = a->m24;
+  double a20 = a->m31, a21 = a->m32, a22 = a->m33, a23 = a->m34;
+  double a30 = a->m41, a31 = a->m42, a32 = a->m43, a33 = a->m44;
+
+  double b00 = a00 * a11 - a01 * a10;
+  double b01 = a00 * a12 - a02 * a10;
+  double b02 = a00 * a13 - a03 * a10;
+  double b03 = a01 * a12 - a02 * a11;
+  double b04 = a01 * a13 - a03 * a11;
+  double b05 = a02 * a13 - a03 * a12;
+  double b06 = a20 * a31 - a21 * a30;
+  double b07 = a20 * a32 - a22 * a30;
+  double b08 = a20 * a33 - a23 * a30;
+  double b09 = a21 * a32 - a22 * a31;
+  double b10 = a21 * a33 - a23 * a31;
+  double b11 = a22 * a33 - a23 * a32;
+
+  double det = b00 * b11 - b01 * b10
+             + b02 * b09 + b03 * b08
+             - b04 * b07 + b05 * b06;
+
+  if (det) {
+    det = 1.0 / det;
+
+    b.m11 = (a11 * b11 - a12 * b10 + a13 * b09) * det;
+    b.m12 = (a02 * b10 - a01 * b11 - a03 * b09) * det;
+    b.m13 = (a31 * b05 - a32 * b04 + a33 * b03) * det;
+    b.m14 = (a22 * b04 - a21 * b05 - a23 * b03) * det;
+
+    b.m21 = (a12 * b08 - a10 * b11 - a13 * b07) * det;
+    b.m22 = (a00 * b11 - a02 * b08 + a03 * b07) * det;
+    b.m23 = (a32 * b02 - a30 * b05 - a33 * b01) * det;
+    b.m24 = (a20 * b05 - a22 * b02 + a23 * b01) * det;
+
+    b.m31 = (a10 * b10 - a11 * b08 + a13 * b06) * det;
+    b.m32 = (a01 * b08 - a00 * b10 - a03 * b06) * det;
+    b.m33 = (a30 * b04 - a31 * b02 + a33 * b00) * det;
+    b.m34 = (a21 * b02 - a20 * b04 - a23 * b00) * det;
+
+    b.m41 = (a11 * b07 - a10 * b09 - a12 * b06) * det;
+    b.m42 = (a00 * b09 - a01 * b07 + a02 * b06) * det;
+    b.m43 = (a31 * b01 - a30 * b03 - a32 * b00) * det;
+    b.m44 = (a20 * b03 - a21 * b01 + a22 * b00) * det;
+  }
+  *out = b;
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * 2x2 block helpers for glisy_mat4_invert_sse. Each __m128
+ * holds a 2x2 matrix as (m11, m12, m21, m22). mul2x2 is A * B,
+ * adjmul2x2 is adj(A) * B and muladj2x2 is A * adj(B).
+ */
+
+static inline __m128
+glisy_mat4_mul2x2 (__m128 a, __m128 b) {
+  return _mm_add_ps(
+    _mm_mul_ps(a, _mm_shuffle_ps(b, b, GLISY_SHUFFLE(0, 3, 0, 3))),
+    _mm_mul_ps(_mm_shuffle_ps(a, a, GLISY_SHUFFLE(1, 0, 3, 2)),
+               _mm_shuffle_ps(b, b, GLISY_SHUFFLE(2, 1, 2, 1))));
+}
+
+static inline __m128
+glisy_mat4_adjmul2x2 (__m128 a, __m128 b) {
+  return _mm_sub_ps(
+    _mm_mul_ps(_mm_shuffle_ps(a, a, GLISY_SHUFFLE(3, 3, 0, 0)), b),
+    _mm_mul_ps(_mm_shuffle_ps(a, a, GLISY_SHUFFLE(1, 1, 2, 2)),
+               _mm_shuffle_ps(b, b, GLISY_SHUFFLE(2, 3, 0, 1))));
+}
+
+static inline __m128
+glisy_mat4_muladj2x2 (__m128 a, __m128 b) {
+  return _mm_sub_ps(
+    _mm_mul_ps(a, _mm_shuffle_ps(b, b, GLISY_SHUFFLE(3, 0, 3, 0))),
+    _mm_mul_ps(_mm_shuffle_ps(a, a, GLISY_SHUFFLE(1, 0, 3, 2)),
+               _mm_shuffle_ps(b, b, GLISY_SHUFFLE(2, 1, 2, 1))));
+}
+
+/**
+ * Single precision inverse using Cramer's rule on 2x2 blocks.
+ * Because inv(transpose(M)) = transpose(inv(M)) the kernel is
+ * layout agnostic. Against the double precision scalar path the
+ * result stays within 8 ulp per element for matrices with a
+ * condition number below 1e3 (rigid, scale and projection
+ * transforms); error grows linearly with the condition number.
+ */
+
+static inline void
+glisy_mat4_invert_sse (mat4 *out, const mat4 *m) {
+  __m128 r0 = _mm_load_ps(&m->m11);
+  __m128 r1 = _mm_load_ps(&m->m21);
+  __m128 r2 = _mm_load_ps(&m->m31);
+  __m128 r3 = _mm_load_ps(&m->m41);
+
+  __m128 a = _mm_movelh_ps(r0, r1);
+  __m128 b = _mm_movehl_ps(r1, r0);
+  __m128 c = _mm_movelh_ps(r2, r3);
+  __m128 d = _mm_movehl_ps(r3, r2);
+
+  // (|A|, |B|, |C|, |D|)
+  __m128 dets = _mm_sub_ps(
+    _mm_mul_ps(_mm_shuffle_ps(r0, r2, GLISY_SHUFFLE(0, 2, 0, 2)),
+               _mm_shuffle_ps(r1, r3, GLISY_SHUFFLE(1, 3, 1, 3))),
+    _mm_mul_ps(_mm_shuffle_ps(r0, r2, GLISY_SHUFFLE(1, 3, 1, 3)),
+               _mm_shuffle_ps(r1, r3, GLISY_SHUFFLE(0, 2, 0, 2))));
+
+  __m128 deta = glisy_simd_splat(dets, 0);
+  __m128 detb = glisy_simd_splat(dets, 1);
+  __m128 detc = glisy_simd_splat(dets, 2);
+  __m128 detd = glisy_simd_splat(dets, 3);
+
+  __m128 dc = glisy_mat4_adjmul2x2(d, c);
+  __m128 ab = glisy_mat4_adjmul2x2(a, b);
+
+  __m128 x = _mm_sub_ps(_mm_mul_ps(detd, a), glisy_mat4_mul2x2(b, dc));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(deta, d), glisy_mat4_mul2x2(c, ab));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(detb, c), glisy_mat4_muladj2x2(d, ab));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(detc, b), glisy_mat4_muladj2x2(a, dc));
+
+  __m128 tr = glisy_simd_hsum(
+    _mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, GLISY_SHUFFLE(0, 2, 1, 3))));
+  __m128 det = _mm_sub_ps(
+    _mm_add_ps(_mm_mul_ps(deta, detd), _mm_mul_ps(detb, detc)), tr);
+
+  if (0 == _mm_cvtss_f32(det)) {
+    *out = (mat4) {0};
+    return;
+  }
+
+  __m128 rdet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+  x = _mm_mul_ps(x, rdet);
+  y = _mm_mul_ps(y, rdet);
+  z = _mm_mul_ps(z, rdet);
+  w = _mm_mul_ps(w, rdet);
+
+  _mm_store_ps(&out->m11, _mm_shuffle_ps(x, y, GLISY_SHUFFLE(3, 1, 3, 1)));
+  _mm_store_ps(&out->m21, _mm_shuffle_ps(x, y, GLISY_SHUFFLE(2, 0, 2, 0)));
+  _mm_store_ps(&out->m31, _mm_shuffle_ps(z, w, GLISY_SHUFFLE(3, 1, 3, 1)));
+  _mm_store_ps(&out->m41, _mm_shuffle_ps(z, w, GLISY_SHUFFLE(2, 0, 2, 0)));
+}
+#endif
+
+static inline void
+glisy_mat4_invert_into (mat4 *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat4_invert_sse(out, a);
+#else
+  glisy_mat4_invert_scalar(out, a);
+#endif
+}
+
+static inline mat4
+glisy_mat4_invert (mat4 a) {
+  mat4 out;
+  glisy_mat4_invert_into(&out, &a);
+  return out;
+}
+
+#define mat4_invert(a) glisy_mat4_invert((a))
+
+/**
+ * Inverts an affine mat4 a, one whose projective column (m14, m24,
+ * m34) is zero and m44 is one. Only the upper 3x3 block is inverted
+ * and the translation becomes -t * inverse(A), so this does about a
+ * third of the work of mat4_invert. A singular a yields all zeros,
+ * like mat4_invert.
+ */
+
+static inline void
+glisy_mat4_invert_affine_scalar (mat4 *out, const mat4 *a) {
+  float a00 = a->m11, a01 = a->m12, a02 = a->m13;
+  float a10 = a->m21, a11 = a->m22, a12 = a->m23;
+  float a20 = a->m31, a21 = a->m32, a22 = a->m33;
+  float tx = a->m41, ty = a->m42, tz = a->m43;
+
+  float b00 = a11 * a22 - a12 * a21;
+  float b10 = a12 * a20 - a10 * a22;
+  float b20 = a10 * a21 - a11 * a20;
+  float det = a00 * b00 + a01 * b10 + a02 * b20;
+
+  if (!det) {
+    *out = (mat4) {0};
+    return;
+  }
+
+  det = 1.0f / det;
+  float i00 = b00 * det;
+  float i01 = (a02 * a21 - a01 * a22) * det;
+  float i02 = (a01 * a12 - a02 * a11) * det;
+  float i10 = b10 * det;
+  float i11 = (a00 * a22 - a02 * a20) * det;
+  float i12 = (a02 * a10 - a00 * a12) * det;
+  float i20 = b20 * det;
+  float i21 = (a01 * a20 - a00 * a21) * det;
+  float i22 = (a00 * a11 - a01 * a10) * det;
+
+  *out = (mat4) {
+    i00, i01, i02, 0,
+    i10, i11, i12, 0,
+    i20, i21, i22, 0,
+    -(tx * i00 + ty * i10 + tz * i20),
+    -(tx * i01 + ty * i11 + tz * i21),
+    -(tx * i02 + ty * i12 + tz * i22),
+    1
+  };
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Returns the cross product of the xyz lanes of a and b. The w
+ * lane is always zero.
+ */
+
+static inline __m128
+glisy_mat4_cross3 (__m128 a, __m128 b) {
+  __m128 a1 = _mm_shuffle_ps(a, a, GLISY_SHUFFLE(1, 2, 0, 3));
+  __m128 b1 = _mm_shuffle_ps(b, b, GLISY_SHUFFLE(1, 2, 0, 3));
+  __m128 c = _mm_sub_ps(_mm_mul_ps(a, b1), _mm_mul_ps(a1, b));
+  return _mm_shuffle_ps(c, c, GLISY_SHUFFLE(1, 2, 0, 3));
+}
+
+/**
+ * Returns (0, 0, 0, 1) - t.x * r0 - t.y * r1 - t.z * r2, the
+ * translation row of an inverse with rotation rows r0, r1, r2.
+ */
+
+static inline __m128
+glisy_mat4_inverse_translation (__m128 t, __m128 r0, __m128 r1, __m128 r2) {
+  __m128 v = _mm_mul_ps(glisy_simd_splat(t, 0), r0);
+  v = glisy_simd_madd(glisy_simd_splat(t, 1), r1, v);
+  v = glisy_simd_madd(glisy_simd_splat(t, 2), r2, v);
+  return _mm_sub_ps(_mm_setr_ps(0, 0, 0, 1), v);
+}
+
+/**
+ * The rows of inverse(A) are the transposed cross products of the
+ * rows of A divided by its determinant.
+ */
+
+static inline void
+glisy_mat4_invert_affine_sse (mat4 *out, const mat4 *a) {
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 t = _mm_load_ps(&a->m41);
+
+  __m128 c0 = glisy_mat4_cross3(r1, r2);
+  __m128 c1 = glisy_mat4_cross3(r2, r0);
+  __m128 c2 = glisy_mat4_cross3(r0, r1);
+  __m128 det = glisy_simd_hsum(_mm_mul_ps(r0, c0));
+
+  if (0 == _mm_cvtss_f32(det)) {
+    *out = (mat4) {0};
+    return;
+  }
+
+  __m128 rdet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+  __m128 c3 = _mm_setzero_ps();
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  c0 = _mm_mul_ps(c0, rdet);
+  c1 = _mm_mul_ps(c1, rdet);
+  c2 = _mm_mul_ps(c2, rdet);
+
+  _mm_store_ps(&out->m11, c0);
+  _mm_store_ps(&out->m21, c1);
+  _mm_store_ps(&out->m31, c2);
+  _mm_store_ps(&out->m41, glisy_mat4_inverse_translation(t, c0, c1, c2));
+}
+#endif
+
+static inline void
+glisy_mat4_invert_affine_into (mat4 *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat4_invert_affine_sse(out, a);
+#else
+  glisy_mat4_invert_affine_scalar(out, a);
+#endif
+}
+
+static inline mat4
+glisy_mat4_invert_affine (mat4 a) {
+  mat4 out;
+  glisy_mat4_invert_affine_into(&out, &a);
+  return out;
+}
+
+#define mat4_invert_affine(a) glisy_mat4_invert_affine((a))
+
+/**
+ * Inverts a rigid mat4 a, a rotation followed by a translation
+ * with no scale. The rotation is orthonormal so its inverse is its
+ * transpose; no determinant is computed.
+ */
+
+static inline void
+glisy_mat4_invert_rigid_scalar (mat4 *out, const mat4 *a) {
+  float a00 = a->m11, a01 = a->m12, a02 = a->m13;
+  float a10 = a->m21, a11 = a->m22, a12 = a->m23;
+  float a20 = a->m31, a21 = a->m32, a22 = a->m33;
+  float tx = a->m41, ty = a->m42, tz = a->m43;
+  *out = (mat4) {
+    a00, a10, a20, 0,
+    a01, a11, a21, 0,
+    a02, a12, a22, 0,
+    -(tx * a00 + ty * a01 + tz * a02),
+    -(tx * a10 + ty * a11 + tz * a12),
+    -(tx * a20 + ty * a21 + tz * a22),
+    1
+  };
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_invert_rigid_sse (mat4 *out, const mat4 *a) {
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 r3 = _mm_setzero_ps();
+  __m128 t = _mm_load_ps(&a->m41);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_store_ps(&out->m11, r0);
+  _mm_store_ps(&out->m21, r1);
+  _mm_store_ps(&out->m31, r2);
+  _mm_store_ps(&out->m41, glisy_mat4_inverse_translation(t, r0, r1, r2));
+}
+#endif
+
+static inline void
+glisy_mat4_invert_rigid_into (mat4 *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  glisy_mat4_invert_rigid_sse(out, a);
+#else
+  glisy_mat4_invert_rigid_scalar(out, a);
+#endif
+}
+
+static inline mat4
+glisy_mat4_invert_rigid (mat4 a) {
+  mat4 out;
+  glisy_mat4_invert_rigid_into(&out, &a);
+  return out;
+}
+
+#define mat4_invert_rigid(a) glisy_mat4_invert_rigid((a))
+
+/**
+ * Batch forms of mat4_invert_affine and mat4_invert_rigid over
+ * count contiguous mat4s. out may be in. mat4_block.h has lane
+ * parallel versions for packed blocks.
+ */
+
+static inline void
+glisy_mat4_invert_affine_batch (mat4 *out, const mat4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat4_invert_affine_into(&out[i], &in[i]);
+  }
+}
+
+static inline void
+glisy_mat4_invert_rigid_batch (mat4 *out, const mat4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat4_invert_rigid_into(&out[i], &in[i]);
+  }
+}
 
 /**
  * Calculates adjugate of mat4 a.
  */
 
-#define mat4_adjoint(a)  ({                                          \
-  mat4 b = mat4(0);                                                  \
-                                                                     \
-  double a00 = (a).m11, a01 = (a).m12, a02 = (a).m13, a03 = (a).m14;  \
-  double a10 = (a).m21, a11 = (a).m22, a12 = (a).m23, a13 = (a).m24;  \
-  double a20 = (a).m31, a21 = (a).m32, a22 = (a).m33, a23 = (a).m34;  \
-  double a30 = (a).m41, a31 = (a).m42, a32 = (a).m43, a33 = (a).m44;  \
-                                                                     \
-  b.m11 =   (a11 * (a22 * a33 - a23 * a32)                           \
-           - a21 * (a12 * a33 - a13 * a32)                           \
-           + a31 * (a12 * a23 - a13 * a22));                         \
-                                                                     \
-  b.m12 = - (a01 * (a22 * a33 - a23 * a32)                           \
-           - a21 * (a02 * a33 - a03 * a32)                           \
-           + a31 * (a02 * a23 - a03 * a22));                         \
-                                                                     \
-  b.m13 =   (a01 * (a12 * a33 - a13 * a32)                           \
-           - a11 * (a02 * a33 - a03 * a32)                           \
-           + a31 * (a02 * a13 - a03 * a12));                         \
-                                                                     \
-  b.m14 = - (a01 * (a12 * a23 - a13 * a22)                           \
-           - a11 * (a02 * a23 - a03 * a22)                           \
-           + a21 * (a02 * a13 - a03 * a12));                         \
-                                                                     \
-  b.m21 = - (a10 * (a22 * a33 - a23 * a32)                           \
-           - a20 * (a12 * a33 - a13 * a32)                           \
-           + a30 * (a12 * a23 - a13 * a22));                         \
-                                                                     \
-  b.m22 =  (a00 * (a22 * a33 - a23 * a32)                            \
-          - a20 * (a02 * a33 - a03 * a32)                            \
-          + a30 * (a02 * a23 - a03 * a22));                          \
-                                                                     \
-  b.m23 = - (a00 * (a12 * a33 - a13 * a32)                           \
-           - a10 * (a02 * a33 - a03 * a32)                           \
-           + a30 * (a02 * a13 - a03 * a12));                         \
-                                                                     \
-  b.m24 =  (a00 * (a12 * a23 - a13 * a22)                            \
-          - a10 * (a02 * a23 - a03 * a22)                            \
-          + a20 * (a02 * a13 - a03 * a12));                          \
-                                                                     \
-  b.m31 =  (a10 * (a21 * a33 - a23 * a31)                            \
-          - a20 * (a11 * a33 - a13 * a31)                            \
-          + a30 * (a11 * a23 - a13 * a21));                          \
-                                                                     \
-  b.m32 = - (a00 * (a21 * a33 - a23 * a31)                           \
-           - a20 * (a01 * a33 - a03 * a31)                           \
-           + a30 * (a01 * a23 - a03 * a21));                         \
-                                                                     \
-  b.m33 =  (a00 * (a11 * a33 - a13 * a31)                            \
-          - a10 * (a01 * a33 - a03 * a31)                            \
-          + a30 * (a01 * a13 - a03 * a11));                          \
-                                                                     \
-  b.m34 = - (a00 * (a11 * a23 - a13 * a21)                           \
-           - a10 * (a01 * a23 - a03 * a21)                           \
-           + a20 * (a01 * a13 - a03 * a11));                         \
-                                                                     \
-  b.m41 = - (a10 * (a21 * a32 - a22 * a31)                           \
-           - a20 * (a11 * a32 - a12 * a31)                           \
-           + a30 * (a11 * a22 - a12 * a21));                         \
-                                                                     \
-  b.m42 =  (a00 * (a21 * a32 - a22 * a31)                            \
-          - a20 * (a01 * a32 - a02 * a31)                            \
-          + a30 * (a01 * a22 - a02 * a21));                          \
-                                                                     \
-  b.m43 = - (a00 * (a11 * a32 - a12 * a31)                           \
-           - a10 * (a01 * a32 - a02 * a31)                           \
-           + a30 * (a01 * a12 - a02 * a11));                         \
-                                                                     \
-  b.m44 =  (a00 * (a11 * a22 - a12 * a21)                            \
-          - a10 * (a01 * a22 - a02 * a21)                            \
-          + a20 * (a01 * a12 - a02 * a11));                          \
-                                                                     \
-  (b);                                                               \
-})
+static inline void
+glisy_mat4_adjoint_into (mat4 *out, const mat4 *a) {
+  mat4 b;
+
+  double a00 = a->m11, a01 = a->m12, a02 = a->m13, a03 = a->m14;
+  double a10 = a->m21, a11 = a->m22, a12 = a->m23, a13 = a->m24;
+  double a20 = a->m31, a21 = a->m32, a22 = a->m33, a23 = a->m34;
+  double a30 = a->m41, a31 = a->m42, a32 = a->m43, a33 = a->m44;
+
+  b.m11 =   (a11 * (a22 * a33 - a23 * a32)
+           - a21 * (a12 * a33 - a13 * a32)
+           + a31 * (a12 * a23 - a13 * a22));
+
+  b.m12 = - (a01 * (a22 * a33 - a23 * a32)
+           - a21 * (a02 * a33 - a03 * a32)
+           + a31 * (a02 * a23 - a03 * a22));
+
+  b.m13 =   (a01 * (a12 * a33 - a13 * a32)
+           - a11 * (a02 * a33 - a03 * a32)
+           + a31 * (a02 * a13 - a03 * a12));
+
+  b.m14 = - (a01 * (a12 * a23 - a13 * a22)
+           - a11 * (a02 * a23 - a03 * a22)
+           + a21 * (a02 * a13 - a03 * a12));
+
+  b.m21 = - (a10 * (a22 * a33 - a23 * a32)
+           - a20 * (a12 * a33 - a13 * a32)
+           + a30 * (a12 * a23 - a13 * a22));
+
+  b.m22 =  (a00 * (a22 * a33 - a23 * a32)
+          - a20 * (a02 * a33 - a03 * a32)
+          + a30 * (a02 * a23 - a03 * a22));
+
+  b.m23 = - (a00 * (a12 * a33 - a13 * a32)
+           - a10 * (a02 * a33 - a03 * a32)
+           + a30 * (a02 * a13 - a03 * a12));
+
+  b.m24 =  (a00 * (a12 * a23 - a13 * a22)
+          - a10 * (a02 * a23 - a03 * a22)
+          + a20 * (a02 * a13 - a03 * a12));
+
+  b.m31 =  (a10 * (a21 * a33 - a23 * a31)
+          - a20 * (a11 * a33 - a13 * a31)
+          + a30 * (a11 * a23 - a13 * a21));
+
+  b.m32 = - (a00 * (a21 * a33 - a23 * a31)
+           - a20 * (a01 * a33 - a03 * a31)
+           + a30 * (a01 * a23 - a03 * a21));
+
+  b.m33 =  (a00 * (a11 * a33 - a13 * a31)
+          - a10 * (a01 * a33 - a03 * a31)
+          + a30 * (a01 * a13 - a03 * a11));
+
+  b.m34 = - (a00 * (a11 * a23 - a13 * a21)
+           - a10 * (a01 * a23 - a03 * a21)
+           + a20 * (a01 * a13 - a03 * a11));
+
+  b.m41 = - (a10 * (a21 * a32 - a22 * a31)
+           - a20 * (a11 * a32 - a12 * a31)
+           + a30 * (a11 * a22 - a12 * a21));
+
+  b.m42 =  (a00 * (a21 * a32 - a22 * a31)
+          - a20 * (a01 * a32 - a02 * a31)
+          + a30 * (a01 * a22 - a02 * a21));
+
+  b.m43 = - (a00 * (a11 * a32 - a12 * a31)
+           - a10 * (a01 * a32 - a02 * a31)
+           + a30 * (a01 * a12 - a02 * a11));
+
+  b.m44 =  (a00 * (a11 * a22 - a12 * a21)
+          - a10 * (a01 * a22 - a02 * a21)
+          + a20 * (a01 * a12 - a02 * a11));
+
+  *out = b;
+}
+
+static inline mat4
+glisy_mat4_adjoint (mat4 a) {
+  mat4 out;
+  glisy_mat4_adjoint_into(&out, &a);
+  return out;
+}
+
+#define mat4_adjoint(a) glisy_mat4_adjoint((a))
 
 /**
  * Calculates determinant of mat4 a.
  */
 
-#define mat4_determinant(a) (double) ({                               \
-  double a00 = (a).m11, a01 = (a).m12, a02 = (a).m13, a03 = (a).m14;  \
-  double a10 = (a).m21, a11 = (a).m22, a12 = (a).m23, a13 = (a).m24;  \
-  double a20 = (a).m31, a21 = (a).m32, a22 = (a).m33, a23 = (a).m34;  \
-  double a30 = (a).m41, a31 = (a).m42, a32 = (a).m43, a33 = (a).m44;  \
-                                                                     \
-  double b00 = a00 * a11 - a01 * a10;                                 \
-  double b01 = a00 * a12 - a02 * a10;                                 \
-  double b02 = a00 * a13 - a03 * a10;                                 \
-  double b03 = a01 * a12 - a02 * a11;                                 \
-  double b04 = a01 * a13 - a03 * a11;                                 \
-  double b05 = a02 * a13 - a03 * a12;                                 \
-  double b06 = a20 * a31 - a21 * a30;                                 \
-  double b07 = a20 * a32 - a22 * a30;                                 \
-  double b08 = a20 * a33 - a23 * a30;                                 \
-  double b09 = a21 * a32 - a22 * a31;                                 \
-  double b10 = a21 * a33 - a23 * a31;                                 \
-  double b11 = a22 * a33 - a23 * a32;                                 \
-                                                                     \
-  double det = b00 * b11                                              \
-            - b01 * b10                                              \
-            + b02 * b09                                              \
-            + b03 * b08                                              \
-            - b04 * b07                                              \
-            + b05 * b06;                                             \
-  (det);                                                             \
-})
+static inline double
+glisy_mat4_determinant (mat4 a) {
+  double a00 = a.m11, a01 = a.m12, a02 = a.m13, a03 = a.m14;
+  double a10 = a.m21, a11 = a.m22, a12 = a.m23, a13 = a.m24;
+  double a20 = a.m31, a21 = a.m32, a22 = a.m33, a23 = a.m34;
+  double a30 = a.m41, a31 = a.m42, a32 = a.m43, a33 = a.m44;
+
+  double b00 = a00 * a11 - a01 * a10;
+  double b01 = a00 * a12 - a02 * a10;
+  double b02 = a00 * a13 - a03 * a10;
+  double b03 = a01 * a12 - a02 * a11;
+  double b04 = a01 * a13 - a03 * a11;
+  double b05 = a02 * a13 - a03 * a12;
+  double b06 = a20 * a31 - a21 * a30;
+  double b07 = a20 * a32 - a22 * a30;
+  double b08 = a20 * a33 - a23 * a30;
+  double b09 = a21 * a32 - a22 * a31;
+  double b10 = a21 * a33 - a23 * a31;
+  double b11 = a22 * a33 - a23 * a32;
+
+  return b00 * b11
+       - b01 * b10
+       + b02 * b09
+       + b03 * b08
+       - b04 * b07
+       + b05 * b06;
+}
+
+#define mat4_determinant(a) glisy_mat4_determinant((a))
 
 /**
  * Add mat4 a and mat4 b.
  */
 
-#define mat4_add(a, b) ((mat4){                                               \
-  (a).m11 + (b).m11, (a).m12 + (b).m12, (a).m13 + (b).m13, (a).m14 + (b).m14, \
-  (a).m21 + (b).m21, (b).m22 + (b).m22, (a).m23 + (b).m23, (a).m24 + (b).m24, \
-  (a).m31 + (b).m31, (b).m32 + (b).m32, (a).m33 + (b).m33, (a).m34 + (b).m34, \
-  (a).m41 + (b).m41, (b).m42 + (b).m42, (a).m43 + (b).m43, (a).m44 + (b).m44  \
-})
+static inline void
+glisy_mat4_add_into (mat4 *out, const mat4 *a, const mat4 *b) {
+  *out = (mat4) {
+    a->m11 + b->m11, a->m12 + b->m12, a->m13 + b->m13, a->m14 + b->m14,
+    a->m21 + b->m21, a->m22 + b->m22, a->m23 + b->m23, a->m24 + b->m24,
+    a->m31 + b->m31, a->m32 + b->m32, a->m33 + b->m33, a->m34 + b->m34,
+    a->m41 + b->m41, a->m42 + b->m42, a->m43 + b->m43, a->m44 + b->m44
+  };
+}
+
+static inline mat4
+glisy_mat4_add (mat4 a, mat4 b) {
+  mat4 out;
+  glisy_mat4_add_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_add(a, b) glisy_mat4_add((a), (b))
 
 /**
  * Subtract mat4 b from mat4 a.
  */
 
-#define mat4_subtract(a, b) ((mat4){                                          \
-  (a).m11 - (b).m11, (a).m12 - (b).m12, (a).m13 - (b).m13, (a).m14 - (b).m14, \
-  (a).m21 - (b).m21, (b).m22 - (b).m22, (a).m23 - (b).m23, (a).m24 - (b).m24, \
-  (a).m31 - (b).m31, (b).m32 - (b).m32, (a).m33 - (b).m33, (a).m34 - (b).m34, \
-  (a).m41 - (b).m41, (b).m42 - (b).m42, (a).m43 - (b).m43, (a).m44 - (b).m44  \
-})
+static inline void
+glisy_mat4_subtract_into (mat4 *out, const mat4 *a, const mat4 *b) {
+  *out = (mat4) {
+    a->m11 - b->m11, a->m12 - b->m12, a->m13 - b->m13, a->m14 - b->m14,
+    a->m21 - b->m21, a->m22 - b->m22, a->m23 - b->m23, a->m24 - b->m24,
+    a->m31 - b->m31, a->m32 - b->m32, a->m33 - b->m33, a->m34 - b->m34,
+    a->m41 - b->m41, a->m42 - b->m42, a->m43 - b->m43, a->m44 - b->m44
+  };
+}
+
+static inline mat4
+glisy_mat4_subtract (mat4 a, mat4 b) {
+  mat4 out;
+  glisy_mat4_subtract_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_subtract(a, b) glisy_mat4_subtract((a), (b))
 
 /**
  * Multiply mat4 a and mat4 b.
  */
 
-#define mat4_multiply(a, b) ((mat4){                                                 \
-  ((a).m11 * (b).m11 + (a).m21 * (b).m12 + (a).m31 * (b).m13 + (a).m41 * (b).m14),   \
-  ((a).m12 * (b).m11 + (a).m22 * (b).m12 + (a).m32 * (b).m13 + (a).m42 * (b).m14),   \
-  ((a).m13 * (b).m11 + (a).m23 * (b).m12 + (a).m33 * (b).m13 + (a).m43 * (b).m14),   \
-  ((a).m14 * (b).m11 + (a).m23 * (b).m12 + (a).m34 * (b).m13 + (a).m44 * (b).m14),   \
-                                                                                     \
-  ((a).m11 * (b).m21 + (a).m21 * (b).m22 + (a).m31 * (b).m23 + (a).m41 * (b).m24),   \
-  ((a).m12 * (b).m21 + (a).m22 * (b).m22 + (a).m32 * (b).m23 + (a).m42 * (b).m24),   \
-  ((a).m13 * (b).m21 + (a).m23 * (b).m22 + (a).m33 * (b).m23 + (a).m43 * (b).m24),   \
-  ((a).m14 * (b).m21 + (a).m24 * (b).m22 + (a).m34 * (b).m23 + (a).m44 * (b).m24),   \
-                                                                                     \
-  ((a).m11 * (b).m31 + (a).m21 * (b).m32 + (a).m31 * (b).m33 + (a).m41 * (b).m34),   \
-  ((a).m12 * (b).m31 + (a).m22 * (b).m32 + (a).m32 * (b).m33 + (a).m42 * (b).m34),   \
-  ((a).m13 * (b).m31 + (a).m23 * (b).m32 + (a).m33 * (b).m33 + (a).m43 * (b).m34),   \
-  ((a).m14 * (b).m31 + (a).m24 * (b).m32 + (a).m34 * (b).m33 + (a).m44 * (b).m34),   \
-                                                                                     \
-  ((a).m11 * (b).m41 + (a).m21 * (b).m42 + (a).m31 * (b).m43 + (a).m41 * (b).m44),   \
-  ((a).m12 * (b).m41 + (a).m22 * (b).m42 + (a).m32 * (b).m43 + (a).m42 * (b).m44),   \
-  ((a).m13 * (b).m41 + (a).m23 * (b).m42 + (a).m33 * (b).m43 + (a).m43 * (b).m44),   \
-  ((a).m14 * (b).m41 + (a).m24 * (b).m42 + (a).m34 * (b).m43 + (a).m44 * (b).m44),   \
-})
+static inline void
+glisy_mat4_multiply_scalar (mat4 *out, const mat4 *a, const mat4 *b) {
+  *out = (mat4) {
+    (a->m11 * b->m11 + a->m21 * b->m12 + a->m31 * b->m13 + a->m41 * b->m14),
+    (a->m12 * b->m11 + a->m22 * b->m12 + a->m32 * b->m13 + a->m42 * b->m14),
+    (a->m13 * b->m11 + a->m23 * b->m12 + a->m33 * b->m13 + a->m43 * b->m14),
+    (a->m14 * b->m11 + a->m24 * b->m12 + a->m34 * b->m13 + a->m44 * b->m14),
+
+    (a->m11 * b->m21 + a->m21 * b->m22 + a->m31 * b->m23 + a->m41 * b->m24),
+    (a->m12 * b->m21 + a->m22 * b->m22 + a->m32 * b->m23 + a->m42 * b->m24),
+    (a->m13 * b->m21 + a->m23 * b->m22 + a->m33 * b->m23 + a->m43 * b->m24),
+    (a->m14 * b->m21 + a->m24 * b->m22 + a->m34 * b->m23 + a->m44 * b->m24),
+
+    (a->m11 * b->m31 + a->m21 * b->m32 + a->m31 * b->m33 + a->m41 * b->m34),
+    (a->m12 * b->m31 + a->m22 * b->m32 + a->m32 * b->m33 + a->m42 * b->m34),
+    (a->m13 * b->m31 + a->m23 * b->m32 + a->m33 * b->m33 + a->m43 * b->m34),
+    (a->m14 * b->m31 + a->m24 * b->m32 + a->m34 * b->m33 + a->m44 * b->m34),
+
+    (a->m11 * b->m41 + a->m21 * b->m42 + a->m31 * b->m43 + a->m41 * b->m44),
+    (a->m12 * b->m41 + a->m22 * b->m42 + a->m32 * b->m43 + a->m42 * b->m44),
+    (a->m13 * b->m41 + a->m23 * b->m42 + a->m33 * b->m43 + a->m43 * b->m44),
+    (a->m14 * b->m41 + a->m24 * b->m42 + a->m34 * b->m43 + a->m44 * b->m44)
+  };
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * SIMD product. Every output row is a linear combination of the
+ * rows of a, summed in the same order as the scalar path, so the
+ * SSE2 kernel is bit exact. With FMA each element may differ from
+ * the scalar result by 2 ulp of the largest partial product.
+ */
+
+static inline void
+glisy_mat4_multiply_sse (mat4 *out, const mat4 *a, const mat4 *b) {
+  __m128 a0 = _mm_load_ps(&a->m11);
+  __m128 a1 = _mm_load_ps(&a->m21);
+  __m128 a2 = _mm_load_ps(&a->m31);
+  __m128 a3 = _mm_load_ps(&a->m41);
+  __m128 r[4];
+  const float *bp = &b->m11;
+  for (int i = 0; i < 4; ++i) {
+    __m128 row = _mm_load_ps(bp + 4 * i);
+    __m128 v = _mm_mul_ps(a0, glisy_simd_splat(row, 0));
+    v = glisy_simd_madd(a1, glisy_simd_splat(row, 1), v);
+    v = glisy_simd_madd(a2, glisy_simd_splat(row, 2), v);
+    r[i] = glisy_simd_madd(a3, glisy_simd_splat(row, 3), v);
+  }
+  _mm_store_ps(&out->m11, r[0]);
+  _mm_store_ps(&out->m21, r[1]);
+  _mm_store_ps(&out->m31, r[2]);
+  _mm_store_ps(&out->m41, r[3]);
+}
+#endif
+
+#ifdef GLISY_AVX
+static inline void
+glisy_mat4_multiply_avx (mat4 *out, const mat4 *a, const mat4 *b) {
+  __m256 a0 = _mm256_broadcast_ps((const __m128 *) &a->m11);
+  __m256 a1 = _mm256_broadcast_ps((const __m128 *) &a->m21);
+  __m256 a2 = _mm256_broadcast_ps((const __m128 *) &a->m31);
+  __m256 a3 = _mm256_broadcast_ps((const __m128 *) &a->m41);
+  __m256 b01 = _mm256_loadu_ps(&b->m11);
+  __m256 b23 = _mm256_loadu_ps(&b->m31);
+  __m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+  __m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+  r01 = glisy_simd_madd256(a1, _mm256_shuffle_ps(b01, b01, 0x55), r01);
+  r23 = glisy_simd_madd256(a1, _mm256_shuffle_ps(b23, b23, 0x55), r23);
+  r01 = glisy_simd_madd256(a2, _mm256_shuffle_ps(b01, b01, 0xaa), r01);
+  r23 = glisy_simd_madd256(a2, _mm256_shuffle_ps(b23, b23, 0xaa), r23);
+  r01 = glisy_simd_madd256(a3, _mm256_shuffle_ps(b01, b01, 0xff), r01);
+  r23 = glisy_simd_madd256(a3, _mm256_shuffle_ps(b23, b23, 0xff), r23);
+  _mm256_storeu_ps(&out->m11, r01);
+  _mm256_storeu_ps(&out->m31, r23);
+}
+#endif
+
+static inline void
+glisy_mat4_multiply_into (mat4 *out, const mat4 *a, const mat4 *b) {
+#if defined(GLISY_AVX)
+  glisy_mat4_multiply_avx(out, a, b);
+#elif defined(GLISY_SSE2)
+  glisy_mat4_multiply_sse(out, a, b);
+#else
+  glisy_mat4_multiply_scalar(out, a, b);
+#endif
+}
+
+static inline mat4
+glisy_mat4_multiply (mat4 a, mat4 b) {
+  mat4 out;
+  glisy_mat4_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_multiply(a, b) glisy_mat4_multiply((a), (b))
+
+/**
+ * Multiplies affine mat4s a and b like mat4_multiply, skipping the
+ * projective column: 36 multiplies instead of 64 in the scalar path
+ * and three quarters of the vector multiply-adds with SSE and AVX.
+ * Both inputs must be affine (m14, m24, m34 zero and m44 one).
+ */
+
+static inline void
+glisy_mat4_multiply_affine_scalar (mat4 *out, const mat4 *a, const mat4 *b) {
+  *out = (mat4) {
+    (a->m11 * b->m11 + a->m21 * b->m12 + a->m31 * b->m13),
+    (a->m12 * b->m11 + a->m22 * b->m12 + a->m32 * b->m13),
+    (a->m13 * b->m11 + a->m23 * b->m12 + a->m33 * b->m13),
+    0,
+
+    (a->m11 * b->m21 + a->m21 * b->m22 + a->m31 * b->m23),
+    (a->m12 * b->m21 + a->m22 * b->m22 + a->m32 * b->m23),
+    (a->m13 * b->m21 + a->m23 * b->m22 + a->m33 * b->m23),
+    0,
+
+    (a->m11 * b->m31 + a->m21 * b->m32 + a->m31 * b->m33),
+    (a->m12 * b->m31 + a->m22 * b->m32 + a->m32 * b->m33),
+    (a->m13 * b->m31 + a->m23 * b->m32 + a->m33 * b->m33),
+    0,
+
+    (a->m11 * b->m41 + a->m21 * b->m42 + a->m31 * b->m43 + a->m41),
+    (a->m12 * b->m41 + a->m22 * b->m42 + a->m32 * b->m43 + a->m42),
+    (a->m13 * b->m41 + a->m23 * b->m42 + a->m33 * b->m43 + a->m43),
+    1
+  };
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_multiply_affine_sse (mat4 *out, const mat4 *a, const mat4 *b) {
+  __m128 a0 = _mm_load_ps(&a->m11);
+  __m128 a1 = _mm_load_ps(&a->m21);
+  __m128 a2 = _mm_load_ps(&a->m31);
+  __m128 a3 = _mm_load_ps(&a->m41);
+  __m128 r[4];
+  const float *bp = &b->m11;
+  for (int i = 0; i < 4; ++i) {
+    __m128 row = _mm_load_ps(bp + 4 * i);
+    __m128 v = _mm_mul_ps(a0, glisy_simd_splat(row, 0));
+    v = glisy_simd_madd(a1, glisy_simd_splat(row, 1), v);
+    r[i] = glisy_simd_madd(a2, glisy_simd_splat(row, 2), v);
+  }
+  _mm_store_ps(&out->m11, r[0]);
+  _mm_store_ps(&out->m21, r[1]);
+  _mm_store_ps(&out->m31, r[2]);
+  _mm_store_ps(&out->m41, _mm_add_ps(r[3], a3));
+}
+#endif
+
+#ifdef GLISY_AVX
+static inline void
+glisy_mat4_multiply_affine_avx (mat4 *out, const mat4 *a, const mat4 *b) {
+  __m256 a0 = _mm256_broadcast_ps((const __m128 *) &a->m11);
+  __m256 a1 = _mm256_broadcast_ps((const __m128 *) &a->m21);
+  __m256 a2 = _mm256_broadcast_ps((const __m128 *) &a->m31);
+  __m256 a3 = _mm256_insertf128_ps(_mm256_setzero_ps(),
+                                   _mm_load_ps(&a->m41), 1);
+  __m256 b01 = _mm256_loadu_ps(&b->m11);
+  __m256 b23 = _mm256_loadu_ps(&b->m31);
+  __m256 r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+  __m256 r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+  r01 = glisy_simd_madd256(a1, _mm256_shuffle_ps(b01, b01, 0x55), r01);
+  r23 = glisy_simd_madd256(a1, _mm256_shuffle_ps(b23, b23, 0x55), r23);
+  r01 = glisy_simd_madd256(a2, _mm256_shuffle_ps(b01, b01, 0xaa), r01);
+  r23 = glisy_simd_madd256(a2, _mm256_shuffle_ps(b23, b23, 0xaa), r23);
+  _mm256_storeu_ps(&out->m11, r01);
+  _mm256_storeu_ps(&out->m31, _mm256_add_ps(r23, a3));
+}
+#endif
+
+static inline void
+glisy_mat4_multiply_affine_into (mat4 *out, const mat4 *a, const mat4 *b) {
+#if defined(GLISY_AVX)
+  glisy_mat4_multiply_affine_avx(out, a, b);
+#elif defined(GLISY_SSE2)
+  glisy_mat4_multiply_affine_sse(out, a, b);
+#else
+  glisy_mat4_multiply_affine_scalar(out, a, b);
+#endif
+}
+
+static inline mat4
+glisy_mat4_multiply_affine (mat4 a, mat4 b) {
+  mat4 out;
+  glisy_mat4_multiply_affine_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_multiply_affine(a, b) glisy_mat4_multiply_affine((a), (b))
+
+/**
+ * Batch form of mat4_multiply_affine over count contiguous pairs,
+ * out[i] = a[i] * b[i]. out may be a or b.
+ */
+
+static inline void
+glisy_mat4_multiply_affine_batch (mat4 *out,
+                                  const mat4 *a,
+                                  const mat4 *b,
+                                  size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_mat4_multiply_affine_into(&out[i], &a[i], &b[i]);
+  }
+}
 
 /**
  * Rotates mat4 a by angle rad.
  */
 
-#define mat4_rotate(a, rad, vec)  ({              \
-  double x = (vec).x, y = (vec).y, z = (vec).z;    \
-  double d = sqrt(x*x + y*y + z*z);                \
-  double c = cosf(rad), s = sinf(rad), t = 1 - c;  \
-                                                  \
-  x /= d; y /= d; z /= d;                         \
-                                                  \
-  (a).m11 = x * x * t + c;                        \
-  (a).m12 = x * y * t - z * s;                    \
-  (a).m13 = x * z * t + y * s;                    \
-  (a).m14 = 0;                                    \
-                                                  \
-  (a).m21 = y * x * t + z * s;                    \
-  (a).m22 = y * y * t + c;                        \
-  (a).m23 = y * z * t - x * s;                    \
-  (a).m24 = 0;                                    \
-                                                  \
-  (a).m31 = z * x * t - y * s;                    \
-  (a).m32 = z * y * t + x * s;                    \
-  (a).m33 = z * z * t + c;                        \
-  (a).m34 = 0;                                    \
-                                                  \
-  (a).m41 = 0;                                    \
-  (a).m42 = 0;                                    \
-  (a).m43 = 0;                                    \
-  (a).m44 = 1;                                    \
-                                                  \
-  (a);                                            \
-})
+static inline mat4
+glisy_mat4_rotate (mat4 *a, float rad, vec3 vec) {
+  double x = vec.x, y = vec.y, z = vec.z;
+  double d = sqrt(x*x + y*y + z*z);
+  float fs, fc;
+  glisy_sincosf(rad, &fs, &fc);
+  double c = fc, s = fs, t = 1 - c;
+
+  x /= d; y /= d; z /= d;
+
+  a->m11 = x * x * t + c;
+  a->m12 = x * y * t - z * s;
+  a->m13 = x * z * t + y * s;
+  a->m14 = 0;
+
+  a->m21 = y * x * t + z * s;
+  a->m22 = y * y * t + c;
+  a->m23 = y * z * t - x * s;
+  a->m24 = 0;
+
+  a->m31 = z * x * t - y * s;
+  a->m32 = z * y * t + x * s;
+  a->m33 = z * z * t + c;
+  a->m34 = 0;
+
+  a->m41 = 0;
+  a->m42 = 0;
+  a->m43 = 0;
+  a->m44 = 1;
+
+  return *a;
+}
+
+#define mat4_rotate(a, rad, vec) glisy_mat4_rotate(&(a), (rad), (vec))
 
 /**
  * Rotates a matrix by the given angle around the X axis
  */
 
-#define mat4_rotateX(a, rad) ({ \
-  double s = sinl(rad);          \
-  double c = cosl(rad);          \
-  double a10 = (a).m21;          \
-  double a11 = (a).m22;          \
-  double a12 = (a).m23;          \
-  double a13 = (a).m24;          \
-  double a20 = (a).m31;          \
-  double a21 = (a).m32;          \
-  double a22 = (a).m33;          \
-  double a23 = (a).m34;          \
-  (a).m21 = a10 * c + a20 * s;  \
-  (a).m22 = a11 * c + a21 * s;  \
-  (a).m23 = a12 * c + a22 * s;  \
-  (a).m24 = a13 * c + a23 * s;  \
-  (a).m31 = a20 * c - a10 * s;  \
-  (a).m32 = a21 * c - a11 * s;  \
-  (a).m33 = a22 * c - a12 * s;  \
-  (a).m34 = a23 * c - a13 * s;  \
-  (a);                          \
-})
+static inline mat4
+glisy_mat4_rotateX (mat4 *a, float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  double a10 = a->m21;
+  double a11 = a->m22;
+  double a12 = a->m23;
+  double a13 = a->m24;
+  double a20 = a->m31;
+  double a21 = a->m32;
+  double a22 = a->m33;
+  double a23 = a->m34;
+  a->m21 = a10 * c + a20 * s;
+  a->m22 = a11 * c + a21 * s;
+  a->m23 = a12 * c + a22 * s;
+  a->m24 = a13 * c + a23 * s;
+  a->m31 = a20 * c - a10 * s;
+  a->m32 = a21 * c - a11 * s;
+  a->m33 = a22 * c - a12 * s;
+  a->m34 = a23 * c - a13 * s;
+  return *a;
+}
+
+#define mat4_rotateX(a, rad) glisy_mat4_rotateX(&(a), (rad))
 
 /**
  * Rotates a matrix by the given angle around the Y axis
  */
 
-#define mat4_rotateY(a, rad) ({ \
-  double s = sinl(rad);          \
-  double c = cosl(rad);          \
-  double a00 = (a).m11;          \
-  double a01 = (a).m12;          \
-  double a02 = (a).m13;          \
-  double a03 = (a).m14;          \
-  double a20 = (a).m31;          \
-  double a21 = (a).m32;          \
-  double a22 = (a).m33;          \
-  double a23 = (a).m34;          \
-  (a).m11 = a00 * c - a20 * s;  \
-  (a).m12 = a01 * c - a21 * s;  \
-  (a).m13 = a02 * c - a22 * s;  \
-  (a).m14 = a03 * c - a23 * s;  \
-  (a).m31 = a00 * s + a20 * c;  \
-  (a).m32 = a01 * s + a21 * c;  \
-  (a).m33 = a02 * s + a22 * c;  \
-  (a).m34 = a03 * s + a23 * c;  \
-  (a);                          \
-})
+static inline mat4
+glisy_mat4_rotateY (mat4 *a, float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  double a00 = a->m11;
+  double a01 = a->m12;
+  double a02 = a->m13;
+  double a03 = a->m14;
+  double a20 = a->m31;
+  double a21 = a->m32;
+  double a22 = a->m33;
+  double a23 = a->m34;
+  a->m11 = a00 * c - a20 * s;
+  a->m12 = a01 * c - a21 * s;
+  a->m13 = a02 * c - a22 * s;
+  a->m14 = a03 * c - a23 * s;
+  a->m31 = a00 * s + a20 * c;
+  a->m32 = a01 * s + a21 * c;
+  a->m33 = a02 * s + a22 * c;
+  a->m34 = a03 * s + a23 * c;
+  return *a;
+}
+
+#define mat4_rotateY(a, rad) glisy_mat4_rotateY(&(a), (rad))
 
 /**
  * Rotates a matrix by the given angle around the Z axis
  */
 
-#define mat4_rotateZ(a, rad) ({ \
-  double s = sinl(rad);          \
-  double c = cosl(rad);          \
-  double a00 = (a).m11;          \
-  double a01 = (a).m12;          \
-  double a02 = (a).m13;          \
-  double a03 = (a).m14;          \
-  double a10 = (a).m21;          \
-  double a11 = (a).m22;          \
-  double a12 = (a).m23;          \
-  double a13 = (a).m24;          \
-  (a).m11 = a00 * c + a10 * s;  \
-  (a).m12 = a01 * c + a11 * s;  \
-  (a).m13 = a02 * c + a12 * s;  \
-  (a).m14 = a03 * c + a13 * s;  \
-  (a).m21 = a10 * c - a00 * s;  \
-  (a).m22 = a11 * c - a01 * s;  \
-  (a).m23 = a12 * c - a02 * s;  \
-  (a).m24 = a13 * c - a03 * s;  \
-  (a);                          \
-})
+static inline mat4
+glisy_mat4_rotateZ (mat4 *a, float rad) {
+  float s, c;
+  glisy_sincosf(rad, &s, &c);
+  double a00 = a->m11;
+  double a01 = a->m12;
+  double a02 = a->m13;
+  double a03 = a->m14;
+  double a10 = a->m21;
+  double a11 = a->m22;
+  double a12 = a->m23;
+  double a13 = a->m24;
+  a->m11 = a00 * c + a10 * s;
+  a->m12 = a01 * c + a11 * s;
+  a->m13 = a02 * c + a12 * s;
+  a->m14 = a03 * c + a13 * s;
+  a->m21 = a10 * c - a00 * s;
+  a->m22 = a11 * c - a01 * s;
+  a->m23 = a12 * c - a02 * s;
+  a->m24 = a13 * c - a03 * s;
+  return *a;
+}
+
+#define mat4_rotateZ(a, rad) glisy_mat4_rotateZ(&(a), (rad))
 
 /**
  * Scales mat4 a by vec3 b.
  */
 
-#define mat4_scale(a, b) ((mat4){                                              \
-  ((a).m11 * (b).x), ((a).m12 * (b).x), ((a).m13 * (b).x), ((a).m14 * (b).x),  \
-  ((a).m21 * (b).y), ((a).m22 * (b).y), ((a).m23 * (b).y), ((a).m24 * (b).y),  \
-  ((a).m31 * (b).z), ((a).m32 * (b).z), ((a).m33 * (b).z), ((a).m34 * (b).z),  \
-  (a).m41, (a).m42, (a).m43, (a).m44                                           \
-})
+static inline void
+glisy_mat4_scale_into (mat4 *out, const mat4 *a, const vec3 *b) {
+  *out = (mat4) {
+    (a->m11 * b->x), (a->m12 * b->x), (a->m13 * b->x), (a->m14 * b->x),
+    (a->m21 * b->y), (a->m22 * b->y), (a->m23 * b->y), (a->m24 * b->y),
+    (a->m31 * b->z), (a->m32 * b->z), (a->m33 * b->z), (a->m34 * b->z),
+    a->m41, a->m42, a->m43, a->m44
+  };
+}
+
+static inline mat4
+glisy_mat4_scale (mat4 a, vec3 b) {
+  mat4 out;
+  glisy_mat4_scale_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_scale(a, b) glisy_mat4_scale((a), (b))
 
 /**
  * Translate mat4 a by vec3 b.
  */
 
-#define mat4_translate(a, b) ((mat4){                                \
-  (a).m11, (a).m12, (a).m13, (a).m14,                                \
-  (a).m21, (a).m22, (a).m23, (a).m24,                                \
-  (a).m31, (a).m32, (a).m33, (a).m34,                                \
-  ((b).x * (a).m11 + (b).y * (a).m21 + (b).z * (a).m31 + (a).m41),   \
-  ((b).x * (a).m12 + (b).y * (a).m22 + (b).z * (a).m32 + (a).m42),   \
-  ((b).x * (a).m13 + (b).y * (a).m23 + (b).z * (a).m33 + (a).m43),   \
-  ((b).x * (a).m14 + (b).y * (a).m24 + (b).z * (a).m34 + (a).m44)    \
-})
+static inline void
+glisy_mat4_translate_into (mat4 *out, const mat4 *a, const vec3 *b) {
+  *out = (mat4) {
+    a->m11, a->m12, a->m13, a->m14,
+    a->m21, a->m22, a->m23, a->m24,
+    a->m31, a->m32, a->m33, a->m34,
+    (b->x * a->m11 + b->y * a->m21 + b->z * a->m31 + a->m41),
+    (b->x * a->m12 + b->y * a->m22 + b->z * a->m32 + a->m42),
+    (b->x * a->m13 + b->y * a->m23 + b->z * a->m33 + a->m43),
+    (b->x * a->m14 + b->y * a->m24 + b->z * a->m34 + a->m44)
+  };
+}
+
+static inline mat4
+glisy_mat4_translate (mat4 a, vec3 b) {
+  mat4 out;
+  glisy_mat4_translate_into(&out, &a, &b);
+  return out;
+}
+
+#define mat4_translate(a, b) glisy_mat4_translate((a), (b))
 
 /**
  * Generates a frustum matrix from top, left, bottom, right,
  * near, and far bounds.
  */
 
-#define mat4_frustum(top, left, bottom, right, near, far)  ({        \
-  double rl = 1 / (right - left);                                     \
-  double tb = 1 / (top - bottom);                                     \
-  double nf = 1 / (near - far);                                       \
-  mat4 a;                                                            \
-                                                                     \
-  a.m11 = rl * (2 * near);                                           \
-  a.m12 = 0;                                                         \
-  a.m13 = 0;                                                         \
-  a.m14 = 0;                                                         \
-                                                                     \
-  a.m21 = 0;                                                         \
-  a.m22 = tb * (2 * near);                                           \
-  a.m23 = 0;                                                         \
-  a.m24 = 0;                                                         \
-                                                                     \
-  a.m31 = rl * (right + left);                                       \
-  a.m32 = rl * (top + bottom);                                       \
-  a.m33 = nf * (far + near);                                         \
-  a.m34 = -1;                                                        \
-                                                                     \
-  a.m41 = 0;                                                         \
-  a.m42 = 0;                                                         \
-  a.m43 = nf * (2 * far * near);                                     \
-  a.m44 = 0;                                                         \
-                                                                     \
-  (a);                                                               \
-})
+static inline mat4
+glisy_mat4_frustum (double top, double left, double bottom,
+                    double right, double near, double far) {
+  double rl = 1 / (right - left);
+  double tb = 1 / (top - bottom);
+  double nf = 1 / (near - far);
+  mat4 a;
+
+  a.m11 = rl * (2 * near);
+  a.m12 = 0;
+  a.m13 = 0;
+  a.m14 = 0;
+
+  a.m21 = 0;
+  a.m22 = tb * (2 * near);
+  a.m23 = 0;
+  a.m24 = 0;
+
+  a.m31 = rl * (right + left);
+  a.m32 = rl * (top + bottom);
+  a.m33 = nf * (far + near);
+  a.m34 = -1;
+
+  a.m41 = 0;
+  a.m42 = 0;
+  a.m43 = nf * (2 * far * near);
+  a.m44 = 0;
+
+  return a;
+}
+
+#define mat4_frustum(top, left, bottom, right, near, far) \
+  glisy_mat4_frustum((top), (left), (bottom), (right), (near), (far))
 
 /**
  * Generates a perspective matrix from fov, aspect, near, and
  * far bounds.
  */
 
-#define mat4_perspective(fov, aspect, near, far)  ({                 \
-  double f = 1.0 / tanf(fov / 2);                                     \
-  int nf = 1 / (near - far);                                         \
-  mat4 a;                                                            \
-                                                                     \
-  a.m11 = f / (aspect);                                              \
-  a.m12 = 0;                                                         \
-  a.m13 = 0;                                                         \
-  a.m14 = 0;                                                         \
-                                                                     \
-  a.m21 = 0;                                                         \
-  a.m22 = f;                                                         \
-  a.m23 = 0;                                                         \
-  a.m24 = 0;                                                         \
-                                                                     \
-  a.m31 = 0;                                                         \
-  a.m32 = 0;                                                         \
-  a.m33 = (near + far) * nf;                                         \
-  a.m34 = -1;                                                        \
-                                                                     \
-  a.m41 = 0;                                                         \
-  a.m42 = 0;                                                         \
-  a.m43 = (2 * far * near) * nf;                                     \
-  a.m44 = 0;                                                         \
-                                                                     \
-  (a);                                                               \
-})
+static inline mat4
+glisy_mat4_perspective (double fov, double aspect, double near, double far) {
+  double f = 1.0 / tan(fov / 2);
+  double nf = 1 / (near - far);
+  mat4 a;
+
+  a.m11 = f / aspect;
+  a.m12 = 0;
+  a.m13 = 0;
+  a.m14 = 0;
+
+  a.m21 = 0;
+  a.m22 = f;
+  a.m23 = 0;
+  a.m24 = 0;
+
+  a.m31 = 0;
+  a.m32 = 0;
+  a.m33 = (near + far) * nf;
+  a.m34 = -1;
+
+  a.m41 = 0;
+  a.m42 = 0;
+  a.m43 = (2 * far * near) * nf;
+  a.m44 = 0;
+
+  return a;
+}
+
+#define mat4_perspective(fov, aspect, near, far) \
+  glisy_mat4_perspective((fov), (aspect), (near), (far))
 
 /**
  * Generates a orthogonal matrix from top, left, bottom, right,
  * near, and far bounds.
  */
 
-#define mat4_ortho(left, right, bottom, top, near, far)  ({          \
-  double lr = 1.0 / (left - right);                                  \
-  double bt = 1.0 / (bottom - top);                                  \
-  double nf = 1.0 / (near - far);                                    \
-  mat4 a;                                                            \
-                                                                     \
-  a.m11 = -2.0 * lr;                                                 \
-  a.m12 = 0;                                                         \
-  a.m13 = 0;                                                         \
-  a.m14 = 0;                                                         \
-                                                                     \
-  a.m21 = 0;                                                         \
-  a.m22 = -2.0 * bt;                                                 \
-  a.m23 = 0;                                                         \
-  a.m24 = 0;                                                         \
-                                                                     \
-  a.m31 = 0;                                                         \
-  a.m32 = 0;                                                         \
-  a.m33 = 2.0 * nf;                                                  \
-  a.m34 = 0;                                                         \
-                                                                     \
-  a.m41 = lr * (left + right);                                       \
-  a.m42 = bt * (top + bottom);                                       \
-  a.m43 = nf * (far + near);                                         \
-  a.m44 = 1;                                                         \
-                                                                     \
-  (a);                                                               \
-})
+static inline mat4
+glisy_mat4_ortho (double left, double right, double bottom,
+                  double top, double near, double far) {
+  double lr = 1.0 / (left - right);
+  double bt = 1.0 / (bottom - top);
+  double nf = 1.0 / (near - far);
+  mat4 a;
+
+  a.m11 = -2.0 * lr;
+  a.m12 = 0;
+  a.m13 = 0;
+  a.m14 = 0;
+
+  a.m21 = 0;
+  a.m22 = -2.0 * bt;
+  a.m23 = 0;
+  a.m24 = 0;
+
+  a.m31 = 0;
+  a.m32 = 0;
+  a.m33 = 2.0 * nf;
+  a.m34 = 0;
+
+  a.m41 = lr * (left + right);
+  a.m42 = bt * (top + bottom);
+  a.m43 = nf * (far + near);
+  a.m44 = 1;
+
+  return a;
+}
+
+#define mat4_ortho(left, right, bottom, top, near, far) \
+  glisy_mat4_ortho((left), (right), (bottom), (top), (near), (far))
 
 /**
  * Generates a lookAt matrix from an eye, focal, and up vec3.
  */
 
-#define mat4_lookAt(eye, center, up)  ({                             \
-  double x0, x1, x2, y0, y1, y2, z0, z1, z2, len;                    \
-  double eyex = (eye).x;                                             \
-  double eyey = (eye).y;                                             \
-  double eyez = (eye).z;                                             \
-  double upx = (up).x;                                               \
-  double upy = (up).y;                                               \
-  double upz = (up).z;                                               \
-  double centerx = (center).x;                                       \
-  double centery = (center).y;                                       \
-  double centerz = (center).z;                                       \
-  mat4 a = mat4_create();                                            \
-  if (!(fabs(eyex - centerx) < GLISY_EPSILON &&                      \
-      fabs(eyey - centery) < GLISY_EPSILON &&                        \
-      fabs(eyez - centerz) < GLISY_EPSILON)) {                       \
-    z0 = eyex - centerx;                                             \
-    z1 = eyey - centery;                                             \
-    z2 = eyez - centerz;                                             \
-    len = 1 / sqrt(z0 * z0 + z1 * z1 + z2 * z2);                     \
-    z0 *= len;                                                       \
-    z1 *= len;                                                       \
-    z2 *= len;                                                       \
-    x0 = upy * z2 - upz * z1;                                        \
-    x1 = upz * z0 - upx * z2;                                        \
-    x2 = upx * z1 - upy * z0;                                        \
-    len = sqrt(x0 * x0 + x1 * x1 + x2 * x2);                         \
-    if (!len) {                                                      \
-      x0 = 0;                                                        \
-      x1 = 0;                                                        \
-      x2 = 0;                                                        \
-    } else {                                                         \
-      len = 1 / len;                                                 \
-      x0 *= len;                                                     \
-      x1 *= len;                                                     \
-      x2 *= len;                                                     \
-    }                                                                \
-    y0 = z1 * x2 - z2 * x1;                                          \
-    y1 = z2 * x0 - z0 * x2;                                          \
-    y2 = z0 * x1 - z1 * x0;                                          \
-    len = sqrt(y0 * y0 + y1 * y1 + y2 * y2);                         \
-    if (!len) {                                                      \
-      y0 = 0;                                                        \
-      y1 = 0;                                                        \
-      y2 = 0;                                                        \
-    } else {                                                         \
-      len = 1 / len;                                                 \
-      y0 *= len;                                                     \
-      y1 *= len;                                                     \
-      y2 *= len;                                                     \
-    }                                                                \
-    a.m11 = x0;                                                      \
-    a.m12 = y0;                                                      \
-    a.m13 = z0;                                                      \
-    a.m14 = 0;                                                       \
-    a.m21 = x1;                                                      \
-    a.m22 = y1;                                                      \
-    a.m23 = z1;                                                      \
-    a.m24 = 0;                                                       \
-    a.m31 = x2;                                                      \
-    a.m32 = y2;                                                      \
-    a.m33 = z2;                                                      \
-    a.m34 = 0;                                                       \
-    a.m41 = -(x0 * eyex + x1 * eyey + x2 * eyez);                    \
-    a.m42 = -(y0 * eyex + y1 * eyey + y2 * eyez);                    \
-    a.m43 = -(z0 * eyex + z1 * eyey + z2 * eyez);                    \
-    a.m44 = 1;                                                       \
-  }                                                                  \
-  (a);                                                               \
-})
+static inline mat4
+glisy_mat4_lookAt (vec3 eye, vec3 center, vec3 up) {
+  double x0, x1, x2, y0, y1, y2, z0, z1, z2, len;
+  double eyex = eye.x;
+  double eyey = eye.y;
+  double eyez = eye.z;
+  double upx = up.x;
+  double upy = up.y;
+  double upz = up.z;
+  double centerx = center.x;
+  double centery = center.y;
+  double centerz = center.z;
+  mat4 a = mat4_create();
+  if (!(fabs(eyex - centerx) < GLISY_EPSILON &&
+      fabs(eyey - centery) < GLISY_EPSILON &&
+      fabs(eyez - centerz) < GLISY_EPSILON)) {
+    z0 = eyex - centerx;
+    z1 = eyey - centery;
+    z2 = eyez - centerz;
+    len = 1 / sqrt(z0 * z0 + z1 * z1 + z2 * z2);
+    z0 *= len;
+    z1 *= len;
+    z2 *= len;
+    x0 = upy * z2 - upz * z1;
+    x1 = upz * z0 - upx * z2;
+    x2 = upx * z1 - upy * z0;
+    len = sqrt(x0 * x0 + x1 * x1 + x2 * x2);
+    if (!len) {
+      x0 = 0;
+      x1 = 0;
+      x2 = 0;
+    } else {
+      len = 1 / len;
+      x0 *= len;
+      x1 *= len;
+      x2 *= len;
+    }
+    y0 = z1 * x2 - z2 * x1;
+    y1 = z2 * x0 - z0 * x2;
+    y2 = z0 * x1 - z1 * x0;
+    len = sqrt(y0 * y0 + y1 * y1 + y2 * y2);
+    if (!len) {
+      y0 = 0;
+      y1 = 0;
+      y2 = 0;
+    } else {
+      len = 1 / len;
+      y0 *= len;
+      y1 *= len;
+      y2 *= len;
+    }
+    a.m11 = x0;
+    a.m12 = y0;
+    a.m13 = z0;
+    a.m14 = 0;
+    a.m21 = x1;
+    a.m22 = y1;
+    a.m23 = z1;
+    a.m24 = 0;
+    a.m31 = x2;
+    a.m32 = y2;
+    a.m33 = z2;
+    a.m34 = 0;
+    a.m41 = -(x0 * eyex + x1 * eyey + x2 * eyez);
+    a.m42 = -(y0 * eyex + y1 * eyey + y2 * eyez);
+    a.m43 = -(z0 * eyex + z1 * eyey + z2 * eyez);
+    a.m44 = 1;
+  }
+  return a;
+}
+
+#define mat4_lookAt(eye, center, up) \
+  glisy_mat4_lookAt((eye), (center), (up))
 
 /**
  * Calculates Frobenius norm mat4 a.
  */
 
-#define mat4_frob(a) (double) sqrt( \
-  powf((a).m11, 2.0) +              \
-  powf((a).m12, 2.0) +              \
-  powf((a).m13, 2.0) +              \
-  powf((a).m14, 2.0) +              \
-  powf((a).m21, 2.0) +              \
-  powf((a).m22, 2.0) +              \
-  powf((a).m23, 2.0) +              \
-  powf((a).m24, 2.0) +              \
-  powf((a).m31, 2.0) +              \
-  powf((a).m32, 2.0) +              \
-  powf((a).m33, 2.0) +              \
-  powf((a).m34, 2.0) +              \
-  powf((a).m41, 2.0) +              \
-  powf((a).m42, 2.0) +              \
-  powf((a).m43, 2.0) +              \
-  powf((a).m44, 2.0)                \
-)
+static inline double
+glisy_mat4_frob (mat4 a) {
+  return sqrt(a.m11 * a.m11 + a.m12 * a.m12 + a.m13 * a.m13 + a.m14 * a.m14 +
+              a.m21 * a.m21 + a.m22 * a.m22 + a.m23 * a.m23 + a.m24 * a.m24 +
+              a.m31 * a.m31 + a.m32 * a.m32 + a.m33 * a.m33 + a.m34 * a.m34 +
+              a.m41 * a.m41 + a.m42 * a.m42 + a.m43 * a.m43 + a.m44 * a.m44);
+}
+
+#define mat4_frob(a) glisy_mat4_frob((a))
 
 /**
  * Calculates a mat4 from a quat
  */
 
-#define mat4_from_quat(q) ({ \
-  mat4 mat = mat4(0);        \
-  double x = (q).x;          \
-  double y = (q).y;          \
-  double z = (q).z;          \
-  double w = (q).w;          \
-  double x2 = x + x;         \
-  double y2 = y + y;         \
-  double z2 = z + z;         \
-  double xx = x * x2;        \
-  double yx = y * x2;        \
-  double yy = y * y2;        \
-  double zx = z * x2;        \
-  double zy = z * y2;        \
-  double zz = z * z2;        \
-  double wx = w * x2;        \
-  double wy = w * y2;        \
-  double wz = w * z2;        \
-                             \
-  mat.m11 = 1 - yy - zz;     \
-  mat.m12 = yx + wz;         \
-  mat.m13 = zx - wy;         \
-  mat.m14 = 0;               \
-                             \
-  mat.m21 = yx - wz;         \
-  mat.m22 = 1 - xx - zz;     \
-  mat.m23 = zy + wx;         \
-  mat.m24 = 0;               \
-                             \
-  mat.m31 = zx + wy;         \
-  mat.m32 = zy - wx;         \
-  mat.m33 = 1 - xx - yy;     \
-  mat.m34 = 0;               \
-                             \
-  mat.m41 = 0;               \
-  mat.m42 = 0;               \
-  mat.m43 = 0;               \
-  mat.m44 = 1;               \
-                             \
-  (mat);                     \
-})
-
-/**
- * Returns a string representation of mat4 a.
- */
-
-#define mat4_string(a) (const char *) ({                             \
-  char str[BUFSIZ];                                                  \
-  mat4 b = mat4_clone((a));                                          \
-  memset(str, 0, BUFSIZ);                                            \
-  sprintf(str, "mat4(%g, %g, %g, %g,\n"                              \
-               "     %g, %g, %g, %g,\n"                              \
-               "     %g, %g, %g, %g,\n"                              \
-               "     %g, %g, %g, %g)",                               \
-               b.m11, b.m12, b.m13, b.m14,                           \
-               b.m21, b.m22, b.m23, b.m24,                           \
-               b.m31, b.m32, b.m33, b.m34,                           \
-               b.m41, b.m42, b.m43, b.m44);                          \
-  (strdup(str));                                                     \
-})
+static inline void
+glisy_mat4_from_quat_into (mat4 *out, const quat *q) {
+  mat4 mat;
+  double x = q->x;
+  double y = q->y;
+  double z = q->z;
+  double w = q->w;
+  double x2 = x + x;
+  double y2 = y + y;
+  double z2 = z + z;
+  double xx = x * x2;
+  double yx = y * x2;
+  double yy = y * y2;
+  double zx = z * x2;
+  double zy = z * y2;
+  double zz = z * z2;
+  double wx = w * x2;
+  double wy = w * y2;
+  double wz = w * z2;
+
+  mat.m11 = 1 - yy - zz;
+  mat.m12 = yx + wz;
+  mat.m13 = zx - wy;
+  mat.m14 = 0;
+
+  mat.m21 = yx - wz;
+  mat.m22 = 1 - xx - zz;
+  mat.m23 = zy + wx;
+  mat.m24 = 0;
+
+  mat.m31 = zx + wy;
+  mat.m32 = zy - wx;
+  mat.m33 = 1 - xx - yy;
+  mat.m34 = 0;
+
+  mat.m41 = 0;
+  mat.m42 = 0;
+  mat.m43 = 0;
+  mat.m44 = 1;
+
+  *out = mat;
+}
+
+static inline mat4
+glisy_mat4_from_quat (quat q) {
+  mat4 out;
+  glisy_mat4_from_quat_into(&out, &q);
+  return out;
+}
+
+#define mat4_from_quat(q) glisy_mat4_from_quat((q))
+
+/**
+ * Writes a string representation of mat4 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_mat4_format (char *buf, size_t size, mat4 a) {
+  return glisy_format_floats(buf, size, "mat4", &a.m11, 16, 4);
+}
+
+#define mat4_format(buf, size, a) glisy_mat4_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(mat4)
+
+/**
+ * Returns a string representation of mat4 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_mat4_string (mat4 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_mat4_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define mat4_string(a) glisy_mat4_string((a))
 
 #ifdef __cplusplus
 }
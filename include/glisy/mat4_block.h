@@ -0,0 +1,625 @@
+#ifndef GLISY_MAT4_BLOCK_H
+#define GLISY_MAT4_BLOCK_H
+
+#include <stddef.h>
+#include <glisy/simd.h>
+#include <glisy/mat4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of mat4s held by one mat4_block.
+ */
+
+#define GLISY_MAT4_BLOCK_LANES GLISY_LANES
+
+/**
+ * mat4_block struct type. Holds GLISY_MAT4_BLOCK_LANES mat4s
+ * lane interleaved (AoSoA): m[e][l] is element e of matrix l,
+ * with elements in mat4 field order (m11, m12, ... m44). Every
+ * element row is one SIMD register, so a batch kernel performs
+ * the same arithmetic as mat4_multiply on GLISY_MAT4_BLOCK_LANES
+ * matrices at once without shuffles.
+ */
+
+typedef struct mat4_block mat4_block;
+struct mat4_block {
+  float m[16][GLISY_MAT4_BLOCK_LANES];
+} GLISY_ALIGN(32);
+
+/**
+ * Returns the number of blocks needed to hold count mat4s.
+ */
+
+static inline size_t
+glisy_mat4_block_count (size_t count) {
+  return (count + GLISY_MAT4_BLOCK_LANES - 1) / GLISY_MAT4_BLOCK_LANES;
+}
+
+#define mat4_block_count(count) glisy_mat4_block_count((count))
+
+/**
+ * Interleaves GLISY_MAT4_BLOCK_LANES mat4s into a block.
+ */
+
+static inline void
+glisy_mat4_block_set_scalar (mat4_block *out, const mat4 *m) {
+  for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+    const float *src = &m[l].m11;
+    for (int e = 0; e < 16; ++e) {
+      out->m[e][l] = src[e];
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_block_set_sse (mat4_block *out, const mat4 *m) {
+  for (int g = 0; g < GLISY_MAT4_BLOCK_LANES; g += 4) {
+    for (int r = 0; r < 4; ++r) {
+      __m128 v0 = _mm_load_ps(&m[g + 0].m11 + 4 * r);
+      __m128 v1 = _mm_load_ps(&m[g + 1].m11 + 4 * r);
+      __m128 v2 = _mm_load_ps(&m[g + 2].m11 + 4 * r);
+      __m128 v3 = _mm_load_ps(&m[g + 3].m11 + 4 * r);
+      _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+      _mm_storeu_ps(&out->m[4 * r + 0][g], v0);
+      _mm_storeu_ps(&out->m[4 * r + 1][g], v1);
+      _mm_storeu_ps(&out->m[4 * r + 2][g], v2);
+      _mm_storeu_ps(&out->m[4 * r + 3][g], v3);
+    }
+  }
+}
+#endif
+
+/**
+ * Extracts the GLISY_MAT4_BLOCK_LANES mat4s of a block.
+ */
+
+static inline void
+glisy_mat4_block_get_scalar (mat4 *out, const mat4_block *b) {
+  for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+    float *dst = &out[l].m11;
+    for (int e = 0; e < 16; ++e) {
+      dst[e] = b->m[e][l];
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_block_get_sse (mat4 *out, const mat4_block *b) {
+  for (int g = 0; g < GLISY_MAT4_BLOCK_LANES; g += 4) {
+    for (int r = 0; r < 4; ++r) {
+      __m128 v0 = _mm_loadu_ps(&b->m[4 * r + 0][g]);
+      __m128 v1 = _mm_loadu_ps(&b->m[4 * r + 1][g]);
+      __m128 v2 = _mm_loadu_ps(&b->m[4 * r + 2][g]);
+      __m128 v3 = _mm_loadu_ps(&b->m[4 * r + 3][g]);
+      _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+      _mm_store_ps(&out[g + 0].m11 + 4 * r, v0);
+      _mm_store_ps(&out[g + 1].m11 + 4 * r, v1);
+      _mm_store_ps(&out[g + 2].m11 + 4 * r, v2);
+      _mm_store_ps(&out[g + 3].m11 + 4 * r, v3);
+    }
+  }
+}
+#endif
+
+/**
+ * Packs count mat4s into glisy_mat4_block_count(count) blocks.
+ * Unused lanes of the last block are set to identity.
+ */
+
+static inline void
+glisy_mat4_block_pack (mat4_block *out, const mat4 *in, size_t count) {
+  for (size_t i = 0; i < count; i += GLISY_MAT4_BLOCK_LANES) {
+    const mat4 *src = in + i;
+    mat4 tail[GLISY_MAT4_BLOCK_LANES];
+    if (count - i < GLISY_MAT4_BLOCK_LANES) {
+      for (size_t l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+        tail[l] = i + l < count ? in[i + l] : (mat4) {1, 0, 0, 0,
+                                                      0, 1, 0, 0,
+                                                      0, 0, 1, 0,
+                                                      0, 0, 0, 1};
+      }
+      src = tail;
+    }
+#ifdef GLISY_SSE2
+    glisy_mat4_block_set_sse(out++, src);
+#else
+    glisy_mat4_block_set_scalar(out++, src);
+#endif
+  }
+}
+
+/**
+ * Unpacks count mat4s from glisy_mat4_block_count(count) blocks.
+ */
+
+static inline void
+glisy_mat4_block_unpack (mat4 *out, const mat4_block *in, size_t count) {
+  for (size_t i = 0; i < count; i += GLISY_MAT4_BLOCK_LANES) {
+    mat4 tail[GLISY_MAT4_BLOCK_LANES];
+    mat4 *dst = count - i < GLISY_MAT4_BLOCK_LANES ? tail : out + i;
+#ifdef GLISY_SSE2
+    glisy_mat4_block_get_sse(dst, in++);
+#else
+    glisy_mat4_block_get_scalar(dst, in++);
+#endif
+    if (dst == tail) {
+      memcpy(out + i, tail, (count - i) * sizeof(mat4));
+    }
+  }
+}
+
+/**
+ * Multiplies every matrix of blocks a by mat4 b, equivalent to
+ * mat4_multiply(a[i], b) per matrix. Output columns are produced
+ * one at a time from the same column of a, so out may be a.
+ */
+
+static inline void
+glisy_mat4_block_multiply_mat4_scalar (mat4_block *out,
+                                       const mat4_block *a,
+                                       const mat4 *b,
+                                       size_t count) {
+  const float *bm = &b->m11;
+  for (size_t n = 0; n < count; ++n) {
+    for (int j = 0; j < 4; ++j) {
+      for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+        float a0 = a[n].m[j][l], a1 = a[n].m[4 + j][l];
+        float a2 = a[n].m[8 + j][l], a3 = a[n].m[12 + j][l];
+        for (int i = 0; i < 4; ++i) {
+          out[n].m[4 * i + j][l] = a0 * bm[4 * i + 0] + a1 * bm[4 * i + 1]
+                                 + a2 * bm[4 * i + 2] + a3 * bm[4 * i + 3];
+        }
+      }
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Returns x0 * y[0] + x1 * y[1] + x2 * y[2] + x3 * y[3], summed
+ * left to right like the scalar mat4_multiply.
+ */
+
+static inline glisy_lane
+glisy_mat4_block_dot (glisy_lane x0, glisy_lane x1,
+                      glisy_lane x2, glisy_lane x3,
+                      const glisy_lane *y) {
+  glisy_lane v = glisy_lane_mul(x0, y[0]);
+  v = glisy_lane_madd(x1, y[1], v);
+  v = glisy_lane_madd(x2, y[2], v);
+  return glisy_lane_madd(x3, y[3], v);
+}
+
+static inline void
+glisy_mat4_block_multiply_mat4_simd (mat4_block *out,
+                                     const mat4_block *a,
+                                     const mat4 *b,
+                                     size_t count) {
+  glisy_lane bs[16];
+  for (int e = 0; e < 16; ++e) {
+    bs[e] = glisy_lane_splat((&b->m11)[e]);
+  }
+  for (size_t n = 0; n < count; ++n) {
+    for (int j = 0; j < 4; ++j) {
+      glisy_lane a0 = glisy_lane_load(a[n].m[j]);
+      glisy_lane a1 = glisy_lane_load(a[n].m[4 + j]);
+      glisy_lane a2 = glisy_lane_load(a[n].m[8 + j]);
+      glisy_lane a3 = glisy_lane_load(a[n].m[12 + j]);
+      glisy_lane_store(out[n].m[0 + j],
+        glisy_mat4_block_dot(a0, a1, a2, a3, bs + 0));
+      glisy_lane_store(out[n].m[4 + j],
+        glisy_mat4_block_dot(a0, a1, a2, a3, bs + 4));
+      glisy_lane_store(out[n].m[8 + j],
+        glisy_mat4_block_dot(a0, a1, a2, a3, bs + 8));
+      glisy_lane_store(out[n].m[12 + j],
+        glisy_mat4_block_dot(a0, a1, a2, a3, bs + 12));
+    }
+  }
+}
+#endif
+
+static inline void
+glisy_mat4_block_multiply_mat4 (mat4_block *out,
+                                const mat4_block *a,
+                                const mat4 *b,
+                                size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_block_multiply_mat4_simd(out, a, b, count);
+#else
+  glisy_mat4_block_multiply_mat4_scalar(out, a, b, count);
+#endif
+}
+
+/**
+ * Multiplies mat4 a by every matrix of blocks b, equivalent to
+ * mat4_multiply(a, b[i]) per matrix. Output rows are produced
+ * one at a time from the same row of b, so out may be b.
+ */
+
+static inline void
+glisy_mat4_multiply_block_scalar (mat4_block *out,
+                                  const mat4 *a,
+                                  const mat4_block *b,
+                                  size_t count) {
+  const float *am = &a->m11;
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+        float b0 = b[n].m[4 * i + 0][l], b1 = b[n].m[4 * i + 1][l];
+        float b2 = b[n].m[4 * i + 2][l], b3 = b[n].m[4 * i + 3][l];
+        for (int j = 0; j < 4; ++j) {
+          out[n].m[4 * i + j][l] = am[j] * b0 + am[4 + j] * b1
+                                 + am[8 + j] * b2 + am[12 + j] * b3;
+        }
+      }
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_multiply_block_simd (mat4_block *out,
+                                const mat4 *a,
+                                const mat4_block *b,
+                                size_t count) {
+  glisy_lane as[16];
+  for (int e = 0; e < 16; ++e) {
+    as[e] = glisy_lane_splat((&a->m11)[4 * (e & 3) + (e >> 2)]);
+  }
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      glisy_lane b0 = glisy_lane_load(b[n].m[4 * i + 0]);
+      glisy_lane b1 = glisy_lane_load(b[n].m[4 * i + 1]);
+      glisy_lane b2 = glisy_lane_load(b[n].m[4 * i + 2]);
+      glisy_lane b3 = glisy_lane_load(b[n].m[4 * i + 3]);
+      glisy_lane_store(out[n].m[4 * i + 0],
+        glisy_mat4_block_dot(b0, b1, b2, b3, as + 0));
+      glisy_lane_store(out[n].m[4 * i + 1],
+        glisy_mat4_block_dot(b0, b1, b2, b3, as + 4));
+      glisy_lane_store(out[n].m[4 * i + 2],
+        glisy_mat4_block_dot(b0, b1, b2, b3, as + 8));
+      glisy_lane_store(out[n].m[4 * i + 3],
+        glisy_mat4_block_dot(b0, b1, b2, b3, as + 12));
+    }
+  }
+}
+#endif
+
+static inline void
+glisy_mat4_multiply_block (mat4_block *out,
+                           const mat4 *a,
+                           const mat4_block *b,
+                           size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_multiply_block_simd(out, a, b, count);
+#else
+  glisy_mat4_multiply_block_scalar(out, a, b, count);
+#endif
+}
+
+/**
+ * Multiplies blocks a and b matrix by matrix, equivalent to
+ * mat4_multiply(a[i], b[i]). Output rows are produced one at a
+ * time from the same row of b, so out may be b but not a.
+ */
+
+static inline void
+glisy_mat4_block_multiply_scalar (mat4_block *out,
+                                  const mat4_block *a,
+                                  const mat4_block *b,
+                                  size_t count) {
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+        float b0 = b[n].m[4 * i + 0][l], b1 = b[n].m[4 * i + 1][l];
+        float b2 = b[n].m[4 * i + 2][l], b3 = b[n].m[4 * i + 3][l];
+        for (int j = 0; j < 4; ++j) {
+          out[n].m[4 * i + j][l] = a[n].m[j][l] * b0
+                                 + a[n].m[4 + j][l] * b1
+                                 + a[n].m[8 + j][l] * b2
+                                 + a[n].m[12 + j][l] * b3;
+        }
+      }
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_block_multiply_simd (mat4_block *out,
+                                const mat4_block *a,
+                                const mat4_block *b,
+                                size_t count) {
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      glisy_lane b0 = glisy_lane_load(b[n].m[4 * i + 0]);
+      glisy_lane b1 = glisy_lane_load(b[n].m[4 * i + 1]);
+      glisy_lane b2 = glisy_lane_load(b[n].m[4 * i + 2]);
+      glisy_lane b3 = glisy_lane_load(b[n].m[4 * i + 3]);
+      for (int j = 0; j < 4; ++j) {
+        glisy_lane col[4] = {glisy_lane_load(a[n].m[j]),
+                             glisy_lane_load(a[n].m[4 + j]),
+                             glisy_lane_load(a[n].m[8 + j]),
+                             glisy_lane_load(a[n].m[12 + j])};
+        glisy_lane_store(out[n].m[4 * i + j],
+                         glisy_mat4_block_dot(b0, b1, b2, b3, col));
+      }
+    }
+  }
+}
+#endif
+
+static inline void
+glisy_mat4_block_multiply (mat4_block *out,
+                           const mat4_block *a,
+                           const mat4_block *b,
+                           size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_block_multiply_simd(out, a, b, count);
+#else
+  glisy_mat4_block_multiply_scalar(out, a, b, count);
+#endif
+}
+
+/**
+ * Multiplies affine blocks a and b matrix by matrix, equivalent to
+ * mat4_multiply_affine(a[i], b[i]). Like glisy_mat4_block_multiply
+ * out may be b but not a.
+ */
+
+static inline void
+glisy_mat4_block_multiply_affine_scalar (mat4_block *out,
+                                         const mat4_block *a,
+                                         const mat4_block *b,
+                                         size_t count) {
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+        float b0 = b[n].m[4 * i + 0][l], b1 = b[n].m[4 * i + 1][l];
+        float b2 = b[n].m[4 * i + 2][l];
+        for (int j = 0; j < 3; ++j) {
+          out[n].m[4 * i + j][l] = a[n].m[j][l] * b0
+                                 + a[n].m[4 + j][l] * b1
+                                 + a[n].m[8 + j][l] * b2
+                                 + (i == 3 ? a[n].m[12 + j][l] : 0);
+        }
+        out[n].m[4 * i + 3][l] = i == 3;
+      }
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_mat4_block_multiply_affine_simd (mat4_block *out,
+                                       const mat4_block *a,
+                                       const mat4_block *b,
+                                       size_t count) {
+  glisy_lane zero = glisy_lane_zero();
+  glisy_lane one = glisy_lane_splat(1.0f);
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      glisy_lane b0 = glisy_lane_load(b[n].m[4 * i + 0]);
+      glisy_lane b1 = glisy_lane_load(b[n].m[4 * i + 1]);
+      glisy_lane b2 = glisy_lane_load(b[n].m[4 * i + 2]);
+      for (int j = 0; j < 3; ++j) {
+        glisy_lane v = glisy_lane_mul(glisy_lane_load(a[n].m[j]), b0);
+        v = glisy_lane_madd(glisy_lane_load(a[n].m[4 + j]), b1, v);
+        v = glisy_lane_madd(glisy_lane_load(a[n].m[8 + j]), b2, v);
+        if (i == 3) v = glisy_lane_add(v, glisy_lane_load(a[n].m[12 + j]));
+        glisy_lane_store(out[n].m[4 * i + j], v);
+      }
+      glisy_lane_store(out[n].m[4 * i + 3], i == 3 ? one : zero);
+    }
+  }
+}
+#endif
+
+static inline void
+glisy_mat4_block_multiply_affine (mat4_block *out,
+                                  const mat4_block *a,
+                                  const mat4_block *b,
+                                  size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_block_multiply_affine_simd(out, a, b, count);
+#else
+  glisy_mat4_block_multiply_affine_scalar(out, a, b, count);
+#endif
+}
+
+/**
+ * Inverts every matrix of blocks in, equivalent to
+ * mat4_invert_affine and mat4_invert_rigid per matrix. out may be
+ * in.
+ */
+
+static inline void
+glisy_mat4_block_invert_affine_scalar (mat4_block *out,
+                                       const mat4_block *in,
+                                       size_t count) {
+  for (size_t n = 0; n < count; ++n) {
+    for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+      float a[16], r[9];
+      for (int e = 0; e < 16; ++e) {
+        a[e] = in[n].m[e][l];
+      }
+      r[0] = a[5] * a[10] - a[6] * a[9];
+      r[1] = a[2] * a[9] - a[1] * a[10];
+      r[2] = a[1] * a[6] - a[2] * a[5];
+      r[3] = a[6] * a[8] - a[4] * a[10];
+      r[4] = a[0] * a[10] - a[2] * a[8];
+      r[5] = a[2] * a[4] - a[0] * a[6];
+      r[6] = a[4] * a[9] - a[5] * a[8];
+      r[7] = a[1] * a[8] - a[0] * a[9];
+      r[8] = a[0] * a[5] - a[1] * a[4];
+      float det = a[0] * r[0] + a[1] * r[3] + a[2] * r[6];
+      det = det ? 1.0f / det : 0;
+      for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          out[n].m[4 * i + j][l] = r[3 * i + j] * det;
+        }
+        out[n].m[4 * i + 3][l] = 0;
+      }
+      for (int j = 0; j < 3; ++j) {
+        out[n].m[12 + j][l] = -(a[12] * r[j] + a[13] * r[3 + j]
+                              + a[14] * r[6 + j]) * det;
+      }
+      out[n].m[15][l] = det ? 1 : 0;
+    }
+  }
+}
+
+static inline void
+glisy_mat4_block_invert_rigid_scalar (mat4_block *out,
+                                      const mat4_block *in,
+                                      size_t count) {
+  for (size_t n = 0; n < count; ++n) {
+    for (int l = 0; l < GLISY_MAT4_BLOCK_LANES; ++l) {
+      float a[16];
+      for (int e = 0; e < 16; ++e) {
+        a[e] = in[n].m[e][l];
+      }
+      for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          out[n].m[4 * i + j][l] = a[4 * j + i];
+        }
+        out[n].m[4 * i + 3][l] = 0;
+        out[n].m[12 + i][l] = -(a[12] * a[4 * i] + a[13] * a[4 * i + 1]
+                              + a[14] * a[4 * i + 2]);
+      }
+      out[n].m[15][l] = 1;
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Stores the translation row -(t * r) of an inverse with rotation
+ * rows r (9 lanes) and a constant m44.
+ */
+
+static inline void
+glisy_mat4_block_store_inverse_translation (mat4_block *out,
+                                            const glisy_lane *t,
+                                            const glisy_lane *r,
+                                            glisy_lane m44) {
+  for (int j = 0; j < 3; ++j) {
+    glisy_lane v = glisy_lane_mul(t[0], r[j]);
+    v = glisy_lane_madd(t[1], r[3 + j], v);
+    v = glisy_lane_madd(t[2], r[6 + j], v);
+    glisy_lane_store(out->m[12 + j], glisy_lane_sub(glisy_lane_zero(), v));
+  }
+  glisy_lane_store(out->m[15], m44);
+}
+
+static inline void
+glisy_mat4_block_invert_affine_simd (mat4_block *out,
+                                     const mat4_block *in,
+                                     size_t count) {
+  glisy_lane zero = glisy_lane_zero();
+  glisy_lane one = glisy_lane_splat(1.0f);
+  for (size_t n = 0; n < count; ++n) {
+    glisy_lane a00 = glisy_lane_load(in[n].m[0]);
+    glisy_lane a01 = glisy_lane_load(in[n].m[1]);
+    glisy_lane a02 = glisy_lane_load(in[n].m[2]);
+    glisy_lane a10 = glisy_lane_load(in[n].m[4]);
+    glisy_lane a11 = glisy_lane_load(in[n].m[5]);
+    glisy_lane a12 = glisy_lane_load(in[n].m[6]);
+    glisy_lane a20 = glisy_lane_load(in[n].m[8]);
+    glisy_lane a21 = glisy_lane_load(in[n].m[9]);
+    glisy_lane a22 = glisy_lane_load(in[n].m[10]);
+    glisy_lane t[3] = {glisy_lane_load(in[n].m[12]),
+                       glisy_lane_load(in[n].m[13]),
+                       glisy_lane_load(in[n].m[14])};
+
+    glisy_lane r[9] = {
+      glisy_lane_sub(glisy_lane_mul(a11, a22), glisy_lane_mul(a12, a21)),
+      glisy_lane_sub(glisy_lane_mul(a02, a21), glisy_lane_mul(a01, a22)),
+      glisy_lane_sub(glisy_lane_mul(a01, a12), glisy_lane_mul(a02, a11)),
+      glisy_lane_sub(glisy_lane_mul(a12, a20), glisy_lane_mul(a10, a22)),
+      glisy_lane_sub(glisy_lane_mul(a00, a22), glisy_lane_mul(a02, a20)),
+      glisy_lane_sub(glisy_lane_mul(a02, a10), glisy_lane_mul(a00, a12)),
+      glisy_lane_sub(glisy_lane_mul(a10, a21), glisy_lane_mul(a11, a20)),
+      glisy_lane_sub(glisy_lane_mul(a01, a20), glisy_lane_mul(a00, a21)),
+      glisy_lane_sub(glisy_lane_mul(a00, a11), glisy_lane_mul(a01, a10))
+    };
+    glisy_lane det = glisy_lane_mul(a00, r[0]);
+    det = glisy_lane_madd(a01, r[3], det);
+    det = glisy_lane_madd(a02, r[6], det);
+
+    // singular lanes become all zeros, like mat4_invert
+    glisy_lane singular = glisy_lane_eq(det, zero);
+    det = glisy_lane_select(singular, zero, glisy_lane_div(one, det));
+    for (int e = 0; e < 9; ++e) {
+      r[e] = glisy_lane_mul(r[e], det);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+      glisy_lane_store(out[n].m[4 * i + 0], r[3 * i + 0]);
+      glisy_lane_store(out[n].m[4 * i + 1], r[3 * i + 1]);
+      glisy_lane_store(out[n].m[4 * i + 2], r[3 * i + 2]);
+      glisy_lane_store(out[n].m[4 * i + 3], zero);
+    }
+    glisy_mat4_block_store_inverse_translation(&out[n], t, r,
+      glisy_lane_select(singular, zero, one));
+  }
+}
+
+static inline void
+glisy_mat4_block_invert_rigid_simd (mat4_block *out,
+                                    const mat4_block *in,
+                                    size_t count) {
+  glisy_lane zero = glisy_lane_zero();
+  for (size_t n = 0; n < count; ++n) {
+    glisy_lane r[9], t[3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        r[3 * j + i] = glisy_lane_load(in[n].m[4 * i + j]);
+      }
+      t[i] = glisy_lane_load(in[n].m[12 + i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+      glisy_lane_store(out[n].m[4 * i + 0], r[3 * i + 0]);
+      glisy_lane_store(out[n].m[4 * i + 1], r[3 * i + 1]);
+      glisy_lane_store(out[n].m[4 * i + 2], r[3 * i + 2]);
+      glisy_lane_store(out[n].m[4 * i + 3], zero);
+    }
+    glisy_mat4_block_store_inverse_translation(&out[n], t, r,
+                                               glisy_lane_splat(1.0f));
+  }
+}
+#endif
+
+static inline void
+glisy_mat4_block_invert_affine (mat4_block *out,
+                                const mat4_block *in,
+                                size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_block_invert_affine_simd(out, in, count);
+#else
+  glisy_mat4_block_invert_affine_scalar(out, in, count);
+#endif
+}
+
+static inline void
+glisy_mat4_block_invert_rigid (mat4_block *out,
+                               const mat4_block *in,
+                               size_t count) {
+#ifdef GLISY_SSE2
+  glisy_mat4_block_invert_rigid_simd(out, in, count);
+#else
+  glisy_mat4_block_invert_rigid_scalar(out, in, count);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
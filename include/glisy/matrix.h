@@ -4,6 +4,7 @@
 #include <glisy/mat2.h>
 #include <glisy/mat3.h>
 #include <glisy/mat4.h>
+#include <glisy/mat4_block.h>
 #include <glisy/quat.h>
 
 #endif
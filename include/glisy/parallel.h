@@ -0,0 +1,611 @@
+#ifndef GLISY_PARALLEL_H
+#define GLISY_PARALLEL_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/mat4.h>
+#include <glisy/mat4_block.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+
+#ifndef GLISY_NO_THREADS
+#include <pthread.h>
+#include <glisy/atomic.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bytes of input and output one chunk of a parallel loop aims to
+ * touch, so a chunk stays in a core's private cache. The chunk
+ * grain of glisy_parallel_for is this divided by the bytes per item.
+ */
+
+#ifndef GLISY_PARALLEL_CHUNK_BYTES
+#define GLISY_PARALLEL_CHUNK_BYTES (64 * 1024)
+#endif
+
+/**
+ * Chunks start on multiples of this many items, so SoA chunks
+ * begin on GLISY_SIMD_ALIGN boundaries and SIMD kernels never share
+ * a register between two threads.
+ */
+
+#define GLISY_PARALLEL_ALIGN GLISY_SOA_PAD
+
+/**
+ * glisy_pool_init flags. GLISY_POOL_PIN pins worker thread i to
+ * CPU i modulo the online CPU count; GLISY_POOL_PIN_CALLER also pins
+ * the calling thread, which runs as worker 0, to CPU 0. Pinning is
+ * a no-op outside Linux.
+ */
+
+#define GLISY_POOL_PIN 1
+#define GLISY_POOL_PIN_CALLER 2
+
+/**
+ * Loop body run by glisy_parallel_for over items [begin, end) on
+ * worker thread worker, 0 being the calling thread.
+ */
+
+typedef void (*glisy_parallel_fn) (void *ctx, size_t begin, size_t end,
+                                   unsigned worker);
+
+#ifndef GLISY_NO_THREADS
+
+/**
+ * One worker's share of a loop. Owners and thieves claim chunks
+ * from the front with a compare and swap on next. Each range has
+ * its own cache line.
+ */
+
+typedef struct glisy_pool_range glisy_pool_range;
+struct glisy_pool_range {
+  atomic_size_t next;
+  size_t end;
+} GLISY_ALIGN(GLISY_SIMD_ALIGN);
+
+typedef struct glisy_pool_worker glisy_pool_worker;
+struct glisy_pool_worker {
+  struct glisy_pool *pool;
+  unsigned index;
+  pthread_t thread;
+};
+#endif
+
+/**
+ * glisy_pool struct type. A fixed set of worker threads that sleep
+ * until glisy_parallel_for hands them a loop. The calling thread
+ * works as worker 0. chunks and steals count the chunks run by the
+ * last loop and how many of them were taken from another worker's
+ * range.
+ */
+
+typedef struct glisy_pool glisy_pool;
+struct glisy_pool {
+  unsigned threads;
+  int flags;
+  size_t chunks;
+  size_t steals;
+#ifndef GLISY_NO_THREADS
+  glisy_pool_worker *workers;
+  glisy_pool_range *ranges;
+  pthread_mutex_t submit;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  unsigned generation;
+  unsigned active;
+  int stop;
+  glisy_parallel_fn fn;
+  void *ctx;
+  size_t grain;
+  size_t align;
+  atomic_size_t claimed;
+  atomic_size_t stolen;
+#endif
+};
+
+#ifndef GLISY_NO_THREADS
+
+/**
+ * Pins the calling thread to CPU cpu modulo the online CPU count.
+ */
+
+static inline void
+glisy_pool_pin (unsigned cpu) {
+#ifdef __linux__
+  unsigned long mask[16] = {0};
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned bits = 8 * sizeof(unsigned long);
+  if (online < 1) return;
+  cpu %= (unsigned) online;
+  if (cpu >= 16 * bits) return;
+  mask[cpu / bits] = 1ul << (cpu % bits);
+  syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask);
+#else
+  (void) cpu;
+#endif
+}
+
+/**
+ * Claims the next chunk of range r: a quarter of what is left, but
+ * never less than grain, rounded to align, a power of two. Chunks
+ * shrink as a range drains, so large loops pay for few claims and
+ * the last chunks are small enough to balance across thieves.
+ * Returns 0 when r is empty.
+ */
+
+static inline int
+glisy_pool_claim (glisy_pool_range *r, size_t grain, size_t align,
+                  size_t *begin, size_t *end) {
+  size_t next = atomic_load_explicit(&r->next, memory_order_relaxed);
+  size_t stop;
+  do {
+    if (next >= r->end) return 0;
+    size_t size = (r->end - next) / 4;
+    if (size < grain) size = grain;
+    size = (size + align - 1) & ~(align - 1);
+    stop = size < r->end - next ? next + size : r->end;
+  } while (!atomic_compare_exchange_weak_explicit(
+             &r->next, &next, stop,
+             memory_order_relaxed, memory_order_relaxed));
+  *begin = next;
+  *end = stop;
+  return 1;
+}
+
+/**
+ * Runs worker w's own range, then steals from the others in turn.
+ */
+
+static inline void
+glisy_pool_run (glisy_pool *p, unsigned w) {
+  size_t claimed = 0, stolen = 0, begin, end;
+  for (unsigned k = 0; k < p->threads; ++k) {
+    glisy_pool_range *r = &p->ranges[(w + k) % p->threads];
+    while (glisy_pool_claim(r, p->grain, p->align, &begin, &end)) {
+      p->fn(p->ctx, begin, end, w);
+      claimed++;
+      stolen += k != 0;
+    }
+  }
+  atomic_fetch_add_explicit(&p->claimed, claimed, memory_order_relaxed);
+  atomic_fetch_add_explicit(&p->stolen, stolen, memory_order_relaxed);
+}
+
+static inline void *
+glisy_pool_thread (void *arg) {
+  glisy_pool_worker *worker = (glisy_pool_worker *) arg;
+  glisy_pool *p = worker->pool;
+  unsigned seen = 0;
+  if (p->flags & GLISY_POOL_PIN) glisy_pool_pin(worker->index);
+  for (;;) {
+    pthread_mutex_lock(&p->lock);
+    while (p->generation == seen && !p->stop) {
+      pthread_cond_wait(&p->wake, &p->lock);
+    }
+    if (p->stop) {
+      pthread_mutex_unlock(&p->lock);
+      return NULL;
+    }
+    seen = p->generation;
+    pthread_mutex_unlock(&p->lock);
+
+    glisy_pool_run(p, worker->index);
+
+    pthread_mutex_lock(&p->lock);
+    if (0 == --p->active) pthread_cond_signal(&p->done);
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+#endif
+
+/**
+ * Stops and joins the workers of pool p and releases its storage.
+ */
+
+static inline void
+glisy_pool_destroy (glisy_pool *p) {
+#ifndef GLISY_NO_THREADS
+  if (p->workers) {
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    for (unsigned t = 1; t < p->threads; ++t) {
+      pthread_join(p->workers[t].thread, NULL);
+    }
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->submit);
+  }
+  free(p->workers);
+  free(p->ranges);
+#endif
+  memset((void *) p, 0, sizeof(*p));
+}
+
+/**
+ * Starts pool p with threads threads including the caller, or one
+ * per online CPU when threads is 0. flags is 0 or a combination of
+ * GLISY_POOL_PIN and GLISY_POOL_PIN_CALLER. Returns 0 on success and
+ * -1 when memory or threads cannot be allocated, leaving p empty.
+ * With GLISY_NO_THREADS the pool always has one thread.
+ */
+
+static inline int
+glisy_pool_init (glisy_pool *p, unsigned threads, int flags) {
+  memset((void *) p, 0, sizeof(*p));
+  p->threads = 1;
+  p->flags = flags;
+#ifndef GLISY_NO_THREADS
+  if (0 == threads) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (unsigned) online : 1;
+  }
+  if (flags & GLISY_POOL_PIN_CALLER) glisy_pool_pin(0);
+
+  p->workers = (glisy_pool_worker *)
+    calloc(threads, sizeof(glisy_pool_worker));
+  p->ranges = (glisy_pool_range *)
+    glisy_simd_alloc(threads * sizeof(glisy_pool_range));
+  if (!p->workers || !p->ranges) {
+    free(p->workers);
+    free(p->ranges);
+    memset((void *) p, 0, sizeof(*p));
+    return -1;
+  }
+  pthread_mutex_init(&p->submit, NULL);
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wake, NULL);
+  pthread_cond_init(&p->done, NULL);
+  for (unsigned t = 0; t < threads; ++t) {
+    p->workers[t].pool = p;
+    p->workers[t].index = t;
+    atomic_init(&p->ranges[t].next, 0);
+    p->ranges[t].end = 0;
+  }
+  for (; p->threads < threads; ++p->threads) {
+    glisy_pool_worker *w = &p->workers[p->threads];
+    if (pthread_create(&w->thread, NULL, glisy_pool_thread, w)) {
+      glisy_pool_destroy(p);
+      return -1;
+    }
+  }
+#else
+  (void) threads;
+#endif
+  return 0;
+}
+
+#define glisy_pool_create() ((glisy_pool) {0})
+
+/**
+ * Runs fn over items [0, count) across the threads of pool p in
+ * chunks of at least grain items starting on multiples of align, a
+ * power of two. Each worker starts on its own slice and steals from
+ * the others once it runs dry. Runs fn on the calling thread in one
+ * call when p is NULL or has one thread, when count is under two
+ * grains, and when p is busy, which covers calls made from inside a
+ * loop body.
+ */
+
+static inline void
+glisy_pool_submit (glisy_pool *p, size_t count, size_t grain,
+                   size_t align, glisy_parallel_fn fn, void *ctx) {
+  if (0 == count) return;
+#ifndef GLISY_NO_THREADS
+  if (p && p->threads > 1 && count >= 2 * grain &&
+      0 == pthread_mutex_trylock(&p->submit)) {
+    unsigned n = p->threads;
+    size_t slice = ((count + n - 1) / n + align - 1) & ~(align - 1);
+    for (unsigned t = 0; t < n; ++t) {
+      size_t begin = t * slice < count ? t * slice : count;
+      size_t end = begin + slice < count ? begin + slice : count;
+      atomic_store_explicit(&p->ranges[t].next, begin,
+                            memory_order_relaxed);
+      p->ranges[t].end = t + 1 == n ? count : end;
+    }
+    atomic_store_explicit(&p->claimed, 0, memory_order_relaxed);
+    atomic_store_explicit(&p->stolen, 0, memory_order_relaxed);
+
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->ctx = ctx;
+    p->grain = grain;
+    p->align = align;
+    p->active = n - 1;
+    p->generation++;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    glisy_pool_run(p, 0);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->active) pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    p->chunks = atomic_load(&p->claimed);
+    p->steals = atomic_load(&p->stolen);
+    pthread_mutex_unlock(&p->submit);
+    return;
+  }
+#else
+  (void) p;
+  (void) grain;
+  (void) align;
+#endif
+  fn(ctx, 0, count, 0);
+}
+
+/**
+ * Calls fn(ctx, begin, end, worker) over disjoint chunks covering
+ * items [0, count) across the threads of pool p, and returns when
+ * all are done. item_bytes is roughly how many bytes each item
+ * reads and writes; it sets the smallest chunk to about
+ * GLISY_PARALLEL_CHUNK_BYTES. Chunks start on multiples of
+ * GLISY_PARALLEL_ALIGN. Runs on the calling thread as described
+ * for glisy_pool_submit.
+ */
+
+static inline void
+glisy_parallel_for (glisy_pool *p, size_t count, size_t item_bytes,
+                    glisy_parallel_fn fn, void *ctx) {
+  size_t grain = GLISY_PARALLEL_CHUNK_BYTES / (item_bytes ? item_bytes : 1);
+  grain = (grain + GLISY_PARALLEL_ALIGN - 1) &
+          ~(size_t) (GLISY_PARALLEL_ALIGN - 1);
+  if (0 == grain) grain = GLISY_PARALLEL_ALIGN;
+  glisy_pool_submit(p, count, grain, GLISY_PARALLEL_ALIGN, fn, ctx);
+}
+
+/**
+ * Calls fn like glisy_parallel_for, but over chunks of at least
+ * grain items that may start on any item, for loops whose items
+ * are too large or uneven to size by bytes, such as whole tracks.
+ */
+
+static inline void
+glisy_parallel_for_grain (glisy_pool *p, size_t count, size_t grain,
+                          glisy_parallel_fn fn, void *ctx) {
+  glisy_pool_submit(p, count, grain ? grain : 1, 1, fn, ctx);
+}
+
+/**
+ * Parallel forms of the batch kernels. Each splits its batch with
+ * glisy_parallel_for and runs the single threaded kernel on every
+ * chunk, so results match the serial calls exactly.
+ */
+
+typedef struct glisy_parallel_batch glisy_parallel_batch;
+struct glisy_parallel_batch {
+  void *out;
+  const void *a;
+  const void *b;
+  int flag;
+};
+
+static inline void
+glisy_parallel_vec3_transform_fn (void *ctx, size_t begin, size_t end,
+                                  unsigned worker) {
+  glisy_parallel_batch *j = (glisy_parallel_batch *) ctx;
+  vec3 *out = (vec3 *) j->out + begin;
+  const vec3 *in = (const vec3 *) j->a + begin;
+  (void) worker;
+  if (j->flag) {
+    glisy_vec3_transform_mat4_affine_batch(out, in, end - begin,
+                                           (const mat4 *) j->b);
+  } else {
+    glisy_vec3_transform_mat4_batch(out, in, end - begin, (const mat4 *) j->b);
+  }
+}
+
+static inline void
+glisy_parallel_vec3_transform_mat4_batch (glisy_pool *p,
+                                          vec3 *out,
+                                          const vec3 *in,
+                                          size_t count,
+                                          const mat4 *mat) {
+  glisy_parallel_batch j = {out, in, mat, 0};
+  glisy_parallel_for(p, count, 2 * sizeof(vec3),
+                     glisy_parallel_vec3_transform_fn, &j);
+}
+
+static inline void
+glisy_parallel_vec3_transform_mat4_affine_batch (glisy_pool *p,
+                                                 vec3 *out,
+                                                 const vec3 *in,
+                                                 size_t count,
+                                                 const mat4 *mat) {
+  glisy_parallel_batch j = {out, in, mat, 1};
+  glisy_parallel_for(p, count, 2 * sizeof(vec3),
+                     glisy_parallel_vec3_transform_fn, &j);
+}
+
+static inline void
+glisy_parallel_vec4_transform_fn (void *ctx, size_t begin, size_t end,
+                                  unsigned worker) {
+  glisy_parallel_batch *j = (glisy_parallel_batch *) ctx;
+  (void) worker;
+  glisy_vec4_transform_mat4_batch((vec4 *) j->out + begin,
+                                  (const vec4 *) j->a + begin,
+                                  end - begin, (const mat4 *) j->b);
+}
+
+static inline void
+glisy_parallel_vec4_transform_mat4_batch (glisy_pool *p,
+                                          vec4 *out,
+                                          const vec4 *in,
+                                          size_t count,
+                                          const mat4 *mat) {
+  glisy_parallel_batch j = {out, in, mat, 0};
+  glisy_parallel_for(p, count, 2 * sizeof(vec4),
+                     glisy_parallel_vec4_transform_fn, &j);
+}
+
+static inline void
+glisy_parallel_vec3_soa_normalize_fn (void *ctx, size_t begin, size_t end,
+                                      unsigned worker) {
+  glisy_parallel_batch *j = (glisy_parallel_batch *) ctx;
+  const vec3_soa *a = (const vec3_soa *) j->a;
+  vec3_soa *o = (vec3_soa *) j->out;
+  size_t n = end - begin;
+  vec3_soa in = {a->x + begin, a->y + begin, a->z + begin, n, n};
+  vec3_soa out = {o->x + begin, o->y + begin, o->z + begin, n, n};
+  (void) worker;
+  glisy_vec3_soa_normalize_kernel(&out, &in, j->flag);
+}
+
+/**
+ * Normalizes vec3_soa a into out like glisy_vec3_soa_normalize,
+ * or glisy_vec3_soa_normalize_fast when fast is non-zero. Returns
+ * -1 when out cannot grow.
+ */
+
+static inline int
+glisy_parallel_vec3_soa_normalize (glisy_pool *p,
+                                   vec3_soa *out,
+                                   const vec3_soa *a,
+                                   int fast) {
+  glisy_parallel_batch j = {out, a, NULL, fast};
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+  glisy_parallel_for(p, a->count, 6 * sizeof(float),
+                     glisy_parallel_vec3_soa_normalize_fn, &j);
+  return 0;
+}
+
+static inline void
+glisy_parallel_quat_soa_normalize_fn (void *ctx, size_t begin, size_t end,
+                                      unsigned worker) {
+  glisy_parallel_batch *j = (glisy_parallel_batch *) ctx;
+  const quat_soa *a = (const quat_soa *) j->a;
+  quat_soa *o = (quat_soa *) j->out;
+  size_t n = end - begin;
+  quat_soa in = {a->x + begin, a->y + begin, a->z + begin, a->w + begin,
+                 n, n};
+  quat_soa out = {o->x + begin, o->y + begin, o->z + begin, o->w + begin,
+                  n, n};
+  (void) worker;
+  glisy_quat_soa_normalize_kernel(&out, &in, j->flag);
+}
+
+static inline int
+glisy_parallel_quat_soa_normalize (glisy_pool *p,
+                                   quat_soa *out,
+                                   const quat_soa *a,
+                                   int fast) {
+  glisy_parallel_batch j = {out, a, NULL, fast};
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+  glisy_parallel_for(p, a->count, 8 * sizeof(float),
+                     glisy_parallel_quat_soa_normalize_fn, &j);
+  return 0;
+}
+
+/**
+ * Pairwise mat4 products, out[i] = a[i] * b[i], with
+ * mat4_multiply or, when affine, mat4_multiply_affine. out may be
+ * a or b.
+ */
+
+typedef struct glisy_parallel_mat4_job glisy_parallel_mat4_job;
+struct glisy_parallel_mat4_job {
+  mat4 *out;
+  const mat4 *a;
+  const mat4 *b;
+  int affine;
+};
+
+static inline void
+glisy_parallel_mat4_multiply_fn (void *ctx, size_t begin, size_t end,
+                                 unsigned worker) {
+  glisy_parallel_mat4_job *j = (glisy_parallel_mat4_job *) ctx;
+  (void) worker;
+  if (j->affine) {
+    glisy_mat4_multiply_affine_batch(j->out + begin, j->a + begin,
+                                     j->b + begin, end - begin);
+    return;
+  }
+  for (size_t i = begin; i < end; ++i) {
+    glisy_mat4_multiply_into(&j->out[i], &j->a[i], &j->b[i]);
+  }
+}
+
+static inline void
+glisy_parallel_mat4_multiply_batch (glisy_pool *p,
+                                    mat4 *out,
+                                    const mat4 *a,
+                                    const mat4 *b,
+                                    size_t count) {
+  glisy_parallel_mat4_job j = {out, a, b, 0};
+  glisy_parallel_for(p, count, 3 * sizeof(mat4),
+                     glisy_parallel_mat4_multiply_fn, &j);
+}
+
+static inline void
+glisy_parallel_mat4_multiply_affine_batch (glisy_pool *p,
+                                           mat4 *out,
+                                           const mat4 *a,
+                                           const mat4 *b,
+                                           size_t count) {
+  glisy_parallel_mat4_job j = {out, a, b, 1};
+  glisy_parallel_for(p, count, 3 * sizeof(mat4),
+                     glisy_parallel_mat4_multiply_fn, &j);
+}
+
+/**
+ * Block forms: glisy_mat4_block_multiply over count block pairs
+ * and glisy_mat4_block_multiply_mat4 of count blocks by one mat4.
+ */
+
+static inline void
+glisy_parallel_mat4_block_fn (void *ctx, size_t begin, size_t end,
+                              unsigned worker) {
+  glisy_parallel_batch *j = (glisy_parallel_batch *) ctx;
+  mat4_block *out = (mat4_block *) j->out + begin;
+  const mat4_block *a = (const mat4_block *) j->a + begin;
+  (void) worker;
+  if (j->flag) {
+    glisy_mat4_block_multiply_mat4(out, a, (const mat4 *) j->b, end - begin);
+  } else {
+    glisy_mat4_block_multiply(out, a, (const mat4_block *) j->b + begin,
+                              end - begin);
+  }
+}
+
+static inline void
+glisy_parallel_mat4_block_multiply (glisy_pool *p,
+                                    mat4_block *out,
+                                    const mat4_block *a,
+                                    const mat4_block *b,
+                                    size_t count) {
+  glisy_parallel_batch j = {out, a, b, 0};
+  glisy_parallel_for(p, count, 3 * sizeof(mat4_block),
+                     glisy_parallel_mat4_block_fn, &j);
+}
+
+static inline void
+glisy_parallel_mat4_block_multiply_mat4 (glisy_pool *p,
+                                         mat4_block *out,
+                                         const mat4_block *a,
+                                         const mat4 *b,
+                                         size_t count) {
+  glisy_parallel_batch j = {out, a, b, 1};
+  glisy_parallel_for(p, count, 2 * sizeof(mat4_block),
+                     glisy_parallel_mat4_block_fn, &j);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
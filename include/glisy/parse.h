@@ -0,0 +1,349 @@
+#ifndef GLISY_PARSE_H
+#define GLISY_PARSE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glisy/vec2.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/mat2.h>
+#include <glisy/mat3.h>
+#include <glisy/mat4.h>
+#include <glisy/mat3x4.h>
+#include <glisy/trs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parses the text the *_format and *_string functions write, such
+ * as "vec3(1, 2, 3)", one value at a time or in bulk into arrays.
+ * Whitespace, including newlines, may appear between any tokens.
+ * Numbers take the decimal forms strtof reads plus nan and inf.
+ * Floats are exact: most numbers go through one correctly rounded
+ * double operation, and the rest fall back to strtof.
+ */
+
+/**
+ * glisy_parser struct type. Reads size bytes at data, which need
+ * not be NUL terminated, from offset pos. After a failed parse,
+ * error describes the problem and pos is its offset. more is set
+ * instead of error when the input ended inside a value; pos is
+ * then the start of that value, so a streaming reader can append
+ * data and parse again from there.
+ */
+
+typedef struct glisy_parser glisy_parser;
+struct glisy_parser {
+  const char *data;
+  size_t size;
+  size_t pos;
+  const char *error;
+  int more;
+};
+
+#define glisy_parser(data, size) ((glisy_parser) {(data), (size), 0, NULL, 0})
+
+/**
+ * Returns the 1-based line and column of the parser position.
+ */
+
+static inline size_t
+glisy_parser_line (const glisy_parser *p) {
+  size_t line = 1;
+  for (size_t i = 0; i < p->pos && i < p->size; ++i) {
+    line += '\n' == p->data[i];
+  }
+  return line;
+}
+
+static inline size_t
+glisy_parser_column (const glisy_parser *p) {
+  size_t i = p->pos < p->size ? p->pos : p->size;
+  size_t column = 1;
+  while (i > 0 && p->data[i - 1] != '\n') {
+    --i;
+    ++column;
+  }
+  return column;
+}
+
+static inline void
+glisy_parser_skip (glisy_parser *p) {
+  while (p->pos < p->size) {
+    char c = p->data[p->pos];
+    if (c != ' ' && c != '\n' && c != '\t' && c != '\r') break;
+    ++p->pos;
+  }
+}
+
+/**
+ * Returns non-zero when only whitespace is left.
+ */
+
+static inline int
+glisy_parser_done (glisy_parser *p) {
+  glisy_parser_skip(p);
+  return p->pos >= p->size;
+}
+
+/**
+ * Records a failure at offset pos. Running out of input sets more
+ * and rewinds to start, the beginning of the value being read.
+ */
+
+static inline int
+glisy_parser_fail (glisy_parser *p, size_t pos, size_t start,
+                   const char *error) {
+  if (pos >= p->size) {
+    p->more = 1;
+    p->error = NULL;
+    p->pos = start;
+  } else {
+    p->more = 0;
+    p->error = error;
+    p->pos = pos;
+  }
+  return -1;
+}
+
+/**
+ * Returns the float nearest w * 10^q in out when one rounding of
+ * an exact double gets it: w and 10^|q| are exact doubles below
+ * 2^53 and 10^22, so the product or quotient is correctly rounded,
+ * and rounding that to float is correct unless it lands exactly
+ * between two floats. Returns -1 when the caller must fall back.
+ */
+
+static inline int
+glisy_parse_decimal (uint64_t w, int32_t q, float *out) {
+  static const double powers[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  if (0 == w) {
+    *out = 0.0f;
+    return 0;
+  }
+  if (w > ((uint64_t) 1 << 53) || q < -22 || q > 22) return -1;
+  double d = q < 0 ? (double) w / powers[-q] : (double) w * powers[q];
+  float f = (float) d;
+  if ((double) f != d) {
+    double g = nextafterf(f, d > f ? INFINITY : -INFINITY);
+    if (2 * d == (double) f + g) return -1;
+  }
+  *out = f;
+  return 0;
+}
+
+/**
+ * Reads a float at the parser position into out.
+ */
+
+static inline int
+glisy_parse_float (glisy_parser *p, float *out) {
+  const char *s = p->data;
+  size_t start, i, n = p->size;
+  uint64_t w = 0;
+  int32_t q = 0, digits = 0, e = 0;
+  int negative = 0, truncated = 0;
+
+  glisy_parser_skip(p);
+  start = i = p->pos;
+  if (i < n && ('-' == s[i] || '+' == s[i])) negative = '-' == s[i++];
+
+  if (i < n && ('n' == s[i] || 'i' == s[i])) {
+    const char *word = 'n' == s[i] ? "nan" : "inf";
+    for (int k = 0; k < 3; ++k, ++i) {
+      if (i >= n || s[i] != word[k]) {
+        return glisy_parser_fail(p, i, start, "expected a number");
+      }
+    }
+    *out = 'n' == word[0] ? NAN : negative ? -INFINITY : INFINITY;
+    p->pos = i;
+    return 0;
+  }
+
+  size_t mantissa = i;
+  for (; i < n && s[i] >= '0' && s[i] <= '9'; ++i) {
+    if (digits < 19) {
+      w = w * 10 + (uint64_t) (s[i] - '0');
+      digits += w != 0;
+    } else {
+      ++q;
+      truncated |= s[i] != '0';
+    }
+  }
+  if (i < n && '.' == s[i]) {
+    for (++i; i < n && s[i] >= '0' && s[i] <= '9'; ++i) {
+      if (digits < 19) {
+        w = w * 10 + (uint64_t) (s[i] - '0');
+        digits += w != 0;
+        --q;
+      } else {
+        truncated |= s[i] != '0';
+      }
+    }
+  }
+  if (i == mantissa || (i == mantissa + 1 && '.' == s[mantissa])) {
+    return glisy_parser_fail(p, i, start, "expected a number");
+  }
+  if (i < n && ('e' == s[i] || 'E' == s[i])) {
+    int esign = 1;
+    size_t exponent = ++i;
+    if (i < n && ('-' == s[i] || '+' == s[i])) esign = '-' == s[i++] ? -1 : 1;
+    for (; i < n && s[i] >= '0' && s[i] <= '9'; ++i) {
+      if (e < 100000) e = e * 10 + (s[i] - '0');
+    }
+    if (i == exponent || ('-' == s[i - 1] || '+' == s[i - 1])) {
+      return glisy_parser_fail(p, i, start, "expected an exponent");
+    }
+    q += esign * e;
+  }
+  // a number running into the end of a stream may continue
+  if (i >= n) return glisy_parser_fail(p, i, start, NULL);
+
+  if (truncated || glisy_parse_decimal(w, q, out)) {
+    char buf[64];
+    size_t len = i - start;
+    if (len >= sizeof(buf)) {
+      return glisy_parser_fail(p, start, start, "number too long");
+    }
+    memcpy(buf, s + start, len);
+    buf[len] = 0;
+    *out = strtof(buf, NULL);
+  } else if (negative) {
+    *out = -*out;
+  }
+  p->pos = i;
+  return 0;
+}
+
+/**
+ * Reads the literal text at the parser position, after whitespace.
+ */
+
+static inline int
+glisy_parse_literal (glisy_parser *p, const char *text, size_t start,
+                     const char *error) {
+  glisy_parser_skip(p);
+  for (size_t k = 0; text[k]; ++k) {
+    size_t i = p->pos + k;
+    if (i >= p->size || p->data[i] != text[k]) {
+      return glisy_parser_fail(p, i, start, error);
+    }
+  }
+  p->pos += strlen(text);
+  return 0;
+}
+
+/**
+ * Reads "name(a, b, ...)" with count floats into out. Used by the
+ * typed parsers; name may be empty for a bare "(a, b, ...)".
+ */
+
+static inline int
+glisy_parse_floats (glisy_parser *p, const char *name,
+                    float *out, int count) {
+  size_t start;
+  glisy_parser_skip(p);
+  start = p->pos;
+  if (p->pos >= p->size) return glisy_parser_fail(p, p->pos, start, NULL);
+  if (glisy_parse_literal(p, name, start, "unexpected type name") ||
+      glisy_parse_literal(p, "(", start, "expected '('")) {
+    return -1;
+  }
+  for (int k = 0; k < count; ++k) {
+    if (k && glisy_parse_literal(p, ",", start, "expected ','")) return -1;
+    if (glisy_parse_float(p, &out[k])) {
+      if (p->more) p->pos = start;
+      return -1;
+    }
+  }
+  return glisy_parse_literal(p, ")", start, "expected ')'");
+}
+
+/**
+ * Typed parsers. Each reads one value and returns 0, or -1 with
+ * the parser error or more set.
+ */
+
+#define GLISY_PARSE_TYPE(type, first, count)                           \
+  static inline int                                                    \
+  glisy_parse_##type (glisy_parser *p, type *out) {                    \
+    type value;                                                        \
+    if (glisy_parse_floats(p, #type, &value.first, count)) return -1;  \
+    *out = value;                                                      \
+    return 0;                                                          \
+  }
+
+GLISY_PARSE_TYPE(vec2, x, 2)
+GLISY_PARSE_TYPE(vec3, x, 3)
+GLISY_PARSE_TYPE(vec4, x, 4)
+GLISY_PARSE_TYPE(quat, x, 4)
+GLISY_PARSE_TYPE(mat2, m11, 4)
+GLISY_PARSE_TYPE(mat3, m11, 9)
+GLISY_PARSE_TYPE(mat4, m11, 16)
+GLISY_PARSE_TYPE(mat3x4, m11, 12)
+
+static inline int
+glisy_parse_trs (glisy_parser *p, trs *out) {
+  trs value;
+  size_t start;
+  glisy_parser_skip(p);
+  start = p->pos;
+  if (p->pos >= p->size) return glisy_parser_fail(p, p->pos, start, NULL);
+  if (glisy_parse_literal(p, "trs(", start, "unexpected type name") ||
+      glisy_parse_floats(p, "translation=", &value.translation.x, 3) ||
+      glisy_parse_literal(p, ",", start, "expected ','") ||
+      glisy_parse_floats(p, "rotation=", &value.rotation.x, 4) ||
+      glisy_parse_literal(p, ",", start, "expected ','") ||
+      glisy_parse_floats(p, "scale=", &value.scale.x, 3) ||
+      glisy_parse_literal(p, ")", start, "expected ')'")) {
+    if (p->more) p->pos = start;
+    return -1;
+  }
+  *out = value;
+  return 0;
+}
+
+/**
+ * Bulk parsers. Each reads values separated by whitespace into out
+ * until the input ends or capacity values are read, and returns
+ * how many it read. Check error, or more when streaming, to tell a
+ * clean stop from a failure; pos is then just past the last value.
+ */
+
+#define GLISY_PARSE_ARRAY(type)                                        \
+  static inline size_t                                                 \
+  glisy_parse_##type##_array (glisy_parser *p, type *out,              \
+                              size_t capacity) {                       \
+    size_t count = 0;                                                  \
+    p->error = NULL;                                                   \
+    p->more = 0;                                                       \
+    while (count < capacity && !glisy_parser_done(p)) {                \
+      if (glisy_parse_##type(p, &out[count])) break;                   \
+      ++count;                                                         \
+    }                                                                  \
+    return count;                                                      \
+  }
+
+GLISY_PARSE_ARRAY(vec2)
+GLISY_PARSE_ARRAY(vec3)
+GLISY_PARSE_ARRAY(vec4)
+GLISY_PARSE_ARRAY(quat)
+GLISY_PARSE_ARRAY(mat2)
+GLISY_PARSE_ARRAY(mat3)
+GLISY_PARSE_ARRAY(mat4)
+GLISY_PARSE_ARRAY(mat3x4)
+GLISY_PARSE_ARRAY(trs)
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,18 +1,12 @@
 #ifndef GLISY_QUAT_H
 #define GLISY_QUAT_H
 
-#include <glisy/mat3.h>
-#include <glisy/vec4.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#define VAR_PTR_ACCESS(m, x) (*((float *) (&(m) + (x)))
-#define VAR_PTR_SET(m, x, v) ({         \
-  float *ptr = ((float *) (&(m) + (x)); \
-  *ptr = v;                             \
-})
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
 
 /**
  * quat struct type.
@@ -21,6 +15,19 @@ extern "C" {
 typedef struct quat quat;
 struct quat { float x; float y; float z; float w; };
 
+/**
+ * Types used by quat routines. Included after the
+ * quat struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/mat3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * quat initializers.
  */
@@ -33,120 +40,305 @@ struct quat { float x; float y; float z; float w; };
  * Inherit vec4 routines.
  */
 
-#define quat_length_squared(...) vec4_length_squared(__VA_ARGS__)
-#define quat_normalize(...) vec4_normalize(__VA_ARGS__)
-#define quat_length(...) vec4_length(__VA_ARGS__)
-#define quat_clone(...) vec4_clone(__VA_ARGS__)
-#define quat_scale(...) vec4_scale(__VA_ARGS__)
-#define quat_copy(...) vec4_copy(__VA_ARGS__)
-#define quat_lerp(...) vec4_lerp(__VA_ARGS__)
-#define quat_add(...) vec4_add(__VA_ARGS__)
-#define quat_dot(...) vec4_dot(__VA_ARGS__)
+static inline float
+glisy_quat_length_squared (quat a) {
+  return a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w;
+}
+
+static inline void
+glisy_quat_normalize_into (quat *out, const quat *a) {
+  float len = a->x * a->x + a->y * a->y + a->z * a->z + a->w * a->w;
+  quat q = {0, 0, 0, 0};
+  if (len > 0) {
+    len = glisy_rsqrtf(len);
+    q.x = a->x * len;
+    q.y = a->y * len;
+    q.z = a->z * len;
+    q.w = a->w * len;
+  }
+  *out = q;
+}
+
+static inline quat
+glisy_quat_normalize (quat a) {
+  quat out;
+  glisy_quat_normalize_into(&out, &a);
+  return out;
+}
+
+static inline void
+glisy_quat_normalize_fast_into (quat *out, const quat *a) {
+  float len = a->x * a->x + a->y * a->y + a->z * a->z + a->w * a->w;
+  float s = len > 0 ? glisy_rsqrtf_fast(len) : 0;
+  *out = (quat) {a->x * s, a->y * s, a->z * s, a->w * s};
+}
+
+static inline quat
+glisy_quat_normalize_fast (quat a) {
+  quat out;
+  glisy_quat_normalize_fast_into(&out, &a);
+  return out;
+}
+
+static inline float
+glisy_quat_length (quat a) {
+  return glisy_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+}
+
+static inline float
+glisy_quat_length_fast (quat a) {
+  return glisy_sqrtf_fast(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+}
+
+static inline quat
+glisy_quat_clone (quat a) {
+  return (quat) {a.x, a.y, a.z, a.w};
+}
+
+static inline void
+glisy_quat_scale_into (quat *out, const quat *a, float s) {
+  *out = (quat) {a->x * s, a->y * s, a->z * s, a->w * s};
+}
+
+static inline quat
+glisy_quat_scale (quat a, float s) {
+  quat out;
+  glisy_quat_scale_into(&out, &a, s);
+  return out;
+}
+
+static inline quat
+glisy_quat_copy (quat *a, quat b) {
+  a->x = b.x;
+  a->y = b.y;
+  a->z = b.z;
+  a->w = b.w;
+  return *a;
+}
+
+static inline void
+glisy_quat_lerp_into (quat *out, const quat *a, const quat *b, float t) {
+  *out = (quat) {a->x + t * (b->x - a->x),
+                 a->y + t * (b->y - a->y),
+                 a->z + t * (b->z - a->z),
+                 a->w + t * (b->w - a->w)};
+}
+
+static inline quat
+glisy_quat_lerp (quat a, quat b, float t) {
+  quat out;
+  glisy_quat_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+static inline void
+glisy_quat_add_into (quat *out, const quat *a, const quat *b) {
+  *out = (quat) {a->x + b->x, a->y + b->y, a->z + b->z, a->w + b->w};
+}
+
+static inline quat
+glisy_quat_add (quat a, quat b) {
+  quat out;
+  glisy_quat_add_into(&out, &a, &b);
+  return out;
+}
+
+static inline float
+glisy_quat_dot (quat a, quat b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+#define quat_length_squared(a) glisy_quat_length_squared((a))
+#define quat_normalize(a) glisy_quat_normalize((a))
+#define quat_length(a) glisy_quat_length((a))
+#define quat_normalize_fast(a) glisy_quat_normalize_fast((a))
+#define quat_length_fast(a) glisy_quat_length_fast((a))
+#define quat_clone(a) glisy_quat_clone((a))
+#define quat_scale(a, s) glisy_quat_scale((a), (s))
+#define quat_copy(a, b) glisy_quat_copy(&(a), (b))
+#define quat_lerp(a, b, t) glisy_quat_lerp((a), (b), (t))
+#define quat_add(a, b) glisy_quat_add((a), (b))
+#define quat_dot(a, b) glisy_quat_dot((a), (b))
 
 /**
  * Setd quat components
  */
 
-#define quat_set(q, a, b, c, d) ({ \
-  (q).x = (a);                     \
-  (q).y = (b);                     \
-  (q).z = (c);                     \
-  (q).w = (d);                     \
-  (q);                             \
-})
+static inline quat
+glisy_quat_set (quat *q, float a, float b, float c, float d) {
+  q->x = a;
+  q->y = b;
+  q->z = c;
+  q->w = d;
+  return *q;
+}
+
+#define quat_set(q, a, b, c, d) glisy_quat_set(&(q), (a), (b), (c), (d))
+
+/**
+ * Creates quat from mat3
+ */
+
+static inline quat
+glisy_quat_from_mat3 (mat3 a) {
+  const float *m = &a.m11;
+  float trace = a.m11 + a.m22 + a.m33;
+  float root;
+  quat q;
+
+  if (trace > 0.0) {
+    root = sqrtf(trace + 1.0f);
+    q.w = 0.5f * root;
+    root = 0.5f / root;
+    q.x = (a.m23 - a.m32) * root;
+    q.y = (a.m31 - a.m13) * root;
+    q.z = (a.m12 - a.m21) * root;
+  } else {
+    float *v = &q.x;
+    int i = 0, j, k;
+    if (a.m22 > a.m11) {
+      i = 1;
+    }
+    if (a.m33 > m[i * 3 + i]) {
+      i = 2;
+    }
+    j = (i + 1) % 3;
+    k = (i + 2) % 3;
+    root = sqrtf(m[i * 3 + i] - m[j * 3 + j] - m[k * 3 + k] + 1.0f);
+    v[i] = 0.5f * root;
+    root = 0.5f / root;
+    q.w = (m[j * 3 + k] - m[k * 3 + j]) * root;
+    v[j] = (m[j * 3 + i] + m[i * 3 + j]) * root;
+    v[k] = (m[k * 3 + i] + m[i * 3 + k]) * root;
+  }
+  return q;
+}
+
+#define quat_from_mat3(m) glisy_quat_from_mat3((m))
 
 /**
  * Sets the specified quaternion with values corresponding to the given
  * axes with the view, right, and up vec3 vectors.
  */
 
-#define quat_set_axes(q, view, right, up)  ({       \
-  mat3 a = mat3(0);                                 \
-  a.m11 = (right).x;                                \
-  a.m21 = (right).y;                                \
-  a.m31 = (right).z;                                \
-  a.m12 = (up).x;                                   \
-  a.m22 = (up).y;                                   \
-  a.m32 = (up).z;                                   \
-  a.m13 = -(view).x;                                \
-  a.m23 = -(view).y;                                \
-  a.m33 = -(view).z;                                \
-  (quat_normalize((q), quat_from_mat3((a)));        \
-})
+static inline quat
+glisy_quat_set_axes (quat *q, vec3 view, vec3 right, vec3 up) {
+  mat3 a;
+  a.m11 = right.x;
+  a.m21 = right.y;
+  a.m31 = right.z;
+  a.m12 = up.x;
+  a.m22 = up.y;
+  a.m32 = up.z;
+  a.m13 = -view.x;
+  a.m23 = -view.y;
+  a.m33 = -view.z;
+  *q = glisy_quat_normalize(glisy_quat_from_mat3(a));
+  return *q;
+}
+
+#define quat_set_axes(q, view, right, up) \
+  glisy_quat_set_axes(&(q), (view), (right), (up))
 
 /**
  * Sets a quat from the given angle and rotation axis,
  * then returns it.
  */
 
-#define quat_set_axis_angle(q, axis, rad)  ({       \
-  float r = rad * 0.5;                              \
-  float s = sinf(r);                                \
-  float c = cosf(r);                                \
-  (q).x = s * (axis).x;                             \
-  (q).y = s * (axis).y;                             \
-  (q).z = s * (axis).z;                             \
-  (q).w = c;                                        \
-  (q);                                              \
-})
+static inline quat
+glisy_quat_set_axis_angle (quat *q, vec3 axis, float rad) {
+  float r = rad * 0.5f;
+  float s, c;
+  glisy_sincosf(r, &s, &c);
+  q->x = s * axis.x;
+  q->y = s * axis.y;
+  q->z = s * axis.z;
+  q->w = c;
+  return *q;
+}
+
+#define quat_set_axis_angle(q, axis, rad) \
+  glisy_quat_set_axis_angle(&(q), (axis), (rad))
 
 /**
  * Multiply two quats
  */
 
-#define quat_multiply(a, b) ({                          \
-  float ax = (a).x, ay = (a).y, az = (a).z, aw = (a).w; \
-  float bx = (b).x, by = (b).y, bz = (b).z, bw = (b).w; \
-  (quat(ax * bw + aw * bx + ay * bz - az * by,          \
-        ay * bw + aw * by + az * bx - ax * bz,          \
-        az * bw + aw * bz + ax * by - ay * bx,          \
-        aw * bw - ax * bx - ay * by - az * bz));        \
-})
+static inline void
+glisy_quat_multiply_into (quat *out, const quat *a, const quat *b) {
+  float ax = a->x, ay = a->y, az = a->z, aw = a->w;
+  float bx = b->x, by = b->y, bz = b->z, bw = b->w;
+  *out = (quat) {ax * bw + aw * bx + ay * bz - az * by,
+                 ay * bw + aw * by + az * bx - ax * bz,
+                 az * bw + aw * bz + ax * by - ay * bx,
+                 aw * bw - ax * bx - ay * by - az * bz};
+}
+
+static inline quat
+glisy_quat_multiply (quat a, quat b) {
+  quat out;
+  glisy_quat_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define quat_multiply(a, b) glisy_quat_multiply((a), (b))
 
 /**
  * Rotates a quaternion by the given angle around the X axis
  */
 
-#define quat_rotateX(q, rad) ({                         \
-  float r = rad * 0.5;                                  \
-  float ax = (q).x, ay = (q).y, az = (q).z, aw = (q).w; \
-  float bx = sinf(r), bw = cosf(r);                     \
-  (q).x = ax * bw + aw * bx;                            \
-  (q).y = ay * bw + az * bx;                            \
-  (q).z = az * bw - ay * bx;                            \
-  (q).w = aw * bw - ax * bx;                            \
-  (q);                                                  \
-})
+static inline quat
+glisy_quat_rotateX (quat *q, float rad) {
+  float r = rad * 0.5f;
+  float ax = q->x, ay = q->y, az = q->z, aw = q->w;
+  float bx, bw;
+  glisy_sincosf(r, &bx, &bw);
+  q->x = ax * bw + aw * bx;
+  q->y = ay * bw + az * bx;
+  q->z = az * bw - ay * bx;
+  q->w = aw * bw - ax * bx;
+  return *q;
+}
+
+#define quat_rotateX(q, rad) glisy_quat_rotateX(&(q), (rad))
 
 /**
  * Rotates a quaternion by the given angle around the Y axis
  */
 
-#define quat_rotateY(q, rad) ({                         \
-  float r = rad * 0.5;                                  \
-  float ax = (q).x, ay = (q).y, az = (q).z, aw = (q).w; \
-  float bx = sinf(r), bw = cosf(r);                     \
-  (q).x = ax * bw - az * bx;                            \
-  (q).y = ay * bw + aw * bx;                            \
-  (q).z = az * bw + ax * bx;                            \
-  (q).w = aw * bw - ay * bx;                            \
-  (q);                                                  \
-})
+static inline quat
+glisy_quat_rotateY (quat *q, float rad) {
+  float r = rad * 0.5f;
+  float ax = q->x, ay = q->y, az = q->z, aw = q->w;
+  float bx, bw;
+  glisy_sincosf(r, &bx, &bw);
+  q->x = ax * bw - az * bx;
+  q->y = ay * bw + aw * bx;
+  q->z = az * bw + ax * bx;
+  q->w = aw * bw - ay * bx;
+  return *q;
+}
+
+#define quat_rotateY(q, rad) glisy_quat_rotateY(&(q), (rad))
 
 /**
  * Rotates a quaternion by the given angle around the Z axis
  */
 
-#define quat_rotateZ(q, rad) ({                         \
-  float r = rad * 0.5;                                  \
-  float ax = (q).x, ay = (q).y, az = (q).z, aw = (q).w; \
-  float bx = sinf(r), bw = cosf(r);                     \
-  (q).x = ax * bw + ay * bx;                            \
-  (q).y = ay * bw - ax * bx;                            \
-  (q).z = az * bw + aw * bx;                            \
-  (q).w = aw * bw - az * bx;                            \
-  (q);                                                  \
-})
+static inline quat
+glisy_quat_rotateZ (quat *q, float rad) {
+  float r = rad * 0.5f;
+  float ax = q->x, ay = q->y, az = q->z, aw = q->w;
+  float bx, bw;
+  glisy_sincosf(r, &bx, &bw);
+  q->x = ax * bw + ay * bx;
+  q->y = ay * bw - ax * bx;
+  q->z = az * bw + aw * bx;
+  q->w = aw * bw - az * bx;
+  return *q;
+}
+
+#define quat_rotateZ(q, rad) glisy_quat_rotateZ(&(q), (rad))
 
 /**
  * Calculates the W component of a quat from the X, Y,
@@ -154,120 +346,130 @@ struct quat { float x; float y; float z; float w; };
  * in length. Any existing W component will be ignored.
  */
 
-#define quat_calculateW(a)  ({                     \
-  float x = (a).x, y = (a).y, z = (a).z;           \
-  (a).w = sqrt(abs(1.0 - x * x - y * y - z * z));  \
-})
+static inline quat
+glisy_quat_calculateW (quat *a) {
+  float x = a->x, y = a->y, z = a->z;
+  a->w = sqrtf(fabsf(1.0f - x * x - y * y - z * z));
+  return *a;
+}
+
+#define quat_calculateW(a) glisy_quat_calculateW(&(a))
 
 /**
  * Performs a linear interpolation between two quat.
  */
 
-#define quat_slerp(q, a, b, t)  ({                      \
-  float ax = (a).x, ay = (a).y, az = (a).z, aw = (a).w; \
-  float bx = (b).x, by = (b).y, bz = (b).z, bw = (b).w; \
-  float omega, sinom, scale0, scale1;                   \
-  float cosom = ax * bx + ay * by + az * bz + aw * bw;  \
-  if ( cosom < 0.0 ) {                                  \
-    cosom = -cosom;                                     \
-    bx = - bx;                                          \
-    by = - by;                                          \
-    bz = - bz;                                          \
-    bw = - bw;                                          \
-  }                                                     \
-  if ((1.0 - cosom) > 0.000001) {                       \
-    omega  = acosf(cosom);                              \
-    sinom  = sinf(omega);                               \
-    scale0 = sinf((1.0 - t) * omega) / sinom;           \
-    scale1 = sinf(t * omega) / sinom;                   \
-  } else {                                              \
-    scale0 = 1.0 - t;                                   \
-    scale1 = t;                                         \
-  }                                                     \
-  (q).x = scale0 * ax + scale1 * bx;                    \
-  (q).y = scale0 * ay + scale1 * by;                    \
-  (q).z = scale0 * az + scale1 * bz;                    \
-  (q).w = scale0 * aw + scale1 * bw;                    \
-  (q);                                                  \
-})
+static inline void
+glisy_quat_slerp_into (quat *out, const quat *a, const quat *b, float t) {
+  float ax = a->x, ay = a->y, az = a->z, aw = a->w;
+  float bx = b->x, by = b->y, bz = b->z, bw = b->w;
+  float omega, sinom, scale0, scale1;
+  float cosom = ax * bx + ay * by + az * bz + aw * bw;
+  if (cosom < 0.0) {
+    cosom = -cosom;
+    bx = - bx;
+    by = - by;
+    bz = - bz;
+    bw = - bw;
+  }
+  if ((1.0 - cosom) > 0.000001) {
+    // sin((1 - t) w) = sin(w) cos(tw) - cos(w) sin(tw)
+    float st, ct;
+    omega  = acosf(cosom);
+    sinom  = sqrtf(1.0f - cosom * cosom);
+    glisy_sincosf(t * omega, &st, &ct);
+    scale1 = st / sinom;
+    scale0 = ct - cosom * scale1;
+  } else {
+    scale0 = 1.0 - t;
+    scale1 = t;
+  }
+  out->x = scale0 * ax + scale1 * bx;
+  out->y = scale0 * ay + scale1 * by;
+  out->z = scale0 * az + scale1 * bz;
+  out->w = scale0 * aw + scale1 * bw;
+}
+
+static inline quat
+glisy_quat_slerp (quat *q, quat a, quat b, float t) {
+  glisy_quat_slerp_into(q, &a, &b, t);
+  return *q;
+}
+
+#define quat_slerp(q, a, b, t) glisy_quat_slerp(&(q), (a), (b), (t))
 
 /**
  * Inverts a quat
  */
 
-#define quat_invert(a)  ({                              \
-  float a0 = (a).x, a1 = (a).y, a2 = (a).z, a3 = (a).w; \
-  float dot = a0*a0 + a1*a1 + a2*a2 + a3*a3;            \
-  float inverse = 0 != dot ? (1.0 / dot) : 0;           \
-  if (inverse) {                                        \
-    (a).x = -a1 * inverse;                              \
-    (a).x = -a0 * inverse;                              \
-    (a).x = -a2 * inverse;                              \
-    (a).x = +a3 * inverse;                              \
-  }                                                     \
-  (a);                                                  \
-})
+static inline void
+glisy_quat_invert_into (quat *out, const quat *a) {
+  float a0 = a->x, a1 = a->y, a2 = a->z, a3 = a->w;
+  float dot = a0*a0 + a1*a1 + a2*a2 + a3*a3;
+  float inverse = 0 != dot ? (1.0f / dot) : 0;
+  if (inverse) {
+    out->x = -a0 * inverse;
+    out->y = -a1 * inverse;
+    out->z = -a2 * inverse;
+    out->w = +a3 * inverse;
+  } else {
+    *out = (quat) {a0, a1, a2, a3};
+  }
+}
+
+static inline quat
+glisy_quat_invert (quat *a) {
+  glisy_quat_invert_into(a, a);
+  return *a;
+}
+
+#define quat_invert(a) glisy_quat_invert(&(a))
 
 /**
  * Calcluates the conjugate.
  */
 
-#define quat_conjugate(a)  ({ -(a).x, -(a).y, -(a).z, +(a).w, })
+static inline void
+glisy_quat_conjugate_into (quat *out, const quat *a) {
+  *out = (quat) {-a->x, -a->y, -a->z, +a->w};
+}
+
+static inline quat
+glisy_quat_conjugate (quat a) {
+  quat out;
+  glisy_quat_conjugate_into(&out, &a);
+  return out;
+}
+
+#define quat_conjugate(a) glisy_quat_conjugate((a))
 
 /**
- * Creates quat from mat3
+ * Writes a string representation of quat a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
  */
 
-#define quat_from_mat3(m)  ({                         \
-  quat q = quat(0);                                   \
-  mat3 *ptr = (mat3 *) &(m);                          \
-  float trace = (m).m11 + (m).m22 + (m).m33;          \
-  float i, j, k;                                      \
-  float root;                                         \
-  if (trace > 0.0) {                                  \
-    root = sqrt(trace + 1.0);                         \
-    q.w = 0.5 * root;                                 \
-    root = 0.5 / root;                                \
-    q.x = ((m).m23 - (m).m32) * root;                 \
-    q.y = ((m).m31 - (m).m13) * root;                 \
-    q.x = ((m).m12 - (m).m21) * root;                 \
-  } else {                                            \
-  if ((m).m22 > (m).m11) {                            \
-    i = 1;                                            \
-  }                                                   \
-  if ((m).m32 > VAR_PTR_ACCESS(m, i * 3 + i)) {       \
-    i = 2;                                            \
-  }                                                   \
-  j = (i + 1) % 3;                                    \
-  k = (i + 2) % 3;                                    \
-  root = sqrtf(VAR_PTR_ACCESS(m, i * 3 + i)           \
-             - VAR_PTR_ACCESS(m, j * 3 + j)           \
-             - VAR_PTR_ACCESS(m, k * 3 + k)           \
-             + 1.0);                                  \
-  VAR_PTR_SET(q, i, 0.5 * root);                      \
-  root = 0.5 / root;                                  \
-  VAR_PTR_SET(q, 3, (VAR_PTR_ACCESS(m, j * 3 + k)     \
-                   - VAR_PTR_ACCESS(m, k * 3 + j))    \
-                   * root);                           \
-  VAR_PTR_SET(q, j, (VAR_PTR_ACCESS(m, j * 3 + i)     \
-                   + VAR_PTR_ACCESS(m, i * 3 + j))    \
-                   * root);                           \
-  VAR_PTR_SET(q, k, (VAR_PTR_ACCESS(m, k * 3 + i)     \
-                   + VAR_PTR_ACCESS(m, i * 3 + k))    \
-                   * root);                           \
-  }                                                   \
-})
+static inline size_t
+glisy_quat_format (char *buf, size_t size, quat a) {
+  return glisy_format_floats(buf, size, "quat", &a.x, 4, 4);
+}
+
+#define quat_format(buf, size, a) glisy_quat_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(quat)
 
 /**
- * Returns a string representation of quat a.
+ * Returns a string representation of quat a, allocated with
+ * strdup. The caller frees it.
  */
 
-#define quat_string(a) (const char *) ({                            \
-  char str[BUFSIZ];                                                 \
-  memset(str, 0, BUFSIZ);                                           \
-  sprintf(str, "quat(%g, %g, %g, %g)", (a).x, (a).y, (a).z, (a).w); \
-  (strdup(str));                                                    \
-})
+static inline const char *
+glisy_quat_string (quat a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_quat_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define quat_string(a) glisy_quat_string((a))
 
 #ifdef __cplusplus
 }
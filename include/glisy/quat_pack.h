@@ -0,0 +1,434 @@
+#ifndef GLISY_QUAT_PACK_H
+#define GLISY_QUAT_PACK_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <glisy/simd.h>
+#include <glisy/half.h>
+#include <glisy/quat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compressed unit quaternions.
+ *
+ * quat32, quat48 and quat64 use the smallest three encoding: the
+ * component with the largest magnitude is dropped and rebuilt from
+ * the unit length on decode, and the other three, which lie in
+ * [-1/sqrt(2), 1/sqrt(2)], are quantized to 10, 15 or 20 bits. The
+ * sign is flipped first so the dropped component is positive, as
+ * q and -q are the same rotation. Inputs must be unit length.
+ *
+ * hquat stores the four components as halves. It keeps the sign
+ * and is not renormalized on decode.
+ *
+ * Layouts: quat32 is index << 30 | a << 20 | b << 10 | c. quat64 is
+ * index << 62 | a << 40 | b << 20 | c. quat48 is three 15 bit
+ * fields, with bit 15 of the first two holding the index.
+ */
+
+typedef uint32_t quat32;
+typedef uint64_t quat64;
+
+typedef struct quat48 quat48;
+struct quat48 { uint16_t v[3]; };
+
+typedef struct hquat hquat;
+struct hquat { uint16_t x; uint16_t y; uint16_t z; uint16_t w; };
+
+#define GLISY_QUAT32_BITS 10
+#define GLISY_QUAT48_BITS 15
+#define GLISY_QUAT64_BITS 20
+
+/**
+ * Returns the worst case rotation error in degrees of a smallest
+ * three encoding with bits per field. Each field is within half a
+ * step, e = 1 / (sqrt(2) * (2^bits - 1)), of its value, so with the
+ * rebuilt component the decoded quaternion is within sqrt(12) * e,
+ * and the rotation within 4 * asin(sqrt(3) * e). A float ulp of
+ * slack per field covers rounding.
+ */
+
+static inline float
+glisy_quat_pack_bound (int bits) {
+  double e = 1 / (sqrt(2.0) * (double) ((1u << bits) - 1)) + 0x1p-23;
+  return (float) (4 * asin(sqrt(3.0) * e) * 180 / M_PI);
+}
+
+#define glisy_quat32_error_bound() \
+  glisy_quat_pack_bound(GLISY_QUAT32_BITS)
+#define glisy_quat48_error_bound() \
+  glisy_quat_pack_bound(GLISY_QUAT48_BITS)
+#define glisy_quat64_error_bound() \
+  glisy_quat_pack_bound(GLISY_QUAT64_BITS)
+
+/**
+ * Returns the worst case rotation error in degrees of hquat. Each
+ * component is within 2^-12 for unit input, so the quaternion is
+ * within 2^-11, and within 2^-10 once normalized.
+ */
+
+static inline float
+glisy_hquat_error_bound (void) {
+  return (float) (4 * asin(0x1p-11) * 180 / M_PI);
+}
+
+/**
+ * Returns the angle in degrees of the rotation between a and b,
+ * which need not be normalized. The angle comes from the vector
+ * part of conj(a) * b, which stays accurate for tiny angles where
+ * acos of the dot product does not.
+ */
+
+static inline float
+glisy_quat_error_degrees (quat a, quat b) {
+  double ax = a.x, ay = a.y, az = a.z, aw = a.w;
+  double bx = b.x, by = b.y, bz = b.z, bw = b.w;
+  double w = aw * bw + ax * bx + ay * by + az * bz;
+  double x = aw * bx - ax * bw - ay * bz + az * by;
+  double y = aw * by - ay * bw - az * bx + ax * bz;
+  double z = aw * bz - az * bw - ax * by + ay * bx;
+  return (float) (2 * atan2(sqrt(x * x + y * y + z * z), fabs(w)) *
+                  180 / M_PI);
+}
+
+/**
+ * Splits unit quaternion q into the index of its largest component
+ * and the other three quantized to bits.
+ */
+
+static inline uint32_t
+glisy_quat_pack_fields (quat q, int bits, uint32_t field[3]) {
+  float c[4] = {q.x, q.y, q.z, q.w};
+  float ax = fabsf(q.x), ay = fabsf(q.y), az = fabsf(q.z), aw = fabsf(q.w);
+  float m = fmaxf(fmaxf(ax, ay), fmaxf(az, aw));
+  uint32_t index = ax == m ? 0 : ay == m ? 1 : az == m ? 2 : 3;
+  float max = (float) ((1u << bits) - 1);
+  float scale = (float) M_SQRT1_2 * max;
+  float bias = 0.5f * max + 0.5f;
+
+  for (uint32_t k = 0, j = 0; j < 4; ++j) {
+    if (j == index) continue;
+    float v = signbit(c[index]) ? -c[j] : c[j];
+    v = v * scale + bias;
+    field[k++] = (uint32_t) (v > 0 ? (v < max ? v : max) : 0);
+  }
+  return index;
+}
+
+/**
+ * Rebuilds a unit quaternion from index and three fields of bits.
+ */
+
+static inline quat
+glisy_quat_unpack_fields (uint32_t index, const uint32_t field[3],
+                          int bits) {
+  float scale = (float) M_SQRT2 / (float) ((1u << bits) - 1);
+  float a = (float) field[0] * scale - (float) M_SQRT1_2;
+  float b = (float) field[1] * scale - (float) M_SQRT1_2;
+  float c = (float) field[2] * scale - (float) M_SQRT1_2;
+  float l = sqrtf(fmaxf(0.0f, 1.0f - a * a - b * b - c * c));
+  switch (index) {
+    case 0: return quat(l, a, b, c);
+    case 1: return quat(a, l, b, c);
+    case 2: return quat(a, b, l, c);
+    default: return quat(a, b, c, l);
+  }
+}
+
+/**
+ * Scalar codecs.
+ */
+
+static inline quat32
+glisy_quat32_encode (quat q) {
+  uint32_t f[3];
+  uint32_t index = glisy_quat_pack_fields(q, GLISY_QUAT32_BITS, f);
+  return index << 30 | f[0] << 20 | f[1] << 10 | f[2];
+}
+
+static inline quat
+glisy_quat32_decode (quat32 p) {
+  uint32_t f[3] = {(p >> 20) & 0x3ff, (p >> 10) & 0x3ff, p & 0x3ff};
+  return glisy_quat_unpack_fields(p >> 30, f, GLISY_QUAT32_BITS);
+}
+
+static inline quat48
+glisy_quat48_encode (quat q) {
+  uint32_t f[3];
+  uint32_t index = glisy_quat_pack_fields(q, GLISY_QUAT48_BITS, f);
+  quat48 p = {{(uint16_t) (f[0] | (index & 1) << 15),
+               (uint16_t) (f[1] | (index >> 1) << 15),
+               (uint16_t) f[2]}};
+  return p;
+}
+
+static inline quat
+glisy_quat48_decode (quat48 p) {
+  uint32_t f[3] = {p.v[0] & 0x7fffu, p.v[1] & 0x7fffu, p.v[2] & 0x7fffu};
+  uint32_t index = (uint32_t) (p.v[0] >> 15 | (p.v[1] >> 15) << 1);
+  return glisy_quat_unpack_fields(index, f, GLISY_QUAT48_BITS);
+}
+
+static inline quat64
+glisy_quat64_encode (quat q) {
+  uint32_t f[3];
+  uint64_t index = glisy_quat_pack_fields(q, GLISY_QUAT64_BITS, f);
+  return index << 62 | (uint64_t) f[0] << 40 | (uint64_t) f[1] << 20 | f[2];
+}
+
+static inline quat
+glisy_quat64_decode (quat64 p) {
+  uint32_t f[3] = {(uint32_t) (p >> 40) & 0xfffff,
+                   (uint32_t) (p >> 20) & 0xfffff,
+                   (uint32_t) p & 0xfffff};
+  return glisy_quat_unpack_fields((uint32_t) (p >> 62), f, GLISY_QUAT64_BITS);
+}
+
+static inline hquat
+glisy_hquat_encode (quat q) {
+  hquat p = {glisy_half_from_float(q.x), glisy_half_from_float(q.y),
+             glisy_half_from_float(q.z), glisy_half_from_float(q.w)};
+  return p;
+}
+
+static inline quat
+glisy_hquat_decode (hquat p) {
+  return quat(glisy_half_to_float(p.x), glisy_half_to_float(p.y),
+              glisy_half_to_float(p.z), glisy_half_to_float(p.w));
+}
+
+#define quat32_encode(q) glisy_quat32_encode((q))
+#define quat32_decode(p) glisy_quat32_decode((p))
+#define quat48_encode(q) glisy_quat48_encode((q))
+#define quat48_decode(p) glisy_quat48_decode((p))
+#define quat64_encode(q) glisy_quat64_encode((q))
+#define quat64_decode(p) glisy_quat64_decode((p))
+#define hquat_encode(q) glisy_hquat_encode((q))
+#define hquat_decode(p) glisy_hquat_decode((p))
+
+#ifdef GLISY_SSE2
+
+/**
+ * SSE2 forms of the field split and rebuild, four quaternions at
+ * a time with the selects done by lane masks instead of branches.
+ * The results match the scalar ones, up to rounding of the fused
+ * multiply-add where the scalar code is not contracted.
+ */
+
+static inline __m128i
+glisy_quat_pack_fields_sse (const quat *in, int bits, __m128i field[3]) {
+  __m128 x = _mm_loadu_ps(&in[0].x);
+  __m128 y = _mm_loadu_ps(&in[1].x);
+  __m128 z = _mm_loadu_ps(&in[2].x);
+  __m128 w = _mm_loadu_ps(&in[3].x);
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 ax = _mm_andnot_ps(sign, x), ay = _mm_andnot_ps(sign, y);
+  __m128 az = _mm_andnot_ps(sign, z), aw = _mm_andnot_ps(sign, w);
+  __m128 m = _mm_max_ps(_mm_max_ps(ax, ay), _mm_max_ps(az, aw));
+  __m128 ex = _mm_cmpeq_ps(ax, m);
+  __m128 ey = _mm_andnot_ps(ex, _mm_cmpeq_ps(ay, m));
+  __m128 ez = _mm_andnot_ps(_mm_or_ps(ex, ey), _mm_cmpeq_ps(az, m));
+  __m128 exy = _mm_or_ps(ex, ey), exyz = _mm_or_ps(exy, ez);
+
+  __m128i index = _mm_set1_epi32(3);
+  index = _mm_sub_epi32(index, _mm_and_si128(_mm_castps_si128(ez),
+                                             _mm_set1_epi32(1)));
+  index = _mm_sub_epi32(index, _mm_and_si128(_mm_castps_si128(ey),
+                                             _mm_set1_epi32(2)));
+  index = _mm_sub_epi32(index, _mm_and_si128(_mm_castps_si128(ex),
+                                             _mm_set1_epi32(3)));
+
+  __m128 largest = glisy_simd_select(ex, x, glisy_simd_select(ey, y,
+                   glisy_simd_select(ez, z, w)));
+  __m128 flip = _mm_and_ps(largest, sign);
+  __m128 a = _mm_xor_ps(glisy_simd_select(ex, y, x), flip);
+  __m128 b = _mm_xor_ps(glisy_simd_select(exy, z, y), flip);
+  __m128 c = _mm_xor_ps(glisy_simd_select(exyz, w, z), flip);
+
+  float max = (float) ((1u << bits) - 1);
+  __m128 vmax = _mm_set1_ps(max);
+  __m128 scale = _mm_set1_ps((float) M_SQRT1_2 * max);
+  __m128 bias = _mm_set1_ps(0.5f * max + 0.5f);
+  __m128 zero = _mm_setzero_ps();
+  a = _mm_max_ps(_mm_min_ps(glisy_simd_madd(a, scale, bias), vmax), zero);
+  b = _mm_max_ps(_mm_min_ps(glisy_simd_madd(b, scale, bias), vmax), zero);
+  c = _mm_max_ps(_mm_min_ps(glisy_simd_madd(c, scale, bias), vmax), zero);
+  field[0] = _mm_cvttps_epi32(a);
+  field[1] = _mm_cvttps_epi32(b);
+  field[2] = _mm_cvttps_epi32(c);
+  return index;
+}
+
+static inline void
+glisy_quat_unpack_fields_sse (quat *out, __m128i index,
+                              const __m128i field[3], int bits) {
+  __m128 scale = _mm_set1_ps((float) M_SQRT2 / (float) ((1u << bits) - 1));
+  __m128 bias = _mm_set1_ps(-(float) M_SQRT1_2);
+  __m128 a = glisy_simd_madd(_mm_cvtepi32_ps(field[0]), scale, bias);
+  __m128 b = glisy_simd_madd(_mm_cvtepi32_ps(field[1]), scale, bias);
+  __m128 c = glisy_simd_madd(_mm_cvtepi32_ps(field[2]), scale, bias);
+  __m128 s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)),
+                        _mm_mul_ps(c, c));
+  __m128 l = _mm_sqrt_ps(_mm_max_ps(_mm_setzero_ps(),
+                                    _mm_sub_ps(_mm_set1_ps(1.0f), s)));
+
+  __m128 e0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(0)));
+  __m128 e1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+  __m128 e2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+  __m128 e3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+  __m128 x = glisy_simd_select(e0, l, a);
+  __m128 y = glisy_simd_select(e0, a, glisy_simd_select(e1, l, b));
+  __m128 z = glisy_simd_select(_mm_or_ps(e0, e1), b,
+                               glisy_simd_select(e2, l, c));
+  __m128 w = glisy_simd_select(e3, l, c);
+
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  _mm_storeu_ps(&out[0].x, x);
+  _mm_storeu_ps(&out[1].x, y);
+  _mm_storeu_ps(&out[2].x, z);
+  _mm_storeu_ps(&out[3].x, w);
+}
+
+#endif
+
+/**
+ * Batch codecs over count quaternions. With SSE2 they work four at
+ * a time; the remainder, and everything without SSE2, goes through
+ * the scalar codecs.
+ */
+
+static inline void
+glisy_quat32_encode_batch (quat32 *out, const quat *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    __m128i f[3];
+    __m128i p = _mm_slli_epi32(glisy_quat_pack_fields_sse(in + i, 10, f), 30);
+    p = _mm_or_si128(p, _mm_slli_epi32(f[0], 20));
+    p = _mm_or_si128(p, _mm_slli_epi32(f[1], 10));
+    p = _mm_or_si128(p, f[2]);
+    _mm_storeu_si128((__m128i *) (out + i), p);
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat32_encode(in[i]);
+}
+
+static inline void
+glisy_quat32_decode_batch (quat *out, const quat32 *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  const __m128i mask = _mm_set1_epi32(0x3ff);
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *) (in + i));
+    __m128i f[3] = {_mm_and_si128(_mm_srli_epi32(p, 20), mask),
+                    _mm_and_si128(_mm_srli_epi32(p, 10), mask),
+                    _mm_and_si128(p, mask)};
+    glisy_quat_unpack_fields_sse(out + i, _mm_srli_epi32(p, 30), f, 10);
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat32_decode(in[i]);
+}
+
+static inline void
+glisy_quat48_encode_batch (quat48 *out, const quat *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    uint32_t index[4], f[3][4];
+    __m128i v[3];
+    _mm_storeu_si128((__m128i *) index,
+                     glisy_quat_pack_fields_sse(in + i, 15, v));
+    for (int k = 0; k < 3; ++k) _mm_storeu_si128((__m128i *) f[k], v[k]);
+    for (int j = 0; j < 4; ++j) {
+      out[i + j].v[0] = (uint16_t) (f[0][j] | (index[j] & 1) << 15);
+      out[i + j].v[1] = (uint16_t) (f[1][j] | (index[j] >> 1) << 15);
+      out[i + j].v[2] = (uint16_t) f[2][j];
+    }
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat48_encode(in[i]);
+}
+
+static inline void
+glisy_quat48_decode_batch (quat *out, const quat48 *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    const uint16_t *p0 = in[i].v, *p1 = in[i + 1].v;
+    const uint16_t *p2 = in[i + 2].v, *p3 = in[i + 3].v;
+    const __m128i mask = _mm_set1_epi32(0x7fff);
+    __m128i u = _mm_set_epi32(p3[0], p2[0], p1[0], p0[0]);
+    __m128i v = _mm_set_epi32(p3[1], p2[1], p1[1], p0[1]);
+    __m128i f[3] = {_mm_and_si128(u, mask), _mm_and_si128(v, mask),
+                    _mm_set_epi32(p3[2], p2[2], p1[2], p0[2])};
+    __m128i index = _mm_or_si128(_mm_srli_epi32(u, 15),
+                                 _mm_slli_epi32(_mm_srli_epi32(v, 15), 1));
+    glisy_quat_unpack_fields_sse(out + i, index, f, 15);
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat48_decode(in[i]);
+}
+
+static inline void
+glisy_quat64_encode_batch (quat64 *out, const quat *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    __m128i f[3];
+    __m128i index = glisy_quat_pack_fields_sse(in + i, 20, f);
+    __m128i l = _mm_or_si128(f[2], _mm_slli_epi32(f[1], 20));
+    __m128i h = _mm_or_si128(_mm_srli_epi32(f[1], 12),
+                             _mm_or_si128(_mm_slli_epi32(f[0], 8),
+                                          _mm_slli_epi32(index, 30)));
+    _mm_storeu_si128((__m128i *) (out + i), _mm_unpacklo_epi32(l, h));
+    _mm_storeu_si128((__m128i *) (out + i + 2), _mm_unpackhi_epi32(l, h));
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat64_encode(in[i]);
+}
+
+static inline void
+glisy_quat64_decode_batch (quat *out, const quat64 *in, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < (count & ~(size_t) 3); i += 4) {
+    const __m128i mask = _mm_set1_epi32(0xfffff);
+    __m128i lo = _mm_loadu_si128((const __m128i *) (in + i));
+    __m128i hi = _mm_loadu_si128((const __m128i *) (in + i + 2));
+    // low and high 32 bits of each code
+    __m128i l = _mm_castps_si128(
+      _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                     GLISY_SHUFFLE(0, 2, 0, 2)));
+    __m128i h = _mm_castps_si128(
+      _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi),
+                     GLISY_SHUFFLE(1, 3, 1, 3)));
+    __m128i f[3] = {_mm_and_si128(_mm_srli_epi32(h, 8), mask),
+                    _mm_or_si128(_mm_srli_epi32(l, 20),
+                                 _mm_and_si128(_mm_slli_epi32(h, 12), mask)),
+                    _mm_and_si128(l, mask)};
+    glisy_quat_unpack_fields_sse(out + i, _mm_srli_epi32(h, 30), f, 20);
+  }
+#endif
+  for (; i < count; ++i) out[i] = glisy_quat64_decode(in[i]);
+}
+
+static inline void
+glisy_hquat_encode_batch (hquat *out, const quat *in, size_t count) {
+  glisy_half_from_float_batch(&out->x, &in->x, 4 * count);
+}
+
+static inline void
+glisy_hquat_decode_batch (quat *out, const hquat *in, size_t count) {
+  glisy_half_to_float_batch(&out->x, &in->x, 4 * count);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
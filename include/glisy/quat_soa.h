@@ -0,0 +1,809 @@
+#ifndef GLISY_QUAT_SOA_H
+#define GLISY_QUAT_SOA_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/vec3_soa.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * quat_soa struct type. A growable array of quats stored as
+ * separate x, y, z and w float arrays sharing one allocation, with
+ * the same alignment and zero padding guarantees as vec3_soa.
+ */
+
+typedef struct quat_soa quat_soa;
+struct quat_soa {
+  float *x;
+  float *y;
+  float *z;
+  float *w;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * quat_soa initializer.
+ */
+
+#define quat_soa_create() ((quat_soa) {0})
+
+/**
+ * Releases the storage of quat_soa s and empties it.
+ */
+
+static inline void
+glisy_quat_soa_free (quat_soa *s) {
+  free(s->x);
+  *s = (quat_soa) {0};
+}
+
+#define quat_soa_free(s) glisy_quat_soa_free(&(s))
+
+/**
+ * Grows quat_soa s to hold at least capacity elements. Returns 0
+ * on success and -1 when allocation fails, leaving s unchanged.
+ */
+
+static inline int
+glisy_quat_soa_reserve (quat_soa *s, size_t capacity) {
+  if (capacity <= s->capacity) return 0;
+  if (capacity < 2 * s->capacity) capacity = 2 * s->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  float *data = (float *) glisy_simd_alloc(4 * capacity * sizeof(float));
+  if (!data) return -1;
+  memset(data, 0, 4 * capacity * sizeof(float));
+  if (s->count) {
+    memcpy(data, s->x, s->count * sizeof(float));
+    memcpy(data + capacity, s->y, s->count * sizeof(float));
+    memcpy(data + 2 * capacity, s->z, s->count * sizeof(float));
+    memcpy(data + 3 * capacity, s->w, s->count * sizeof(float));
+  }
+  free(s->x);
+  s->x = data;
+  s->y = data + capacity;
+  s->z = data + 2 * capacity;
+  s->w = data + 3 * capacity;
+  s->capacity = capacity;
+  return 0;
+}
+
+#define quat_soa_reserve(s, capacity) glisy_quat_soa_reserve(&(s), (capacity))
+
+/**
+ * Sets the number of elements of quat_soa s. New elements are
+ * zero. Returns 0 on success and -1 when allocation fails.
+ */
+
+static inline int
+glisy_quat_soa_resize (quat_soa *s, size_t count) {
+  if (glisy_quat_soa_reserve(s, count)) return -1;
+  if (count < s->count) {
+    size_t n = (s->count - count) * sizeof(float);
+    memset(s->x + count, 0, n);
+    memset(s->y + count, 0, n);
+    memset(s->z + count, 0, n);
+    memset(s->w + count, 0, n);
+  }
+  s->count = count;
+  return 0;
+}
+
+#define quat_soa_resize(s, count) glisy_quat_soa_resize(&(s), (count))
+
+/**
+ * Appends quat q to quat_soa s. Returns 0 on success and -1 when
+ * allocation fails.
+ */
+
+static inline int
+glisy_quat_soa_push (quat_soa *s, quat q) {
+  if (glisy_quat_soa_reserve(s, s->count + 1)) return -1;
+  s->x[s->count] = q.x;
+  s->y[s->count] = q.y;
+  s->z[s->count] = q.z;
+  s->w[s->count] = q.w;
+  s->count++;
+  return 0;
+}
+
+#define quat_soa_push(s, q) glisy_quat_soa_push(&(s), (q))
+
+/**
+ * Returns element i of quat_soa s.
+ */
+
+static inline quat
+glisy_quat_soa_get (const quat_soa *s, size_t i) {
+  return (quat) {s->x[i], s->y[i], s->z[i], s->w[i]};
+}
+
+#define quat_soa_get(s, i) glisy_quat_soa_get(&(s), (i))
+
+/**
+ * Sets element i of quat_soa s to quat q.
+ */
+
+static inline void
+glisy_quat_soa_set (quat_soa *s, size_t i, quat q) {
+  s->x[i] = q.x;
+  s->y[i] = q.y;
+  s->z[i] = q.z;
+  s->w[i] = q.w;
+}
+
+#define quat_soa_set(s, i, q) glisy_quat_soa_set(&(s), (i), (q))
+
+/**
+ * Replaces the contents of quat_soa s with count four float
+ * elements (quat or vec4) gathered from in. Returns 0 on success
+ * and -1 when allocation fails.
+ */
+
+static inline int
+glisy_quat_soa_gather (quat_soa *s, const float *in, size_t count) {
+  size_t i = 0;
+  if (glisy_quat_soa_resize(s, count)) return -1;
+#ifdef GLISY_SSE2
+  for (; i < count - count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane x, y, z, w;
+    glisy_vec4_load_lanes(in + 4 * i, &x, &y, &z, &w);
+    glisy_lane_store(s->x + i, x);
+    glisy_lane_store(s->y + i, y);
+    glisy_lane_store(s->z + i, z);
+    glisy_lane_store(s->w + i, w);
+  }
+#endif
+  for (; i < count; ++i) {
+    const float *q = in + 4 * i;
+    glisy_quat_soa_set(s, i, (quat) {q[0], q[1], q[2], q[3]});
+  }
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_from_quat (quat_soa *s, const quat *in, size_t count) {
+  return glisy_quat_soa_gather(s, &in->x, count);
+}
+
+static inline int
+glisy_quat_soa_from_vec4 (quat_soa *s, const vec4 *in, size_t count) {
+  return glisy_quat_soa_gather(s, &in->x, count);
+}
+
+/**
+ * Scatters the elements of quat_soa s as four float elements
+ * (quat or vec4) into out.
+ */
+
+static inline void
+glisy_quat_soa_scatter (float *out, const quat_soa *s) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < s->count - s->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_vec4_store_lanes(out + 4 * i, glisy_lane_load(s->x + i),
+                           glisy_lane_load(s->y + i),
+                           glisy_lane_load(s->z + i),
+                           glisy_lane_load(s->w + i));
+  }
+#endif
+  for (; i < s->count; ++i) {
+    float *q = out + 4 * i;
+    q[0] = s->x[i];
+    q[1] = s->y[i];
+    q[2] = s->z[i];
+    q[3] = s->w[i];
+  }
+}
+
+static inline void
+glisy_quat_soa_to_quat (quat *out, const quat_soa *s) {
+  glisy_quat_soa_scatter(&out->x, s);
+}
+
+static inline void
+glisy_quat_soa_to_vec4 (vec4 *out, const quat_soa *s) {
+  glisy_quat_soa_scatter(&out->x, s);
+}
+
+/**
+ * Batch quat routines. Each applies the quat.h routine of the same
+ * name to every element of a (and b), resizing out to a's count.
+ * a and b must have the same count; out may be a or b. They return
+ * 0 on success and -1 when resizing out fails.
+ */
+
+static inline int
+glisy_quat_soa_add (quat_soa *out, const quat_soa *a, const quat_soa *b) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_add(glisy_lane_load(a->x + i),
+                                                glisy_lane_load(b->x + i)));
+    glisy_lane_store(out->y + i, glisy_lane_add(glisy_lane_load(a->y + i),
+                                                glisy_lane_load(b->y + i)));
+    glisy_lane_store(out->z + i, glisy_lane_add(glisy_lane_load(a->z + i),
+                                                glisy_lane_load(b->z + i)));
+    glisy_lane_store(out->w + i, glisy_lane_add(glisy_lane_load(a->w + i),
+                                                glisy_lane_load(b->w + i)));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] + b->x[i];
+    out->y[i] = a->y[i] + b->y[i];
+    out->z[i] = a->z[i] + b->z[i];
+    out->w[i] = a->w[i] + b->w[i];
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_subtract (quat_soa *out,
+                         const quat_soa *a,
+                         const quat_soa *b) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_sub(glisy_lane_load(a->x + i),
+                                                glisy_lane_load(b->x + i)));
+    glisy_lane_store(out->y + i, glisy_lane_sub(glisy_lane_load(a->y + i),
+                                                glisy_lane_load(b->y + i)));
+    glisy_lane_store(out->z + i, glisy_lane_sub(glisy_lane_load(a->z + i),
+                                                glisy_lane_load(b->z + i)));
+    glisy_lane_store(out->w + i, glisy_lane_sub(glisy_lane_load(a->w + i),
+                                                glisy_lane_load(b->w + i)));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] - b->x[i];
+    out->y[i] = a->y[i] - b->y[i];
+    out->z[i] = a->z[i] - b->z[i];
+    out->w[i] = a->w[i] - b->w[i];
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_scale (quat_soa *out, const quat_soa *a, float s) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vs = glisy_lane_splat(s);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_mul(glisy_lane_load(a->x + i), vs));
+    glisy_lane_store(out->y + i, glisy_lane_mul(glisy_lane_load(a->y + i), vs));
+    glisy_lane_store(out->z + i, glisy_lane_mul(glisy_lane_load(a->z + i), vs));
+    glisy_lane_store(out->w + i, glisy_lane_mul(glisy_lane_load(a->w + i), vs));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] * s;
+    out->y[i] = a->y[i] * s;
+    out->z[i] = a->z[i] * s;
+    out->w[i] = a->w[i] * s;
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_normalize_kernel (quat_soa *out,
+                                 const quat_soa *a,
+                                 int fast) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane x = glisy_lane_load(a->x + i);
+    glisy_lane y = glisy_lane_load(a->y + i);
+    glisy_lane z = glisy_lane_load(a->z + i);
+    glisy_lane w = glisy_lane_load(a->w + i);
+    glisy_lane len = glisy_lane_madd(w, w, glisy_lane_madd(z, z,
+                     glisy_lane_madd(y, y, glisy_lane_mul(x, x))));
+    glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                       fast ? glisy_lane_rsqrt_fast(len)
+                            : glisy_lane_rsqrt(len));
+    glisy_lane_store(out->x + i, glisy_lane_mul(x, inv));
+    glisy_lane_store(out->y + i, glisy_lane_mul(y, inv));
+    glisy_lane_store(out->z + i, glisy_lane_mul(z, inv));
+    glisy_lane_store(out->w + i, glisy_lane_mul(w, inv));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    quat q = glisy_quat_soa_get(a, i);
+    if (fast) glisy_quat_normalize_fast_into(&q, &q);
+    else glisy_quat_normalize_into(&q, &q);
+    glisy_quat_soa_set(out, i, q);
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_normalize (quat_soa *out, const quat_soa *a) {
+  return glisy_quat_soa_normalize_kernel(out, a, 0);
+}
+
+/**
+ * Fast variant of quat_soa_normalize using the rsqrt estimate and
+ * one Newton-Raphson step, see glisy_rsqrtf_fast.
+ */
+
+static inline int
+glisy_quat_soa_normalize_fast (quat_soa *out, const quat_soa *a) {
+  return glisy_quat_soa_normalize_kernel(out, a, 1);
+}
+
+static inline int
+glisy_quat_soa_lerp (quat_soa *out,
+                     const quat_soa *a,
+                     const quat_soa *b,
+                     float t) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vt = glisy_lane_splat(t);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane ax = glisy_lane_load(a->x + i);
+    glisy_lane ay = glisy_lane_load(a->y + i);
+    glisy_lane az = glisy_lane_load(a->z + i);
+    glisy_lane aw = glisy_lane_load(a->w + i);
+    glisy_lane_store(out->x + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->x + i), ax), ax));
+    glisy_lane_store(out->y + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->y + i), ay), ay));
+    glisy_lane_store(out->z + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->z + i), az), az));
+    glisy_lane_store(out->w + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->w + i), aw), aw));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] + t * (b->x[i] - a->x[i]);
+    out->y[i] = a->y[i] + t * (b->y[i] - a->y[i]);
+    out->z[i] = a->z[i] + t * (b->z[i] - a->z[i]);
+    out->w[i] = a->w[i] + t * (b->w[i] - a->w[i]);
+  }
+#endif
+  return 0;
+}
+
+/**
+ * Writes the dot product of every element pair of a and b to the
+ * count floats at out.
+ */
+
+static inline void
+glisy_quat_soa_dot (float *out, const quat_soa *a, const quat_soa *b) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < a->count - a->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane d = glisy_lane_mul(glisy_lane_load(a->x + i),
+                                  glisy_lane_load(b->x + i));
+    d = glisy_lane_madd(glisy_lane_load(a->y + i),
+                        glisy_lane_load(b->y + i), d);
+    d = glisy_lane_madd(glisy_lane_load(a->z + i),
+                        glisy_lane_load(b->z + i), d);
+    d = glisy_lane_madd(glisy_lane_load(a->w + i),
+                        glisy_lane_load(b->w + i), d);
+    glisy_lane_store(out + i, d);
+  }
+#endif
+  for (; i < a->count; ++i) {
+    out[i] = a->x[i] * b->x[i] + a->y[i] * b->y[i]
+           + a->z[i] * b->z[i] + a->w[i] * b->w[i];
+  }
+}
+
+/**
+ * Sets every element of out to the rotation of rad[i] radians
+ * around axis i, like quat_set_axis_angle, computing the sines
+ * and cosines a register at a time. Returns 0 on success and -1
+ * when resizing out fails.
+ */
+
+static inline int
+glisy_quat_soa_set_axis_angle (quat_soa *out,
+                               const vec3_soa *axis,
+                               const float *rad) {
+  size_t count = axis->count, i = 0;
+  if (glisy_quat_soa_resize(out, count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane half = glisy_lane_splat(0.5f);
+  for (; i < count - count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane s, c;
+    glisy_lane_sincos(glisy_lane_mul(glisy_lane_load(rad + i), half),
+                      &s, &c);
+    glisy_lane_store(out->x + i,
+                     glisy_lane_mul(s, glisy_lane_load(axis->x + i)));
+    glisy_lane_store(out->y + i,
+                     glisy_lane_mul(s, glisy_lane_load(axis->y + i)));
+    glisy_lane_store(out->z + i,
+                     glisy_lane_mul(s, glisy_lane_load(axis->z + i)));
+    glisy_lane_store(out->w + i, c);
+  }
+#endif
+  for (; i < count; ++i) {
+    float s, c;
+    glisy_sincosf(rad[i] * 0.5f, &s, &c);
+    out->x[i] = s * axis->x[i];
+    out->y[i] = s * axis->y[i];
+    out->z[i] = s * axis->z[i];
+    out->w[i] = c;
+  }
+  return 0;
+}
+
+/**
+ * Weights of the slerp from a to b at t, given the dot product c of
+ * a and b made non-negative. acos is the polynomial of Abramowitz
+ * and Stegun 4.4.46, within 2e-8 on [0, 1], so the kernels need
+ * only one glisy_lane_sincos. Pairs closer than 1e-6 in c fall back
+ * to lerp weights, like glisy_quat_slerp_into.
+ */
+
+#ifdef GLISY_SSE2
+
+static inline void
+glisy_quat_slerp_weights (glisy_lane c, glisy_lane t,
+                          glisy_lane *s0, glisy_lane *s1) {
+  glisy_lane one = glisy_lane_splat(1.0f);
+  glisy_lane zero = glisy_lane_zero();
+  glisy_lane p = glisy_lane_madd(c, glisy_lane_splat(-0.0012624911f),
+                                 glisy_lane_splat(0.0066700901f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(-0.0170881256f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(0.0308918810f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(-0.0501743046f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(0.0889789874f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(-0.2145988016f));
+  p = glisy_lane_madd(c, p, glisy_lane_splat(1.5707963050f));
+  // inputs a little off unit length may give c above 1
+  glisy_lane e = glisy_lane_sub(one, c);
+  glisy_lane omega = glisy_lane_mul(p, glisy_lane_sqrt(
+                       glisy_lane_and(e, glisy_lane_gt(e, zero))));
+  glisy_lane sinom = glisy_lane_sub(one, glisy_lane_mul(c, c));
+  sinom = glisy_lane_sqrt(glisy_lane_and(sinom, glisy_lane_gt(sinom, zero)));
+  glisy_lane st, ct;
+  glisy_lane_sincos(glisy_lane_mul(t, omega), &st, &ct);
+  glisy_lane w1 = glisy_lane_div(st, sinom);
+  glisy_lane w0 = glisy_lane_sub(ct, glisy_lane_mul(c, w1));
+  glisy_lane near = glisy_lane_ge(glisy_lane_splat(0.000001f), e);
+  *s0 = glisy_lane_select(near, glisy_lane_sub(one, t), w0);
+  *s1 = glisy_lane_select(near, t, w1);
+}
+
+/**
+ * Slerps lanes q towards lanes b by t in place. The shortest path
+ * flip is folded into the sign of b's weight, so no lane branches.
+ */
+
+static inline void
+glisy_quat_slerp_lanes (glisy_lane q[4], const glisy_lane b[4], glisy_lane t) {
+  glisy_lane sign = glisy_lane_splat(-0.0f);
+  glisy_lane d = glisy_lane_mul(q[0], b[0]);
+  d = glisy_lane_madd(q[1], b[1], d);
+  d = glisy_lane_madd(q[2], b[2], d);
+  d = glisy_lane_madd(q[3], b[3], d);
+  glisy_lane flip = glisy_lane_and(d, sign);
+  glisy_lane s0, s1;
+  glisy_quat_slerp_weights(glisy_lane_xor(d, flip), t, &s0, &s1);
+  s1 = glisy_lane_xor(s1, flip);
+  for (int k = 0; k < 4; ++k) {
+    q[k] = glisy_lane_madd(s0, q[k], glisy_lane_mul(s1, b[k]));
+  }
+}
+
+/**
+ * Corrected t for glisy_quat_slerp_fast_lanes, from Kapoulkine's
+ * "Approximating slerp": a cubic in t scaled by a fit over the
+ * dot product c, which bends nlerp onto constant angular speed.
+ */
+
+static inline glisy_lane
+glisy_quat_slerp_fast_t (glisy_lane c, glisy_lane t) {
+  glisy_lane h = glisy_lane_sub(t, glisy_lane_splat(0.5f));
+  glisy_lane ka = glisy_lane_madd(c, glisy_lane_splat(-1.43519f),
+                                  glisy_lane_splat(3.55645f));
+  ka = glisy_lane_madd(c, ka, glisy_lane_splat(-3.2452f));
+  ka = glisy_lane_madd(c, ka, glisy_lane_splat(1.0904f));
+  glisy_lane kb = glisy_lane_madd(c, glisy_lane_splat(0.215638f),
+                                  glisy_lane_splat(-1.06021f));
+  kb = glisy_lane_madd(c, kb, glisy_lane_splat(0.848013f));
+  glisy_lane k = glisy_lane_madd(ka, glisy_lane_mul(h, h), kb);
+  glisy_lane r = glisy_lane_mul(glisy_lane_mul(t, h),
+                                glisy_lane_sub(t, glisy_lane_splat(1.0f)));
+  return glisy_lane_madd(r, k, t);
+}
+
+/**
+ * Normalized lerp of lanes q towards lanes b by t in place, along
+ * the shorter arc. With fast, t is first corrected by
+ * glisy_quat_slerp_fast_t.
+ */
+
+static inline void
+glisy_quat_nlerp_lanes (glisy_lane q[4], const glisy_lane b[4],
+                        glisy_lane t, int fast) {
+  glisy_lane sign = glisy_lane_splat(-0.0f);
+  glisy_lane d = glisy_lane_mul(q[0], b[0]);
+  d = glisy_lane_madd(q[1], b[1], d);
+  d = glisy_lane_madd(q[2], b[2], d);
+  d = glisy_lane_madd(q[3], b[3], d);
+  glisy_lane flip = glisy_lane_and(d, sign);
+  if (fast) t = glisy_quat_slerp_fast_t(glisy_lane_xor(d, flip), t);
+  glisy_lane s1 = glisy_lane_xor(t, flip);
+  glisy_lane s0 = glisy_lane_sub(glisy_lane_splat(1.0f), t);
+  glisy_lane len = glisy_lane_zero();
+  for (int k = 0; k < 4; ++k) {
+    q[k] = glisy_lane_madd(s0, q[k], glisy_lane_mul(s1, b[k]));
+    len = glisy_lane_madd(q[k], q[k], len);
+  }
+  glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                     fast ? glisy_lane_rsqrt_fast(len)
+                          : glisy_lane_rsqrt(len));
+  for (int k = 0; k < 4; ++k) q[k] = glisy_lane_mul(q[k], inv);
+}
+#endif
+
+/**
+ * Scalar forms of the lane kernels above.
+ */
+
+static inline float
+glisy_quat_slerp_fast_t_scalar (float c, float t) {
+  float h = t - 0.5f;
+  float ka = 1.0904f + c * (-3.2452f + c * (3.55645f - c * 1.43519f));
+  float kb = 0.848013f + c * (-1.06021f + c * 0.215638f);
+  return t + t * h * (t - 1.0f) * (ka * h * h + kb);
+}
+
+static inline void
+glisy_quat_nlerp_scalar (quat *out, const quat *a, const quat *b,
+                         float t, int fast) {
+  float d = a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+  if (fast) t = glisy_quat_slerp_fast_t_scalar(fabsf(d), t);
+  float s0 = 1.0f - t, s1 = d < 0 ? -t : t;
+  quat q = {s0 * a->x + s1 * b->x, s0 * a->y + s1 * b->y,
+            s0 * a->z + s1 * b->z, s0 * a->w + s1 * b->w};
+  if (fast) glisy_quat_normalize_fast_into(out, &q);
+  else glisy_quat_normalize_into(out, &q);
+}
+
+/**
+ * Interpolates every element pair of a and b by t, resizing out to
+ * a's count, along the shorter arc. quat_soa_slerp matches
+ * quat_slerp to float precision. quat_soa_nlerp is the normalized
+ * lerp, which keeps the path but not the speed: it is up to about
+ * 8 degrees off slerp on half turns. quat_soa_slerp_fast corrects
+ * t so that nlerp stays within 0.05 degrees of slerp for t in
+ * [0, 1], at about the cost of nlerp. a and b must have the same
+ * count; out may be a or b. They return 0 on success and -1 when
+ * resizing out fails.
+ */
+
+static inline int
+glisy_quat_soa_slerp (quat_soa *out,
+                      const quat_soa *a,
+                      const quat_soa *b,
+                      float t) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vt = glisy_lane_splat(t);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane q[4] = {
+      glisy_lane_load(a->x + i), glisy_lane_load(a->y + i),
+      glisy_lane_load(a->z + i), glisy_lane_load(a->w + i)
+    };
+    glisy_lane r[4] = {
+      glisy_lane_load(b->x + i), glisy_lane_load(b->y + i),
+      glisy_lane_load(b->z + i), glisy_lane_load(b->w + i)
+    };
+    glisy_quat_slerp_lanes(q, r, vt);
+    glisy_lane_store(out->x + i, q[0]);
+    glisy_lane_store(out->y + i, q[1]);
+    glisy_lane_store(out->z + i, q[2]);
+    glisy_lane_store(out->w + i, q[3]);
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    quat p = glisy_quat_soa_get(a, i), q = glisy_quat_soa_get(b, i);
+    glisy_quat_slerp_into(&p, &p, &q, t);
+    glisy_quat_soa_set(out, i, p);
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_nlerp_kernel (quat_soa *out,
+                             const quat_soa *a,
+                             const quat_soa *b,
+                             float t,
+                             int fast) {
+  if (glisy_quat_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vt = glisy_lane_splat(t);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane q[4] = {
+      glisy_lane_load(a->x + i), glisy_lane_load(a->y + i),
+      glisy_lane_load(a->z + i), glisy_lane_load(a->w + i)
+    };
+    glisy_lane r[4] = {
+      glisy_lane_load(b->x + i), glisy_lane_load(b->y + i),
+      glisy_lane_load(b->z + i), glisy_lane_load(b->w + i)
+    };
+    glisy_quat_nlerp_lanes(q, r, vt, fast);
+    glisy_lane_store(out->x + i, q[0]);
+    glisy_lane_store(out->y + i, q[1]);
+    glisy_lane_store(out->z + i, q[2]);
+    glisy_lane_store(out->w + i, q[3]);
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    quat p = glisy_quat_soa_get(a, i), q = glisy_quat_soa_get(b, i);
+    glisy_quat_nlerp_scalar(&p, &p, &q, t, fast);
+    glisy_quat_soa_set(out, i, p);
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_quat_soa_nlerp (quat_soa *out,
+                      const quat_soa *a,
+                      const quat_soa *b,
+                      float t) {
+  return glisy_quat_soa_nlerp_kernel(out, a, b, t, 0);
+}
+
+static inline int
+glisy_quat_soa_slerp_fast (quat_soa *out,
+                           const quat_soa *a,
+                           const quat_soa *b,
+                           float t) {
+  return glisy_quat_soa_nlerp_kernel(out, a, b, t, 1);
+}
+
+/**
+ * Blends count quat_soa poses in[0] .. in[count - 1] with the given
+ * weights into out: the normalized weighted sum, with every element
+ * first flipped onto the hemisphere of its counterpart in in[0].
+ * This is the usual blend tree pose blend; for two poses it is
+ * nlerp. The weights need not sum to 1. All poses must have the
+ * same count, which out is resized to; out may be any of them.
+ * Returns 0 on success and -1 when resizing out fails.
+ */
+
+static inline int
+glisy_quat_soa_blend (quat_soa *out,
+                      const quat_soa *in,
+                      const float *weights,
+                      size_t count) {
+  if (!count) return glisy_quat_soa_resize(out, 0);
+  size_t n = in[0].count;
+  if (glisy_quat_soa_resize(out, n)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane sign = glisy_lane_splat(-0.0f);
+  for (size_t i = 0; i < n; i += GLISY_LANES) {
+    glisy_lane r[4] = {
+      glisy_lane_load(in[0].x + i), glisy_lane_load(in[0].y + i),
+      glisy_lane_load(in[0].z + i), glisy_lane_load(in[0].w + i)
+    };
+    glisy_lane q[4];
+    glisy_lane w = glisy_lane_splat(weights[0]);
+    for (int k = 0; k < 4; ++k) q[k] = glisy_lane_mul(w, r[k]);
+    for (size_t j = 1; j < count; ++j) {
+      glisy_lane p[4] = {
+        glisy_lane_load(in[j].x + i), glisy_lane_load(in[j].y + i),
+        glisy_lane_load(in[j].z + i), glisy_lane_load(in[j].w + i)
+      };
+      glisy_lane d = glisy_lane_mul(r[0], p[0]);
+      d = glisy_lane_madd(r[1], p[1], d);
+      d = glisy_lane_madd(r[2], p[2], d);
+      d = glisy_lane_madd(r[3], p[3], d);
+      w = glisy_lane_xor(glisy_lane_splat(weights[j]),
+                         glisy_lane_and(d, sign));
+      for (int k = 0; k < 4; ++k) q[k] = glisy_lane_madd(w, p[k], q[k]);
+    }
+    glisy_lane len = glisy_lane_mul(q[0], q[0]);
+    len = glisy_lane_madd(q[1], q[1], len);
+    len = glisy_lane_madd(q[2], q[2], len);
+    len = glisy_lane_madd(q[3], q[3], len);
+    glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                                    glisy_lane_rsqrt(len));
+    glisy_lane_store(out->x + i, glisy_lane_mul(q[0], inv));
+    glisy_lane_store(out->y + i, glisy_lane_mul(q[1], inv));
+    glisy_lane_store(out->z + i, glisy_lane_mul(q[2], inv));
+    glisy_lane_store(out->w + i, glisy_lane_mul(q[3], inv));
+  }
+#else
+  for (size_t i = 0; i < n; ++i) {
+    quat r = glisy_quat_soa_get(&in[0], i);
+    quat q = {weights[0] * r.x, weights[0] * r.y,
+              weights[0] * r.z, weights[0] * r.w};
+    for (size_t j = 1; j < count; ++j) {
+      quat p = glisy_quat_soa_get(&in[j], i);
+      float d = r.x * p.x + r.y * p.y + r.z * p.z + r.w * p.w;
+      float w = d < 0 ? -weights[j] : weights[j];
+      q.x += w * p.x;
+      q.y += w * p.y;
+      q.z += w * p.z;
+      q.w += w * p.w;
+    }
+    glisy_quat_normalize_into(&q, &q);
+    glisy_quat_soa_set(out, i, q);
+  }
+#endif
+  return 0;
+}
+
+/**
+ * AoS batch forms: out[i] is a[i] interpolated towards b[i] by t,
+ * as quat_soa_slerp, quat_soa_nlerp and quat_soa_slerp_fast. Whole
+ * registers of quats are transposed into lanes on the fly. out may
+ * be a or b.
+ */
+
+static inline void
+glisy_quat_slerp_batch_kernel (quat *out,
+                               const quat *a,
+                               const quat *b,
+                               float t,
+                               size_t count,
+                               int kind) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  glisy_lane vt = glisy_lane_splat(t);
+  for (; i < (count & ~(size_t) (GLISY_LANES - 1)); i += GLISY_LANES) {
+    glisy_lane q[4], r[4];
+    glisy_vec4_load_lanes(&a[i].x, &q[0], &q[1], &q[2], &q[3]);
+    glisy_vec4_load_lanes(&b[i].x, &r[0], &r[1], &r[2], &r[3]);
+    if (kind) glisy_quat_nlerp_lanes(q, r, vt, kind > 1);
+    else glisy_quat_slerp_lanes(q, r, vt);
+    glisy_vec4_store_lanes(&out[i].x, q[0], q[1], q[2], q[3]);
+  }
+#endif
+  for (; i < count; ++i) {
+    if (kind) glisy_quat_nlerp_scalar(&out[i], &a[i], &b[i], t, kind > 1);
+    else glisy_quat_slerp_into(&out[i], &a[i], &b[i], t);
+  }
+}
+
+static inline void
+glisy_quat_slerp_batch (quat *out,
+                        const quat *a,
+                        const quat *b,
+                        float t,
+                        size_t count) {
+  glisy_quat_slerp_batch_kernel(out, a, b, t, count, 0);
+}
+
+static inline void
+glisy_quat_nlerp_batch (quat *out,
+                        const quat *a,
+                        const quat *b,
+                        float t,
+                        size_t count) {
+  glisy_quat_slerp_batch_kernel(out, a, b, t, count, 1);
+}
+
+static inline void
+glisy_quat_slerp_fast_batch (quat *out,
+                             const quat *a,
+                             const quat *b,
+                             float t,
+                             size_t count) {
+  glisy_quat_slerp_batch_kernel(out, a, b, t, count, 2);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
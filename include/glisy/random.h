@@ -0,0 +1,164 @@
+#ifndef GLISY_RANDOM_H
+#define GLISY_RANDOM_H
+
+#include <stdint.h>
+#include <time.h>
+#include <glisy/simd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Seedable pseudo random numbers with explicit state. Each
+ * glisy_rng holds one xoshiro128++ stream for single draws and
+ * GLISY_RNG_LANES more for the batch samplers in glisy/sample.h,
+ * each 2^64 draws apart. A state must not be shared between
+ * threads without locking; glisy_rng_thread gives every thread its
+ * own, seeded on first use.
+ */
+
+#define GLISY_RNG_LANES 8
+
+typedef struct glisy_rng glisy_rng;
+struct glisy_rng {
+  uint32_t lanes[4][GLISY_RNG_LANES] GLISY_ALIGN(32);
+  uint32_t s[4];
+};
+
+#if defined(__cplusplus)
+#define GLISY_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define GLISY_THREAD_LOCAL _Thread_local
+#else
+#define GLISY_THREAD_LOCAL __thread
+#endif
+
+static inline uint32_t
+glisy_rng_rotl (uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+/**
+ * Advances state s and returns its next 32 bits.
+ */
+
+static inline uint32_t
+glisy_rng_step (uint32_t s[4]) {
+  uint32_t result = glisy_rng_rotl(s[0] + s[3], 7) + s[0];
+  uint32_t t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = glisy_rng_rotl(s[3], 11);
+  return result;
+}
+
+/**
+ * Advances state s by 2^64 draws.
+ */
+
+static inline void
+glisy_rng_jump_state (uint32_t s[4]) {
+  static const uint32_t jump[4] = {
+    0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b
+  };
+  uint32_t t[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    for (int b = 0; b < 32; ++b) {
+      if (jump[i] & (uint32_t) 1 << b) {
+        for (int k = 0; k < 4; ++k) t[k] ^= s[k];
+      }
+      glisy_rng_step(s);
+    }
+  }
+  for (int k = 0; k < 4; ++k) s[k] = t[k];
+}
+
+/**
+ * Seeds rng from any 64 bit value, expanded with splitmix64 so that
+ * nearby seeds give unrelated streams.
+ */
+
+static inline void
+glisy_rng_seed (glisy_rng *rng, uint64_t seed) {
+  uint32_t s[4];
+  for (int k = 0; k < 4; k += 2) {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    s[k] = (uint32_t) z;
+    s[k + 1] = (uint32_t) (z >> 32);
+  }
+  if (!(s[0] | s[1] | s[2] | s[3])) s[0] = 1;
+  for (int k = 0; k < 4; ++k) rng->s[k] = s[k];
+  for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+    glisy_rng_jump_state(s);
+    for (int k = 0; k < 4; ++k) rng->lanes[k][i] = s[k];
+  }
+}
+
+/**
+ * Returns 32 random bits.
+ */
+
+static inline uint32_t
+glisy_rng_next (glisy_rng *rng) {
+  return glisy_rng_step(rng->s);
+}
+
+/**
+ * Returns a float uniform in [0, 1), a multiple of 2^-24.
+ */
+
+static inline float
+glisy_rng_float (glisy_rng *rng) {
+  return (float) (glisy_rng_next(rng) >> 8) * 0x1p-24f;
+}
+
+/**
+ * Returns a float uniform in [a, b).
+ */
+
+static inline float
+glisy_rng_range (glisy_rng *rng, float a, float b) {
+  return a + (b - a) * glisy_rng_float(rng);
+}
+
+/**
+ * Returns the calling thread's generator, seeded on first use from
+ * the clock and the state's address, which differs per thread.
+ * The clock is timespec_get under C11 and clock_gettime or time
+ * before it.
+ */
+
+static inline glisy_rng *
+glisy_rng_thread (void) {
+  static GLISY_THREAD_LOCAL glisy_rng rng;
+  static GLISY_THREAD_LOCAL int seeded;
+  if (!seeded) {
+    uint64_t now;
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    now = (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#elif defined(CLOCK_REALTIME)
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    now = (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#else
+    now = (uint64_t) time(NULL) * 1000000000u;
+#endif
+    glisy_rng_seed(&rng, now ^ (uint64_t) (uintptr_t) &rng);
+    seeded = 1;
+  }
+  return &rng;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,381 @@
+#ifndef GLISY_SAMPLE_H
+#define GLISY_SAMPLE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <glisy/simd.h>
+#include <glisy/random.h>
+#include <glisy/vec2.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Uniform random samples: unit vectors on the circle, sphere and
+ * hemisphere, points in the disc and ball, and unit rotations.
+ *
+ * The single forms draw from the scalar stream of a glisy_rng. The
+ * batch forms step its GLISY_RNG_LANES lane streams together, in
+ * SIMD registers where available, and take sines and cosines a
+ * register at a time. The lane streams step the same way with and
+ * without SIMD, so a seed gives the same batches on every build up
+ * to float rounding.
+ */
+
+#define GLISY_SAMPLE_TWO_PI 6.28318530717958647692f
+
+static inline vec2
+glisy_sample_circle (glisy_rng *rng) {
+  float s, c;
+  glisy_sincosf(GLISY_SAMPLE_TWO_PI * glisy_rng_float(rng), &s, &c);
+  return vec2(c, s);
+}
+
+static inline vec2
+glisy_sample_disc (glisy_rng *rng) {
+  float r = sqrtf(glisy_rng_float(rng));
+  vec2 d = glisy_sample_circle(rng);
+  return vec2(d.x * r, d.y * r);
+}
+
+static inline vec3
+glisy_sample_sphere (glisy_rng *rng) {
+  float z = 1.0f - 2.0f * glisy_rng_float(rng);
+  float r = sqrtf(fmaxf(0.0f, 1.0f - z * z));
+  vec2 d = glisy_sample_circle(rng);
+  return vec3(d.x * r, d.y * r, z);
+}
+
+/**
+ * Samples the unit hemisphere around normal, which need not be
+ * normalized, by flipping sphere samples that point away from it.
+ */
+
+static inline vec3
+glisy_sample_hemisphere (glisy_rng *rng, vec3 normal) {
+  vec3 d = glisy_sample_sphere(rng);
+  float s = d.x * normal.x + d.y * normal.y + d.z * normal.z < 0 ? -1 : 1;
+  return vec3(d.x * s, d.y * s, d.z * s);
+}
+
+/**
+ * Samples the unit ball. The radius is the largest of three
+ * uniforms, which is distributed as r^3 like the ball's and saves
+ * a cube root.
+ */
+
+static inline vec3
+glisy_sample_ball (glisy_rng *rng) {
+  float r = glisy_rng_float(rng);
+  r = fmaxf(r, glisy_rng_float(rng));
+  r = fmaxf(r, glisy_rng_float(rng));
+  vec3 d = glisy_sample_sphere(rng);
+  return vec3(d.x * r, d.y * r, d.z * r);
+}
+
+/**
+ * Samples unit quaternions uniformly over rotations (Shoemake).
+ */
+
+static inline quat
+glisy_sample_quat (glisy_rng *rng) {
+  float u = glisy_rng_float(rng);
+  float a = sqrtf(1.0f - u), b = sqrtf(u);
+  vec2 p = glisy_sample_circle(rng);
+  vec2 q = glisy_sample_circle(rng);
+  return quat(a * p.y, a * p.x, b * q.y, b * q.x);
+}
+
+/**
+ * Lane stream state for the length of a batch, held in registers
+ * under SSE2 and read through rng otherwise.
+ */
+
+typedef struct glisy_sample_lanes glisy_sample_lanes;
+
+#ifdef GLISY_SSE2
+
+struct glisy_sample_lanes { __m128i s[4][GLISY_RNG_LANES / 4]; };
+
+static inline void
+glisy_sample_lanes_load (glisy_sample_lanes *v, glisy_rng *rng) {
+  for (int k = 0; k < 4; ++k) {
+    for (int h = 0; h < GLISY_RNG_LANES / 4; ++h) {
+      v->s[k][h] = _mm_load_si128((const __m128i *) (rng->lanes[k] + 4 * h));
+    }
+  }
+}
+
+static inline void
+glisy_sample_lanes_store (glisy_rng *rng, const glisy_sample_lanes *v) {
+  for (int k = 0; k < 4; ++k) {
+    for (int h = 0; h < GLISY_RNG_LANES / 4; ++h) {
+      _mm_store_si128((__m128i *) (rng->lanes[k] + 4 * h), v->s[k][h]);
+    }
+  }
+}
+
+#define glisy_sample_rotl(x, k) \
+  _mm_or_si128(_mm_slli_epi32((x), (k)), _mm_srli_epi32((x), 32 - (k)))
+
+/**
+ * Writes the next GLISY_RNG_LANES uniforms in [0, 1) to u, four
+ * streams per glisy_rng_step.
+ */
+
+static inline void
+glisy_sample_uniform_lanes (glisy_sample_lanes *v, float *u) {
+  for (int h = 0; h < GLISY_RNG_LANES / 4; ++h) {
+    __m128i s0 = v->s[0][h], s1 = v->s[1][h];
+    __m128i s2 = v->s[2][h], s3 = v->s[3][h];
+    __m128i r = _mm_add_epi32(glisy_sample_rotl(_mm_add_epi32(s0, s3), 7),
+                              s0);
+    __m128i t = _mm_slli_epi32(s1, 9);
+    s2 = _mm_xor_si128(s2, s0);
+    s3 = _mm_xor_si128(s3, s1);
+    s1 = _mm_xor_si128(s1, s2);
+    s0 = _mm_xor_si128(s0, s3);
+    s2 = _mm_xor_si128(s2, t);
+    v->s[0][h] = s0;
+    v->s[1][h] = s1;
+    v->s[2][h] = s2;
+    v->s[3][h] = glisy_sample_rotl(s3, 11);
+    _mm_storeu_ps(u + 4 * h,
+                  _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(r, 8)),
+                             _mm_set1_ps(0x1p-24f)));
+  }
+}
+
+/**
+ * Writes the sine and cosine of 2 pi times the next GLISY_RNG_LANES
+ * uniforms to s and c.
+ */
+
+static inline void
+glisy_sample_angle_lanes (glisy_sample_lanes *v, float *s, float *c) {
+  float u[GLISY_RNG_LANES];
+  glisy_sample_uniform_lanes(v, u);
+  for (int i = 0; i < GLISY_RNG_LANES; i += GLISY_LANES) {
+    glisy_lane ls, lc;
+    glisy_lane_sincos(glisy_lane_mul(glisy_lane_load(u + i),
+                                     glisy_lane_splat(GLISY_SAMPLE_TWO_PI)),
+                      &ls, &lc);
+    glisy_lane_store(s + i, ls);
+    glisy_lane_store(c + i, lc);
+  }
+}
+
+#else
+
+struct glisy_sample_lanes { glisy_rng *rng; };
+
+static inline void
+glisy_sample_lanes_load (glisy_sample_lanes *v, glisy_rng *rng) {
+  v->rng = rng;
+}
+
+static inline void
+glisy_sample_lanes_store (glisy_rng *rng, const glisy_sample_lanes *v) {
+  (void) rng;
+  (void) v;
+}
+
+static inline void
+glisy_sample_uniform_lanes (glisy_sample_lanes *v, float *u) {
+  for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+    uint32_t s[4];
+    for (int k = 0; k < 4; ++k) s[k] = v->rng->lanes[k][i];
+    u[i] = (float) (glisy_rng_step(s) >> 8) * 0x1p-24f;
+    for (int k = 0; k < 4; ++k) v->rng->lanes[k][i] = s[k];
+  }
+}
+
+static inline void
+glisy_sample_angle_lanes (glisy_sample_lanes *v, float *s, float *c) {
+  float u[GLISY_RNG_LANES];
+  glisy_sample_uniform_lanes(v, u);
+  for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+    glisy_sincosf(GLISY_SAMPLE_TWO_PI * u[i], &s[i], &c[i]);
+  }
+}
+
+#endif
+
+/**
+ * Lane forms of the disc and sphere samplers, writing
+ * GLISY_RNG_LANES samples component by component.
+ */
+
+static inline void
+glisy_sample_disc_lanes (glisy_sample_lanes *v, float *x, float *y) {
+  float u[GLISY_RNG_LANES];
+  glisy_sample_uniform_lanes(v, u);
+  glisy_sample_angle_lanes(v, y, x);
+#ifdef GLISY_SSE2
+  for (int i = 0; i < GLISY_RNG_LANES; i += GLISY_LANES) {
+    glisy_lane r = glisy_lane_sqrt(glisy_lane_load(u + i));
+    glisy_lane_store(x + i, glisy_lane_mul(glisy_lane_load(x + i), r));
+    glisy_lane_store(y + i, glisy_lane_mul(glisy_lane_load(y + i), r));
+  }
+#else
+  for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+    float r = sqrtf(u[i]);
+    x[i] *= r;
+    y[i] *= r;
+  }
+#endif
+}
+
+static inline void
+glisy_sample_sphere_lanes (glisy_sample_lanes *v,
+                           float *x, float *y, float *z) {
+  glisy_sample_uniform_lanes(v, z);
+  glisy_sample_angle_lanes(v, y, x);
+#ifdef GLISY_SSE2
+  for (int i = 0; i < GLISY_RNG_LANES; i += GLISY_LANES) {
+    glisy_lane one = glisy_lane_splat(1.0f);
+    glisy_lane w = glisy_lane_madd(glisy_lane_load(z + i),
+                                   glisy_lane_splat(-2.0f), one);
+    glisy_lane d = glisy_lane_madd(glisy_lane_xor(w, glisy_lane_splat(-0.0f)),
+                                   w, one);
+    glisy_lane r = glisy_lane_sqrt(glisy_lane_and(d,
+                     glisy_lane_gt(d, glisy_lane_zero())));
+    glisy_lane_store(x + i, glisy_lane_mul(glisy_lane_load(x + i), r));
+    glisy_lane_store(y + i, glisy_lane_mul(glisy_lane_load(y + i), r));
+    glisy_lane_store(z + i, w);
+  }
+#else
+  for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+    z[i] = 1.0f - 2.0f * z[i];
+    float r = sqrtf(fmaxf(0.0f, 1.0f - z[i] * z[i]));
+    x[i] *= r;
+    y[i] *= r;
+  }
+#endif
+}
+
+/**
+ * Batch samplers. Each writes count samples to out. A final partial
+ * step still advances every lane stream and drops the samples it
+ * does not need.
+ */
+
+static inline void
+glisy_sample_circle_batch (glisy_rng *rng, vec2 *out, size_t count) {
+  float x[GLISY_RNG_LANES], y[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_angle_lanes(&v, y, x);
+    for (size_t j = 0; j < n; ++j) out[i + j] = vec2(x[j], y[j]);
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+static inline void
+glisy_sample_disc_batch (glisy_rng *rng, vec2 *out, size_t count) {
+  float x[GLISY_RNG_LANES], y[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_disc_lanes(&v, x, y);
+    for (size_t j = 0; j < n; ++j) out[i + j] = vec2(x[j], y[j]);
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+static inline void
+glisy_sample_sphere_batch (glisy_rng *rng, vec3 *out, size_t count) {
+  float x[GLISY_RNG_LANES], y[GLISY_RNG_LANES], z[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_sphere_lanes(&v, x, y, z);
+    for (size_t j = 0; j < n; ++j) out[i + j] = vec3(x[j], y[j], z[j]);
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+static inline void
+glisy_sample_hemisphere_batch (glisy_rng *rng, vec3 *out, size_t count,
+                               vec3 normal) {
+  float x[GLISY_RNG_LANES], y[GLISY_RNG_LANES], z[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_sphere_lanes(&v, x, y, z);
+    for (size_t j = 0; j < n; ++j) {
+      float d = x[j] * normal.x + y[j] * normal.y + z[j] * normal.z;
+      float s = d < 0 ? -1.0f : 1.0f;
+      out[i + j] = vec3(x[j] * s, y[j] * s, z[j] * s);
+    }
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+static inline void
+glisy_sample_ball_batch (glisy_rng *rng, vec3 *out, size_t count) {
+  float x[GLISY_RNG_LANES], y[GLISY_RNG_LANES], z[GLISY_RNG_LANES];
+  float r[GLISY_RNG_LANES], u[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_uniform_lanes(&v, r);
+    for (int k = 0; k < 2; ++k) {
+      glisy_sample_uniform_lanes(&v, u);
+      for (int j = 0; j < GLISY_RNG_LANES; ++j) r[j] = fmaxf(r[j], u[j]);
+    }
+    glisy_sample_sphere_lanes(&v, x, y, z);
+    for (size_t j = 0; j < n; ++j) {
+      out[i + j] = vec3(x[j] * r[j], y[j] * r[j], z[j] * r[j]);
+    }
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+static inline void
+glisy_sample_quat_batch (glisy_rng *rng, quat *out, size_t count) {
+  float u[GLISY_RNG_LANES], a[GLISY_RNG_LANES];
+  float ps[GLISY_RNG_LANES], pc[GLISY_RNG_LANES];
+  float qs[GLISY_RNG_LANES], qc[GLISY_RNG_LANES];
+  glisy_sample_lanes v;
+  glisy_sample_lanes_load(&v, rng);
+  for (size_t i = 0; i < count; i += GLISY_RNG_LANES) {
+    size_t n = count - i < GLISY_RNG_LANES ? count - i : GLISY_RNG_LANES;
+    glisy_sample_uniform_lanes(&v, u);
+    glisy_sample_angle_lanes(&v, ps, pc);
+    glisy_sample_angle_lanes(&v, qs, qc);
+#ifdef GLISY_SSE2
+    for (int j = 0; j < GLISY_RNG_LANES; j += GLISY_LANES) {
+      glisy_lane b = glisy_lane_load(u + j);
+      glisy_lane c = glisy_lane_sub(glisy_lane_splat(1.0f), b);
+      glisy_lane_store(a + j, glisy_lane_sqrt(c));
+      glisy_lane_store(u + j, glisy_lane_sqrt(b));
+    }
+#else
+    for (int j = 0; j < GLISY_RNG_LANES; ++j) {
+      a[j] = sqrtf(1.0f - u[j]);
+      u[j] = sqrtf(u[j]);
+    }
+#endif
+    for (size_t j = 0; j < n; ++j) {
+      out[i + j] = quat(a[j] * ps[j], a[j] * pc[j],
+                        u[j] * qs[j], u[j] * qc[j]);
+    }
+  }
+  glisy_sample_lanes_store(rng, &v);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,456 @@
+#ifndef GLISY_SIMD_H
+#define GLISY_SIMD_H
+
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+
+/**
+ * Compile time SIMD selection. SSE2 is the baseline on x86-64,
+ * AVX, FMA and F16C are used when the compiler targets them
+ * (-mavx, -mfma, -mf16c, -march=native). Define GLISY_NO_SIMD to
+ * force the scalar routines everywhere.
+ */
+
+#if !defined(GLISY_NO_SIMD) && defined(__SSE2__)
+#define GLISY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(GLISY_SSE2) && defined(__AVX__)
+#define GLISY_AVX 1
+#include <immintrin.h>
+#endif
+
+#if defined(GLISY_SSE2) && defined(__FMA__)
+#define GLISY_FMA 1
+#include <immintrin.h>
+#endif
+
+#if defined(GLISY_AVX) && defined(__F16C__)
+#define GLISY_F16C 1
+#endif
+
+/**
+ * Aligns a type or variable to n bytes.
+ */
+
+#define GLISY_ALIGN(n) __attribute__((aligned(n)))
+
+#ifdef GLISY_SSE2
+
+/**
+ * Shuffle mask helper matching _MM_SHUFFLE argument order
+ * (x selects lane 0).
+ */
+
+#define GLISY_SHUFFLE(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+
+/**
+ * Broadcasts lane i of a.
+ */
+
+#define glisy_simd_splat(a, i) \
+  _mm_shuffle_ps((a), (a), GLISY_SHUFFLE(i, i, i, i))
+
+/**
+ * Returns a * b + c, fused when FMA is available.
+ */
+
+static inline __m128
+glisy_simd_madd (__m128 a, __m128 b, __m128 c) {
+#ifdef GLISY_FMA
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+/**
+ * Returns the sum of all lanes of a broadcast to every lane.
+ */
+
+static inline __m128
+glisy_simd_hsum (__m128 a) {
+  a = _mm_add_ps(a, _mm_shuffle_ps(a, a, GLISY_SHUFFLE(2, 3, 0, 1)));
+  return _mm_add_ps(a, _mm_shuffle_ps(a, a, GLISY_SHUFFLE(1, 0, 3, 2)));
+}
+
+/**
+ * Returns a where mask is set and b elsewhere.
+ */
+
+static inline __m128
+glisy_simd_select (__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+#endif
+
+#ifdef GLISY_AVX
+
+/**
+ * 256 bit variant of glisy_simd_madd.
+ */
+
+static inline __m256
+glisy_simd_madd256 (__m256 a, __m256 b, __m256 c) {
+#ifdef GLISY_FMA
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+#endif
+
+/**
+ * Lane width of the SoA and AoSoA kernels: eight floats under
+ * AVX, four otherwise. glisy_lane is one register of GLISY_LANES
+ * floats; its loads and stores are unaligned so callers may use
+ * plain malloc'd arrays.
+ */
+
+#ifdef GLISY_AVX
+#define GLISY_LANES 8
+#else
+#define GLISY_LANES 4
+#endif
+
+#if defined(GLISY_AVX)
+typedef __m256 glisy_lane;
+#define glisy_lane_load(p) _mm256_loadu_ps((p))
+#define glisy_lane_store(p, a) _mm256_storeu_ps((p), (a))
+#define glisy_lane_splat(f) _mm256_set1_ps((f))
+#define glisy_lane_add(a, b) _mm256_add_ps((a), (b))
+#define glisy_lane_sub(a, b) _mm256_sub_ps((a), (b))
+#define glisy_lane_mul(a, b) _mm256_mul_ps((a), (b))
+#define glisy_lane_madd(a, b, c) glisy_simd_madd256((a), (b), (c))
+#define glisy_lane_div(a, b) _mm256_div_ps((a), (b))
+#define glisy_lane_eq(a, b) _mm256_cmp_ps((a), (b), _CMP_EQ_OQ)
+#define glisy_lane_select(mask, a, b) _mm256_blendv_ps((b), (a), (mask))
+#define glisy_lane_shuffle(a, b, imm) _mm256_shuffle_ps((a), (b), (imm))
+#define glisy_lane_unpacklo(a, b) _mm256_unpacklo_ps((a), (b))
+#define glisy_lane_unpackhi(a, b) _mm256_unpackhi_ps((a), (b))
+#define glisy_lane_sqrt(a) _mm256_sqrt_ps((a))
+#define glisy_lane_gt(a, b) _mm256_cmp_ps((a), (b), _CMP_GT_OQ)
+#define glisy_lane_ge(a, b) _mm256_cmp_ps((a), (b), _CMP_GE_OQ)
+#define glisy_lane_and(a, b) _mm256_and_ps((a), (b))
+#define glisy_lane_or(a, b) _mm256_or_ps((a), (b))
+#define glisy_lane_xor(a, b) _mm256_xor_ps((a), (b))
+#define glisy_lane_movemask(a) _mm256_movemask_ps((a))
+#define glisy_lane_zero() _mm256_setzero_ps()
+#elif defined(GLISY_SSE2)
+typedef __m128 glisy_lane;
+#define glisy_lane_load(p) _mm_loadu_ps((p))
+#define glisy_lane_store(p, a) _mm_storeu_ps((p), (a))
+#define glisy_lane_splat(f) _mm_set1_ps((f))
+#define glisy_lane_add(a, b) _mm_add_ps((a), (b))
+#define glisy_lane_sub(a, b) _mm_sub_ps((a), (b))
+#define glisy_lane_mul(a, b) _mm_mul_ps((a), (b))
+#define glisy_lane_madd(a, b, c) glisy_simd_madd((a), (b), (c))
+#define glisy_lane_div(a, b) _mm_div_ps((a), (b))
+#define glisy_lane_eq(a, b) _mm_cmpeq_ps((a), (b))
+#define glisy_lane_select(mask, a, b) glisy_simd_select((mask), (a), (b))
+#define glisy_lane_shuffle(a, b, imm) _mm_shuffle_ps((a), (b), (imm))
+#define glisy_lane_unpacklo(a, b) _mm_unpacklo_ps((a), (b))
+#define glisy_lane_unpackhi(a, b) _mm_unpackhi_ps((a), (b))
+#define glisy_lane_sqrt(a) _mm_sqrt_ps((a))
+#define glisy_lane_gt(a, b) _mm_cmpgt_ps((a), (b))
+#define glisy_lane_ge(a, b) _mm_cmpge_ps((a), (b))
+#define glisy_lane_and(a, b) _mm_and_ps((a), (b))
+#define glisy_lane_or(a, b) _mm_or_ps((a), (b))
+#define glisy_lane_xor(a, b) _mm_xor_ps((a), (b))
+#define glisy_lane_movemask(a) _mm_movemask_ps((a))
+#define glisy_lane_zero() _mm_setzero_ps()
+#endif
+
+#ifdef GLISY_SSE2
+
+/**
+ * Transposes the 4x4 float blocks held in each 128 bit half of
+ * a, b, c and d, like _MM_TRANSPOSE4_PS.
+ */
+
+static inline void
+glisy_lane_transpose4 (glisy_lane *a, glisy_lane *b,
+                       glisy_lane *c, glisy_lane *d) {
+  glisy_lane t0 = glisy_lane_unpacklo(*a, *b);
+  glisy_lane t1 = glisy_lane_unpacklo(*c, *d);
+  glisy_lane t2 = glisy_lane_unpackhi(*a, *b);
+  glisy_lane t3 = glisy_lane_unpackhi(*c, *d);
+  *a = glisy_lane_shuffle(t0, t1, GLISY_SHUFFLE(0, 1, 0, 1));
+  *b = glisy_lane_shuffle(t0, t1, GLISY_SHUFFLE(2, 3, 2, 3));
+  *c = glisy_lane_shuffle(t2, t3, GLISY_SHUFFLE(0, 1, 0, 1));
+  *d = glisy_lane_shuffle(t2, t3, GLISY_SHUFFLE(2, 3, 2, 3));
+}
+#endif
+
+/**
+ * Alignment of SIMD allocations, one cache line.
+ */
+
+#define GLISY_SIMD_ALIGN 64
+
+/**
+ * SoA containers round their capacity up to a multiple of
+ * GLISY_SOA_PAD floats, so every component array starts on a
+ * GLISY_SIMD_ALIGN boundary and holds whole SIMD registers.
+ */
+
+#define GLISY_SOA_PAD 16
+
+/**
+ * Allocates size bytes aligned to GLISY_SIMD_ALIGN, rounding size
+ * up to a multiple of the alignment. Release with free(). Uses
+ * aligned_alloc under C11 and posix_memalign before it.
+ */
+
+static inline void *
+glisy_simd_alloc (size_t size) {
+  size = (size + GLISY_SIMD_ALIGN - 1) & ~(size_t) (GLISY_SIMD_ALIGN - 1);
+  if (0 == size) size = GLISY_SIMD_ALIGN;
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  return aligned_alloc(GLISY_SIMD_ALIGN, size);
+#else
+  void *p = NULL;
+  return posix_memalign(&p, GLISY_SIMD_ALIGN, size) ? NULL : p;
+#endif
+}
+
+/**
+ * Fast reciprocal square root: the hardware rsqrt estimate (12
+ * bits) refined by one Newton-Raphson step, which leaves a
+ * relative error below 5e-7 (about 4 ulp). The step overflows
+ * outside the normal float range, so 0, subnormals, inf and NaN
+ * take 1 / sqrtf(x) instead, as does every x without SSE.
+ */
+
+static inline float
+glisy_rsqrtf_fast (float x) {
+#ifdef GLISY_SSE2
+  if (x >= FLT_MIN && x <= FLT_MAX) {
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - 0.5f * x * y * y);
+  }
+#endif
+  return 1.0f / sqrtf(x);
+}
+
+/**
+ * Fast square root as x * glisy_rsqrtf_fast(x), and sqrtf(x)
+ * outside the normal float range.
+ */
+
+static inline float
+glisy_sqrtf_fast (float x) {
+  return x >= FLT_MIN && x <= FLT_MAX ? x * glisy_rsqrtf_fast(x) : sqrtf(x);
+}
+
+/**
+ * Square root and reciprocal square root used by the length,
+ * distance and normalize routines. Correctly rounded float by
+ * default; defining GLISY_FAST_MATH switches every such routine,
+ * scalar and batch, to the fast variants above.
+ */
+
+static inline float
+glisy_rsqrtf (float x) {
+#ifdef GLISY_FAST_MATH
+  return glisy_rsqrtf_fast(x);
+#else
+  return 1.0f / sqrtf(x);
+#endif
+}
+
+static inline float
+glisy_sqrtf (float x) {
+#ifdef GLISY_FAST_MATH
+  return glisy_sqrtf_fast(x);
+#else
+  return sqrtf(x);
+#endif
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Lane variants of glisy_rsqrtf_fast, glisy_sqrtf_fast and
+ * glisy_rsqrtf. The exact path runs only when some lane is outside
+ * the normal float range, and only those lanes take its result.
+ */
+
+static inline glisy_lane
+glisy_lane_normal (glisy_lane x) {
+  return glisy_lane_and(glisy_lane_ge(x, glisy_lane_splat(FLT_MIN)),
+                        glisy_lane_ge(glisy_lane_splat(FLT_MAX), x));
+}
+
+static inline glisy_lane
+glisy_lane_rsqrt_fast (glisy_lane x) {
+#ifdef GLISY_AVX
+  glisy_lane y = _mm256_rsqrt_ps(x);
+#else
+  glisy_lane y = _mm_rsqrt_ps(x);
+#endif
+  glisy_lane h = glisy_lane_mul(glisy_lane_mul(x, glisy_lane_splat(0.5f)),
+                                glisy_lane_mul(y, y));
+  y = glisy_lane_mul(y, glisy_lane_sub(glisy_lane_splat(1.5f), h));
+  glisy_lane normal = glisy_lane_normal(x);
+  if (glisy_lane_movemask(normal) != (1 << GLISY_LANES) - 1) {
+    glisy_lane exact = glisy_lane_div(glisy_lane_splat(1.0f),
+                                      glisy_lane_sqrt(x));
+    y = glisy_lane_select(normal, y, exact);
+  }
+  return y;
+}
+
+static inline glisy_lane
+glisy_lane_sqrt_fast (glisy_lane x) {
+  glisy_lane y = glisy_lane_mul(x, glisy_lane_rsqrt_fast(x));
+  glisy_lane normal = glisy_lane_normal(x);
+  if (glisy_lane_movemask(normal) != (1 << GLISY_LANES) - 1) {
+    y = glisy_lane_select(normal, y, glisy_lane_sqrt(x));
+  }
+  return y;
+}
+
+static inline glisy_lane
+glisy_lane_rsqrt (glisy_lane x) {
+#ifdef GLISY_FAST_MATH
+  return glisy_lane_rsqrt_fast(x);
+#else
+  return glisy_lane_div(glisy_lane_splat(1.0f), glisy_lane_sqrt(x));
+#endif
+}
+#endif
+
+/**
+ * Largest |x| for which glisy_sincosf uses its own argument
+ * reduction. Larger angles and infinities fall back to sinf and
+ * cosf.
+ */
+
+#define GLISY_SINCOS_RANGE 8192.0f
+
+/**
+ * Computes the sine and cosine of x in one pass. x is reduced to
+ * [-pi/4, pi/4] with a four part Cody-Waite split of pi/2 and both
+ * results come from minimax polynomials on the reduced angle. The
+ * error is within 2.5 ulp of the correctly rounded result and
+ * 1e-7 absolute for |x| <= GLISY_SINCOS_RANGE.
+ */
+
+static inline void
+glisy_sincosf (float x, float *s, float *c) {
+  if (!(fabsf(x) <= GLISY_SINCOS_RANGE)) {
+    *s = sinf(x);
+    *c = cosf(x);
+    return;
+  }
+
+  // nearest quadrant q, then r = x - q * pi/2
+  float q = (x * 0.636619772f + 12582912.0f) - 12582912.0f;
+  float r = x - q * 1.5703125f;
+  r = r - q * 4.837512969970703e-4f;
+  r = r - q * 7.549533620476723e-8f;
+  r = r - q * 2.5633440682570896e-12f;
+
+  float z = r * r;
+  float sr = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f
+                        + z * -1.9515295891e-4f));
+  float cr = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f
+                             + z * (-1.388731625493765e-3f
+                             + z * 2.443315711809948e-5f));
+
+  // the quadrant selects and signs the results
+  int n = (int) q;
+  float ss = n & 1 ? cr : sr;
+  float cc = n & 1 ? sr : cr;
+  *s = n & 2 ? -ss : ss;
+  *c = (n + 1) & 2 ? -cc : cc;
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Lane variant of glisy_sincosf.
+ */
+
+static inline void
+glisy_lane_sincos (glisy_lane x, glisy_lane *s, glisy_lane *c) {
+  glisy_lane magic = glisy_lane_splat(12582912.0f);
+  glisy_lane sign = glisy_lane_splat(-0.0f);
+  glisy_lane one = glisy_lane_splat(1.0f);
+  glisy_lane two = glisy_lane_splat(2.0f);
+
+  glisy_lane q = glisy_lane_sub(glisy_lane_madd(x,
+                   glisy_lane_splat(0.636619772f), magic), magic);
+  glisy_lane r = glisy_lane_madd(q, glisy_lane_splat(-1.5703125f), x);
+  r = glisy_lane_madd(q, glisy_lane_splat(-4.837512969970703e-4f), r);
+  r = glisy_lane_madd(q, glisy_lane_splat(-7.549533620476723e-8f), r);
+  r = glisy_lane_madd(q, glisy_lane_splat(-2.5633440682570896e-12f), r);
+
+  glisy_lane z = glisy_lane_mul(r, r);
+  glisy_lane ps = glisy_lane_madd(z, glisy_lane_splat(-1.9515295891e-4f),
+                                  glisy_lane_splat(8.3321608736e-3f));
+  ps = glisy_lane_madd(z, ps, glisy_lane_splat(-1.6666654611e-1f));
+  glisy_lane sr = glisy_lane_madd(glisy_lane_mul(r, z), ps, r);
+  glisy_lane pc = glisy_lane_madd(z, glisy_lane_splat(2.443315711809948e-5f),
+                                  glisy_lane_splat(-1.388731625493765e-3f));
+  pc = glisy_lane_madd(z, pc, glisy_lane_splat(4.166664568298827e-2f));
+  glisy_lane cr = glisy_lane_madd(glisy_lane_mul(z, z), pc,
+                    glisy_lane_madd(z, glisy_lane_splat(-0.5f), one));
+
+  // q mod 4 in floats, as AVX without AVX2 has no integer lanes
+  glisy_lane k = glisy_lane_madd(q, glisy_lane_splat(0.25f),
+                                 glisy_lane_splat(-0.375f));
+  k = glisy_lane_sub(glisy_lane_add(k, magic), magic);
+  glisy_lane m = glisy_lane_madd(k, glisy_lane_splat(-4.0f), q);
+  glisy_lane m1 = glisy_lane_eq(m, one);
+  glisy_lane swap = glisy_lane_or(m1, glisy_lane_eq(m, glisy_lane_splat(3.0f)));
+  glisy_lane sneg = glisy_lane_and(glisy_lane_ge(m, two), sign);
+  glisy_lane cneg = glisy_lane_and(glisy_lane_or(m1, glisy_lane_eq(m, two)),
+                                   sign);
+  *s = glisy_lane_xor(glisy_lane_select(swap, cr, sr), sneg);
+  *c = glisy_lane_xor(glisy_lane_select(swap, sr, cr), cneg);
+
+  glisy_lane range = glisy_lane_splat(GLISY_SINCOS_RANGE);
+  glisy_lane ax = glisy_lane_xor(x, glisy_lane_and(x, sign));
+  if (glisy_lane_movemask(glisy_lane_gt(ax, range))) {
+    float xs[GLISY_LANES], ss[GLISY_LANES], cs[GLISY_LANES];
+    glisy_lane_store(xs, x);
+    glisy_lane_store(ss, *s);
+    glisy_lane_store(cs, *c);
+    for (int i = 0; i < GLISY_LANES; ++i) {
+      if (fabsf(xs[i]) > GLISY_SINCOS_RANGE) {
+        glisy_sincosf(xs[i], &ss[i], &cs[i]);
+      }
+    }
+    *s = glisy_lane_load(ss);
+    *c = glisy_lane_load(cs);
+  }
+}
+#endif
+
+/**
+ * Writes the sine and cosine of the count angles at x to s and c.
+ */
+
+static inline void
+glisy_sincosf_batch (float *s, float *c, const float *x, size_t count) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < count - count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane ls, lc;
+    glisy_lane_sincos(glisy_lane_load(x + i), &ls, &lc);
+    glisy_lane_store(s + i, ls);
+    glisy_lane_store(c + i, lc);
+  }
+#endif
+  for (; i < count; ++i) {
+    glisy_sincosf(x[i], &s[i], &c[i]);
+  }
+}
+
+#endif
@@ -0,0 +1,518 @@
+#ifndef GLISY_SKIN_H
+#define GLISY_SKIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/mat4.h>
+#include <glisy/mat3x4.h>
+#include <glisy/trs.h>
+#include <glisy/dquat.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/parallel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CPU skinning of SoA vertex positions and normals by a bone
+ * palette, with linear blending of mat3x4s (LBS) or dual
+ * quaternion blending of dquats (DQS). Vertices are split into
+ * chunks over a glisy_pool. Each chunk blends one vertex's
+ * influences at a time with SSE and transforms a register of
+ * vertices at a time.
+ */
+
+#define GLISY_SKIN_MAX_INFLUENCES 8
+
+/**
+ * skin_weights struct type. Up to influences bone indices and
+ * weights for each of count vertices, stored a stream per
+ * influence: influence k of vertex i is at k * capacity + i.
+ * Weights of a vertex sum to 1 and unused influences have weight
+ * 0. Entries past count are zero, like the padding of vec3_soa.
+ */
+
+typedef struct skin_weights skin_weights;
+struct skin_weights {
+  uint16_t *bones;
+  float *weights;
+  size_t count;
+  size_t capacity;
+  int influences;
+};
+
+#define skin_weights_create() ((skin_weights) {0})
+
+/**
+ * Releases the storage of skin_weights w and empties it.
+ */
+
+static inline void
+glisy_skin_weights_free (skin_weights *w) {
+  free(w->weights);
+  *w = (skin_weights) {0};
+}
+
+#define skin_weights_free(w) glisy_skin_weights_free(&(w))
+
+/**
+ * Sets skin_weights w to count vertices of influences, 1 to
+ * GLISY_SKIN_MAX_INFLUENCES, weights each. Existing vertices keep
+ * their weights when influences is unchanged; new ones have none.
+ * Returns 0 on success and -1 when influences is out of range or
+ * allocation fails, leaving w unchanged.
+ */
+
+static inline int
+glisy_skin_weights_resize (skin_weights *w, size_t count, int influences) {
+  if (influences < 1 || influences > GLISY_SKIN_MAX_INFLUENCES) return -1;
+  if (influences == w->influences && count <= w->capacity) {
+    for (int k = 0; count < w->count && k < influences; ++k) {
+      size_t n = w->count - count;
+      memset(w->weights + k * w->capacity + count, 0, n * sizeof(float));
+      memset(w->bones + k * w->capacity + count, 0, n * sizeof(uint16_t));
+    }
+    w->count = count;
+    return 0;
+  }
+
+  size_t capacity = count > 2 * w->capacity ? count : 2 * w->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+  size_t size = influences * capacity * (sizeof(float) + sizeof(uint16_t));
+  float *data = (float *) glisy_simd_alloc(size);
+  if (!data) return -1;
+  memset(data, 0, size);
+  skin_weights g = {(uint16_t *) (data + influences * capacity), data,
+                    count, capacity, influences};
+  if (influences == w->influences) {
+    size_t n = count < w->count ? count : w->count;
+    for (int k = 0; k < influences; ++k) {
+      memcpy(g.weights + k * capacity, w->weights + k * w->capacity,
+             n * sizeof(float));
+      memcpy(g.bones + k * capacity, w->bones + k * w->capacity,
+             n * sizeof(uint16_t));
+    }
+  }
+  free(w->weights);
+  *w = g;
+  return 0;
+}
+
+#define skin_weights_resize(w, count, influences) \
+  glisy_skin_weights_resize(&(w), (count), (influences))
+
+/**
+ * Sets vertex i of skin_weights w to n influences of bones with
+ * weights, scaled to sum to 1. Influences past n are cleared.
+ * Returns 0 on success and -1 when i or n is out of range or the
+ * weights do not sum to a positive value.
+ */
+
+static inline int
+glisy_skin_weights_set (skin_weights *w,
+                        size_t i,
+                        int n,
+                        const uint16_t *bones,
+                        const float *weights) {
+  float sum = 0;
+  if (i >= w->count || n < 0 || n > w->influences) return -1;
+  for (int k = 0; k < n; ++k) sum += weights[k];
+  if (!(sum > 0)) return -1;
+  for (int k = 0; k < w->influences; ++k) {
+    w->bones[k * w->capacity + i] = k < n ? bones[k] : 0;
+    w->weights[k * w->capacity + i] = k < n ? weights[k] / sum : 0;
+  }
+  return 0;
+}
+
+#define skin_weights_set(w, i, n, bones, weights) \
+  glisy_skin_weights_set(&(w), (i), (n), (bones), (weights))
+
+/**
+ * Builds an LBS palette: out[i] = world[i] * inverse_bind[i], the
+ * transform from bind space to world space of each of count bones.
+ */
+
+static inline void
+glisy_skin_palette_mat4 (mat3x4 *out,
+                         const mat4 *world,
+                         const mat4 *inverse_bind,
+                         size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    mat3x4 a, b;
+    glisy_mat3x4_from_mat4_into(&a, &world[i]);
+    glisy_mat3x4_from_mat4_into(&b, &inverse_bind[i]);
+    glisy_mat3x4_multiply_into(&out[i], &a, &b);
+  }
+}
+
+static inline void
+glisy_skin_palette_trs (mat3x4 *out,
+                        const trs *world,
+                        const mat3x4 *inverse_bind,
+                        size_t count) {
+  glisy_trs_to_mat3x4_batch(out, world, count);
+  glisy_mat3x4_multiply_batch(out, out, inverse_bind, count);
+}
+
+/**
+ * Builds a DQS palette like glisy_skin_palette_mat4. Bones must be
+ * rigid: scale in world or inverse_bind is dropped.
+ */
+
+static inline void
+glisy_skin_dquat_palette_mat4 (dquat *out,
+                               const mat4 *world,
+                               const mat4 *inverse_bind,
+                               size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    mat3x4 m;
+    glisy_skin_palette_mat4(&m, &world[i], &inverse_bind[i], 1);
+    out[i] = glisy_dquat_from_mat3x4(m);
+  }
+}
+
+static inline void
+glisy_skin_dquat_palette_trs (dquat *out,
+                              const trs *world,
+                              const trs *inverse_bind,
+                              size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    dquat a, b;
+    glisy_dquat_from_trs_into(&a, &world[i]);
+    glisy_dquat_from_trs_into(&b, &inverse_bind[i]);
+    glisy_dquat_multiply_into(&out[i], &a, &b);
+  }
+}
+
+/**
+ * One skinning call, split into chunks by glisy_parallel_for.
+ * normals and normals_out are NULL when only positions are skinned.
+ */
+
+typedef struct glisy_skin_job glisy_skin_job;
+struct glisy_skin_job {
+  vec3_soa *positions_out;
+  vec3_soa *normals_out;
+  const vec3_soa *positions;
+  const vec3_soa *normals;
+  const skin_weights *weights;
+  const void *palette;
+};
+
+#ifndef GLISY_SSE2
+
+/**
+ * Skins vertex i of job j, the scalar path.
+ */
+
+static inline void
+glisy_skin_lbs_vertex (const glisy_skin_job *j, size_t i) {
+  const skin_weights *w = j->weights;
+  const mat3x4 *palette = j->palette;
+  float m[12] = {0};
+  for (int k = 0; k < w->influences; ++k) {
+    float s = w->weights[k * w->capacity + i];
+    const float *b = &palette[w->bones[k * w->capacity + i]].m11;
+    if (0 == s) continue;
+    for (int e = 0; e < 12; ++e) m[e] += s * b[e];
+  }
+  vec3 p = glisy_vec3_soa_get(j->positions, i);
+  glisy_vec3_soa_set(j->positions_out, i, (vec3) {
+    m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+    m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+    m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]});
+  if (j->normals) {
+    vec3 n = glisy_vec3_soa_get(j->normals, i);
+    n = (vec3) {m[0] * n.x + m[1] * n.y + m[2] * n.z,
+                m[4] * n.x + m[5] * n.y + m[6] * n.z,
+                m[8] * n.x + m[9] * n.y + m[10] * n.z};
+    glisy_vec3_normalize_into(&n, &n);
+    glisy_vec3_soa_set(j->normals_out, i, n);
+  }
+}
+
+static inline void
+glisy_skin_dqs_vertex (const glisy_skin_job *j, size_t i) {
+  const skin_weights *w = j->weights;
+  const dquat *palette = j->palette;
+  const quat *pivot = NULL;
+  float v[8] = {0};
+  for (int k = 0; k < w->influences; ++k) {
+    float s = w->weights[k * w->capacity + i];
+    const dquat *q = &palette[w->bones[k * w->capacity + i]];
+    const float *b = &q->real.x;
+    if (0 == s) continue;
+    if (!pivot) pivot = &q->real;
+    if (pivot->x * q->real.x + pivot->y * q->real.y +
+        pivot->z * q->real.z + pivot->w * q->real.w < 0) {
+      s = -s;
+    }
+    for (int e = 0; e < 8; ++e) v[e] += s * b[e];
+  }
+  dquat q = dquat({v[0], v[1], v[2], v[3]}, {v[4], v[5], v[6], v[7]});
+  glisy_dquat_normalize_into(&q, &q);
+  vec3 p = glisy_vec3_soa_get(j->positions, i);
+  glisy_dquat_transform_point_into(&p, &q, &p);
+  glisy_vec3_soa_set(j->positions_out, i, p);
+  if (j->normals) {
+    vec3 n = glisy_vec3_soa_get(j->normals, i);
+    glisy_vec3_soa_set(j->normals_out, i, glisy_trs_rotate(&q.real, n));
+  }
+}
+#endif
+
+static inline void
+glisy_skin_lbs_fn (void *ctx, size_t begin, size_t end, unsigned worker) {
+  const glisy_skin_job *j = (const glisy_skin_job *) ctx;
+  (void) worker;
+#ifdef GLISY_SSE2
+  const skin_weights *w = j->weights;
+  const mat3x4 *palette = (const mat3x4 *) j->palette;
+  float rows[3][4 * GLISY_LANES] GLISY_ALIGN(16);
+  for (size_t i = begin; i < end; i += GLISY_LANES) {
+    // blend each vertex's matrix rows, then transpose to lanes
+    for (size_t v = 0; v < GLISY_LANES; ++v) {
+      __m128 r0 = _mm_setzero_ps(), r1 = r0, r2 = r0;
+      for (int k = 0; k < w->influences; ++k) {
+        float s = w->weights[k * w->capacity + i + v];
+        const mat3x4 *m = &palette[w->bones[k * w->capacity + i + v]];
+        if (0 == s) continue;
+        __m128 ws = _mm_set1_ps(s);
+        r0 = glisy_simd_madd(ws, _mm_load_ps(&m->m11), r0);
+        r1 = glisy_simd_madd(ws, _mm_load_ps(&m->m21), r1);
+        r2 = glisy_simd_madd(ws, _mm_load_ps(&m->m31), r2);
+      }
+      _mm_store_ps(rows[0] + 4 * v, r0);
+      _mm_store_ps(rows[1] + 4 * v, r1);
+      _mm_store_ps(rows[2] + 4 * v, r2);
+    }
+    glisy_lane m[12];
+    glisy_vec4_load_lanes(rows[0], &m[0], &m[1], &m[2], &m[3]);
+    glisy_vec4_load_lanes(rows[1], &m[4], &m[5], &m[6], &m[7]);
+    glisy_vec4_load_lanes(rows[2], &m[8], &m[9], &m[10], &m[11]);
+
+    glisy_lane x = glisy_lane_load(j->positions->x + i);
+    glisy_lane y = glisy_lane_load(j->positions->y + i);
+    glisy_lane z = glisy_lane_load(j->positions->z + i);
+    for (int r = 0; r < 3; ++r) {
+      float *out[3] = {j->positions_out->x, j->positions_out->y,
+                       j->positions_out->z};
+      glisy_lane_store(out[r] + i,
+        glisy_lane_madd(m[4 * r], x, glisy_lane_madd(m[4 * r + 1], y,
+        glisy_lane_madd(m[4 * r + 2], z, m[4 * r + 3]))));
+    }
+    if (!j->normals) continue;
+
+    x = glisy_lane_load(j->normals->x + i);
+    y = glisy_lane_load(j->normals->y + i);
+    z = glisy_lane_load(j->normals->z + i);
+    glisy_lane n[3];
+    for (int r = 0; r < 3; ++r) {
+      n[r] = glisy_lane_madd(m[4 * r], x, glisy_lane_madd(m[4 * r + 1], y,
+             glisy_lane_mul(m[4 * r + 2], z)));
+    }
+    glisy_lane len = glisy_lane_madd(n[2], n[2], glisy_lane_madd(n[1], n[1],
+                     glisy_lane_mul(n[0], n[0])));
+    glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                                    glisy_lane_rsqrt(len));
+    glisy_lane_store(j->normals_out->x + i, glisy_lane_mul(n[0], inv));
+    glisy_lane_store(j->normals_out->y + i, glisy_lane_mul(n[1], inv));
+    glisy_lane_store(j->normals_out->z + i, glisy_lane_mul(n[2], inv));
+  }
+#else
+  if (end > j->positions->count) end = j->positions->count;
+  for (size_t i = begin; i < end; ++i) glisy_skin_lbs_vertex(j, i);
+#endif
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Returns 2 * r x (r x v + w * v), the rotation of v by unit quat
+ * (r, w) minus v, in lanes.
+ */
+
+static inline void
+glisy_skin_rotate_lanes (glisy_lane out[3], const glisy_lane r[4],
+                         const glisy_lane v[3]) {
+  glisy_lane u[3];
+  for (int e = 0; e < 3; ++e) {
+    int a = (e + 1) % 3, b = (e + 2) % 3;
+    u[e] = glisy_lane_madd(r[3], v[e], glisy_lane_sub(
+             glisy_lane_mul(r[a], v[b]), glisy_lane_mul(r[b], v[a])));
+  }
+  for (int e = 0; e < 3; ++e) {
+    int a = (e + 1) % 3, b = (e + 2) % 3;
+    glisy_lane c = glisy_lane_sub(glisy_lane_mul(r[a], u[b]),
+                                  glisy_lane_mul(r[b], u[a]));
+    out[e] = glisy_lane_add(c, c);
+  }
+}
+#endif
+
+static inline void
+glisy_skin_dqs_fn (void *ctx, size_t begin, size_t end, unsigned worker) {
+  const glisy_skin_job *j = (const glisy_skin_job *) ctx;
+  (void) worker;
+#ifdef GLISY_SSE2
+  const skin_weights *w = j->weights;
+  const dquat *palette = (const dquat *) j->palette;
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  float real[4 * GLISY_LANES] GLISY_ALIGN(16);
+  float dual[4 * GLISY_LANES] GLISY_ALIGN(16);
+  for (size_t i = begin; i < end; i += GLISY_LANES) {
+    // blend each vertex's dquats on the side of its first bone
+    for (size_t v = 0; v < GLISY_LANES; ++v) {
+      __m128 r = _mm_setzero_ps(), d = r, pivot = r;
+      int first = 1;
+      for (int k = 0; k < w->influences; ++k) {
+        float s = w->weights[k * w->capacity + i + v];
+        const dquat *q = &palette[w->bones[k * w->capacity + i + v]];
+        if (0 == s) continue;
+        __m128 qr = _mm_loadu_ps(&q->real.x);
+        __m128 qd = _mm_loadu_ps(&q->dual.x);
+        __m128 ws = _mm_set1_ps(s);
+        if (first) {
+          pivot = qr;
+          first = 0;
+        }
+        __m128 dot = glisy_simd_hsum(_mm_mul_ps(pivot, qr));
+        ws = _mm_xor_ps(ws, _mm_and_ps(sign,
+                                       _mm_cmplt_ps(dot, _mm_setzero_ps())));
+        r = glisy_simd_madd(ws, qr, r);
+        d = glisy_simd_madd(ws, qd, d);
+      }
+      _mm_store_ps(real + 4 * v, r);
+      _mm_store_ps(dual + 4 * v, d);
+    }
+    glisy_lane r[4], d[4];
+    glisy_vec4_load_lanes(real, &r[0], &r[1], &r[2], &r[3]);
+    glisy_vec4_load_lanes(dual, &d[0], &d[1], &d[2], &d[3]);
+
+    // scale both parts by 1 / |real|; the part of dual along real
+    // drops out of the translation below
+    glisy_lane len = glisy_lane_madd(r[3], r[3], glisy_lane_madd(r[2], r[2],
+                     glisy_lane_madd(r[1], r[1], glisy_lane_mul(r[0], r[0]))));
+    glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                                    glisy_lane_rsqrt(len));
+    for (int e = 0; e < 4; ++e) {
+      r[e] = glisy_lane_mul(r[e], inv);
+      d[e] = glisy_lane_mul(d[e], inv);
+    }
+
+    // t = 2 * (w d - dw r + r x d)
+    glisy_lane t[3];
+    for (int e = 0; e < 3; ++e) {
+      int a = (e + 1) % 3, b = (e + 2) % 3;
+      glisy_lane c = glisy_lane_madd(r[3], d[e], glisy_lane_sub(
+                       glisy_lane_sub(glisy_lane_mul(r[a], d[b]),
+                                      glisy_lane_mul(r[b], d[a])),
+                       glisy_lane_mul(d[3], r[e])));
+      t[e] = glisy_lane_add(c, c);
+    }
+
+    glisy_lane p[3] = {glisy_lane_load(j->positions->x + i),
+                       glisy_lane_load(j->positions->y + i),
+                       glisy_lane_load(j->positions->z + i)};
+    glisy_lane q[3];
+    glisy_skin_rotate_lanes(q, r, p);
+    glisy_lane_store(j->positions_out->x + i,
+                     glisy_lane_add(p[0], glisy_lane_add(q[0], t[0])));
+    glisy_lane_store(j->positions_out->y + i,
+                     glisy_lane_add(p[1], glisy_lane_add(q[1], t[1])));
+    glisy_lane_store(j->positions_out->z + i,
+                     glisy_lane_add(p[2], glisy_lane_add(q[2], t[2])));
+    if (!j->normals) continue;
+
+    glisy_lane n[3] = {glisy_lane_load(j->normals->x + i),
+                       glisy_lane_load(j->normals->y + i),
+                       glisy_lane_load(j->normals->z + i)};
+    glisy_skin_rotate_lanes(q, r, n);
+    glisy_lane_store(j->normals_out->x + i, glisy_lane_add(n[0], q[0]));
+    glisy_lane_store(j->normals_out->y + i, glisy_lane_add(n[1], q[1]));
+    glisy_lane_store(j->normals_out->z + i, glisy_lane_add(n[2], q[2]));
+  }
+#else
+  if (end > j->positions->count) end = j->positions->count;
+  for (size_t i = begin; i < end; ++i) glisy_skin_dqs_vertex(j, i);
+#endif
+}
+
+/**
+ * Checks and sizes the outputs of a skinning call and runs fn over
+ * its vertices on pool.
+ */
+
+static inline int
+glisy_skin_run (glisy_pool *pool,
+                glisy_parallel_fn fn,
+                glisy_skin_job *j) {
+  size_t count = j->positions->count;
+  if (j->weights->count != count) return -1;
+  if (j->normals && (j->normals->count != count || !j->normals_out)) {
+    return -1;
+  }
+  if (glisy_vec3_soa_resize(j->positions_out, count)) return -1;
+  if (j->normals && glisy_vec3_soa_resize(j->normals_out, count)) return -1;
+  size_t bytes = (j->normals ? 12 : 6) * sizeof(float) +
+                 j->weights->influences * (sizeof(float) + sizeof(uint16_t));
+  glisy_parallel_for(pool, count, bytes, fn, j);
+  return 0;
+}
+
+/**
+ * Skins positions, and normals when not NULL, by the mat3x4 palette
+ * with linear blend skinning into positions_out and normals_out,
+ * which are resized to match. Normals are transformed by the
+ * blended matrix and renormalized, which is exact for rotations and
+ * uniform scale. Outputs may be the inputs. Work is split over the
+ * threads of pool, which may be NULL. Every bone index must be in
+ * palette. Returns 0 on success and -1 when the counts of the
+ * inputs and weights differ or an output cannot grow.
+ */
+
+static inline int
+glisy_skin_lbs (glisy_pool *pool,
+                vec3_soa *positions_out,
+                vec3_soa *normals_out,
+                const vec3_soa *positions,
+                const vec3_soa *normals,
+                const skin_weights *weights,
+                const mat3x4 *palette) {
+  glisy_skin_job j = {positions_out, normals_out, positions, normals,
+                      weights, palette};
+  return glisy_skin_run(pool, glisy_skin_lbs_fn, &j);
+}
+
+/**
+ * Skins like glisy_skin_lbs with dual quaternion skinning: each
+ * vertex blends its bones' dquats, flipping those on the far side
+ * of its first bone's, and normalizes the blend, so joints twist
+ * without the volume loss of LBS. Bones are rigid.
+ */
+
+static inline int
+glisy_skin_dqs (glisy_pool *pool,
+                vec3_soa *positions_out,
+                vec3_soa *normals_out,
+                const vec3_soa *positions,
+                const vec3_soa *normals,
+                const skin_weights *weights,
+                const dquat *palette) {
+  glisy_skin_job j = {positions_out, normals_out, positions, normals,
+                      weights, palette};
+  return glisy_skin_run(pool, glisy_skin_dqs_fn, &j);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
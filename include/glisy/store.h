@@ -0,0 +1,624 @@
+#ifndef GLISY_STORE_H
+#define GLISY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glisy/simd.h>
+#include <glisy/vec2.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/mat2.h>
+#include <glisy/mat3.h>
+#include <glisy/mat4.h>
+#include <glisy/mat3x4.h>
+#include <glisy/trs.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+
+#if defined(_WIN32) && !defined(GLISY_NO_MMAP)
+#define GLISY_NO_MMAP
+#endif
+
+#ifndef GLISY_NO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A binary container for arrays of glisy values, laid out so a
+ * file can be memory mapped and its arrays used in place.
+ *
+ * A file is a 64 byte header, then the data of each section, then
+ * a directory of 64 byte section records. Each section is one named
+ * array of one type, stored either as packed structs (AoS) or as
+ * one float stream per component (SoA) like vec3_soa. Section data
+ * and SoA streams start on GLISY_STORE_ALIGN boundaries, and SoA
+ * streams are zero padded to a multiple of GLISY_SOA_PAD elements,
+ * so views satisfy the alignment the batch kernels want. Values are
+ * stored in the writer's byte order, which the reader checks.
+ *
+ * The header is written last, when the writer is closed, so an
+ * unfinished file is rejected rather than read short.
+ */
+
+#define GLISY_STORE_MAGIC "GLISYBIN"
+#define GLISY_STORE_VERSION 1
+#define GLISY_STORE_BYTE_ORDER 0x01020304u
+#define GLISY_STORE_ALIGN GLISY_SIMD_ALIGN
+#define GLISY_STORE_NAME_MAX 16
+
+/**
+ * Element types.
+ */
+
+#define GLISY_STORE_FLOAT 1
+#define GLISY_STORE_VEC2 2
+#define GLISY_STORE_VEC3 3
+#define GLISY_STORE_VEC4 4
+#define GLISY_STORE_QUAT 5
+#define GLISY_STORE_MAT2 6
+#define GLISY_STORE_MAT3 7
+#define GLISY_STORE_MAT4 8
+#define GLISY_STORE_MAT3X4 9
+#define GLISY_STORE_TRS 10
+#define GLISY_STORE_TYPE_COUNT 11
+
+/**
+ * Section layouts.
+ */
+
+#define GLISY_STORE_AOS 0
+#define GLISY_STORE_SOA 1
+
+/**
+ * On-disk records. Both are 64 bytes.
+ */
+
+typedef struct glisy_store_header glisy_store_header;
+struct glisy_store_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t directory;
+  uint64_t sections;
+  uint64_t size;
+  uint8_t reserved[24];
+};
+
+typedef struct glisy_store_section glisy_store_section;
+struct glisy_store_section {
+  char name[GLISY_STORE_NAME_MAX];
+  uint32_t type;
+  uint32_t layout;
+  uint32_t components;
+  uint32_t alignment;
+  uint64_t count;
+  uint64_t capacity;
+  uint64_t offset;
+  uint64_t size;
+};
+
+/**
+ * Returns the number of floats in one element of type, or 0 for
+ * an unknown type.
+ */
+
+static inline uint32_t
+glisy_store_components (uint32_t type) {
+  static const uint8_t components[GLISY_STORE_TYPE_COUNT] = {
+    0, 1, 2, 3, 4, 4, 4, 9, 16, 12, 10
+  };
+  return type < GLISY_STORE_TYPE_COUNT ? components[type] : 0;
+}
+
+/**
+ * Returns the number of elements each SoA stream holds for count
+ * elements.
+ */
+
+static inline uint64_t
+glisy_store_capacity (uint64_t count) {
+  return (count + GLISY_SOA_PAD - 1) & ~(uint64_t) (GLISY_SOA_PAD - 1);
+}
+
+/**
+ * glisy_store_writer struct type. Streams sections to a file one
+ * at a time, so producers need not know counts in advance. Data
+ * appended to a SoA section is split into component streams; all
+ * but the first are spooled to temporary files until the section
+ * ends. Every function returns 0, or -1 once any write has failed.
+ */
+
+typedef struct glisy_store_writer glisy_store_writer;
+struct glisy_store_writer {
+  FILE *file;
+  FILE *streams[16];
+  glisy_store_section *sections;
+  size_t count;
+  size_t capacity;
+  uint64_t pos;
+  int open;
+  int error;
+};
+
+static inline int
+glisy_store_writer_put (glisy_store_writer *w, FILE *file,
+                        const void *data, size_t size) {
+  if (w->error) return -1;
+  if (size && fwrite(data, 1, size, file) != size) w->error = 1;
+  if (file == w->file) w->pos += size;
+  return w->error ? -1 : 0;
+}
+
+static inline int
+glisy_store_writer_zero (glisy_store_writer *w, FILE *file, uint64_t size) {
+  static const char zero[GLISY_STORE_ALIGN] = {0};
+  while (size && !w->error) {
+    size_t n = size < sizeof(zero) ? (size_t) size : sizeof(zero);
+    glisy_store_writer_put(w, file, zero, n);
+    size -= n;
+  }
+  return w->error ? -1 : 0;
+}
+
+/**
+ * Creates or truncates the file at path for writing.
+ */
+
+static inline int
+glisy_store_writer_open (glisy_store_writer *w, const char *path) {
+  *w = (glisy_store_writer) {0};
+  w->file = fopen(path, "wb");
+  if (!w->file) return -1;
+  // the header is rewritten on close
+  return glisy_store_writer_zero(w, w->file, sizeof(glisy_store_header));
+}
+
+/**
+ * Starts a section called name holding elements of type in layout.
+ * Names longer than GLISY_STORE_NAME_MAX - 1 bytes are rejected.
+ */
+
+static inline int glisy_store_writer_end (glisy_store_writer *w);
+
+static inline int
+glisy_store_writer_begin (glisy_store_writer *w, const char *name,
+                          uint32_t type, uint32_t layout) {
+  uint32_t components = glisy_store_components(type);
+  size_t length = strlen(name);
+  if (w->open && glisy_store_writer_end(w)) return -1;
+  if (!components || layout > GLISY_STORE_SOA ||
+      length >= GLISY_STORE_NAME_MAX || w->error) {
+    return -1;
+  }
+  if (w->count == w->capacity) {
+    size_t capacity = w->capacity ? 2 * w->capacity : 8;
+    glisy_store_section *sections = (glisy_store_section *)
+      realloc(w->sections, capacity * sizeof(*sections));
+    if (!sections) return -1;
+    w->sections = sections;
+    w->capacity = capacity;
+  }
+  if (glisy_store_writer_zero(w, w->file,
+                              -w->pos & (GLISY_STORE_ALIGN - 1))) {
+    return -1;
+  }
+
+  glisy_store_section *s = &w->sections[w->count++];
+  *s = (glisy_store_section) {0};
+  memcpy(s->name, name, length);
+  s->type = type;
+  s->layout = layout;
+  s->components = components;
+  s->alignment = GLISY_STORE_ALIGN;
+  s->offset = w->pos;
+  w->open = 1;
+  return 0;
+}
+
+/**
+ * Appends count elements to the open section. values holds packed
+ * elements of the section type (vec3s for GLISY_STORE_VEC3, and so
+ * on) whatever the section layout.
+ */
+
+static inline int
+glisy_store_writer_append (glisy_store_writer *w, const void *values,
+                           size_t count) {
+  if (!w->open || w->error) return -1;
+  glisy_store_section *s = &w->sections[w->count - 1];
+  const float *in = (const float *) values;
+  uint32_t components = s->components;
+
+  if (GLISY_STORE_AOS == s->layout || 1 == components) {
+    s->count += count;
+    return glisy_store_writer_put(w, w->file, in,
+                                  count * components * sizeof(float));
+  }
+
+  for (uint32_t c = 1; c < components; ++c) {
+    if (!w->streams[c] && !(w->streams[c] = tmpfile())) {
+      w->error = 1;
+      return -1;
+    }
+  }
+  // split in blocks so each stream gets one fwrite per block
+  while (count && !w->error) {
+    float block[256];
+    size_t n = count < 256 ? count : 256;
+    for (uint32_t c = 0; c < components; ++c) {
+      for (size_t i = 0; i < n; ++i) block[i] = in[i * components + c];
+      glisy_store_writer_put(w, c ? w->streams[c] : w->file,
+                             block, n * sizeof(float));
+    }
+    s->count += n;
+    in += n * components;
+    count -= n;
+  }
+  return w->error ? -1 : 0;
+}
+
+/**
+ * Finishes the open section, padding SoA streams and copying in
+ * the spooled ones.
+ */
+
+static inline int
+glisy_store_writer_end (glisy_store_writer *w) {
+  if (!w->open) return w->error ? -1 : 0;
+  glisy_store_section *s = &w->sections[w->count - 1];
+  w->open = 0;
+
+  if (GLISY_STORE_AOS == s->layout) {
+    s->capacity = s->count;
+  } else {
+    s->capacity = glisy_store_capacity(s->count);
+    uint64_t pad = (s->capacity - s->count) * sizeof(float);
+    glisy_store_writer_zero(w, w->file, pad);
+    for (uint32_t c = 1; c < s->components; ++c) {
+      FILE *stream = w->streams[c];
+      w->streams[c] = NULL;
+      if (stream) {
+        char block[4096];
+        size_t n;
+        rewind(stream);
+        while (!w->error && (n = fread(block, 1, sizeof(block), stream))) {
+          glisy_store_writer_put(w, w->file, block, n);
+        }
+        if (ferror(stream)) w->error = 1;
+        fclose(stream);
+      }
+      glisy_store_writer_zero(w, w->file, pad);
+    }
+  }
+  s->size = w->pos - s->offset;
+  return w->error ? -1 : 0;
+}
+
+/**
+ * Writes a whole section from packed elements.
+ */
+
+static inline int
+glisy_store_writer_write (glisy_store_writer *w, const char *name,
+                          uint32_t type, uint32_t layout,
+                          const void *values, size_t count) {
+  if (glisy_store_writer_begin(w, name, type, layout) ||
+      glisy_store_writer_append(w, values, count)) {
+    return -1;
+  }
+  return glisy_store_writer_end(w);
+}
+
+/**
+ * Writes a whole SoA section from separate component arrays of
+ * count floats each, such as the x, y and z of a vec3_soa.
+ */
+
+static inline int
+glisy_store_writer_streams (glisy_store_writer *w, const char *name,
+                            uint32_t type, const float *const *streams,
+                            size_t count) {
+  if (glisy_store_writer_begin(w, name, type, GLISY_STORE_SOA)) return -1;
+  glisy_store_section *s = &w->sections[w->count - 1];
+  uint64_t capacity = glisy_store_capacity(count);
+  w->open = 0;
+  for (uint32_t c = 0; c < s->components; ++c) {
+    glisy_store_writer_put(w, w->file, streams[c], count * sizeof(float));
+    glisy_store_writer_zero(w, w->file, (capacity - count) * sizeof(float));
+  }
+  s->count = count;
+  s->capacity = capacity;
+  s->size = w->pos - s->offset;
+  return w->error ? -1 : 0;
+}
+
+static inline int
+glisy_store_writer_vec3_soa (glisy_store_writer *w, const char *name,
+                             const vec3_soa *a) {
+  const float *streams[3] = {a->x, a->y, a->z};
+  return glisy_store_writer_streams(w, name, GLISY_STORE_VEC3,
+                                    streams, a->count);
+}
+
+static inline int
+glisy_store_writer_quat_soa (glisy_store_writer *w, const char *name,
+                             const quat_soa *a) {
+  const float *streams[4] = {a->x, a->y, a->z, a->w};
+  return glisy_store_writer_streams(w, name, GLISY_STORE_QUAT,
+                                    streams, a->count);
+}
+
+/**
+ * Ends any open section, writes the directory and header, and
+ * closes the file. Returns -1 if anything failed to write, in
+ * which case the file is left without a valid header.
+ */
+
+static inline int
+glisy_store_writer_close (glisy_store_writer *w) {
+  glisy_store_header header = {0};
+  if (!w->file) return -1;
+  glisy_store_writer_end(w);
+  glisy_store_writer_zero(w, w->file, -w->pos & (GLISY_STORE_ALIGN - 1));
+
+  memcpy(header.magic, GLISY_STORE_MAGIC, sizeof(header.magic));
+  header.version = GLISY_STORE_VERSION;
+  header.byte_order = GLISY_STORE_BYTE_ORDER;
+  header.directory = w->pos;
+  header.sections = w->count;
+  glisy_store_writer_put(w, w->file, w->sections,
+                         w->count * sizeof(glisy_store_section));
+  header.size = w->pos;
+
+  if (!w->error && (fflush(w->file) || fseek(w->file, 0, SEEK_SET))) {
+    w->error = 1;
+  }
+  glisy_store_writer_put(w, w->file, &header, sizeof(header));
+  if (fclose(w->file)) w->error = 1;
+  for (size_t c = 0; c < 16; ++c) {
+    if (w->streams[c]) fclose(w->streams[c]);
+  }
+  free(w->sections);
+
+  int error = w->error;
+  *w = (glisy_store_writer) {0};
+  return error ? -1 : 0;
+}
+
+/**
+ * glisy_store struct type. An opened container: a file mapped
+ * copy-on-write, so views may be modified without changing the
+ * file, or caller memory. All views point into data and are valid
+ * until glisy_store_close.
+ */
+
+typedef struct glisy_store glisy_store;
+struct glisy_store {
+  unsigned char *data;
+  size_t size;
+  const glisy_store_section *sections;
+  size_t count;
+  int owned;
+};
+
+/**
+ * Checks the header and directory of size bytes at data and opens
+ * them as store s. The memory is used in place; it must be aligned
+ * to GLISY_STORE_ALIGN and outlive s.
+ */
+
+static inline int
+glisy_store_open_memory (glisy_store *s, void *data, size_t size) {
+  const glisy_store_header *h = (const glisy_store_header *) data;
+  *s = (glisy_store) {0};
+  if ((uintptr_t) data & (GLISY_STORE_ALIGN - 1) ||
+      size < sizeof(*h) ||
+      memcmp(h->magic, GLISY_STORE_MAGIC, sizeof(h->magic)) ||
+      h->version != GLISY_STORE_VERSION ||
+      h->byte_order != GLISY_STORE_BYTE_ORDER ||
+      h->size != size ||
+      h->directory & (GLISY_STORE_ALIGN - 1) ||
+      h->directory < sizeof(*h) || h->directory > size ||
+      h->sections > (size - h->directory) / sizeof(glisy_store_section)) {
+    return -1;
+  }
+
+  const glisy_store_section *sections =
+    (const glisy_store_section *) ((unsigned char *) data + h->directory);
+  for (uint64_t i = 0; i < h->sections; ++i) {
+    const glisy_store_section *e = &sections[i];
+    uint64_t element = (uint64_t) e->components * sizeof(float);
+    uint64_t room = h->directory - e->offset;
+    if (!e->components || e->components != glisy_store_components(e->type) ||
+        e->layout > GLISY_STORE_SOA ||
+        e->name[GLISY_STORE_NAME_MAX - 1] ||
+        e->alignment != GLISY_STORE_ALIGN ||
+        e->offset & (GLISY_STORE_ALIGN - 1) ||
+        e->offset < sizeof(*h) || e->offset > h->directory ||
+        e->count > e->capacity || e->capacity > room / element ||
+        e->size != e->capacity * element) {
+      return -1;
+    }
+    if (GLISY_STORE_AOS == e->layout ? e->capacity != e->count
+                                     : e->capacity % GLISY_SOA_PAD) {
+      return -1;
+    }
+  }
+
+  s->data = (unsigned char *) data;
+  s->size = size;
+  s->sections = sections;
+  s->count = h->sections;
+  return 0;
+}
+
+/**
+ * Opens the container file at path. Returns 0 on success and -1
+ * when the file cannot be read or is not a valid container.
+ */
+
+static inline int
+glisy_store_open (glisy_store *s, const char *path) {
+  void *data;
+  size_t size;
+  *s = (glisy_store) {0};
+#ifndef GLISY_NO_MMAP
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) || st.st_size <= 0) {
+    close(fd);
+    return -1;
+  }
+  size = (size_t) st.st_size;
+  data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == data) return -1;
+  if (glisy_store_open_memory(s, data, size)) {
+    munmap(data, size);
+    return -1;
+  }
+  s->owned = 1;
+#else
+  FILE *file = fopen(path, "rb");
+  long length;
+  if (!file) return -1;
+  if (fseek(file, 0, SEEK_END) || (length = ftell(file)) <= 0 ||
+      fseek(file, 0, SEEK_SET)) {
+    fclose(file);
+    return -1;
+  }
+  size = (size_t) length;
+  data = glisy_simd_alloc(size);
+  if (!data || fread(data, 1, size, file) != size ||
+      glisy_store_open_memory(s, data, size)) {
+    fclose(file);
+    free(data);
+    return -1;
+  }
+  fclose(file);
+  s->owned = 2;
+#endif
+  return 0;
+}
+
+/**
+ * Unmaps or frees what glisy_store_open acquired and empties s.
+ */
+
+static inline void
+glisy_store_close (glisy_store *s) {
+#ifndef GLISY_NO_MMAP
+  if (1 == s->owned) munmap(s->data, s->size);
+#endif
+  if (2 == s->owned) free(s->data);
+  *s = (glisy_store) {0};
+}
+
+/**
+ * Returns the section called name, or NULL.
+ */
+
+static inline const glisy_store_section *
+glisy_store_find (const glisy_store *s, const char *name) {
+  for (size_t i = 0; i < s->count; ++i) {
+    if (0 == strncmp(s->sections[i].name, name, GLISY_STORE_NAME_MAX)) {
+      return &s->sections[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Returns component c of SoA section e, or the packed elements of
+ * AoS section e when c is 0, as floats in place.
+ */
+
+static inline float *
+glisy_store_stream (const glisy_store *s, const glisy_store_section *e,
+                    uint32_t c) {
+  return (float *) (s->data + e->offset) + (size_t) c * e->capacity;
+}
+
+/**
+ * Typed AoS views. Each returns the elements of the section called
+ * name in place and sets *count, or returns NULL when there is no
+ * such section or it holds another type or layout.
+ */
+
+#define GLISY_STORE_VIEW(kind, tag)                                    \
+  static inline kind *                                                 \
+  glisy_store_##kind (const glisy_store *s, const char *name,          \
+                      size_t *count) {                                 \
+    const glisy_store_section *e = glisy_store_find(s, name);          \
+    if (!e || e->type != tag || e->layout != GLISY_STORE_AOS) {        \
+      return NULL;                                                     \
+    }                                                                  \
+    *count = (size_t) e->count;                                        \
+    return (kind *) glisy_store_stream(s, e, 0);                       \
+  }
+
+GLISY_STORE_VIEW(float, GLISY_STORE_FLOAT)
+GLISY_STORE_VIEW(vec2, GLISY_STORE_VEC2)
+GLISY_STORE_VIEW(vec3, GLISY_STORE_VEC3)
+GLISY_STORE_VIEW(vec4, GLISY_STORE_VEC4)
+GLISY_STORE_VIEW(quat, GLISY_STORE_QUAT)
+GLISY_STORE_VIEW(mat2, GLISY_STORE_MAT2)
+GLISY_STORE_VIEW(mat3, GLISY_STORE_MAT3)
+GLISY_STORE_VIEW(mat4, GLISY_STORE_MAT4)
+GLISY_STORE_VIEW(mat3x4, GLISY_STORE_MAT3X4)
+GLISY_STORE_VIEW(trs, GLISY_STORE_TRS)
+
+/**
+ * SoA views. Each points out at the streams of the section called
+ * name and returns 0, or -1 when there is no such vec3 or quat SoA
+ * section. The view can be read and written by the vec3_soa and
+ * quat_soa routines but must not be freed, reserved or resized.
+ */
+
+static inline int
+glisy_store_vec3_soa (const glisy_store *s, const char *name,
+                      vec3_soa *out) {
+  const glisy_store_section *e = glisy_store_find(s, name);
+  if (!e || e->type != GLISY_STORE_VEC3 || e->layout != GLISY_STORE_SOA) {
+    return -1;
+  }
+  out->x = glisy_store_stream(s, e, 0);
+  out->y = glisy_store_stream(s, e, 1);
+  out->z = glisy_store_stream(s, e, 2);
+  out->count = (size_t) e->count;
+  out->capacity = (size_t) e->capacity;
+  return 0;
+}
+
+static inline int
+glisy_store_quat_soa (const glisy_store *s, const char *name,
+                      quat_soa *out) {
+  const glisy_store_section *e = glisy_store_find(s, name);
+  if (!e || e->type != GLISY_STORE_QUAT || e->layout != GLISY_STORE_SOA) {
+    return -1;
+  }
+  out->x = glisy_store_stream(s, e, 0);
+  out->y = glisy_store_stream(s, e, 1);
+  out->z = glisy_store_stream(s, e, 2);
+  out->w = glisy_store_stream(s, e, 3);
+  out->count = (size_t) e->count;
+  out->capacity = (size_t) e->capacity;
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,431 @@
+#ifndef GLISY_TRACK_H
+#define GLISY_TRACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+#include <glisy/trs.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * track_keys struct type. One animation channel: count key times in
+ * strictly increasing order and, for each, a value of three (vec3)
+ * or four (quat) floats. Times and values share one allocation
+ * aligned to GLISY_SIMD_ALIGN.
+ */
+
+typedef struct track_keys track_keys;
+struct track_keys {
+  float *times;
+  float *values;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * track struct type. The translation, rotation and scale channels
+ * of one animated transform. Channels key independently and may be
+ * empty, in which case they sample to the identity value.
+ */
+
+typedef struct track track;
+struct track {
+  track_keys translation;
+  track_keys rotation;
+  track_keys scale;
+};
+
+/**
+ * track_cursor struct type. The key each channel of a track was
+ * last sampled at. Sampling starts its search there, so playback
+ * that moves forward by a key or less per sample steps instead of
+ * searching. Cursors belong to the caller and any cursor is valid
+ * for any track; a stale one only costs a search.
+ */
+
+typedef struct track_cursor track_cursor;
+struct track_cursor {
+  uint32_t translation;
+  uint32_t rotation;
+  uint32_t scale;
+};
+
+/**
+ * track and track_cursor initializers.
+ */
+
+#define track_create() ((track) {0})
+#define track_cursor_create() ((track_cursor) {0})
+
+/**
+ * Keys a cursor steps over before falling back to binary search.
+ */
+
+#define GLISY_TRACK_STEPS 4
+
+/**
+ * Releases the storage of track t and empties it.
+ */
+
+static inline void
+glisy_track_free (track *t) {
+  free(t->translation.times);
+  free(t->rotation.times);
+  free(t->scale.times);
+  *t = (track) {0};
+}
+
+#define track_free(t) glisy_track_free(&(t))
+
+/**
+ * Grows channel k, of values of components floats, to hold at
+ * least capacity keys. Returns 0 on success and -1 when allocation
+ * fails, leaving k unchanged.
+ */
+
+static inline int
+glisy_track_keys_reserve (track_keys *k, size_t capacity, int components) {
+  if (capacity <= k->capacity) return 0;
+  if (capacity < 2 * k->capacity) capacity = 2 * k->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+  // one float of slack lets the batch sampler load any vec3 key as
+  // four floats
+  char *data = (char *) glisy_simd_alloc((capacity * (1 + components) + 1) *
+                                         sizeof(float));
+  if (!data) return -1;
+  track_keys g = *k;
+  g.times = (float *) data;
+  g.values = (float *) data + capacity;
+  g.capacity = capacity;
+  if (k->count) {
+    memcpy(g.times, k->times, k->count * sizeof(float));
+    memcpy(g.values, k->values, k->count * components * sizeof(float));
+  }
+  free(k->times);
+  *k = g;
+  return 0;
+}
+
+/**
+ * Appends a key at time with the components floats at value to
+ * channel k. Returns 0 on success and -1 when time is not after
+ * the last key's or allocation fails.
+ */
+
+static inline int
+glisy_track_keys_push (track_keys *k,
+                       float time,
+                       const float *value,
+                       int components) {
+  if (isnan(time) || (k->count && !(time > k->times[k->count - 1]))) {
+    return -1;
+  }
+  if (glisy_track_keys_reserve(k, k->count + 1, components)) return -1;
+  k->times[k->count] = time;
+  memcpy(k->values + k->count * components, value,
+         components * sizeof(float));
+  k->count++;
+  return 0;
+}
+
+/**
+ * Appends a translation, rotation or scale key to track t. Keys of
+ * a channel must come in increasing time. Return 0 on success and
+ * -1 when time is not after the channel's last key or allocation
+ * fails.
+ */
+
+static inline int
+glisy_track_add_translation (track *t, float time, vec3 v) {
+  return glisy_track_keys_push(&t->translation, time, &v.x, 3);
+}
+
+#define track_add_translation(t, time, v) \
+  glisy_track_add_translation(&(t), (time), (v))
+
+static inline int
+glisy_track_add_rotation (track *t, float time, quat q) {
+  return glisy_track_keys_push(&t->rotation, time, &q.x, 4);
+}
+
+#define track_add_rotation(t, time, q) \
+  glisy_track_add_rotation(&(t), (time), (q))
+
+static inline int
+glisy_track_add_scale (track *t, float time, vec3 v) {
+  return glisy_track_keys_push(&t->scale, time, &v.x, 3);
+}
+
+#define track_add_scale(t, time, v) glisy_track_add_scale(&(t), (time), (v))
+
+/**
+ * Returns the time of the last key of track t, over all channels,
+ * or 0 when it has none.
+ */
+
+static inline float
+glisy_track_duration (const track *t) {
+  float d = 0;
+  const track_keys *k[3] = {&t->translation, &t->rotation, &t->scale};
+  for (int c = 0; c < 3; ++c) {
+    if (k[c]->count && k[c]->times[k[c]->count - 1] > d) {
+      d = k[c]->times[k[c]->count - 1];
+    }
+  }
+  return d;
+}
+
+#define track_duration(t) glisy_track_duration(&(t))
+
+/**
+ * Returns the last key of channel k at or before time, 0 when time
+ * is before the first key, starting from and updating cursor. k
+ * must not be empty. Forward steps of up to GLISY_TRACK_STEPS keys
+ * are walked; longer jumps and any step back binary search the
+ * keys on that side of the cursor.
+ */
+
+static inline size_t
+glisy_track_keys_seek (const track_keys *k, uint32_t *cursor, float time) {
+  size_t i = *cursor < k->count ? *cursor : 0;
+  size_t lo, hi;
+  if (time < k->times[i]) {
+    lo = 0;
+    hi = i;
+  } else {
+    for (int s = 0; s < GLISY_TRACK_STEPS; ++s) {
+      if (i + 1 >= k->count || k->times[i + 1] > time) {
+        *cursor = (uint32_t) i;
+        return i;
+      }
+      ++i;
+    }
+    lo = i;
+    hi = k->count;
+  }
+  // the last key in [lo, hi) at or before time, or lo
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (k->times[mid] <= time) lo = mid;
+    else hi = mid;
+  }
+  *cursor = (uint32_t) lo;
+  return lo;
+}
+
+/**
+ * Finds the keys of non-empty channel k around time and returns
+ * the interpolation parameter between them: i0 and i1 are the same
+ * key, with 0, before the first key, after the last and on a key.
+ */
+
+static inline float
+glisy_track_keys_locate (const track_keys *k,
+                         uint32_t *cursor,
+                         float time,
+                         size_t *i0,
+                         size_t *i1) {
+  size_t i = glisy_track_keys_seek(k, cursor, time);
+  *i0 = *i1 = i;
+  if (i + 1 >= k->count || !(time > k->times[i])) return 0;
+  *i1 = i + 1;
+  return (time - k->times[i]) / (k->times[i + 1] - k->times[i]);
+}
+
+/**
+ * Samples channel k of vec3 values at time, or returns fallback
+ * when it is empty.
+ */
+
+static inline vec3
+glisy_track_keys_vec3 (const track_keys *k,
+                       uint32_t *cursor,
+                       float time,
+                       vec3 fallback) {
+  size_t i0, i1;
+  if (!k->count) return fallback;
+  float t = glisy_track_keys_locate(k, cursor, time, &i0, &i1);
+  const float *a = k->values + 3 * i0, *b = k->values + 3 * i1;
+  return (vec3) {a[0] + t * (b[0] - a[0]),
+                 a[1] + t * (b[1] - a[1]),
+                 a[2] + t * (b[2] - a[2])};
+}
+
+/**
+ * Samples channel k of quat values at time with quat slerp, or
+ * returns the identity when it is empty.
+ */
+
+static inline quat
+glisy_track_keys_quat (const track_keys *k, uint32_t *cursor, float time) {
+  size_t i0, i1;
+  quat q = {0, 0, 0, 1};
+  if (!k->count) return q;
+  float t = glisy_track_keys_locate(k, cursor, time, &i0, &i1);
+  const quat *v = (const quat *) k->values;
+  glisy_quat_slerp_into(&q, &v[i0], &v[i1], t);
+  return q;
+}
+
+/**
+ * Samples track t at time into out, lerping translation and scale
+ * and slerping rotation between the keys around time. Times outside
+ * a channel's keys clamp to its first or last key. cursor is read
+ * and updated.
+ */
+
+static inline void
+glisy_track_sample_into (trs *out,
+                         const track *t,
+                         track_cursor *cursor,
+                         float time) {
+  out->translation = glisy_track_keys_vec3(&t->translation,
+                                           &cursor->translation, time,
+                                           vec3(0, 0, 0));
+  out->rotation = glisy_track_keys_quat(&t->rotation, &cursor->rotation,
+                                        time);
+  out->scale = glisy_track_keys_vec3(&t->scale, &cursor->scale, time,
+                                     vec3(1, 1, 1));
+}
+
+static inline trs
+glisy_track_sample (const track *t, track_cursor *cursor, float time) {
+  trs out;
+  glisy_track_sample_into(&out, t, cursor, time);
+  return out;
+}
+
+#define track_sample(t, cursor, time) \
+  glisy_track_sample(&(t), &(cursor), (time))
+
+#ifdef GLISY_SSE2
+
+/**
+ * Gathers, for the first n of GLISY_LANES tracks and cursors, the
+ * keys around time of channel 0 (translation), 1 (rotation) or 2
+ * (scale) as consecutive vec4s at a and b, and their parameters
+ * into t. A vec3 key's fourth float is the next one's first and is
+ * meant to be ignored. Lanes past n gather zeros, which interpolate
+ * to zero and so keep the padding of SoA outputs zero.
+ */
+
+static inline void
+glisy_track_gather_lanes (float *a,
+                          float *b,
+                          float *t,
+                          const track *tracks,
+                          track_cursor *cursors,
+                          size_t n,
+                          int channel,
+                          float time) {
+  static const float values[4][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 1}, {1, 1, 1, 0}, {0, 0, 0, 0}
+  };
+  static const size_t keys[3] = {
+    offsetof(track, translation),
+    offsetof(track, rotation),
+    offsetof(track, scale)
+  };
+  static const size_t cursor[3] = {
+    offsetof(track_cursor, translation),
+    offsetof(track_cursor, rotation),
+    offsetof(track_cursor, scale)
+  };
+  size_t components = 1 == channel ? 4 : 3;
+  for (size_t j = 0; j < GLISY_LANES; ++j) {
+    const float *va = values[3], *vb = values[3];
+    t[j] = 0;
+    if (j < n) {
+      const track_keys *k = (const track_keys *)
+        ((const char *) &tracks[j] + keys[channel]);
+      va = vb = values[channel];
+      if (k->count) {
+        size_t i0, i1;
+        uint32_t *c = (uint32_t *) ((char *) &cursors[j] + cursor[channel]);
+        t[j] = glisy_track_keys_locate(k, c, time, &i0, &i1);
+        va = k->values + components * i0;
+        vb = k->values + components * i1;
+      }
+    }
+    _mm_storeu_ps(a + 4 * j, _mm_loadu_ps(va));
+    _mm_storeu_ps(b + 4 * j, _mm_loadu_ps(vb));
+  }
+}
+#endif
+
+/**
+ * Samples count tracks at one time into SoA streams ready for
+ * blending: element i of translation, rotation and scale is track
+ * i at time, as glisy_track_sample gives it, and cursors[i] is its
+ * cursor. The outputs are resized to count. Key lookup is per
+ * track; the interpolation runs a register of tracks at a time.
+ * Returns 0 on success and -1 when resizing an output fails.
+ */
+
+static inline int
+glisy_track_sample_batch (vec3_soa *translation,
+                          quat_soa *rotation,
+                          vec3_soa *scale,
+                          const track *tracks,
+                          track_cursor *cursors,
+                          size_t count,
+                          float time) {
+  if (glisy_vec3_soa_resize(translation, count) ||
+      glisy_quat_soa_resize(rotation, count) ||
+      glisy_vec3_soa_resize(scale, count)) {
+    return -1;
+  }
+#ifdef GLISY_SSE2
+  float a[4 * GLISY_LANES], b[4 * GLISY_LANES], t[GLISY_LANES];
+  for (size_t i = 0; i < count; i += GLISY_LANES) {
+    size_t n = count - i < GLISY_LANES ? count - i : GLISY_LANES;
+    vec3_soa *v[2] = {translation, scale};
+    glisy_lane q[4], r[4];
+    for (int c = 0; c < 2; ++c) {
+      glisy_track_gather_lanes(a, b, t, tracks + i, cursors + i, n,
+                               2 * c, time);
+      glisy_lane vt = glisy_lane_load(t);
+      glisy_vec4_load_lanes(a, &q[0], &q[1], &q[2], &q[3]);
+      glisy_vec4_load_lanes(b, &r[0], &r[1], &r[2], &r[3]);
+      glisy_lane_store(v[c]->x + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[0], q[0]), q[0]));
+      glisy_lane_store(v[c]->y + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[1], q[1]), q[1]));
+      glisy_lane_store(v[c]->z + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[2], q[2]), q[2]));
+    }
+
+    glisy_track_gather_lanes(a, b, t, tracks + i, cursors + i, n, 1, time);
+    glisy_vec4_load_lanes(a, &q[0], &q[1], &q[2], &q[3]);
+    glisy_vec4_load_lanes(b, &r[0], &r[1], &r[2], &r[3]);
+    glisy_quat_slerp_lanes(q, r, glisy_lane_load(t));
+    glisy_lane_store(rotation->x + i, q[0]);
+    glisy_lane_store(rotation->y + i, q[1]);
+    glisy_lane_store(rotation->z + i, q[2]);
+    glisy_lane_store(rotation->w + i, q[3]);
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    trs s;
+    glisy_track_sample_into(&s, &tracks[i], &cursors[i], time);
+    glisy_vec3_soa_set(translation, i, s.translation);
+    glisy_quat_soa_set(rotation, i, s.rotation);
+    glisy_vec3_soa_set(scale, i, s.scale);
+  }
+#endif
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,772 @@
+#ifndef GLISY_TRACK_COMPRESS_H
+#define GLISY_TRACK_COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/quat.h>
+#include <glisy/trs.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+#include <glisy/quat_pack.h>
+#include <glisy/parallel.h>
+#include <glisy/track.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Offline keyframe reduction of tracks into a compact clip, and
+ * sampling of the clip at runtime.
+ *
+ * Each channel keeps only the keys needed to rebuild every input
+ * key within a tolerance, by lerp (vec3) or slerp (quat) between
+ * the kept keys, the same way glisy_track_sample does. Kept values
+ * are quantized when the quantization error fits in half the
+ * tolerance: vec3s to 16 bits per component over the channel's
+ * range and quats to quat48. Reduction measures error on the
+ * quantized values, so the tolerance holds for what the clip
+ * decodes, not just for the key selection.
+ */
+
+/**
+ * track_tolerance flags. GLISY_TRACK_FIT lets a kept key take a
+ * least squares fitted value instead of its input value when that
+ * keeps a longer span of input keys within tolerance.
+ */
+
+#define GLISY_TRACK_FIT 1
+
+/**
+ * track_tolerance struct type. The largest error allowed at any
+ * input key: distance for translation and scale, in the units of
+ * the data, and angle in degrees for rotation.
+ */
+
+typedef struct track_tolerance track_tolerance;
+struct track_tolerance {
+  float translation;
+  float rotation;
+  float scale;
+  int flags;
+};
+
+#define track_tolerance_create() \
+  ((track_tolerance) {0.0005f, 0.05f, 0.0001f, GLISY_TRACK_FIT})
+
+/**
+ * Key value formats of a clip channel.
+ */
+
+#define GLISY_TRACK_CLIP_VEC3 0
+#define GLISY_TRACK_CLIP_VEC3_U16 1
+#define GLISY_TRACK_CLIP_QUAT 2
+#define GLISY_TRACK_CLIP_QUAT48 3
+
+/**
+ * track_clip_channel struct type. count keys whose times, as
+ * floats, start offset bytes into the clip data and whose values,
+ * in format, follow. A GLISY_TRACK_CLIP_VEC3_U16 value decodes to
+ * origin + step * value per component.
+ */
+
+typedef struct track_clip_channel track_clip_channel;
+struct track_clip_channel {
+  uint32_t offset;
+  uint32_t count;
+  uint32_t format;
+  float origin[3];
+  float step[3];
+};
+
+/**
+ * track_clip struct type. The channels of count tracks in one
+ * allocation: 3 * count track_clip_channel records, translation,
+ * rotation and scale of track 0 first, then the key data of every
+ * channel in the same order. Channels refer to their keys by
+ * offset, so the data can be copied, stored and mapped as is.
+ * error holds the worst error the compressor measured for each of
+ * translation, rotation and scale.
+ */
+
+typedef struct track_clip track_clip;
+struct track_clip {
+  unsigned char *data;
+  size_t size;
+  size_t count;
+  float error[3];
+};
+
+#define track_clip_create() ((track_clip) {0})
+
+/**
+ * Releases the storage of clip and empties it.
+ */
+
+static inline void
+glisy_track_clip_free (track_clip *clip) {
+  free(clip->data);
+  *clip = (track_clip) {0};
+}
+
+#define track_clip_free(clip) glisy_track_clip_free(&(clip))
+
+/**
+ * Returns the bytes of one value in format.
+ */
+
+static inline size_t
+glisy_track_clip_stride (uint32_t format) {
+  switch (format) {
+    case GLISY_TRACK_CLIP_VEC3: return 3 * sizeof(float);
+    case GLISY_TRACK_CLIP_QUAT: return 4 * sizeof(float);
+    default: return 3 * sizeof(uint16_t);
+  }
+}
+
+/**
+ * Encodes the three or four floats at v into value p of channel h.
+ */
+
+static inline void
+glisy_track_clip_encode (const track_clip_channel *h,
+                         unsigned char *p,
+                         const float *v) {
+  if (GLISY_TRACK_CLIP_VEC3_U16 == h->format) {
+    uint16_t q[3];
+    for (int c = 0; c < 3; ++c) {
+      float f = h->step[c] > 0 ? (v[c] - h->origin[c]) / h->step[c] : 0;
+      f = f < 0 ? 0 : f > 65535 ? 65535 : f;
+      q[c] = (uint16_t) (f + 0.5f);
+    }
+    memcpy(p, q, sizeof(q));
+  } else if (GLISY_TRACK_CLIP_QUAT48 == h->format) {
+    quat48 e = glisy_quat48_encode((quat) {v[0], v[1], v[2], v[3]});
+    memcpy(p, &e, sizeof(e));
+  } else {
+    memcpy(p, v, glisy_track_clip_stride(h->format));
+  }
+}
+
+/**
+ * Decodes value p of channel h into the three or four floats at v.
+ */
+
+static inline void
+glisy_track_clip_decode (const track_clip_channel *h,
+                         const unsigned char *p,
+                         float *v) {
+  if (GLISY_TRACK_CLIP_VEC3_U16 == h->format) {
+    uint16_t q[3];
+    memcpy(q, p, sizeof(q));
+    for (int c = 0; c < 3; ++c) v[c] = h->origin[c] + h->step[c] * q[c];
+  } else if (GLISY_TRACK_CLIP_QUAT48 == h->format) {
+    quat48 e;
+    memcpy(&e, p, sizeof(e));
+    quat q = glisy_quat48_decode(e);
+    memcpy(v, &q, sizeof(q));
+  } else if (GLISY_TRACK_CLIP_QUAT == h->format) {
+    memcpy(v, p, 4 * sizeof(float));
+  } else {
+    memcpy(v, p, 3 * sizeof(float));
+  }
+}
+
+/**
+ * Returns the error between values a and b of a channel in format:
+ * their distance for vec3s and the angle between them in degrees
+ * for quats.
+ */
+
+static inline float
+glisy_track_clip_error (uint32_t format, const float *a, const float *b) {
+  if (format >= GLISY_TRACK_CLIP_QUAT) {
+    return glisy_quat_error_degrees((quat) {a[0], a[1], a[2], a[3]},
+                                    (quat) {b[0], b[1], b[2], b[3]});
+  }
+  float x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+  return sqrtf(x * x + y * y + z * z);
+}
+
+/**
+ * Interpolates values a and b of a channel in format by t into out
+ * as sampling does: lerp for vec3s and quat slerp for quats.
+ */
+
+static inline void
+glisy_track_clip_interpolate (uint32_t format,
+                              float *out,
+                              const float *a,
+                              const float *b,
+                              float t) {
+  if (format >= GLISY_TRACK_CLIP_QUAT) {
+    glisy_quat_slerp_into((quat *) out, (const quat *) a,
+                          (const quat *) b, t);
+    return;
+  }
+  for (int c = 0; c < 3; ++c) out[c] = a[c] + t * (b[c] - a[c]);
+}
+
+/**
+ * The reduced keys of one channel while a clip is built.
+ */
+
+typedef struct glisy_track_clip_part glisy_track_clip_part;
+struct glisy_track_clip_part {
+  track_clip_channel header;
+  float *times;
+  unsigned char *values;
+  float error;
+  int failed;
+};
+
+/**
+ * Returns the worst error over input keys (a, j] of channel k when
+ * they are rebuilt from kept values va at key a and vb at key j.
+ */
+
+static inline float
+glisy_track_clip_span_error (const track_keys *k,
+                             uint32_t format,
+                             size_t a,
+                             size_t j,
+                             const float *va,
+                             const float *vb) {
+  size_t components = format >= GLISY_TRACK_CLIP_QUAT ? 4 : 3;
+  float worst = glisy_track_clip_error(format, vb,
+                                       k->values + components * j);
+  float v[4];
+  for (size_t i = a + 1; i < j; ++i) {
+    float t = (k->times[i] - k->times[a]) / (k->times[j] - k->times[a]);
+    glisy_track_clip_interpolate(format, v, va, vb, t);
+    float e = glisy_track_clip_error(format, v, k->values + components * i);
+    if (e > worst) worst = e;
+  }
+  return worst;
+}
+
+/**
+ * Fits the value at key j that, lerped from kept value va at key a,
+ * best matches input keys (a, j] in the least squares sense, and
+ * writes it into out as channel h encodes it. Quats are fitted
+ * componentwise on the side of va and normalized.
+ */
+
+static inline void
+glisy_track_clip_fit (const track_keys *k,
+                      const track_clip_channel *h,
+                      size_t a,
+                      size_t j,
+                      const float *va,
+                      float *out) {
+  size_t components = h->format >= GLISY_TRACK_CLIP_QUAT ? 4 : 3;
+  double sum[4] = {0, 0, 0, 0}, uu = 0;
+  unsigned char p[4 * sizeof(float)];
+  for (size_t i = a + 1; i <= j; ++i) {
+    const float *v = k->values + components * i;
+    double u = (k->times[i] - k->times[a]) / (k->times[j] - k->times[a]);
+    double sign = 1, dot = 0;
+    for (size_t c = 0; c < components; ++c) dot += (double) v[c] * va[c];
+    if (components == 4 && dot < 0) sign = -1;
+    for (size_t c = 0; c < components; ++c) {
+      sum[c] += u * (sign * v[c] - va[c]);
+    }
+    uu += u * u;
+  }
+  for (size_t c = 0; c < components; ++c) {
+    out[c] = (float) (va[c] + sum[c] / uu);
+  }
+  if (components == 4) {
+    glisy_quat_normalize_into((quat *) out, (const quat *) out);
+  }
+  glisy_track_clip_encode(h, p, out);
+  glisy_track_clip_decode(h, p, out);
+}
+
+/**
+ * Writes into vb the value to keep at key j after kept value va at
+ * key a: its input value or, with GLISY_TRACK_FIT, its fitted value
+ * when that rebuilds keys (a, j] better. Returns the worst error.
+ */
+
+static inline float
+glisy_track_clip_candidate (const track_keys *k,
+                            const track_clip_channel *h,
+                            size_t a,
+                            size_t j,
+                            const float *va,
+                            int flags,
+                            float *vb) {
+  size_t components = h->format >= GLISY_TRACK_CLIP_QUAT ? 4 : 3;
+  unsigned char p[4 * sizeof(float)];
+  float fit[4];
+  glisy_track_clip_encode(h, p, k->values + components * j);
+  glisy_track_clip_decode(h, p, vb);
+  float e = glisy_track_clip_span_error(k, h->format, a, j, va, vb);
+  if (flags & GLISY_TRACK_FIT) {
+    glisy_track_clip_fit(k, h, a, j, va, fit);
+    float f = glisy_track_clip_span_error(k, h->format, a, j, va, fit);
+    if (f < e) {
+      e = f;
+      memcpy(vb, fit, sizeof(fit));
+    }
+  }
+  return e;
+}
+
+/**
+ * Reduces channel k, of quats when rotation is non-zero, into part
+ * within tolerance. Keys are kept greedily: from each kept key the
+ * next is an input key that still rebuilds every key in between
+ * within tolerance, from its input value or, with GLISY_TRACK_FIT,
+ * its fitted value. The end key is found by galloping out from the
+ * kept key and then bisecting, so a span of m keys costs O(m log m)
+ * rather than O(m^2) error evaluations.
+ */
+
+static inline void
+glisy_track_clip_reduce (glisy_track_clip_part *part,
+                         const track_keys *k,
+                         int rotation,
+                         float tolerance,
+                         int flags) {
+  track_clip_channel *h = &part->header;
+  size_t n = k->count, components = rotation ? 4 : 3;
+  memset(part, 0, sizeof(*part));
+  if (!n) return;
+
+  if (rotation) {
+    h->format = glisy_quat48_error_bound() <= 0.5f * tolerance ?
+                GLISY_TRACK_CLIP_QUAT48 : GLISY_TRACK_CLIP_QUAT;
+  } else {
+    float lo[3], hi[3], e = 0;
+    for (int c = 0; c < 3; ++c) lo[c] = hi[c] = k->values[c];
+    for (size_t i = 1; i < n; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        float v = k->values[3 * i + c];
+        lo[c] = v < lo[c] ? v : lo[c];
+        hi[c] = v > hi[c] ? v : hi[c];
+      }
+    }
+    for (int c = 0; c < 3; ++c) {
+      h->origin[c] = lo[c];
+      h->step[c] = (hi[c] - lo[c]) / 65535;
+      // half a step, and a float ulp of the decoded value
+      float half = 0.5f * h->step[c] +
+                   fmaxf(fabsf(lo[c]), fabsf(hi[c])) * 0x1p-23f;
+      e += half * half;
+    }
+    h->format = sqrtf(e) <= 0.5f * tolerance ?
+                GLISY_TRACK_CLIP_VEC3_U16 : GLISY_TRACK_CLIP_VEC3;
+  }
+
+  size_t stride = glisy_track_clip_stride(h->format);
+  part->times = (float *) malloc(n * sizeof(float));
+  part->values = (unsigned char *) malloc(n * stride);
+  if (!part->times || !part->values) {
+    part->failed = 1;
+    return;
+  }
+
+  // the first key's value as the clip will decode it
+  float va[4], vb[4], best[4];
+  unsigned char p[4 * sizeof(float)];
+  glisy_track_clip_encode(h, p, k->values);
+  glisy_track_clip_decode(h, p, va);
+  part->times[0] = k->times[0];
+  memcpy(part->values, p, stride);
+  h->count = 1;
+
+  // a constant channel needs only that key
+  float worst = 0;
+  for (size_t i = 0; i < n; ++i) {
+    float e = glisy_track_clip_error(h->format, va,
+                                     k->values + components * i);
+    if (e > worst) worst = e;
+  }
+  if (worst <= tolerance) {
+    part->error = worst;
+    return;
+  }
+
+  size_t a = 0;
+  while (a + 1 < n) {
+    size_t end = a + 1, fail = n;
+    float error = glisy_track_clip_candidate(k, h, a, end, va, flags, best);
+    // end passes and fail does not, or is past the last key
+    for (size_t step = 1; end + step < n; step *= 2) {
+      float e = glisy_track_clip_candidate(k, h, a, end + step, va, flags, vb);
+      if (e > tolerance) {
+        fail = end + step;
+        break;
+      }
+      end += step;
+      error = e;
+      memcpy(best, vb, sizeof(best));
+    }
+    while (fail - end > 1) {
+      size_t j = end + (fail - end) / 2;
+      float e = glisy_track_clip_candidate(k, h, a, j, va, flags, vb);
+      if (e > tolerance) {
+        fail = j;
+        continue;
+      }
+      end = j;
+      error = e;
+      memcpy(best, vb, sizeof(best));
+    }
+    glisy_track_clip_encode(h, part->values + h->count * stride, best);
+    part->times[h->count++] = k->times[end];
+    if (error > part->error) part->error = error;
+    memcpy(va, best, sizeof(best));
+    a = end;
+  }
+}
+
+/**
+ * Tracks [begin, end) of glisy_track_compress. The loop runs with a
+ * grain of one track, so even a few tracks spread over every
+ * thread.
+ */
+
+typedef struct glisy_track_clip_job glisy_track_clip_job;
+struct glisy_track_clip_job {
+  glisy_track_clip_part *parts;
+  const track *tracks;
+  const track_tolerance *tolerance;
+};
+
+static inline void
+glisy_track_clip_reduce_fn (void *ctx, size_t begin, size_t end,
+                            unsigned worker) {
+  glisy_track_clip_job *j = (glisy_track_clip_job *) ctx;
+  const track_tolerance *tol = j->tolerance;
+  (void) worker;
+  for (size_t i = begin; i < end; ++i) {
+    glisy_track_clip_part *part = j->parts + 3 * i;
+    glisy_track_clip_reduce(&part[0], &j->tracks[i].translation, 0,
+                            tol->translation, tol->flags);
+    glisy_track_clip_reduce(&part[1], &j->tracks[i].rotation, 1,
+                            tol->rotation, tol->flags);
+    glisy_track_clip_reduce(&part[2], &j->tracks[i].scale, 0,
+                            tol->scale, tol->flags);
+  }
+}
+
+/**
+ * Compresses count tracks into clip within tolerance, spreading
+ * the tracks over the threads of pool, which may be NULL to run on
+ * the calling thread. The result does not depend on the pool.
+ * Returns 0 on success and -1 when allocation fails or the clip
+ * would exceed 4 GiB, leaving clip empty.
+ */
+
+static inline int
+glisy_track_compress (glisy_pool *pool,
+                      track_clip *clip,
+                      const track *tracks,
+                      size_t count,
+                      const track_tolerance *tolerance) {
+  glisy_track_clip_part *parts =
+    (glisy_track_clip_part *) calloc(3 * count + 1, sizeof(*parts));
+  glisy_track_clip_job job = {parts, tracks, tolerance};
+  size_t size = 3 * count * sizeof(track_clip_channel);
+  int failed = !parts;
+  *clip = (track_clip) {0};
+  if (parts) {
+    glisy_parallel_for_grain(pool, count, 1,
+                             glisy_track_clip_reduce_fn, &job);
+  }
+
+  for (size_t i = 0; !failed && i < 3 * count; ++i) {
+    const track_clip_channel *h = &parts[i].header;
+    size_t stride = glisy_track_clip_stride(h->format);
+    failed = parts[i].failed;
+    parts[i].header.offset = (uint32_t) size;
+    size += h->count * sizeof(float);
+    size += (h->count * stride + 3) & ~(size_t) 3;
+    if (size > UINT32_MAX) failed = 1;
+  }
+  if (!failed) {
+    clip->data = (unsigned char *) glisy_simd_alloc(size);
+    failed = !clip->data;
+  }
+
+  if (!failed) {
+    track_clip_channel *channels = (track_clip_channel *) clip->data;
+    clip->size = size;
+    clip->count = count;
+    memset(clip->data, 0, size);
+    for (size_t i = 0; i < 3 * count; ++i) {
+      const glisy_track_clip_part *part = &parts[i];
+      const track_clip_channel *h = &part->header;
+      unsigned char *keys = clip->data + h->offset;
+      channels[i] = *h;
+      if (h->count) {
+        memcpy(keys, part->times, h->count * sizeof(float));
+        memcpy(keys + h->count * sizeof(float), part->values,
+               h->count * glisy_track_clip_stride(h->format));
+      }
+      if (part->error > clip->error[i % 3]) {
+        clip->error[i % 3] = part->error;
+      }
+    }
+  }
+
+  for (size_t i = 0; parts && i < 3 * count; ++i) {
+    free(parts[i].times);
+    free(parts[i].values);
+  }
+  free(parts);
+  if (failed) {
+    glisy_track_clip_free(clip);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Finds the keys of channel c (0 translation, 1 rotation, 2 scale)
+ * of track index of clip around time, starting from and updating
+ * cursor. Points h at the channel and a and b at the encoded values
+ * of the keys, and returns the interpolation parameter between
+ * them as glisy_track_keys_locate does, or -1 when the channel is
+ * empty.
+ */
+
+static inline float
+glisy_track_clip_find (const track_clip *clip,
+                       size_t index,
+                       int c,
+                       uint32_t *cursor,
+                       float time,
+                       const track_clip_channel **h,
+                       const unsigned char **a,
+                       const unsigned char **b) {
+  const track_clip_channel *ch =
+    (const track_clip_channel *) clip->data + 3 * index + c;
+  if (!ch->count) return -1;
+  const unsigned char *keys = clip->data + ch->offset;
+  const unsigned char *values = keys + ch->count * sizeof(float);
+  size_t stride = glisy_track_clip_stride(ch->format), i0, i1;
+  track_keys k = {(float *) keys, NULL, ch->count, ch->count};
+  float t = glisy_track_keys_locate(&k, cursor, time, &i0, &i1);
+  *h = ch;
+  *a = values + i0 * stride;
+  *b = values + i1 * stride;
+  return t;
+}
+
+/**
+ * Finds the keys of channel c as glisy_track_clip_find does and
+ * decodes them into a and b.
+ */
+
+static inline float
+glisy_track_clip_locate (const track_clip *clip,
+                         size_t index,
+                         int c,
+                         uint32_t *cursor,
+                         float time,
+                         float *a,
+                         float *b) {
+  const track_clip_channel *h;
+  const unsigned char *pa, *pb;
+  float t = glisy_track_clip_find(clip, index, c, cursor, time, &h,
+                                  &pa, &pb);
+  if (t < 0) return t;
+  glisy_track_clip_decode(h, pa, a);
+  if (pb == pa) memcpy(b, a, 4 * sizeof(float));
+  else glisy_track_clip_decode(h, pb, b);
+  return t;
+}
+
+/**
+ * Samples track index of clip at time into out, as
+ * glisy_track_sample samples the track it was compressed from.
+ * cursor is read and updated.
+ */
+
+static inline void
+glisy_track_clip_sample_into (trs *out,
+                              const track_clip *clip,
+                              size_t index,
+                              track_cursor *cursor,
+                              float time) {
+  float a[4], b[4], t;
+  out->translation = vec3(0, 0, 0);
+  out->rotation = quat(0, 0, 0, 1);
+  out->scale = vec3(1, 1, 1);
+  t = glisy_track_clip_locate(clip, index, 0, &cursor->translation, time,
+                              a, b);
+  if (t >= 0) {
+    glisy_track_clip_interpolate(GLISY_TRACK_CLIP_VEC3,
+                                 &out->translation.x, a, b, t);
+  }
+  t = glisy_track_clip_locate(clip, index, 1, &cursor->rotation, time,
+                              a, b);
+  if (t >= 0) {
+    glisy_track_clip_interpolate(GLISY_TRACK_CLIP_QUAT,
+                                 &out->rotation.x, a, b, t);
+  }
+  t = glisy_track_clip_locate(clip, index, 2, &cursor->scale, time, a, b);
+  if (t >= 0) {
+    glisy_track_clip_interpolate(GLISY_TRACK_CLIP_VEC3,
+                                 &out->scale.x, a, b, t);
+  }
+}
+
+static inline trs
+glisy_track_clip_sample (const track_clip *clip,
+                         size_t index,
+                         track_cursor *cursor,
+                         float time) {
+  trs out;
+  glisy_track_clip_sample_into(&out, clip, index, cursor, time);
+  return out;
+}
+
+#define track_clip_sample(clip, index, cursor, time) \
+  glisy_track_clip_sample(&(clip), (index), &(cursor), (time))
+
+#ifdef GLISY_SSE2
+
+/**
+ * Decodes, for the tracks from index of clip, the keys around time
+ * of channel c as consecutive vec4s at a and b and their parameters
+ * into t, like glisy_track_gather_lanes. Lanes past count gather
+ * zeros. quat48 keys are gathered packed and decoded a register at
+ * a time.
+ */
+
+static inline void
+glisy_track_clip_gather_lanes (float *a,
+                               float *b,
+                               float *t,
+                               const track_clip *clip,
+                               size_t index,
+                               track_cursor *cursors,
+                               int c,
+                               float time) {
+  static const float values[4][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 1}, {1, 1, 1, 0}, {0, 0, 0, 0}
+  };
+  static const size_t cursor[3] = {
+    offsetof(track_cursor, translation),
+    offsetof(track_cursor, rotation),
+    offsetof(track_cursor, scale)
+  };
+  quat48 pa[GLISY_LANES] = {{{0}}}, pb[GLISY_LANES] = {{{0}}};
+  unsigned packed = 0;
+  for (size_t j = 0; j < GLISY_LANES; ++j) {
+    const track_clip_channel *h;
+    const unsigned char *ka, *kb;
+    float *va = a + 4 * j, *vb = b + 4 * j;
+    t[j] = -1;
+    if (index + j < clip->count) {
+      uint32_t *k = (uint32_t *) ((char *) &cursors[j] + cursor[c]);
+      t[j] = glisy_track_clip_find(clip, index + j, c, k, time, &h,
+                                   &ka, &kb);
+    }
+    if (t[j] < 0) {
+      const float *v = values[index + j < clip->count ? c : 3];
+      memcpy(va, v, sizeof(values[0]));
+      memcpy(vb, v, sizeof(values[0]));
+      t[j] = 0;
+    } else if (GLISY_TRACK_CLIP_QUAT48 == h->format) {
+      memcpy(&pa[j], ka, sizeof(quat48));
+      memcpy(&pb[j], kb, sizeof(quat48));
+      packed |= 1u << j;
+    } else {
+      glisy_track_clip_decode(h, ka, va);
+      glisy_track_clip_decode(h, kb, vb);
+    }
+  }
+  if (packed == (1u << GLISY_LANES) - 1) {
+    glisy_quat48_decode_batch((quat *) a, pa, GLISY_LANES);
+    glisy_quat48_decode_batch((quat *) b, pb, GLISY_LANES);
+  } else if (packed) {
+    quat qa[GLISY_LANES], qb[GLISY_LANES];
+    glisy_quat48_decode_batch(qa, pa, GLISY_LANES);
+    glisy_quat48_decode_batch(qb, pb, GLISY_LANES);
+    for (size_t j = 0; j < GLISY_LANES; ++j) {
+      if (packed & 1u << j) {
+        memcpy(a + 4 * j, &qa[j], sizeof(quat));
+        memcpy(b + 4 * j, &qb[j], sizeof(quat));
+      }
+    }
+  }
+}
+#endif
+
+/**
+ * Samples every track of clip at one time into SoA streams, as
+ * glisy_track_sample_batch does for tracks: element i is track i
+ * and cursors[i] its cursor. The outputs are resized to the track
+ * count. Returns 0 on success and -1 when resizing an output fails.
+ */
+
+static inline int
+glisy_track_clip_sample_batch (vec3_soa *translation,
+                               quat_soa *rotation,
+                               vec3_soa *scale,
+                               const track_clip *clip,
+                               track_cursor *cursors,
+                               float time) {
+  size_t count = clip->count;
+  if (glisy_vec3_soa_resize(translation, count) ||
+      glisy_quat_soa_resize(rotation, count) ||
+      glisy_vec3_soa_resize(scale, count)) {
+    return -1;
+  }
+#ifdef GLISY_SSE2
+  float a[4 * GLISY_LANES] GLISY_ALIGN(GLISY_SIMD_ALIGN);
+  float b[4 * GLISY_LANES] GLISY_ALIGN(GLISY_SIMD_ALIGN);
+  float t[GLISY_LANES];
+  for (size_t i = 0; i < count; i += GLISY_LANES) {
+    vec3_soa *v[2] = {translation, scale};
+    glisy_lane q[4], r[4];
+    for (int c = 0; c < 2; ++c) {
+      glisy_track_clip_gather_lanes(a, b, t, clip, i, cursors + i, 2 * c,
+                                    time);
+      glisy_lane vt = glisy_lane_load(t);
+      glisy_vec4_load_lanes(a, &q[0], &q[1], &q[2], &q[3]);
+      glisy_vec4_load_lanes(b, &r[0], &r[1], &r[2], &r[3]);
+      glisy_lane_store(v[c]->x + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[0], q[0]), q[0]));
+      glisy_lane_store(v[c]->y + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[1], q[1]), q[1]));
+      glisy_lane_store(v[c]->z + i, glisy_lane_madd(vt,
+        glisy_lane_sub(r[2], q[2]), q[2]));
+    }
+
+    glisy_track_clip_gather_lanes(a, b, t, clip, i, cursors + i, 1, time);
+    glisy_vec4_load_lanes(a, &q[0], &q[1], &q[2], &q[3]);
+    glisy_vec4_load_lanes(b, &r[0], &r[1], &r[2], &r[3]);
+    glisy_quat_slerp_lanes(q, r, glisy_lane_load(t));
+    glisy_lane_store(rotation->x + i, q[0]);
+    glisy_lane_store(rotation->y + i, q[1]);
+    glisy_lane_store(rotation->z + i, q[2]);
+    glisy_lane_store(rotation->w + i, q[3]);
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    trs s;
+    glisy_track_clip_sample_into(&s, clip, i, &cursors[i], time);
+    glisy_vec3_soa_set(translation, i, s.translation);
+    glisy_quat_soa_set(rotation, i, s.rotation);
+    glisy_vec3_soa_set(scale, i, s.scale);
+  }
+#endif
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,544 @@
+#ifndef GLISY_TRS_H
+#define GLISY_TRS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/vec3.h>
+#include <glisy/quat.h>
+#include <glisy/mat4.h>
+#include <glisy/mat3x4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * trs struct type. A 40 byte transform that scales by scale, then
+ * rotates by the unit quat rotation, then translates by
+ * translation. It converts to the mat4 built by mat4_from_quat,
+ * setting the translation row and mat4_scale.
+ */
+
+typedef struct trs trs;
+struct trs {
+  vec3 translation;
+  quat rotation;
+  vec3 scale;
+};
+
+/**
+ * trs initializers.
+ */
+
+#define trs_create() trs({0, 0, 0}, {0, 0, 0, 1}, {1, 1, 1})
+
+#define trs(...) ((trs){ __VA_ARGS__ })
+
+/**
+ * Rotates v by unit quat q with two cross products instead of
+ * the four quat multiplies of vec4_transform_quat.
+ */
+
+static inline vec3
+glisy_trs_rotate (const quat *q, vec3 v) {
+  float ux = q->y * v.z - q->z * v.y;
+  float uy = q->z * v.x - q->x * v.z;
+  float uz = q->x * v.y - q->y * v.x;
+  float vx = q->y * uz - q->z * uy;
+  float vy = q->z * ux - q->x * uz;
+  float vz = q->x * uy - q->y * ux;
+  return (vec3) {
+    v.x + 2 * (q->w * ux + vx),
+    v.y + 2 * (q->w * uy + vy),
+    v.z + 2 * (q->w * uz + vz)
+  };
+}
+
+/**
+ * Transforms point v by trs a.
+ */
+
+static inline void
+glisy_trs_transform_point_into (vec3 *out, const trs *a, const vec3 *v) {
+  vec3 p = glisy_trs_rotate(&a->rotation, (vec3) {v->x * a->scale.x,
+                                                  v->y * a->scale.y,
+                                                  v->z * a->scale.z});
+  *out = (vec3) {p.x + a->translation.x,
+                 p.y + a->translation.y,
+                 p.z + a->translation.z};
+}
+
+static inline vec3
+glisy_trs_transform_point (trs a, vec3 v) {
+  vec3 out;
+  glisy_trs_transform_point_into(&out, &a, &v);
+  return out;
+}
+
+#define trs_transform_point(a, v) glisy_trs_transform_point((a), (v))
+
+/**
+ * Composes trs a and b with the same meaning as mat4_multiply: the
+ * result applies b, then a, such as a parent and a local transform.
+ * Rotations and scales combine componentwise, so the result is exact
+ * when a has uniform scale; a non-uniform parent scale under a
+ * rotated child would need shear, which trs cannot hold.
+ */
+
+static inline void
+glisy_trs_multiply_into (trs *out, const trs *a, const trs *b) {
+  vec3 t = glisy_trs_rotate(&a->rotation,
+                            (vec3) {b->translation.x * a->scale.x,
+                                    b->translation.y * a->scale.y,
+                                    b->translation.z * a->scale.z});
+  quat r;
+  glisy_quat_multiply_into(&r, &a->rotation, &b->rotation);
+  *out = (trs) {
+    {t.x + a->translation.x,
+     t.y + a->translation.y,
+     t.z + a->translation.z},
+    r,
+    {a->scale.x * b->scale.x,
+     a->scale.y * b->scale.y,
+     a->scale.z * b->scale.z}
+  };
+}
+
+static inline trs
+glisy_trs_multiply (trs a, trs b) {
+  trs out;
+  glisy_trs_multiply_into(&out, &a, &b);
+  return out;
+}
+
+#define trs_multiply(a, b) glisy_trs_multiply((a), (b))
+
+/**
+ * Inverts trs a by conjugating the rotation, taking the reciprocal
+ * of the scale and mapping the negated translation through both.
+ * Exact for uniform scale, under the same limit as trs_multiply.
+ * Scale components must be non-zero.
+ */
+
+static inline void
+glisy_trs_invert_into (trs *out, const trs *a) {
+  quat r = {-a->rotation.x, -a->rotation.y, -a->rotation.z, a->rotation.w};
+  vec3 s = {1.0f / a->scale.x, 1.0f / a->scale.y, 1.0f / a->scale.z};
+  vec3 t = glisy_trs_rotate(&r, a->translation);
+  *out = (trs) {{-t.x * s.x, -t.y * s.y, -t.z * s.z}, r, s};
+}
+
+static inline trs
+glisy_trs_invert (trs a) {
+  trs out;
+  glisy_trs_invert_into(&out, &a);
+  return out;
+}
+
+#define trs_invert(a) glisy_trs_invert((a))
+
+/**
+ * Interpolates trs a and b, lerping translation and scale and
+ * slerping rotation.
+ */
+
+static inline void
+glisy_trs_lerp_into (trs *out, const trs *a, const trs *b, float t) {
+  quat r;
+  glisy_quat_slerp_into(&r, &a->rotation, &b->rotation, t);
+  *out = (trs) {
+    {a->translation.x + t * (b->translation.x - a->translation.x),
+     a->translation.y + t * (b->translation.y - a->translation.y),
+     a->translation.z + t * (b->translation.z - a->translation.z)},
+    r,
+    {a->scale.x + t * (b->scale.x - a->scale.x),
+     a->scale.y + t * (b->scale.y - a->scale.y),
+     a->scale.z + t * (b->scale.z - a->scale.z)}
+  };
+}
+
+static inline trs
+glisy_trs_lerp (trs a, trs b, float t) {
+  trs out;
+  glisy_trs_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+#define trs_lerp(a, b, t) glisy_trs_lerp((a), (b), (t))
+
+/**
+ * Returns the rows of the rotation matrix of unit quat q scaled
+ * by s, in mat4 layout. Same formula as mat3_from_quat.
+ */
+
+static inline void
+glisy_trs_basis (float m[9], const quat *q, const vec3 *s) {
+  float x = q->x, y = q->y, z = q->z, w = q->w;
+  float x2 = x + x, y2 = y + y, z2 = z + z;
+  float xx = x * x2, yx = y * x2, yy = y * y2;
+  float zx = z * x2, zy = z * y2, zz = z * z2;
+  float wx = w * x2, wy = w * y2, wz = w * z2;
+  m[0] = (1 - yy - zz) * s->x;
+  m[1] = (yx + wz) * s->x;
+  m[2] = (zx - wy) * s->x;
+  m[3] = (yx - wz) * s->y;
+  m[4] = (1 - xx - zz) * s->y;
+  m[5] = (zy + wx) * s->y;
+  m[6] = (zx + wy) * s->z;
+  m[7] = (zy - wx) * s->z;
+  m[8] = (1 - xx - yy) * s->z;
+}
+
+/**
+ * Converts trs a to an affine mat4 without building and
+ * multiplying separate rotation, scale and translation matrices.
+ */
+
+static inline void
+glisy_trs_to_mat4_into (mat4 *out, const trs *a) {
+  float m[9];
+  glisy_trs_basis(m, &a->rotation, &a->scale);
+  *out = (mat4) {
+    m[0], m[1], m[2], 0,
+    m[3], m[4], m[5], 0,
+    m[6], m[7], m[8], 0,
+    a->translation.x, a->translation.y, a->translation.z, 1
+  };
+}
+
+static inline mat4
+glisy_trs_to_mat4 (trs a) {
+  mat4 out;
+  glisy_trs_to_mat4_into(&out, &a);
+  return out;
+}
+
+#define trs_to_mat4(a) glisy_trs_to_mat4((a))
+
+/**
+ * Converts trs a to a mat3x4.
+ */
+
+static inline void
+glisy_trs_to_mat3x4_into (mat3x4 *out, const trs *a) {
+  float m[9];
+  glisy_trs_basis(m, &a->rotation, &a->scale);
+  *out = (mat3x4) {
+    m[0], m[3], m[6], a->translation.x,
+    m[1], m[4], m[7], a->translation.y,
+    m[2], m[5], m[8], a->translation.z
+  };
+}
+
+static inline mat3x4
+glisy_trs_to_mat3x4 (trs a) {
+  mat3x4 out;
+  glisy_trs_to_mat3x4_into(&out, &a);
+  return out;
+}
+
+#define trs_to_mat3x4(a) glisy_trs_to_mat3x4((a))
+
+/**
+ * Decomposes affine mat4 a into a trs. The scale is the length of
+ * each basis row, negated on x when a mirrors, and the rotation is
+ * read from the normalized rows with quat_from_mat3. a must have no
+ * shear and no zero scale. With SSE the three row lengths, their
+ * reciprocals and the normalized rows each take one instruction.
+ */
+
+static inline void
+glisy_trs_from_mat4_into (trs *out, const mat4 *a) {
+#ifdef GLISY_SSE2
+  __m128 r0 = _mm_load_ps(&a->m11);
+  __m128 r1 = _mm_load_ps(&a->m21);
+  __m128 r2 = _mm_load_ps(&a->m31);
+  __m128 c0 = r0, c1 = r1, c2 = r2, c3 = _mm_setzero_ps();
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  __m128 s = _mm_mul_ps(c0, c0);
+  s = glisy_simd_madd(c1, c1, s);
+  s = _mm_sqrt_ps(glisy_simd_madd(c2, c2, s));
+  __m128 det = glisy_simd_hsum(_mm_mul_ps(r0, glisy_mat4_cross3(r1, r2)));
+  __m128 sign = _mm_and_ps(_mm_cmplt_ss(det, _mm_setzero_ps()),
+                           _mm_set_ss(-0.0f));
+  s = _mm_xor_ps(s, sign);
+  __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), s);
+  float m[12], l[4];
+  _mm_storeu_ps(m + 0, _mm_mul_ps(r0, glisy_simd_splat(inv, 0)));
+  _mm_storeu_ps(m + 4, _mm_mul_ps(r1, glisy_simd_splat(inv, 1)));
+  _mm_storeu_ps(m + 8, _mm_mul_ps(r2, glisy_simd_splat(inv, 2)));
+  _mm_storeu_ps(l, s);
+  mat3 r = {m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]};
+  float sx = l[0], sy = l[1], sz = l[2];
+#else
+  float sx = sqrtf(a->m11 * a->m11 + a->m12 * a->m12 + a->m13 * a->m13);
+  float sy = sqrtf(a->m21 * a->m21 + a->m22 * a->m22 + a->m23 * a->m23);
+  float sz = sqrtf(a->m31 * a->m31 + a->m32 * a->m32 + a->m33 * a->m33);
+  float det = a->m11 * (a->m22 * a->m33 - a->m23 * a->m32) +
+              a->m12 * (a->m23 * a->m31 - a->m21 * a->m33) +
+              a->m13 * (a->m21 * a->m32 - a->m22 * a->m31);
+  if (det < 0) sx = -sx;
+  float ix = 1.0f / sx, iy = 1.0f / sy, iz = 1.0f / sz;
+  mat3 r = {
+    a->m11 * ix, a->m12 * ix, a->m13 * ix,
+    a->m21 * iy, a->m22 * iy, a->m23 * iy,
+    a->m31 * iz, a->m32 * iz, a->m33 * iz
+  };
+#endif
+  *out = (trs) {
+    {a->m41, a->m42, a->m43},
+    glisy_quat_from_mat3(r),
+    {sx, sy, sz}
+  };
+}
+
+static inline trs
+glisy_trs_from_mat4 (mat4 a) {
+  trs out;
+  glisy_trs_from_mat4_into(&out, &a);
+  return out;
+}
+
+#define trs_from_mat4(a) glisy_trs_from_mat4((a))
+
+/**
+ * Decomposes mat3x4 a into a trs like trs_from_mat4.
+ */
+
+static inline trs
+glisy_trs_from_mat3x4 (mat3x4 a) {
+  mat4 m;
+  glisy_mat3x4_to_mat4_into(&m, &a);
+  return glisy_trs_from_mat4(m);
+}
+
+#define trs_from_mat3x4(a) glisy_trs_from_mat3x4((a))
+
+/**
+ * Batch conversions from count contiguous trs to mat4s and
+ * mat3x4s. The SIMD kernel gathers GLISY_LANES transforms with
+ * three transposes, builds every matrix element a register at a
+ * time and transposes the rows back out.
+ */
+
+static inline void
+glisy_trs_to_mat4_batch_scalar (mat4 *out, const trs *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_trs_to_mat4_into(&out[i], &in[i]);
+  }
+}
+
+static inline void
+glisy_trs_to_mat3x4_batch_scalar (mat3x4 *out,
+                                  const trs *in,
+                                  size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_trs_to_mat3x4_into(&out[i], &in[i]);
+  }
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Loads four floats at offset off of each of GLISY_LANES trs at p
+ * and transposes them into lanes. Under AVX trs i and i + 4 share
+ * a register.
+ */
+
+static inline void
+glisy_trs_load_lanes (const trs *p, int off,
+                      glisy_lane *a, glisy_lane *b,
+                      glisy_lane *c, glisy_lane *d) {
+  const float *f = &p->translation.x + off;
+#ifdef GLISY_AVX
+  *a = _mm256_loadu2_m128(f + 40, f + 0);
+  *b = _mm256_loadu2_m128(f + 50, f + 10);
+  *c = _mm256_loadu2_m128(f + 60, f + 20);
+  *d = _mm256_loadu2_m128(f + 70, f + 30);
+#else
+  *a = _mm_loadu_ps(f + 0);
+  *b = _mm_loadu_ps(f + 10);
+  *c = _mm_loadu_ps(f + 20);
+  *d = _mm_loadu_ps(f + 30);
+#endif
+  glisy_lane_transpose4(a, b, c, d);
+}
+
+/**
+ * Transposes lanes a, b, c and d and stores them as one row of
+ * four floats in each of GLISY_LANES matrices stride floats apart.
+ */
+
+static inline void
+glisy_trs_store_row (float *p, size_t stride,
+                     glisy_lane a, glisy_lane b,
+                     glisy_lane c, glisy_lane d) {
+  glisy_lane_transpose4(&a, &b, &c, &d);
+#ifdef GLISY_AVX
+  _mm256_storeu2_m128(p + 4 * stride, p + 0, a);
+  _mm256_storeu2_m128(p + 5 * stride, p + stride, b);
+  _mm256_storeu2_m128(p + 6 * stride, p + 2 * stride, c);
+  _mm256_storeu2_m128(p + 7 * stride, p + 3 * stride, d);
+#else
+  _mm_storeu_ps(p + 0, a);
+  _mm_storeu_ps(p + stride, b);
+  _mm_storeu_ps(p + 2 * stride, c);
+  _mm_storeu_ps(p + 3 * stride, d);
+#endif
+}
+
+/**
+ * Loads GLISY_LANES trs at in and computes the scaled basis rows
+ * m[0..8] and translation t[0..2] in lanes.
+ */
+
+static inline void
+glisy_trs_lanes (const trs *in, glisy_lane m[9], glisy_lane t[3]) {
+  glisy_lane x, y, z, w, sx, sy, sz, w6, sx6;
+  glisy_trs_load_lanes(in, 0, &t[0], &t[1], &t[2], &x);
+  glisy_trs_load_lanes(in, 4, &y, &z, &w, &sx);
+  glisy_trs_load_lanes(in, 6, &w6, &sx6, &sy, &sz);
+
+  glisy_lane one = glisy_lane_splat(1.0f);
+  glisy_lane x2 = glisy_lane_add(x, x);
+  glisy_lane y2 = glisy_lane_add(y, y);
+  glisy_lane z2 = glisy_lane_add(z, z);
+  glisy_lane xx = glisy_lane_mul(x, x2);
+  glisy_lane yx = glisy_lane_mul(y, x2);
+  glisy_lane yy = glisy_lane_mul(y, y2);
+  glisy_lane zx = glisy_lane_mul(z, x2);
+  glisy_lane zy = glisy_lane_mul(z, y2);
+  glisy_lane zz = glisy_lane_mul(z, z2);
+  glisy_lane wx = glisy_lane_mul(w, x2);
+  glisy_lane wy = glisy_lane_mul(w, y2);
+  glisy_lane wz = glisy_lane_mul(w, z2);
+
+  m[0] = glisy_lane_mul(glisy_lane_sub(glisy_lane_sub(one, yy), zz), sx);
+  m[1] = glisy_lane_mul(glisy_lane_add(yx, wz), sx);
+  m[2] = glisy_lane_mul(glisy_lane_sub(zx, wy), sx);
+  m[3] = glisy_lane_mul(glisy_lane_sub(yx, wz), sy);
+  m[4] = glisy_lane_mul(glisy_lane_sub(glisy_lane_sub(one, xx), zz), sy);
+  m[5] = glisy_lane_mul(glisy_lane_add(zy, wx), sy);
+  m[6] = glisy_lane_mul(glisy_lane_add(zx, wy), sz);
+  m[7] = glisy_lane_mul(glisy_lane_sub(zy, wx), sz);
+  m[8] = glisy_lane_mul(glisy_lane_sub(glisy_lane_sub(one, xx), yy), sz);
+}
+
+static inline void
+glisy_trs_to_mat4_batch_simd (mat4 *out, const trs *in, size_t count) {
+  glisy_lane zero = glisy_lane_zero();
+  glisy_lane one = glisy_lane_splat(1.0f);
+  size_t i = 0;
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane m[9], t[3];
+    float *p = &out[i].m11;
+    glisy_trs_lanes(in + i, m, t);
+    glisy_trs_store_row(p + 0, 16, m[0], m[1], m[2], zero);
+    glisy_trs_store_row(p + 4, 16, m[3], m[4], m[5], zero);
+    glisy_trs_store_row(p + 8, 16, m[6], m[7], m[8], zero);
+    glisy_trs_store_row(p + 12, 16, t[0], t[1], t[2], one);
+  }
+  glisy_trs_to_mat4_batch_scalar(out + i, in + i, count - i);
+}
+
+static inline void
+glisy_trs_to_mat3x4_batch_simd (mat3x4 *out, const trs *in, size_t count) {
+  size_t i = 0;
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane m[9], t[3];
+    float *p = &out[i].m11;
+    glisy_trs_lanes(in + i, m, t);
+    glisy_trs_store_row(p + 0, 12, m[0], m[3], m[6], t[0]);
+    glisy_trs_store_row(p + 4, 12, m[1], m[4], m[7], t[1]);
+    glisy_trs_store_row(p + 8, 12, m[2], m[5], m[8], t[2]);
+  }
+  glisy_trs_to_mat3x4_batch_scalar(out + i, in + i, count - i);
+}
+#endif
+
+static inline void
+glisy_trs_to_mat4_batch (mat4 *out, const trs *in, size_t count) {
+#ifdef GLISY_SSE2
+  glisy_trs_to_mat4_batch_simd(out, in, count);
+#else
+  glisy_trs_to_mat4_batch_scalar(out, in, count);
+#endif
+}
+
+static inline void
+glisy_trs_to_mat3x4_batch (mat3x4 *out, const trs *in, size_t count) {
+#ifdef GLISY_SSE2
+  glisy_trs_to_mat3x4_batch_simd(out, in, count);
+#else
+  glisy_trs_to_mat3x4_batch_scalar(out, in, count);
+#endif
+}
+
+/**
+ * Batch form of trs_from_mat4 over count contiguous mat4s.
+ */
+
+static inline void
+glisy_trs_from_mat4_batch (trs *out, const mat4 *in, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_trs_from_mat4_into(&out[i], &in[i]);
+  }
+}
+
+/**
+ * Batch form of trs_multiply over count contiguous pairs,
+ * out[i] = a[i] * b[i]. out may be a or b.
+ */
+
+static inline void
+glisy_trs_multiply_batch (trs *out,
+                          const trs *a,
+                          const trs *b,
+                          size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_trs_multiply_into(&out[i], &a[i], &b[i]);
+  }
+}
+
+/**
+ * Writes a string representation of trs a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_trs_format (char *buf, size_t size, trs a) {
+  glisy_writer w = {buf, size, 0};
+  glisy_writer_text(&w, "trs(", 4);
+  glisy_writer_floats(&w, "translation=", &a.translation.x, 3, 3);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "rotation=", &a.rotation.x, 4, 4);
+  glisy_writer_text(&w, ", ", 2);
+  glisy_writer_floats(&w, "scale=", &a.scale.x, 3, 3);
+  glisy_writer_text(&w, ")", 1);
+  return glisy_writer_end(&w);
+}
+
+#define trs_format(buf, size, a) glisy_trs_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(trs)
+
+/**
+ * Returns a string representation of trs a, allocated with strdup.
+ * The caller frees it.
+ */
+
+static inline const char *
+glisy_trs_string (trs a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_trs_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define trs_string(a) glisy_trs_string((a))
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,16 +1,14 @@
 #ifndef GLISY_VEC2_H
 #define GLISY_VEC2_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 #include <time.h>
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <glisy/vec3.h>
-#include <glisy/mat2.h>
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/random.h>
 
 /**
  * vec2 struct type.
@@ -19,6 +17,20 @@ extern "C" {
 typedef struct vec2 vec2;
 struct vec2 { float x; float y; };
 
+/**
+ * Types used by vec2 routines. Included after the
+ * vec2 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/vec3.h>
+#include <glisy/mat2.h>
+#include <glisy/mat3.h>
+#include <glisy/mat4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * vec2 initializer.
  */
@@ -30,204 +42,462 @@ struct vec2 { float x; float y; };
  * Clones and returns vec2.
  */
 
-#define vec2_clone(vec) ((vec2) {(vec).x, (vec).y})
+static inline vec2
+glisy_vec2_clone (vec2 vec) {
+  return (vec2) {vec.x, vec.y};
+}
+
+#define vec2_clone(vec) glisy_vec2_clone((vec))
 
 /**
  * Subtracts vec2 b from vec2 a.
  */
 
+static inline void
+glisy_vec2_subtract_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {(a->x - b->x), (a->y - b->y)};
+}
+
+static inline vec2
+glisy_vec2_subtract (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_subtract_into(&out, &a, &b);
+  return out;
+}
+
 #define vec2_sub vec2_subtract
-#define vec2_subtract(a, b) ((vec2) {((a).x - (b).x), ((a).y - (b).y)})
+#define vec2_subtract(a, b) glisy_vec2_subtract((a), (b))
 
 /**
  * Multiply two vec2.
  */
 
+static inline void
+glisy_vec2_multiply_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {(a->x * b->x), (a->y * b->y)};
+}
+
+static inline vec2
+glisy_vec2_multiply (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_multiply_into(&out, &a, &b);
+  return out;
+}
+
 #define vec2_mul vec2_multiply
-#define vec2_multiply(a, b) ((vec2) {((a).x * (b).x), ((a).y * (b).y)})
+#define vec2_multiply(a, b) glisy_vec2_multiply((a), (b))
 
 /**
  * Divide two vec2 a by vec2 b
  */
 
+static inline void
+glisy_vec2_divide_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {(a->x / b->x), (a->y / b->y)};
+}
+
+static inline vec2
+glisy_vec2_divide (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_divide_into(&out, &a, &b);
+  return out;
+}
+
 #define vec2_div vec2_divide
-#define vec2_divide(a, b) ((vec2) {((a).x / (b).x), ((a).y / (b).y)})
+#define vec2_divide(a, b) glisy_vec2_divide((a), (b))
 
 /**
  * Copy vec2 b into vec2 a
  */
 
-#define vec2_copy(a, b) ({             \
-  vec2 *tmp = (vec2 *) &(a);           \
-  (tmp->x = (b).x);                    \
-  (tmp->y = (b).y);                    \
-  (*tmp);                              \
-})
+static inline vec2
+glisy_vec2_copy (vec2 *a, vec2 b) {
+  a->x = b.x;
+  a->y = b.y;
+  return *a;
+}
+
+#define vec2_copy(a, b) glisy_vec2_copy(&(a), (b))
 
 /**
  * Sets x and y component of vec2.
  */
 
-#define vec2_set(v, a, b) ({    \
-  vec2 *tmp = (vec2 *) &(v);    \
-  tmp->x = ((float) a);         \
-  tmp->y = ((float) b);         \
-  (*tmp);                       \
-})
+static inline vec2
+glisy_vec2_set (vec2 *v, float a, float b) {
+  v->x = a;
+  v->y = b;
+  return *v;
+}
+
+#define vec2_set(v, a, b) glisy_vec2_set(&(v), (a), (b))
 
 /**
  * Add two vectors together.
  */
 
-#define vec2_add(a, b) ((vec2) {((a).x + (b).x), ((a).y + (b).y)})
+static inline void
+glisy_vec2_add_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {(a->x + b->x), (a->y + b->y)};
+}
+
+static inline vec2
+glisy_vec2_add (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_add_into(&out, &a, &b);
+  return out;
+}
+
+#define vec2_add(a, b) glisy_vec2_add((a), (b))
 
 /**
  * Returns the maximum of two vec2 inputs.
  */
 
-#define vec2_max(a, b) ((vec2) {fmaxf((a).x, (b).x), fmaxf((a).y, (b).y)})
+static inline void
+glisy_vec2_max_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {fmaxf(a->x, b->x), fmaxf(a->y, b->y)};
+}
+
+static inline vec2
+glisy_vec2_max (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_max_into(&out, &a, &b);
+  return out;
+}
+
+#define vec2_max(a, b) glisy_vec2_max((a), (b))
 
 /**
  * Returns the minimum of two vec2 inputs.
  */
 
-#define vec2_min(a, b) ((vec2) {fminf((a).x, (b).x), fminf((a).y, (b).y)})
+static inline void
+glisy_vec2_min_into (vec2 *out, const vec2 *a, const vec2 *b) {
+  *out = (vec2) {fminf(a->x, b->x), fminf(a->y, b->y)};
+}
+
+static inline vec2
+glisy_vec2_min (vec2 a, vec2 b) {
+  vec2 out;
+  glisy_vec2_min_into(&out, &a, &b);
+  return out;
+}
+
+#define vec2_min(a, b) glisy_vec2_min((a), (b))
 
 /**
  * Scale a vec2 by a scalar number.
  */
 
-#define vec2_scale(a, s) ((vec2) {(a.x * s), (a.y * s)})
+static inline void
+glisy_vec2_scale_into (vec2 *out, const vec2 *a, float s) {
+  *out = (vec2) {(a->x * s), (a->y * s)};
+}
+
+static inline vec2
+glisy_vec2_scale (vec2 a, float s) {
+  vec2 out;
+  glisy_vec2_scale_into(&out, &a, s);
+  return out;
+}
+
+#define vec2_scale(a, s) glisy_vec2_scale((a), (s))
 
 /**
  * Calculates the Euclidean distance for a vec2.
  */
 
-#define vec2_distance(a, b) (float) sqrt(powf((b).x - (a).x, 2) + \
-                                         powf((b).y - (a).y, 2))
+static inline float
+glisy_vec2_distance (vec2 a, vec2 b) {
+  float x = b.x - a.x, y = b.y - a.y;
+  return glisy_sqrtf(x * x + y * y);
+}
+
+#define vec2_distance(a, b) glisy_vec2_distance((a), (b))
+
+/**
+ * Fast variant of vec2_distance using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec2_distance_fast (vec2 a, vec2 b) {
+  float x = b.x - a.x, y = b.y - a.y;
+  return glisy_sqrtf_fast(x * x + y * y);
+}
+
+#define vec2_distance_fast(a, b) glisy_vec2_distance_fast((a), (b))
 
 /**
  * Calculates the squared distance for a vec2.
  */
 
-#define vec2_distance_squared(a, b) (float) (powf((b).x - (a).x, 2) + \
-                                             powf((b).y - (a).y, 2))
+static inline float
+glisy_vec2_distance_squared (vec2 a, vec2 b) {
+  float x = b.x - a.x, y = b.y - a.y;
+  return x * x + y * y;
+}
+
+#define vec2_distance_squared(a, b) glisy_vec2_distance_squared((a), (b))
 
 /**
  * Calculates the length of a vec2.
  */
 
-#define vec2_length(a) (float) (       \
-  sqrt(powf(a.x, 2) + powf(a.y, 2))    \
-)
+static inline float
+glisy_vec2_length (vec2 a) {
+  return glisy_sqrtf(a.x * a.x + a.y * a.y);
+}
+
+#define vec2_length(a) glisy_vec2_length((a))
+
+/**
+ * Fast variant of vec2_length using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec2_length_fast (vec2 a) {
+  return glisy_sqrtf_fast(a.x * a.x + a.y * a.y);
+}
+
+#define vec2_length_fast(a) glisy_vec2_length_fast((a))
 
 /**
  * Calculates the squard length of a vec2.
  */
 
-#define vec2_length_squared(a) (float) (powf((a).x, 2) + powf((a).y, 2))
+static inline float
+glisy_vec2_length_squared (vec2 a) {
+  return a.x * a.x + a.y * a.y;
+}
+
+#define vec2_length_squared(a) glisy_vec2_length_squared((a))
 
 /**
  * Returns the negation of a vec2.
  */
 
-#define vec2_negate(a) ((vec2) {-1 * (a).x, -1 * (a).y})
+static inline void
+glisy_vec2_negate_into (vec2 *out, const vec2 *a) {
+  *out = (vec2) {-a->x, -a->y};
+}
+
+static inline vec2
+glisy_vec2_negate (vec2 a) {
+  vec2 out;
+  glisy_vec2_negate_into(&out, &a);
+  return out;
+}
+
+#define vec2_negate(a) glisy_vec2_negate((a))
 
 /**
  * Calculates the inverse of a vec2.
  */
 
-#define vec2_inverse(a) ( {(1.0f/(a).x), (1.0f/(a).y)})
+static inline void
+glisy_vec2_inverse_into (vec2 *out, const vec2 *a) {
+  *out = (vec2) {(1.0f / a->x), (1.0f / a->y)};
+}
+
+static inline vec2
+glisy_vec2_inverse (vec2 a) {
+  vec2 out;
+  glisy_vec2_inverse_into(&out, &a);
+  return out;
+}
+
+#define vec2_inverse(a) glisy_vec2_inverse((a))
 
 /**
  * Returns a normalized vec2.
  */
 
-#define vec2_normalize(a)  ({                    \
-  float len = ((a).x * (a).x) + ((a).y * (a).y); \
-  vec2 vec = vec2(0, 0);                         \
-  if (len > 0) {                                 \
-    len = (1/sqrt(len));                         \
-    vec.x = ((a).x * len);                       \
-    vec.y = ((a).y * len);                       \
-  }                                              \
-  (vec);                                         \
-})
+static inline void
+glisy_vec2_normalize_into (vec2 *out, const vec2 *a) {
+  float len = (a->x * a->x) + (a->y * a->y);
+  vec2 vec = {0, 0};
+  if (len > 0) {
+    len = glisy_rsqrtf(len);
+    vec.x = (a->x * len);
+    vec.y = (a->y * len);
+  }
+  *out = vec;
+}
+
+static inline vec2
+glisy_vec2_normalize (vec2 a) {
+  vec2 out;
+  glisy_vec2_normalize_into(&out, &a);
+  return out;
+}
+
+#define vec2_normalize(a) glisy_vec2_normalize((a))
+
+/**
+ * Fast variant of vec2_normalize using glisy_rsqrtf_fast. The
+ * result has unit length to within 5e-7.
+ */
+
+static inline void
+glisy_vec2_normalize_fast_into (vec2 *out, const vec2 *a) {
+  float len = a->x * a->x + a->y * a->y;
+  float s = len > 0 ? glisy_rsqrtf_fast(len) : 0;
+  *out = (vec2) {a->x * s, a->y * s};
+}
+
+static inline vec2
+glisy_vec2_normalize_fast (vec2 a) {
+  vec2 out;
+  glisy_vec2_normalize_fast_into(&out, &a);
+  return out;
+}
+
+#define vec2_normalize_fast(a) glisy_vec2_normalize_fast((a))
 
 /**
  * Calculates the dot product of vec2 a
  * and vec2 b.
  */
 
-#define vec2_dot(a, b) (float) (((a).x * (b).x) + ((a).y * (b).y))
+static inline float
+glisy_vec2_dot (vec2 a, vec2 b) {
+  return (a.x * b.x) + (a.y * b.y);
+}
+
+#define vec2_dot(a, b) glisy_vec2_dot((a), (b))
 
 /**
  * Calculates the cross product of vec2 a
  * and vec2 b producing a vec3.
  */
 
-#define vec2_cross(a, b) ((vec3) {          \
-  0, 0, (((a).x * (b).y) - ((a).y * (b).x)) \
-})
+static inline vec3
+glisy_vec2_cross (vec2 a, vec2 b) {
+  return (vec3) {0, 0, ((a.x * b.y) - (a.y * b.x))};
+}
+
+#define vec2_cross(a, b) glisy_vec2_cross((a), (b))
 
 /**
  * Calculates a linear interpolation between
  * vec2 a and vec2 b with interpolation factor t.
  */
 
-#define vec2_lerp(a, b, t) ((vec2) {(a).x + t * ((b).x - (a).x), \
-                                    (a).y + t * ((b).y - (a).y)})
+static inline void
+glisy_vec2_lerp_into (vec2 *out, const vec2 *a, const vec2 *b, float t) {
+  *out = (vec2) {a->x + t * (b->x - a->x),
+                 a->y + t * (b->y - a->y)};
+}
+
+static inline vec2
+glisy_vec2_lerp (vec2 a, vec2 b, float t) {
+  vec2 out;
+  glisy_vec2_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+#define vec2_lerp(a, b, t) glisy_vec2_lerp((a), (b), (t))
 
 /**
- * Generates a random vec2 with scale.
+ * Generates a random vec2 of length scale, uniform in direction,
+ * from the calling thread's generator.
  */
 
-#define vec2_random(scale)  ({                   \
-  srand((unsigned int) time(NULL));              \
-  float rad = 2.0 * M_PI * rand();               \
-  (vec2(cosf(rad) * scale, sinf(rad) * scale));  \
-})
+static inline vec2
+glisy_vec2_random (float scale) {
+  float s, c;
+  glisy_sincosf(2.0f * (float) M_PI * glisy_rng_float(glisy_rng_thread()),
+                &s, &c);
+  return (vec2) {c * scale, s * scale};
+}
+
+#define vec2_random(scale) glisy_vec2_random((scale))
 
 /**
  * Transform vec2 with mat2.
  */
 
-#define vec2_transform_mat2(a, m)  ({      \
-  float x = (m).m11 * (a).x + (m).m21 * (a).y;   \
-  float y = (m).m12 * (a).x + (m).m22 * (a).y;   \
-  (vec2(x, y));                                  \
-})
+static inline void
+glisy_vec2_transform_mat2_into (vec2 *out, const vec2 *a, const mat2 *m) {
+  *out = (vec2) {m->m11 * a->x + m->m21 * a->y,
+                 m->m12 * a->x + m->m22 * a->y};
+}
+
+static inline vec2
+glisy_vec2_transform_mat2 (vec2 a, mat2 m) {
+  vec2 out;
+  glisy_vec2_transform_mat2_into(&out, &a, &m);
+  return out;
+}
+
+#define vec2_transform_mat2(a, m) glisy_vec2_transform_mat2((a), (m))
 
 /**
  * Transform vec2 with mat3.
  */
 
-#define vec2_transform_mat3(a, m)  ({            \
-  float x = m.m11 * a.x + m.m21 * a.y + m.m31;   \
-  float y = m.m12 * a.x + m.m22 * a.y + m.m32;   \
-  (vec2(x, y));                                  \
-})
+static inline void
+glisy_vec2_transform_mat3_into (vec2 *out, const vec2 *a, const mat3 *m) {
+  *out = (vec2) {m->m11 * a->x + m->m21 * a->y + m->m31,
+                 m->m12 * a->x + m->m22 * a->y + m->m32};
+}
+
+static inline vec2
+glisy_vec2_transform_mat3 (vec2 a, mat3 m) {
+  vec2 out;
+  glisy_vec2_transform_mat3_into(&out, &a, &m);
+  return out;
+}
+
+#define vec2_transform_mat3(a, m) glisy_vec2_transform_mat3((a), (m))
 
 /**
  * Transform vec2 with mat4.
  */
 
-#define vec2_transform_mat4(a, m)  ({                      \
-  float x = (m).m11 * (a).x + (m).m21 * (a).y + (m).m31;   \
-  float y = (m).m12 * (a).x + (m).m22 * (a).y + (m).m32;   \
-  (vec2(x, y));                                            \
-})
+static inline void
+glisy_vec2_transform_mat4_into (vec2 *out, const vec2 *a, const mat4 *m) {
+  *out = (vec2) {m->m11 * a->x + m->m21 * a->y + m->m41,
+                 m->m12 * a->x + m->m22 * a->y + m->m42};
+}
+
+static inline vec2
+glisy_vec2_transform_mat4 (vec2 a, mat4 m) {
+  vec2 out;
+  glisy_vec2_transform_mat4_into(&out, &a, &m);
+  return out;
+}
+
+#define vec2_transform_mat4(a, m) glisy_vec2_transform_mat4((a), (m))
 
 /**
- * Returns a string representation of vec2 a.
+ * Writes a string representation of vec2 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
  */
 
-#define vec2_string(a) (const char *) ({         \
-  char str[BUFSIZ];                              \
-  memset(str, 0, BUFSIZ);                        \
-  sprintf(str, "vec2(%g, %g)", (a).x, (a).y);    \
-  (strdup(str));                                 \
-})
+static inline size_t
+glisy_vec2_format (char *buf, size_t size, vec2 a) {
+  return glisy_format_floats(buf, size, "vec2", &a.x, 2, 2);
+}
+
+#define vec2_format(buf, size, a) glisy_vec2_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(vec2)
+
+/**
+ * Returns a string representation of vec2 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_vec2_string (vec2 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_vec2_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define vec2_string(a) glisy_vec2_string((a))
 
 #ifdef __cplusplus
 }
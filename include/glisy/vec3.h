@@ -3,11 +3,12 @@
 
 #include <time.h>
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <glisy/simd.h>
+#include <glisy/format.h>
+#include <glisy/random.h>
 
 /**
  * vec3 struct type.
@@ -16,6 +17,18 @@ extern "C" {
 typedef struct vec3 vec3;
 struct vec3 { float x; float y; float z; };
 
+/**
+ * Types used by vec3 routines. Included after the
+ * vec3 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/mat3.h>
+#include <glisy/mat4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * vec3 initializer.
  */
@@ -27,219 +40,445 @@ struct vec3 { float x; float y; float z; };
  * Clones and returns vec3.
  */
 
-#define vec3_clone(vec) ((vec3) {(vec).x, (vec).y, (vec).z})
+static inline vec3
+glisy_vec3_clone (vec3 vec) {
+  return (vec3) {vec.x, vec.y, vec.z};
+}
+
+#define vec3_clone(vec) glisy_vec3_clone((vec))
 
 /**
  * Subtracts vec3 b from vec3 a.
  */
 
+static inline void
+glisy_vec3_subtract_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {(a->x - b->x),
+                 (a->y - b->y),
+                 (a->z - b->z)};
+}
+
+static inline vec3
+glisy_vec3_subtract (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_subtract_into(&out, &a, &b);
+  return out;
+}
+
 #define vec3_sub vec3_subtract
-#define vec3_subtract(a, b) ((vec3) {((a).x - (b).x), \
-                                     ((a).y - (b).y), \
-                                     ((a).z - (b).z)})
+#define vec3_subtract(a, b) glisy_vec3_subtract((a), (b))
 
 /**
  * Multiply two vec3.
  */
 
+static inline void
+glisy_vec3_multiply_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {(a->x * b->x),
+                 (a->y * b->y),
+                 (a->z * b->z)};
+}
+
+static inline vec3
+glisy_vec3_multiply (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_multiply_into(&out, &a, &b);
+  return out;
+}
+
 #define vec3_mul vec3_multiply
-#define vec3_multiply(a, b) ((vec3) {((a).x * (b).x), \
-                                     ((a).y * (b).y), \
-                                     ((a).z * (b).z)})
+#define vec3_multiply(a, b) glisy_vec3_multiply((a), (b))
 
 /**
  * Divide two vec3 a by vec3 b
  */
 
+static inline void
+glisy_vec3_divide_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {(a->x / b->x),
+                 (a->y / b->y),
+                 (a->z / b->z)};
+}
+
+static inline vec3
+glisy_vec3_divide (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_divide_into(&out, &a, &b);
+  return out;
+}
+
 #define vec3_div vec3_divide
-#define vec3_divide(a, b) ((vec3) {((a).x / (b).x), \
-                                   ((a).y / (b).y), \
-                                   ((a).z / (b).z)})
+#define vec3_divide(a, b) glisy_vec3_divide((a), (b))
 
 /**
  * Copy vec3 b into vec3 a
  */
 
-#define vec3_copy(a, b)  ({       \
-  vec3 *tmp = (vec3 *) &(a);      \
-  (tmp->x = b.x);                 \
-  (tmp->y = b.y);                 \
-  (tmp->z = b.z);                 \
-  (*tmp);                         \
-})
+static inline vec3
+glisy_vec3_copy (vec3 *a, vec3 b) {
+  a->x = b.x;
+  a->y = b.y;
+  a->z = b.z;
+  return *a;
+}
+
+#define vec3_copy(a, b) glisy_vec3_copy(&(a), (b))
 
 /**
  * Sets x and y component of vec3.
  */
 
-#define vec3_set(v, a, b, c)  ({       \
-  vec3 *tmp = (vec3 *) &(v);           \
-  tmp->x = ((float) a);                \
-  tmp->y = ((float) b);                \
-  tmp->z = ((float) c);                \
-  (*tmp);                              \
-})
+static inline vec3
+glisy_vec3_set (vec3 *v, float a, float b, float c) {
+  v->x = a;
+  v->y = b;
+  v->z = c;
+  return *v;
+}
+
+#define vec3_set(v, a, b, c) glisy_vec3_set(&(v), (a), (b), (c))
 
 /**
  * Add two vectors together.
  */
 
-#define vec3_add(a, b) ((vec3) {((a).x + (b).x), \
-                                ((a).y + (b).y), \
-                                ((a).z + (b).z)})
+static inline void
+glisy_vec3_add_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {(a->x + b->x),
+                 (a->y + b->y),
+                 (a->z + b->z)};
+}
+
+static inline vec3
+glisy_vec3_add (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_add_into(&out, &a, &b);
+  return out;
+}
+
+#define vec3_add(a, b) glisy_vec3_add((a), (b))
 
 /**
  * Returns the maximum of two vec3 inputs.
  */
 
-#define vec3_max(a, b) ((vec3) {fmaxf((a).x, (b).x), \
-                                fmaxf((a).y, (b).y), \
-                                fmaxf((a).z, (b).z)})
+static inline void
+glisy_vec3_max_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {fmaxf(a->x, b->x),
+                 fmaxf(a->y, b->y),
+                 fmaxf(a->z, b->z)};
+}
+
+static inline vec3
+glisy_vec3_max (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_max_into(&out, &a, &b);
+  return out;
+}
+
+#define vec3_max(a, b) glisy_vec3_max((a), (b))
 
 /**
  * Returns the minimum of two vec3 inputs.
  */
 
-#define vec3_min(a, b) ((vec3) {fminf((a).x, (b).x), \
-                                fminf((a).y, (b).y), \
-                                fminf((a).z, (b).z)})
+static inline void
+glisy_vec3_min_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {fminf(a->x, b->x),
+                 fminf(a->y, b->y),
+                 fminf(a->z, b->z)};
+}
+
+static inline vec3
+glisy_vec3_min (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_min_into(&out, &a, &b);
+  return out;
+}
+
+#define vec3_min(a, b) glisy_vec3_min((a), (b))
 
 /**
  * Scale a vec3 by a scalar number.
  */
 
-#define vec3_scale(a, s) ((vec3) {((a).x * s), \
-                                  ((a).y * s), \
-                                  ((a).z * s)})
+static inline void
+glisy_vec3_scale_into (vec3 *out, const vec3 *a, float s) {
+  *out = (vec3) {(a->x * s),
+                 (a->y * s),
+                 (a->z * s)};
+}
+
+static inline vec3
+glisy_vec3_scale (vec3 a, float s) {
+  vec3 out;
+  glisy_vec3_scale_into(&out, &a, s);
+  return out;
+}
+
+#define vec3_scale(a, s) glisy_vec3_scale((a), (s))
 
 /**
  * Calculates the Euclidean distance for a vec3.
  */
 
-#define vec3_distance(a, b) (float) sqrt(pow((b).x - (a).x, 2) + \
-                                         pow((b).y - (a).y, 2) + \
-                                         pow((b).z - (a).z, 2))
+static inline float
+glisy_vec3_distance (vec3 a, vec3 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z;
+  return glisy_sqrtf(x * x + y * y + z * z);
+}
+
+#define vec3_distance(a, b) glisy_vec3_distance((a), (b))
+
+/**
+ * Fast variant of vec3_distance using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec3_distance_fast (vec3 a, vec3 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z;
+  return glisy_sqrtf_fast(x * x + y * y + z * z);
+}
+
+#define vec3_distance_fast(a, b) glisy_vec3_distance_fast((a), (b))
 
 /**
  * Calculates the squared distance for a vec3.
  */
 
-#define vec3_distance_squared(a, b) (float) (powf((b).x - (a).x, 2) + \
-                                             powf((b).y - (a).y, 2) + \
-                                             powf((b).z - (a).z, 2))
+static inline float
+glisy_vec3_distance_squared (vec3 a, vec3 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z;
+  return x * x + y * y + z * z;
+}
+
+#define vec3_distance_squared(a, b) glisy_vec3_distance_squared((a), (b))
 
 /**
  * Calculates the length of a vec3.
  */
 
-#define vec3_length(a) (float) sqrt(powf((a).x, 2) + \
-                                    powf((a).y, 2) + \
-                                    powf((a).z, 2))
+static inline float
+glisy_vec3_length (vec3 a) {
+  return glisy_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+
+#define vec3_length(a) glisy_vec3_length((a))
+
+/**
+ * Fast variant of vec3_length using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec3_length_fast (vec3 a) {
+  return glisy_sqrtf_fast(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+
+#define vec3_length_fast(a) glisy_vec3_length_fast((a))
 
 /**
  * Calculates the squard length of a vec3.
  */
 
-#define vec3_length_squared(a) (float) (powf((a).x, 2) + \
-                                        powf((a).y, 2) + \
-                                        powf((a).z, 2))
+static inline float
+glisy_vec3_length_squared (vec3 a) {
+  return a.x * a.x + a.y * a.y + a.z * a.z;
+}
+
+#define vec3_length_squared(a) glisy_vec3_length_squared((a))
 
 /**
  * Returns the negation of a vec3.
  */
 
-#define vec3_negate(a) ( vec3_scale((a), -1))
+static inline void
+glisy_vec3_negate_into (vec3 *out, const vec3 *a) {
+  *out = (vec3) {-a->x, -a->y, -a->z};
+}
+
+static inline vec3
+glisy_vec3_negate (vec3 a) {
+  vec3 out;
+  glisy_vec3_negate_into(&out, &a);
+  return out;
+}
+
+#define vec3_negate(a) glisy_vec3_negate((a))
 
 /**
  * Calculates the inverse of a vec3.
  */
 
-#define vec3_inverse(a) ((vec3) {(1.0f/(a).x), \
-                                 (1.0f/(a).y), \
-                                 (1.0f/(a).z)})
+static inline void
+glisy_vec3_inverse_into (vec3 *out, const vec3 *a) {
+  *out = (vec3) {(1.0f / a->x),
+                 (1.0f / a->y),
+                 (1.0f / a->z)};
+}
+
+static inline vec3
+glisy_vec3_inverse (vec3 a) {
+  vec3 out;
+  glisy_vec3_inverse_into(&out, &a);
+  return out;
+}
+
+#define vec3_inverse(a) glisy_vec3_inverse((a))
 
 /**
  * Returns a normalized vec3.
  */
 
-#define vec3_normalize(a)  ({                                      \
-  float len = ((a).x * (a).x) + ((a).y * (a).y) + ((a).z * (a).z); \
-  vec3 vec = {0, 0, 0};                                            \
-  if (len > 0) {                                                   \
-    len = (1/sqrt(len));                                           \
-    vec.x = ((a).x * len);                                         \
-    vec.y = ((a).y * len);                                         \
-    vec.z = ((a).z * len);                                         \
-  }                                                                \
-  (vec);                                                           \
-})
+static inline void
+glisy_vec3_normalize_into (vec3 *out, const vec3 *a) {
+  float len = (a->x * a->x) + (a->y * a->y) + (a->z * a->z);
+  vec3 vec = {0, 0, 0};
+  if (len > 0) {
+    len = glisy_rsqrtf(len);
+    vec.x = (a->x * len);
+    vec.y = (a->y * len);
+    vec.z = (a->z * len);
+  }
+  *out = vec;
+}
+
+static inline vec3
+glisy_vec3_normalize (vec3 a) {
+  vec3 out;
+  glisy_vec3_normalize_into(&out, &a);
+  return out;
+}
+
+#define vec3_normalize(a) glisy_vec3_normalize((a))
+
+/**
+ * Fast variant of vec3_normalize using glisy_rsqrtf_fast. The
+ * result has unit length to within 5e-7.
+ */
+
+static inline void
+glisy_vec3_normalize_fast_into (vec3 *out, const vec3 *a) {
+  float len = a->x * a->x + a->y * a->y + a->z * a->z;
+  float s = len > 0 ? glisy_rsqrtf_fast(len) : 0;
+  *out = (vec3) {a->x * s, a->y * s, a->z * s};
+}
+
+static inline vec3
+glisy_vec3_normalize_fast (vec3 a) {
+  vec3 out;
+  glisy_vec3_normalize_fast_into(&out, &a);
+  return out;
+}
+
+#define vec3_normalize_fast(a) glisy_vec3_normalize_fast((a))
 
 /**
  * Calculates the dot product of vec3 a
  * and vec3 b.
  */
 
-#define vec3_dot(a, b) (float) (((a).x * (b).x) + \
-                                ((a).y * (b).y) + \
-                                ((a).z * (b).z))
+static inline float
+glisy_vec3_dot (vec3 a, vec3 b) {
+  return (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+}
+
+#define vec3_dot(a, b) glisy_vec3_dot((a), (b))
 
 /**
  * Calculates the cross product of vec3 a
  * and vec3 b.
  */
 
-#define vec3_cross(a, b) ((vec3) {((a).y * (b).z - (a).z * (b).y), \
-                                  ((a).z * (b).x - (a).x * (b).z), \
-                                  ((a).x * (b).y - (a).y * (b).x)})
+static inline void
+glisy_vec3_cross_into (vec3 *out, const vec3 *a, const vec3 *b) {
+  *out = (vec3) {(a->y * b->z - a->z * b->y),
+                 (a->z * b->x - a->x * b->z),
+                 (a->x * b->y - a->y * b->x)};
+}
+
+static inline vec3
+glisy_vec3_cross (vec3 a, vec3 b) {
+  vec3 out;
+  glisy_vec3_cross_into(&out, &a, &b);
+  return out;
+}
+
+#define vec3_cross(a, b) glisy_vec3_cross((a), (b))
+
 /**
  * Calculates a linear interpolation between
  * vec3 a and vec3 b with interpolation factor t.
  */
 
-#define vec3_lerp(a, b, t) ((vec3) {(a).x + t * ((b).x - (a).x), \
-                                    (a).y + t * ((b).y - (a).y), \
-                                    (a).z + t * ((b).z - (a).z)})
+static inline void
+glisy_vec3_lerp_into (vec3 *out, const vec3 *a, const vec3 *b, float t) {
+  *out = (vec3) {a->x + t * (b->x - a->x),
+                 a->y + t * (b->y - a->y),
+                 a->z + t * (b->z - a->z)};
+}
+
+static inline vec3
+glisy_vec3_lerp (vec3 a, vec3 b, float t) {
+  vec3 out;
+  glisy_vec3_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+#define vec3_lerp(a, b, t) glisy_vec3_lerp((a), (b), (t))
 
 /**
- * Generates a random vec3 with scale.
+ * Generates a random vec3 of length scale, uniform on the sphere,
+ * from the calling thread's generator.
  */
 
-#define vec3_random(scale)  ({                   \
-  srand((unsigned int) time(NULL));              \
-  float rad = 2.0 * M_PI * rand();               \
-  float z = (rand() * 2.0) - 1.0;                \
-  float zs = sqrt(1.0 - z * z) * scale;          \
-  (vec3(cosf(rad)*zs, sinf(rad)*zs, z*scale));   \
-})
+static inline vec3
+glisy_vec3_random (float scale) {
+  glisy_rng *rng = glisy_rng_thread();
+  float s, c;
+  float z = 1.0f - 2.0f * glisy_rng_float(rng);
+  float zs = sqrtf(fmaxf(0.0f, 1.0f - z * z)) * scale;
+  glisy_sincosf(2.0f * (float) M_PI * glisy_rng_float(rng), &s, &c);
+  return (vec3) {c * zs, s * zs, z * scale};
+}
+
+#define vec3_random(scale) glisy_vec3_random((scale))
 
 /**
  * Returns the angle between two vec3 vectors.
  */
 
-#define vec3_angle(a, b) ({      \
-  vec3 x = vec3_normalize((a));  \
-  vec3 y = vec3_normalize((b));  \
-  float angle = 0;               \
-  float cosine = vec3_dot(x, y); \
-  if (cosine > 1.0) cosine = 0;  \
-  else cosine = acosf(cosine);   \
-  (cosine);                      \
-})
+static inline float
+glisy_vec3_angle (vec3 a, vec3 b) {
+  vec3 x = glisy_vec3_normalize(a);
+  vec3 y = glisy_vec3_normalize(b);
+  float cosine = glisy_vec3_dot(x, y);
+  if (cosine > 1.0) cosine = 0;
+  else cosine = acosf(cosine);
+  return cosine;
+}
+
+#define vec3_angle(a, b) glisy_vec3_angle((a), (b))
 
 /**
  * Applies a mat4 to a vec3.
  */
 
-#define vec3_transform_mat3(vec, mat) ({     \
-  vec3 out;                                  \
-  vec3 v = *(vec3* ) &(vec);                 \
-  mat3 a = (mat3) (mat);                     \
-  float x = v.x, y = v.y, z = v.z;           \
-  out.x = x * a.m11 + y * a.m21 + z * a.m31; \
-  out.y = x * a.m12 + y * a.m22 + z * a.m32; \
-  out.z = x * a.m13 + y * a.m23 + z * a.m33; \
-  (out);                                     \
-})
+static inline void
+glisy_vec3_transform_mat3_into (vec3 *out, const vec3 *v, const mat3 *a) {
+  float x = v->x, y = v->y, z = v->z;
+  *out = (vec3) {x * a->m11 + y * a->m21 + z * a->m31,
+                 x * a->m12 + y * a->m22 + z * a->m32,
+                 x * a->m13 + y * a->m23 + z * a->m33};
+}
+
+static inline vec3
+glisy_vec3_transform_mat3 (vec3 v, mat3 a) {
+  vec3 out;
+  glisy_vec3_transform_mat3_into(&out, &v, &a);
+  return out;
+}
+
+#define vec3_transform_mat3(vec, mat) glisy_vec3_transform_mat3((vec), (mat))
 
   // @TODO(werle) - hermite
   // @TODO(werle) - bezier
@@ -247,77 +486,398 @@ struct vec3 { float x; float y; float z; };
   // @TODO(werle) - transformQuat
 
 /**
+ * Transforms point vec3 by mat4 and divides by the resulting w
+ * (treated as 1 when zero).
  */
 
-#define vec3_transform_mat4(vec, mat)  ({                              \
-  vec3 out;                                                            \
-  double x = (vec).x, y = (vec).y, z = (vec).z;                         \
-  double w = (mat).m14 * x + (mat).m24 * y + (mat).m34 * z + (mat).m44; \
-  w = w ? w : 1.0;                                                     \
-  out.x = (mat.m11 * x + mat.m21 * y + mat.m31 * z + mat.m41) / w;     \
-  out.y = (mat.m12 * x + mat.m22 * y + mat.m32 * z + mat.m42) / w;     \
-  out.z = (mat.m13 * x + mat.m23 * y + mat.m33 * z + mat.m43) / w;     \
-  (out);                                                               \
-})
+static inline void
+glisy_vec3_transform_mat4_into (vec3 *out, const vec3 *vec, const mat4 *mat) {
+  float x = vec->x, y = vec->y, z = vec->z;
+  float w = mat->m14 * x + mat->m24 * y + mat->m34 * z + mat->m44;
+  float iw = 1.0f / (w ? w : 1.0f);
+  *out = (vec3) {(mat->m11 * x + mat->m21 * y + mat->m31 * z + mat->m41) * iw,
+                 (mat->m12 * x + mat->m22 * y + mat->m32 * z + mat->m42) * iw,
+                 (mat->m13 * x + mat->m23 * y + mat->m33 * z + mat->m43) * iw};
+}
+
+static inline vec3
+glisy_vec3_transform_mat4 (vec3 vec, mat4 mat) {
+  vec3 out;
+  glisy_vec3_transform_mat4_into(&out, &vec, &mat);
+  return out;
+}
+
+#define vec3_transform_mat4(vec, mat) glisy_vec3_transform_mat4((vec), (mat))
 
 /**
+ * Transforms point vec3 by an affine mat4, ignoring its
+ * projective column (m14, m24, m34, m44) and skipping the divide.
  */
 
-#define vec3_rotateX(vec, axis, origin, angle) ({ \
-  vec3 p, r;                                      \
-  p.x = (axis).x - (origin).x;                    \
-  p.y = (axis).y - (origin).y;                    \
-  p.z = (axis).z - (origin).z;                    \
-  r.x = p.x;                                      \
-  r.y = p.y * cosf(angle) - p.z * sinf(angle);    \
-  r.z = p.y * sinf(angle) + p.z * cosf(angle);    \
-  (vec).x = r.x + (origin).x;                     \
-  (vec).y = r.y + (origin).y;                     \
-  (vec).z = r.z + (origin).z;                     \
-})
+static inline void
+glisy_vec3_transform_mat4_affine_into (vec3 *out,
+                                       const vec3 *vec,
+                                       const mat4 *mat) {
+  float x = vec->x, y = vec->y, z = vec->z;
+  *out = (vec3) {mat->m11 * x + mat->m21 * y + mat->m31 * z + mat->m41,
+                 mat->m12 * x + mat->m22 * y + mat->m32 * z + mat->m42,
+                 mat->m13 * x + mat->m23 * y + mat->m33 * z + mat->m43};
+}
+
+static inline vec3
+glisy_vec3_transform_mat4_affine (vec3 vec, mat4 mat) {
+  vec3 out;
+  glisy_vec3_transform_mat4_affine_into(&out, &vec, &mat);
+  return out;
+}
+
+#define vec3_transform_mat4_affine(vec, mat) \
+  glisy_vec3_transform_mat4_affine((vec), (mat))
 
 /**
+ * Batch point transforms over count contiguous vec3s. The
+ * projective kernels divide by w like vec3_transform_mat4, the
+ * affine ones match vec3_transform_mat4_affine. Every point is
+ * read and written once, in order, so out may be in.
  */
 
-#define vec3_rotateY(vec, axis, origin, angle) ({ \
-  vec3 p, r;                                      \
-  p.x = (axis).x - (origin).x;                    \
-  p.y = (axis).y - (origin).y;                    \
-  p.z = (axis).z - (origin).z;                    \
-  r.x = p.z * sinf(angle) + p.x * cosf(angle);    \
-  r.y = p.y;                                      \
-  r.z = p.z * cosf(angle) - p.x * sinf(angle);    \
-  (vec).x = r.x + (origin).x;                     \
-  (vec).y = r.y + (origin).y;                     \
-  (vec).z = r.z + (origin).z;                     \
-})
+static inline void
+glisy_vec3_transform_mat4_batch_scalar (vec3 *out,
+                                        const vec3 *in,
+                                        size_t count,
+                                        const mat4 *mat,
+                                        int projective) {
+  for (size_t i = 0; i < count; ++i) {
+    if (projective) {
+      glisy_vec3_transform_mat4_into(&out[i], &in[i], mat);
+    } else {
+      glisy_vec3_transform_mat4_affine_into(&out[i], &in[i], mat);
+    }
+  }
+}
+
+#ifdef GLISY_SSE2
 
 /**
+ * Loads GLISY_LANES consecutive vec3s as x, y and z lanes. Each
+ * 128 bit half holds four points which are transposed in place,
+ * so AVX costs the same seven shuffles as SSE for twice the points.
  */
 
-#define vec3_rotateZ(vec, axis, origin, angle) ({ \
-  vec3 p, r;                                      \
-  p.x = (axis).x - (origin).x;                    \
-  p.y = (axis).y - (origin).y;                    \
-  p.z = (axis).z - (origin).z;                    \
-  r.x = p.x * cosf(angle) - p.y * sinf(angle);    \
-  r.y = p.x * sinf(angle) + p.y * cosf(angle);    \
-  r.z = p.z;                                      \
-  (vec).x = r.x + (origin).x;                     \
-  (vec).y = r.y + (origin).y;                     \
-  (vec).z = r.z + (origin).z;                     \
-})
+static inline void
+glisy_vec3_load_lanes (const vec3 *in,
+                       glisy_lane *x, glisy_lane *y, glisy_lane *z) {
+  const float *p = &in->x;
+#ifdef GLISY_AVX
+  glisy_lane a = _mm256_insertf128_ps(
+    _mm256_castps128_ps256(_mm_loadu_ps(p + 0)), _mm_loadu_ps(p + 12), 1);
+  glisy_lane b = _mm256_insertf128_ps(
+    _mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+  glisy_lane c = _mm256_insertf128_ps(
+    _mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+#else
+  glisy_lane a = _mm_loadu_ps(p + 0);
+  glisy_lane b = _mm_loadu_ps(p + 4);
+  glisy_lane c = _mm_loadu_ps(p + 8);
+#endif
+  // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+  glisy_lane t = glisy_lane_shuffle(b, c, GLISY_SHUFFLE(2, 2, 1, 1));
+  *x = glisy_lane_shuffle(a, t, GLISY_SHUFFLE(0, 3, 0, 2));
+  t = glisy_lane_shuffle(a, b, GLISY_SHUFFLE(1, 1, 0, 0));
+  *y = glisy_lane_shuffle(t, glisy_lane_shuffle(b, c, GLISY_SHUFFLE(3, 3, 2, 2)),
+                          GLISY_SHUFFLE(0, 2, 0, 2));
+  t = glisy_lane_shuffle(a, b, GLISY_SHUFFLE(2, 2, 1, 1));
+  *z = glisy_lane_shuffle(t, c, GLISY_SHUFFLE(0, 2, 0, 3));
+}
+
+/**
+ * Stores x, y and z lanes as GLISY_LANES consecutive vec3s.
+ */
+
+static inline void
+glisy_vec3_store_lanes (vec3 *out, glisy_lane x, glisy_lane y, glisy_lane z) {
+  float *p = &out->x;
+  glisy_lane t = glisy_lane_shuffle(x, y, GLISY_SHUFFLE(0, 0, 0, 0));
+  glisy_lane u = glisy_lane_shuffle(z, x, GLISY_SHUFFLE(0, 0, 1, 1));
+  glisy_lane a = glisy_lane_shuffle(t, u, GLISY_SHUFFLE(0, 2, 0, 2));
+  t = glisy_lane_shuffle(y, z, GLISY_SHUFFLE(1, 1, 1, 1));
+  u = glisy_lane_shuffle(x, y, GLISY_SHUFFLE(2, 2, 2, 2));
+  glisy_lane b = glisy_lane_shuffle(t, u, GLISY_SHUFFLE(0, 2, 0, 2));
+  t = glisy_lane_shuffle(z, x, GLISY_SHUFFLE(2, 2, 3, 3));
+  u = glisy_lane_shuffle(y, z, GLISY_SHUFFLE(3, 3, 3, 3));
+  glisy_lane c = glisy_lane_shuffle(t, u, GLISY_SHUFFLE(0, 2, 0, 2));
+#ifdef GLISY_AVX
+  _mm_storeu_ps(p + 0, _mm256_castps256_ps128(a));
+  _mm_storeu_ps(p + 4, _mm256_castps256_ps128(b));
+  _mm_storeu_ps(p + 8, _mm256_castps256_ps128(c));
+  _mm_storeu_ps(p + 12, _mm256_extractf128_ps(a, 1));
+  _mm_storeu_ps(p + 16, _mm256_extractf128_ps(b, 1));
+  _mm_storeu_ps(p + 20, _mm256_extractf128_ps(c, 1));
+#else
+  _mm_storeu_ps(p + 0, a);
+  _mm_storeu_ps(p + 4, b);
+  _mm_storeu_ps(p + 8, c);
+#endif
+}
 
 /**
- * Returns a string representation of vec3 a.
+ * Transforms x, y and z lanes by mat4 in place. m holds the
+ * sixteen matrix elements splatted across lanes.
  */
 
-#define vec3_string(a) (const char *) ({                 \
-  char str[BUFSIZ];                                      \
-  memset(str, 0, BUFSIZ);                                \
-  sprintf(str, "vec3(%g, %g, %g)", (a).x, (a).y, (a).z); \
-  (strdup(str));                                         \
-})
+static inline void
+glisy_vec3_transform_mat4_lanes (glisy_lane *x, glisy_lane *y, glisy_lane *z,
+                                 const glisy_lane *m, int projective) {
+  glisy_lane rx = glisy_lane_madd(*z, m[8], glisy_lane_madd(*y, m[4],
+                  glisy_lane_madd(*x, m[0], m[12])));
+  glisy_lane ry = glisy_lane_madd(*z, m[9], glisy_lane_madd(*y, m[5],
+                  glisy_lane_madd(*x, m[1], m[13])));
+  glisy_lane rz = glisy_lane_madd(*z, m[10], glisy_lane_madd(*y, m[6],
+                  glisy_lane_madd(*x, m[2], m[14])));
+  if (projective) {
+    glisy_lane one = glisy_lane_splat(1.0f);
+    glisy_lane w = glisy_lane_madd(*z, m[11], glisy_lane_madd(*y, m[7],
+                   glisy_lane_madd(*x, m[3], m[15])));
+    w = glisy_lane_div(one, glisy_lane_select(
+          glisy_lane_eq(w, glisy_lane_splat(0.0f)), one, w));
+    rx = glisy_lane_mul(rx, w);
+    ry = glisy_lane_mul(ry, w);
+    rz = glisy_lane_mul(rz, w);
+  }
+  *x = rx;
+  *y = ry;
+  *z = rz;
+}
+
+static inline void
+glisy_vec3_transform_mat4_batch_simd (vec3 *out,
+                                      const vec3 *in,
+                                      size_t count,
+                                      const mat4 *mat,
+                                      int projective) {
+  glisy_lane m[16];
+  size_t i = 0;
+  for (int e = 0; e < 16; ++e) {
+    m[e] = glisy_lane_splat((&mat->m11)[e]);
+  }
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane x, y, z;
+    glisy_vec3_load_lanes(in + i, &x, &y, &z);
+    glisy_vec3_transform_mat4_lanes(&x, &y, &z, m, projective);
+    glisy_vec3_store_lanes(out + i, x, y, z);
+  }
+  glisy_vec3_transform_mat4_batch_scalar(out + i, in + i, count - i,
+                                         mat, projective);
+}
+#endif
+
+static inline void
+glisy_vec3_transform_mat4_batch (vec3 *out,
+                                 const vec3 *in,
+                                 size_t count,
+                                 const mat4 *mat) {
+#ifdef GLISY_SSE2
+  glisy_vec3_transform_mat4_batch_simd(out, in, count, mat, 1);
+#else
+  glisy_vec3_transform_mat4_batch_scalar(out, in, count, mat, 1);
+#endif
+}
+
+static inline void
+glisy_vec3_transform_mat4_affine_batch (vec3 *out,
+                                        const vec3 *in,
+                                        size_t count,
+                                        const mat4 *mat) {
+#ifdef GLISY_SSE2
+  glisy_vec3_transform_mat4_batch_simd(out, in, count, mat, 0);
+#else
+  glisy_vec3_transform_mat4_batch_scalar(out, in, count, mat, 0);
+#endif
+}
+
+/**
+ * Batch point transforms over SoA streams of count x, y and z
+ * floats. Output streams may be the input streams.
+ */
+
+static inline void
+glisy_vec3_transform_mat4_streams_scalar (float *ox, float *oy, float *oz,
+                                          const float *x,
+                                          const float *y,
+                                          const float *z,
+                                          size_t count,
+                                          const mat4 *mat,
+                                          int projective) {
+  for (size_t i = 0; i < count; ++i) {
+    vec3 v = {x[i], y[i], z[i]};
+    if (projective) {
+      glisy_vec3_transform_mat4_into(&v, &v, mat);
+    } else {
+      glisy_vec3_transform_mat4_affine_into(&v, &v, mat);
+    }
+    ox[i] = v.x;
+    oy[i] = v.y;
+    oz[i] = v.z;
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_vec3_transform_mat4_streams_simd (float *ox, float *oy, float *oz,
+                                        const float *x,
+                                        const float *y,
+                                        const float *z,
+                                        size_t count,
+                                        const mat4 *mat,
+                                        int projective) {
+  glisy_lane m[16];
+  size_t i = 0;
+  for (int e = 0; e < 16; ++e) {
+    m[e] = glisy_lane_splat((&mat->m11)[e]);
+  }
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane vx = glisy_lane_load(x + i);
+    glisy_lane vy = glisy_lane_load(y + i);
+    glisy_lane vz = glisy_lane_load(z + i);
+    glisy_vec3_transform_mat4_lanes(&vx, &vy, &vz, m, projective);
+    glisy_lane_store(ox + i, vx);
+    glisy_lane_store(oy + i, vy);
+    glisy_lane_store(oz + i, vz);
+  }
+  glisy_vec3_transform_mat4_streams_scalar(ox + i, oy + i, oz + i,
+                                           x + i, y + i, z + i,
+                                           count - i, mat, projective);
+}
+#endif
+
+static inline void
+glisy_vec3_transform_mat4_streams (float *ox, float *oy, float *oz,
+                                   const float *x,
+                                   const float *y,
+                                   const float *z,
+                                   size_t count,
+                                   const mat4 *mat) {
+#ifdef GLISY_SSE2
+  glisy_vec3_transform_mat4_streams_simd(ox, oy, oz, x, y, z,
+                                         count, mat, 1);
+#else
+  glisy_vec3_transform_mat4_streams_scalar(ox, oy, oz, x, y, z,
+                                           count, mat, 1);
+#endif
+}
+
+static inline void
+glisy_vec3_transform_mat4_affine_streams (float *ox, float *oy, float *oz,
+                                          const float *x,
+                                          const float *y,
+                                          const float *z,
+                                          size_t count,
+                                          const mat4 *mat) {
+#ifdef GLISY_SSE2
+  glisy_vec3_transform_mat4_streams_simd(ox, oy, oz, x, y, z,
+                                         count, mat, 0);
+#else
+  glisy_vec3_transform_mat4_streams_scalar(ox, oy, oz, x, y, z,
+                                           count, mat, 0);
+#endif
+}
+
+/**
+ */
+
+static inline vec3
+glisy_vec3_rotateX (vec3 *vec, vec3 axis, vec3 origin, float angle) {
+  float s, c;
+  glisy_sincosf(angle, &s, &c);
+  vec3 p, r;
+  p.x = axis.x - origin.x;
+  p.y = axis.y - origin.y;
+  p.z = axis.z - origin.z;
+  r.x = p.x;
+  r.y = p.y * c - p.z * s;
+  r.z = p.y * s + p.z * c;
+  vec->x = r.x + origin.x;
+  vec->y = r.y + origin.y;
+  vec->z = r.z + origin.z;
+  return *vec;
+}
+
+#define vec3_rotateX(vec, axis, origin, angle) \
+  glisy_vec3_rotateX(&(vec), (axis), (origin), (angle))
+
+/**
+ */
+
+static inline vec3
+glisy_vec3_rotateY (vec3 *vec, vec3 axis, vec3 origin, float angle) {
+  float s, c;
+  glisy_sincosf(angle, &s, &c);
+  vec3 p, r;
+  p.x = axis.x - origin.x;
+  p.y = axis.y - origin.y;
+  p.z = axis.z - origin.z;
+  r.x = p.z * s + p.x * c;
+  r.y = p.y;
+  r.z = p.z * c - p.x * s;
+  vec->x = r.x + origin.x;
+  vec->y = r.y + origin.y;
+  vec->z = r.z + origin.z;
+  return *vec;
+}
+
+#define vec3_rotateY(vec, axis, origin, angle) \
+  glisy_vec3_rotateY(&(vec), (axis), (origin), (angle))
+
+/**
+ */
+
+static inline vec3
+glisy_vec3_rotateZ (vec3 *vec, vec3 axis, vec3 origin, float angle) {
+  float s, c;
+  glisy_sincosf(angle, &s, &c);
+  vec3 p, r;
+  p.x = axis.x - origin.x;
+  p.y = axis.y - origin.y;
+  p.z = axis.z - origin.z;
+  r.x = p.x * c - p.y * s;
+  r.y = p.x * s + p.y * c;
+  r.z = p.z;
+  vec->x = r.x + origin.x;
+  vec->y = r.y + origin.y;
+  vec->z = r.z + origin.z;
+  return *vec;
+}
+
+#define vec3_rotateZ(vec, axis, origin, angle) \
+  glisy_vec3_rotateZ(&(vec), (axis), (origin), (angle))
+
+/**
+ * Writes a string representation of vec3 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_vec3_format (char *buf, size_t size, vec3 a) {
+  return glisy_format_floats(buf, size, "vec3", &a.x, 3, 3);
+}
+
+#define vec3_format(buf, size, a) glisy_vec3_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(vec3)
+
+/**
+ * Returns a string representation of vec3 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_vec3_string (vec3 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_vec3_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define vec3_string(a) glisy_vec3_string((a))
 
 #ifdef __cplusplus
 }
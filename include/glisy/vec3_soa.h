@@ -0,0 +1,497 @@
+#ifndef GLISY_VEC3_SOA_H
+#define GLISY_VEC3_SOA_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <glisy/simd.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * vec3_soa struct type. A growable array of vec3s stored as
+ * separate x, y and z float arrays sharing one allocation aligned
+ * to GLISY_SIMD_ALIGN. Capacity is a multiple of GLISY_SOA_PAD and
+ * elements past count are kept zero, so batch routines always work
+ * on whole SIMD registers without a scalar tail.
+ */
+
+typedef struct vec3_soa vec3_soa;
+struct vec3_soa {
+  float *x;
+  float *y;
+  float *z;
+  size_t count;
+  size_t capacity;
+};
+
+/**
+ * vec3_soa initializer.
+ */
+
+#define vec3_soa_create() ((vec3_soa) {0})
+
+/**
+ * Releases the storage of vec3_soa s and empties it.
+ */
+
+static inline void
+glisy_vec3_soa_free (vec3_soa *s) {
+  free(s->x);
+  *s = (vec3_soa) {0};
+}
+
+#define vec3_soa_free(s) glisy_vec3_soa_free(&(s))
+
+/**
+ * Grows vec3_soa s to hold at least capacity elements. Returns 0
+ * on success and -1 when allocation fails, leaving s unchanged.
+ */
+
+static inline int
+glisy_vec3_soa_reserve (vec3_soa *s, size_t capacity) {
+  if (capacity <= s->capacity) return 0;
+  if (capacity < 2 * s->capacity) capacity = 2 * s->capacity;
+  capacity = (capacity + GLISY_SOA_PAD - 1) & ~(size_t) (GLISY_SOA_PAD - 1);
+
+  float *data = (float *) glisy_simd_alloc(3 * capacity * sizeof(float));
+  if (!data) return -1;
+  memset(data, 0, 3 * capacity * sizeof(float));
+  if (s->count) {
+    memcpy(data, s->x, s->count * sizeof(float));
+    memcpy(data + capacity, s->y, s->count * sizeof(float));
+    memcpy(data + 2 * capacity, s->z, s->count * sizeof(float));
+  }
+  free(s->x);
+  s->x = data;
+  s->y = data + capacity;
+  s->z = data + 2 * capacity;
+  s->capacity = capacity;
+  return 0;
+}
+
+#define vec3_soa_reserve(s, capacity) glisy_vec3_soa_reserve(&(s), (capacity))
+
+/**
+ * Sets the number of elements of vec3_soa s. New elements are
+ * zero. Returns 0 on success and -1 when allocation fails.
+ */
+
+static inline int
+glisy_vec3_soa_resize (vec3_soa *s, size_t count) {
+  if (glisy_vec3_soa_reserve(s, count)) return -1;
+  if (count < s->count) {
+    size_t n = (s->count - count) * sizeof(float);
+    memset(s->x + count, 0, n);
+    memset(s->y + count, 0, n);
+    memset(s->z + count, 0, n);
+  }
+  s->count = count;
+  return 0;
+}
+
+#define vec3_soa_resize(s, count) glisy_vec3_soa_resize(&(s), (count))
+
+/**
+ * Appends vec3 v to vec3_soa s. Returns 0 on success and -1 when
+ * allocation fails.
+ */
+
+static inline int
+glisy_vec3_soa_push (vec3_soa *s, vec3 v) {
+  if (glisy_vec3_soa_reserve(s, s->count + 1)) return -1;
+  s->x[s->count] = v.x;
+  s->y[s->count] = v.y;
+  s->z[s->count] = v.z;
+  s->count++;
+  return 0;
+}
+
+#define vec3_soa_push(s, v) glisy_vec3_soa_push(&(s), (v))
+
+/**
+ * Returns element i of vec3_soa s.
+ */
+
+static inline vec3
+glisy_vec3_soa_get (const vec3_soa *s, size_t i) {
+  return (vec3) {s->x[i], s->y[i], s->z[i]};
+}
+
+#define vec3_soa_get(s, i) glisy_vec3_soa_get(&(s), (i))
+
+/**
+ * Sets element i of vec3_soa s to vec3 v.
+ */
+
+static inline void
+glisy_vec3_soa_set (vec3_soa *s, size_t i, vec3 v) {
+  s->x[i] = v.x;
+  s->y[i] = v.y;
+  s->z[i] = v.z;
+}
+
+#define vec3_soa_set(s, i, v) glisy_vec3_soa_set(&(s), (i), (v))
+
+/**
+ * Replaces the contents of vec3_soa s with count vec3s gathered
+ * from in. Returns 0 on success and -1 when allocation fails.
+ */
+
+static inline int
+glisy_vec3_soa_from_vec3 (vec3_soa *s, const vec3 *in, size_t count) {
+  size_t i = 0;
+  if (glisy_vec3_soa_resize(s, count)) return -1;
+#ifdef GLISY_SSE2
+  for (; i < count - count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane x, y, z;
+    glisy_vec3_load_lanes(in + i, &x, &y, &z);
+    glisy_lane_store(s->x + i, x);
+    glisy_lane_store(s->y + i, y);
+    glisy_lane_store(s->z + i, z);
+  }
+#endif
+  for (; i < count; ++i) {
+    glisy_vec3_soa_set(s, i, in[i]);
+  }
+  return 0;
+}
+
+/**
+ * Scatters the elements of vec3_soa s into vec3 array out.
+ */
+
+static inline void
+glisy_vec3_soa_to_vec3 (vec3 *out, const vec3_soa *s) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < s->count - s->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_vec3_store_lanes(out + i, glisy_lane_load(s->x + i),
+                           glisy_lane_load(s->y + i),
+                           glisy_lane_load(s->z + i));
+  }
+#endif
+  for (; i < s->count; ++i) {
+    out[i] = glisy_vec3_soa_get(s, i);
+  }
+}
+
+/**
+ * Replaces the contents of vec3_soa s with the x, y and z of count
+ * vec4s gathered from in. Returns 0 on success and -1 when
+ * allocation fails.
+ */
+
+static inline int
+glisy_vec3_soa_from_vec4 (vec3_soa *s, const vec4 *in, size_t count) {
+  size_t i = 0;
+  if (glisy_vec3_soa_resize(s, count)) return -1;
+#ifdef GLISY_SSE2
+  for (; i < count - count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane x, y, z, w;
+    glisy_vec4_load_lanes(&in[i].x, &x, &y, &z, &w);
+    glisy_lane_store(s->x + i, x);
+    glisy_lane_store(s->y + i, y);
+    glisy_lane_store(s->z + i, z);
+  }
+#endif
+  for (; i < count; ++i) {
+    glisy_vec3_soa_set(s, i, (vec3) {in[i].x, in[i].y, in[i].z});
+  }
+  return 0;
+}
+
+/**
+ * Scatters the elements of vec3_soa s into vec4 array out with
+ * every w set to w.
+ */
+
+static inline void
+glisy_vec3_soa_to_vec4 (vec4 *out, const vec3_soa *s, float w) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < s->count - s->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_vec4_store_lanes(&out[i].x, glisy_lane_load(s->x + i),
+                           glisy_lane_load(s->y + i),
+                           glisy_lane_load(s->z + i),
+                           glisy_lane_splat(w));
+  }
+#endif
+  for (; i < s->count; ++i) {
+    out[i] = (vec4) {s->x[i], s->y[i], s->z[i], w};
+  }
+}
+
+/**
+ * Batch vec3 routines. Each applies the vec3.h routine of the same
+ * name to every element of a (and b), resizing out to a's count.
+ * a and b must have the same count; out may be a or b. They return
+ * 0 on success and -1 when resizing out fails.
+ */
+
+static inline int
+glisy_vec3_soa_add (vec3_soa *out, const vec3_soa *a, const vec3_soa *b) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_add(glisy_lane_load(a->x + i),
+                                                glisy_lane_load(b->x + i)));
+    glisy_lane_store(out->y + i, glisy_lane_add(glisy_lane_load(a->y + i),
+                                                glisy_lane_load(b->y + i)));
+    glisy_lane_store(out->z + i, glisy_lane_add(glisy_lane_load(a->z + i),
+                                                glisy_lane_load(b->z + i)));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] + b->x[i];
+    out->y[i] = a->y[i] + b->y[i];
+    out->z[i] = a->z[i] + b->z[i];
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_vec3_soa_subtract (vec3_soa *out,
+                         const vec3_soa *a,
+                         const vec3_soa *b) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_sub(glisy_lane_load(a->x + i),
+                                                glisy_lane_load(b->x + i)));
+    glisy_lane_store(out->y + i, glisy_lane_sub(glisy_lane_load(a->y + i),
+                                                glisy_lane_load(b->y + i)));
+    glisy_lane_store(out->z + i, glisy_lane_sub(glisy_lane_load(a->z + i),
+                                                glisy_lane_load(b->z + i)));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] - b->x[i];
+    out->y[i] = a->y[i] - b->y[i];
+    out->z[i] = a->z[i] - b->z[i];
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_vec3_soa_scale (vec3_soa *out, const vec3_soa *a, float s) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vs = glisy_lane_splat(s);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane_store(out->x + i, glisy_lane_mul(glisy_lane_load(a->x + i), vs));
+    glisy_lane_store(out->y + i, glisy_lane_mul(glisy_lane_load(a->y + i), vs));
+    glisy_lane_store(out->z + i, glisy_lane_mul(glisy_lane_load(a->z + i), vs));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] * s;
+    out->y[i] = a->y[i] * s;
+    out->z[i] = a->z[i] * s;
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_vec3_soa_cross (vec3_soa *out, const vec3_soa *a, const vec3_soa *b) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane ax = glisy_lane_load(a->x + i);
+    glisy_lane ay = glisy_lane_load(a->y + i);
+    glisy_lane az = glisy_lane_load(a->z + i);
+    glisy_lane bx = glisy_lane_load(b->x + i);
+    glisy_lane by = glisy_lane_load(b->y + i);
+    glisy_lane bz = glisy_lane_load(b->z + i);
+    glisy_lane_store(out->x + i, glisy_lane_sub(glisy_lane_mul(ay, bz),
+                                                glisy_lane_mul(az, by)));
+    glisy_lane_store(out->y + i, glisy_lane_sub(glisy_lane_mul(az, bx),
+                                                glisy_lane_mul(ax, bz)));
+    glisy_lane_store(out->z + i, glisy_lane_sub(glisy_lane_mul(ax, by),
+                                                glisy_lane_mul(ay, bx)));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    vec3 v = glisy_vec3_soa_get(a, i);
+    vec3 w = glisy_vec3_soa_get(b, i);
+    glisy_vec3_cross_into(&v, &v, &w);
+    glisy_vec3_soa_set(out, i, v);
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_vec3_soa_normalize_kernel (vec3_soa *out,
+                                 const vec3_soa *a,
+                                 int fast) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane x = glisy_lane_load(a->x + i);
+    glisy_lane y = glisy_lane_load(a->y + i);
+    glisy_lane z = glisy_lane_load(a->z + i);
+    glisy_lane len = glisy_lane_madd(z, z, glisy_lane_madd(y, y,
+                     glisy_lane_mul(x, x)));
+    glisy_lane inv = glisy_lane_and(glisy_lane_gt(len, glisy_lane_zero()),
+                       fast ? glisy_lane_rsqrt_fast(len)
+                            : glisy_lane_rsqrt(len));
+    glisy_lane_store(out->x + i, glisy_lane_mul(x, inv));
+    glisy_lane_store(out->y + i, glisy_lane_mul(y, inv));
+    glisy_lane_store(out->z + i, glisy_lane_mul(z, inv));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    vec3 v = glisy_vec3_soa_get(a, i);
+    if (fast) glisy_vec3_normalize_fast_into(&v, &v);
+    else glisy_vec3_normalize_into(&v, &v);
+    glisy_vec3_soa_set(out, i, v);
+  }
+#endif
+  return 0;
+}
+
+static inline int
+glisy_vec3_soa_normalize (vec3_soa *out, const vec3_soa *a) {
+  return glisy_vec3_soa_normalize_kernel(out, a, 0);
+}
+
+/**
+ * Fast variant of vec3_soa_normalize using the rsqrt estimate and
+ * one Newton-Raphson step, see glisy_rsqrtf_fast.
+ */
+
+static inline int
+glisy_vec3_soa_normalize_fast (vec3_soa *out, const vec3_soa *a) {
+  return glisy_vec3_soa_normalize_kernel(out, a, 1);
+}
+
+static inline int
+glisy_vec3_soa_lerp (vec3_soa *out,
+                     const vec3_soa *a,
+                     const vec3_soa *b,
+                     float t) {
+  if (glisy_vec3_soa_resize(out, a->count)) return -1;
+#ifdef GLISY_SSE2
+  glisy_lane vt = glisy_lane_splat(t);
+  for (size_t i = 0; i < a->count; i += GLISY_LANES) {
+    glisy_lane ax = glisy_lane_load(a->x + i);
+    glisy_lane ay = glisy_lane_load(a->y + i);
+    glisy_lane az = glisy_lane_load(a->z + i);
+    glisy_lane_store(out->x + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->x + i), ax), ax));
+    glisy_lane_store(out->y + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->y + i), ay), ay));
+    glisy_lane_store(out->z + i, glisy_lane_madd(vt,
+      glisy_lane_sub(glisy_lane_load(b->z + i), az), az));
+  }
+#else
+  for (size_t i = 0; i < a->count; ++i) {
+    out->x[i] = a->x[i] + t * (b->x[i] - a->x[i]);
+    out->y[i] = a->y[i] + t * (b->y[i] - a->y[i]);
+    out->z[i] = a->z[i] + t * (b->z[i] - a->z[i]);
+  }
+#endif
+  return 0;
+}
+
+/**
+ * Writes the dot product of every element pair of a and b to the
+ * count floats at out.
+ */
+
+static inline void
+glisy_vec3_soa_dot (float *out, const vec3_soa *a, const vec3_soa *b) {
+  size_t i = 0;
+#ifdef GLISY_SSE2
+  for (; i < a->count - a->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane d = glisy_lane_mul(glisy_lane_load(a->x + i),
+                                  glisy_lane_load(b->x + i));
+    d = glisy_lane_madd(glisy_lane_load(a->y + i),
+                        glisy_lane_load(b->y + i), d);
+    d = glisy_lane_madd(glisy_lane_load(a->z + i),
+                        glisy_lane_load(b->z + i), d);
+    glisy_lane_store(out + i, d);
+  }
+#endif
+  for (; i < a->count; ++i) {
+    out[i] = a->x[i] * b->x[i] + a->y[i] * b->y[i] + a->z[i] * b->z[i];
+  }
+}
+
+/**
+ * Writes the length of every element of a, or with b the distance
+ * between every element pair of a and b, to the count floats at
+ * out.
+ */
+
+static inline void
+glisy_vec3_soa_length_kernel (float *out,
+                              const vec3_soa *a,
+                              const vec3_soa *b,
+                              int fast) {
+  size_t i = 0;
+#ifdef GLISY_FAST_MATH
+  fast = 1;
+#endif
+#ifdef GLISY_SSE2
+  for (; i < a->count - a->count % GLISY_LANES; i += GLISY_LANES) {
+    glisy_lane x = glisy_lane_load(a->x + i);
+    glisy_lane y = glisy_lane_load(a->y + i);
+    glisy_lane z = glisy_lane_load(a->z + i);
+    if (b) {
+      x = glisy_lane_sub(glisy_lane_load(b->x + i), x);
+      y = glisy_lane_sub(glisy_lane_load(b->y + i), y);
+      z = glisy_lane_sub(glisy_lane_load(b->z + i), z);
+    }
+    glisy_lane len = glisy_lane_madd(z, z, glisy_lane_madd(y, y,
+                     glisy_lane_mul(x, x)));
+    glisy_lane_store(out + i, fast ? glisy_lane_sqrt_fast(len)
+                                   : glisy_lane_sqrt(len));
+  }
+#endif
+  for (; i < a->count; ++i) {
+    float x = a->x[i], y = a->y[i], z = a->z[i];
+    if (b) {
+      x = b->x[i] - x;
+      y = b->y[i] - y;
+      z = b->z[i] - z;
+    }
+    float len = x * x + y * y + z * z;
+    out[i] = fast ? glisy_sqrtf_fast(len) : glisy_sqrtf(len);
+  }
+}
+
+static inline void
+glisy_vec3_soa_length (float *out, const vec3_soa *a) {
+  glisy_vec3_soa_length_kernel(out, a, NULL, 0);
+}
+
+static inline void
+glisy_vec3_soa_length_fast (float *out, const vec3_soa *a) {
+  glisy_vec3_soa_length_kernel(out, a, NULL, 1);
+}
+
+static inline void
+glisy_vec3_soa_distance (float *out, const vec3_soa *a, const vec3_soa *b) {
+  glisy_vec3_soa_length_kernel(out, a, b, 0);
+}
+
+static inline void
+glisy_vec3_soa_distance_fast (float *out,
+                              const vec3_soa *a,
+                              const vec3_soa *b) {
+  glisy_vec3_soa_length_kernel(out, a, b, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -3,11 +3,11 @@
 
 #include <time.h>
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
+#include <glisy/simd.h>
+#include <glisy/format.h>
 
 /**
  * vec4 struct type.
@@ -16,6 +16,18 @@ extern "C" {
 typedef struct vec4 vec4;
 struct vec4 { float x; float y; float z; float w; };
 
+/**
+ * Types used by vec4 routines. Included after the
+ * vec4 struct so cyclic includes always see it complete.
+ */
+
+#include <glisy/mat4.h>
+#include <glisy/quat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * vec4 initializer.
  */
@@ -27,231 +39,694 @@ struct vec4 { float x; float y; float z; float w; };
  * Clones and returns vec4.
  */
 
-#define vec4_clone(vec) ((vec4) {(vec).x, (vec).y, (vec).z, (vec).w})
+static inline vec4
+glisy_vec4_clone (vec4 vec) {
+  return (vec4) {vec.x, vec.y, vec.z, vec.w};
+}
+
+#define vec4_clone(vec) glisy_vec4_clone((vec))
 
 /**
  * Subtracts vec4 b from vec4 a.
  */
 
+static inline void
+glisy_vec4_subtract_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {(a->x - b->x),
+                 (a->y - b->y),
+                 (a->z - b->z),
+                 (a->w - b->w)};
+}
+
+static inline vec4
+glisy_vec4_subtract (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_subtract_into(&out, &a, &b);
+  return out;
+}
+
 #define vec4_sub vec4_subtract
-#define vec4_subtract(a, b) ((vec4) {((a).x - (b).x), \
-                                     ((a).y - (b).y), \
-                                     ((a).z - (b).z), \
-                                     ((a).w - (b).w)})
+#define vec4_subtract(a, b) glisy_vec4_subtract((a), (b))
 
 /**
  * Multiply two vec4.
  */
 
+static inline void
+glisy_vec4_multiply_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {(a->x * b->x),
+                 (a->y * b->y),
+                 (a->z * b->z),
+                 (a->w * b->w)};
+}
+
+static inline vec4
+glisy_vec4_multiply (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_multiply_into(&out, &a, &b);
+  return out;
+}
+
 #define vec4_mul vec4_multiply
-#define vec4_multiply(a, b) ((vec4) {((a).x * (b).x), \
-                                     ((a).y * (b).y), \
-                                     ((a).z * (b).z), \
-                                     ((a).w * (b).w)})
+#define vec4_multiply(a, b) glisy_vec4_multiply((a), (b))
 
 /**
  * Divide two vec4 a by vec4 b
  */
 
+static inline void
+glisy_vec4_divide_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {(a->x / b->x),
+                 (a->y / b->y),
+                 (a->z / b->z),
+                 (a->w / b->w)};
+}
+
+static inline vec4
+glisy_vec4_divide (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_divide_into(&out, &a, &b);
+  return out;
+}
+
 #define vec4_div vec4_divide
-#define vec4_divide(a, b) ((vec4) {((a).x / (b).x), \
-                                   ((a).y / (b).y), \
-                                   ((a).z / (b).z), \
-                                   ((a).w / (b).w)})
+#define vec4_divide(a, b) glisy_vec4_divide((a), (b))
 
 /**
  * Copy vec4 b into vec4 a
  */
 
-#define vec4_copy(a, b)  ({       \
-  vec4 *tmp = (vec4 *) &(a);      \
-  (tmp->x = b.x);                 \
-  (tmp->y = b.y);                 \
-  (tmp->z = b.z);                 \
-  (tmp->w = b.w);                 \
-  (*tmp);                         \
-})
+static inline vec4
+glisy_vec4_copy (vec4 *a, vec4 b) {
+  a->x = b.x;
+  a->y = b.y;
+  a->z = b.z;
+  a->w = b.w;
+  return *a;
+}
+
+#define vec4_copy(a, b) glisy_vec4_copy(&(a), (b))
 
 /**
  * Sets x and y component of vec4.
  */
 
-#define vec4_set(v, a, b, c, d)  ({       \
-  vec4 *tmp = &(v);                       \
-  tmp->x = ((float) a);                   \
-  tmp->y = ((float) b);                   \
-  tmp->z = ((float) c);                   \
-  tmp->w = ((float) d);                   \
-  (*tmp);                                 \
-})
+static inline vec4
+glisy_vec4_set (vec4 *v, float a, float b, float c, float d) {
+  v->x = a;
+  v->y = b;
+  v->z = c;
+  v->w = d;
+  return *v;
+}
+
+#define vec4_set(v, a, b, c, d) glisy_vec4_set(&(v), (a), (b), (c), (d))
 
 /**
  * Add two vectors together.
  */
 
-#define vec4_add(a, b) ((vec4) {((a).x + (b).x), \
-                                ((a).y + (b).y), \
-                                ((a).z + (b).z), \
-                                ((a).w + (b).w)})
+static inline void
+glisy_vec4_add_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {(a->x + b->x),
+                 (a->y + b->y),
+                 (a->z + b->z),
+                 (a->w + b->w)};
+}
+
+static inline vec4
+glisy_vec4_add (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_add_into(&out, &a, &b);
+  return out;
+}
+
+#define vec4_add(a, b) glisy_vec4_add((a), (b))
 
 /**
  * Returns the maximum of two vec4 inputs.
  */
 
-#define vec4_max(a, b) ((vec4) {fmaxf((a).x, (b).x), \
-                                fmaxf((a).y, (b).y), \
-                                fmaxf((a).z, (b).z), \
-                                fmaxf((a).w, (b).w)})
+static inline void
+glisy_vec4_max_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {fmaxf(a->x, b->x),
+                 fmaxf(a->y, b->y),
+                 fmaxf(a->z, b->z),
+                 fmaxf(a->w, b->w)};
+}
+
+static inline vec4
+glisy_vec4_max (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_max_into(&out, &a, &b);
+  return out;
+}
+
+#define vec4_max(a, b) glisy_vec4_max((a), (b))
 
 /**
  * Returns the minimum of two vec4 inputs.
  */
 
-#define vec4_min(a, b) ((vec4) {fminf((a).x, (b).x), \
-                                fminf((a).y, (b).y), \
-                                fminf((a).z, (b).z), \
-                                fminf((a).w, (b).w)})
+static inline void
+glisy_vec4_min_into (vec4 *out, const vec4 *a, const vec4 *b) {
+  *out = (vec4) {fminf(a->x, b->x),
+                 fminf(a->y, b->y),
+                 fminf(a->z, b->z),
+                 fminf(a->w, b->w)};
+}
+
+static inline vec4
+glisy_vec4_min (vec4 a, vec4 b) {
+  vec4 out;
+  glisy_vec4_min_into(&out, &a, &b);
+  return out;
+}
+
+#define vec4_min(a, b) glisy_vec4_min((a), (b))
 
 /**
  * Scale a vec4 by a scalar number.
  */
 
-#define vec4_scale(a, s) ((vec4) {((a).x * s), \
-                                  ((a).y * s), \
-                                  ((a).z * s), \
-                                  ((a).w * s)})
+static inline void
+glisy_vec4_scale_into (vec4 *out, const vec4 *a, float s) {
+  *out = (vec4) {(a->x * s),
+                 (a->y * s),
+                 (a->z * s),
+                 (a->w * s)};
+}
+
+static inline vec4
+glisy_vec4_scale (vec4 a, float s) {
+  vec4 out;
+  glisy_vec4_scale_into(&out, &a, s);
+  return out;
+}
+
+#define vec4_scale(a, s) glisy_vec4_scale((a), (s))
 
 /**
  * Calculates the Euclidean distance for a vec4.
  */
 
-#define vec4_distance(a, b) (float) sqrt(pow((b).x - (a).x, 2) + \
-                                         pow((b).y - (a).y, 2) + \
-                                         pow((b).z - (a).z, 2) + \
-                                         pow((b).w - (a).w, 2))
+static inline float
+glisy_vec4_distance (vec4 a, vec4 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z, w = b.w - a.w;
+  return glisy_sqrtf(x * x + y * y + z * z + w * w);
+}
+
+#define vec4_distance(a, b) glisy_vec4_distance((a), (b))
+
+/**
+ * Fast variant of vec4_distance using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec4_distance_fast (vec4 a, vec4 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z, w = b.w - a.w;
+  return glisy_sqrtf_fast(x * x + y * y + z * z + w * w);
+}
+
+#define vec4_distance_fast(a, b) glisy_vec4_distance_fast((a), (b))
 
 /**
  * Calculates the squared distance for a vec4.
  */
 
-#define vec4_distance_squared(a, b) (float) (powf((b).x - (a).x, 2) + \
-                                             powf((b).y - (a).y, 2) + \
-                                             powf((b).z - (a).z, 2) + \
-                                             powf((b).w - (a).w, 2))
+static inline float
+glisy_vec4_distance_squared (vec4 a, vec4 b) {
+  float x = b.x - a.x, y = b.y - a.y, z = b.z - a.z, w = b.w - a.w;
+  return x * x + y * y + z * z + w * w;
+}
+
+#define vec4_distance_squared(a, b) glisy_vec4_distance_squared((a), (b))
 
 /**
  * Calculates the length of a vec4.
  */
 
-#define vec4_length(a) (float) sqrt(powf((a).x, 2) + \
-                                    powf((a).y, 2) + \
-                                    powf((a).z, 2) + \
-                                    powf((a).w, 2))
+static inline float
+glisy_vec4_length (vec4 a) {
+  return glisy_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+}
+
+#define vec4_length(a) glisy_vec4_length((a))
+
+/**
+ * Fast variant of vec4_length using glisy_sqrtf_fast.
+ */
+
+static inline float
+glisy_vec4_length_fast (vec4 a) {
+  return glisy_sqrtf_fast(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+}
+
+#define vec4_length_fast(a) glisy_vec4_length_fast((a))
 
 /**
  * Calculates the squard length of a vec4.
  */
 
-#define vec4_length_squared(a) (float) (powf((a).x, 2) + \
-                                        powf((a).y, 2) + \
-                                        powf((a).z, 2) + \
-                                        powf((a).w, 2))
+static inline float
+glisy_vec4_length_squared (vec4 a) {
+  return a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w;
+}
+
+#define vec4_length_squared(a) glisy_vec4_length_squared((a))
 
 /**
  * Returns the negation of a vec4.
  */
 
-#define vec4_negate(a) ( vec4_scale((a), -1)
+static inline void
+glisy_vec4_negate_into (vec4 *out, const vec4 *a) {
+  *out = (vec4) {-a->x, -a->y, -a->z, -a->w};
+}
+
+static inline vec4
+glisy_vec4_negate (vec4 a) {
+  vec4 out;
+  glisy_vec4_negate_into(&out, &a);
+  return out;
+}
+
+#define vec4_negate(a) glisy_vec4_negate((a))
 
 /**
  * Calculates the inverse of a vec4.
  */
 
-#define vec4_inverse(a) ((vec4) {(1.0f/(a).x), \
-                                 (1.0f/(a).y), \
-                                 (1.0f/(a).z), \
-                                 (1.0f/(a).w)})
+static inline void
+glisy_vec4_inverse_into (vec4 *out, const vec4 *a) {
+  *out = (vec4) {(1.0f / a->x),
+                 (1.0f / a->y),
+                 (1.0f / a->z),
+                 (1.0f / a->w)};
+}
+
+static inline vec4
+glisy_vec4_inverse (vec4 a) {
+  vec4 out;
+  glisy_vec4_inverse_into(&out, &a);
+  return out;
+}
+
+#define vec4_inverse(a) glisy_vec4_inverse((a))
 
 /**
  * Returns a normalized vec4.
  */
 
-#define vec4_normalize(a)  ({          \
-  float len = ((a).x * (a).x) +        \
-              ((a).y * (a).y) +        \
-              ((a).z * (a).z) +        \
-              ((a).w * (a).w);         \
-  vec4 vec = vec4(0);                  \
-  if (len > 0) {                       \
-    len = (1/sqrt(len));               \
-    vec.x = ((a).x * len);             \
-    vec.y = ((a).y * len);             \
-    vec.z = ((a).z * len);             \
-    vec.w = ((a).w * len);             \
-  }                                    \
-  (vec);                               \
-})
+static inline void
+glisy_vec4_normalize_into (vec4 *out, const vec4 *a) {
+  float len = (a->x * a->x) +
+              (a->y * a->y) +
+              (a->z * a->z) +
+              (a->w * a->w);
+  vec4 vec = {0, 0, 0, 0};
+  if (len > 0) {
+    len = glisy_rsqrtf(len);
+    vec.x = (a->x * len);
+    vec.y = (a->y * len);
+    vec.z = (a->z * len);
+    vec.w = (a->w * len);
+  }
+  *out = vec;
+}
+
+static inline vec4
+glisy_vec4_normalize (vec4 a) {
+  vec4 out;
+  glisy_vec4_normalize_into(&out, &a);
+  return out;
+}
+
+#define vec4_normalize(a) glisy_vec4_normalize((a))
+
+/**
+ * Fast variant of vec4_normalize using glisy_rsqrtf_fast. The
+ * result has unit length to within 5e-7.
+ */
+
+static inline void
+glisy_vec4_normalize_fast_into (vec4 *out, const vec4 *a) {
+  float len = a->x * a->x + a->y * a->y + a->z * a->z + a->w * a->w;
+  float s = len > 0 ? glisy_rsqrtf_fast(len) : 0;
+  *out = (vec4) {a->x * s, a->y * s, a->z * s, a->w * s};
+}
+
+static inline vec4
+glisy_vec4_normalize_fast (vec4 a) {
+  vec4 out;
+  glisy_vec4_normalize_fast_into(&out, &a);
+  return out;
+}
+
+#define vec4_normalize_fast(a) glisy_vec4_normalize_fast((a))
 
 /**
  * Calculates the dot product of vec4 a
  * and vec4 b.
  */
 
-#define vec4_dot(a, b) (float) (((a).x * (b).x) + \
-                                ((a).y * (b).y) + \
-                                ((a).z * (b).z) + \
-                                ((a).w * (b).w))
+static inline float
+glisy_vec4_dot (vec4 a, vec4 b) {
+  return (a.x * b.x) +
+         (a.y * b.y) +
+         (a.z * b.z) +
+         (a.w * b.w);
+}
+
+#define vec4_dot(a, b) glisy_vec4_dot((a), (b))
+
 /**
  * Calculates a linear interpolation between
  * vec4 a and vec4 b with interpolation factor t.
  */
 
-#define vec4_lerp(a, b, t) ((vec4) {(a).x + t * ((b).x - (a).x), \
-                                    (a).y + t * ((b).y - (a).y), \
-                                    (a).z + t * ((b).z - (a).z), \
-                                    (a).w + t * ((b).w - (a).w)})
+static inline void
+glisy_vec4_lerp_into (vec4 *out, const vec4 *a, const vec4 *b, float t) {
+  *out = (vec4) {a->x + t * (b->x - a->x),
+                 a->y + t * (b->y - a->y),
+                 a->z + t * (b->z - a->z),
+                 a->w + t * (b->w - a->w)};
+}
+
+static inline vec4
+glisy_vec4_lerp (vec4 a, vec4 b, float t) {
+  vec4 out;
+  glisy_vec4_lerp_into(&out, &a, &b, t);
+  return out;
+}
+
+#define vec4_lerp(a, b, t) glisy_vec4_lerp((a), (b), (t))
 
 /**
  * Calculates a transformed vec4 a with a mat4 b.
  */
 
-#define vec4_transform_mat4(a, b) ((vec4) {                              \
-  (b).m11 * (a).x + (b).m21 * (a).y + (b).m31 * (a).z + (b).m41 * (a).w, \
-  (b).m12 * (a).x + (b).m22 * (a).y + (b).m32 * (a).z + (b).m42 * (a).w, \
-  (b).m13 * (a).x + (b).m23 * (a).y + (b).m33 * (a).z + (b).m43 * (a).w, \
-  (b).m14 * (a).x + (b).m24 * (a).y + (b).m34 * (a).z + (b).m44 * (a).w, \
-})
+static inline void
+glisy_vec4_transform_mat4_scalar (vec4 *out, const vec4 *a, const mat4 *b) {
+  *out = (vec4) {
+    b->m11 * a->x + b->m21 * a->y + b->m31 * a->z + b->m41 * a->w,
+    b->m12 * a->x + b->m22 * a->y + b->m32 * a->z + b->m42 * a->w,
+    b->m13 * a->x + b->m23 * a->y + b->m33 * a->z + b->m43 * a->w,
+    b->m14 * a->x + b->m24 * a->y + b->m34 * a->z + b->m44 * a->w
+  };
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * SIMD transform. Bit exact with the scalar path under SSE2,
+ * within 2 ulp of the largest partial product with FMA.
+ */
+
+static inline void
+glisy_vec4_transform_mat4_sse (vec4 *out, const vec4 *a, const mat4 *b) {
+  __m128 v = _mm_loadu_ps(&a->x);
+  __m128 r = _mm_mul_ps(_mm_load_ps(&b->m11), glisy_simd_splat(v, 0));
+  r = glisy_simd_madd(_mm_load_ps(&b->m21), glisy_simd_splat(v, 1), r);
+  r = glisy_simd_madd(_mm_load_ps(&b->m31), glisy_simd_splat(v, 2), r);
+  r = glisy_simd_madd(_mm_load_ps(&b->m41), glisy_simd_splat(v, 3), r);
+  _mm_storeu_ps(&out->x, r);
+}
+#endif
+
+static inline void
+glisy_vec4_transform_mat4_into (vec4 *out, const vec4 *a, const mat4 *b) {
+#ifdef GLISY_SSE2
+  glisy_vec4_transform_mat4_sse(out, a, b);
+#else
+  glisy_vec4_transform_mat4_scalar(out, a, b);
+#endif
+}
+
+static inline vec4
+glisy_vec4_transform_mat4 (vec4 a, mat4 b) {
+  vec4 out;
+  glisy_vec4_transform_mat4_into(&out, &a, &b);
+  return out;
+}
+
+#define vec4_transform_mat4(a, b) glisy_vec4_transform_mat4((a), (b))
+
+/**
+ * Transforms count contiguous vec4s by mat4 b. Every vector is
+ * read and written once, in order, so out may be in.
+ */
+
+static inline void
+glisy_vec4_transform_mat4_batch_scalar (vec4 *out,
+                                        const vec4 *in,
+                                        size_t count,
+                                        const mat4 *b) {
+  for (size_t i = 0; i < count; ++i) {
+    glisy_vec4_transform_mat4_scalar(&out[i], &in[i], b);
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_vec4_transform_mat4_batch_sse (vec4 *out,
+                                     const vec4 *in,
+                                     size_t count,
+                                     const mat4 *b) {
+  __m128 b0 = _mm_load_ps(&b->m11);
+  __m128 b1 = _mm_load_ps(&b->m21);
+  __m128 b2 = _mm_load_ps(&b->m31);
+  __m128 b3 = _mm_load_ps(&b->m41);
+  for (size_t i = 0; i < count; ++i) {
+    __m128 v = _mm_loadu_ps(&in[i].x);
+    __m128 r = _mm_mul_ps(b0, glisy_simd_splat(v, 0));
+    r = glisy_simd_madd(b1, glisy_simd_splat(v, 1), r);
+    r = glisy_simd_madd(b2, glisy_simd_splat(v, 2), r);
+    r = glisy_simd_madd(b3, glisy_simd_splat(v, 3), r);
+    _mm_storeu_ps(&out[i].x, r);
+  }
+}
+#endif
+
+#ifdef GLISY_AVX
+static inline void
+glisy_vec4_transform_mat4_batch_avx (vec4 *out,
+                                     const vec4 *in,
+                                     size_t count,
+                                     const mat4 *b) {
+  __m256 b0 = _mm256_broadcast_ps((const __m128 *) &b->m11);
+  __m256 b1 = _mm256_broadcast_ps((const __m128 *) &b->m21);
+  __m256 b2 = _mm256_broadcast_ps((const __m128 *) &b->m31);
+  __m256 b3 = _mm256_broadcast_ps((const __m128 *) &b->m41);
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256 v = _mm256_loadu_ps(&in[i].x);
+    __m256 r = _mm256_mul_ps(b0, _mm256_shuffle_ps(v, v, 0x00));
+    r = glisy_simd_madd256(b1, _mm256_shuffle_ps(v, v, 0x55), r);
+    r = glisy_simd_madd256(b2, _mm256_shuffle_ps(v, v, 0xaa), r);
+    r = glisy_simd_madd256(b3, _mm256_shuffle_ps(v, v, 0xff), r);
+    _mm256_storeu_ps(&out[i].x, r);
+  }
+  glisy_vec4_transform_mat4_batch_sse(out + i, in + i, count - i, b);
+}
+#endif
+
+static inline void
+glisy_vec4_transform_mat4_batch (vec4 *out,
+                                 const vec4 *in,
+                                 size_t count,
+                                 const mat4 *b) {
+#if defined(GLISY_AVX)
+  glisy_vec4_transform_mat4_batch_avx(out, in, count, b);
+#elif defined(GLISY_SSE2)
+  glisy_vec4_transform_mat4_batch_sse(out, in, count, b);
+#else
+  glisy_vec4_transform_mat4_batch_scalar(out, in, count, b);
+#endif
+}
+
+#ifdef GLISY_SSE2
+
+/**
+ * Loads GLISY_LANES consecutive vec4s (or quats) at p as x, y, z
+ * and w lanes. Under AVX vectors i and i + 4 share a register and
+ * each 128 bit half is transposed in place.
+ */
+
+static inline void
+glisy_vec4_load_lanes (const float *p,
+                       glisy_lane *x, glisy_lane *y,
+                       glisy_lane *z, glisy_lane *w) {
+#ifdef GLISY_AVX
+  *x = _mm256_loadu2_m128(p + 16, p + 0);
+  *y = _mm256_loadu2_m128(p + 20, p + 4);
+  *z = _mm256_loadu2_m128(p + 24, p + 8);
+  *w = _mm256_loadu2_m128(p + 28, p + 12);
+#else
+  *x = _mm_loadu_ps(p + 0);
+  *y = _mm_loadu_ps(p + 4);
+  *z = _mm_loadu_ps(p + 8);
+  *w = _mm_loadu_ps(p + 12);
+#endif
+  glisy_lane_transpose4(x, y, z, w);
+}
+
+/**
+ * Stores x, y, z and w lanes as GLISY_LANES consecutive vec4s.
+ */
+
+static inline void
+glisy_vec4_store_lanes (float *p,
+                        glisy_lane x, glisy_lane y,
+                        glisy_lane z, glisy_lane w) {
+  glisy_lane_transpose4(&x, &y, &z, &w);
+#ifdef GLISY_AVX
+  _mm256_storeu2_m128(p + 16, p + 0, x);
+  _mm256_storeu2_m128(p + 20, p + 4, y);
+  _mm256_storeu2_m128(p + 24, p + 8, z);
+  _mm256_storeu2_m128(p + 28, p + 12, w);
+#else
+  _mm_storeu_ps(p + 0, x);
+  _mm_storeu_ps(p + 4, y);
+  _mm_storeu_ps(p + 8, z);
+  _mm_storeu_ps(p + 12, w);
+#endif
+}
+#endif
+
+/**
+ * Transforms SoA streams of count x, y, z and w floats by mat4 b
+ * into four output streams. w may be NULL for points (w = 1),
+ * which saves a stream read and four multiplies per point.
+ * Output streams may be the input streams.
+ */
+
+static inline void
+glisy_vec4_transform_mat4_streams_scalar (float *ox, float *oy,
+                                          float *oz, float *ow,
+                                          const float *x, const float *y,
+                                          const float *z, const float *w,
+                                          size_t count,
+                                          const mat4 *b) {
+  for (size_t i = 0; i < count; ++i) {
+    vec4 v = {x[i], y[i], z[i], w ? w[i] : 1.0f};
+    glisy_vec4_transform_mat4_scalar(&v, &v, b);
+    ox[i] = v.x;
+    oy[i] = v.y;
+    oz[i] = v.z;
+    ow[i] = v.w;
+  }
+}
+
+#ifdef GLISY_SSE2
+static inline void
+glisy_vec4_transform_mat4_streams_simd (float *ox, float *oy,
+                                        float *oz, float *ow,
+                                        const float *x, const float *y,
+                                        const float *z, const float *w,
+                                        size_t count,
+                                        const mat4 *b) {
+  glisy_lane m[16];
+  size_t i = 0;
+  for (int e = 0; e < 16; ++e) {
+    m[e] = glisy_lane_splat((&b->m11)[e]);
+  }
+  for (; i + GLISY_LANES <= count; i += GLISY_LANES) {
+    glisy_lane vx = glisy_lane_load(x + i);
+    glisy_lane vy = glisy_lane_load(y + i);
+    glisy_lane vz = glisy_lane_load(z + i);
+    glisy_lane r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = w ? glisy_lane_mul(glisy_lane_load(w + i), m[12 + c]) : m[12 + c];
+      r[c] = glisy_lane_madd(vx, m[c], r[c]);
+      r[c] = glisy_lane_madd(vy, m[4 + c], r[c]);
+      r[c] = glisy_lane_madd(vz, m[8 + c], r[c]);
+    }
+    glisy_lane_store(ox + i, r[0]);
+    glisy_lane_store(oy + i, r[1]);
+    glisy_lane_store(oz + i, r[2]);
+    glisy_lane_store(ow + i, r[3]);
+  }
+  glisy_vec4_transform_mat4_streams_scalar(ox + i, oy + i, oz + i, ow + i,
+                                           x + i, y + i, z + i,
+                                           w ? w + i : 0,
+                                           count - i, b);
+}
+#endif
+
+static inline void
+glisy_vec4_transform_mat4_streams (float *ox, float *oy,
+                                   float *oz, float *ow,
+                                   const float *x, const float *y,
+                                   const float *z, const float *w,
+                                   size_t count,
+                                   const mat4 *b) {
+#ifdef GLISY_SSE2
+  glisy_vec4_transform_mat4_streams_simd(ox, oy, oz, ow, x, y, z, w,
+                                         count, b);
+#else
+  glisy_vec4_transform_mat4_streams_scalar(ox, oy, oz, ow, x, y, z, w,
+                                           count, b);
+#endif
+}
 
 /**
  * Calculates a transformed vec4 a with a quat b.
  */
 
-#define vec4_transform_quat(a, b) ({                    \
-  vec4 c;                                               \
-  float x = (a).x, y = (a).y, z = (a).z, w = (a).w;     \
-  float qx = (b).x, qy = (b).y, qz = (b).z, qw = (b).w; \
-  float ix = qw * x + qy * z - qz * y;                  \
-  float iy = qw * y + qz * x - qx * z;                  \
-  float iz = qw * z + qx * y - qy * x;                  \
-  float iw = -qx * x - qy * y - qz * z;                 \
-                                                        \
-  (c).x = ix * qw + iw * -qx + iy * -qz - iz * -qy;     \
-  (c).y = iy * qw + iw * -qy + iz * -qx - ix * -qz;     \
-  (c).z = iz * qw + iw * -qz + ix * -qy - iy * -qx;     \
-  (c).w = w;                                            \
-  (c);                                                  \
-})
-
-/**
- * Returns a string representation of vec4 a.
- */
-
-#define vec4_string(a) (const char *) ({                            \
-  char str[BUFSIZ];                                                 \
-  memset(str, 0, BUFSIZ);                                           \
-  sprintf(str, "vec4(%g, %g, %g, %g)", (a).x, (a).y, (a).z, (a).w); \
-  (strdup(str));                                                    \
-})
+static inline void
+glisy_vec4_transform_quat_into (vec4 *out, const vec4 *a, const quat *b) {
+  vec4 c;
+  float x = a->x, y = a->y, z = a->z, w = a->w;
+  float qx = b->x, qy = b->y, qz = b->z, qw = b->w;
+  float ix = qw * x + qy * z - qz * y;
+  float iy = qw * y + qz * x - qx * z;
+  float iz = qw * z + qx * y - qy * x;
+  float iw = -qx * x - qy * y - qz * z;
+
+  c.x = ix * qw + iw * -qx + iy * -qz - iz * -qy;
+  c.y = iy * qw + iw * -qy + iz * -qx - ix * -qz;
+  c.z = iz * qw + iw * -qz + ix * -qy - iy * -qx;
+  c.w = w;
+  *out = c;
+}
+
+static inline vec4
+glisy_vec4_transform_quat (vec4 a, quat b) {
+  vec4 out;
+  glisy_vec4_transform_quat_into(&out, &a, &b);
+  return out;
+}
+
+#define vec4_transform_quat(a, b) glisy_vec4_transform_quat((a), (b))
+
+/**
+ * Writes a string representation of vec4 a to buf of size bytes,
+ * NUL terminated, and returns its full length like snprintf.
+ */
+
+static inline size_t
+glisy_vec4_format (char *buf, size_t size, vec4 a) {
+  return glisy_format_floats(buf, size, "vec4", &a.x, 4, 4);
+}
+
+#define vec4_format(buf, size, a) glisy_vec4_format((buf), (size), (a))
+
+GLISY_ARENA_FORMAT(vec4)
+
+/**
+ * Returns a string representation of vec4 a, allocated with
+ * strdup. The caller frees it.
+ */
+
+static inline const char *
+glisy_vec4_string (vec4 a) {
+  char str[GLISY_FORMAT_MAX];
+  glisy_vec4_format(str, sizeof(str), a);
+  return strdup(str);
+}
+
+#define vec4_string(a) glisy_vec4_string((a))
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <glisy/bounds.h>
+
+#include "test.h"
+
+int
+main (void) {
+  // planes
+  {
+    plane a = plane_normalize(plane({0, 3, 4}, 10));
+    assert(fcmp(a.normal.y, 0.6f) && fcmp(a.normal.z, 0.8f));
+    assert(fcmp(a.distance, 2));
+    assert(fcmp(plane_distance(a, vec3(0, 0, 0)), 2));
+    assert(fcmp(plane_distance(a, vec3(5, 3, 4)), 7));
+    a = plane_normalize(plane({0, 0, 0}, 1));
+    assert(0 == a.normal.x && 0 == a.distance);
+  }
+
+  // boxes
+  {
+    aabb a = aabb({-1, 0, 2}, {3, 2, 4});
+    vec3 c = aabb_center(a), e = aabb_extents(a);
+    assert(fcmp(c.x, 1) && fcmp(c.y, 1) && fcmp(c.z, 3));
+    assert(fcmp(e.x, 2) && fcmp(e.y, 1) && fcmp(e.z, 1));
+
+    // the transformed box holds every transformed corner
+    mat4 m = mat4_translate(mat4_rotate(mat4_create(), 0.7f,
+                                        vec3_normalize(vec3(1, 2, 3))),
+                            vec3(5, -2, 1));
+    aabb b = aabb_transform_mat4(a, m);
+    for (int k = 0; k < 8; ++k) {
+      vec3 p = vec3(k & 1 ? a.max.x : a.min.x, k & 2 ? a.max.y : a.min.y,
+                    k & 4 ? a.max.z : a.min.z);
+      p = vec3_transform_mat4(p, m);
+      assert(p.x >= b.min.x - 1e-4f && p.x <= b.max.x + 1e-4f);
+      assert(p.y >= b.min.y - 1e-4f && p.y <= b.max.y + 1e-4f);
+      assert(p.z >= b.min.z - 1e-4f && p.z <= b.max.z + 1e-4f);
+    }
+    b = aabb_transform_mat4(a, mat4_translate(mat4_create(), vec3(1, 1, 1)));
+    assert(fcmp(b.min.x, 0) && fcmp(b.max.z, 5));
+  }
+
+  // containers keep their padding zero
+  {
+    sphere_soa s = sphere_soa_create();
+    aabb_soa b = aabb_soa_create();
+    for (int i = 0; i < 37; ++i) {
+      assert(0 == sphere_soa_push(s, sphere({i, 1, 2}, 0.5f * i)));
+      assert(0 == aabb_soa_push(b, aabb({i, 0, 0}, {i + 1, 1, 1})));
+    }
+    assert(37 == s.count && 0 == s.capacity % GLISY_SOA_PAD);
+    sphere c = sphere_soa_get(s, 12);
+    assert(12 == c.center.x && fcmp(c.radius, 6));
+    aabb d = aabb_soa_get(b, 36);
+    assert(36 == d.min.x && 37 == d.max.x && 1 == d.max.z);
+    assert(0 == sphere_soa_resize(s, 10));
+    assert(0 == aabb_soa_resize(b, 10));
+    for (size_t i = 10; i < s.capacity; ++i) assert(0 == s.radius[i]);
+    for (size_t i = 10; i < b.capacity; ++i) assert(0 == b.max_x[i]);
+    assert(0 == aabb_soa_reserve(b, 1000));
+    assert(9 == aabb_soa_get(b, 9).min.x && 10 == b.count);
+    sphere_soa_free(s);
+    aabb_soa_free(b);
+    assert(0 == s.x && 0 == b.min_x && 0 == b.count);
+  }
+
+  // formats
+  {
+    char buf[128];
+    assert(plane_format(buf, sizeof(buf), plane({0, 1, 0}, 2)) > 0);
+    assert(0 == strncmp(buf, "plane(normal=", 13));
+    assert(sphere_format(buf, sizeof(buf), sphere({0, 1, 0}, 2)) > 0);
+    assert(0 == strncmp(buf, "sphere(center=", 14));
+    assert(aabb_format(buf, sizeof(buf), aabb({0, 1, 0}, {2, 3, 4})) > 0);
+    assert(0 == strncmp(buf, "aabb(min=", 9));
+  }
+  return 0;
+}
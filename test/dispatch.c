@@ -0,0 +1,181 @@
+#include <assert.h>
+#include <glisy/dispatch.h>
+
+#include "test.h"
+
+#define COUNT 203
+
+static mat4 as[COUNT], bs[COUNT], ms[COUNT], es[COUNT];
+static vec3 points[COUNT], out3[COUNT], expected3[COUNT];
+static vec4 points4[COUNT], out4[COUNT], expected4[COUNT];
+static quat qa[COUNT], qb[COUNT], qo[COUNT], qe[COUNT];
+
+static inline void
+assert_close (const float *x, const float *y, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    assert(fabsf(x[i] - y[i]) <= 1e-5f * fmaxf(1, fabsf(y[i])));
+  }
+}
+
+/**
+ * Checks every slot of table k against the scalar kernels over
+ * batches of count items.
+ */
+
+static void
+assert_table (const glisy_kernels *k, size_t count) {
+  glisy_mat4_multiply_batch_scalar(es, as, bs, count);
+  k->mat4_multiply_batch(ms, as, bs, count);
+  assert_close(&ms[0].m11, &es[0].m11, 16 * count);
+
+  for (int projective = 0; projective < 2; ++projective) {
+    out3[count] = expected3[count] = vec3(7, 7, 7);
+    glisy_vec3_transform_mat4_batch_scalar(expected3, points, count,
+                                           &as[1], projective);
+    k->vec3_transform_mat4_batch(out3, points, count, &as[1], projective);
+    assert_close(&out3[0].x, &expected3[0].x, 3 * count);
+    assert(0 == memcmp(&out3[count], &expected3[count], sizeof(vec3)));
+  }
+
+  out4[count] = expected4[count] = vec4(7, 7, 7, 7);
+  glisy_vec4_transform_mat4_batch_scalar(expected4, points4, count, &as[2]);
+  k->vec4_transform_mat4_batch(out4, points4, count, &as[2]);
+  assert_close(&out4[0].x, &expected4[0].x, 4 * count);
+  assert(0 == memcmp(&out4[count], &expected4[count], sizeof(vec4)));
+
+  {
+    vec3_soa a = vec3_soa_create();
+    vec3_soa e = vec3_soa_create();
+    vec3_soa o = vec3_soa_create();
+    assert(0 == glisy_vec3_soa_from_vec3(&a, points, count));
+    if (count > 2) glisy_vec3_soa_set(&a, 2, vec3(0, 0, 0));
+    assert(0 == glisy_vec3_soa_resize(&e, count));
+    assert(0 == glisy_vec3_soa_resize(&o, count));
+    glisy_vec3_soa_normalize_scalar(&e, &a);
+    k->vec3_soa_normalize(&o, &a);
+    assert_close(o.x, e.x, count);
+    assert_close(o.y, e.y, count);
+    assert_close(o.z, e.z, count);
+    if (count > 2) assert(0 == o.x[2] && 0 == o.y[2] && 0 == o.z[2]);
+    vec3_soa_free(a);
+    vec3_soa_free(e);
+    vec3_soa_free(o);
+  }
+
+  // inside [0, 1] and extrapolating past b
+  for (float t = 0.3f; t < 2; t += 1.2f) {
+    glisy_quat_slerp_batch_scalar(qe, qa, qb, t, count);
+    k->quat_slerp_batch(qo, qa, qb, t, count);
+    assert_close(&qo[0].x, &qe[0].x, 4 * count);
+  }
+}
+
+int
+main (void) {
+  int cpu = glisy_cpu_isa();
+  assert(cpu >= GLISY_ISA_SCALAR && cpu < GLISY_ISA_COUNT);
+  assert(0 == strcmp("avx2", glisy_isa_name(GLISY_ISA_AVX2)));
+  assert(0 == strcmp("unknown", glisy_isa_name(GLISY_ISA_COUNT)));
+
+  for (int i = 0; i < COUNT; ++i) {
+    mat4 m = mat4_create();
+    mat4_rotateY(m, random_float() * 3);
+    m = mat4_translate(m, vec3(random_float(), random_float(), 2));
+    m.m14 = 0.05f * random_float();
+    as[i] = m;
+    bs[i] = mat4_scale(m, vec3(random_float() + 2, 1, 1));
+    points[i] = vec3(random_float(), random_float(), random_float());
+    points4[i] = vec4(random_float(), random_float(), random_float(), 1);
+    qa[i] = quat_normalize(quat(random_float(), random_float(),
+                                random_float(), random_float()));
+    qb[i] = quat_normalize(quat(random_float(), random_float(),
+                                random_float(), random_float()));
+  }
+  // equal, opposite and nearly equal rotations
+  qb[3] = qa[3];
+  qb[4] = quat_scale(qa[4], -1);
+  qb[20] = quat_normalize(quat_add(qa[20], quat(0, 0, 1e-4f, 0)));
+  // a point that lands on w = 0 keeps its unscaled coordinates
+  points[5] = vec3(0, 0, 0);
+  as[1].m44 = 0;
+
+  // every level the CPU runs agrees with the scalar kernels,
+  // including the tails of the wide loops
+  for (int isa = 0; isa <= cpu; ++isa) {
+    size_t counts[] = {0, 1, 7, 8, 9, 15, 16, 17, 31, 33, COUNT - 1};
+    glisy_kernels k;
+    glisy_kernels_select(&k, isa, 0);
+    for (int op = 0; op < GLISY_KERNEL_COUNT; ++op) {
+      assert(k.isa[op] <= isa);
+    }
+    for (size_t c = 0; c < sizeof(counts) / sizeof(*counts); ++c) {
+      assert_table(&k, counts[c]);
+    }
+  }
+
+  // the default table takes the widest variant of each operation
+  {
+    unsetenv("GLISY_ISA");
+    const glisy_kernels *k = glisy_dispatch_init(0);
+    assert(k == glisy_dispatch());
+    assert(k->cpu == cpu && k->cap == cpu);
+    assert(k->isa[GLISY_KERNEL_MAT4_MULTIPLY] == cpu);
+    assert(k->isa[GLISY_KERNEL_QUAT_SLERP] == cpu);
+  }
+
+  // tuning stays within what the CPU supports
+  {
+    const glisy_kernels *k = glisy_dispatch_init(GLISY_DISPATCH_TUNE);
+    for (int op = 0; op < GLISY_KERNEL_COUNT; ++op) {
+      assert(k->isa[op] <= cpu);
+    }
+    assert_table(k, COUNT - 1);
+  }
+
+  // GLISY_ISA forces a level, never above the CPU's
+  {
+    setenv("GLISY_ISA", "scalar", 1);
+    const glisy_kernels *k = glisy_dispatch_init(GLISY_DISPATCH_TUNE);
+    assert(k->cap == GLISY_ISA_SCALAR);
+    for (int op = 0; op < GLISY_KERNEL_COUNT; ++op) {
+      assert(k->isa[op] == GLISY_ISA_SCALAR);
+    }
+
+    setenv("GLISY_ISA", "avx512", 1);
+    k = glisy_dispatch_init(0);
+    assert(k->cap == cpu);
+
+    setenv("GLISY_ISA", "bogus", 1);
+    k = glisy_dispatch_init(0);
+    assert(k->cap == cpu);
+    unsetenv("GLISY_ISA");
+  }
+
+  // dispatched calls
+  {
+    vec3_soa a = vec3_soa_create();
+    vec3_soa o = vec3_soa_create();
+    glisy_dispatch_init(0);
+    glisy_dispatch_mat4_multiply_batch(ms, as, bs, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat4 e = mat4_multiply(as[i], bs[i]);
+      assert_close(&ms[i].m11, &e.m11, 16);
+    }
+    glisy_dispatch_vec3_transform_mat4_affine_batch(out3, points, COUNT,
+                                                    &as[0]);
+    for (int i = 0; i < COUNT; ++i) {
+      vec3 e = vec3_transform_mat4_affine(points[i], as[0]);
+      assert_close(&out3[i].x, &e.x, 3);
+    }
+    glisy_dispatch_vec3_transform_mat4_batch(out3, points, COUNT, &as[0]);
+    glisy_dispatch_vec4_transform_mat4_batch(out4, points4, COUNT, &as[0]);
+    glisy_dispatch_quat_slerp_batch(qo, qa, qb, 0.5f, COUNT);
+    assert(0 == glisy_vec3_soa_from_vec3(&a, points, COUNT));
+    assert(0 == glisy_dispatch_vec3_soa_normalize(&o, &a));
+    assert(o.count == COUNT);
+    vec3_soa_free(a);
+    vec3_soa_free(o);
+  }
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <glisy/dquat.h>
+
+#include "test.h"
+
+static inline trs
+random_rigid (void) {
+  trs a = trs_create();
+  quat_set_axis_angle(a.rotation,
+                      vec3_normalize(vec3(random_float(), random_float(),
+                                          random_float())),
+                      random_float() * 3.0f);
+  a.translation = vec3(random_float() * 10, random_float() * 10,
+                       random_float() * 10);
+  return a;
+}
+
+int
+main (void) {
+  seed = 7;
+  // identity
+  {
+    dquat a = dquat_create();
+    vec3 v = vec3(1, -2, 3);
+    vec3_assert_close(dquat_transform_point(a, v), v);
+    vec3_assert_close(dquat_get_translation(a), vec3(0, 0, 0));
+  }
+
+  for (int n = 0; n < 50; ++n) {
+    trs ta = random_rigid(), tb = random_rigid();
+    dquat a = dquat_from_trs(ta), b = dquat_from_trs(tb);
+    vec3 v = vec3(random_float() * 5, random_float() * 5,
+                  random_float() * 5);
+
+    // rigid transforms as trs does
+    vec3_assert_close(dquat_get_translation(a), ta.translation);
+    vec3_assert_close(dquat_transform_point(a, v),
+                      trs_transform_point(ta, v));
+    vec3_assert_close(dquat_transform_vector(a, v),
+                      glisy_trs_rotate(&ta.rotation, v));
+
+    // composition matches trs, b first
+    vec3_assert_close(dquat_transform_point(dquat_multiply(a, b), v),
+                      trs_transform_point(trs_multiply(ta, tb), v));
+
+    // the conjugate inverts
+    dquat i = dquat_multiply(a, dquat_conjugate(a));
+    vec3_assert_close(dquat_transform_point(i, v), v);
+
+    // matrices, with scale dropped on the way in
+    mat4 m = dquat_to_mat4(a);
+    vec3_assert_close(vec3_transform_mat4(v, m), dquat_transform_point(a, v));
+    mat3x4 m34 = dquat_to_mat3x4(a);
+    vec3_assert_close(mat3x4_transform_point(m34, v),
+                      dquat_transform_point(a, v));
+    trs scaled = ta;
+    scaled.scale = vec3(2, 2, 2);
+    vec3_assert_close(dquat_transform_point(
+                        dquat_from_mat4(trs_to_mat4(scaled)), v),
+                      dquat_transform_point(a, v));
+    vec3_assert_close(dquat_transform_point(
+                        dquat_from_mat3x4(trs_to_mat3x4(scaled)), v),
+                      dquat_transform_point(a, v));
+
+    // normalizing a scaled dquat restores it
+    dquat s = dquat({a.real.x * 3, a.real.y * 3, a.real.z * 3, a.real.w * 3},
+                    {a.dual.x * 3, a.dual.y * 3, a.dual.z * 3, a.dual.w * 3});
+    s = dquat_normalize(s);
+    assert(fcmp(quat_length(s.real), 1));
+    vec3_assert_close(dquat_transform_point(s, v),
+                      dquat_transform_point(a, v));
+
+    // blending ends on either input and ignores the sign of b
+    vec3_assert_close(dquat_transform_point(dquat_lerp(a, b, 0), v),
+                      dquat_transform_point(a, v));
+    vec3_assert_close(dquat_transform_point(dquat_lerp(a, b, 1), v),
+                      dquat_transform_point(b, v));
+    dquat nb = dquat({-b.real.x, -b.real.y, -b.real.z, -b.real.w},
+                     {-b.dual.x, -b.dual.y, -b.dual.z, -b.dual.w});
+    vec3_assert_close(dquat_transform_point(dquat_lerp(a, nb, 0.3f), v),
+                      dquat_transform_point(dquat_lerp(a, b, 0.3f), v));
+  }
+
+  // blending translations alone moves in a straight line
+  {
+    dquat a = dquat_from_rotation_translation(quat_create(), vec3(0, 0, 0));
+    dquat b = dquat_from_rotation_translation(quat_create(), vec3(4, 2, 0));
+    vec3_assert_close(dquat_get_translation(dquat_lerp(a, b, 0.25f)),
+                      vec3(1, 0.5f, 0));
+  }
+
+  // a zero dquat normalizes to zero
+  {
+    dquat z = dquat_normalize(dquat({0, 0, 0, 0}, {1, 2, 3, 4}));
+    assert(0 == z.real.w && 0 == z.dual.x);
+  }
+
+  // string
+  {
+    char buf[GLISY_FORMAT_MAX];
+    dquat_format(buf, sizeof(buf), dquat_create());
+    assert(0 == strncmp(buf, "dquat(real=", 11));
+    const char *str = dquat_string(dquat_create());
+    assert(0 == strcmp(str, buf));
+    free((void *) str);
+  }
+
+  return 0;
+}
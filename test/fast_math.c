@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+
+#include "test.h"
+
+#define COUNT 45
+
+/**
+ * Bound on the relative error of the rsqrt estimate after one
+ * Newton-Raphson step.
+ */
+
+#define FAST_EPSILON 5e-7
+
+static vec3 as[COUNT], bs[COUNT];
+static float lengths[COUNT], fast[COUNT];
+
+static inline void
+assert_close (double a, double b) {
+  assert(a == b || fabs(a - b) <= FAST_EPSILON * fabs(b) + 1e-30);
+}
+
+int
+main (void) {
+  // glisy_rsqrtf_fast, glisy_sqrtf_fast, subnormal up to FLT_MAX
+  {
+    for (float x = 1e-44f; x < FLT_MAX / 1.37f; x *= 1.37f) {
+      assert_close(glisy_rsqrtf_fast(x), 1.0 / sqrt(x));
+      assert_close(glisy_sqrtf_fast(x), sqrt(x));
+    }
+    assert(glisy_sqrtf_fast(0) == 0);
+    assert(isinf(glisy_rsqrtf_fast(0)));
+    assert(glisy_rsqrtf_fast(INFINITY) == 0);
+    assert(isinf(glisy_sqrtf_fast(INFINITY)));
+    assert(isnan(glisy_rsqrtf_fast(NAN)));
+  }
+
+  // squared lengths that underflow or overflow match the default path
+  {
+    vec3 tiny = vec3(1e-20f, 0, 0);
+    vec3 huge = vec3(1e20f, 1e20f, 0);
+    vec3 t = vec3_normalize_fast(tiny), e = vec3_normalize(tiny);
+    vec3 h = vec3_normalize_fast(huge), f = vec3_normalize(huge);
+    assert(vec3_length_fast(tiny) == vec3_length(tiny));
+    assert(vec3_length_fast(huge) == vec3_length(huge));
+    assert(t.x == e.x && t.y == e.y && t.z == e.z);
+    assert(h.x == f.x && h.y == f.y && h.z == f.z);
+    assert(fcmp(t.x, 1));
+  }
+
+  // vec2_length_fast, vec3_distance_fast, vec4_normalize_fast
+  {
+    vec2 a = vec2(3, 4);
+    vec3 b = vec3(1, 2, 3);
+    vec3 c = vec3(4, 6, 15);
+    vec4 d = vec4(1, -2, 2, 4);
+    assert_close(vec2_length_fast(a), 5);
+    assert_close(vec3_distance_fast(b, c), 13);
+    assert_close(vec4_length_fast(vec4_normalize_fast(d)), 1);
+    assert_close(vec4_normalize_fast(d).w, 0.8);
+  }
+
+  // zero vectors normalize to zero
+  {
+    vec3 z = vec3_normalize_fast(vec3(0, 0, 0));
+    quat q = quat_normalize_fast(quat(0, 0, 0, 0));
+    assert(z.x == 0 && z.y == 0 && z.z == 0);
+    assert(q.x == 0 && q.y == 0 && q.z == 0 && q.w == 0);
+  }
+
+  // quat_normalize_fast
+  {
+    quat q = quat_normalize_fast(quat(1, 2, -2, 4));
+    assert_close(quat_length_fast(q), 1);
+    assert_close(q.z, -0.4);
+  }
+
+  // glisy_vec3_soa_length, _distance, _normalize_fast
+  {
+    vec3_soa a = vec3_soa_create();
+    vec3_soa b = vec3_soa_create();
+    vec3_soa out = vec3_soa_create();
+    for (int i = 0; i < COUNT; ++i) {
+      as[i] = vec3(i, 1 - i, 0.5f * i);
+      bs[i] = vec3(2, i * 0.25f, -i);
+    }
+    as[3] = vec3(0, 0, 0);
+    as[5] = vec3(1e-20f, 0, 0);
+    as[6] = vec3(1e20f, 1e20f, 0);
+    assert(0 == glisy_vec3_soa_from_vec3(&a, as, COUNT));
+    assert(0 == glisy_vec3_soa_from_vec3(&b, bs, COUNT));
+
+    glisy_vec3_soa_length(lengths, &a);
+    glisy_vec3_soa_length_fast(fast, &a);
+    for (int i = 0; i < COUNT; ++i) {
+      assert_close(lengths[i], vec3_length(as[i]));
+      assert_close(fast[i], lengths[i]);
+    }
+
+    glisy_vec3_soa_distance(lengths, &a, &b);
+    glisy_vec3_soa_distance_fast(fast, &a, &b);
+    for (int i = 0; i < COUNT; ++i) {
+      assert_close(lengths[i], vec3_distance(as[i], bs[i]));
+      assert_close(fast[i], lengths[i]);
+    }
+
+    assert(0 == glisy_vec3_soa_normalize_fast(&out, &a));
+    for (int i = 0; i < COUNT; ++i) {
+      vec3 v = vec3_soa_get(out, i);
+      vec3 e = vec3_normalize(as[i]);
+      assert(fcmp(v.x, e.x));
+      assert(fcmp(v.y, e.y));
+      assert(fcmp(v.z, e.z));
+    }
+
+    vec3_soa_free(a);
+    vec3_soa_free(b);
+    vec3_soa_free(out);
+  }
+
+  // glisy_quat_soa_normalize_fast
+  {
+    quat_soa q = quat_soa_create();
+    for (int i = 0; i < COUNT; ++i) {
+      assert(0 == quat_soa_push(q, quat(i, 1, -i, 2)));
+    }
+    quat_soa_set(q, 5, quat(1e-19f, 0, 0, 0));
+    assert(0 == glisy_quat_soa_normalize_fast(&q, &q));
+    for (int i = 0; i < COUNT; ++i) {
+      assert_close(quat_length(quat_soa_get(q, i)), 1);
+    }
+    quat_soa_free(q);
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/trs.h>
+
+#include "test.h"
+
+/**
+ * Formats f and returns the text in a static buffer.
+ */
+
+static const char *
+text (float f) {
+  static char buf[GLISY_FORMAT_FLOAT_MAX + 1];
+  size_t n = glisy_format_float(buf, f);
+  assert(n <= GLISY_FORMAT_FLOAT_MAX);
+  buf[n] = 0;
+  return buf;
+}
+
+int
+main (void) {
+  // shortest digits, %g style layout
+  {
+    assert(0 == strcmp("0", text(0.0f)));
+    assert(0 == strcmp("-0", text(-0.0f)));
+    assert(0 == strcmp("1", text(1.0f)));
+    assert(0 == strcmp("-2.5", text(-2.5f)));
+    assert(0 == strcmp("0.1", text(0.1f)));
+    assert(0 == strcmp("0.33333334", text(1.0f / 3.0f)));
+    assert(0 == strcmp("100", text(100.0f)));
+    assert(0 == strcmp("123456790", text(123456789.0f)));
+    assert(0 == strcmp("1e+09", text(1e9f)));
+    assert(0 == strcmp("0.0001", text(1e-4f)));
+    assert(0 == strcmp("1.5e-05", text(1.5e-5f)));
+    assert(0 == strcmp("3.4028235e+38", text(FLT_MAX)));
+    assert(0 == strcmp("1.1754944e-38", text(FLT_MIN)));
+    assert(0 == strcmp("1e-45", text(1e-45f)));
+    assert(0 == strcmp("inf", text(INFINITY)));
+    assert(0 == strcmp("-inf", text(-INFINITY)));
+    assert(0 == strcmp("nan", text(NAN)));
+  }
+
+  // every float reads back exactly
+  for (int i = 0; i < 200000; ++i) {
+    uint32_t bits = random_bits();
+    float f, g;
+    memcpy(&f, &bits, sizeof(f));
+    if (isnan(f)) continue;
+    g = strtof(text(f), NULL);
+    assert(0 == memcmp(&f, &g, sizeof(f)));
+  }
+
+  // types format into caller buffers
+  {
+    char buf[GLISY_FORMAT_MAX];
+    assert(13 == vec3_format(buf, sizeof(buf), vec3(1, 2, 3)));
+    assert(0 == strcmp("vec3(1, 2, 3)", buf));
+    assert(0 == strcmp("quat(0, 0, 0, 1)",
+                       (quat_format(buf, sizeof(buf), quat(0, 0, 0, 1)),
+                        buf)));
+    mat4_format(buf, sizeof(buf), mat4_create());
+    assert(0 == strcmp("mat4(1, 0, 0, 0,\n"
+                       "     0, 1, 0, 0,\n"
+                       "     0, 0, 1, 0,\n"
+                       "     0, 0, 0, 1)", buf));
+    mat2_format(buf, sizeof(buf), mat2(1, 2, 3, 4));
+    assert(0 == strcmp("mat2(1, 2,\n     3, 4)", buf));
+    trs_format(buf, sizeof(buf), trs_create());
+    assert(0 == strcmp("trs(translation=(0, 0, 0), rotation=(0, 0, 0, 1), "
+                       "scale=(1, 1, 1))", buf));
+  }
+
+  // truncation reports the full length, like snprintf
+  {
+    char buf[8];
+    memset(buf, 'x', sizeof(buf));
+    assert(22 == vec3_format(buf, 8, vec3(0.5f, 0.25f, 0.125f)));
+    assert(0 == strcmp("vec3(0.", buf));
+    assert(22 == vec3_format(NULL, 0, vec3(0.5f, 0.25f, 0.125f)));
+    assert(22 == vec3_format(buf, 1, vec3(0.5f, 0.25f, 0.125f)));
+    assert(0 == buf[0]);
+  }
+
+  // the allocating wrappers are unchanged in use
+  {
+    const char *s = vec4_string(vec4(1, -1, 0.5f, 2));
+    assert(0 == strcmp("vec4(1, -1, 0.5, 2)", s));
+    free((void *) s);
+  }
+
+  // arenas pack strings until full and are reused after reset
+  {
+    char memory[64];
+    glisy_arena arena = glisy_arena(memory, sizeof(memory));
+    const char *a = glisy_arena_format(arena, vec3, vec3(1, 2, 3));
+    const char *b = glisy_arena_format(arena, vec2, vec2(4, 5));
+    assert(a && b);
+    assert(0 == strcmp("vec3(1, 2, 3)", a));
+    assert(0 == strcmp("vec2(4, 5)", b));
+    assert(arena.used == 14 + 11);
+    assert(NULL == glisy_arena_format(arena, mat4, mat4_create()));
+    assert(arena.used == 25);
+    glisy_arena_reset(arena);
+    assert(memory == glisy_arena_format(arena, quat, quat(0, 0, 0, 1)));
+  }
+
+  // arena_format evaluates its arena argument once
+  {
+    char memory[2][32];
+    glisy_arena arenas[2] = {
+      glisy_arena(memory[0], sizeof(memory[0])),
+      glisy_arena(memory[1], sizeof(memory[1]))
+    };
+    int i = 0;
+    const char *s = glisy_arena_format(arenas[i++], vec2, vec2(1, 2));
+    assert(1 == i);
+    assert(memory[0] == s);
+    assert(0 == strcmp("vec2(1, 2)", s));
+    assert(arenas[0].used == 11 && arenas[1].used == 0);
+  }
+
+  return 0;
+}
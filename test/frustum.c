@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <glisy/frustum.h>
+
+#include "test.h"
+
+#define COUNT 10007
+
+/**
+ * Returns whether bounds centered on c with reach r and extents e
+ * are further than a small margin from every plane of f, so float
+ * rounding cannot change their state.
+ */
+
+static int
+clear (const frustum *f, vec3 c, vec3 e, float r) {
+  for (int p = 0; p < 6; ++p) {
+    plane q = f->planes[p];
+    float d = plane_distance(q, c);
+    float s = r + fabsf(q.normal.x) * e.x + fabsf(q.normal.y) * e.y +
+              fabsf(q.normal.z) * e.z;
+    if (fabsf(d + s) < 1e-3f || fabsf(d - s) < 1e-3f) return 0;
+  }
+  return 1;
+}
+
+/**
+ * Checks out against the scalar classification of the bounds.
+ */
+
+static void
+check (const frustum_cull *out, const frustum *f,
+       const sphere_soa *spheres, const aabb_soa *boxes) {
+  size_t n = 0, count = spheres ? spheres->count : boxes->count;
+  assert(count == out->count);
+  for (size_t i = 0; i < count; ++i) {
+    int state;
+    if (spheres) {
+      sphere a = glisy_sphere_soa_get(spheres, i);
+      state = glisy_frustum_classify_sphere(f, a);
+      if (!clear(f, a.center, vec3(0, 0, 0), a.radius)) state = -1;
+    } else {
+      aabb a = glisy_aabb_soa_get(boxes, i);
+      state = glisy_frustum_classify_aabb(f, a);
+      if (!clear(f, aabb_center(a), aabb_extents(a), 0)) state = -1;
+    }
+    if (state >= 0) assert(state == out->state[i]);
+    if (out->state[i] & GLISY_CULL_VISIBLE) {
+      assert(n < out->visible_count && i == out->visible[n]);
+      n++;
+    }
+  }
+  assert(n == out->visible_count);
+}
+
+int
+main (void) {
+  seed = 11;
+  glisy_pool pool;
+  assert(0 == glisy_pool_init(&pool, 4, 0));
+
+  mat4 proj = mat4_perspective(M_PI / 3, 1.5, 0.5, 100);
+  mat4 view = mat4_lookAt(vec3(3, 2, 10), vec3(0, 0, 0), vec3(0, 1, 0));
+  mat4 viewproj = mat4_multiply(proj, view);
+  frustum f = frustum_from_mat4(viewproj);
+
+  // planes are unit, face inwards and agree with the clip volume
+  for (int p = 0; p < 6; ++p) {
+    assert(fcmp(vec3_length(f.planes[p].normal), 1));
+  }
+  for (int k = 0; k < 10000; ++k) {
+    vec3 v = vec3(random_float() * 60, random_float() * 60,
+                  random_float() * 120);
+    vec4 c = vec4_transform_mat4(vec4(v.x, v.y, v.z, 1), viewproj);
+    float m = fminf(fminf(c.w - fabsf(c.x), c.w - fabsf(c.y)),
+                    c.w - fabsf(c.z));
+    if (fabsf(m) < 1e-3f * fabsf(c.w)) continue;
+    int in = frustum_classify_sphere(f, sphere(v, 0));
+    assert((m > 0 ? GLISY_CULL_INSIDE : GLISY_CULL_OUTSIDE) == in);
+  }
+  assert(GLISY_CULL_INSIDE == frustum_classify_sphere(f,
+         sphere({0, 0, 0}, 1)));
+  assert(GLISY_CULL_OUTSIDE == frustum_classify_sphere(f,
+         sphere({3, 2, 10.2f}, 0.1f)));
+  assert(GLISY_CULL_INTERSECT == frustum_classify_sphere(f,
+         sphere({3, 2, 10}, 1)));
+  assert(GLISY_CULL_INTERSECT == frustum_classify_aabb(f,
+         aabb({-1000, -1, -1}, {1000, 1, 1})));
+  assert(GLISY_CULL_OUTSIDE == frustum_classify_aabb(f,
+         aabb({-1, 100, -1}, {1, 101, 1})));
+
+  // orthographic volumes are boxes
+  {
+    frustum o = frustum_from_mat4(mat4_ortho(-2, 2, -1, 1, 0, 10));
+    assert(fcmp(o.planes[GLISY_FRUSTUM_LEFT].normal.x, 1));
+    assert(fcmp(o.planes[GLISY_FRUSTUM_LEFT].distance, 2));
+    assert(fcmp(o.planes[GLISY_FRUSTUM_FAR].normal.z, 1));
+    assert(fcmp(o.planes[GLISY_FRUSTUM_FAR].distance, 10));
+    assert(GLISY_CULL_INSIDE == frustum_classify_aabb(o,
+           aabb({-1, -0.5f, -9}, {1, 0.5f, -1})));
+    assert(GLISY_CULL_INTERSECT == frustum_classify_aabb(o,
+           aabb({1, -0.5f, -9}, {3, 0.5f, -1})));
+    assert(GLISY_CULL_OUTSIDE == frustum_classify_aabb(o,
+           aabb({-1, -0.5f, 1}, {1, 0.5f, 2})));
+  }
+
+  sphere_soa spheres = sphere_soa_create();
+  aabb_soa boxes = aabb_soa_create();
+  for (size_t i = 0; i < COUNT; ++i) {
+    vec3 c = vec3(random_float() * 60, random_float() * 60,
+                  random_float() * 120);
+    float r = 4 * fabsf(random_float());
+    assert(0 == sphere_soa_push(spheres, sphere(c, r)));
+    assert(0 == aabb_soa_push(boxes, aabb({c.x - r, c.y - 0.5f * r, c.z},
+                                          {c.x + r, c.y, c.z + 2 * r})));
+  }
+
+  // batches match the scalar tests, with and without threads
+  frustum_cull out = frustum_cull_create();
+  frustum_cull serial = frustum_cull_create();
+  assert(0 == frustum_cull_spheres(&pool, out, f, spheres, 0));
+  check(&out, &f, &spheres, NULL);
+  assert(out.visible_count > COUNT / 10 && out.visible_count < COUNT / 2);
+  assert(0 == frustum_cull_spheres(NULL, serial, f, spheres, 0));
+  assert(0 == memcmp(serial.state, out.state, COUNT));
+  assert(serial.visible_count == out.visible_count);
+  assert(0 == memcmp(serial.visible, out.visible,
+                     out.visible_count * sizeof(uint32_t)));
+  assert(0 == frustum_cull_aabbs(&pool, out, f, boxes, 0));
+  check(&out, &f, NULL, &boxes);
+  assert(0 == frustum_cull_aabbs(NULL, serial, f, boxes, 0));
+  assert(0 == memcmp(serial.state, out.state, COUNT));
+  assert(0 == memcmp(serial.visible, out.visible,
+                     out.visible_count * sizeof(uint32_t)));
+
+  // coherent culling gives the same answers frame after frame while
+  // the camera turns, and caches a plane each rejected object is behind
+  for (int frame = 0; frame < 8; ++frame) {
+    mat4 v = mat4_lookAt(vec3(3, 2, 10), vec3(frame * 2.0f, 0, 0),
+                         vec3(0, 1, 0));
+    frustum g = frustum_from_mat4(mat4_multiply(proj, v));
+    for (int box = 0; box < 2; ++box) {
+      frustum_cull *c = box ? &serial : &out;
+      if (box) {
+        assert(0 == frustum_cull_aabbs(&pool, *c, g, boxes,
+                                       GLISY_FRUSTUM_COHERENT));
+      } else {
+        assert(0 == frustum_cull_spheres(&pool, *c, g, spheres,
+                                         GLISY_FRUSTUM_COHERENT));
+      }
+      check(c, &g, box ? NULL : &spheres, box ? &boxes : NULL);
+      for (size_t i = 0; i < COUNT; ++i) {
+        if (c->state[i] != GLISY_CULL_OUTSIDE) continue;
+        plane q = g.planes[c->plane[i]];
+        if (box) {
+          aabb a = aabb_soa_get(boxes, i);
+          vec3 e = aabb_extents(a);
+          assert(plane_distance(q, aabb_center(a)) +
+                 fabsf(q.normal.x) * e.x + fabsf(q.normal.y) * e.y +
+                 fabsf(q.normal.z) * e.z < 1e-3f);
+        } else {
+          sphere a = sphere_soa_get(spheres, i);
+          assert(plane_distance(q, a.center) + a.radius < 1e-3f);
+        }
+      }
+    }
+  }
+
+  // resizing keeps cached planes; tails and empty batches are clean
+  {
+    frustum_cull c = frustum_cull_create();
+    sphere_soa few = sphere_soa_create();
+    assert(0 == frustum_cull_spheres(NULL, c, f, few, 0));
+    assert(0 == c.count && 0 == c.visible_count);
+    for (int i = 0; i < 5; ++i) {
+      assert(0 == sphere_soa_push(few, sphere({0, 0, 0}, 1)));
+    }
+    assert(0 == sphere_soa_push(few, sphere({0, 100, 0}, 1)));
+    assert(0 == frustum_cull_spheres(NULL, c, f, few,
+                                     GLISY_FRUSTUM_COHERENT));
+    assert(5 == c.visible_count && 4 == c.visible[4]);
+    assert(GLISY_CULL_INSIDE == c.state[0] && 0 == c.state[5]);
+    for (size_t i = 6; i < c.capacity; ++i) assert(0 == c.state[i]);
+    uint8_t cached = c.plane[5];
+    uint8_t first = 6;
+    glisy_frustum_classify(&f, vec3(0, 100, 0), vec3(0, 0, 0), 1, &first);
+    assert(first == cached);
+    assert(0 == frustum_cull_reserve(c, 1000));
+    assert(cached == c.plane[5] && 1000 <= c.capacity);
+    frustum_cull_free(c);
+    sphere_soa_free(few);
+    assert(0 == c.state && 0 == c.capacity);
+  }
+
+  frustum_cull_free(out);
+  frustum_cull_free(serial);
+  sphere_soa_free(spheres);
+  aabb_soa_free(boxes);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
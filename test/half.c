@@ -0,0 +1,111 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/half.h>
+
+#include "test.h"
+
+#define COUNT 4099
+
+static float floats[COUNT], back[COUNT];
+static uint16_t halves[COUNT], expected[COUNT];
+
+/**
+ * Converts count floats in bulk and checks every half against the
+ * scalar conversion and the overflow count against a direct one.
+ */
+
+static void
+check_batch (size_t count) {
+  size_t overflow = 0;
+  for (size_t i = 0; i < count; ++i) {
+    expected[i] = glisy_half_from_float(floats[i]);
+    overflow += isfinite(floats[i]) && fabsf(floats[i]) >= 65520.0f;
+  }
+  assert(overflow == glisy_half_from_float_batch(halves, floats, count));
+  assert(0 == memcmp(expected, halves, count * sizeof(uint16_t)));
+}
+
+int
+main (void) {
+  // every half decodes the same in bulk and alone
+  {
+    static uint16_t all[0x10000];
+    static float decoded[0x10000];
+    for (uint32_t h = 0; h < 0x10000; ++h) all[h] = (uint16_t) h;
+    glisy_half_to_float_batch(decoded, all, 0x10000);
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+      float f = glisy_half_to_float((uint16_t) h);
+      assert(0 == memcmp(&f, &decoded[h], sizeof(f)));
+      // and every non-nan half survives the trip back
+      if ((h & 0x7c00) != 0x7c00 || !(h & 0x3ff)) {
+        assert(h == glisy_half_from_float(f));
+      }
+    }
+  }
+
+  // floats across the whole range, batches of every tail length
+  for (uint64_t start = 0; start < 0x100000000ull; start += 0x1000000ull) {
+    for (size_t i = 0; i < COUNT; ++i) {
+      uint32_t bits = (uint32_t) (start + i * 4093u);
+      memcpy(&floats[i], &bits, sizeof(float));
+    }
+    check_batch(COUNT - (start >> 24) % 8);
+  }
+
+  // rounding and overflow at the edges of the half range
+  {
+    float edges[] = {
+      65504.0f, 65519.0f, 65520.0f, -65520.0f, FLT_MAX, INFINITY,
+      -INFINITY, NAN, 0x1p-24f, 0x1p-25f, 0x1.8p-25f, 0x1p-14f,
+      0x1.ffcp-15f, 1.0f + 0x1p-11f, 1.0f + 0x3p-11f, -0.0f, 0.0f
+    };
+    size_t n = sizeof(edges) / sizeof(edges[0]);
+    for (size_t i = 0; i < COUNT; ++i) floats[i] = edges[i % n];
+    check_batch(COUNT);
+    assert(0x7bff == glisy_half_from_float(65519.0f));
+    assert(0x7c00 == glisy_half_from_float(65520.0f));
+    assert(0xfc00 == glisy_half_from_float(-FLT_MAX));
+    assert(0x0001 == glisy_half_from_float(0x1.8p-25f));
+    assert(0x0400 == glisy_half_from_float(0x1.ffcp-15f));
+    assert(3 == glisy_half_from_float_batch(halves, edges, 6));
+  }
+
+  // vector types round trip within half precision
+  {
+    vec3 v[5] = {
+      vec3(1, 2, 3), vec3(-0.5f, 0.25f, 1024),
+      vec3(0.1f, 0.2f, 0.3f), vec3(0, -0.0f, 65504), vec3(1e5f, 0, 0)
+    };
+    hvec3 h[5];
+    vec3 out[5];
+    assert(6 == sizeof(hvec3));
+    assert(1 == glisy_hvec3_encode_batch(h, v, 5));
+    glisy_hvec3_decode_batch(out, h, 5);
+    for (int i = 0; i < 4; ++i) {
+      vec3 d = hvec3_decode(hvec3_encode(v[i]));
+      assert(0 == memcmp(&d, &out[i], sizeof(d)));
+      assert(fabsf(out[i].x - v[i].x) <= fabsf(v[i].x) * 0x1p-11f);
+      assert(fabsf(out[i].z - v[i].z) <= fabsf(v[i].z) * 0x1p-11f);
+    }
+    assert(INFINITY == out[4].x);
+
+    vec4 c = vec4(0.25f, 0.5f, 0.75f, 1);
+    vec4 d = hvec4_decode(hvec4_encode(c));
+    assert(0 == memcmp(&c, &d, sizeof(c)));
+    vec2 uv = vec2(0.125f, 0.875f), uv2;
+    hvec2 huv;
+    assert(0 == glisy_hvec2_encode_batch(&huv, &uv, 1));
+    glisy_hvec2_decode_batch(&uv2, &huv, 1);
+    assert(0 == memcmp(&uv, &uv2, sizeof(uv)));
+  }
+
+  // decoding floats from a bulk encode matches element-wise
+  for (size_t i = 0; i < COUNT; ++i) floats[i] = (float) i * 0.37f - 700;
+  check_batch(COUNT);
+  glisy_half_to_float_batch(back, halves, COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    assert(fabsf(back[i] - floats[i]) <= fabsf(floats[i]) * 0x1p-11f);
+  }
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <glisy/hierarchy.h>
+
+#include "test.h"
+
+#define COUNT 40000
+
+static mat4 expected[COUNT];
+static uint8_t moved[COUNT];
+static uint32_t versions[COUNT];
+
+static inline unsigned int
+random_uint (void) {
+  return random_bits() >> 8;
+}
+
+static inline mat4
+random_local (void) {
+  mat4 m = mat4_create();
+  mat4_rotateY(m, (random_uint() % 1000) * 0.001f);
+  return mat4_translate(m, vec3((random_uint() % 100) * 0.01f, 1, 0));
+}
+
+/**
+ * Recomputes every world matrix from scratch into expected.
+ */
+
+static void
+reference (const hierarchy *h) {
+  for (size_t i = 0; i < h->count; ++i) {
+    int32_t p = h->parent[i];
+    expected[i] = p < 0 ? h->local[i]
+                        : mat4_multiply(expected[p], h->local[i]);
+  }
+}
+
+static void
+assert_worlds (const hierarchy *h) {
+  reference(h);
+  for (size_t i = 0; i < h->count; ++i) {
+    const float *x = &h->world[i].m11;
+    const float *y = &expected[i].m11;
+    for (int e = 0; e < 16; ++e) {
+      assert(x[e] == y[e]);
+    }
+  }
+}
+
+/**
+ * Returns how many nodes the next update of h must recompute: the
+ * pending nodes and all their descendants, flagged in moved.
+ */
+
+static size_t
+affected (const hierarchy *h) {
+  size_t n = 0;
+  memset(moved, 0, sizeof(moved));
+  for (size_t k = 0; k < h->pending_count; ++k) {
+    moved[h->pending[k]] = 1;
+  }
+  for (size_t i = 0; i < h->count; ++i) {
+    if (h->parent[i] >= 0 && moved[h->parent[i]]) moved[i] = 1;
+    n += moved[i];
+  }
+  return n;
+}
+
+/**
+ * Sets n random local matrices of h.
+ */
+
+static void
+touch (hierarchy *h, size_t n) {
+  for (size_t k = 0; k < n; ++k) {
+    hierarchy_set_local(*h, random_uint() % h->count, random_local());
+  }
+}
+
+int
+main (void) {
+  hierarchy h = hierarchy_create();
+  hierarchy p = hierarchy_create();
+
+  // invalid parents are rejected
+  assert(-1 == hierarchy_add(h, 0, mat4_create()));
+  assert(0 == hierarchy_add(h, -1, mat4_create()));
+  assert(-1 == hierarchy_add(h, 5, mat4_create()));
+  hierarchy_free(h);
+
+  // a few roots with random shallow and deep chains
+  for (int i = 0; i < COUNT; ++i) {
+    int32_t parent = -1;
+    if (i >= 4) {
+      parent = random_uint() % 4 ? i - 1 - random_uint() % 8
+                                 : random_uint() % i;
+    }
+    assert(i == hierarchy_add(h, parent, random_local()));
+    assert(i == hierarchy_add(p, parent, h.local[i]));
+    assert(h.parent[i] < i);
+  }
+  assert(h.pending_count == COUNT);
+
+  // first update computes everything
+  hierarchy_update(h);
+  assert(h.counters.recomputed == COUNT);
+  assert(h.counters.visited == COUNT);
+  assert(h.pending_count == 0);
+  assert_worlds(&h);
+
+  // nothing dirty: no work
+  hierarchy_update(h);
+  assert(h.counters.recomputed == 0);
+  assert(h.counters.visited == 0);
+
+  // only dirty subtrees are recomputed, and their versions bump
+  for (int round = 0; round < 5; ++round) {
+    memcpy(versions, h.world_version, sizeof(versions));
+    touch(&h, 50);
+    size_t n = affected(&h);
+    hierarchy_update(h);
+    assert(h.counters.recomputed == n);
+    assert(h.counters.recomputed < COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+      assert(h.world_version[i] == versions[i] + moved[i]);
+      assert(0 == h.dirty[i]);
+    }
+    assert_worlds(&h);
+  }
+  assert(h.counters.updates == 7);
+
+  // set_local bumps the local version, repeated marks queue once
+  {
+    uint32_t v = h.version[10];
+    hierarchy_set_local(h, 10, h.local[10]);
+    hierarchy_mark_dirty(h, 10);
+    assert(h.version[10] == v + 2);
+    assert(h.pending_count == 1);
+    hierarchy_update(h);
+  }
+
+  // update_all recomputes everything and matches
+  hierarchy_update_all(h);
+  assert(h.counters.recomputed == COUNT);
+  assert_worlds(&h);
+
+  // parallel updates match the serial ones
+  {
+    glisy_pool pool;
+    assert(0 == glisy_pool_init(&pool, 4, 0));
+    hierarchy_update_parallel(&pool, p);
+    assert(p.counters.recomputed == COUNT);
+    assert_worlds(&p);
+
+    glisy_hierarchy_build_levels(&p);
+    for (size_t d = 0; d < p.level_count; ++d) {
+      for (size_t k = p.levels[d]; k < p.levels[d + 1]; ++k) {
+        assert(p.depth[p.order[k]] == d);
+      }
+    }
+    assert(p.levels[p.level_count] == COUNT);
+
+    for (int round = 0; round < 3; ++round) {
+      touch(&p, round ? 40 : 1);
+      hierarchy_set_local(p, 0, random_local());
+      size_t n = affected(&p);
+      hierarchy_update_parallel(round == 1 ? NULL : &pool, p);
+      assert(p.counters.recomputed == n);
+      assert_worlds(&p);
+    }
+    glisy_pool_destroy(&pool);
+  }
+
+  hierarchy_free(h);
+  hierarchy_free(p);
+  assert(h.count == 0 && h.local == NULL);
+  return 0;
+}
@@ -84,6 +84,26 @@ main (void) {
                           1,3,5,
                           7,8,9));
 
+  // add
+  mat3_assert_equals(mat3_add(mat3(1,2,3,
+                                   4,5,6,
+                                   7,8,9), mat3(1,1,1,
+                                                1,1,1,
+                                                1,1,1)),
+                     mat3(2,3,4,
+                          5,6,7,
+                          8,9,10));
+
+  // subtract
+  mat3_assert_equals(mat3_subtract(mat3(1,2,3,
+                                        4,5,6,
+                                        7,8,9), mat3(1,1,1,
+                                                     1,1,1,
+                                                     1,1,1)),
+                     mat3(0,1,2,
+                          3,4,5,
+                          6,7,8));
+
   // translate
   mat3_assert_equals(mat3_translate(mat3(1,0,0,
                                          0,1,0,
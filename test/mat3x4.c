@@ -0,0 +1,176 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/mat3x4.h>
+
+#include "test.h"
+
+#define COUNT 19
+
+static mat4 xs[COUNT], ys[COUNT];
+static mat3x4 as[COUNT], bs[COUNT], out[COUNT];
+static vec3 points[COUNT], moved[COUNT];
+
+/**
+ * floats_assert_ulps over the twelve elements of a mat3x4.
+ */
+
+static inline void
+mat3x4_assert_ulps (mat3x4 a, mat3x4 b, float ulps) {
+  floats_assert_ulps(&a.m11, &b.m11, 12, ulps);
+}
+
+static inline void
+vec3_assert_equals (vec3 a, vec3 b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+  assert(fcmp(a.z, b.z));
+}
+
+static inline mat4
+random_transform (void) {
+  mat4 m = mat4_create();
+  mat4_rotate(m, random_float() * 3.0f,
+              vec3(random_float(), random_float(), random_float()));
+  m = mat4_scale(m, vec3(1.5f + random_float(),
+                         1.5f + random_float(),
+                         1.5f + random_float()));
+  return mat4_translate(m, vec3(random_float() * 10,
+                                random_float() * 10,
+                                random_float() * 10));
+}
+
+int
+main (void) {
+  assert(48 == sizeof(mat3x4));
+
+  for (int i = 0; i < COUNT; ++i) {
+    xs[i] = random_transform();
+    ys[i] = random_transform();
+    as[i] = mat3x4_from_mat4(xs[i]);
+    bs[i] = mat3x4_from_mat4(ys[i]);
+    points[i] = vec3(random_float() * 5, random_float(), random_float() * 3);
+  }
+
+  // layout: rows are the columns of the mat4, translation in m14..m34
+  {
+    mat4 t = mat4_translate(mat4_create(), vec3(1, 2, 3));
+    mat3x4 a = mat3x4_from_mat4(t);
+    mat3x4_assert_ulps(a, mat3x4(1,0,0,1,
+                                 0,1,0,2,
+                                 0,0,1,3), 0);
+    mat3x4_assert_ulps(mat3x4_create(), mat3x4_from_mat4(mat4_create()), 0);
+  }
+
+  // mat4 round trip
+  for (int i = 0; i < COUNT; ++i) {
+    mat4 m = mat3x4_to_mat4(as[i]);
+    const float *x = &m.m11;
+    const float *y = &xs[i].m11;
+    for (int e = 0; e < 16; ++e) {
+      assert(x[e] == y[e]);
+    }
+  }
+
+  // mat3 and quat conversions
+  {
+    quat q;
+    quat_set_axis_angle(q, vec3_normalize(vec3(1, -2, 3)), 0.9f);
+    mat3x4 a = mat3x4_from_quat(q);
+    mat3x4 e = mat3x4_from_mat4(mat4_from_quat(q));
+    mat3x4_assert_ulps(a, e, 4);
+    assert(a.m14 == 0 && a.m24 == 0 && a.m34 == 0);
+
+    mat3 m = mat3x4_to_mat3(a);
+    mat3 f = mat3_from_quat(q);
+    assert(fcmp(m.m12, f.m12) && fcmp(m.m23, f.m23) && fcmp(m.m31, f.m31));
+    mat3x4_assert_ulps(mat3x4_from_mat3(m), a, 0);
+
+    quat r = mat3x4_to_quat(a);
+    assert(fcmp(r.x, q.x) && fcmp(r.y, q.y));
+    assert(fcmp(r.z, q.z) && fcmp(r.w, q.w));
+  }
+
+  // multiply matches mat4_multiply
+  for (int i = 0; i < COUNT; ++i) {
+    mat3x4 e = mat3x4_from_mat4(mat4_multiply(xs[i], ys[i]));
+    mat3x4 scalar;
+    glisy_mat3x4_multiply_scalar(&scalar, &as[i], &bs[i]);
+    mat3x4_assert_ulps(mat3x4_multiply(as[i], bs[i]), e, 16);
+    mat3x4_assert_ulps(scalar, e, 16);
+  }
+
+  // invert matches mat4_invert_affine
+  for (int i = 0; i < COUNT; ++i) {
+    mat3x4 e = mat3x4_from_mat4(mat4_invert_affine(xs[i]));
+    mat3x4 scalar;
+    glisy_mat3x4_invert_scalar(&scalar, &as[i]);
+    mat3x4_assert_ulps(mat3x4_invert(as[i]), e, 16);
+    mat3x4_assert_ulps(scalar, e, 16);
+    mat3x4_assert_ulps(mat3x4_multiply(as[i], mat3x4_invert(as[i])),
+                       mat3x4_create(), 64);
+  }
+  mat3x4_assert_ulps(mat3x4_invert(mat3x4(0)), mat3x4(0), 0);
+
+  // rigid inverse
+  {
+    mat4 r = mat4_create();
+    mat4_rotate(r, 0.7f, vec3(1, 2, 3));
+    r = mat4_translate(r, vec3(4, -5, 6));
+    mat3x4 a = mat3x4_from_mat4(r);
+    mat3x4 scalar;
+    glisy_mat3x4_invert_rigid_scalar(&scalar, &a);
+    mat3x4_assert_ulps(mat3x4_invert_rigid(a), mat3x4_invert(a), 16);
+    mat3x4_assert_ulps(scalar, mat3x4_invert(a), 16);
+  }
+
+  // point and vector transforms match mat4
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 p = mat3x4_transform_point(as[i], points[i]);
+    vec3 v = mat3x4_transform_vector(as[i], points[i]);
+    vec3 e = vec3_transform_mat4_affine(points[i], xs[i]);
+    vec4 w = vec4_transform_mat4(vec4(points[i].x, points[i].y,
+                                      points[i].z, 0), xs[i]);
+    vec3_assert_equals(p, e);
+    vec3_assert_equals(v, vec3(w.x, w.y, w.z));
+  }
+
+  // batch kernels agree with the single forms
+  {
+    mat4 back[COUNT];
+    glisy_mat3x4_from_mat4_batch(out, xs, COUNT);
+    glisy_mat3x4_to_mat4_batch(back, out, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat3x4_assert_ulps(out[i], as[i], 0);
+      assert(0 == memcmp(&back[i], &xs[i], sizeof(mat4)));
+    }
+
+    glisy_mat3x4_multiply_batch(out, as, bs, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat3x4_assert_ulps(out[i], mat3x4_multiply(as[i], bs[i]), 0);
+    }
+
+    glisy_mat3x4_multiply_each(out, &as[0], bs, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat3x4_assert_ulps(out[i], mat3x4_multiply(as[0], bs[i]), 0);
+    }
+
+    glisy_mat3x4_invert_batch(out, as, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat3x4_assert_ulps(out[i], mat3x4_invert(as[i]), 0);
+    }
+
+    glisy_mat3x4_invert_rigid_batch(out, as, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat3x4_assert_ulps(out[i], mat3x4_invert_rigid(as[i]), 0);
+    }
+
+    glisy_mat3x4_transform_point_batch(moved, points, COUNT, &as[1]);
+    for (int i = 0; i < COUNT; ++i) {
+      vec3_assert_equals(moved[i], mat3x4_transform_point(as[1], points[i]));
+    }
+    glisy_mat3x4_transform_point_batch(points, points, COUNT, &as[1]);
+    assert(0 == memcmp(points, moved, sizeof(points)));
+  }
+
+  return 0;
+}
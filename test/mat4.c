@@ -0,0 +1,226 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/mat4.h>
+
+#include "test.h"
+
+static inline void
+mat4_assert_equals (mat4 a, mat4 b) {
+  const float *x = &a.m11;
+  const float *y = &b.m11;
+  for (int i = 0; i < 16; ++i) {
+    assert(fcmp(x[i], y[i]));
+  }
+}
+
+static inline mat4
+random_transform (void) {
+  mat4 m = mat4_create();
+  mat4_rotate(m, random_float() * 3.0f,
+              vec3(random_float(), random_float(), random_float()));
+  m = mat4_scale(m, vec3(1.5f + random_float(),
+                         1.5f + random_float(),
+                         1.5f + random_float()));
+  return mat4_translate(m, vec3(random_float() * 10,
+                                random_float() * 10,
+                                random_float() * 10));
+}
+
+int
+main (void) {
+  // identity
+  mat4 mat = mat4_create();
+  mat4_assert_equals(mat4_identity(mat), mat4(1,0,0,0,
+                                              0,1,0,0,
+                                              0,0,1,0,
+                                              0,0,0,1));
+
+  // transpose
+  mat4_assert_equals(mat4_transpose(mat4(1,2,3,4,
+                                         5,6,7,8,
+                                         9,10,11,12,
+                                         13,14,15,16)),
+                     mat4(1,5,9,13,
+                          2,6,10,14,
+                          3,7,11,15,
+                          4,8,12,16));
+
+  // multiply
+  mat4_assert_equals(mat4_multiply(mat4(1,2,3,4,
+                                        5,6,7,8,
+                                        9,10,11,12,
+                                        13,14,15,16),
+                                   mat4(1,0,0,0,
+                                        0,2,0,0,
+                                        0,0,3,0,
+                                        1,1,1,1)),
+                     mat4(1,2,3,4,
+                          10,12,14,16,
+                          27,30,33,36,
+                          28,32,36,40));
+
+  // multiply reads every element of the left column
+  mat4_assert_equals(mat4_multiply(mat4(1,2,3,4,
+                                        5,6,7,8,
+                                        9,10,11,12,
+                                        13,14,15,16),
+                                   mat4(1,1,0,0,
+                                        0,1,0,0,
+                                        0,0,1,0,
+                                        0,0,0,1)),
+                     mat4(6,8,10,12,
+                          5,6,7,8,
+                          9,10,11,12,
+                          13,14,15,16));
+
+  // add
+  mat4_assert_equals(mat4_add(mat4(1,2,3,4,
+                                   5,6,7,8,
+                                   9,10,11,12,
+                                   13,14,15,16),
+                              mat4(1,1,1,1,
+                                   1,1,1,1,
+                                   1,1,1,1,
+                                   1,1,1,1)),
+                     mat4(2,3,4,5,
+                          6,7,8,9,
+                          10,11,12,13,
+                          14,15,16,17));
+
+  // subtract
+  mat4_assert_equals(mat4_subtract(mat4(1,2,3,4,
+                                        5,6,7,8,
+                                        9,10,11,12,
+                                        13,14,15,16),
+                                   mat4(1,1,1,1,
+                                        1,1,1,1,
+                                        1,1,1,1,
+                                        1,1,1,1)),
+                     mat4(0,1,2,3,
+                          4,5,6,7,
+                          8,9,10,11,
+                          12,13,14,15));
+
+  // perspective keeps the fractional depth terms
+  mat4_assert_equals(mat4_perspective(M_PI / 2, 1, 1, 10),
+                     mat4(1,0,0,0,
+                          0,1,0,0,
+                          0,0,-1.22222,-1,
+                          0,0,-2.22222,0));
+
+  // inverse
+  mat4_assert_equals(mat4_invert(mat4(2,0,0,0,
+                                      0,4,0,0,
+                                      0,0,8,0,
+                                      1,2,3,1)),
+                     mat4(0.5,0,0,0,
+                          0,0.25,0,0,
+                          0,0,0.125,0,
+                          -0.5,-0.5,-0.375,1));
+
+  // singular inverse
+  mat4_assert_equals(mat4_invert(mat4(0)), mat4(0));
+
+  // in place multiply
+  mat4 a = mat4(1,2,3,4,
+                5,6,7,8,
+                9,10,11,12,
+                13,14,15,16);
+  mat4 b = mat4_create();
+  b.m41 = 1;
+  mat4 expected = mat4_multiply(a, b);
+  glisy_mat4_multiply_into(&a, &a, &b);
+  mat4_assert_equals(a, expected);
+
+  // vec4 transform
+  vec4 v = vec4_transform_mat4(vec4(1,2,3,1), mat4(1,0,0,0,
+                                                   0,1,0,0,
+                                                   0,0,1,0,
+                                                   5,6,7,1));
+  assert(fcmp(6, v.x));
+  assert(fcmp(8, v.y));
+  assert(fcmp(10, v.z));
+  assert(fcmp(1, v.w));
+
+  // affine inverse
+  mat4_assert_equals(mat4_invert_affine(mat4(2,0,0,0,
+                                             0,4,0,0,
+                                             0,0,8,0,
+                                             1,2,3,1)),
+                     mat4(0.5,0,0,0,
+                          0,0.25,0,0,
+                          0,0,0.125,0,
+                          -0.5,-0.5,-0.375,1));
+  mat4_assert_equals(mat4_invert_affine(mat4(0)), mat4(0));
+
+  // rigid inverse
+  mat4 rigid = mat4_create();
+  mat4_rotate(rigid, 0.7f, vec3(1, 2, 3));
+  rigid = mat4_translate(rigid, vec3(4, -5, 6));
+  mat4_assert_equals(mat4_invert_rigid(rigid), mat4_invert(rigid));
+  mat4_assert_equals(mat4_multiply(rigid, mat4_invert_rigid(rigid)),
+                     mat4_create());
+
+  // affine fast paths agree with the general routines
+  static mat4 xs[16], ys[16], batch[16];
+  for (int i = 0; i < 16; ++i) {
+    xs[i] = random_transform();
+    ys[i] = random_transform();
+  }
+  glisy_mat4_invert_affine_batch(batch, xs, 16);
+  for (int i = 0; i < 16; ++i) {
+    mat4 scalar;
+    glisy_mat4_invert_affine_scalar(&scalar, &xs[i]);
+    mat4_assert_ulps(batch[i], mat4_invert(xs[i]), 8);
+    mat4_assert_ulps(scalar, mat4_invert(xs[i]), 8);
+  }
+  glisy_mat4_multiply_affine_batch(batch, xs, ys, 16);
+  for (int i = 0; i < 16; ++i) {
+    mat4 scalar;
+    glisy_mat4_multiply_affine_scalar(&scalar, &xs[i], &ys[i]);
+    mat4_assert_ulps(batch[i], mat4_multiply(xs[i], ys[i]), 4);
+    mat4_assert_ulps(scalar, mat4_multiply(xs[i], ys[i]), 4);
+  }
+  for (int i = 0; i < 16; ++i) {
+    xs[i] = mat4_create();
+    mat4_rotate(xs[i], random_float() * 3.0f,
+                vec3(random_float(), random_float(), random_float()));
+    xs[i] = mat4_translate(xs[i], vec3(i, -i, 2 * i));
+  }
+  glisy_mat4_invert_rigid_batch(batch, xs, 16);
+  for (int i = 0; i < 16; ++i) {
+    mat4 scalar;
+    glisy_mat4_invert_rigid_scalar(&scalar, &xs[i]);
+    mat4_assert_ulps(batch[i], mat4_invert(xs[i]), 8);
+    mat4_assert_ulps(scalar, mat4_invert(xs[i]), 8);
+  }
+
+  // SIMD kernels agree with the scalar reference
+  for (int i = 0; i < 1000; ++i) {
+    mat4 x = random_transform();
+    mat4 y = random_transform();
+    mat4 simd, scalar;
+
+    glisy_mat4_multiply_into(&simd, &x, &y);
+    glisy_mat4_multiply_scalar(&scalar, &x, &y);
+    mat4_assert_ulps(simd, scalar, 4);
+
+    glisy_mat4_invert_into(&simd, &x);
+    glisy_mat4_invert_scalar(&scalar, &x);
+    mat4_assert_ulps(simd, scalar, 8);
+
+    glisy_mat4_transpose_into(&simd, &x);
+    glisy_mat4_transpose_scalar(&scalar, &x);
+    mat4_assert_ulps(simd, scalar, 0);
+
+    vec4 p = vec4(random_float(), random_float(), random_float(), 1);
+    vec4 vs, vr;
+    glisy_vec4_transform_mat4_into(&vs, &p, &x);
+    glisy_vec4_transform_mat4_scalar(&vr, &p, &x);
+    vec4_assert_ulps(vs, vr, 2);
+  }
+
+  return 0;
+}
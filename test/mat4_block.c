@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/vec3.h>
+#include <glisy/mat4.h>
+#include <glisy/mat4_block.h>
+
+#include "test.h"
+
+#define COUNT 37
+
+static mat4 a[COUNT];
+static mat4 b[COUNT];
+static mat4 out[COUNT];
+static mat4_block ablocks[COUNT];
+static mat4_block bblocks[COUNT];
+static mat4_block oblocks[COUNT];
+
+int
+main (void) {
+  size_t blocks = mat4_block_count(COUNT);
+  assert(blocks == (COUNT + GLISY_MAT4_BLOCK_LANES - 1) / GLISY_MAT4_BLOCK_LANES);
+
+  for (int i = 0; i < COUNT; ++i) {
+    a[i] = mat4_create();
+    b[i] = mat4_create();
+    mat4_rotate(a[i], i * 0.1f, vec3(1, 2, 3));
+    mat4_rotateX(b[i], i * 0.2f);
+    a[i] = mat4_translate(a[i], vec3(i, -i, 2));
+    b[i] = mat4_scale(b[i], vec3(1, 2, 0.5f * i));
+  }
+
+  // pack and unpack round trip
+  glisy_mat4_block_pack(ablocks, a, COUNT);
+  glisy_mat4_block_pack(bblocks, b, COUNT);
+  glisy_mat4_block_unpack(out, ablocks, COUNT);
+  assert(0 == memcmp(out, a, sizeof(a)));
+
+  // padding lanes are identity
+  int last = COUNT % GLISY_MAT4_BLOCK_LANES;
+  if (last) {
+    assert(1 == ablocks[blocks - 1].m[0][last]);
+    assert(0 == ablocks[blocks - 1].m[1][last]);
+  }
+
+  // array x one
+  glisy_mat4_block_multiply_mat4(oblocks, ablocks, &b[3], blocks);
+  glisy_mat4_block_unpack(out, oblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[i], b[3]), 4);
+  }
+
+  // one x array
+  glisy_mat4_multiply_block(oblocks, &a[5], bblocks, blocks);
+  glisy_mat4_block_unpack(out, oblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[5], b[i]), 4);
+  }
+
+  // array x array
+  glisy_mat4_block_multiply(oblocks, ablocks, bblocks, blocks);
+  glisy_mat4_block_unpack(out, oblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[i], b[i]), 4);
+  }
+
+  // in place
+  glisy_mat4_block_multiply_mat4(ablocks, ablocks, &b[3], blocks);
+  glisy_mat4_multiply_block(bblocks, &a[5], bblocks, blocks);
+  glisy_mat4_block_unpack(out, ablocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[i], b[3]), 4);
+  }
+  glisy_mat4_block_unpack(out, bblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[5], b[i]), 4);
+  }
+
+  // affine multiply and inverses
+  glisy_mat4_block_pack(ablocks, a, COUNT);
+  glisy_mat4_block_pack(bblocks, b, COUNT);
+  glisy_mat4_block_multiply_affine(oblocks, ablocks, bblocks, blocks);
+  glisy_mat4_block_unpack(out, oblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_multiply(a[i], b[i]), 4);
+  }
+
+  glisy_mat4_block_invert_rigid(oblocks, ablocks, blocks);
+  glisy_mat4_block_unpack(out, oblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_invert(a[i]), 8);
+  }
+
+  glisy_mat4_block_invert_affine(bblocks, bblocks, blocks);
+  glisy_mat4_block_unpack(out, bblocks, COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    mat4_assert_ulps(out[i], mat4_invert_affine(b[i]), 8);
+  }
+  mat4_assert_ulps(out[0], (mat4) {0}, 0);
+
+  return 0;
+}
@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <glisy/parallel.h>
+
+#include "test.h"
+
+#define COUNT 200003
+
+static unsigned char seen[COUNT];
+static vec3 points[COUNT], out[COUNT], expected[COUNT];
+static vec4 points4[COUNT], out4[COUNT], expected4[COUNT];
+static mat4 as[4096], bs[4096], ms[4096], es[4096];
+
+static inline mat4
+random_mat4 (void) {
+  mat4 m = mat4_create();
+  mat4_rotateY(m, random_float() * 3);
+  mat4_rotateX(m, random_float() * 3);
+  return mat4_translate(m, vec3(random_float(), random_float(), 1));
+}
+
+typedef struct coverage coverage;
+struct coverage {
+  glisy_pool *pool;
+  _Atomic size_t calls;
+  int misaligned;
+  int nested;
+};
+
+/**
+ * Marks every item it is handed, and checks chunk alignment.
+ */
+
+static void
+mark (void *ctx, size_t begin, size_t end, unsigned worker) {
+  coverage *c = ctx;
+  if (begin % GLISY_PARALLEL_ALIGN) c->misaligned = 1;
+  if (worker >= (c->pool ? c->pool->threads : 1)) c->misaligned = 1;
+  for (size_t i = begin; i < end; ++i) seen[i]++;
+  atomic_fetch_add(&c->calls, 1);
+}
+
+/**
+ * Marks every item it is handed, wherever the chunk starts.
+ */
+
+static void
+count_items (void *ctx, size_t begin, size_t end, unsigned worker) {
+  coverage *c = ctx;
+  (void) worker;
+  for (size_t i = begin; i < end; ++i) seen[i]++;
+  atomic_fetch_add(&c->calls, 1);
+}
+
+static void
+count_calls (void *ctx, size_t begin, size_t end, unsigned worker) {
+  coverage *c = ctx;
+  (void) begin;
+  (void) end;
+  (void) worker;
+  c->calls++;
+}
+
+/**
+ * Runs a nested loop from inside a loop body; it must run inline.
+ */
+
+static void
+nest (void *ctx, size_t begin, size_t end, unsigned worker) {
+  coverage *c = ctx;
+  coverage inner = {c->pool, 0, 0, 0};
+  (void) begin;
+  (void) end;
+  (void) worker;
+  glisy_parallel_for(c->pool, COUNT, 1, count_calls, &inner);
+  if (1 != inner.calls) c->nested = 1;
+}
+
+static void
+assert_covered (glisy_pool *p, size_t count, size_t item_bytes) {
+  coverage c = {p, 0, 0, 0};
+  memset(seen, 0, sizeof(seen));
+  glisy_parallel_for(p, count, item_bytes, mark, &c);
+  for (size_t i = 0; i < COUNT; ++i) {
+    assert(seen[i] == (i < count));
+  }
+  assert(0 == c.misaligned);
+}
+
+int
+main (void) {
+  glisy_pool pool;
+  glisy_pool one;
+  assert(0 == glisy_pool_init(&pool, 4, 0));
+  assert(0 == glisy_pool_init(&one, 1, GLISY_POOL_PIN));
+#ifndef GLISY_NO_THREADS
+  assert(4 == pool.threads);
+#endif
+
+  // every item is handed out exactly once, whatever the split
+  {
+    size_t counts[] = {0, 1, 15, 17, 4095, 65536, COUNT};
+    for (size_t k = 0; k < sizeof(counts) / sizeof(*counts); ++k) {
+      assert_covered(&pool, counts[k], 4);
+      assert_covered(&pool, counts[k], 1024);
+      assert_covered(&one, counts[k], 4);
+      assert_covered(NULL, counts[k], 4);
+    }
+  }
+
+  // small loops run inline as a single call
+  {
+    coverage c = {&pool, 0, 0, 0};
+    glisy_parallel_for(&pool, 100, 16, mark, &c);
+    assert(1 == c.calls);
+  }
+
+  // large loops split into several chunks
+#ifndef GLISY_NO_THREADS
+  {
+    coverage c = {&pool, 0, 0, 0};
+    glisy_parallel_for(&pool, COUNT, 64, mark, &c);
+    assert(c.calls > 4);
+    assert(c.calls == pool.chunks);
+    assert(pool.steals <= pool.chunks);
+  }
+#endif
+
+  // an explicit grain covers every item and splits even tiny loops
+  {
+    size_t counts[] = {0, 1, 2, 3, 7, 100};
+    for (int k = 0; k < 6; ++k) {
+      coverage c = {&pool, 0, 0, 0};
+      memset(seen, 0, sizeof(seen));
+      glisy_parallel_for_grain(&pool, counts[k], 1, count_items, &c);
+      for (size_t i = 0; i < COUNT; ++i) {
+        assert(seen[i] == (i < counts[k]));
+      }
+#ifndef GLISY_NO_THREADS
+      if (counts[k] >= 2) assert(c.calls == pool.chunks && c.calls > 1);
+#endif
+    }
+  }
+
+  // nested loops do not deadlock and run inline
+  {
+    coverage c = {&pool, 0, 0, 0};
+    glisy_parallel_for(&pool, COUNT, 64, nest, &c);
+    assert(0 == c.nested);
+  }
+
+  // wrappers match the serial kernels exactly
+  {
+    mat4 m = random_mat4();
+    m.m14 = 0.01f;
+    for (size_t i = 0; i < COUNT; ++i) {
+      points[i] = vec3(random_float(), random_float(), random_float());
+      points4[i] = vec4(random_float(), random_float(), random_float(), 1);
+    }
+
+    glisy_vec3_transform_mat4_batch(expected, points, COUNT, &m);
+    glisy_parallel_vec3_transform_mat4_batch(&pool, out, points, COUNT, &m);
+    assert(0 == memcmp(out, expected, sizeof(out)));
+
+    glisy_vec3_transform_mat4_affine_batch(expected, points, COUNT, &m);
+    glisy_parallel_vec3_transform_mat4_affine_batch(&pool, out, points,
+                                                    COUNT, &m);
+    assert(0 == memcmp(out, expected, sizeof(out)));
+
+    glisy_vec4_transform_mat4_batch(expected4, points4, COUNT, &m);
+    glisy_parallel_vec4_transform_mat4_batch(&pool, out4, points4,
+                                             COUNT, &m);
+    assert(0 == memcmp(out4, expected4, sizeof(out4)));
+  }
+
+  {
+    vec3_soa a = vec3_soa_create();
+    vec3_soa e = vec3_soa_create();
+    vec3_soa o = vec3_soa_create();
+    assert(0 == glisy_vec3_soa_from_vec3(&a, points, COUNT));
+    for (int fast = 0; fast < 2; ++fast) {
+      assert(0 == glisy_vec3_soa_normalize_kernel(&e, &a, fast));
+      assert(0 == glisy_parallel_vec3_soa_normalize(&pool, &o, &a, fast));
+      assert(o.count == COUNT);
+      assert(0 == memcmp(o.x, e.x, COUNT * sizeof(float)));
+      assert(0 == memcmp(o.y, e.y, COUNT * sizeof(float)));
+      assert(0 == memcmp(o.z, e.z, COUNT * sizeof(float)));
+    }
+    vec3_soa_free(a);
+    vec3_soa_free(e);
+    vec3_soa_free(o);
+  }
+
+  {
+    quat_soa a = quat_soa_create();
+    quat_soa e = quat_soa_create();
+    quat_soa o = quat_soa_create();
+    assert(0 == glisy_quat_soa_from_vec4(&a, points4, COUNT));
+    assert(0 == glisy_quat_soa_normalize(&e, &a));
+    assert(0 == glisy_parallel_quat_soa_normalize(&pool, &o, &a, 0));
+    assert(0 == memcmp(o.x, e.x, COUNT * sizeof(float)));
+    assert(0 == memcmp(o.w, e.w, COUNT * sizeof(float)));
+    quat_soa_free(a);
+    quat_soa_free(e);
+    quat_soa_free(o);
+  }
+
+  {
+    const size_t n = sizeof(as) / sizeof(*as);
+    for (size_t i = 0; i < n; ++i) {
+      as[i] = random_mat4();
+      bs[i] = random_mat4();
+    }
+    for (size_t i = 0; i < n; ++i) {
+      glisy_mat4_multiply_into(&es[i], &as[i], &bs[i]);
+    }
+    glisy_parallel_mat4_multiply_batch(&pool, ms, as, bs, n);
+    assert(0 == memcmp(ms, es, sizeof(ms)));
+
+    glisy_mat4_multiply_affine_batch(es, as, bs, n);
+    glisy_parallel_mat4_multiply_affine_batch(&pool, ms, as, bs, n);
+    assert(0 == memcmp(ms, es, sizeof(ms)));
+  }
+
+  {
+    size_t n = glisy_mat4_block_count(sizeof(as) / sizeof(*as));
+    mat4_block *a = glisy_simd_alloc(3 * n * sizeof(mat4_block));
+    mat4_block *b = a + n, *e = a + 2 * n;
+    assert(a);
+    glisy_mat4_block_pack(a, as, sizeof(as) / sizeof(*as));
+    glisy_mat4_block_pack(b, bs, sizeof(bs) / sizeof(*bs));
+    glisy_mat4_block_multiply(e, a, b, n);
+    glisy_parallel_mat4_block_multiply(&pool, b, a, b, n);
+    assert(0 == memcmp(b, e, n * sizeof(mat4_block)));
+
+    glisy_mat4_block_multiply_mat4(e, a, &bs[0], n);
+    glisy_parallel_mat4_block_multiply_mat4(&pool, b, a, &bs[0], n);
+    assert(0 == memcmp(b, e, n * sizeof(mat4_block)));
+    free(a);
+  }
+
+  glisy_pool_destroy(&pool);
+  glisy_pool_destroy(&one);
+  assert(0 == pool.threads);
+  return 0;
+}
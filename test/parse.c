@@ -0,0 +1,170 @@
+#include <assert.h>
+#include <glisy/parse.h>
+
+#include "test.h"
+
+#define COUNT 2000
+
+static vec3 vs[COUNT], vs_out[COUNT];
+static mat4 ms[COUNT], ms_out[COUNT];
+static trs ts[8], ts_out[8];
+static char text[COUNT * GLISY_FORMAT_MAX];
+
+/**
+ * Returns a random finite float from the whole range, or from a
+ * few decimal orders around 1 when small.
+ */
+
+static inline float
+random_finite (int small) {
+  float f;
+  do {
+    uint32_t bits = random_bits();
+    if (small) bits = (bits & 0x807fffff) | ((120 + bits % 16) << 23);
+    memcpy(&f, &bits, sizeof(f));
+  } while (!isfinite(f));
+  return f;
+}
+
+static inline float
+parse_one (const char *s) {
+  glisy_parser p = glisy_parser(s, strlen(s));
+  vec2 v;
+  assert(0 == glisy_parse_vec2(&p, &v));
+  return v.x;
+}
+
+int
+main (void) {
+  // individual numbers in every notation
+  {
+    assert(1.5f == parse_one("vec2(1.5, 0)"));
+    assert(-0.25f == parse_one("vec2(-.25, 0)"));
+    assert(100.0f == parse_one("vec2(1e2, 0)"));
+    assert(100.0f == parse_one("vec2(1E+2, 0)"));
+    assert(0.001f == parse_one("vec2(+1e-3, 0)"));
+    assert(0.1f == parse_one("vec2(0.1000000000000000000000001, 0)"));
+    assert(3.4028235e38f == parse_one("vec2(3.4028235e+38, 0)"));
+    assert(1e-45f == parse_one("vec2(1e-45, 0)"));
+    assert(INFINITY == parse_one("vec2(1e39, 0)"));
+    assert(-INFINITY == parse_one("vec2(-inf, 0)"));
+    assert(isnan(parse_one("vec2(nan, 0)")));
+    assert(signbit(parse_one("vec2(-0, 0)")));
+    // halfway between two floats: ties to even
+    assert(16777216.0f == parse_one("vec2(16777217, 0)"));
+    assert(16777220.0f == parse_one("vec2(16777219, 0)"));
+  }
+
+  // everything the formatter writes reads back bit exact
+  for (int i = 0; i < 100000; ++i) {
+    char buf[GLISY_FORMAT_MAX];
+    vec2 a = vec2(random_finite(i & 1), random_finite(0)), b;
+    glisy_parser p = glisy_parser(buf, vec2_format(buf, sizeof(buf), a));
+    assert(0 == glisy_parse_vec2(&p, &b));
+    assert(0 == memcmp(&a, &b, sizeof(a)));
+    assert(glisy_parser_done(&p));
+  }
+
+  // and so does strtof's reading of printf output
+  for (int i = 0; i < 100000; ++i) {
+    char buf[64];
+    float f = random_finite(i & 1);
+    snprintf(buf, sizeof(buf), "vec2(%.*g, 0)", 1 + i % 12, f);
+    float e = strtof(buf + 5, NULL);
+    float g = parse_one(buf);
+    assert(0 == memcmp(&e, &g, sizeof(e)));
+  }
+
+  // bulk parsing of every type's text
+  {
+    glisy_writer w = {text, sizeof(text), 0};
+    for (int i = 0; i < COUNT; ++i) {
+      vs[i] = vec3(random_finite(1), random_finite(1), random_finite(0));
+      w.len += vec3_format(text + w.len, sizeof(text) - w.len, vs[i]);
+      glisy_writer_text(&w, i % 7 ? " " : "\n", 1);
+    }
+    glisy_writer_end(&w);
+    glisy_parser p = glisy_parser(text, w.len);
+    assert(COUNT == glisy_parse_vec3_array(&p, vs_out, COUNT));
+    assert(NULL == p.error && 0 == p.more);
+    assert(0 == memcmp(vs, vs_out, sizeof(vs)));
+
+    w.len = 0;
+    for (int i = 0; i < COUNT; ++i) {
+      float *m = &ms[i].m11;
+      for (int e = 0; e < 16; ++e) m[e] = random_finite(e & 1);
+      w.len += mat4_format(text + w.len, sizeof(text) - w.len, ms[i]);
+      glisy_writer_text(&w, "\n", 1);
+    }
+    p = glisy_parser(text, w.len);
+    assert(COUNT == glisy_parse_mat4_array(&p, ms_out, COUNT));
+    assert(0 == memcmp(ms, ms_out, sizeof(ms)));
+
+    // capacity stops early without an error
+    p = glisy_parser(text, w.len);
+    assert(10 == glisy_parse_mat4_array(&p, ms_out, 10));
+    assert(NULL == p.error);
+
+    w.len = 0;
+    for (int i = 0; i < 8; ++i) {
+      ts[i] = trs_create();
+      ts[i].translation = vec3(i, -0.5f, random_finite(1));
+      w.len += trs_format(text + w.len, sizeof(text) - w.len, ts[i]);
+    }
+    p = glisy_parser(text, w.len);
+    assert(8 == glisy_parse_trs_array(&p, ts_out, 8));
+    assert(0 == memcmp(ts, ts_out, sizeof(ts)));
+  }
+
+  // the other types
+  {
+    char buf[GLISY_FORMAT_MAX];
+    quat q = quat(0.5f, -0.5f, 0.5f, -0.5f), qo;
+    mat3x4 m = mat3x4_create(), mo;
+    glisy_parser p = glisy_parser(buf, quat_format(buf, sizeof(buf), q));
+    assert(0 == glisy_parse_quat(&p, &qo));
+    assert(0 == memcmp(&q, &qo, sizeof(q)));
+    p = glisy_parser(buf, mat3x4_format(buf, sizeof(buf), m));
+    assert(0 == glisy_parse_mat3x4(&p, &mo));
+    assert(0 == memcmp(&m, &mo, sizeof(m)));
+  }
+
+  // errors report where they are
+  {
+    const char *bad = "vec3(1, 2, 3)\nvec3(4, x, 6)";
+    glisy_parser p = glisy_parser(bad, strlen(bad));
+    assert(1 == glisy_parse_vec3_array(&p, vs_out, COUNT));
+    assert(p.error && 0 == p.more);
+    assert(22 == p.pos);
+    assert(2 == glisy_parser_line(&p));
+    assert(9 == glisy_parser_column(&p));
+
+    const char *wrong = "  vec4(1, 2, 3, 4)";
+    p = glisy_parser(wrong, strlen(wrong));
+    assert(-1 == glisy_parse_vec3(&p, &vs_out[0]));
+    assert(p.error && 5 == p.pos);
+
+    const char *missing = "vec2(1 2)";
+    p = glisy_parser(missing, strlen(missing));
+    assert(-1 == glisy_parse_vec2(&p, (vec2 *) &vs_out[0]));
+    assert(p.error && 7 == p.pos);
+  }
+
+  // streaming: a value cut anywhere asks for more input and parses
+  // once the rest arrives
+  {
+    char buf[GLISY_FORMAT_MAX];
+    mat4 m = ms[3], mo;
+    size_t n = mat4_format(buf, sizeof(buf), m);
+    for (size_t cut = 0; cut < n; ++cut) {
+      glisy_parser p = glisy_parser(buf, cut);
+      assert(-1 == glisy_parse_mat4(&p, &mo));
+      assert(p.more && NULL == p.error && 0 == p.pos);
+      p.size = n;
+      assert(0 == glisy_parse_mat4(&p, &mo));
+      assert(0 == memcmp(&m, &mo, sizeof(m)));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,38 @@
+#include <assert.h>
+#include <glisy/quat.h>
+#include <glisy/mat3.h>
+
+#include "test.h"
+
+static inline void
+quat_assert_equals (quat a, quat b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+  assert(fcmp(a.z, b.z));
+  assert(fcmp(a.w, b.w));
+}
+
+int
+main (void) {
+  // conjugate
+  quat_assert_equals(quat_conjugate(quat(1,2,3,4)),
+                     quat(-1,-2,-3,4));
+
+  // calculate w from a fractional xyz
+  quat q = quat(0.5,0.5,0.5,0);
+  quat_calculateW(q);
+  assert(fcmp(0.5, q.w));
+
+  // from mat3, positive trace sets z
+  q = quat(0,0,0.24740,0.96891);
+  quat_assert_equals(quat_from_mat3(mat3_from_quat(q)), q);
+
+  // from mat3, each axis of a half turn leads the negative trace path
+  quat_assert_equals(quat_from_mat3(mat3_from_quat(quat(1,0,0,0))),
+                     quat(1,0,0,0));
+  quat_assert_equals(quat_from_mat3(mat3_from_quat(quat(0,1,0,0))),
+                     quat(0,1,0,0));
+  quat_assert_equals(quat_from_mat3(mat3_from_quat(quat(0,0,1,0))),
+                     quat(0,0,1,0));
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <glisy/quat_pack.h>
+
+#include "test.h"
+
+#define COUNT 100003
+
+static quat in[COUNT], out[COUNT], ref[COUNT];
+static quat32 p32[COUNT];
+static quat48 p48[COUNT];
+static quat64 p64[COUNT];
+static hquat ph[COUNT];
+
+/**
+ * Returns the largest rotation error between in and out.
+ */
+
+static float
+max_error (const quat *a, const quat *b, size_t count) {
+  float e = 0;
+  for (size_t i = 0; i < count; ++i) {
+    e = fmaxf(e, glisy_quat_error_degrees(a[i], b[i]));
+  }
+  return e;
+}
+
+int
+main (void) {
+  assert(6 == sizeof(quat48));
+  assert(8 == sizeof(hquat));
+
+  for (int i = 0; i < COUNT; ++i) {
+    in[i] = quat_normalize(quat(random_float(), random_float(),
+                                random_float(), random_float()));
+  }
+  // exact axes, ties between components and the identity
+  in[0] = quat(0, 0, 0, 1);
+  in[1] = quat(0, 0, 0, -1);
+  in[2] = quat(1, 0, 0, 0);
+  in[3] = quat(0, -1, 0, 0);
+  in[4] = quat(0.5f, 0.5f, 0.5f, 0.5f);
+  in[5] = quat(-0.5f, 0.5f, -0.5f, 0.5f);
+  in[6] = quat_normalize(quat(1, 1, 0, 0));
+  in[7] = quat_normalize(quat(0, 0, -1, 1));
+
+  // the error angle is exact enough for the finest codec
+  {
+    quat a = in[9], b = a;
+    b.x += 1e-6f;
+    assert(glisy_quat_error_degrees(a, a) < 1e-5f);
+    assert(glisy_quat_error_degrees(a, quat_scale(a, -1)) < 1e-5f);
+    assert(glisy_quat_error_degrees(a, b) > 1e-5f);
+    assert(fabsf(glisy_quat_error_degrees(quat(0, 0, 0, 1),
+                                          quat(0, 0, M_SQRT1_2, M_SQRT1_2))
+                 - 90) < 1e-4f);
+  }
+
+  // scalar codecs stay within their bounds
+  for (int i = 0; i < COUNT; ++i) {
+    out[i] = quat32_decode(quat32_encode(in[i]));
+  }
+  assert(max_error(in, out, COUNT) <= glisy_quat32_error_bound());
+  for (int i = 0; i < COUNT; ++i) {
+    out[i] = quat48_decode(quat48_encode(in[i]));
+  }
+  assert(max_error(in, out, COUNT) <= glisy_quat48_error_bound());
+  for (int i = 0; i < COUNT; ++i) {
+    out[i] = quat64_decode(quat64_encode(in[i]));
+  }
+  assert(max_error(in, out, COUNT) <= glisy_quat64_error_bound());
+  for (int i = 0; i < COUNT; ++i) {
+    out[i] = hquat_decode(hquat_encode(in[i]));
+  }
+  assert(max_error(in, out, COUNT) <= glisy_hquat_error_bound());
+  assert(glisy_quat64_error_bound() < glisy_quat48_error_bound());
+  assert(glisy_quat48_error_bound() < glisy_hquat_error_bound());
+  assert(glisy_hquat_error_bound() < glisy_quat32_error_bound());
+  assert(glisy_quat32_error_bound() < 0.3f);
+
+  // q and -q encode the same
+  for (int i = 0; i < 100; ++i) {
+    assert(quat32_encode(in[i]) == quat32_encode(quat_scale(in[i], -1)));
+    assert(quat64_encode(in[i]) == quat64_encode(quat_scale(in[i], -1)));
+  }
+
+  // batches agree with the scalar codecs and cover the tails
+  {
+    size_t n = COUNT, differ = 0;
+    glisy_quat32_encode_batch(p32, in, n);
+    for (size_t i = 0; i < n; ++i) {
+      differ += p32[i] != quat32_encode(in[i]);
+      ref[i] = quat32_decode(p32[i]);
+    }
+    assert(differ < n / 1000);
+    glisy_quat32_decode_batch(out, p32, n);
+    assert(max_error(ref, out, n) < 1e-3f);
+    assert(max_error(in, out, n) <= glisy_quat32_error_bound());
+
+    glisy_quat48_encode_batch(p48, in, n);
+    for (size_t i = 0; i < n; ++i) ref[i] = quat48_decode(p48[i]);
+    glisy_quat48_decode_batch(out, p48, n);
+    assert(max_error(ref, out, n) < 1e-3f);
+    assert(max_error(in, out, n) <= glisy_quat48_error_bound());
+
+    glisy_quat64_encode_batch(p64, in, n);
+    for (size_t i = 0; i < n; ++i) ref[i] = quat64_decode(p64[i]);
+    glisy_quat64_decode_batch(out, p64, n);
+    assert(max_error(ref, out, n) < 1e-3f);
+    assert(max_error(in, out, n) <= glisy_quat64_error_bound());
+
+    glisy_hquat_encode_batch(ph, in, n);
+    for (size_t i = 0; i < n; ++i) {
+      hquat h = hquat_encode(in[i]);
+      assert(0 == memcmp(&h, &ph[i], sizeof(h)));
+    }
+    glisy_hquat_decode_batch(out, ph, n);
+    assert(max_error(in, out, n) <= glisy_hquat_error_bound());
+  }
+
+  // halves round to nearest even and keep specials
+  {
+    assert(0x3c00 == glisy_half_from_float(1.0f));
+    assert(0xc000 == glisy_half_from_float(-2.0f));
+    assert(0x7bff == glisy_half_from_float(65504.0f));
+    assert(0x7c00 == glisy_half_from_float(65520.0f));
+    assert(0x0001 == glisy_half_from_float(0x1p-24f));
+    assert(0x0000 == glisy_half_from_float(0x1p-25f));
+    assert(0x3c00 == glisy_half_from_float(1.0f + 0x1p-11f));
+    assert(0x3c02 == glisy_half_from_float(1.0f + 0x3p-11f));
+    assert(0x8000 == glisy_half_from_float(-0.0f));
+    assert(isnan(glisy_half_to_float(glisy_half_from_float(NAN))));
+    assert(INFINITY == glisy_half_to_float(0x7c00));
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+      if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff)) continue;
+      assert(h == glisy_half_from_float(glisy_half_to_float((uint16_t) h)));
+    }
+  }
+
+  return 0;
+}
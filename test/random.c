@@ -0,0 +1,197 @@
+#include <assert.h>
+#include <pthread.h>
+#include <glisy/sample.h>
+
+#include "test.h"
+
+#define COUNT 4099
+
+static vec2 v2[COUNT];
+static vec3 v3[COUNT];
+static quat q[COUNT];
+
+static void *
+thread_state (void *arg) {
+  glisy_rng *rng = glisy_rng_thread();
+  *(uint32_t *) arg = glisy_rng_next(rng);
+  return 0;
+}
+
+int
+main (void) {
+  // equal seeds give equal streams, nearby seeds unrelated ones
+  {
+    glisy_rng a, b, c;
+    glisy_rng_seed(&a, 42);
+    glisy_rng_seed(&b, 42);
+    glisy_rng_seed(&c, 43);
+    int same = 0;
+    for (int i = 0; i < 1000; ++i) {
+      uint32_t x = glisy_rng_next(&a);
+      assert(x == glisy_rng_next(&b));
+      same += x == glisy_rng_next(&c);
+    }
+    assert(same < 2);
+    assert(0 == memcmp(a.lanes, b.lanes, sizeof(a.lanes)));
+    assert(a.lanes[0][0] != a.lanes[0][1]);
+  }
+
+  // a zero seed still gives a working state
+  {
+    glisy_rng rng;
+    glisy_rng_seed(&rng, 0);
+    uint32_t any = 0;
+    for (int i = 0; i < 8; ++i) any |= glisy_rng_next(&rng);
+    assert(any);
+  }
+
+  // floats cover [0, 1) with the expected mean and range
+  {
+    glisy_rng rng;
+    glisy_rng_seed(&rng, 7);
+    double sum = 0;
+    for (int i = 0; i < 100000; ++i) {
+      float u = glisy_rng_float(&rng);
+      float r = glisy_rng_range(&rng, -3, 5);
+      assert(u >= 0 && u < 1);
+      assert(r >= -3 && r < 5);
+      sum += u;
+    }
+    assert(fabs(sum / 100000 - 0.5) < 0.01);
+  }
+
+  // every thread gets its own stream
+  {
+    uint32_t first[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i) {
+      pthread_create(&threads[i], 0, thread_state, &first[i]);
+    }
+    for (int i = 0; i < 4; ++i) pthread_join(threads[i], 0);
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < i; ++j) assert(first[i] != first[j]);
+    }
+    assert(glisy_rng_thread() == glisy_rng_thread());
+  }
+
+  // the legacy generators vary between calls and keep their length
+  {
+    vec2 a = vec2_random(2), b = vec2_random(2);
+    vec3 c = vec3_random(3), d = vec3_random(3);
+    assert(a.x != b.x || a.y != b.y);
+    assert(c.x != d.x || c.z != d.z);
+    assert(fcmp(vec2_length(a), 2));
+    assert(fcmp(vec3_length(c), 3));
+  }
+
+  // batches have unit length and no bias in any direction
+  {
+    glisy_rng rng;
+    glisy_rng_seed(&rng, 1);
+    vec3 mean = vec3(0, 0, 0);
+    glisy_sample_sphere_batch(&rng, v3, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      assert(fabsf(vec3_length(v3[i]) - 1) < 1e-5f);
+      mean = vec3_add(mean, v3[i]);
+    }
+    assert(vec3_length(mean) / COUNT < 0.05f);
+
+    vec2 m2 = vec2(0, 0);
+    glisy_sample_circle_batch(&rng, v2, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      assert(fabsf(vec2_length(v2[i]) - 1) < 1e-5f);
+      m2 = vec2_add(m2, v2[i]);
+    }
+    assert(vec2_length(m2) / COUNT < 0.05f);
+
+    vec3 n = vec3(0, 2, 0);
+    glisy_sample_hemisphere_batch(&rng, v3, COUNT, n);
+    for (int i = 0; i < COUNT; ++i) {
+      assert(fabsf(vec3_length(v3[i]) - 1) < 1e-5f);
+      assert(v3[i].y >= 0);
+    }
+
+    glisy_sample_quat_batch(&rng, q, COUNT);
+    double w = 0;
+    for (int i = 0; i < COUNT; ++i) {
+      assert(fabsf(quat_length(q[i]) - 1) < 1e-5f);
+      w += fabsf(q[i].w);
+    }
+    // |w| of a uniform rotation has mean 4 / (3 pi)
+    assert(fabs(w / COUNT - 4 / (3 * M_PI)) < 0.02);
+  }
+
+  // points in the disc and ball fill them by area and volume
+  {
+    glisy_rng rng;
+    glisy_rng_seed(&rng, 2);
+    int inner = 0;
+    glisy_sample_disc_batch(&rng, v2, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      float r = vec2_length(v2[i]);
+      assert(r <= 1 + 1e-6f);
+      inner += r < 0.5f;
+    }
+    assert(fabs((double) inner / COUNT - 0.25) < 0.03);
+
+    inner = 0;
+    glisy_sample_ball_batch(&rng, v3, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      float r = vec3_length(v3[i]);
+      assert(r <= 1 + 1e-6f);
+      inner += r < 0.5f;
+    }
+    assert(fabs((double) inner / COUNT - 0.125) < 0.03);
+  }
+
+  // single samplers keep to the same shapes
+  {
+    glisy_rng rng;
+    glisy_rng_seed(&rng, 3);
+    for (int i = 0; i < 1000; ++i) {
+      assert(fabsf(vec2_length(glisy_sample_circle(&rng)) - 1) < 1e-5f);
+      assert(vec2_length(glisy_sample_disc(&rng)) <= 1 + 1e-6f);
+      assert(fabsf(vec3_length(glisy_sample_sphere(&rng)) - 1) < 1e-5f);
+      assert(glisy_sample_hemisphere(&rng, vec3(0, 0, -1)).z <= 0);
+      assert(vec3_length(glisy_sample_ball(&rng)) <= 1 + 1e-6f);
+      assert(fabsf(quat_length(glisy_sample_quat(&rng)) - 1) < 1e-5f);
+    }
+  }
+
+  // tails advance every lane, so split batches continue one stream
+  {
+    glisy_rng a, b;
+    glisy_rng_seed(&a, 9);
+    glisy_rng_seed(&b, 9);
+    glisy_sample_sphere_batch(&a, v3, 2 * GLISY_RNG_LANES);
+    vec3 head[5], tail[3];
+    glisy_sample_sphere_batch(&b, head, 5);
+    glisy_sample_sphere_batch(&b, tail, 3);
+    assert(0 == memcmp(a.lanes, b.lanes, sizeof(a.lanes)));
+    assert(0 == memcmp(v3, head, sizeof(head)));
+    assert(0 == memcmp(v3 + GLISY_RNG_LANES, tail, sizeof(tail)));
+    // and leave the scalar stream alone
+    assert(0 == memcmp(a.s, b.s, sizeof(a.s)));
+  }
+
+  // lane streams step the same as the scalar generator
+  {
+    glisy_rng rng, scalar;
+    float u[GLISY_RNG_LANES], expected;
+    glisy_sample_lanes v;
+    glisy_rng_seed(&rng, 11);
+    scalar = rng;
+    glisy_sample_lanes_load(&v, &rng);
+    glisy_sample_uniform_lanes(&v, u);
+    glisy_sample_lanes_store(&rng, &v);
+    for (int i = 0; i < GLISY_RNG_LANES; ++i) {
+      uint32_t s[4];
+      for (int k = 0; k < 4; ++k) s[k] = scalar.lanes[k][i];
+      expected = (float) (glisy_rng_step(s) >> 8) * 0x1p-24f;
+      assert(expected == u[i]);
+      for (int k = 0; k < 4; ++k) assert(s[k] == rng.lanes[k][i]);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <stdint.h>
+#include <glisy/quat_soa.h>
+
+#include "test.h"
+
+#define COUNT 45
+
+static float angles[COUNT], sines[COUNT], cosines[COUNT];
+
+/**
+ * Asserts float a is within n ulp of double e rounded to float.
+ */
+
+static inline void
+assert_ulps (float a, double e, double n) {
+  int exp;
+  frexpf((float) e, &exp);
+  double ulp = ldexp(1.0, exp - 24 < -149 ? -149 : exp - 24);
+  assert(fabs(a - e) <= n * ulp);
+}
+
+int
+main (void) {
+  // glisy_sincosf against double sin and cos
+  {
+    uint32_t state = 1;
+    for (int i = 0; i < 100000; ++i) {
+      state = state * 1664525u + 1013904223u;
+      float x = ((float) (state >> 8) / 16777216.0f - 0.5f) * 2048.0f;
+      float s, c;
+      glisy_sincosf(x, &s, &c);
+      assert_ulps(s, sin(x), 2.5);
+      assert_ulps(c, cos(x), 2.5);
+    }
+  }
+
+  // exact special values
+  {
+    float s, c;
+    glisy_sincosf(0, &s, &c);
+    assert(s == 0 && c == 1);
+    glisy_sincosf(-0.0f, &s, &c);
+    assert(s == 0 && c == 1);
+    glisy_sincosf(INFINITY, &s, &c);
+    assert(isnan(s) && isnan(c));
+    glisy_sincosf(1e6f, &s, &c);
+    assert(s == sinf(1e6f) && c == cosf(1e6f));
+  }
+
+  // glisy_sincosf_batch
+  {
+    for (int i = 0; i < COUNT; ++i) {
+      angles[i] = (i - COUNT / 2) * 0.7f;
+    }
+    angles[5] = 1e5f;
+    glisy_sincosf_batch(sines, cosines, angles, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      float s, c;
+      glisy_sincosf(angles[i], &s, &c);
+      assert(fcmp(sines[i], s));
+      assert(fcmp(cosines[i], c));
+    }
+    assert(sines[5] == sinf(1e5f));
+  }
+
+  // rotation builders
+  {
+    mat2 m = mat2_from_rotation(M_PI / 2);
+    assert(fcmp(m.m11, 0) && fcmp(m.m12, 1));
+    quat q;
+    quat_set_axis_angle(q, vec3(0, 0, 1), M_PI);
+    assert(fcmp(q.z, 1) && fcmp(q.w, 0));
+  }
+
+  // quat_slerp
+  {
+    quat a, b, q;
+    quat_set_axis_angle(a, vec3(0, 1, 0), 0.2f);
+    quat_set_axis_angle(b, vec3(0, 1, 0), 1.4f);
+    for (float t = 0; t <= 1; t += 0.125f) {
+      quat e;
+      quat_set_axis_angle(e, vec3(0, 1, 0), 0.2f + t * 1.2f);
+      quat_slerp(q, a, b, t);
+      assert(fcmp(q.y, e.y));
+      assert(fcmp(q.w, e.w));
+    }
+  }
+
+  // glisy_quat_soa_set_axis_angle
+  {
+    vec3_soa axes = vec3_soa_create();
+    quat_soa out = quat_soa_create();
+    for (int i = 0; i < COUNT; ++i) {
+      assert(0 == vec3_soa_push(axes, vec3_normalize(vec3(i, 1, -i))));
+    }
+    assert(0 == glisy_quat_soa_set_axis_angle(&out, &axes, angles));
+    assert(out.count == COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      quat e, q = quat_soa_get(out, i);
+      quat_set_axis_angle(e, vec3_soa_get(axes, i), angles[i]);
+      assert(fcmp(q.x, e.x));
+      assert(fcmp(q.y, e.y));
+      assert(fcmp(q.z, e.z));
+      assert(fcmp(q.w, e.w));
+    }
+    vec3_soa_free(axes);
+    quat_soa_free(out);
+  }
+
+  return 0;
+}
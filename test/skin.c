@@ -0,0 +1,250 @@
+#include <assert.h>
+#include <glisy/skin.h>
+
+#include "test.h"
+
+#define COUNT 1003
+#define BONES 23
+
+static trs world[BONES], bind[BONES], inverse_bind[BONES];
+static mat4 world4[BONES], inverse4[BONES];
+static mat3x4 inverse34[BONES], palette[BONES];
+static dquat dpalette[BONES];
+
+static inline trs
+random_trs (float scale) {
+  trs a = trs_create();
+  quat_set_axis_angle(a.rotation,
+                      vec3_normalize(vec3(random_float(), random_float(),
+                                          random_float())),
+                      random_float() * 3.0f);
+  a.translation = vec3(random_float() * 10, random_float() * 10,
+                       random_float() * 10);
+  a.scale = vec3(1 + scale * random_float(), 1 + scale * random_float(),
+                 1 + scale * random_float());
+  return a;
+}
+
+static void
+random_weights (skin_weights *w, int influences) {
+  assert(0 == glisy_skin_weights_resize(w, COUNT, influences));
+  for (size_t i = 0; i < COUNT; ++i) {
+    uint16_t bones[GLISY_SKIN_MAX_INFLUENCES];
+    float weights[GLISY_SKIN_MAX_INFLUENCES];
+    int n = 1 + (int) (i % influences);
+    for (int k = 0; k < n; ++k) {
+      bones[k] = (uint16_t) ((i * 7 + k * 5) % BONES);
+      weights[k] = 1.5f + random_float();
+    }
+    assert(0 == glisy_skin_weights_set(w, i, n, bones, weights));
+  }
+}
+
+/**
+ * The blended mat4 of vertex i, built from mat4 building blocks.
+ */
+
+static mat4
+reference_matrix (const skin_weights *w, size_t i) {
+  mat4 m = {0};
+  float *a = &m.m11;
+  for (int k = 0; k < w->influences; ++k) {
+    float s = w->weights[k * w->capacity + i];
+    mat4 b = mat4_multiply(world4[w->bones[k * w->capacity + i]],
+                           inverse4[w->bones[k * w->capacity + i]]);
+    for (int e = 0; e < 16; ++e) a[e] += s * (&b.m11)[e];
+  }
+  return m;
+}
+
+static dquat
+reference_dquat (const skin_weights *w, size_t i) {
+  dquat q = {{0, 0, 0, 0}, {0, 0, 0, 0}}, pivot = dquat_create();
+  for (int k = 0; k < w->influences; ++k) {
+    float s = w->weights[k * w->capacity + i];
+    dquat b = dpalette[w->bones[k * w->capacity + i]];
+    if (0 == s) continue;
+    if (0 == k) pivot = b;
+    if (quat_dot(pivot.real, b.real) < 0) s = -s;
+    for (int e = 0; e < 8; ++e) (&q.real.x)[e] += s * (&b.real.x)[e];
+  }
+  return dquat_normalize(q);
+}
+
+int
+main (void) {
+  seed = 3;
+  glisy_pool pool;
+  skin_weights weights = skin_weights_create();
+  vec3_soa positions = vec3_soa_create(), normals = vec3_soa_create();
+  vec3_soa out = vec3_soa_create(), out_normals = vec3_soa_create();
+  vec3_soa serial = vec3_soa_create(), serial_normals = vec3_soa_create();
+  assert(0 == glisy_pool_init(&pool, 4, 0));
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    vec3 p = vec3(random_float() * 2, random_float() * 2, random_float());
+    vec3 n = vec3_normalize(vec3(random_float(), random_float(), 0.5f));
+    assert(0 == vec3_soa_push(positions, p));
+    assert(0 == vec3_soa_push(normals, n));
+  }
+
+  // weights are normalized, cleared past n, and checked
+  {
+    skin_weights w = skin_weights_create();
+    uint16_t bones[3] = {4, 9, 2};
+    float ws[3] = {2, 1, 1};
+    assert(-1 == skin_weights_resize(w, 10, 9));
+    assert(-1 == skin_weights_resize(w, 10, 0));
+    assert(0 == skin_weights_resize(w, 10, 4));
+    assert(0 == skin_weights_set(w, 3, 3, bones, ws));
+    assert(fcmp(w.weights[3], 0.5f) && fcmp(w.weights[w.capacity + 3], 0.25f));
+    assert(9 == w.bones[w.capacity + 3] && 0 == w.weights[3 * w.capacity + 3]);
+    assert(-1 == skin_weights_set(w, 10, 3, bones, ws));
+    assert(-1 == skin_weights_set(w, 3, 5, bones, ws));
+    assert(-1 == skin_weights_set(w, 3, 0, bones, ws));
+    // growing keeps weights, shrinking clears the dropped ones
+    assert(0 == skin_weights_resize(w, 100, 4));
+    assert(fcmp(w.weights[3], 0.5f) && 2 == w.bones[2 * w.capacity + 3]);
+    assert(0 == skin_weights_resize(w, 2, 4));
+    assert(0 == w.weights[3] && 0 == w.bones[w.capacity + 3]);
+    skin_weights_free(w);
+    assert(0 == w.weights && 0 == w.count);
+  }
+
+  // palettes from mat4 and trs agree
+  for (int b = 0; b < BONES; ++b) {
+    world[b] = random_trs(0.3f);
+    bind[b] = random_trs(0.3f);
+    world4[b] = trs_to_mat4(world[b]);
+    inverse4[b] = mat4_invert(trs_to_mat4(bind[b]));
+    inverse34[b] = mat3x4_from_mat4(inverse4[b]);
+  }
+  glisy_skin_palette_mat4(palette, world4, inverse4, BONES);
+  {
+    mat3x4 p[BONES];
+    glisy_skin_palette_trs(p, world, inverse34, BONES);
+    for (int b = 0; b < BONES; ++b) {
+      vec3 v = vec3(1, 2, 3);
+      vec3_assert_close(mat3x4_transform_point(p[b], v),
+                        mat3x4_transform_point(palette[b], v));
+    }
+  }
+
+  // linear blend skinning matches blending mat4s, 4 and 8 weights
+  for (int influences = 4; influences <= 8; influences += 4) {
+    random_weights(&weights, influences);
+    assert(0 == glisy_skin_lbs(&pool, &out, &out_normals, &positions,
+                               &normals, &weights, palette));
+    assert(COUNT == out.count && COUNT == out_normals.count);
+    for (size_t i = 0; i < COUNT; ++i) {
+      mat4 m = reference_matrix(&weights, i);
+      vec3 p = vec3_transform_mat4(vec3_soa_get(positions, i), m);
+      vec3_assert_close(vec3_soa_get(out, i), p);
+      vec3 n = vec3_soa_get(normals, i);
+      n = vec3_normalize(vec3(m.m11 * n.x + m.m21 * n.y + m.m31 * n.z,
+                              m.m12 * n.x + m.m22 * n.y + m.m32 * n.z,
+                              m.m13 * n.x + m.m23 * n.y + m.m33 * n.z));
+      vec3_assert_close(vec3_soa_get(out_normals, i), n);
+    }
+    for (size_t i = COUNT; i < out.capacity; ++i) {
+      assert(0 == out.x[i] && 0 == out_normals.z[i]);
+    }
+
+    // threads do not change the result
+    assert(0 == glisy_skin_lbs(NULL, &serial, &serial_normals, &positions,
+                               &normals, &weights, palette));
+    assert(0 == memcmp(serial.x, out.x, COUNT * sizeof(float)));
+    assert(0 == memcmp(serial_normals.y, out_normals.y,
+                       COUNT * sizeof(float)));
+  }
+
+  // dual quaternion skinning of rigid bones
+  for (int b = 0; b < BONES; ++b) {
+    world[b].scale = bind[b].scale = vec3(1, 1, 1);
+    inverse_bind[b] = trs_invert(bind[b]);
+    world4[b] = trs_to_mat4(world[b]);
+    inverse4[b] = trs_to_mat4(inverse_bind[b]);
+  }
+  glisy_skin_palette_mat4(palette, world4, inverse4, BONES);
+  glisy_skin_dquat_palette_trs(dpalette, world, inverse_bind, BONES);
+  {
+    dquat p[BONES];
+    glisy_skin_dquat_palette_mat4(p, world4, inverse4, BONES);
+    for (int b = 0; b < BONES; ++b) {
+      vec3 v = vec3(1, 2, 3);
+      vec3_assert_close(dquat_transform_point(p[b], v),
+                        dquat_transform_point(dpalette[b], v));
+      vec3_assert_close(dquat_transform_point(p[b], v),
+                        mat3x4_transform_point(palette[b], v));
+    }
+  }
+  // flip a bone to the far side of the sphere; blending must not care
+  dpalette[5] = dquat({-dpalette[5].real.x, -dpalette[5].real.y,
+                       -dpalette[5].real.z, -dpalette[5].real.w},
+                      {-dpalette[5].dual.x, -dpalette[5].dual.y,
+                       -dpalette[5].dual.z, -dpalette[5].dual.w});
+  for (int influences = 4; influences <= 8; influences += 4) {
+    random_weights(&weights, influences);
+    assert(0 == glisy_skin_dqs(&pool, &out, &out_normals, &positions,
+                               &normals, &weights, dpalette));
+    for (size_t i = 0; i < COUNT; ++i) {
+      dquat q = reference_dquat(&weights, i);
+      vec3_assert_close(vec3_soa_get(out, i),
+                        dquat_transform_point(q, vec3_soa_get(positions, i)));
+      vec3 n = vec3_soa_get(out_normals, i);
+      vec3_assert_close(n, dquat_transform_vector(q,
+                                                  vec3_soa_get(normals, i)));
+      assert(fabsf(vec3_length(n) - 1) < 1e-5f);
+    }
+    for (size_t i = COUNT; i < out.capacity; ++i) {
+      assert(0 == out.y[i] && 0 == out_normals.x[i]);
+    }
+    assert(0 == glisy_skin_dqs(NULL, &serial, &serial_normals, &positions,
+                               &normals, &weights, dpalette));
+    assert(0 == memcmp(serial.z, out.z, COUNT * sizeof(float)));
+  }
+
+  // a vertex on one bone moves rigidly with it under both methods
+  {
+    uint16_t bone = 11;
+    float one = 1;
+    assert(0 == glisy_skin_weights_set(&weights, 0, 1, &bone, &one));
+    assert(0 == glisy_skin_lbs(NULL, &out, NULL, &positions, NULL,
+                               &weights, palette));
+    vec3 p = vec3_soa_get(positions, 0);
+    vec3_assert_close(vec3_soa_get(out, 0),
+                      trs_transform_point(world[11],
+                        trs_transform_point(inverse_bind[11], p)));
+    assert(0 == glisy_skin_dqs(NULL, &serial, NULL, &positions, NULL,
+                               &weights, dpalette));
+    vec3_assert_close(vec3_soa_get(serial, 0), vec3_soa_get(out, 0));
+  }
+
+  // in place, and mismatched counts
+  {
+    vec3_soa copy = vec3_soa_create();
+    assert(0 == glisy_vec3_soa_resize(&copy, COUNT));
+    memcpy(copy.x, positions.x, COUNT * sizeof(float));
+    memcpy(copy.y, positions.y, COUNT * sizeof(float));
+    memcpy(copy.z, positions.z, COUNT * sizeof(float));
+    assert(0 == glisy_skin_lbs(&pool, &copy, NULL, &copy, NULL, &weights,
+                               palette));
+    assert(0 == memcmp(copy.x, out.x, COUNT * sizeof(float)));
+    assert(0 == glisy_vec3_soa_resize(&copy, COUNT - 1));
+    assert(-1 == glisy_skin_dqs(&pool, &out, NULL, &copy, NULL, &weights,
+                                dpalette));
+    assert(-1 == glisy_skin_lbs(&pool, &out, NULL, &positions, &copy,
+                                &weights, palette));
+    vec3_soa_free(copy);
+  }
+
+  skin_weights_free(weights);
+  vec3_soa_free(positions);
+  vec3_soa_free(normals);
+  vec3_soa_free(out);
+  vec3_soa_free(out_normals);
+  vec3_soa_free(serial);
+  vec3_soa_free(serial_normals);
+  glisy_pool_destroy(&pool);
+  return 0;
+}
@@ -0,0 +1,233 @@
+#include <assert.h>
+#include <stdint.h>
+#include <glisy/vec3_soa.h>
+#include <glisy/quat_soa.h>
+#include <glisy/quat_pack.h>
+
+#include "test.h"
+
+#define COUNT 45
+
+static vec3 as[COUNT], bs[COUNT], out3[COUNT];
+static vec4 as4[COUNT], out4[COUNT];
+static quat qs[COUNT], rs[COUNT], outq[COUNT];
+static float dots[COUNT];
+
+static inline void
+vec3_assert_equals (vec3 a, vec3 b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+  assert(fcmp(a.z, b.z));
+}
+
+static inline void
+quat_assert_equals (quat a, quat b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+  assert(fcmp(a.z, b.z));
+  assert(fcmp(a.w, b.w));
+}
+
+int
+main (void) {
+  for (int i = 0; i < COUNT; ++i) {
+    as[i] = vec3(i, 1 - i, 0.5f * i);
+    bs[i] = vec3(2, i * 0.25f, -i);
+    as4[i] = vec4(i, -i, 2 * i, 1);
+    qs[i] = quat(i, 1, -i, 2);
+    rs[i] = quat(0.5f, i, 3, -i);
+  }
+  as[3] = vec3(0, 0, 0);
+
+  // growth, alignment and zero padding
+  vec3_soa a = vec3_soa_create();
+  for (int i = 0; i < COUNT; ++i) {
+    assert(0 == vec3_soa_push(a, as[i]));
+  }
+  assert(COUNT == a.count);
+  assert(0 == a.capacity % GLISY_SOA_PAD);
+  assert(0 == (uintptr_t) a.x % GLISY_SIMD_ALIGN);
+  assert(0 == (uintptr_t) a.y % GLISY_SIMD_ALIGN);
+  assert(0 == (uintptr_t) a.z % GLISY_SIMD_ALIGN);
+  for (size_t i = COUNT; i < a.capacity; ++i) {
+    assert(0 == a.x[i] && 0 == a.y[i] && 0 == a.z[i]);
+  }
+  vec3_assert_equals(vec3_soa_get(a, 7), as[7]);
+  assert(0 == vec3_soa_resize(a, 10));
+  assert(0 == a.x[10] && 0 == a.y[11]);
+
+  // gather and scatter round trip
+  vec3_soa b = vec3_soa_create();
+  assert(0 == glisy_vec3_soa_from_vec3(&a, as, COUNT));
+  assert(0 == glisy_vec3_soa_from_vec3(&b, bs, COUNT));
+  glisy_vec3_soa_to_vec3(out3, &a);
+  assert(0 == memcmp(out3, as, sizeof(as)));
+
+  vec3_soa c = vec3_soa_create();
+  assert(0 == glisy_vec3_soa_from_vec4(&c, as4, COUNT));
+  glisy_vec3_soa_to_vec4(out4, &c, 1);
+  assert(0 == memcmp(out4, as4, sizeof(as4)));
+
+  // batch vec3 routines
+  vec3_soa r = vec3_soa_create();
+  assert(0 == glisy_vec3_soa_add(&r, &a, &b));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(r, i), vec3_add(as[i], bs[i]));
+  }
+  assert(0 == glisy_vec3_soa_subtract(&r, &a, &b));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(r, i), vec3_subtract(as[i], bs[i]));
+  }
+  assert(0 == glisy_vec3_soa_scale(&r, &a, 3));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(r, i), vec3_scale(as[i], 3));
+  }
+  assert(0 == glisy_vec3_soa_cross(&r, &a, &b));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(r, i), vec3_cross(as[i], bs[i]));
+  }
+  assert(0 == glisy_vec3_soa_lerp(&r, &a, &b, 0.25f));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(r, i), vec3_lerp(as[i], bs[i], 0.25f));
+  }
+  glisy_vec3_soa_dot(dots, &a, &b);
+  for (int i = 0; i < COUNT; ++i) {
+    assert(fcmp(dots[i], vec3_dot(as[i], bs[i])));
+  }
+
+  // in place normalize keeps zero vectors zero
+  assert(0 == glisy_vec3_soa_normalize(&a, &a));
+  for (int i = 0; i < COUNT; ++i) {
+    vec3_assert_equals(vec3_soa_get(a, i), vec3_normalize(as[i]));
+  }
+
+  // quat containers
+  quat_soa q = quat_soa_create();
+  quat_soa p = quat_soa_create();
+  quat_soa o = quat_soa_create();
+  assert(0 == glisy_quat_soa_from_quat(&q, qs, COUNT));
+  assert(0 == glisy_quat_soa_from_quat(&p, rs, COUNT));
+  assert(0 == (uintptr_t) q.w % GLISY_SIMD_ALIGN);
+  glisy_quat_soa_to_quat(outq, &q);
+  assert(0 == memcmp(outq, qs, sizeof(qs)));
+  assert(0 == glisy_quat_soa_from_vec4(&o, as4, COUNT));
+  glisy_quat_soa_to_vec4(out4, &o);
+  assert(0 == memcmp(out4, as4, sizeof(as4)));
+
+  assert(0 == glisy_quat_soa_add(&o, &q, &p));
+  for (int i = 0; i < COUNT; ++i) {
+    quat_assert_equals(quat_soa_get(o, i), quat_add(qs[i], rs[i]));
+  }
+  assert(0 == glisy_quat_soa_subtract(&o, &q, &p));
+  for (int i = 0; i < COUNT; ++i) {
+    quat q = quat_soa_get(o, i);
+    quat_assert_equals(q, quat(qs[i].x - rs[i].x, qs[i].y - rs[i].y,
+                               qs[i].z - rs[i].z, qs[i].w - rs[i].w));
+  }
+  assert(0 == glisy_quat_soa_scale(&o, &q, 2));
+  for (int i = 0; i < COUNT; ++i) {
+    quat_assert_equals(quat_soa_get(o, i), quat_scale(qs[i], 2));
+  }
+  assert(0 == glisy_quat_soa_lerp(&o, &q, &p, 0.75f));
+  for (int i = 0; i < COUNT; ++i) {
+    quat_assert_equals(quat_soa_get(o, i), quat_lerp(qs[i], rs[i], 0.75f));
+  }
+  glisy_quat_soa_dot(dots, &q, &p);
+  for (int i = 0; i < COUNT; ++i) {
+    assert(fcmp(dots[i], quat_dot(qs[i], rs[i])));
+  }
+  assert(0 == glisy_quat_soa_normalize(&q, &q));
+  for (int i = 0; i < COUNT; ++i) {
+    quat_assert_equals(quat_soa_get(q, i), quat_normalize(qs[i]));
+  }
+
+  // slerp, nlerp and the corrected nlerp against quat_slerp, on
+  // unit quats with an equal, an opposite and a close pair
+  assert(0 == glisy_quat_soa_normalize(&p, &p));
+  glisy_quat_soa_set(&p, 1, quat_soa_get(q, 1));
+  glisy_quat_soa_set(&p, 2, quat_scale(quat_soa_get(q, 2), -1));
+  glisy_quat_soa_set(&p, 3, quat_normalize(quat_add(quat_soa_get(q, 3),
+                                                    quat(1e-4f, 0, 0, 0))));
+  for (int k = -2; k <= 12; ++k) {
+    float t = k * 0.1f;
+    quat_soa f = quat_soa_create();
+    assert(0 == glisy_quat_soa_slerp(&o, &q, &p, t));
+    assert(0 == glisy_quat_soa_slerp_fast(&f, &q, &p, t));
+    for (int i = 0; i < COUNT; ++i) {
+      quat e;
+      quat_slerp(e, quat_soa_get(q, i), quat_soa_get(p, i), t);
+      assert(glisy_quat_error_degrees(quat_soa_get(o, i), e) < 1e-3f);
+      if (t >= 0 && t <= 1) {
+        assert(glisy_quat_error_degrees(quat_soa_get(f, i), e) < 0.05f);
+      }
+    }
+    quat_soa_free(f);
+  }
+  assert(0 == glisy_quat_soa_nlerp(&o, &q, &p, 0.5f));
+  for (int i = 0; i < COUNT; ++i) {
+    quat e;
+    quat_slerp(e, quat_soa_get(q, i), quat_soa_get(p, i), 0.5f);
+    assert(glisy_quat_error_degrees(quat_soa_get(o, i), e) < 1e-3f);
+  }
+
+  // the AoS batches match the SoA kernels, tails included
+  {
+    quat a4[COUNT], b4[COUNT];
+    glisy_quat_soa_to_quat(a4, &q);
+    glisy_quat_soa_to_quat(b4, &p);
+    void (*batch[3]) (quat *, const quat *, const quat *, float, size_t) = {
+      glisy_quat_slerp_batch, glisy_quat_nlerp_batch,
+      glisy_quat_slerp_fast_batch
+    };
+    int (*soa[3]) (quat_soa *, const quat_soa *, const quat_soa *, float) = {
+      glisy_quat_soa_slerp, glisy_quat_soa_nlerp, glisy_quat_soa_slerp_fast
+    };
+    for (int k = 0; k < 3; ++k) {
+      assert(0 == soa[k](&o, &q, &p, 0.3f));
+      batch[k](outq, a4, b4, 0.3f, COUNT);
+      for (int i = 0; i < COUNT; ++i) {
+        assert(glisy_quat_error_degrees(outq[i], quat_soa_get(o, i)) < 1e-3f);
+      }
+    }
+  }
+
+  // blends of two poses are nlerp, and opposite signs do not cancel
+  {
+    quat_soa poses[3] = {q, p, quat_soa_create()};
+    float weights[3] = {0.25f, 0.75f, 0.5f};
+    assert(0 == glisy_quat_soa_scale(&poses[2], &q, -1));
+    assert(0 == glisy_quat_soa_blend(&o, poses, weights, 2));
+    quat_soa n = quat_soa_create();
+    assert(0 == glisy_quat_soa_nlerp(&n, &q, &p, 0.75f));
+    for (int i = 0; i < COUNT; ++i) {
+      assert(glisy_quat_error_degrees(quat_soa_get(o, i),
+                                      quat_soa_get(n, i)) < 1e-3f);
+    }
+    quat_soa_free(n);
+    float halves[2] = {0.5f, 0.5f};
+    quat_soa pair[2] = {q, poses[2]};
+    assert(0 == glisy_quat_soa_blend(&o, pair, halves, 2));
+    for (int i = 0; i < COUNT; ++i) {
+      assert(glisy_quat_error_degrees(quat_soa_get(o, i),
+                                      quat_soa_get(q, i)) < 1e-3f);
+    }
+    // three ways, one of them flipped
+    quat_soa c3 = quat_soa_create();
+    assert(0 == glisy_quat_soa_blend(&c3, poses, weights, 3));
+    for (int i = 0; i < COUNT; ++i) {
+      assert(fabsf(quat_length(quat_soa_get(c3, i)) - 1) < 1e-5f);
+    }
+    quat_soa_free(c3);
+    quat_soa_free(poses[2]);
+  }
+
+  vec3_soa_free(a);
+  vec3_soa_free(b);
+  vec3_soa_free(c);
+  vec3_soa_free(r);
+  quat_soa_free(q);
+  quat_soa_free(p);
+  quat_soa_free(o);
+  assert(0 == a.count && 0 == a.x);
+  return 0;
+}
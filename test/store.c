@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <glisy/store.h>
+
+#include "test.h"
+
+#define COUNT 1000
+#define PATH "store.bin"
+
+static mat4 ms[COUNT];
+static vec3 vs[COUNT];
+static trs ts[COUNT];
+
+int
+main (void) {
+  vec3_soa positions = vec3_soa_create();
+  quat_soa rotations = quat_soa_create();
+
+  assert(64 == sizeof(glisy_store_header));
+  assert(64 == sizeof(glisy_store_section));
+  assert(10 * sizeof(float) == sizeof(trs));
+  assert(12 * sizeof(float) == sizeof(mat3x4));
+
+  for (int i = 0; i < COUNT; ++i) {
+    ms[i] = mat4_create();
+    ms[i] = mat4_translate(ms[i], vec3(i, 2 * i, -i));
+    vs[i] = vec3(i, i + 0.5f, i + 0.25f);
+    ts[i] = trs_create();
+    ts[i].translation = vs[i];
+    vec3_soa_push(positions, vs[i]);
+    quat_soa_push(rotations, quat(0, 0, i, 1));
+  }
+
+  // write every kind of section, the streamed ones in pieces
+  {
+    glisy_store_writer w;
+    assert(0 == glisy_store_writer_open(&w, PATH));
+    assert(0 == glisy_store_writer_write(&w, "matrices", GLISY_STORE_MAT4,
+                                         GLISY_STORE_AOS, ms, COUNT));
+    assert(0 == glisy_store_writer_begin(&w, "points", GLISY_STORE_VEC3,
+                                         GLISY_STORE_SOA));
+    for (int i = 0; i < COUNT; i += 300) {
+      size_t n = COUNT - i < 300 ? COUNT - i : 300;
+      assert(0 == glisy_store_writer_append(&w, vs + i, n));
+    }
+    // begin ends the open section
+    assert(0 == glisy_store_writer_begin(&w, "trs", GLISY_STORE_TRS,
+                                         GLISY_STORE_AOS));
+    assert(0 == glisy_store_writer_append(&w, ts, 7));
+    assert(0 == glisy_store_writer_append(&w, ts + 7, COUNT - 7));
+    assert(0 == glisy_store_writer_vec3_soa(&w, "positions", &positions));
+    assert(0 == glisy_store_writer_quat_soa(&w, "rotations", &rotations));
+    assert(0 == glisy_store_writer_write(&w, "empty", GLISY_STORE_VEC3,
+                                         GLISY_STORE_SOA, NULL, 0));
+    assert(-1 == glisy_store_writer_begin(&w, "a name far too long",
+                                          GLISY_STORE_VEC3, GLISY_STORE_AOS));
+    assert(-1 == glisy_store_writer_begin(&w, "bad", 99, GLISY_STORE_AOS));
+    assert(0 == glisy_store_writer_close(&w));
+  }
+
+  // read it back in place
+  {
+    glisy_store s;
+    size_t count = 0;
+    vec3_soa points, view;
+    quat_soa quats;
+    assert(0 == glisy_store_open(&s, PATH));
+    assert(6 == s.count);
+
+    mat4 *m = glisy_store_mat4(&s, "matrices", &count);
+    assert(m && COUNT == count);
+    assert(0 == ((uintptr_t) m & (GLISY_STORE_ALIGN - 1)));
+    assert(0 == memcmp(ms, m, sizeof(ms)));
+
+    trs *t = glisy_store_trs(&s, "trs", &count);
+    assert(t && COUNT == count);
+    assert(0 == memcmp(ts, t, sizeof(ts)));
+
+    assert(0 == glisy_store_vec3_soa(&s, "points", &points));
+    assert(COUNT == points.count);
+    assert(0 == points.capacity % GLISY_SOA_PAD);
+    assert(0 == ((uintptr_t) points.y & (GLISY_STORE_ALIGN - 1)));
+    for (int i = 0; i < COUNT; ++i) {
+      vec3 v = vec3_soa_get(points, i);
+      assert(0 == memcmp(&vs[i], &v, sizeof(v)));
+    }
+    for (size_t i = COUNT; i < points.capacity; ++i) {
+      assert(0 == points.x[i] && 0 == points.y[i] && 0 == points.z[i]);
+    }
+
+    assert(0 == glisy_store_vec3_soa(&s, "positions", &view));
+    assert(0 == memcmp(view.z, positions.z, COUNT * sizeof(float)));
+    assert(0 == glisy_store_quat_soa(&s, "rotations", &quats));
+    assert(0 == memcmp(quats.w, rotations.w, COUNT * sizeof(float)));
+
+    // views work with the batch routines, in place
+    glisy_vec3_soa_normalize(&view, &view);
+    assert(fabsf(vec3_length(vec3_soa_get(view, 5)) - 1) < 1e-6f);
+
+    assert(0 == glisy_store_vec3_soa(&s, "empty", &view));
+    assert(0 == view.count);
+
+    // wrong type or layout, or missing
+    assert(NULL == glisy_store_vec3(&s, "points", &count));
+    assert(NULL == glisy_store_mat3(&s, "matrices", &count));
+    assert(NULL == glisy_store_mat4(&s, "missing", &count));
+    assert(-1 == glisy_store_quat_soa(&s, "positions", &quats));
+    glisy_store_close(&s);
+
+    // the mapping is private, so the file kept its positions
+    assert(0 == glisy_store_open(&s, PATH));
+    assert(0 == glisy_store_vec3_soa(&s, "positions", &view));
+    assert(0 == memcmp(view.x, positions.x, COUNT * sizeof(float)));
+    glisy_store_close(&s);
+  }
+
+  // damaged containers are rejected
+  {
+    FILE *file = fopen(PATH, "rb");
+    size_t size;
+    fseek(file, 0, SEEK_END);
+    size = (size_t) ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = glisy_simd_alloc(size);
+    assert(size == fread(data, 1, size, file));
+    fclose(file);
+
+    glisy_store s;
+    glisy_store_header *h = (glisy_store_header *) data;
+    glisy_store_section *e = (glisy_store_section *) (data + h->directory);
+    assert(0 == glisy_store_open_memory(&s, data, size));
+    assert(-1 == glisy_store_open_memory(&s, data, size - 1));
+    assert(-1 == glisy_store_open_memory(&s, data + 1, size - 1));
+    h->version = 2;
+    assert(-1 == glisy_store_open_memory(&s, data, size));
+    h->version = GLISY_STORE_VERSION;
+    e[1].capacity = 1ull << 60;
+    assert(-1 == glisy_store_open_memory(&s, data, size));
+    e[1].capacity = e[1].count;
+    assert(-1 == glisy_store_open_memory(&s, data, size));
+    e[1].capacity = glisy_store_capacity(e[1].count);
+    e[2].offset += 4;
+    assert(-1 == glisy_store_open_memory(&s, data, size));
+    e[2].offset -= 4;
+    assert(0 == glisy_store_open_memory(&s, data, size));
+    free(data);
+
+    // an unfinished file has no header
+    glisy_store_writer w;
+    assert(0 == glisy_store_writer_open(&w, PATH));
+    assert(0 == glisy_store_writer_write(&w, "matrices", GLISY_STORE_MAT4,
+                                         GLISY_STORE_AOS, ms, COUNT));
+    fflush(w.file);
+    assert(-1 == glisy_store_open(&s, PATH));
+    assert(0 == glisy_store_writer_close(&w));
+    assert(0 == glisy_store_open(&s, PATH));
+    glisy_store_close(&s);
+  }
+
+  remove(PATH);
+  vec3_soa_free(positions);
+  quat_soa_free(rotations);
+  return 0;
+}
@@ -2,7 +2,9 @@
 #define GLISY_TEST_H
 
 #include <math.h>
+#include <float.h>
 #include <stdio.h>
+#include <assert.h>
 #include <string.h>
 #include <GLFW/glfw3.h>
 #include <glisy/math.h>
@@ -10,6 +12,76 @@
 #define EPISILON 0.0001
 #define fcmp(a, b) fabs(a - b) < EPISILON
 
+/**
+ * Shared test random numbers: a 32 bit LCG. Tests wanting another
+ * sequence assign seed before drawing.
+ */
+
+static unsigned int seed = 1;
+
+static inline unsigned int
+random_bits (void) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed;
+}
+
+/**
+ * Returns a random float in [-1, 1).
+ */
+
+static inline float
+random_float (void) {
+  return (float) (random_bits() >> 8) / (float) (1 << 24) * 2.0f - 1.0f;
+}
+
+/**
+ * Asserts every element of a is within ulps units in the last
+ * place of the largest magnitude element of b.
+ */
+
+static inline void
+floats_assert_ulps (const float *x, const float *y, int n, float ulps) {
+  float scale = 0;
+  for (int i = 0; i < n; ++i) {
+    scale = fmaxf(scale, fabsf(y[i]));
+  }
+  for (int i = 0; i < n; ++i) {
+    assert(fabsf(x[i] - y[i]) <= ulps * scale * FLT_EPSILON);
+  }
+}
+
+static inline void
+mat4_assert_ulps (mat4 a, mat4 b, float ulps) {
+  floats_assert_ulps(&a.m11, &b.m11, 16, ulps);
+}
+
+static inline void
+vec4_assert_ulps (vec4 a, vec4 b, float ulps) {
+  floats_assert_ulps(&a.x, &b.x, 4, ulps);
+}
+
+/**
+ * Asserts every element of a is within 1e-4 of b, relative to b
+ * when b is larger than 1.
+ */
+
+static inline void
+floats_assert_close (const float *x, const float *y, int n) {
+  for (int i = 0; i < n; ++i) {
+    assert(fabsf(x[i] - y[i]) <= 1e-4f * fmaxf(1, fabsf(y[i])));
+  }
+}
+
+static inline void
+vec3_assert_close (vec3 a, vec3 b) {
+  floats_assert_close(&a.x, &b.x, 3);
+}
+
+static inline void
+mat4_assert_close (mat4 a, mat4 b) {
+  floats_assert_close(&a.m11, &b.m11, 16);
+}
+
 #define TEST(body) { \
   if (!glfwInit()) return 1; \
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); \
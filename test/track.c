@@ -0,0 +1,155 @@
+#include <assert.h>
+#include <glisy/track.h>
+#include <glisy/quat_pack.h>
+
+#include "test.h"
+
+#define TRACKS 37
+#define KEYS 50
+
+static track tracks[TRACKS];
+static track_cursor cursors[TRACKS];
+
+/**
+ * Samples track t at time the slow way: a fresh cursor, so every
+ * channel is binary searched from the start.
+ */
+
+static trs
+reference (const track *t, float time) {
+  track_cursor c = track_cursor_create();
+  c.translation = c.rotation = c.scale = UINT32_MAX;
+  return glisy_track_sample(t, &c, time);
+}
+
+static void
+assert_trs_close (trs a, trs b) {
+  assert(fabsf(a.translation.x - b.translation.x) < 1e-4f);
+  assert(fabsf(a.translation.y - b.translation.y) < 1e-4f);
+  assert(fabsf(a.translation.z - b.translation.z) < 1e-4f);
+  assert(glisy_quat_error_degrees(a.rotation, b.rotation) < 1e-3f);
+  assert(fabsf(a.scale.x - b.scale.x) < 1e-4f);
+  assert(fabsf(a.scale.y - b.scale.y) < 1e-4f);
+  assert(fabsf(a.scale.z - b.scale.z) < 1e-4f);
+}
+
+int
+main (void) {
+  // keys must be in increasing time
+  {
+    track t = track_create();
+    assert(0 == track_add_translation(t, 0, vec3(0, 0, 0)));
+    assert(0 == track_add_translation(t, 1, vec3(2, 4, 6)));
+    assert(-1 == track_add_translation(t, 1, vec3(0, 0, 0)));
+    assert(-1 == track_add_translation(t, 0.5f, vec3(0, 0, 0)));
+    assert(-1 == track_add_scale(t, NAN, vec3(1, 1, 1)));
+    assert(2 == t.translation.count);
+    assert(1 == track_duration(t));
+
+    // empty channels sample to the identity, times clamp to the keys
+    track_cursor c = track_cursor_create();
+    trs s = track_sample(t, c, 0.25f);
+    assert(fcmp(s.translation.x, 0.5f) && fcmp(s.translation.z, 1.5f));
+    assert(0 == s.rotation.x && 1 == s.rotation.w);
+    assert(1 == s.scale.x && 1 == s.scale.y && 1 == s.scale.z);
+    s = track_sample(t, c, -3);
+    assert(0 == s.translation.y);
+    s = track_sample(t, c, 8);
+    assert(4 == s.translation.y);
+    track_free(t);
+    assert(0 == t.translation.count && 0 == t.translation.times);
+  }
+
+  // uneven key times per channel
+  for (int i = 0; i < TRACKS; ++i) {
+    track *t = &tracks[i];
+    float time = 0;
+    for (int k = 0; k < KEYS + i; ++k) {
+      time += 0.05f + 0.01f * ((k * 7 + i) % 5);
+      assert(0 == glisy_track_add_translation(t, time,
+                    vec3(k, i * 0.5f, -k * 0.25f)));
+      if (k % 3 == 0) {
+        assert(0 == glisy_track_add_scale(t, time,
+                      vec3(1 + 0.1f * k, 1, 2)));
+      }
+      quat q;
+      quat_set_axis_angle(q, vec3_normalize(vec3(1, i, 2)), k * 0.7f);
+      // alternate signs so sampling must pick the shorter arc
+      if (k % 2) q = quat_scale(q, -1);
+      assert(0 == glisy_track_add_rotation(t, time * 1.1f, q));
+    }
+    if (i == 5) glisy_track_free(t);
+    if (i == 6) tracks[6].rotation.count = 1;
+  }
+
+  // forward playback with cursors, small and large steps, matches
+  // binary search from scratch and slerp between the keys
+  for (float dt = 0.004f; dt < 1; dt *= 3) {
+    for (int i = 0; i < TRACKS; ++i) cursors[i] = track_cursor_create();
+    for (float time = -0.5f; time < 5; time += dt) {
+      for (int i = 0; i < TRACKS; ++i) {
+        trs s = glisy_track_sample(&tracks[i], &cursors[i], time);
+        assert_trs_close(s, reference(&tracks[i], time));
+      }
+    }
+  }
+
+  // on a key and half way between two, against trs_lerp
+  {
+    const track *t = &tracks[3];
+    track_cursor c = track_cursor_create();
+    float t0 = t->rotation.times[10], t1 = t->rotation.times[11];
+    const quat *q = (const quat *) t->rotation.values;
+    trs s = glisy_track_sample(t, &c, t0);
+    assert(0 == memcmp(&s.rotation, &q[10], sizeof(quat)));
+    s = glisy_track_sample(t, &c, 0.5f * (t0 + t1));
+    trs a = trs(vec3(0, 0, 0), q[10], vec3(1, 1, 1));
+    trs b = trs(vec3(0, 0, 0), q[11], vec3(1, 1, 1));
+    assert(glisy_quat_error_degrees(s.rotation,
+                                    trs_lerp(a, b, 0.5f).rotation) < 1e-3f);
+  }
+
+  // playing backwards and jumping around
+  {
+    track_cursor c = track_cursor_create();
+    for (float time = 5; time > -1; time -= 0.13f) {
+      assert_trs_close(glisy_track_sample(&tracks[9], &c, time),
+                       reference(&tracks[9], time));
+    }
+    for (int k = 0; k < 200; ++k) {
+      float time = (float) ((k * 7919) % 997) * 0.005f;
+      assert_trs_close(glisy_track_sample(&tracks[9], &c, time),
+                       reference(&tracks[9], time));
+    }
+  }
+
+  // batch sampling matches single sampling and keeps padding zero
+  {
+    vec3_soa translation = vec3_soa_create();
+    vec3_soa scale = vec3_soa_create();
+    quat_soa rotation = quat_soa_create();
+    for (size_t count = 0; count <= TRACKS; count += 9) {
+      for (int i = 0; i < TRACKS; ++i) cursors[i] = track_cursor_create();
+      for (float time = 0; time < 4; time += 0.37f) {
+        assert(0 == glisy_track_sample_batch(&translation, &rotation, &scale,
+                                             tracks, cursors, count, time));
+        assert(count == rotation.count && count == scale.count);
+        for (size_t i = 0; i < count; ++i) {
+          trs s = trs(vec3_soa_get(translation, i),
+                      quat_soa_get(rotation, i),
+                      vec3_soa_get(scale, i));
+          assert_trs_close(s, reference(&tracks[i], time));
+        }
+        for (size_t i = count; i < rotation.capacity; ++i) {
+          assert(0 == rotation.w[i] && 0 == scale.x[i]);
+        }
+      }
+    }
+    vec3_soa_free(translation);
+    vec3_soa_free(scale);
+    quat_soa_free(rotation);
+  }
+
+  for (int i = 0; i < TRACKS; ++i) track_free(tracks[i]);
+  return 0;
+}
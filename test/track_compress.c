@@ -0,0 +1,212 @@
+#include <assert.h>
+#include <glisy/track_compress.h>
+
+#include "test.h"
+
+#define TRACKS 41
+#define FRAMES 240
+#define RATE 60.0f
+
+static track tracks[TRACKS];
+static track_cursor cursors[TRACKS];
+
+static size_t
+clip_keys (const track_clip *clip, int channel) {
+  const track_clip_channel *h = (const track_clip_channel *) clip->data;
+  size_t keys = 0;
+  for (size_t i = 0; i < clip->count; ++i) keys += h[3 * i + channel].count;
+  return keys;
+}
+
+/**
+ * Asserts that clip rebuilds every input key within tol.
+ */
+
+static void
+assert_within (const track_clip *clip, const track_tolerance *tol) {
+  for (size_t i = 0; i < clip->count; ++i) {
+    const track *t = &tracks[i];
+    track_cursor c = track_cursor_create();
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f / RATE;
+      trs s = glisy_track_clip_sample(clip, i, &c, time);
+      if (t->translation.count) {
+        const float *v = t->translation.values + 3 * f;
+        vec3 d = vec3_subtract(s.translation, vec3(v[0], v[1], v[2]));
+        assert(vec3_length(d) <= tol->translation * 1.0001f);
+      } else {
+        assert(0 == s.translation.x && 0 == s.translation.z);
+      }
+      if (t->rotation.count) {
+        const float *v = t->rotation.values + 4 * f;
+        quat q = quat(v[0], v[1], v[2], v[3]);
+        assert(glisy_quat_error_degrees(s.rotation, q) <=
+               tol->rotation * 1.0001f);
+      } else {
+        assert(1 == s.rotation.w);
+      }
+      const float *v = t->scale.values + 3 * f;
+      vec3 d = vec3_subtract(s.scale, vec3(v[0], v[1], v[2]));
+      assert(vec3_length(d) <= tol->scale * 1.0001f);
+    }
+  }
+}
+
+int
+main (void) {
+  // baked tracks: linear, smooth and slightly noisy motion
+  for (int i = 0; i < TRACKS; ++i) {
+    vec3 axis = vec3_normalize(vec3(1, i % 5, 2 - i % 3));
+    for (int f = 0; f < FRAMES; ++f) {
+      float time = f / RATE, noise = 0.0002f * ((f * 7 + i) % 3 - 1);
+      vec3 p = vec3(i + 2 * time, 0.5f * time, -time);
+      if (i % 4) {
+        p = vec3(sinf(time * (1 + i % 3)), cosf(time * 2) + noise,
+                 0.1f * i);
+      }
+      quat q;
+      quat_set_axis_angle(q, axis, 0.3f * i + sinf(time) * 2 + noise);
+      if (f % 2) q = quat_scale(q, -1);
+      vec3 s = vec3(1, 1, 1);
+      if (i % 3 == 0) s = vec3(1 + 0.2f * sinf(time * 3), 1, 1);
+      if (i != 5) assert(0 == glisy_track_add_translation(&tracks[i],
+                                                          time, p));
+      if (i != 6) assert(0 == glisy_track_add_rotation(&tracks[i], time, q));
+      assert(0 == glisy_track_add_scale(&tracks[i], time, s));
+    }
+  }
+
+  track_tolerance tol = track_tolerance_create();
+  track_clip clip = track_clip_create(), serial = track_clip_create();
+  glisy_pool pool;
+  assert(0 == glisy_pool_init(&pool, 4, 0));
+
+  // threads do not change the result
+  assert(0 == glisy_track_compress(&pool, &clip, tracks, TRACKS, &tol));
+  assert(0 == glisy_track_compress(NULL, &serial, tracks, TRACKS, &tol));
+  assert(TRACKS == clip.count);
+  assert(clip.size == serial.size);
+  assert(0 == memcmp(clip.data, serial.data, clip.size));
+  track_clip_free(serial);
+  assert(0 == serial.data && 0 == serial.size);
+
+  // within tolerance, quantized and much smaller
+  assert(clip.error[0] <= tol.translation);
+  assert(clip.error[1] <= tol.rotation);
+  assert(clip.error[2] <= tol.scale);
+  assert_within(&clip, &tol);
+  {
+    const track_clip_channel *h = (const track_clip_channel *) clip.data;
+    assert(GLISY_TRACK_CLIP_VEC3_U16 == h[0].format);
+    assert(GLISY_TRACK_CLIP_QUAT48 == h[1].format);
+    // linear motion needs its ends, a constant one key, an empty none
+    assert(2 == h[0].count);
+    assert(1 == h[3 * 1 + 2].count);
+    assert(0 == h[3 * 5 + 0].count && 0 == h[3 * 6 + 1].count);
+    assert(clip_keys(&clip, 0) < TRACKS * FRAMES / 2);
+    assert(clip_keys(&clip, 1) < TRACKS * FRAMES / 4);
+    // a fifth of the floats the keys were baked as
+    assert(clip.size < TRACKS * FRAMES * 13 * sizeof(float) / 5);
+  }
+
+  // fitting keeps no more keys than interpolating the inputs
+  {
+    track_tolerance plain = tol;
+    track_clip unfit = track_clip_create();
+    plain.flags = 0;
+    assert(0 == glisy_track_compress(&pool, &unfit, tracks, TRACKS,
+                                     &plain));
+    assert_within(&unfit, &plain);
+    for (int c = 0; c < 3; ++c) {
+      assert(clip_keys(&clip, c) <= clip_keys(&unfit, c));
+    }
+    assert(clip.size < unfit.size);
+    track_clip_free(unfit);
+  }
+
+  // tolerances below the quantization error keep floats
+  {
+    track_tolerance fine = {0.00001f, 0.005f, 0.00001f, GLISY_TRACK_FIT};
+    track_clip exact = track_clip_create();
+    assert(0 == glisy_track_compress(NULL, &exact, tracks, TRACKS, &fine));
+    const track_clip_channel *h = (const track_clip_channel *) exact.data;
+    assert(GLISY_TRACK_CLIP_VEC3 == h[3].format);
+    assert(GLISY_TRACK_CLIP_QUAT == h[1].format);
+    assert_within(&exact, &fine);
+    track_clip_free(exact);
+  }
+
+  // the data is position independent, and samples like the tracks
+  {
+    track_clip moved = clip;
+    moved.data = glisy_simd_alloc(clip.size);
+    memcpy(moved.data, clip.data, clip.size);
+    memset(clip.data, 0xff, clip.size);
+    free(clip.data);
+    clip = moved;
+    assert_within(&clip, &tol);
+
+    track_cursor c = track_cursor_create(), d = track_cursor_create();
+    for (float time = -1; time < 5; time += 0.0123f) {
+      trs a = track_clip_sample(clip, 2, c, time);
+      trs b = track_sample(tracks[2], d, time);
+      assert(vec3_distance(a.translation, b.translation) < 0.001f);
+      assert(glisy_quat_error_degrees(a.rotation, b.rotation) < 0.1f);
+      assert(vec3_distance(a.scale, b.scale) < 0.001f);
+    }
+  }
+
+  // batch sampling matches single sampling and keeps padding zero
+  {
+    vec3_soa translation = vec3_soa_create();
+    vec3_soa scale = vec3_soa_create();
+    quat_soa rotation = quat_soa_create();
+    for (float time = -0.5f; time < 5; time += 0.21f) {
+      assert(0 == glisy_track_clip_sample_batch(&translation, &rotation,
+                                                &scale, &clip, cursors,
+                                                time));
+      assert(TRACKS == translation.count);
+      for (size_t i = 0; i < TRACKS; ++i) {
+        track_cursor c = track_cursor_create();
+        trs s = glisy_track_clip_sample(&clip, i, &c, time);
+        assert(vec3_distance(s.translation,
+                             vec3_soa_get(translation, i)) < 1e-5f);
+        assert(glisy_quat_error_degrees(s.rotation,
+                                        quat_soa_get(rotation, i)) < 1e-3f);
+        assert(vec3_distance(s.scale, vec3_soa_get(scale, i)) < 1e-5f);
+      }
+      for (size_t i = TRACKS; i < rotation.capacity; ++i) {
+        assert(0 == rotation.w[i] && 0 == scale.x[i]);
+      }
+    }
+    vec3_soa_free(translation);
+    vec3_soa_free(scale);
+    quat_soa_free(rotation);
+  }
+
+  // a couple of tracks still spread over the pool
+  {
+    track_clip pair = track_clip_create();
+    assert(0 == glisy_track_compress(&pool, &pair, tracks, 2, &tol));
+#ifndef GLISY_NO_THREADS
+    assert(2 == pool.chunks);
+#endif
+    const track_clip_channel *a = (const track_clip_channel *) pair.data;
+    const track_clip_channel *b = (const track_clip_channel *) clip.data;
+    for (int c = 0; c < 6; ++c) assert(a[c].count == b[c].count);
+    track_clip_free(pair);
+  }
+
+  // no tracks make an empty clip
+  {
+    track_clip empty = track_clip_create();
+    assert(0 == glisy_track_compress(&pool, &empty, tracks, 0, &tol));
+    assert(0 == empty.count && 0 == empty.size);
+    track_clip_free(empty);
+  }
+
+  track_clip_free(clip);
+  glisy_pool_destroy(&pool);
+  for (int i = 0; i < TRACKS; ++i) track_free(tracks[i]);
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/vec3.h>
+#include <glisy/vec4.h>
+#include <glisy/mat4.h>
+
+#include "test.h"
+
+#define COUNT 103
+
+static inline int
+close_to (float a, float b) {
+  return fabsf(a - b) <= 1e-5f * fmaxf(1.0f, fabsf(b));
+}
+
+static vec3 points[COUNT];
+static vec3 out3[COUNT];
+static vec4 points4[COUNT];
+static vec4 out4[COUNT];
+static float xs[COUNT], ys[COUNT], zs[COUNT], ws[COUNT];
+static float ox[COUNT], oy[COUNT], oz[COUNT], ow[COUNT];
+
+int
+main (void) {
+  mat4 model = mat4_create();
+  mat4_rotate(model, 0.7f, vec3(1, 2, 3));
+  model = mat4_translate(model, vec3(4, -5, 6));
+  mat4 projection = mat4_perspective(GLISY_PI / 3, 1.5, 0.1, 100);
+  mat4 mvp = mat4_multiply(model, projection);
+
+  for (int i = 0; i < COUNT; ++i) {
+    points[i] = vec3(i * 0.5f, 1 - i * 0.25f, -i);
+    points4[i] = vec4(points[i].x, points[i].y, points[i].z, 1 + (i & 1));
+    xs[i] = points[i].x;
+    ys[i] = points[i].y;
+    zs[i] = points[i].z;
+    ws[i] = points4[i].w;
+  }
+
+  // single point transforms
+  vec3 p = vec3_transform_mat4(vec3(1, 2, 3), mat4(1,0,0,0,
+                                                   0,1,0,0,
+                                                   0,0,1,0,
+                                                   4,5,6,2));
+  assert(fcmp(2.5, p.x));
+  assert(fcmp(3.5, p.y));
+  assert(fcmp(4.5, p.z));
+  p = vec3_transform_mat4_affine(vec3(1, 2, 3), mat4(1,0,0,0,
+                                                     0,1,0,0,
+                                                     0,0,1,0,
+                                                     4,5,6,2));
+  assert(fcmp(5, p.x));
+  assert(fcmp(7, p.y));
+  assert(fcmp(9, p.z));
+
+  // affine vec3 batch
+  glisy_vec3_transform_mat4_affine_batch(out3, points, COUNT, &model);
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 e = vec3_transform_mat4_affine(points[i], model);
+    assert(close_to(out3[i].x, e.x));
+    assert(close_to(out3[i].y, e.y));
+    assert(close_to(out3[i].z, e.z));
+  }
+
+  // projective vec3 batch, in place
+  memcpy(out3, points, sizeof(points));
+  glisy_vec3_transform_mat4_batch(out3, out3, COUNT, &mvp);
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 e = vec3_transform_mat4(points[i], mvp);
+    assert(close_to(out3[i].x, e.x));
+    assert(close_to(out3[i].y, e.y));
+    assert(close_to(out3[i].z, e.z));
+  }
+
+  // SoA streams
+  glisy_vec3_transform_mat4_streams(ox, oy, oz, xs, ys, zs, COUNT, &mvp);
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 e = vec3_transform_mat4(points[i], mvp);
+    assert(close_to(ox[i], e.x));
+    assert(close_to(oy[i], e.y));
+    assert(close_to(oz[i], e.z));
+  }
+  glisy_vec3_transform_mat4_affine_streams(ox, oy, oz, xs, ys, zs,
+                                           COUNT, &model);
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 e = vec3_transform_mat4_affine(points[i], model);
+    assert(close_to(ox[i], e.x));
+    assert(close_to(oy[i], e.y));
+    assert(close_to(oz[i], e.z));
+  }
+
+  // vec4 batch
+  glisy_vec4_transform_mat4_batch(out4, points4, COUNT, &mvp);
+  for (int i = 0; i < COUNT; ++i) {
+    vec4 e = vec4_transform_mat4(points4[i], mvp);
+    assert(close_to(out4[i].x, e.x));
+    assert(close_to(out4[i].y, e.y));
+    assert(close_to(out4[i].z, e.z));
+    assert(close_to(out4[i].w, e.w));
+  }
+
+  // vec4 streams with and without w
+  glisy_vec4_transform_mat4_streams(ox, oy, oz, ow, xs, ys, zs, ws,
+                                    COUNT, &mvp);
+  for (int i = 0; i < COUNT; ++i) {
+    vec4 e = vec4_transform_mat4(points4[i], mvp);
+    assert(close_to(ox[i], e.x));
+    assert(close_to(oy[i], e.y));
+    assert(close_to(oz[i], e.z));
+    assert(close_to(ow[i], e.w));
+  }
+  glisy_vec4_transform_mat4_streams(ox, oy, oz, ow, xs, ys, zs, 0,
+                                    COUNT, &mvp);
+  for (int i = 0; i < COUNT; ++i) {
+    vec4 e = vec4_transform_mat4(vec4(xs[i], ys[i], zs[i], 1), mvp);
+    assert(close_to(ox[i], e.x));
+    assert(close_to(ow[i], e.w));
+  }
+
+  return 0;
+}
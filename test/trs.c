@@ -0,0 +1,150 @@
+#include <assert.h>
+#include <float.h>
+#include <glisy/trs.h>
+
+#include "test.h"
+
+#define COUNT 21
+
+static trs ts[COUNT], us[COUNT], tmp[COUNT];
+static mat4 m4[COUNT];
+static mat3x4 m34[COUNT];
+
+/**
+ * Asserts quats a and b are the same rotation, either sign.
+ */
+
+static inline void
+quat_assert_rotation (quat a, quat b) {
+  float s = quat_dot(a, b) < 0 ? -1 : 1;
+  assert(fcmp(a.x, s * b.x) && fcmp(a.y, s * b.y));
+  assert(fcmp(a.z, s * b.z) && fcmp(a.w, s * b.w));
+}
+
+static inline trs
+random_trs (int uniform) {
+  trs a;
+  quat_set_axis_angle(a.rotation,
+                      vec3_normalize(vec3(random_float(), random_float(),
+                                          random_float())),
+                      random_float() * 3.0f);
+  a.translation = vec3(random_float() * 10, random_float() * 10,
+                       random_float() * 10);
+  a.scale.x = 1.5f + random_float();
+  a.scale.y = uniform ? a.scale.x : 1.5f + random_float();
+  a.scale.z = uniform ? a.scale.x : 1.5f + random_float();
+  return a;
+}
+
+/**
+ * The mat4 built the old way, from mat4_from_quat, the translation
+ * row and mat4_scale.
+ */
+
+static inline mat4
+reference (trs a) {
+  mat4 m = mat4_from_quat(a.rotation);
+  m.m41 = a.translation.x;
+  m.m42 = a.translation.y;
+  m.m43 = a.translation.z;
+  return mat4_scale(m, a.scale);
+}
+
+int
+main (void) {
+  assert(40 == sizeof(trs));
+
+  for (int i = 0; i < COUNT; ++i) {
+    ts[i] = random_trs(0);
+    us[i] = random_trs(i % 2);
+  }
+
+  // identity
+  {
+    mat4_assert_close(trs_to_mat4(trs_create()), mat4_create());
+  }
+
+  // to_mat4 and to_mat3x4 match the matrix builders
+  for (int i = 0; i < COUNT; ++i) {
+    mat4 e = reference(ts[i]);
+    mat4_assert_close(trs_to_mat4(ts[i]), e);
+    mat4_assert_close(mat3x4_to_mat4(trs_to_mat3x4(ts[i])), e);
+  }
+
+  // transform_point matches the matrix
+  for (int i = 0; i < COUNT; ++i) {
+    vec3 p = vec3(random_float() * 4, random_float(), random_float() * 2);
+    vec3_assert_close(trs_transform_point(ts[i], p),
+                      vec3_transform_mat4_affine(p, reference(ts[i])));
+  }
+
+  // from_mat4 recovers the transform, including a mirror
+  for (int i = 0; i < COUNT; ++i) {
+    trs a = ts[i];
+    if (i == 3) a.scale.y = -a.scale.y;
+    trs d = trs_from_mat4(reference(a));
+    mat4_assert_close(trs_to_mat4(d), reference(a));
+    if (i != 3) {
+      vec3_assert_close(d.scale, a.scale);
+      vec3_assert_close(d.translation, a.translation);
+      quat_assert_rotation(d.rotation, a.rotation);
+    }
+    mat4_assert_close(trs_to_mat4(trs_from_mat3x4(trs_to_mat3x4(a))),
+                      reference(a));
+  }
+
+  // multiply matches mat4_multiply for a uniformly scaled parent
+  for (int i = 0; i < COUNT; ++i) {
+    trs parent = random_trs(1);
+    mat4_assert_close(trs_to_mat4(trs_multiply(parent, ts[i])),
+                      mat4_multiply(reference(parent), reference(ts[i])));
+  }
+
+  // invert
+  for (int i = 0; i < COUNT; ++i) {
+    trs a = random_trs(1);
+    mat4_assert_close(trs_to_mat4(trs_invert(a)),
+                      mat4_invert(reference(a)));
+    mat4_assert_close(trs_to_mat4(trs_multiply(a, trs_invert(a))),
+                      mat4_create());
+  }
+
+  // lerp
+  {
+    trs a = ts[0], b = ts[1];
+    trs c = trs_lerp(a, b, 0);
+    trs d = trs_lerp(a, b, 1);
+    trs h = trs_lerp(a, b, 0.5f);
+    quat r;
+    quat_slerp(r, a.rotation, b.rotation, 0.5f);
+    vec3_assert_close(c.translation, a.translation);
+    vec3_assert_close(d.scale, b.scale);
+    quat_assert_rotation(d.rotation, b.rotation);
+    vec3_assert_close(h.translation,
+                      vec3_lerp(a.translation, b.translation, 0.5f));
+    quat_assert_rotation(h.rotation, r);
+  }
+
+  // batch kernels agree with the single forms
+  {
+    glisy_trs_to_mat4_batch(m4, ts, COUNT);
+    glisy_trs_to_mat3x4_batch(m34, ts, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat4_assert_close(m4[i], trs_to_mat4(ts[i]));
+      mat4_assert_close(mat3x4_to_mat4(m34[i]), trs_to_mat4(ts[i]));
+    }
+
+    glisy_trs_from_mat4_batch(tmp, m4, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      mat4_assert_close(trs_to_mat4(tmp[i]), m4[i]);
+    }
+
+    glisy_trs_multiply_batch(tmp, us, ts, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      trs e = trs_multiply(us[i], ts[i]);
+      assert(0 == memcmp(&tmp[i], &e, sizeof(trs)));
+    }
+  }
+
+  return 0;
+}
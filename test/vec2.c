@@ -0,0 +1,25 @@
+#include <assert.h>
+#include <glisy/vec2.h>
+#include <glisy/mat4.h>
+
+#include "test.h"
+
+static inline void
+vec2_assert_equals (vec2 a, vec2 b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+}
+
+int
+main (void) {
+  // inverse
+  vec2_assert_equals(vec2_inverse(vec2(2,4)), vec2(0.5,0.25));
+
+  // transform by mat4 uses the translation row
+  vec2_assert_equals(vec2_transform_mat4(vec2(1,2), mat4(2,0,0,0,
+                                                         0,3,0,0,
+                                                         7,7,1,0,
+                                                         5,6,0,1)),
+                     vec2(7,12));
+  return 0;
+}
@@ -0,0 +1,23 @@
+#include <assert.h>
+#include <glisy/vec4.h>
+
+#include "test.h"
+
+static inline void
+vec4_assert_equals (vec4 a, vec4 b) {
+  assert(fcmp(a.x, b.x));
+  assert(fcmp(a.y, b.y));
+  assert(fcmp(a.z, b.z));
+  assert(fcmp(a.w, b.w));
+}
+
+int
+main (void) {
+  // negate
+  vec4_assert_equals(vec4_negate(vec4(1,-2,3,-4)), vec4(-1,2,-3,4));
+
+  // inverse
+  vec4_assert_equals(vec4_inverse(vec4(1,2,4,8)),
+                     vec4(1,0.5,0.25,0.125));
+  return 0;
+}